@@ -43,6 +43,7 @@
 #include <vmm_cache.h>
 #include <vmm_delay.h>
 #include <vmm_stdio.h>
+#include <vmm_host_ram.h>
 #include <libs/stringlib.h>
 
 #include <cpu_defines.h>
@@ -121,6 +122,20 @@ static const struct smp_operations * __init smp_get_ops(const char *name)
 	return NULL;
 }
 
+/*
+ * Read a cpu's NUMA node (if any) from the device tree and
+ * record it for host RAM placement.
+ */
+static void __init smp_read_numa_node(struct vmm_devtree_node *dn, int cpu)
+{
+	u32 node;
+
+	if (!vmm_devtree_read_u32(dn,
+			VMM_DEVTREE_NUMA_NODE_ID_ATTR_NAME, &node)) {
+		vmm_host_ram_set_cpu_node(cpu, node);
+	}
+}
+
 /*
  * Read a cpu's enable method from the device tree and 
  * record it in smp_cpu_ops.
@@ -209,6 +224,7 @@ int __init arch_smp_init_cpus(void)
 		return rc;
 	}
 	smp_read_ops(dn, 0);
+	smp_read_numa_node(dn, 0);
 	vmm_devtree_dref_node(dn);
 
 	dn = NULL;
@@ -286,6 +302,7 @@ int __init arch_smp_init_cpus(void)
 		DPRINTF("%s: smp logical map CPU%0 -> HWID 0x%llx\n",
 			__func__, cpu, hwid);
 		smp_logical_map(cpu) = hwid;
+		smp_read_numa_node(dn, cpu);
 next:
 		cpu++;
 	}
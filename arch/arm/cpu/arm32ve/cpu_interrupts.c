@@ -30,6 +30,7 @@
 #include <cpu_vcpu_excep.h>
 #include <cpu_vcpu_emulate.h>
 #include <cpu_vcpu_helper.h>
+#include <arch_profiler.h>
 
 void do_undef_inst(arch_regs_t *regs)
 {
@@ -256,6 +257,16 @@ void do_fiq(arch_regs_t *regs)
 	vmm_scheduler_irq_exit(regs);
 }
 
+unsigned long arch_profiler_regs_pc(arch_regs_t *regs, bool *guest_mode)
+{
+	if (guest_mode) {
+		*guest_mode = ((regs->cpsr & CPSR_MODE_MASK) !=
+			       CPSR_MODE_HYPERVISOR) ? TRUE : FALSE;
+	}
+
+	return regs->pc;
+}
+
 int __cpuinit arch_cpu_irq_setup(void)
 {
 	extern u32 _start_vect[];
@@ -70,7 +70,8 @@ static int cpu_vcpu_stage2_map(struct vmm_vcpu *vcpu,
 		size = TTBL_L2_BLOCK_SIZE;
 		rc = vmm_guest_physical_map(vcpu->guest, inaddr, size,
 				    &outaddr, &availsz, &reg_flags);
-		if (!rc && (availsz >= TTBL_L2_BLOCK_SIZE)) {
+		if (!rc && (availsz >= TTBL_L2_BLOCK_SIZE) &&
+		    !(outaddr & ~TTBL_L2_MAP_MASK)) {
 			pg.ia = inaddr;
 			pg.sz = size;
 			pg.oa = outaddr;
@@ -80,7 +81,8 @@ static int cpu_vcpu_stage2_map(struct vmm_vcpu *vcpu,
 		size = TTBL_L1_BLOCK_SIZE;
 		rc = vmm_guest_physical_map(vcpu->guest, inaddr, size,
 				    &outaddr, &availsz, &reg_flags);
-		if (!rc && (availsz >= TTBL_L1_BLOCK_SIZE)) {
+		if (!rc && (availsz >= TTBL_L1_BLOCK_SIZE) &&
+		    !(outaddr & ~TTBL_L1_MAP_MASK)) {
 			pg.ia = inaddr;
 			pg.sz = size;
 			pg.oa = outaddr;
@@ -31,6 +31,7 @@
 #include <cpu_vcpu_emulate.h>
 #include <cpu_vcpu_helper.h>
 #include <cpu_defines.h>
+#include <arch_profiler.h>
 
 void do_bad_mode(arch_regs_t *regs, unsigned long mode)
 {
@@ -234,6 +235,18 @@ void do_hyp_fiq(arch_regs_t *regs)
 	vmm_scheduler_irq_exit(regs);
 }
 
+unsigned long arch_profiler_regs_pc(arch_regs_t *regs, bool *guest_mode)
+{
+	u64 mode = regs->pstate & PSR_MODE_MASK;
+
+	if (guest_mode) {
+		*guest_mode = ((mode != PSR_MODE64_EL2t) &&
+			       (mode != PSR_MODE64_EL2h)) ? TRUE : FALSE;
+	}
+
+	return regs->pc;
+}
+
 int __cpuinit arch_cpu_irq_setup(void)
 {
 	extern u32 vectors[];
@@ -23,8 +23,11 @@
 
 #include <vmm_error.h>
 #include <vmm_stdio.h>
+#include <vmm_timer.h>
 #include <vmm_host_aspace.h>
 #include <vmm_guest_aspace.h>
+#include <vmm_guest_dedup.h>
+#include <arch_atomic64.h>
 #include <libs/stringlib.h>
 #include <cpu_inline_asm.h>
 #include <cpu_vcpu_helper.h>
@@ -35,16 +38,162 @@
 #include <emulate_arm.h>
 #include <emulate_thumb.h>
 
+static void cpu_vcpu_stage2_page_attr(struct cpu_page *pg, u32 reg_flags)
+{
+	if (reg_flags & VMM_REGION_VIRTUAL) {
+		pg->af = 0;
+		pg->ap = TTBL_HAP_NOACCESS;
+	} else if (reg_flags & VMM_REGION_READONLY) {
+		pg->af = 1;
+		pg->ap = TTBL_HAP_READONLY;
+	} else {
+		pg->af = 1;
+		pg->ap = TTBL_HAP_READWRITE;
+	}
+
+	/* memattr in stage 2
+	 * ------------------
+	 *  0x0 - strongly ordered
+	 *  0x5 - normal-memory NC
+	 *  0xA - normal-memory WT
+	 *  0xF - normal-memory WB
+	 */
+	if (reg_flags & VMM_REGION_CACHEABLE) {
+		if (reg_flags & VMM_REGION_BUFFERABLE) {
+			pg->memattr = 0xF;
+		} else {
+			pg->memattr = 0xA;
+		}
+	} else {
+		pg->memattr = 0x0;
+	}
+}
+
+static void cpu_vcpu_stage2_count_block(struct vmm_guest *guest,
+					physical_size_t size)
+{
+	struct arm_guest_priv *gpriv = arm_guest_priv(guest);
+
+	if (size == TTBL_L1_BLOCK_SIZE) {
+		arch_atomic64_inc(&gpriv->stage2_l1_blocks);
+	} else if (size == TTBL_L2_BLOCK_SIZE) {
+		arch_atomic64_inc(&gpriv->stage2_l2_blocks);
+	} else {
+		arch_atomic64_inc(&gpriv->stage2_l3_pages);
+	}
+}
+
+/*
+ * With dirty page logging, RAM is mapped read-only upon read fault and
+ * writable pages are mapped only upon write fault.
+ */
+static bool cpu_vcpu_stage2_dirty_log(struct vmm_guest *guest, u32 reg_flags)
+{
+	if (!vmm_guest_dirty_log_enabled(guest)) {
+		return FALSE;
+	}
+
+	return ((reg_flags & VMM_REGION_ISRAM) &&
+		!(reg_flags & (VMM_REGION_READONLY | VMM_REGION_VIRTUAL))) ?
+		TRUE : FALSE;
+}
+
+/*
+ * Guests with page deduplication are mapped using pages only so that
+ * a shared page can be mapped read-only independent of its neighbours.
+ */
+static int cpu_vcpu_stage2_dedup_map(struct vmm_vcpu *vcpu,
+				     physical_addr_t fipa,
+				     bool write, bool perm_fault)
+{
+	int rc;
+	u32 reg_flags = 0x0;
+	bool dirty_log;
+	u64 tstamp = vmm_timer_timestamp();
+	struct cpu_page pg;
+	physical_addr_t inaddr, outaddr;
+	physical_size_t availsz;
+	struct vmm_guest *guest = vcpu->guest;
+
+	inaddr = fipa & TTBL_L3_MAP_MASK;
+
+	/* Pages are not merged or freed while we are mapping them */
+	vmm_guest_memory_access_begin(guest);
+
+	rc = vmm_guest_dedup_fault(guest, inaddr, write,
+				   &outaddr, &reg_flags);
+	if (rc == VMM_ENOENT) {
+		if (perm_fault) {
+			/* Permission fault not caused by sharing */
+			goto done;
+		}
+		rc = vmm_guest_physical_map(guest, inaddr, TTBL_L3_BLOCK_SIZE,
+					    &outaddr, &availsz, &reg_flags);
+		if (!rc && (availsz < TTBL_L3_BLOCK_SIZE)) {
+			rc = VMM_EFAIL;
+		}
+	}
+	if (rc) {
+		vmm_printf("%s: IPA=0x%lx map failed (error %d)\n",
+			   __func__, inaddr, rc);
+		goto done;
+	}
+
+	dirty_log = cpu_vcpu_stage2_dirty_log(guest, reg_flags);
+	if (dirty_log && !write) {
+		reg_flags |= VMM_REGION_READONLY;
+	}
+
+	/* Drop stale mapping (if any) before mapping the page */
+	cpu_vcpu_stage2_unmap(guest, inaddr, TTBL_L3_BLOCK_SIZE);
+
+	memset(&pg, 0, sizeof(pg));
+	pg.ia = inaddr;
+	pg.oa = outaddr;
+	pg.sz = TTBL_L3_BLOCK_SIZE;
+	pg.sh = 3U;
+	cpu_vcpu_stage2_page_attr(&pg, reg_flags);
+
+	/* Failure means other VCPU mapped it meanwhile so ignore it */
+	if (!mmu_lpae_map_page(arm_guest_priv(guest)->ttbl, &pg)) {
+		cpu_vcpu_stage2_count_block(guest, pg.sz);
+	}
+
+	if (dirty_log && write) {
+		vmm_guest_dirty_log_fault(guest, inaddr, tstamp);
+	}
+
+done:
+	vmm_guest_memory_access_end(guest);
+
+	return rc;
+}
+
 static int cpu_vcpu_stage2_map(struct vmm_vcpu *vcpu,
 			       arch_regs_t *regs,
-			       physical_addr_t fipa)
+			       physical_addr_t fipa, bool write)
 {
 	int rc, rc1;
 	u32 reg_flags = 0x0, pg_reg_flags = 0x0;
+	bool dirty_log;
+	u64 tstamp = 0;
 	struct cpu_page pg;
 	physical_addr_t inaddr, outaddr;
 	physical_size_t size, availsz;
 
+	arch_atomic64_inc(&arm_guest_priv(vcpu->guest)->stage2_faults);
+
+	if (vmm_guest_dedup_enabled(vcpu->guest)) {
+		return cpu_vcpu_stage2_dedup_map(vcpu, fipa, write, FALSE);
+	}
+
+	if (vmm_guest_dirty_log_enabled(vcpu->guest)) {
+		tstamp = vmm_timer_timestamp();
+	}
+
+	/* Host RAM is not freed while we are mapping it */
+	vmm_guest_memory_access_begin(vcpu->guest);
+
 	memset(&pg, 0, sizeof(pg));
 
 	inaddr = fipa & TTBL_L3_MAP_MASK;
@@ -56,13 +205,14 @@ static int cpu_vcpu_stage2_map(struct vmm_vcpu *vcpu,
 	if (rc) {
 		vmm_printf("%s: IPA=0x%lx size=0x%lx map failed\n",
 			   __func__, inaddr, size);
-		return rc;
+		goto done;
 	}
 
 	if (availsz < TTBL_L3_BLOCK_SIZE) {
 		vmm_printf("%s: availsz=0x%lx insufficent for IPA=0x%lx\n",
 			   __func__, availsz, inaddr);
-		return VMM_EFAIL;
+		rc = VMM_EFAIL;
+		goto done;
 	}
 
 	pg.ia = inaddr;
@@ -70,12 +220,18 @@ static int cpu_vcpu_stage2_map(struct vmm_vcpu *vcpu,
 	pg.oa = outaddr;
 	pg_reg_flags = reg_flags;
 
-	if (reg_flags & (VMM_REGION_ISRAM | VMM_REGION_ISROM)) {
+	/* Writable pages are tracked individually with dirty page logging */
+	dirty_log = cpu_vcpu_stage2_dirty_log(vcpu->guest, reg_flags);
+
+	/* Blocks are used only when host address is equally aligned */
+	if ((reg_flags & (VMM_REGION_ISRAM | VMM_REGION_ISROM)) &&
+	    !(dirty_log && write)) {
 		inaddr = fipa & TTBL_L2_MAP_MASK;
 		size = TTBL_L2_BLOCK_SIZE;
 		rc = vmm_guest_physical_map(vcpu->guest, inaddr, size,
 				    &outaddr, &availsz, &reg_flags);
-		if (!rc && (availsz >= TTBL_L2_BLOCK_SIZE)) {
+		if (!rc && (availsz >= TTBL_L2_BLOCK_SIZE) &&
+		    !(outaddr & ~TTBL_L2_MAP_MASK)) {
 			pg.ia = inaddr;
 			pg.sz = size;
 			pg.oa = outaddr;
@@ -85,7 +241,8 @@ static int cpu_vcpu_stage2_map(struct vmm_vcpu *vcpu,
 		size = TTBL_L1_BLOCK_SIZE;
 		rc = vmm_guest_physical_map(vcpu->guest, inaddr, size,
 				    &outaddr, &availsz, &reg_flags);
-		if (!rc && (availsz >= TTBL_L1_BLOCK_SIZE)) {
+		if (!rc && (availsz >= TTBL_L1_BLOCK_SIZE) &&
+		    !(outaddr & ~TTBL_L1_MAP_MASK)) {
 			pg.ia = inaddr;
 			pg.sz = size;
 			pg.oa = outaddr;
@@ -93,33 +250,11 @@ static int cpu_vcpu_stage2_map(struct vmm_vcpu *vcpu,
 		}
 	}
 
-	if (pg_reg_flags & VMM_REGION_VIRTUAL) {
-		pg.af = 0;
-		pg.ap = TTBL_HAP_NOACCESS;
-	} else if (pg_reg_flags & VMM_REGION_READONLY) {
-		pg.af = 1;
-		pg.ap = TTBL_HAP_READONLY;
-	} else {
-		pg.af = 1;
-		pg.ap = TTBL_HAP_READWRITE;
+	if (dirty_log && !write) {
+		pg_reg_flags |= VMM_REGION_READONLY;
 	}
 
-	/* memattr in stage 2
-	 * ------------------
-	 *  0x0 - strongly ordered
-	 *  0x5 - normal-memory NC
-	 *  0xA - normal-memory WT
-	 *  0xF - normal-memory WB
-	 */
-	if (pg_reg_flags & VMM_REGION_CACHEABLE) {
-		if (pg_reg_flags & VMM_REGION_BUFFERABLE) {
-			pg.memattr = 0xF;
-		} else {
-			pg.memattr = 0xA;
-		}
-	} else {
-		pg.memattr = 0x0;
-	}
+	cpu_vcpu_stage2_page_attr(&pg, pg_reg_flags);
 
 	/* Try to map the page in Stage2 */
 	rc = mmu_lpae_map_page(arm_guest_priv(vcpu->guest)->ttbl, &pg);
@@ -134,15 +269,166 @@ static int cpu_vcpu_stage2_map(struct vmm_vcpu *vcpu,
 		memset(&pg, 0, sizeof(pg));
 		rc1 = mmu_lpae_get_page(arm_guest_priv(vcpu->guest)->ttbl,
 					fipa, &pg);
-		if (rc1) {
-			return rc1;
+		rc = rc1;
+	} else {
+		cpu_vcpu_stage2_count_block(vcpu->guest, pg.sz);
+		if (dirty_log && write) {
+			vmm_guest_dirty_log_fault(vcpu->guest, pg.ia, tstamp);
 		}
-		rc = VMM_OK;
 	}
 
+done:
+	vmm_guest_memory_access_end(vcpu->guest);
+
 	return rc;
 }
 
+static int cpu_vcpu_stage2_write_fault(struct vmm_vcpu *vcpu,
+				       physical_addr_t fipa)
+{
+	int rc;
+	u64 tstamp = vmm_timer_timestamp();
+	struct vmm_region *reg;
+	struct vmm_guest *guest = vcpu->guest;
+
+	/* Write to shared page of deduplicated guest */
+	if (vmm_guest_dedup_enabled(guest)) {
+		rc = cpu_vcpu_stage2_dedup_map(vcpu, fipa, TRUE, TRUE);
+		if (rc != VMM_ENOENT) {
+			return rc;
+		}
+	}
+
+	/* Write to RAM page write protected for dirty page logging */
+	reg = vmm_guest_find_region(guest, fipa,
+				    VMM_REGION_REAL | VMM_REGION_MEMORY, FALSE);
+	if (!vmm_guest_dirty_log_region(reg)) {
+		return VMM_EFAIL;
+	}
+
+	rc = mmu_lpae_write_unprotect_page(arm_guest_priv(guest)->ttbl,
+					   fipa & TTBL_L3_MAP_MASK);
+	if (rc == VMM_ENOENT) {
+		/* Page unmapped meanwhile so let the guest fault again */
+		return VMM_OK;
+	} else if (rc) {
+		vmm_printf("%s: IPA=0x%lx unprotect failed (error %d)\n",
+			   __func__, fipa, rc);
+		return rc;
+	}
+
+	vmm_guest_dirty_log_fault(guest, fipa & TTBL_L3_MAP_MASK, tstamp);
+
+	return VMM_OK;
+}
+
+static bool cpu_vcpu_stage2_prefault_region(struct vmm_region *reg)
+{
+	/* On-demand regions are populated only upon first access */
+	if (!(reg->flags & VMM_REGION_REAL) ||
+	    (reg->flags & (VMM_REGION_ALIAS | VMM_REGION_VIRTUAL |
+			   VMM_REGION_ISONDEMAND))) {
+		return FALSE;
+	}
+
+	return (reg->flags & (VMM_REGION_ISRAM | VMM_REGION_ISROM)) ?
+		TRUE : FALSE;
+}
+
+int cpu_vcpu_stage2_prefault(struct vmm_guest *guest,
+			     struct vmm_region *reg)
+{
+	int rc;
+	u32 i;
+	struct cpu_page pg;
+	physical_addr_t gpa, hpa, gend;
+	physical_size_t availsz;
+	const physical_size_t blksz[] = {
+		TTBL_L1_BLOCK_SIZE, TTBL_L2_BLOCK_SIZE, TTBL_L3_BLOCK_SIZE,
+	};
+	struct arm_guest_priv *gpriv = arm_guest_priv(guest);
+
+	if (!gpriv->stage2_prefault || vmm_guest_dedup_enabled(guest) ||
+	    !cpu_vcpu_stage2_prefault_region(reg)) {
+		return VMM_OK;
+	}
+
+	gpa = VMM_REGION_GPHYS_START(reg);
+	gend = VMM_REGION_GPHYS_END(reg);
+	while (gpa < gend) {
+		/* Use largest block which is aligned on both sides */
+		for (i = 0; i < array_size(blksz); i++) {
+			if ((gpa & (blksz[i] - 1)) || ((gend - gpa) < blksz[i])) {
+				continue;
+			}
+			vmm_guest_find_mapping(guest, reg, gpa, &hpa, &availsz);
+			if ((availsz < blksz[i]) || (hpa & (blksz[i] - 1))) {
+				continue;
+			}
+			break;
+		}
+		if (i == array_size(blksz)) {
+			vmm_printf("%s: no mapping for IPA=0x%"PRIPADDR"\n",
+				   __func__, gpa);
+			return VMM_EFAIL;
+		}
+
+		memset(&pg, 0, sizeof(pg));
+		pg.ia = gpa;
+		pg.oa = hpa;
+		pg.sz = blksz[i];
+		pg.sh = 3U;
+		cpu_vcpu_stage2_page_attr(&pg, reg->flags);
+
+		/* Failure means the block is already mapped so ignore it */
+		rc = mmu_lpae_map_page(gpriv->ttbl, &pg);
+		if (!rc) {
+			arch_atomic64_inc(&gpriv->stage2_prefaults);
+			cpu_vcpu_stage2_count_block(guest, pg.sz);
+		}
+
+		gpa += blksz[i];
+	}
+
+	return VMM_OK;
+}
+
+int cpu_vcpu_stage2_unmap(struct vmm_guest *guest,
+			  physical_addr_t gphys_addr,
+			  physical_size_t phys_size)
+{
+	struct cpu_page pg;
+	physical_addr_t gpa, gend;
+	struct arm_guest_priv *gpriv = arm_guest_priv(guest);
+
+	gpa = gphys_addr;
+	gend = gphys_addr + phys_size;
+	while (gpa < gend) {
+		if (mmu_lpae_get_page(gpriv->ttbl, gpa, &pg)) {
+			gpa += TTBL_L3_BLOCK_SIZE;
+			continue;
+		}
+		mmu_lpae_unmap_page(gpriv->ttbl, &pg);
+		gpa = pg.ia + pg.sz;
+	}
+
+	return VMM_OK;
+}
+
+int cpu_vcpu_stage2_unmap_region(struct vmm_guest *guest,
+				 struct vmm_region *reg)
+{
+	struct arm_guest_priv *gpriv = arm_guest_priv(guest);
+
+	if (!gpriv->stage2_prefault || vmm_guest_dedup_enabled(guest) ||
+	    !cpu_vcpu_stage2_prefault_region(reg)) {
+		return VMM_OK;
+	}
+
+	return cpu_vcpu_stage2_unmap(guest, VMM_REGION_GPHYS_START(reg),
+				     VMM_REGION_PHYS_SIZE(reg));
+}
+
 int cpu_vcpu_inst_abort(struct vmm_vcpu *vcpu,
 			arch_regs_t *regs,
 			u32 il, u32 iss,
@@ -152,7 +438,7 @@ int cpu_vcpu_inst_abort(struct vmm_vcpu *vcpu,
 	case FSC_TRANS_FAULT_LEVEL1:
 	case FSC_TRANS_FAULT_LEVEL2:
 	case FSC_TRANS_FAULT_LEVEL3:
-		return cpu_vcpu_stage2_map(vcpu, regs, fipa);
+		return cpu_vcpu_stage2_map(vcpu, regs, fipa, FALSE);
 	default:
 		break;
 	};
@@ -172,7 +458,8 @@ int cpu_vcpu_data_abort(struct vmm_vcpu *vcpu,
 	case FSC_TRANS_FAULT_LEVEL1:
 	case FSC_TRANS_FAULT_LEVEL2:
 	case FSC_TRANS_FAULT_LEVEL3:
-		return cpu_vcpu_stage2_map(vcpu, regs, fipa);
+		return cpu_vcpu_stage2_map(vcpu, regs, fipa,
+				(iss & ISS_ABORT_WNR_MASK) ? TRUE : FALSE);
 	case FSC_ACCESS_FAULT_LEVEL1:
 	case FSC_ACCESS_FAULT_LEVEL2:
 	case FSC_ACCESS_FAULT_LEVEL3:
@@ -203,6 +490,13 @@ int cpu_vcpu_data_abort(struct vmm_vcpu *vcpu,
 			return cpu_vcpu_emulate_load(vcpu, regs,
 						     il, iss, fipa);
 		}
+	case FSC_PERM_FAULT_LEVEL1:
+	case FSC_PERM_FAULT_LEVEL2:
+	case FSC_PERM_FAULT_LEVEL3:
+		if (iss & ISS_ABORT_WNR_MASK) {
+			return cpu_vcpu_stage2_write_fault(vcpu, fipa);
+		}
+		/* Fall-through */
 	default:
 		vmm_printf("%s: Unhandled FSC=0x%x\n",
 			   __func__, iss & ISS_ABORT_FSC_MASK);
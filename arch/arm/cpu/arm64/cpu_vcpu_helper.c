@@ -25,6 +25,7 @@
 #include <vmm_heap.h>
 #include <vmm_smp.h>
 #include <vmm_stdio.h>
+#include <arch_atomic64.h>
 #include <arch_barrier.h>
 #include <libs/stringlib.h>
 #include <libs/mathlib.h>
@@ -32,6 +33,7 @@
 #include <cpu_vcpu_sysregs.h>
 #include <cpu_vcpu_vfp.h>
 #include <cpu_vcpu_helper.h>
+#include <cpu_vcpu_excep.h>
 
 #include <generic_timer.h>
 #include <arm_features.h>
@@ -320,6 +322,15 @@ int arch_guest_init(struct vmm_guest *guest)
 			/* By default, assume PSCI v0.1 */
 			arm_guest_priv(guest)->psci_version = 1;
 		}
+
+		arm_guest_priv(guest)->stage2_prefault =
+			vmm_devtree_getattr(guest->node,
+				"stage2_prefault") ? TRUE : FALSE;
+		arch_atomic64_write(&arm_guest_priv(guest)->stage2_faults, 0);
+		arch_atomic64_write(&arm_guest_priv(guest)->stage2_prefaults, 0);
+		arch_atomic64_write(&arm_guest_priv(guest)->stage2_l1_blocks, 0);
+		arch_atomic64_write(&arm_guest_priv(guest)->stage2_l2_blocks, 0);
+		arch_atomic64_write(&arm_guest_priv(guest)->stage2_l3_pages, 0);
 	}
 
 	return VMM_OK;
@@ -341,12 +352,29 @@ int arch_guest_deinit(struct vmm_guest *guest)
 
 int arch_guest_add_region(struct vmm_guest *guest, struct vmm_region *region)
 {
-	return VMM_OK;
+	return cpu_vcpu_stage2_prefault(guest, region);
 }
 
 int arch_guest_del_region(struct vmm_guest *guest, struct vmm_region *region)
 {
-	return VMM_OK;
+	return cpu_vcpu_stage2_unmap_region(guest, region);
+}
+
+int arch_guest_unmap_region(struct vmm_guest *guest,
+			    struct vmm_region *region,
+			    physical_addr_t gphys_addr,
+			    physical_size_t phys_size)
+{
+	return cpu_vcpu_stage2_unmap(guest, gphys_addr, phys_size);
+}
+
+int arch_guest_write_protect_region(struct vmm_guest *guest,
+				    struct vmm_region *region,
+				    physical_addr_t gphys_addr,
+				    physical_size_t phys_size)
+{
+	return mmu_lpae_write_protect(arm_guest_priv(guest)->ttbl,
+				      gphys_addr, phys_size);
 }
 
 int arch_vcpu_init(struct vmm_vcpu *vcpu)
@@ -829,6 +857,54 @@ void cpu_vcpu_dump_user_reg(arch_regs_t *regs)
 	__cpu_vcpu_dump_user_reg(NULL, regs);
 }
 
+/* VCPU state saved in guest snapshots */
+struct arm_vcpu_state {
+	arch_regs_t regs;
+	struct arm_priv_sysregs sysregs;
+	struct arm_priv_vfp vfp;
+	struct generic_timer_vcpu_state gentimer;
+};
+
+u32 arch_vcpu_state_size(struct vmm_vcpu *vcpu)
+{
+	return sizeof(struct arm_vcpu_state);
+}
+
+int arch_vcpu_state_save(struct vmm_vcpu *vcpu, void *buf, u32 size)
+{
+	struct arm_vcpu_state *st = buf;
+
+	if (!vcpu->is_normal || (size != sizeof(*st))) {
+		return VMM_EINVALID;
+	}
+
+	memcpy(&st->regs, arm_regs(vcpu), sizeof(st->regs));
+	memcpy(&st->sysregs, &arm_priv(vcpu)->sysregs, sizeof(st->sysregs));
+	memcpy(&st->vfp, &arm_priv(vcpu)->vfp, sizeof(st->vfp));
+	generic_timer_vcpu_context_get_state(arm_gentimer_context(vcpu),
+					     &st->gentimer);
+
+	return VMM_OK;
+}
+
+int arch_vcpu_state_restore(struct vmm_vcpu *vcpu,
+			    const void *buf, u32 size)
+{
+	const struct arm_vcpu_state *st = buf;
+
+	if (!vcpu->is_normal || (size != sizeof(*st))) {
+		return VMM_EINVALID;
+	}
+
+	memcpy(arm_regs(vcpu), &st->regs, sizeof(st->regs));
+	memcpy(&arm_priv(vcpu)->sysregs, &st->sysregs, sizeof(st->sysregs));
+	memcpy(&arm_priv(vcpu)->vfp, &st->vfp, sizeof(st->vfp));
+	generic_timer_vcpu_context_set_state(arm_gentimer_context(vcpu),
+					     &st->gentimer);
+
+	return VMM_OK;
+}
+
 void arch_vcpu_regs_dump(struct vmm_chardev *cdev, struct vmm_vcpu *vcpu)
 {
 	struct arm_priv *p;
@@ -862,5 +938,24 @@ void arch_vcpu_regs_dump(struct vmm_chardev *cdev, struct vmm_vcpu *vcpu)
 
 void arch_vcpu_stat_dump(struct vmm_chardev *cdev, struct vmm_vcpu *vcpu)
 {
-	/* For now no arch specific stats */
+	struct arm_guest_priv *gpriv;
+
+	if (!vcpu->is_normal || !vcpu->guest || !vcpu->guest->arch_priv) {
+		return;
+	}
+	gpriv = arm_guest_priv(vcpu->guest);
+
+	/* Stage2 statistics are per-guest */
+	vmm_cprintf(cdev, "Stage2 Prefault  : %s\n",
+		    (gpriv->stage2_prefault) ? "enabled" : "disabled");
+	vmm_cprintf(cdev, "Stage2 Prefaults : %"PRIu64"\n",
+		    arch_atomic64_read(&gpriv->stage2_prefaults));
+	vmm_cprintf(cdev, "Stage2 Faults    : %"PRIu64"\n",
+		    arch_atomic64_read(&gpriv->stage2_faults));
+	vmm_cprintf(cdev, "Stage2 1GB Blocks: %"PRIu64"\n",
+		    arch_atomic64_read(&gpriv->stage2_l1_blocks));
+	vmm_cprintf(cdev, "Stage2 2MB Blocks: %"PRIu64"\n",
+		    arch_atomic64_read(&gpriv->stage2_l2_blocks));
+	vmm_cprintf(cdev, "Stage2 4KB Pages : %"PRIu64"\n",
+		    arch_atomic64_read(&gpriv->stage2_l3_pages));
 }
@@ -151,6 +151,16 @@ struct arm_guest_priv {
 	 * Bits[15:0] = Minor number
 	 */
 	u32 psci_version;
+	/* Populate stage2 for RAM/ROM regions upfront */
+	bool stage2_prefault;
+	/* Stage2 translation faults handled */
+	atomic64_t stage2_faults;
+	/* Stage2 blocks populated upfront */
+	atomic64_t stage2_prefaults;
+	/* Stage2 1GB, 2MB and 4KB mappings created */
+	atomic64_t stage2_l1_blocks;
+	atomic64_t stage2_l2_blocks;
+	atomic64_t stage2_l3_pages;
 };
 
 #define arm_regs(vcpu)		(&((vcpu)->regs))
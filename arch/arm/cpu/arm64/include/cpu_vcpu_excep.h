@@ -26,6 +26,21 @@
 #include <vmm_types.h>
 #include <vmm_manager.h>
 
+/** Populate stage2 mappings of a guest region upfront
+ *  Note: this does nothing unless stage2 prefault is enabled for guest
+ */
+int cpu_vcpu_stage2_prefault(struct vmm_guest *guest,
+			     struct vmm_region *reg);
+
+/** Remove stage2 mappings for given guest physical range */
+int cpu_vcpu_stage2_unmap(struct vmm_guest *guest,
+			  physical_addr_t gphys_addr,
+			  physical_size_t phys_size);
+
+/** Remove stage2 mappings populated by cpu_vcpu_stage2_prefault() */
+int cpu_vcpu_stage2_unmap_region(struct vmm_guest *guest,
+				 struct vmm_region *reg);
+
 /** Handle stage2 instruction abort */
 int cpu_vcpu_inst_abort(struct vmm_vcpu *vcpu,
 			arch_regs_t *regs,
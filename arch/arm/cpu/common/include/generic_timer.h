@@ -75,6 +75,17 @@ struct generic_timer_context {
 	struct vmm_timer_event phys_ev;
 }__packed;
 
+/* Generic timer state of a VCPU saved in guest snapshots */
+struct generic_timer_vcpu_state {
+	u64 vcount;
+	u64 cntpcval;
+	u64 cntvcval;
+	u32 cntkctl;
+	u32 cntpctl;
+	u32 cntvctl;
+	u32 reserved;
+};
+
 int generic_timer_vcpu_context_init(void *vcpu_ptr,
 				    void **context,
 				    u32 phys_irq, u32 virt_irq);
@@ -87,6 +98,12 @@ void generic_timer_vcpu_context_restore(void *vcpu_ptr, void *context);
 
 void generic_timer_vcpu_context_post_restore(void *vcpu_ptr, void *context);
 
+void generic_timer_vcpu_context_get_state(void *context,
+				struct generic_timer_vcpu_state *state);
+
+void generic_timer_vcpu_context_set_state(void *context,
+				const struct generic_timer_vcpu_state *state);
+
 #endif /* __ASSEMBLY__ */
 
 #endif /* __GENERIC_TIMER_H__ */
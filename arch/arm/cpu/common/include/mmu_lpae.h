@@ -85,6 +85,17 @@ int mmu_lpae_unmap_page(struct cpu_ttbl *ttbl, struct cpu_page *pg);
 /** Map a page under a given translation table */
 int mmu_lpae_map_page(struct cpu_ttbl *ttbl, struct cpu_page *pg);
 
+/** Remove write permission from all stage2 mappings of given range
+ *  Note: Block mappings are kept as-is.
+ */
+int mmu_lpae_write_protect(struct cpu_ttbl *ttbl,
+			   physical_addr_t ia, physical_size_t sz);
+
+/** Give write permission to stage2 page mapping given address
+ *  Note: Block mapping containing given address is split into pages.
+ */
+int mmu_lpae_write_unprotect_page(struct cpu_ttbl *ttbl, physical_addr_t ia);
+
 /** Get page from a given virtual address */
 int mmu_lpae_get_hypervisor_page(virtual_addr_t va, struct cpu_page *pg);
 
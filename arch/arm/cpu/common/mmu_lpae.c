@@ -625,6 +625,204 @@ int mmu_lpae_map_page(struct cpu_ttbl *ttbl, struct cpu_page *pg)
 	return VMM_OK;
 }
 
+static void mmu_lpae_invalid_tlb(struct cpu_ttbl *ttbl, physical_addr_t ia)
+{
+	if (ttbl->stage == TTBL_STAGE2) {
+		cpu_invalid_ipa_guest_tlb(ia);
+	} else {
+		cpu_invalid_va_hypervisor_tlb(((virtual_addr_t)ia));
+	}
+}
+
+/* Replace block mapping containing given address with a next level
+ * table mapping same output addresses using same attributes.
+ */
+static int mmu_lpae_split_block(struct cpu_ttbl *ttbl, physical_addr_t ia)
+{
+	int i, index;
+	u64 *tte, *ctte, attr;
+	irq_flags_t flags;
+	physical_addr_t oa;
+	physical_size_t csz;
+	struct cpu_ttbl *child;
+
+	if (ttbl->level == TTBL_LAST_LEVEL) {
+		return VMM_EINVALID;
+	}
+
+	child = mmu_lpae_ttbl_alloc(ttbl->stage);
+	if (!child) {
+		return VMM_ENOMEM;
+	}
+
+	index = mmu_lpae_level_index(ia, ttbl->level);
+	tte = (u64 *)ttbl->tbl_va;
+	ctte = (u64 *)child->tbl_va;
+	csz = mmu_lpae_level_block_size(ttbl->level + 1);
+
+	vmm_spin_lock_irqsave_lite(&ttbl->tbl_lock, flags);
+
+	if (!(tte[index] & TTBL_VALID_MASK)) {
+		vmm_spin_unlock_irqrestore_lite(&ttbl->tbl_lock, flags);
+		mmu_lpae_ttbl_free(child);
+		return VMM_ENOENT;
+	}
+	if (tte[index] & TTBL_TABLE_MASK) {
+		/* Somebody else already did it */
+		vmm_spin_unlock_irqrestore_lite(&ttbl->tbl_lock, flags);
+		mmu_lpae_ttbl_free(child);
+		return VMM_OK;
+	}
+
+	oa = tte[index] &
+		(mmu_lpae_level_map_mask(ttbl->level) & TTBL_OUTADDR_MASK);
+	attr = tte[index] & ~(TTBL_OUTADDR_MASK | TTBL_TABLE_MASK);
+	if (ttbl->stage == TTBL_STAGE2) {
+		attr &= ~TTBL_STAGE2_UPPER_CONT_MASK;
+	} else {
+		attr &= ~TTBL_STAGE1_UPPER_CONT_MASK;
+	}
+	if ((ttbl->level + 1) == TTBL_LAST_LEVEL) {
+		attr |= TTBL_TABLE_MASK;
+	}
+	for (i = 0; i < TTBL_TABLE_ENTCNT; i++) {
+		ctte[i] = attr | ((oa + i * csz) & TTBL_OUTADDR_MASK);
+	}
+	child->tte_cnt = TTBL_TABLE_ENTCNT;
+	cpu_mmu_sync_tte(&ctte[0]);
+
+	/* Break-before-make */
+	tte[index] = 0x0;
+	cpu_mmu_sync_tte(&tte[index]);
+	mmu_lpae_invalid_tlb(ttbl, ia);
+
+	tte[index] |= (child->tbl_pa & TTBL_OUTADDR_MASK);
+	tte[index] |= (TTBL_TABLE_MASK | TTBL_VALID_MASK);
+	cpu_mmu_sync_tte(&tte[index]);
+
+	child->parent = ttbl;
+	child->level = ttbl->level + 1;
+	child->map_ia = ia & mmu_lpae_level_map_mask(ttbl->level);
+	ttbl->child_cnt++;
+	list_add(&child->head, &ttbl->child_list);
+
+	vmm_spin_unlock_irqrestore_lite(&ttbl->tbl_lock, flags);
+
+	return VMM_OK;
+}
+
+static void mmu_lpae_write_protect_range(struct cpu_ttbl *ttbl,
+					 physical_addr_t ia,
+					 physical_addr_t end)
+{
+	int index;
+	u64 *tte, tte_val;
+	irq_flags_t flags;
+	physical_size_t blksz;
+	physical_addr_t next;
+	struct cpu_ttbl *child;
+
+	blksz = mmu_lpae_level_block_size(ttbl->level);
+	tte = (u64 *)ttbl->tbl_va;
+
+	while (ia < end) {
+		next = (ia & mmu_lpae_level_map_mask(ttbl->level)) + blksz;
+		if ((next > end) || (next < ia)) {
+			next = end;
+		}
+		index = mmu_lpae_level_index(ia, ttbl->level);
+
+		vmm_spin_lock_irqsave_lite(&ttbl->tbl_lock, flags);
+		tte_val = tte[index];
+		if ((tte_val & TTBL_VALID_MASK) &&
+		    ((ttbl->level == TTBL_LAST_LEVEL) ||
+		     !(tte_val & TTBL_TABLE_MASK))) {
+			tte[index] = tte_val & ~((u64)TTBL_HAP_WRITEONLY <<
+						TTBL_STAGE2_LOWER_HAP_SHIFT);
+			cpu_mmu_sync_tte(&tte[index]);
+		}
+		vmm_spin_unlock_irqrestore_lite(&ttbl->tbl_lock, flags);
+
+		if ((tte_val & TTBL_VALID_MASK) &&
+		    (ttbl->level < TTBL_LAST_LEVEL) &&
+		    (tte_val & TTBL_TABLE_MASK)) {
+			child = mmu_lpae_ttbl_get_child(ttbl, ia, FALSE);
+			if (child) {
+				mmu_lpae_write_protect_range(child, ia, next);
+			}
+		}
+
+		ia = next;
+	}
+}
+
+int mmu_lpae_write_protect(struct cpu_ttbl *ttbl,
+			   physical_addr_t ia, physical_size_t sz)
+{
+	if (!ttbl || (ttbl->stage != TTBL_STAGE2)) {
+		return VMM_EINVALID;
+	}
+	if (!sz || ((ia + sz) < ia)) {
+		return VMM_EINVALID;
+	}
+
+	mmu_lpae_write_protect_range(ttbl, ia, ia + sz);
+
+	/* Guest TLB is flushed once for the whole range */
+	mmu_lpae_invalid_tlb(ttbl, ia);
+
+	return VMM_OK;
+}
+
+int mmu_lpae_write_unprotect_page(struct cpu_ttbl *ttbl, physical_addr_t ia)
+{
+	int rc, index;
+	u64 *tte, tte_val, hap;
+	irq_flags_t flags;
+	struct cpu_ttbl *child;
+
+	if (!ttbl || (ttbl->stage != TTBL_STAGE2)) {
+		return VMM_EINVALID;
+	}
+
+	index = mmu_lpae_level_index(ia, ttbl->level);
+	tte = (u64 *)ttbl->tbl_va;
+	hap = (u64)TTBL_HAP_READWRITE << TTBL_STAGE2_LOWER_HAP_SHIFT;
+
+	vmm_spin_lock_irqsave_lite(&ttbl->tbl_lock, flags);
+	tte_val = tte[index];
+
+	if (!(tte_val & TTBL_VALID_MASK)) {
+		vmm_spin_unlock_irqrestore_lite(&ttbl->tbl_lock, flags);
+		return VMM_ENOENT;
+	}
+
+	if (ttbl->level == TTBL_LAST_LEVEL) {
+		if ((tte_val & TTBL_STAGE2_LOWER_HAP_MASK) != hap) {
+			tte[index] = tte_val | hap;
+			cpu_mmu_sync_tte(&tte[index]);
+			mmu_lpae_invalid_tlb(ttbl, ia);
+		}
+		vmm_spin_unlock_irqrestore_lite(&ttbl->tbl_lock, flags);
+		return VMM_OK;
+	}
+
+	vmm_spin_unlock_irqrestore_lite(&ttbl->tbl_lock, flags);
+
+	if (!(tte_val & TTBL_TABLE_MASK)) {
+		if ((rc = mmu_lpae_split_block(ttbl, ia))) {
+			return rc;
+		}
+	}
+
+	child = mmu_lpae_ttbl_get_child(ttbl, ia, FALSE);
+	if (!child) {
+		return VMM_ENOENT;
+	}
+
+	return mmu_lpae_write_unprotect_page(child, ia);
+}
+
 int mmu_lpae_get_hypervisor_page(virtual_addr_t va, struct cpu_page *pg)
 {
 	return mmu_lpae_get_page(mmuctrl.hyp_ttbl, va, pg);
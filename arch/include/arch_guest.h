@@ -57,4 +57,43 @@ int arch_guest_add_region(struct vmm_guest *guest, struct vmm_region *region);
  */
 int arch_guest_del_region(struct vmm_guest *guest, struct vmm_region *region);
 
+/** Architecture specific callback for unmapping part of a region
+ *
+ * Remove architecture specific mappings (such as Stage2 page table
+ * entries) for given part of a region so that the guest faults on
+ * next access. This is used when host RAM backing the part of region
+ * is given back to the host.
+ * Note: This function is optional.
+ *
+ * @param guest Guest to which region belongs.
+ * @param region Region being unmapped.
+ * @param gphys_addr Guest physical address of the part.
+ * @param phys_size Size of the part.
+ * @return This function should return VMM_OK on success or
+ * appropriate error code otherwise.
+ */
+int arch_guest_unmap_region(struct vmm_guest *guest,
+			    struct vmm_region *region,
+			    physical_addr_t gphys_addr,
+			    physical_size_t phys_size);
+
+/** Architecture specific callback for write protecting part of a region
+ *
+ * Remove write permission from architecture specific mappings (such as
+ * Stage2 page table entries) for given part of a region so that next
+ * guest write to it traps. This is used for dirty page logging.
+ * Note: This function is optional.
+ *
+ * @param guest Guest to which region belongs.
+ * @param region Region being write protected.
+ * @param gphys_addr Guest physical address of the part.
+ * @param phys_size Size of the part.
+ * @return This function should return VMM_OK on success or
+ * appropriate error code otherwise.
+ */
+int arch_guest_write_protect_region(struct vmm_guest *guest,
+				    struct vmm_region *region,
+				    physical_addr_t gphys_addr,
+				    physical_size_t phys_size);
+
 #endif
@@ -0,0 +1,37 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file arch_profiler.h
+ * @author agent (agent@local)
+ * @brief generic interface for arch specific profiler functions
+ */
+#ifndef _ARCH_PROFILER_H__
+#define _ARCH_PROFILER_H__
+
+#include <vmm_types.h>
+#include <arch_regs.h>
+
+/** Retrive program counter from interrupted register state
+ * Note: This function is optional.
+ * Note: The guest_mode flag is set to TRUE when the register
+ * state belongs to guest execution (i.e. the program counter
+ * is a guest virtual address which cannot be symbolized).
+ */
+unsigned long arch_profiler_regs_pc(arch_regs_t *regs, bool *guest_mode);
+
+#endif
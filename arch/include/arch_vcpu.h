@@ -68,6 +68,23 @@ void arch_vcpu_regs_dump(struct vmm_chardev *cdev, struct vmm_vcpu *vcpu);
 /** Print architecture specific stats for a VCPU */
 void arch_vcpu_stat_dump(struct vmm_chardev *cdev, struct vmm_vcpu *vcpu);
 
+/** Get size of architecture specific VCPU state saved in snapshots
+ *  NOTE: This function is optional and by default only arch_regs_t
+ *  of the VCPU is saved.
+ */
+u32 arch_vcpu_state_size(struct vmm_vcpu *vcpu);
+
+/** Save architecture specific VCPU state to given buffer
+ *  NOTE: This function is called only for a VCPU which is not running.
+ */
+int arch_vcpu_state_save(struct vmm_vcpu *vcpu, void *buf, u32 size);
+
+/** Restore architecture specific VCPU state from given buffer
+ *  NOTE: This function is called only for a VCPU which is not running.
+ */
+int arch_vcpu_state_restore(struct vmm_vcpu *vcpu,
+			    const void *buf, u32 size);
+
 /** Get count of VCPU interrupts */
 u32 arch_vcpu_irq_count(struct vmm_vcpu *vcpu);
 
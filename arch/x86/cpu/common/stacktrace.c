@@ -73,9 +73,32 @@ void arch_save_stacktrace(struct stack_trace *trace)
 		trace->entries[trace->nr_entries++] = 0UL;
 }
 
+extern u8 __x86_vmm_address(virtual_addr_t addr);
+
+/*
+ * Save stack-backtrace addresses of interrupted context into a
+ * stack_trace buffer. This is called from sampling profiler timer
+ * hence it walks frame pointer chain silently and only follows
+ * frames moving up within one thread stack of interrupted context.
+ */
 void arch_save_stacktrace_regs(struct arch_regs *regs, struct stack_trace *trace)
 {
-	dump_trace(regs, NULL, 0, &save_stack_ops, trace);
+	unsigned long sp = regs->rsp;
+	unsigned long limit = sp + CONFIG_THREAD_STACK_SIZE;
+	struct stack_frame *frame = (struct stack_frame *)regs->rbp;
+
+	__save_stack_address(trace, regs->rip, TRUE);
+
+	while ((trace->nr_entries < trace->max_entries) &&
+	       (sp < (unsigned long)frame) &&
+	       (((unsigned long)frame + sizeof(*frame)) <= limit)) {
+		if (!__x86_vmm_address(frame->return_address))
+			break;
+		__save_stack_address(trace, frame->return_address, TRUE);
+		sp = (unsigned long)frame;
+		frame = frame->next_frame;
+	}
+
 	if (trace->nr_entries < trace->max_entries)
 		trace->entries[trace->nr_entries++] = 0UL;
 }
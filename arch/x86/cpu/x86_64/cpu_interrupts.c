@@ -34,6 +34,7 @@
 #include <stacktrace.h>
 #include <arch_guest_helper.h>
 #include <cpu_extables.h>
+#include <arch_profiler.h>
 
 #undef __DEBUG
 //#define __DEBUG
@@ -314,3 +315,15 @@ int do_generic_int_handler(int intno, arch_regs_t *regs)
 
 	return 0;
 }
+
+unsigned long arch_profiler_regs_pc(arch_regs_t *regs, bool *guest_mode)
+{
+	/* Guest execution always traps to us via VM exits so
+	 * interrupted register state is always hypervisor state.
+	 */
+	if (guest_mode) {
+		*guest_mode = FALSE;
+	}
+
+	return regs->rip;
+}
@@ -28,7 +28,10 @@
 #include <vmm_cmdmgr.h>
 #include <vmm_heap.h>
 #include <block/vmm_blockdev.h>
+#include <block/vmm_blockrq.h>
+#include <block/vmm_blockcache.h>
 #include <libs/stringlib.h>
+#include <libs/mathlib.h>
 
 #define MODULE_DESC			"Command blockdev"
 #define MODULE_AUTHOR			"Anup Patel"
@@ -42,13 +45,29 @@ static void cmd_blockdev_usage(struct vmm_chardev *cdev)
 	vmm_cprintf(cdev, "Usage:\n");
 	vmm_cprintf(cdev, "   blockdev help\n");
 	vmm_cprintf(cdev, "   blockdev list\n");
+	vmm_cprintf(cdev, "   blockdev iostat\n");
 	vmm_cprintf(cdev, "   blockdev info <name>\n");
 	vmm_cprintf(cdev, "   blockdev dump8 <name> [length] [offset]\n");
+	vmm_cprintf(cdev, "   blockdev stats <name>\n");
+	vmm_cprintf(cdev, "   blockdev iosched <name> [noop|deadline] "
+			  "[max_merge_bytes]\n");
+}
+
+static struct vmm_blockrq *cmd_blockdev_brq(struct vmm_blockdev *bdev)
+{
+	if (!vmm_blockrq_is_rq(bdev->rq)) {
+		return NULL;
+	}
+
+	return vmm_blockrq_from_rq(bdev->rq);
 }
 
 static int cmd_blockdev_info(struct vmm_chardev *cdev,
 			     struct vmm_blockdev *bdev)
 {
+	struct vmm_blockcache_stats cstats;
+	struct vmm_blockrq *brq = cmd_blockdev_brq(bdev);
+
 	vmm_cprintf(cdev, "Name       : %s\n", bdev->name);
 	vmm_cprintf(cdev, "Parent     : %s\n",
 				(bdev->parent) ? bdev->parent->name : "---");
@@ -58,10 +77,121 @@ static int cmd_blockdev_info(struct vmm_chardev *cdev,
 	vmm_cprintf(cdev, "Start LBA  : %"PRIu64"\n", bdev->start_lba);
 	vmm_cprintf(cdev, "Block Size : %"PRIu32"\n", bdev->block_size);
 	vmm_cprintf(cdev, "Block Count: %"PRIu64"\n", bdev->num_blocks);
+	if (brq) {
+		vmm_cprintf(cdev, "IO Sched   : %s\n",
+			    vmm_blockrq_sched_name(brq->sched));
+		vmm_cprintf(cdev, "Max Merge  : %"PRIu32" bytes\n",
+			    brq->max_merge_bytes);
+	}
+	if (!vmm_blockcache_get_stats(bdev, &cstats)) {
+		vmm_cprintf(cdev, "Cache      : %"PRIu32" x %"PRIu32" bytes "
+			    "(%"PRIu32" dirty, %"PRIu32" users)\n",
+			    cstats.buf_count, cstats.buf_size,
+			    cstats.dirty_count, cstats.users);
+		vmm_cprintf(cdev, "Cache Hits : %"PRIu64" (%"PRIu64" misses, "
+			    "%"PRIu64" bypass)\n",
+			    cstats.hits, cstats.misses, cstats.bypass);
+		vmm_cprintf(cdev, "Cache Evict: %"PRIu64" (%"PRIu64" "
+			    "writebacks)\n",
+			    cstats.evictions, cstats.writebacks);
+	}
+
+	return VMM_OK;
+}
+
+static int cmd_blockdev_stats(struct vmm_chardev *cdev,
+			      struct vmm_blockdev *bdev)
+{
+	int rc;
+	struct vmm_blockrq_stats stats;
+	struct vmm_blockdev_stats iostats;
+	struct vmm_blockrq *brq = cmd_blockdev_brq(bdev);
+
+	rc = vmm_blockdev_get_stats(bdev, &iostats);
+	if (rc) {
+		vmm_cprintf(cdev, "Error: failed to get io stats "
+			    "(error %d)\n", rc);
+		return rc;
+	}
+	vmm_blockdev_stats_print(cdev, &iostats);
+
+	if (!brq) {
+		return VMM_OK;
+	}
+
+	rc = vmm_blockrq_get_stats(brq, &stats);
+	if (rc) {
+		vmm_cprintf(cdev, "Error: failed to get stats (error %d)\n",
+			    rc);
+		return rc;
+	}
+
+	vmm_cprintf(cdev, "\nQueue       : %s\n", brq->name);
+	vmm_cprintf(cdev, "IO Sched    : %s\n",
+		    vmm_blockrq_sched_name(brq->sched));
+	vmm_cprintf(cdev, "Max Merge   : %"PRIu32" bytes\n",
+		    brq->max_merge_bytes);
+	vmm_cprintf(cdev, "Requests    : %"PRIu64"\n", stats.requests);
+	vmm_cprintf(cdev, "Dispatches  : %"PRIu64"\n", stats.dispatches);
+	vmm_cprintf(cdev, "Merges      : %"PRIu64"\n", stats.merges);
+	vmm_cprintf(cdev, "Expired     : %"PRIu64"\n", stats.expired);
+	vmm_cprintf(cdev, "Aborts      : %"PRIu64"\n", stats.aborts);
+	vmm_cprintf(cdev, "Completed   : %"PRIu64"\n", stats.completed);
+	vmm_cprintf(cdev, "Avg Latency : %"PRIu64" usecs\n",
+		    (stats.completed) ?
+		    udiv64(udiv64(stats.total_latency_ns, stats.completed),
+			   1000) : 0);
+	vmm_cprintf(cdev, "Max Latency : %"PRIu64" usecs\n",
+		    udiv64(stats.max_latency_ns, 1000));
 
 	return VMM_OK;
 }
 
+static int cmd_blockdev_iosched(struct vmm_chardev *cdev,
+				struct vmm_blockdev *bdev,
+				int argc, char *argv[])
+{
+	int rc;
+	u32 max_merge_bytes;
+	enum vmm_blockrq_sched sched;
+	struct vmm_blockrq *brq = cmd_blockdev_brq(bdev);
+
+	if (!brq) {
+		vmm_cprintf(cdev, "Error: %s does not use generic "
+			    "request queue\n", bdev->name);
+		return VMM_ENOTSUPP;
+	}
+
+	if (argc < 1) {
+		vmm_cprintf(cdev, "%s (max merge %"PRIu32" bytes)\n",
+			    vmm_blockrq_sched_name(brq->sched),
+			    brq->max_merge_bytes);
+		return VMM_OK;
+	}
+
+	for (sched = 0; sched < VMM_BLOCKRQ_SCHED_MAX; sched++) {
+		if (!strcmp(argv[0], vmm_blockrq_sched_name(sched))) {
+			break;
+		}
+	}
+	if (sched == VMM_BLOCKRQ_SCHED_MAX) {
+		vmm_cprintf(cdev, "Error: unknown io scheduler %s\n",
+			    argv[0]);
+		return VMM_EINVALID;
+	}
+
+	max_merge_bytes = (argc >= 2) ?
+		strtoul(argv[1], NULL, 10) : brq->max_merge_bytes;
+
+	rc = vmm_blockrq_set_sched(brq, sched, max_merge_bytes);
+	if (rc) {
+		vmm_cprintf(cdev, "Error: failed to set io scheduler "
+			    "(error %d)\n", rc);
+	}
+
+	return rc;
+}
+
 static int cmd_blockdev_list_iter(struct vmm_blockdev *bdev, void *data)
 {
 	struct vmm_chardev *cdev = data;
@@ -86,6 +216,46 @@ static void cmd_blockdev_list(struct vmm_chardev *cdev)
 			  "----------------------------------------\n");
 }
 
+static int cmd_blockdev_iostat_iter(struct vmm_blockdev *bdev, void *data)
+{
+	u64 svc_nsecs, ops;
+	struct vmm_blockdev_stats st;
+	struct vmm_chardev *cdev = data;
+
+	if (vmm_blockdev_get_stats(bdev, &st)) {
+		return VMM_OK;
+	}
+
+	ops = st.ops[VMM_BLOCKDEV_STATS_READ] +
+	      st.ops[VMM_BLOCKDEV_STATS_WRITE];
+	svc_nsecs = st.service_nsecs[VMM_BLOCKDEV_STATS_READ] +
+		    st.service_nsecs[VMM_BLOCKDEV_STATS_WRITE];
+	vmm_cprintf(cdev, " %-14s %-7"PRIu64" %-10"PRIu64" %-10"PRIu64" "
+		    "%-10"PRIu64" %-10"PRIu64" %-10"PRIu64"\n",
+		    bdev->name, vmm_blockdev_stats_in_flight(&st),
+		    st.ops[VMM_BLOCKDEV_STATS_READ],
+		    st.bytes[VMM_BLOCKDEV_STATS_READ] >> 10,
+		    st.ops[VMM_BLOCKDEV_STATS_WRITE],
+		    st.bytes[VMM_BLOCKDEV_STATS_WRITE] >> 10,
+		    (ops) ? udiv64(udiv64(svc_nsecs, ops), 1000) : 0);
+
+	return VMM_OK;
+}
+
+static void cmd_blockdev_iostat(struct vmm_chardev *cdev)
+{
+	vmm_cprintf(cdev, "----------------------------------------"
+			  "----------------------------------------\n");
+	vmm_cprintf(cdev, " %-14s %-7s %-10s %-10s %-10s %-10s %-10s\n",
+			  "Name", "InFlt", "Rd Ops", "Rd KB",
+			  "Wr Ops", "Wr KB", "Avg Svc us");
+	vmm_cprintf(cdev, "----------------------------------------"
+			  "----------------------------------------\n");
+	vmm_blockdev_iterate(NULL, cdev, cmd_blockdev_iostat_iter);
+	vmm_cprintf(cdev, "----------------------------------------"
+			  "----------------------------------------\n");
+}
+
 static int cmd_blockdev_dump8(struct vmm_chardev *cdev,
 			      struct vmm_blockdev *bdev,
 			      int argc, char *argv[])
@@ -152,6 +322,9 @@ static int cmd_blockdev_exec(struct vmm_chardev *cdev, int argc, char **argv)
 		} else if (strcmp(argv[1], "list") == 0) {
 			cmd_blockdev_list(cdev);
 			return VMM_OK;
+		} else if (strcmp(argv[1], "iostat") == 0) {
+			cmd_blockdev_iostat(cdev);
+			return VMM_OK;
 		}
 	} else if (argc >= 3) {
 		bdev = vmm_blockdev_find(argv[2]);
@@ -167,6 +340,11 @@ static int cmd_blockdev_exec(struct vmm_chardev *cdev, int argc, char **argv)
 		} else if (strcmp(argv[1], "dump8") == 0) {
 			return cmd_blockdev_dump8(cdev, bdev,
 						 argc - 3, argv + 3);
+		} else if (strcmp(argv[1], "stats") == 0) {
+			return cmd_blockdev_stats(cdev, bdev);
+		} else if (strcmp(argv[1], "iosched") == 0) {
+			return cmd_blockdev_iosched(cdev, bdev,
+						    argc - 3, argv + 3);
 		}
 	}
 	cmd_blockdev_usage(cdev);
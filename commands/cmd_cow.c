@@ -0,0 +1,233 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file cmd_cow.c
+ * @author agent (agent@local)
+ * @brief Implementation of cow command
+ */
+
+#include <vmm_error.h>
+#include <vmm_stdio.h>
+#include <vmm_modules.h>
+#include <vmm_cmdmgr.h>
+#include <libs/stringlib.h>
+#include <drv/cow.h>
+
+#define MODULE_DESC			"Command cow"
+#define MODULE_AUTHOR			"agent"
+#define MODULE_LICENSE			"GPL"
+#define MODULE_IPRIORITY		0
+#define	MODULE_INIT			cmd_cow_init
+#define	MODULE_EXIT			cmd_cow_exit
+
+static void cmd_cow_usage(struct vmm_chardev *cdev)
+{
+	vmm_cprintf(cdev, "Usage:\n");
+	vmm_cprintf(cdev, "   cow help\n");
+	vmm_cprintf(cdev, "   cow list\n");
+	vmm_cprintf(cdev, "   cow format <overlay_bdev> <base_bdev> "
+			  "[<cluster_size>]\n");
+	vmm_cprintf(cdev, "   cow create <name> <base_bdev> "
+			  "<overlay_bdev>\n");
+	vmm_cprintf(cdev, "   cow destroy <name>\n");
+	vmm_cprintf(cdev, "Note:\n");
+	vmm_cprintf(cdev, "   <cluster_size> is power of 2 between "
+			  "%d and %d bytes (default %d)\n",
+			  1 << COW_MIN_CLUSTER_BITS,
+			  1 << COW_MAX_CLUSTER_BITS,
+			  1 << COW_DEFAULT_CLUSTER_BITS);
+}
+
+static int cmd_cow_list(struct vmm_chardev *cdev)
+{
+	int num, count;
+	char used[32];
+	struct cow *c;
+
+	vmm_cprintf(cdev, "----------------------------------------"
+			  "----------------------------------------\n");
+	vmm_cprintf(cdev, " %-16s %-16s %-16s %-10s %-16s\n",
+			  "Name", "Base", "Overlay", "Cluster", "Overlay Used");
+	vmm_cprintf(cdev, "----------------------------------------"
+			  "----------------------------------------\n");
+	count = cow_count();
+	for (num = 0; num < count; num++) {
+		c = cow_get(num);
+		if (!c) {
+			break;
+		}
+		vmm_snprintf(used, sizeof(used), "0x%"PRIx64,
+			     c->hdr.next_free);
+		vmm_cprintf(cdev, " %-16s %-16s %-16s %-10d %-16s\n",
+			    c->bdev->name, c->base->name, c->overlay->name,
+			    c->cluster_size, used);
+	}
+	vmm_cprintf(cdev, "----------------------------------------"
+			  "----------------------------------------\n");
+
+	return VMM_OK;
+}
+
+static int cmd_cow_format(struct vmm_chardev *cdev,
+			  const char *overlay_name, const char *base_name,
+			  u32 cluster_size)
+{
+	int rc;
+	u32 cluster_bits = 0;
+	struct vmm_blockdev *overlay, *base;
+
+	overlay = vmm_blockdev_find(overlay_name);
+	if (!overlay) {
+		vmm_cprintf(cdev, "Failed to find block device %s\n",
+			    overlay_name);
+		return VMM_ENOTAVAIL;
+	}
+
+	base = vmm_blockdev_find(base_name);
+	if (!base) {
+		vmm_cprintf(cdev, "Failed to find block device %s\n",
+			    base_name);
+		return VMM_ENOTAVAIL;
+	}
+
+	while ((cluster_bits < 31) && ((1U << cluster_bits) < cluster_size)) {
+		cluster_bits++;
+	}
+	if ((1U << cluster_bits) != cluster_size) {
+		vmm_cprintf(cdev, "Cluster size %d not power of 2\n",
+			    cluster_size);
+		return VMM_EINVALID;
+	}
+
+	rc = cow_format(overlay, base, cluster_bits);
+	if (rc) {
+		vmm_cprintf(cdev, "Failed to format %s (error %d)\n",
+			    overlay_name, rc);
+		return rc;
+	}
+
+	vmm_cprintf(cdev, "Formatted %s as overlay of %s\n",
+		    overlay_name, base_name);
+
+	return VMM_OK;
+}
+
+static int cmd_cow_create(struct vmm_chardev *cdev, const char *name,
+			  const char *base_name, const char *overlay_name)
+{
+	struct cow *c;
+	struct vmm_blockdev *overlay, *base;
+
+	if (cow_find(name)) {
+		vmm_cprintf(cdev, "COW instance %s already exist\n", name);
+		return VMM_EEXIST;
+	}
+
+	base = vmm_blockdev_find(base_name);
+	if (!base) {
+		vmm_cprintf(cdev, "Failed to find block device %s\n",
+			    base_name);
+		return VMM_ENOTAVAIL;
+	}
+
+	overlay = vmm_blockdev_find(overlay_name);
+	if (!overlay) {
+		vmm_cprintf(cdev, "Failed to find block device %s\n",
+			    overlay_name);
+		return VMM_ENOTAVAIL;
+	}
+
+	c = cow_create(name, base, overlay);
+	if (!c) {
+		vmm_cprintf(cdev, "Failed to create %s COW instance\n", name);
+		return VMM_EFAIL;
+	}
+
+	vmm_cprintf(cdev, "Created %s COW instance\n", name);
+
+	return VMM_OK;
+}
+
+static int cmd_cow_destroy(struct vmm_chardev *cdev, const char *name)
+{
+	struct cow *c = cow_find(name);
+
+	if (!c) {
+		vmm_cprintf(cdev, "Failed to find %s COW instance\n", name);
+		return VMM_ENOTAVAIL;
+	}
+
+	cow_destroy(c);
+
+	vmm_cprintf(cdev, "Destroyed %s COW instance\n", name);
+
+	return VMM_OK;
+}
+
+static int cmd_cow_exec(struct vmm_chardev *cdev, int argc, char **argv)
+{
+	u32 cluster_size;
+
+	if (argc <= 1) {
+		goto fail;
+	}
+
+	if (strcmp(argv[1], "help") == 0) {
+		cmd_cow_usage(cdev);
+		return VMM_OK;
+	} else if ((strcmp(argv[1], "list") == 0) && (argc == 2)) {
+		return cmd_cow_list(cdev);
+	} else if ((strcmp(argv[1], "format") == 0) &&
+		   ((argc == 4) || (argc == 5))) {
+		cluster_size = (argc == 5) ? strtoul(argv[4], NULL, 0) :
+					     (1 << COW_DEFAULT_CLUSTER_BITS);
+		return cmd_cow_format(cdev, argv[2], argv[3], cluster_size);
+	} else if ((strcmp(argv[1], "create") == 0) && (argc == 5)) {
+		return cmd_cow_create(cdev, argv[2], argv[3], argv[4]);
+	} else if ((strcmp(argv[1], "destroy") == 0) && (argc == 3)) {
+		return cmd_cow_destroy(cdev, argv[2]);
+	}
+
+fail:
+	cmd_cow_usage(cdev);
+	return VMM_EFAIL;
+}
+
+static struct vmm_cmd cmd_cow = {
+	.name = "cow",
+	.desc = "copy-on-write block device commands",
+	.usage = cmd_cow_usage,
+	.exec = cmd_cow_exec,
+};
+
+static int __init cmd_cow_init(void)
+{
+	return vmm_cmdmgr_register_cmd(&cmd_cow);
+}
+
+static void __exit cmd_cow_exit(void)
+{
+	vmm_cmdmgr_unregister_cmd(&cmd_cow);
+}
+
+VMM_DECLARE_MODULE(MODULE_DESC,
+			MODULE_AUTHOR,
+			MODULE_LICENSE,
+			MODULE_IPRIORITY,
+			MODULE_INIT,
+			MODULE_EXIT);
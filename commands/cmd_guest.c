@@ -27,10 +27,13 @@
 #include <vmm_manager.h>
 #include <vmm_host_aspace.h>
 #include <vmm_guest_aspace.h>
+#include <vmm_guest_dedup.h>
 #include <vmm_modules.h>
 #include <vmm_cmdmgr.h>
 #include <vmm_devemu.h>
 #include <libs/stringlib.h>
+#include <libs/mathlib.h>
+#include <libs/guest_snapshot.h>
 
 #define MODULE_DESC			"Command guest"
 #define MODULE_AUTHOR			"Anup Patel"
@@ -55,6 +58,14 @@ static void cmd_guest_usage(struct vmm_chardev *cdev)
 			  "[mem_sz]\n");
 	vmm_cprintf(cdev, "   guest region_list <guest_name>\n");
 	vmm_cprintf(cdev, "   guest region  <guest_name> <gphys_addr>\n");
+	vmm_cprintf(cdev, "   guest memstat <guest_name>\n");
+	vmm_cprintf(cdev, "   guest balloon <guest_name> <target_bytes>\n");
+	vmm_cprintf(cdev, "   guest dedup   <guest_name>\n");
+	vmm_cprintf(cdev, "   guest dedup_rate <pages_to_scan> "
+			  "<sleep_msecs>\n");
+	vmm_cprintf(cdev, "   guest dirtylog <guest_name> start|stop|stat\n");
+	vmm_cprintf(cdev, "   guest snapshot <guest_name> <file_path>\n");
+	vmm_cprintf(cdev, "   guest restore  <guest_name> <file_path>\n");
 	vmm_cprintf(cdev, "Note:\n");
 	vmm_cprintf(cdev, "   <guest_name> = node name under /guests "
 			  "device tree node\n");
@@ -377,6 +388,217 @@ static int cmd_guest_region(struct vmm_chardev *cdev, const char *name,
 	return VMM_OK;
 }
 
+static const char *const balloon_stat_names[] = {
+	"swap_in",
+	"swap_out",
+	"major_faults",
+	"minor_faults",
+	"free_memory",
+	"total_memory",
+	"avail_memory",
+	"disk_caches",
+};
+
+static int cmd_guest_memstat(struct vmm_chardev *cdev, const char *name)
+{
+	u32 i;
+	char str[16];
+	struct vmm_guest *guest = vmm_manager_guest_find(name);
+
+	if (!guest) {
+		vmm_cprintf(cdev, "Failed to find guest\n");
+		return VMM_ENOTAVAIL;
+	}
+
+	str[0] = '\0';
+	u64_to_size_str(vmm_guest_ondemand_resident(guest), str, sizeof(str));
+	vmm_cprintf(cdev, "On-demand RAM resident       : %s\n", str);
+
+	if (vmm_guest_ondemand_limit(guest)) {
+		str[0] = '\0';
+		u64_to_size_str(vmm_guest_ondemand_limit(guest),
+				str, sizeof(str));
+		vmm_cprintf(cdev, "On-demand RAM limit          : %s\n", str);
+	} else {
+		vmm_cprintf(cdev, "On-demand RAM limit          : none\n");
+	}
+
+	str[0] = '\0';
+	u64_to_size_str(vmm_guest_balloon_target(guest), str, sizeof(str));
+	vmm_cprintf(cdev, "Balloon target               : %s\n", str);
+
+	str[0] = '\0';
+	u64_to_size_str(vmm_guest_balloon_size(guest), str, sizeof(str));
+	vmm_cprintf(cdev, "Balloon size                 : %s\n", str);
+
+	for (i = 0; i < VMM_GUEST_BALLOON_STAT_MAX; i++) {
+		vmm_cprintf(cdev, "Balloon stat %-16s: %"PRIu64"\n",
+			    balloon_stat_names[i],
+			    vmm_guest_balloon_stat(guest, i));
+	}
+
+	return VMM_OK;
+}
+
+static int cmd_guest_balloon(struct vmm_chardev *cdev, const char *name,
+			     physical_size_t target)
+{
+	int ret;
+	struct vmm_guest *guest = vmm_manager_guest_find(name);
+
+	if (!guest) {
+		vmm_cprintf(cdev, "Failed to find guest\n");
+		return VMM_ENOTAVAIL;
+	}
+
+	if ((ret = vmm_guest_balloon_set_target(guest, target))) {
+		vmm_cprintf(cdev, "%s: Failed to set balloon target\n", name);
+	}
+
+	return ret;
+}
+
+static int cmd_guest_dedup(struct vmm_chardev *cdev, const char *name)
+{
+	int ret;
+	struct vmm_guest_dedup_stats stats;
+	struct vmm_guest *guest = vmm_manager_guest_find(name);
+
+	if (!guest) {
+		vmm_cprintf(cdev, "Failed to find guest\n");
+		return VMM_ENOTAVAIL;
+	}
+
+	vmm_cprintf(cdev, "Scan rate                    : %u pages every "
+		    "%u msecs\n", vmm_guest_dedup_pages_to_scan(),
+		    vmm_guest_dedup_sleep_msecs());
+	vmm_cprintf(cdev, "Shared host frames           : %u\n",
+		    vmm_guest_dedup_frame_count());
+	vmm_cprintf(cdev, "Full scans (all guests)      : %"PRIu64"\n",
+		    vmm_guest_dedup_full_scans());
+
+	if ((ret = vmm_guest_dedup_get_stats(guest, &stats))) {
+		vmm_cprintf(cdev, "%s: Page deduplication not enabled\n",
+			    name);
+		return ret;
+	}
+
+	vmm_cprintf(cdev, "Pages scanned                : %"PRIu64"\n",
+		    stats.pages_scanned);
+	vmm_cprintf(cdev, "Pages merged                 : %"PRIu64"\n",
+		    stats.pages_merged);
+	vmm_cprintf(cdev, "Pages shared                 : %u\n",
+		    stats.pages_shared);
+	vmm_cprintf(cdev, "Pages pending                : %u\n",
+		    stats.pages_pending);
+	vmm_cprintf(cdev, "Pages private                : %u\n",
+		    stats.pages_private);
+	vmm_cprintf(cdev, "Pages pinned                 : %u\n",
+		    stats.pages_pinned);
+	vmm_cprintf(cdev, "Copy-on-write breaks         : %"PRIu64"\n",
+		    stats.cow_breaks);
+	vmm_cprintf(cdev, "Full scans                   : %"PRIu64"\n",
+		    stats.full_scans);
+
+	return VMM_OK;
+}
+
+static int cmd_guest_dedup_rate(struct vmm_chardev *cdev,
+				u32 pages_to_scan, u32 sleep_msecs)
+{
+	int ret;
+
+	if ((ret = vmm_guest_dedup_set_rate(pages_to_scan, sleep_msecs))) {
+		vmm_cprintf(cdev, "Failed to set page deduplication rate\n");
+	}
+
+	return ret;
+}
+
+static int cmd_guest_dirtylog(struct vmm_chardev *cdev, const char *name,
+			      const char *op)
+{
+	int ret = VMM_OK;
+	u64 faults = 0, nsecs = 0;
+	struct vmm_guest *guest = vmm_manager_guest_find(name);
+
+	if (!guest) {
+		vmm_cprintf(cdev, "Failed to find guest\n");
+		return VMM_ENOTAVAIL;
+	}
+
+	if (strcmp(op, "start") == 0) {
+		if ((ret = vmm_guest_dirty_log_start(guest))) {
+			vmm_cprintf(cdev, "%s: Failed to start dirty page "
+				    "logging (error %d)\n", name, ret);
+		}
+		return ret;
+	} else if (strcmp(op, "stop") == 0) {
+		if ((ret = vmm_guest_dirty_log_stop(guest))) {
+			vmm_cprintf(cdev, "%s: Failed to stop dirty page "
+				    "logging (error %d)\n", name, ret);
+		}
+		return ret;
+	} else if (strcmp(op, "stat") != 0) {
+		cmd_guest_usage(cdev);
+		return VMM_EINVALID;
+	}
+
+	vmm_guest_dirty_log_fault_stats(guest, &faults, &nsecs);
+
+	vmm_cprintf(cdev, "Dirty page logging           : %s\n",
+		    (vmm_guest_dirty_log_enabled(guest)) ?
+		    "enabled" : "disabled");
+	vmm_cprintf(cdev, "Dirty pages                  : %u\n",
+		    vmm_guest_dirty_log_count(guest));
+	vmm_cprintf(cdev, "Write faults                 : %"PRIu64"\n",
+		    faults);
+	vmm_cprintf(cdev, "Average write fault cost     : %"PRIu64" ns\n",
+		    (faults) ? udiv64(nsecs, faults) : 0);
+
+	return VMM_OK;
+}
+
+static int cmd_guest_snapshot(struct vmm_chardev *cdev, const char *name,
+			      const char *path, bool restore)
+{
+	int ret;
+	struct guest_snapshot_stats stats;
+	struct vmm_guest *guest = vmm_manager_guest_find(name);
+
+	if (!guest) {
+		vmm_cprintf(cdev, "Failed to find guest\n");
+		return VMM_ENOTAVAIL;
+	}
+
+	if (restore) {
+		ret = guest_snapshot_restore(guest, path, &stats);
+	} else {
+		ret = guest_snapshot_save(guest, path, &stats);
+	}
+	if (ret) {
+		vmm_cprintf(cdev, "%s: Failed to %s %s (error %d)\n",
+			    name, (restore) ? "restore" : "snapshot",
+			    path, ret);
+		return ret;
+	}
+
+	vmm_cprintf(cdev, "RAM data                     : %"PRIu64" bytes\n",
+		    stats.ram_bytes);
+	vmm_cprintf(cdev, "RAM zero (skipped)           : %"PRIu64" bytes\n",
+		    stats.zero_bytes);
+	vmm_cprintf(cdev, "File size                    : %"PRIu64" bytes\n",
+		    stats.file_bytes);
+	vmm_cprintf(cdev, "VCPU states                  : %u\n",
+		    stats.vcpu_count);
+	vmm_cprintf(cdev, "Emulator states              : %u (%u skipped)\n",
+		    stats.devemu_count, stats.devemu_skipped);
+	vmm_cprintf(cdev, "Time taken                   : %"PRIu64" us\n",
+		    udiv64(stats.nsecs, 1000));
+
+	return VMM_OK;
+}
+
 static int cmd_guest_param(struct vmm_chardev *cdev, int argc, char **argv,
 			   physical_addr_t *src_addr, u32 *size)
 {
@@ -441,6 +663,23 @@ static int cmd_guest_exec(struct vmm_chardev *cdev, int argc, char **argv)
 			return ret;
 		}
 		return cmd_guest_region(cdev, argv[2], src_addr);
+	} else if (strcmp(argv[1], "memstat") == 0) {
+		return cmd_guest_memstat(cdev, argv[2]);
+	} else if ((strcmp(argv[1], "balloon") == 0) && (argc > 3)) {
+		return cmd_guest_balloon(cdev, argv[2],
+				(physical_size_t)strtoull(argv[3], NULL, 0));
+	} else if (strcmp(argv[1], "dedup") == 0) {
+		return cmd_guest_dedup(cdev, argv[2]);
+	} else if ((strcmp(argv[1], "dedup_rate") == 0) && (argc > 3)) {
+		return cmd_guest_dedup_rate(cdev,
+				(u32)strtoul(argv[2], NULL, 0),
+				(u32)strtoul(argv[3], NULL, 0));
+	} else if ((strcmp(argv[1], "dirtylog") == 0) && (argc > 3)) {
+		return cmd_guest_dirtylog(cdev, argv[2], argv[3]);
+	} else if ((strcmp(argv[1], "snapshot") == 0) && (argc > 3)) {
+		return cmd_guest_snapshot(cdev, argv[2], argv[3], FALSE);
+	} else if ((strcmp(argv[1], "restore") == 0) && (argc > 3)) {
+		return cmd_guest_snapshot(cdev, argv[2], argv[3], TRUE);
 	} else {
 		cmd_guest_usage(cdev);
 		return VMM_EFAIL;
@@ -44,6 +44,7 @@ static void cmd_heap_usage(struct vmm_chardev *cdev)
 	vmm_cprintf(cdev, "   heap help\n");
 	vmm_cprintf(cdev, "   heap info\n");
 	vmm_cprintf(cdev, "   heap state\n");
+	vmm_cprintf(cdev, "   heap slab\n");
 	vmm_cprintf(cdev, "   heap dma_info\n");
 	vmm_cprintf(cdev, "   heap dma_state\n");
 }
@@ -112,6 +113,44 @@ static int cmd_heap_state(struct vmm_chardev *cdev)
 	return vmm_normal_heap_print_state(cdev);
 }
 
+static int cmd_heap_slab(struct vmm_chardev *cdev)
+{
+	u32 i, count;
+	u64 allocs, hit_pct;
+	struct vmm_kmem_cache *cache;
+	struct vmm_kmem_cache_stats st;
+
+	count = vmm_kmem_cache_count();
+	if (!count) {
+		vmm_cprintf(cdev, "Slab allocator not available\n");
+		return VMM_ENOTAVAIL;
+	}
+
+	vmm_cprintf(cdev, "----------------------------------------"
+			  "----------------------------------------\n");
+	vmm_cprintf(cdev, " %-16s %6s %6s %6s %8s %8s %8s %6s\n",
+		    "Name", "ObjSz", "PerSlb", "Slabs", "Total",
+		    "Free", "Cached", "Hit%");
+	vmm_cprintf(cdev, "----------------------------------------"
+			  "----------------------------------------\n");
+	for (i = 0; i < count; i++) {
+		cache = vmm_kmem_cache_get(i);
+		if (!cache || vmm_kmem_cache_stats(cache, &st)) {
+			continue;
+		}
+		allocs = st.alloc_hit + st.alloc_miss;
+		hit_pct = (allocs) ? udiv64(st.alloc_hit * 100, allocs) : 0;
+		vmm_cprintf(cdev, " %-16s %6d %6d %6d %8d %8d %8d %6"PRIu64"\n",
+			    vmm_kmem_cache_name(cache), st.obj_size,
+			    st.objs_per_slab, st.slab_count, st.obj_total,
+			    st.obj_free, st.obj_cached, hit_pct);
+	}
+	vmm_cprintf(cdev, "----------------------------------------"
+			  "----------------------------------------\n");
+
+	return VMM_OK;
+}
+
 static int cmd_heap_dma_info(struct vmm_chardev *cdev)
 {
 	return heap_info(cdev, FALSE,
@@ -136,6 +175,8 @@ static int cmd_heap_exec(struct vmm_chardev *cdev, int argc, char **argv)
 			return cmd_heap_info(cdev);
 		} else if (strcmp(argv[1], "state") == 0) {
 			return cmd_heap_state(cdev);
+		} else if (strcmp(argv[1], "slab") == 0) {
+			return cmd_heap_slab(cdev);
 		} else if (strcmp(argv[1], "dma_info") == 0) {
 			return cmd_heap_dma_info(cdev);
 		} else if (strcmp(argv[1], "dma_state") == 0) {
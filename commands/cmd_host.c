@@ -60,6 +60,7 @@ static void cmd_host_usage(struct vmm_chardev *cdev)
 	vmm_cprintf(cdev, "   host irq set_affinity <hirq> <hcpu>\n");
 	vmm_cprintf(cdev, "   host extirq stats\n");
 	vmm_cprintf(cdev, "   host ram info\n");
+	vmm_cprintf(cdev, "   host ram numa\n");
 	vmm_cprintf(cdev, "   host ram bitmap [<column count>]\n");
 	vmm_cprintf(cdev, "   host ram reserve <physaddr> <size>\n");
 	vmm_cprintf(cdev, "   host vapool info\n");
@@ -291,9 +292,51 @@ static void cmd_host_ram_info(struct vmm_chardev *cdev)
 					bn, free, free);
 		vmm_cprintf(cdev, "Bank%02d Frame Count: %d (0x%08x)\n",
 					bn, count, count);
+		vmm_cprintf(cdev, "Bank%02d NUMA Node  : %d\n",
+					bn, vmm_host_ram_bank_node(bn));
 	}
 }
 
+static void cmd_host_ram_numa(struct vmm_chardev *cdev)
+{
+	int c;
+	u64 local, remote;
+	u32 n, bn, banks, free, count;
+	u32 node_count = vmm_host_ram_node_count();
+	u32 bank_count = vmm_host_ram_bank_count();
+
+	vmm_cprintf(cdev, "----------------------------------------"
+			  "----------------------------------------\n");
+	vmm_cprintf(cdev, " %-4s %-6s %-12s %-12s %-14s %-14s %s\n",
+		    "Node", "Banks", "Frames", "Free Frames",
+		    "Local Allocs", "Remote Allocs", "CPUs");
+	vmm_cprintf(cdev, "----------------------------------------"
+			  "----------------------------------------\n");
+	for (n = 0; n < node_count; n++) {
+		banks = free = count = 0;
+		for (bn = 0; bn < bank_count; bn++) {
+			if (vmm_host_ram_bank_node(bn) != n) {
+				continue;
+			}
+			banks++;
+			free += vmm_host_ram_bank_free_frames(bn);
+			count += vmm_host_ram_bank_frame_count(bn);
+		}
+		vmm_host_ram_node_stats(n, &local, &remote);
+		vmm_cprintf(cdev, " %-4d %-6d %-12d %-12d %-14"PRIu64
+			    " %-14"PRIu64" ", n, banks, count, free,
+			    local, remote);
+		for_each_online_cpu(c) {
+			if (vmm_host_ram_cpu_node(c) == n) {
+				vmm_cprintf(cdev, "%d ", c);
+			}
+		}
+		vmm_cprintf(cdev, "\n");
+	}
+	vmm_cprintf(cdev, "----------------------------------------"
+			  "----------------------------------------\n");
+}
+
 static int cmd_host_ram_reserve(struct vmm_chardev *cdev, physical_addr_t paddr, int size)
 {
 	return vmm_host_ram_reserve(paddr, size);
@@ -563,6 +606,9 @@ static int cmd_host_exec(struct vmm_chardev *cdev, int argc, char **argv)
 		if (strcmp(argv[2], "info") == 0) {
 			cmd_host_ram_info(cdev);
 			return VMM_OK;
+		} else if (strcmp(argv[2], "numa") == 0) {
+			cmd_host_ram_numa(cdev);
+			return VMM_OK;
 		} else if (strcmp(argv[2], "bitmap") == 0) {
 			if (3 < argc) {
 				colcnt = atoi(argv[3]);
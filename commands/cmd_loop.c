@@ -0,0 +1,161 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file cmd_loop.c
+ * @author agent (agent@local)
+ * @brief Implementation of loop command
+ */
+
+#include <vmm_error.h>
+#include <vmm_stdio.h>
+#include <vmm_modules.h>
+#include <vmm_cmdmgr.h>
+#include <libs/stringlib.h>
+#include <drv/loop.h>
+
+#define MODULE_DESC			"Command loop"
+#define MODULE_AUTHOR			"agent"
+#define MODULE_LICENSE			"GPL"
+#define MODULE_IPRIORITY		0
+#define	MODULE_INIT			cmd_loop_init
+#define	MODULE_EXIT			cmd_loop_exit
+
+static void cmd_loop_usage(struct vmm_chardev *cdev)
+{
+	vmm_cprintf(cdev, "Usage:\n");
+	vmm_cprintf(cdev, "   loop help\n");
+	vmm_cprintf(cdev, "   loop list\n");
+	vmm_cprintf(cdev, "   loop create <name> <path_to_file> [ro]\n");
+	vmm_cprintf(cdev, "   loop destroy <name>\n");
+}
+
+static int cmd_loop_list(struct vmm_chardev *cdev)
+{
+	int num, count;
+	char size[32];
+	struct loop *l;
+
+	vmm_cprintf(cdev, "----------------------------------------"
+			  "----------------------------------------\n");
+	vmm_cprintf(cdev, " %-16s %-18s %-6s %-36s\n",
+			  "Name", "Size", "Access", "File");
+	vmm_cprintf(cdev, "----------------------------------------"
+			  "----------------------------------------\n");
+	count = loop_count();
+	for (num = 0; num < count; num++) {
+		l = loop_get(num);
+		if (!l) {
+			break;
+		}
+		vmm_snprintf(size, sizeof(size), "0x%"PRIx64, l->size);
+		vmm_cprintf(cdev, " %-16s %-18s %-6s %-36s\n",
+			    l->bdev->name, size,
+			    (l->read_only) ? "RO" : "RW", l->path);
+	}
+	vmm_cprintf(cdev, "----------------------------------------"
+			  "----------------------------------------\n");
+
+	return VMM_OK;
+}
+
+static int cmd_loop_create(struct vmm_chardev *cdev, const char *name,
+			   const char *path, bool read_only)
+{
+	struct loop *l;
+
+	if (loop_find(name)) {
+		vmm_cprintf(cdev, "Loop instance %s already exist\n", name);
+		return VMM_EEXIST;
+	}
+
+	l = loop_create(name, path, read_only);
+	if (!l) {
+		vmm_cprintf(cdev, "Failed to create %s loop instance\n",
+			    name);
+		return VMM_EFAIL;
+	}
+
+	vmm_cprintf(cdev, "Created %s loop instance\n", name);
+
+	return VMM_OK;
+}
+
+static int cmd_loop_destroy(struct vmm_chardev *cdev, const char *name)
+{
+	struct loop *l = loop_find(name);
+
+	if (!l) {
+		vmm_cprintf(cdev, "Failed to find %s loop instance\n", name);
+		return VMM_ENOTAVAIL;
+	}
+
+	loop_destroy(l);
+
+	vmm_cprintf(cdev, "Destroyed %s loop instance\n", name);
+
+	return VMM_OK;
+}
+
+static int cmd_loop_exec(struct vmm_chardev *cdev, int argc, char **argv)
+{
+	if (argc <= 1) {
+		goto fail;
+	}
+
+	if (strcmp(argv[1], "help") == 0) {
+		cmd_loop_usage(cdev);
+		return VMM_OK;
+	} else if ((strcmp(argv[1], "list") == 0) && (argc == 2)) {
+		return cmd_loop_list(cdev);
+	} else if ((strcmp(argv[1], "create") == 0) && (argc == 4)) {
+		return cmd_loop_create(cdev, argv[2], argv[3], FALSE);
+	} else if ((strcmp(argv[1], "create") == 0) && (argc == 5) &&
+		   (strcmp(argv[4], "ro") == 0)) {
+		return cmd_loop_create(cdev, argv[2], argv[3], TRUE);
+	} else if ((strcmp(argv[1], "destroy") == 0) && (argc == 3)) {
+		return cmd_loop_destroy(cdev, argv[2]);
+	}
+
+fail:
+	cmd_loop_usage(cdev);
+	return VMM_EFAIL;
+}
+
+static struct vmm_cmd cmd_loop = {
+	.name = "loop",
+	.desc = "file backed block device commands",
+	.usage = cmd_loop_usage,
+	.exec = cmd_loop_exec,
+};
+
+static int __init cmd_loop_init(void)
+{
+	return vmm_cmdmgr_register_cmd(&cmd_loop);
+}
+
+static void __exit cmd_loop_exit(void)
+{
+	vmm_cmdmgr_unregister_cmd(&cmd_loop);
+}
+
+VMM_DECLARE_MODULE(MODULE_DESC,
+			MODULE_AUTHOR,
+			MODULE_LICENSE,
+			MODULE_IPRIORITY,
+			MODULE_INIT,
+			MODULE_EXIT);
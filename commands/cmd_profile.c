@@ -28,6 +28,7 @@
 #include <vmm_heap.h>
 #include <vmm_timer.h>
 #include <vmm_profiler.h>
+#include <vmm_cpumask.h>
 #include <arch_atomic.h>
 #include <arch_atomic64.h>
 #include <libs/stringlib.h>
@@ -42,17 +43,24 @@
 #define	MODULE_INIT			cmd_profile_init
 #define	MODULE_EXIT			cmd_profile_exit
 
-static bool cmd_profile_updated = FALSE;
-
 static void cmd_profile_usage(struct vmm_chardev *cdev)
 {
 	vmm_cprintf(cdev, "Usage: \n");
 	vmm_cprintf(cdev, "   profile help\n");
+#if defined(CONFIG_PROFILE)
 	vmm_cprintf(cdev, "   profile start\n");
 	vmm_cprintf(cdev, "   profile stop\n");
 	vmm_cprintf(cdev, "   profile status\n");
 	vmm_cprintf(cdev,
 		    "   profile dump [name|count|total_time|single_time]\n");
+#endif
+#if defined(CONFIG_PROFILE_SAMPLE)
+	vmm_cprintf(cdev, "   profile sample start [<period_usecs>] "
+			  "[<stack_depth>]\n");
+	vmm_cprintf(cdev, "   profile sample stop\n");
+	vmm_cprintf(cdev, "   profile sample status\n");
+	vmm_cprintf(cdev, "   profile sample dump [<max_lines>]\n");
+#endif
 }
 
 static int cmd_profile_help(struct vmm_chardev *cdev, char *dummy)
@@ -62,6 +70,10 @@ static int cmd_profile_help(struct vmm_chardev *cdev, char *dummy)
 	return VMM_OK;
 }
 
+#if defined(CONFIG_PROFILE)
+
+static bool cmd_profile_updated = FALSE;
+
 static int cmd_profile_status(struct vmm_chardev *cdev, char *dummy)
 {
 	if (vmm_profiler_isactive()) {
@@ -334,15 +346,242 @@ static int cmd_profile_stop(struct vmm_chardev *cdev, char *dummy)
 	return vmm_profiler_stop();
 }
 
+#endif
+
+#if defined(CONFIG_PROFILE_SAMPLE)
+
+static const char *const cmd_profile_sample_ctx_names[] = {
+	[VMM_PROFILE_SAMPLE_HYP] = "hypervisor",
+	[VMM_PROFILE_SAMPLE_GUEST_EXIT] = "guest-exit",
+	[VMM_PROFILE_SAMPLE_GUEST] = "guest",
+	[VMM_PROFILE_SAMPLE_IDLE] = "idle",
+};
+
+struct cmd_profile_sample_hit {
+	u32 index;
+	u32 self;
+	u32 incl;
+	u32 ctx[VMM_PROFILE_SAMPLE_MAX];
+};
+
+extern u8 _code_start;
+extern u8 _code_end;
+
+static bool cmd_profile_sample_symbol(unsigned long addr, u32 *pos)
+{
+	if ((addr < (unsigned long)&_code_start) ||
+	    ((unsigned long)&_code_end <= addr) ||
+	    (addr < kallsyms_addresses[0])) {
+		return FALSE;
+	}
+
+	*pos = kallsyms_get_symbol_pos(addr, NULL, NULL);
+
+	return TRUE;
+}
+
+static int cmd_profile_sample_self_cmp(void *m, size_t a, size_t b)
+{
+	struct cmd_profile_sample_hit *h = m;
+
+	if (h[a].self != h[b].self) {
+		return (h[a].self < h[b].self) ? 1 : 0;
+	}
+
+	return (h[a].incl < h[b].incl) ? 1 : 0;
+}
+
+static void cmd_profile_sample_swap(void *m, size_t a, size_t b)
+{
+	struct cmd_profile_sample_hit tmp;
+	struct cmd_profile_sample_hit *h = m;
+
+	tmp = h[a];
+	h[a] = h[b];
+	h[b] = tmp;
+}
+
+static void cmd_profile_sample_percent(u32 val, u32 total,
+				       u32 *ipart, u32 *fpart)
+{
+	u64 tmp = (total) ? udiv64((u64)val * 10000, total) : 0;
+
+	*ipart = (u32)udiv64(tmp, 100);
+	*fpart = (u32)(tmp - (u64)(*ipart) * 100);
+}
+
+static int cmd_profile_sample_dump(struct vmm_chardev *cdev, u32 max_lines)
+{
+	int rc = VMM_OK;
+	u32 c, i, j, k, pos, cnt, total = 0, unknown = 0, ip, fp;
+	u32 ctx_total[VMM_PROFILE_SAMPLE_MAX];
+	u32 seen[VMM_PROFILE_SAMPLE_DEPTH + 1], seen_count;
+	struct vmm_profiler_sample *s;
+	struct cmd_profile_sample_hit *hits, *h;
+	char name[KSYM_NAME_LEN];
+
+	if (vmm_profiler_sample_isactive()) {
+		vmm_cprintf(cdev, "Can't dump while sampling is active\n");
+		return VMM_EFAIL;
+	}
+
+	hits = vmm_zalloc(sizeof(*hits) * kallsyms_num_syms);
+	if (!hits) {
+		return VMM_ENOMEM;
+	}
+	memset(ctx_total, 0, sizeof(ctx_total));
+
+	/* Aggregate samples of all host CPUs by symbol */
+	for_each_cpu(c, cpu_online_mask) {
+		cnt = vmm_profiler_sample_count(c);
+		for (i = 0; i < cnt; i++) {
+			s = vmm_profiler_sample_get(c, i);
+			if (!s || (VMM_PROFILE_SAMPLE_MAX <= s->context)) {
+				continue;
+			}
+			total++;
+			ctx_total[s->context]++;
+			if (s->context == VMM_PROFILE_SAMPLE_GUEST) {
+				continue;
+			}
+			if (!cmd_profile_sample_symbol(s->pc, &pos)) {
+				unknown++;
+				continue;
+			}
+
+			h = &hits[pos];
+			h->self++;
+			h->incl++;
+			h->ctx[s->context]++;
+
+			/* Count each caller only once per sample */
+			seen[0] = pos;
+			seen_count = 1;
+			for (j = 0; j < s->nr_frames; j++) {
+				if (!cmd_profile_sample_symbol(s->frames[j],
+								&pos)) {
+					continue;
+				}
+				for (k = 0; k < seen_count; k++) {
+					if (seen[k] == pos) {
+						break;
+					}
+				}
+				if (k < seen_count) {
+					continue;
+				}
+				seen[seen_count++] = pos;
+				hits[pos].incl++;
+			}
+		}
+	}
+
+	/* Compact non-zero entries at start of array */
+	cnt = 0;
+	for (i = 0; i < kallsyms_num_syms; i++) {
+		if (!hits[i].incl) {
+			continue;
+		}
+		hits[cnt] = hits[i];
+		hits[cnt].index = i;
+		cnt++;
+	}
+
+	libsort_smoothsort(hits, 0, cnt, cmd_profile_sample_self_cmp,
+			   cmd_profile_sample_swap);
+
+	vmm_cprintf(cdev, "Sample period: %"PRIu64" usecs, Stack depth: %u\n",
+		    udiv64(vmm_profiler_sample_period(), 1000),
+		    vmm_profiler_sample_depth());
+	for_each_cpu(c, cpu_online_mask) {
+		vmm_cprintf(cdev, "CPU%d: %u samples, %"PRIu64" dropped\n",
+			    c, vmm_profiler_sample_count(c),
+			    vmm_profiler_sample_dropped(c));
+	}
+	for (i = 0; i < VMM_PROFILE_SAMPLE_MAX; i++) {
+		cmd_profile_sample_percent(ctx_total[i], total, &ip, &fp);
+		vmm_cprintf(cdev, "%-12s: %8u samples (%3u.%02u%%)\n",
+			    cmd_profile_sample_ctx_names[i],
+			    ctx_total[i], ip, fp);
+	}
+	vmm_cprintf(cdev, "%-12s: %8u samples\n", "unknown", unknown);
+	vmm_cprintf(cdev, "\n");
+
+	vmm_cprintf(cdev, "%-40s %8s %8s %8s %8s %8s %8s\n",
+		    "Symbol", "Self", "Self%", "Incl", "Hyp", "Exit", "Idle");
+	for (i = 0; i < cnt; i++) {
+		if (max_lines && (max_lines <= i)) {
+			break;
+		}
+		h = &hits[cnt - i - 1];
+		kallsyms_expand_symbol(kallsyms_get_symbol_offset(h->index),
+				       name);
+		cmd_profile_sample_percent(h->self, total, &ip, &fp);
+		vmm_cprintf(cdev, "%-40s %8u %4u.%02u%% %8u %8u %8u %8u\n",
+			    name, h->self, ip, fp, h->incl,
+			    h->ctx[VMM_PROFILE_SAMPLE_HYP],
+			    h->ctx[VMM_PROFILE_SAMPLE_GUEST_EXIT],
+			    h->ctx[VMM_PROFILE_SAMPLE_IDLE]);
+	}
+
+	vmm_free(hits);
+
+	return rc;
+}
+
+static int cmd_profile_sample_exec(struct vmm_chardev *cdev,
+				   int argc, char **argv)
+{
+	u32 c, depth = VMM_PROFILE_SAMPLE_DEPTH;
+	u64 period = VMM_PROFILE_SAMPLE_DEF_PERIOD;
+
+	if (argc < 1) {
+		goto fail;
+	}
+
+	if (!strcmp(argv[0], "start") && (argc <= 3)) {
+		if (argc > 1) {
+			period = strtoull(argv[1], NULL, 0) * 1000;
+		}
+		if (argc > 2) {
+			depth = strtoul(argv[2], NULL, 0);
+		}
+		return vmm_profiler_sample_start(period, depth);
+	} else if (!strcmp(argv[0], "stop") && (argc == 1)) {
+		return vmm_profiler_sample_stop();
+	} else if (!strcmp(argv[0], "status") && (argc == 1)) {
+		vmm_cprintf(cdev, "profile sample is %s\n",
+			    (vmm_profiler_sample_isactive()) ?
+			    "running" : "not running");
+		for_each_cpu(c, cpu_online_mask) {
+			vmm_cprintf(cdev, "CPU%d: %u samples, %"PRIu64" dropped\n",
+				    c, vmm_profiler_sample_count(c),
+				    vmm_profiler_sample_dropped(c));
+		}
+		return VMM_OK;
+	} else if (!strcmp(argv[0], "dump") && (argc <= 2)) {
+		return cmd_profile_sample_dump(cdev,
+				(argc > 1) ? strtoul(argv[1], NULL, 0) : 0);
+	}
+
+fail:
+	cmd_profile_usage(cdev);
+	return VMM_EFAIL;
+}
+
+#endif
+
 static const struct {
 	char *name;
 	int (*function) (struct vmm_chardev *, char *);
 } const command[] = {
 	{"help", cmd_profile_help},
+#if defined(CONFIG_PROFILE)
 	{"start", cmd_profile_start},
 	{"stop", cmd_profile_stop},
 	{"status", cmd_profile_status},
 	{"dump", cmd_profile_dump},
+#endif
 	{NULL, NULL},
 };
 
@@ -351,6 +590,12 @@ static int cmd_profile_exec(struct vmm_chardev *cdev, int argc, char **argv)
 	char *param = NULL;
 	int index = 0;
 
+#if defined(CONFIG_PROFILE_SAMPLE)
+	if ((argc > 1) && !strcmp(argv[1], "sample")) {
+		return cmd_profile_sample_exec(cdev, argc - 2, &argv[2]);
+	}
+#endif
+
 	if (argc > 3) {
 		goto fail;
 	}
@@ -26,9 +26,11 @@
 #include <vmm_stdio.h>
 #include <vmm_version.h>
 #include <vmm_threads.h>
+#include <vmm_workqueue.h>
 #include <vmm_modules.h>
 #include <vmm_cmdmgr.h>
 #include <libs/stringlib.h>
+#include <libs/mathlib.h>
 
 #define MODULE_DESC			"Command thread"
 #define MODULE_AUTHOR			"Anup Patel"
@@ -42,6 +44,7 @@ static void cmd_thread_usage(struct vmm_chardev *cdev)
 	vmm_cprintf(cdev, "Usage:\n");
 	vmm_cprintf(cdev, "   thread help\n");
 	vmm_cprintf(cdev, "   thread list\n");
+	vmm_cprintf(cdev, "   thread workqueues\n");
 }
 
 static void cmd_thread_list(struct vmm_chardev *cdev)
@@ -87,6 +90,48 @@ static void cmd_thread_list(struct vmm_chardev *cdev)
 			  "----------------------------------------\n");
 }
 
+static void cmd_thread_workqueues(struct vmm_chardev *cdev)
+{
+	int index, count;
+	const char *mode;
+	struct vmm_workqueue *wq;
+	struct vmm_workqueue_stats stats;
+
+	vmm_cprintf(cdev, "----------------------------------------"
+			  "----------------------------------------\n");
+	vmm_cprintf(cdev, " %-14s %-7s %-3s %-5s %-5s %-10s %-8s %-9s %-9s\n",
+			  "Name", "Mode", "Wkr", "Depth", "Max",
+			  "Executed", "Stolen", "AvgLat-us", "MaxLat-us");
+	vmm_cprintf(cdev, "----------------------------------------"
+			  "----------------------------------------\n");
+	count = vmm_workqueue_count();
+	for (index = 0; index < count; index++) {
+		wq = vmm_workqueue_index2workqueue(index);
+		if (!wq || vmm_workqueue_get_stats(wq, &stats)) {
+			continue;
+		}
+		if (vmm_workqueue_get_flags(wq) & VMM_WORKQUEUE_PERCPU) {
+			mode = "percpu";
+		} else if (vmm_workqueue_get_flags(wq) & VMM_WORKQUEUE_UNBOUND) {
+			mode = "unbound";
+		} else {
+			mode = "ordered";
+		}
+		vmm_cprintf(cdev, " %-14s %-7s %-3d %-5d %-5d %-10"PRIu64
+				  " %-8"PRIu64" %-9"PRIu64" %-9"PRIu64"\n",
+				  vmm_workqueue_get_name(wq), mode,
+				  vmm_workqueue_worker_count(wq),
+				  stats.depth, stats.max_depth,
+				  stats.executed, stats.stolen,
+				  (stats.executed) ?
+				  udiv64(stats.total_latency,
+					 stats.executed * 1000) : 0,
+				  udiv64(stats.max_latency, 1000));
+	}
+	vmm_cprintf(cdev, "----------------------------------------"
+			  "----------------------------------------\n");
+}
+
 static int cmd_thread_exec(struct vmm_chardev *cdev, int argc, char **argv)
 {
 	if (argc == 2) {
@@ -96,6 +141,9 @@ static int cmd_thread_exec(struct vmm_chardev *cdev, int argc, char **argv)
 		} else if (strcmp(argv[1], "list") == 0) {
 			cmd_thread_list(cdev);
 			return VMM_OK;
+		} else if (strcmp(argv[1], "workqueues") == 0) {
+			cmd_thread_workqueues(cdev);
+			return VMM_OK;
 		}
 	}
 	cmd_thread_usage(cdev);
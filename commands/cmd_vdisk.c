@@ -28,6 +28,7 @@
 #include <vmm_cmdmgr.h>
 #include <vio/vmm_vdisk.h>
 #include <libs/stringlib.h>
+#include <libs/mathlib.h>
 
 #define MODULE_DESC			"Command vdisk"
 #define MODULE_AUTHOR			"Anup Patel"
@@ -41,7 +42,9 @@ static void cmd_vdisk_usage(struct vmm_chardev *cdev)
 	vmm_cprintf(cdev, "Usage:\n");
 	vmm_cprintf(cdev, "   vdisk help\n");
 	vmm_cprintf(cdev, "   vdisk list\n");
+	vmm_cprintf(cdev, "   vdisk iostat\n");
 	vmm_cprintf(cdev, "   vdisk info <vdisk_name>\n");
+	vmm_cprintf(cdev, "   vdisk stats <vdisk_name>\n");
 	vmm_cprintf(cdev, "   vdisk detach <vdisk_name>\n");
 	vmm_cprintf(cdev, "   vdisk attach <vdisk_name> <block_device_name>\n");
 }
@@ -95,6 +98,67 @@ static int cmd_vdisk_info(struct vmm_chardev *cdev,
 	return VMM_OK;
 }
 
+static int cmd_vdisk_stats(struct vmm_chardev *cdev,
+			   const char *vdisk_name)
+{
+	int rc;
+	struct vmm_blockdev_stats st;
+	struct vmm_vdisk *vdisk = vmm_vdisk_find(vdisk_name);
+
+	if (!vdisk) {
+		vmm_cprintf(cdev, "Failed to find virtual disk\n");
+		return VMM_ENODEV;
+	}
+
+	rc = vmm_vdisk_get_stats(vdisk, &st);
+	if (rc) {
+		vmm_cprintf(cdev, "Failed to get io stats (error %d)\n", rc);
+		return rc;
+	}
+
+	return vmm_blockdev_stats_print(cdev, &st);
+}
+
+static int cmd_vdisk_iostat_iter(struct vmm_vdisk *vdisk, void *data)
+{
+	u64 svc_nsecs, ops;
+	struct vmm_blockdev_stats st;
+	struct vmm_chardev *cdev = data;
+
+	if (vmm_vdisk_get_stats(vdisk, &st)) {
+		return VMM_OK;
+	}
+
+	ops = st.ops[VMM_BLOCKDEV_STATS_READ] +
+	      st.ops[VMM_BLOCKDEV_STATS_WRITE];
+	svc_nsecs = st.service_nsecs[VMM_BLOCKDEV_STATS_READ] +
+		    st.service_nsecs[VMM_BLOCKDEV_STATS_WRITE];
+	vmm_cprintf(cdev, " %-14s %-7"PRIu64" %-10"PRIu64" %-10"PRIu64" "
+		    "%-10"PRIu64" %-10"PRIu64" %-10"PRIu64"\n",
+		    vmm_vdisk_name(vdisk), vmm_blockdev_stats_in_flight(&st),
+		    st.ops[VMM_BLOCKDEV_STATS_READ],
+		    st.bytes[VMM_BLOCKDEV_STATS_READ] >> 10,
+		    st.ops[VMM_BLOCKDEV_STATS_WRITE],
+		    st.bytes[VMM_BLOCKDEV_STATS_WRITE] >> 10,
+		    (ops) ? udiv64(udiv64(svc_nsecs, ops), 1000) : 0);
+
+	return VMM_OK;
+}
+
+static void cmd_vdisk_iostat(struct vmm_chardev *cdev)
+{
+	vmm_cprintf(cdev, "----------------------------------------"
+			  "----------------------------------------\n");
+	vmm_cprintf(cdev, " %-14s %-7s %-10s %-10s %-10s %-10s %-10s\n",
+			  "Name", "InFlt", "Rd Ops", "Rd KB",
+			  "Wr Ops", "Wr KB", "Avg Svc us");
+	vmm_cprintf(cdev, "----------------------------------------"
+			  "----------------------------------------\n");
+	vmm_vdisk_iterate(NULL, cdev, cmd_vdisk_iostat_iter);
+	vmm_cprintf(cdev, "----------------------------------------"
+			  "----------------------------------------\n");
+}
+
 static int cmd_vdisk_detach(struct vmm_chardev *cdev,
 			    const char *vdisk_name)
 {
@@ -135,12 +199,17 @@ static int cmd_vdisk_exec(struct vmm_chardev *cdev, int argc, char **argv)
 		} else if (strcmp(argv[1], "list") == 0) {
 			cmd_vdisk_list(cdev);
 			return VMM_OK;
+		} else if (strcmp(argv[1], "iostat") == 0) {
+			cmd_vdisk_iostat(cdev);
+			return VMM_OK;
 		}
 	} else if (argc == 3) {
 		if (strcmp(argv[1], "detach") == 0) {
 			return cmd_vdisk_detach(cdev, argv[2]);
 		} else if (strcmp(argv[1], "info") == 0) {
 			return cmd_vdisk_info(cdev, argv[2]);
+		} else if (strcmp(argv[1], "stats") == 0) {
+			return cmd_vdisk_stats(cdev, argv[2]);
 		}
 	} else if (argc == 4) {
 		if (strcmp(argv[1], "attach") == 0) {
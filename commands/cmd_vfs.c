@@ -33,9 +33,12 @@
 #include <vmm_modules.h>
 #include <vmm_cmdmgr.h>
 #include <vmm_delay.h>
+#include <vmm_timer.h>
 #include <libs/libfdt.h>
 #include <libs/stringlib.h>
+#include <libs/mathlib.h>
 #include <libs/vfs.h>
+#include <libs/guest_loader.h>
 
 #if CONFIG_CRYPTO_HASH_MD5
 #include <libs/md5.h>
@@ -55,6 +58,9 @@
 #define VFS_MAX_MODULE_SZ		(256 * 1024)
 #define VFS_MAX_FDT_SZ			(32 * 1024)
 #define VFS_LOAD_BUF_SZ			(4 * 1024)
+#define VFS_MAX_BENCH_BUF_SZ		(4 * 1024 * 1024)
+#define VFS_MAX_LOAD_JOBS		32
+#define VFS_MAX_LOAD_LISTS		8
 
 static void cmd_vfs_usage(struct vmm_chardev *cdev)
 {
@@ -74,6 +80,8 @@ static void cmd_vfs_usage(struct vmm_chardev *cdev)
 	vmm_cprintf(cdev, "   vfs sha256 <path_to_file>\n");
 #endif
 	vmm_cprintf(cdev, "   vfs run <path_to_file>\n");
+	vmm_cprintf(cdev, "   vfs readbench <path_to_file> "
+			  "[<buf_size>]\n");
 	vmm_cprintf(cdev, "   vfs mv <old_path> <new_path>\n");
 	vmm_cprintf(cdev, "   vfs rm <path_to_file>\n");
 	vmm_cprintf(cdev, "   vfs mkdir <path_to_dir>\n");
@@ -84,13 +92,19 @@ static void cmd_vfs_usage(struct vmm_chardev *cdev)
 			  "[<alias0>,<attr_name>,<attr_type>,<value>] "
 			  "[<alias1>,<attr_name>,<attr_type>,<value>] ...\n");
 	vmm_cprintf(cdev, "   vfs host_load <host_phys_addr> "
-			  "<path_to_file> [<file_offset>] [<byte_count>]\n");
-	vmm_cprintf(cdev, "   vfs host_load_list <path_to_list_file>\n");
+			  "<path_to_file> [<file_offset>] [<byte_count>] "
+			  "[raw]\n");
+	vmm_cprintf(cdev, "   vfs host_load_list <path_to_list_file> "
+			  "[raw]\n");
 	vmm_cprintf(cdev, "   vfs guest_load <guest_name> <guest_phys_addr> "
-			  "<path_to_file> [<file_offset>] [<byte_count>]\n");
+			  "<path_to_file> [<file_offset>] [<byte_count>] "
+			  "[raw]\n");
 	vmm_cprintf(cdev, "   vfs guest_load_list <guest_name> "
-			  "<path_to_list_file>\n");
+			  "<path_to_list_file> [<guest_name> "
+			  "<path_to_list_file>] ... [raw]\n");
 	vmm_cprintf(cdev, "Note:\n");
+	vmm_cprintf(cdev, "   gzip and LZ4 files are decompressed while "
+			  "loading unless raw is given\n");
 	vmm_cprintf(cdev, "   <attr_type> = unknown|string|bytes|"
 					   "uint32|uint64|"
 			  		   "physaddr|physsize|"
@@ -622,6 +636,64 @@ static int cmd_vfs_cat(struct vmm_chardev *cdev, const char *path)
 	return VMM_OK;
 }
 
+static int cmd_vfs_readbench(struct vmm_chardev *cdev,
+			     const char *path, u32 buf_size)
+{
+	int fd, rc;
+	u32 len;
+	size_t buf_rd;
+	u64 total = 0, tstamp, usecs;
+	char *buf = NULL;
+
+	if (!buf_size || (VFS_MAX_BENCH_BUF_SZ < buf_size)) {
+		vmm_cprintf(cdev, "Invalid buffer size %d\n", buf_size);
+		return VMM_EINVALID;
+	}
+
+	rc = cmd_vfs_file_open_read(cdev, path, &fd, &len);
+	if (VMM_OK != rc) {
+		return rc;
+	}
+
+	if (NULL == (buf = vmm_malloc(buf_size))) {
+		vmm_cprintf(cdev, "Failed to allocate buffer\n");
+		vfs_close(fd);
+		return VMM_ENOMEM;
+	}
+
+	tstamp = vmm_timer_timestamp();
+	while (len) {
+		buf_rd = vfs_read(fd, buf, (len < buf_size) ? len : buf_size);
+		if (buf_rd < 1) {
+			break;
+		}
+		total += buf_rd;
+		len -= buf_rd;
+	}
+	tstamp = vmm_timer_timestamp() - tstamp;
+
+	usecs = udiv64(tstamp, 1000);
+	if (!usecs) {
+		usecs = 1;
+	}
+
+	vmm_cprintf(cdev, "Read %"PRIu64" bytes in %"PRIu64" usecs "
+		    "using %d bytes buffer\n", total, usecs, buf_size);
+	vmm_cprintf(cdev, "Throughput %"PRIu64" KB/s\n",
+		    udiv64(udiv64(total * 1000000ULL, usecs), 1024));
+	if (len) {
+		vmm_cprintf(cdev, "Failed to read %d bytes\n", len);
+		rc = VMM_EIO;
+	}
+
+	vmm_free(buf);
+	if (vfs_close(fd)) {
+		vmm_cprintf(cdev, "Failed to close %s\n", path);
+	}
+
+	return rc;
+}
+
 static int cmd_vfs_mv(struct vmm_chardev *cdev,
 			const char *old_path, const char *new_path)
 {
@@ -995,80 +1067,58 @@ fail:
 	return rc;
 }
 
-static int cmd_vfs_load(struct vmm_chardev *cdev,
-			struct vmm_guest *guest,
-			physical_addr_t pa,
-			const char *path, u32 off, u32 len)
-{
-	int fd, rc;
-	loff_t rd_off;
-	physical_addr_t wr_pa;
-	size_t buf_wr, buf_rd, buf_count, wr_count;
-	char *buf = NULL;
+struct cmd_vfs_load_entry {
+	struct vmm_guest *guest;
+	physical_addr_t pa;
+	char path[VFS_MAX_PATH];
+	struct guest_loader_job *job;
+};
 
-	rc = cmd_vfs_file_open_read(cdev, path, &fd, &len);
-	if (VMM_OK != rc) {
-		return rc;
-	}
+static void cmd_vfs_load_report(struct vmm_chardev *cdev,
+				struct vmm_guest *guest,
+				physical_addr_t pa, const char *path,
+				int rc, struct guest_loader_stats *stats)
+{
+	u64 usecs, kbps;
 
-	if (off >= len) {
-		vfs_close(fd);
-		vmm_cprintf(cdev, "Offset greater than file size\n");
-		return VMM_EINVALID;
+	if (rc) {
+		vmm_cprintf(cdev, "%s: Failed to load 0x%"PRIPADDR" with %s "
+			    "(error %d)\n", (guest) ? (guest->name) : "host",
+			    pa, path, rc);
+		return;
 	}
 
-	if (NULL == (buf = vmm_malloc(VFS_LOAD_BUF_SZ))) {
-		vmm_cprintf(cdev, "Failed to allocate buffer\n");
-		vfs_close(fd);
-		return VMM_ENOMEM;
+	usecs = udiv64(stats->nsecs, 1000);
+	if (!usecs) {
+		usecs = 1;
 	}
+	kbps = udiv64(udiv64(stats->bytes * 1000000ULL, usecs), 1024);
 
-	len = ((len - off) < len) ? (len - off) : len;
-
-	rd_off = 0;
-	wr_count = 0;
-	wr_pa = pa;
-	while (len) {
-		buf_rd = (len < VFS_LOAD_BUF_SZ) ? len : VFS_LOAD_BUF_SZ;
-		buf_count = vfs_read(fd, buf, buf_rd);
-		if (buf_count < 1) {
-			vmm_cprintf(cdev, "Failed to read "
-					  "%zu bytes @ 0x%llx from %s\n",
-					   buf_rd, rd_off, path);
-			break;
-		}
-		rd_off += buf_count;
-		if (guest) {
-			buf_wr = vmm_guest_memory_write(guest, wr_pa,
-							buf, buf_count, FALSE);
-		} else {
-			buf_wr = vmm_host_memory_write(wr_pa,
-						       buf, buf_count, FALSE);
-		}
-		if (buf_wr != buf_count) {
-			vmm_cprintf(cdev, "Failed to write "
-					  "%zu bytes @ 0x%"PRIPADDR" (%s)\n",
-					  buf_count, wr_pa,
-					  (guest) ? (guest->name) : "host");
-			break;
-		}
-		len -= buf_wr;
-		wr_count += buf_wr;
-		wr_pa += buf_wr;
+	vmm_cprintf(cdev, "%s: Loaded 0x%"PRIPADDR" with %"PRIu64" bytes "
+		    "in %"PRIu64" usecs (%"PRIu64".%02d MB/s)\n",
+		    (guest) ? (guest->name) : "host", pa, stats->bytes,
+		    usecs, udiv64(kbps, 1024),
+		    (int)udiv64(umod64(kbps, 1024) * 100, 1024));
+	if (stats->format != DECOMPRESS_NONE) {
+		vmm_cprintf(cdev, "%s: Decompressed %"PRIu64" bytes of %s "
+			    "file\n", (guest) ? (guest->name) : "host",
+			    stats->file_bytes,
+			    decompress_format_name(stats->format));
 	}
+}
 
-	vmm_cprintf(cdev, "%s: Loaded 0x%"PRIPADDR" with %zu bytes\n",
-			  (guest) ? (guest->name) : "host",
-			  pa, wr_count);
+static int cmd_vfs_load(struct vmm_chardev *cdev,
+			struct vmm_guest *guest,
+			physical_addr_t pa,
+			const char *path, u32 off, u32 len, u32 flags)
+{
+	int rc;
+	struct guest_loader_stats stats;
 
-	vmm_free(buf);
-	rc = vfs_close(fd);
-	if (rc) {
-		vmm_cprintf(cdev, "Failed to close %s\n", path);
-		return rc;
-	}
+	rc = guest_loader_load(guest, pa, path, off, len, flags, &stats);
+	cmd_vfs_load_report(cdev, guest, pa, path, rc, &stats);
 
-	return VMM_OK;
+	return rc;
 }
 
 static const char cmd_vfs_esclist[] = {'\n', '\r', ' '};
@@ -1116,16 +1166,18 @@ static char *cmd_vfs_next_token(char **bufp, u32 *len)
 	return token;
 }
 
-static int cmd_vfs_load_list(struct vmm_chardev *cdev,
-			     struct vmm_guest *guest,
-			     const char *path)
+static int cmd_vfs_load_list_submit(struct vmm_chardev *cdev,
+				    struct vmm_guest *guest,
+				    const char *path, u32 flags,
+				    struct cmd_vfs_load_entry *ents,
+				    u32 *ent_count)
 {
 	u32 len;
 	int fd, rc;
-	physical_addr_t pa;
 	char *buf = NULL;
 	char *buf_save = NULL;
 	char *token = NULL;
+	struct cmd_vfs_load_entry *e;
 
 	rc = cmd_vfs_file_open_read(cdev, path, &fd, &len);
 	if (VMM_OK != rc) {
@@ -1158,39 +1210,117 @@ static int cmd_vfs_load_list(struct vmm_chardev *cdev,
 			vmm_cprintf(cdev, "Failed to read address\n");
 			break;
 		}
-		pa = (physical_addr_t)strtoull(token, NULL, 0);
+		if (VFS_MAX_LOAD_JOBS <= *ent_count) {
+			vmm_cprintf(cdev, "Too many files to load\n");
+			rc = VMM_ENOSPC;
+			break;
+		}
+		e = &ents[*ent_count];
+		e->guest = guest;
+		e->pa = (physical_addr_t)strtoull(token, NULL, 0);
 
 		token = cmd_vfs_next_token(&buf, &len);
+		if (!token) {
+			vmm_cprintf(cdev, "Failed to read file path\n");
+			break;
+		}
+		strncpy(e->path, token, sizeof(e->path));
+		e->path[sizeof(e->path) - 1] = '\0';
 		vmm_cprintf(cdev, "%s: Loading 0x%"PRIPADDR" with file %s\n",
 			    (guest) ? (guest->name) : "host",
-			    pa, token);
-
-		rc = cmd_vfs_load(cdev, guest, pa, token, 0, 0xFFFFFFFF);
-		if (rc) {
-			vmm_cprintf(cdev, "error %d\n", rc);
+			    e->pa, e->path);
+
+		e->job = guest_loader_submit(guest, e->pa, e->path,
+					     0, 0xFFFFFFFF, flags);
+		if (!e->job) {
+			vmm_cprintf(cdev, "Failed to submit load of %s\n",
+				    e->path);
+			rc = VMM_EFAIL;
 			break;
 		}
+		(*ent_count)++;
 	}
 
 	vmm_free(buf_save);
-	rc = vfs_close(fd);
-	if (rc) {
+	if (vfs_close(fd)) {
 		vmm_cprintf(cdev, "Failed to close %s\n", path);
-		return rc;
 	}
 
-	return VMM_OK;
+	return rc;
+}
+
+static int cmd_vfs_load_list(struct vmm_chardev *cdev,
+			     struct vmm_guest **guests,
+			     const char **paths, u32 count, u32 flags)
+{
+	int rc = VMM_OK, rc1;
+	u32 i, ent_count = 0;
+	u64 tstamp, usecs;
+	struct guest_loader_stats stats, total;
+	struct cmd_vfs_load_entry *ents, *e;
+
+	ents = vmm_zalloc(sizeof(*ents) * VFS_MAX_LOAD_JOBS);
+	if (!ents) {
+		vmm_cprintf(cdev, "Failed to allocate buffer\n");
+		return VMM_ENOMEM;
+	}
+
+	/* Submit all files of all lists so that they load in parallel */
+	tstamp = vmm_timer_timestamp();
+	for (i = 0; i < count; i++) {
+		rc = cmd_vfs_load_list_submit(cdev, guests[i], paths[i],
+					      flags, ents, &ent_count);
+		if (rc) {
+			break;
+		}
+	}
+
+	memset(&total, 0, sizeof(total));
+	for (i = 0; i < ent_count; i++) {
+		e = &ents[i];
+		rc1 = guest_loader_wait(e->job, &stats);
+		cmd_vfs_load_report(cdev, e->guest, e->pa, e->path,
+				    rc1, &stats);
+		if (rc1) {
+			rc = (rc) ? rc : rc1;
+		} else {
+			total.bytes += stats.bytes;
+		}
+	}
+	total.nsecs = vmm_timer_timestamp() - tstamp;
+
+	if (1 < ent_count) {
+		usecs = udiv64(total.nsecs, 1000);
+		vmm_cprintf(cdev, "Loaded %d files with %"PRIu64" bytes "
+			    "in %"PRIu64" usecs\n", ent_count,
+			    total.bytes, usecs);
+	}
+
+	vmm_free(ents);
+
+	return rc;
 }
 
 static int cmd_vfs_exec(struct vmm_chardev *cdev, int argc, char **argv)
 {
-	u32 off, len;
+	u32 i, off, len, flags = 0;
 	physical_addr_t pa;
 	struct vmm_guest *guest;
+	const char *paths[VFS_MAX_LOAD_LISTS];
+	struct vmm_guest *guests[VFS_MAX_LOAD_LISTS];
 	if (argc < 2) {
 		cmd_vfs_usage(cdev);
 		return VMM_EFAIL;
 	}
+	/* Trailing raw option of load commands disables decompression */
+	if ((argc > 3) && (strcmp(argv[argc - 1], "raw") == 0) &&
+	    ((strcmp(argv[1], "host_load") == 0) ||
+	     (strcmp(argv[1], "host_load_list") == 0) ||
+	     (strcmp(argv[1], "guest_load") == 0) ||
+	     (strcmp(argv[1], "guest_load_list") == 0))) {
+		flags |= GUEST_LOADER_RAW;
+		argc--;
+	}
 	if (strcmp(argv[1], "help") == 0) {
 		cmd_vfs_usage(cdev);
 		return VMM_OK;
@@ -1219,6 +1349,10 @@ static int cmd_vfs_exec(struct vmm_chardev *cdev, int argc, char **argv)
 	} else if ((strcmp(argv[1], "sha256") == 0) && (argc == 3)) {
 		return cmd_vfs_sha256(cdev, argv[2]);
 #endif
+	} else if ((strcmp(argv[1], "readbench") == 0) &&
+		   ((argc == 3) || (argc == 4))) {
+		len = (argc == 4) ? strtoul(argv[3], NULL, 0) : VFS_LOAD_BUF_SZ;
+		return cmd_vfs_readbench(cdev, argv[2], len);
 	} else if ((strcmp(argv[1], "cat") == 0) && (argc == 3)) {
 		return cmd_vfs_cat(cdev, argv[2]);
 	} else if ((strcmp(argv[1], "mv") == 0) && (argc == 4)) {
@@ -1238,9 +1372,11 @@ static int cmd_vfs_exec(struct vmm_chardev *cdev, int argc, char **argv)
 		pa = (physical_addr_t)strtoull(argv[2], NULL, 0);
 		off = (argc > 4) ? strtoul(argv[4], NULL, 0) : 0;
 		len = (argc > 5) ? strtoul(argv[5], NULL, 0) : 0xFFFFFFFF;
-		return cmd_vfs_load(cdev, NULL, pa, argv[3], off, len);
+		return cmd_vfs_load(cdev, NULL, pa, argv[3], off, len, flags);
 	} else if ((strcmp(argv[1], "host_load_list") == 0) && (argc == 3)) {
-		return cmd_vfs_load_list(cdev, NULL, argv[2]);
+		guests[0] = NULL;
+		paths[0] = argv[2];
+		return cmd_vfs_load_list(cdev, guests, paths, 1, flags);
 	} else if ((strcmp(argv[1], "guest_load") == 0) && (argc > 4)) {
 		guest = vmm_manager_guest_find(argv[2]);
 		if (!guest) {
@@ -1251,15 +1387,21 @@ static int cmd_vfs_exec(struct vmm_chardev *cdev, int argc, char **argv)
 		pa = (physical_addr_t)strtoull(argv[3], NULL, 0);
 		off = (argc > 5) ? strtoul(argv[5], NULL, 0) : 0;
 		len = (argc > 6) ? strtoul(argv[6], NULL, 0) : 0xFFFFFFFF;
-		return cmd_vfs_load(cdev, guest, pa, argv[4], off, len);
-	} else if ((strcmp(argv[1], "guest_load_list") == 0) && (argc == 4)) {
-		guest = vmm_manager_guest_find(argv[2]);
-		if (!guest) {
-			vmm_cprintf(cdev, "Failed to find guest %s\n",
-				    argv[2]);
-			return VMM_ENOTAVAIL;
+		return cmd_vfs_load(cdev, guest, pa, argv[4], off, len,
+				    flags);
+	} else if ((strcmp(argv[1], "guest_load_list") == 0) &&
+		   (argc >= 4) && !(argc % 2) &&
+		   (((argc - 2) / 2) <= VFS_MAX_LOAD_LISTS)) {
+		for (i = 0; i < ((argc - 2) / 2); i++) {
+			guests[i] = vmm_manager_guest_find(argv[2 + 2 * i]);
+			if (!guests[i]) {
+				vmm_cprintf(cdev, "Failed to find guest %s\n",
+					    argv[2 + 2 * i]);
+				return VMM_ENOTAVAIL;
+			}
+			paths[i] = argv[3 + 2 * i];
 		}
-		return cmd_vfs_load_list(cdev, guest, argv[3]);
+		return cmd_vfs_load_list(cdev, guests, paths, i, flags);
 	}
 	cmd_vfs_usage(cdev);
 	return VMM_EFAIL;
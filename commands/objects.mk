@@ -54,6 +54,8 @@ commands-objs-$(CONFIG_CMD_FB)+= cmd_fb.o
 commands-objs-$(CONFIG_CMD_FB_BACKLIGHT)+= cmd_backlight.o
 commands-objs-$(CONFIG_CMD_BLOCKDEV)+= cmd_blockdev.o
 commands-objs-$(CONFIG_CMD_RBD)+= cmd_rbd.o
+commands-objs-$(CONFIG_CMD_LOOP)+= cmd_loop.o
+commands-objs-$(CONFIG_CMD_COW)+= cmd_cow.o
 commands-objs-$(CONFIG_CMD_FLASH)+= cmd_flash.o
 commands-objs-$(CONFIG_CMD_I2C)+= cmd_i2c.o
 commands-objs-$(CONFIG_CMD_SPIDEV)+= cmd_spidev.o
@@ -25,6 +25,7 @@ core-objs-$(CONFIG_BLOCK)+= block/vmm_blockdev_mod.o
 
 vmm_blockdev_mod-y += vmm_blockdev.o
 vmm_blockdev_mod-y += vmm_blockrq.o
+vmm_blockdev_mod-$(CONFIG_BLOCK_CACHE) += vmm_blockcache.o
 
 %/vmm_blockdev_mod.o: $(foreach obj,$(vmm_blockdev_mod-y),%/$(obj))
 	$(call merge_objs,$@,$^)
@@ -0,0 +1,738 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file vmm_blockcache.c
+ * @author agent (agent@local)
+ * @brief Block device buffer cache source
+ *
+ * Each block device with buffer cache enabled gets a fixed pool of
+ * buffers. A buffer caches one page worth of blocks (or one block if
+ * blocks are bigger than a page). Buffers are found using a hash table
+ * and recycled in LRU order. Writes only dirty buffers which are then
+ * written back by a global flusher thread, upon eviction or upon
+ * explicit sync.
+ *
+ * Large buffer aligned transfers (e.g. guest image loading) bypass the
+ * buffer cache so that they don't thrash small metadata buffers.
+ *
+ * Buffer cache always belongs to the whole block device and partitions
+ * share it so that cached contents of a partition and its parent are
+ * never different. Users of a buffer cache take a reference under the
+ * cache list lock and buffer cache is freed only after all references
+ * are dropped. No I/O is done with the cache list lock held.
+ */
+
+#include <vmm_error.h>
+#include <vmm_heap.h>
+#include <vmm_delay.h>
+#include <vmm_stdio.h>
+#include <vmm_mutex.h>
+#include <vmm_modules.h>
+#include <vmm_threads.h>
+#include <vmm_completion.h>
+#include <vmm_host_aspace.h>
+#include <block/vmm_blockcache.h>
+#include <libs/list.h>
+#include <libs/stringlib.h>
+#include <libs/mathlib.h>
+
+#define BLOCKCACHE_MIN_BUFFERS		8
+#define BLOCKCACHE_BYPASS_BUFFERS	16
+#define BLOCKCACHE_PRIORITY		VMM_THREAD_DEF_PRIORITY
+#define BLOCKCACHE_TIMESLICE		VMM_THREAD_DEF_TIME_SLICE
+
+struct blockcache_buf {
+	struct dlist hash_head;
+	struct dlist lru_head;
+	u64 bno;
+	bool valid;
+	bool dirty;
+	u8 *data;
+};
+
+struct vmm_blockcache {
+	struct dlist head;
+	struct vmm_blockdev *bdev;
+	u32 users;
+	u32 refs;
+	u32 flush_gen;
+
+	/* Lock to protect buffers and statistics */
+	struct vmm_mutex lock;
+
+	u32 buf_blocks;
+	u32 buf_size;
+	u32 buf_count;
+	u32 buf_pages;
+	virtual_addr_t buf_va;
+	struct blockcache_buf *bufs;
+
+	u32 hash_mask;
+	struct dlist *hash;
+
+	/* Most recently used buffer at head and
+	 * invalid buffers at tail
+	 */
+	struct dlist lru_list;
+
+	u32 dirty_count;
+	struct vmm_blockcache_stats stats;
+};
+
+struct blockcache_ctrl {
+	/* Lock to protect cache list and bdev->cache pointers */
+	struct vmm_mutex cache_list_lock;
+	struct dlist cache_list;
+	u32 flush_gen;
+	struct vmm_completion flush_cmpl;
+	struct vmm_thread *flush_thread;
+};
+
+static struct blockcache_ctrl bcctrl;
+
+static int blockcache_writeback(struct vmm_blockcache *bc,
+				struct blockcache_buf *b)
+{
+	int rc;
+
+	if (!b->valid || !b->dirty) {
+		return VMM_OK;
+	}
+
+	rc = vmm_blockdev_rw_blocks(bc->bdev, VMM_REQUEST_WRITE, b->data,
+				    b->bno * bc->buf_blocks, bc->buf_blocks);
+	if (rc) {
+		return rc;
+	}
+
+	b->dirty = FALSE;
+	bc->dirty_count--;
+	bc->stats.writebacks++;
+
+	return VMM_OK;
+}
+
+static void blockcache_mark_dirty(struct vmm_blockcache *bc,
+				  struct blockcache_buf *b)
+{
+	if (!b->dirty) {
+		b->dirty = TRUE;
+		bc->dirty_count++;
+	}
+}
+
+static int blockcache_sync(struct vmm_blockcache *bc)
+{
+	int rc, ret = VMM_OK;
+	u32 i;
+
+	for (i = 0; (i < bc->buf_count) && bc->dirty_count; i++) {
+		rc = blockcache_writeback(bc, &bc->bufs[i]);
+		if (rc) {
+			ret = rc;
+		}
+	}
+
+	return ret;
+}
+
+static struct blockcache_buf *blockcache_find(struct vmm_blockcache *bc,
+					      u64 bno)
+{
+	struct blockcache_buf *b;
+	struct dlist *bucket = &bc->hash[(u32)bno & bc->hash_mask];
+
+	list_for_each_entry(b, bucket, hash_head) {
+		if (b->bno == bno) {
+			return b;
+		}
+	}
+
+	return NULL;
+}
+
+static void blockcache_invalidate(struct vmm_blockcache *bc,
+				  struct blockcache_buf *b)
+{
+	if (!b->valid) {
+		return;
+	}
+
+	if (b->dirty) {
+		b->dirty = FALSE;
+		bc->dirty_count--;
+	}
+	b->valid = FALSE;
+	list_del(&b->hash_head);
+	list_del(&b->lru_head);
+	list_add_tail(&b->lru_head, &bc->lru_list);
+}
+
+/* Get buffer for given buffer number with cache lock held.
+ * Buffer contents are read from block device only if fill is TRUE.
+ */
+static struct blockcache_buf *blockcache_get(struct vmm_blockcache *bc,
+					     u64 bno, bool fill)
+{
+	struct blockcache_buf *b;
+
+	b = blockcache_find(bc, bno);
+	if (b) {
+		bc->stats.hits++;
+		list_del(&b->lru_head);
+		list_add(&b->lru_head, &bc->lru_list);
+		return b;
+	}
+	bc->stats.misses++;
+
+	/* Recycle least recently used buffer */
+	b = list_last_entry(&bc->lru_list, struct blockcache_buf, lru_head);
+	if (b->valid) {
+		if (blockcache_writeback(bc, b)) {
+			return NULL;
+		}
+		list_del(&b->hash_head);
+		b->valid = FALSE;
+		bc->stats.evictions++;
+	}
+
+	if (fill) {
+		if (vmm_blockdev_rw_blocks(bc->bdev, VMM_REQUEST_READ,
+					   b->data, bno * bc->buf_blocks,
+					   bc->buf_blocks)) {
+			return NULL;
+		}
+	}
+
+	b->bno = bno;
+	b->valid = TRUE;
+	b->dirty = FALSE;
+	list_add(&b->hash_head, &bc->hash[(u32)bno & bc->hash_mask]);
+	list_del(&b->lru_head);
+	list_add(&b->lru_head, &bc->lru_list);
+
+	return b;
+}
+
+/* Transfer whole buffers directly between block device and caller */
+static int blockcache_bypass(struct vmm_blockcache *bc,
+			     enum vmm_request_type type,
+			     u8 *buf, u64 bno, u64 count)
+{
+	int rc = VMM_OK;
+	u32 i;
+	struct blockcache_buf *b;
+
+	vmm_mutex_lock(&bc->lock);
+
+	bc->stats.bypass++;
+
+	if (type == VMM_REQUEST_READ) {
+		/* Block device must have latest contents before
+		 * reading without cache lock held.
+		 */
+		for (i = 0; i < bc->buf_count; i++) {
+			b = &bc->bufs[i];
+			if (!b->valid || !b->dirty ||
+			    (b->bno < bno) || ((bno + count) <= b->bno)) {
+				continue;
+			}
+			rc = blockcache_writeback(bc, b);
+			if (rc) {
+				break;
+			}
+		}
+
+		vmm_mutex_unlock(&bc->lock);
+
+		if (rc) {
+			return rc;
+		}
+
+		return vmm_blockdev_rw_blocks(bc->bdev, type, buf,
+					      bno * bc->buf_blocks,
+					      count * bc->buf_blocks);
+	}
+
+	/* Keep cache lock held while writing so that stale
+	 * contents are not cached in parallel.
+	 */
+	rc = vmm_blockdev_rw_blocks(bc->bdev, type, buf,
+				    bno * bc->buf_blocks,
+				    count * bc->buf_blocks);
+
+	for (i = 0; i < bc->buf_count; i++) {
+		b = &bc->bufs[i];
+		if (!b->valid ||
+		    (b->bno < bno) || ((bno + count) <= b->bno)) {
+			continue;
+		}
+		if (rc) {
+			blockcache_invalidate(bc, b);
+			continue;
+		}
+		memcpy(b->data, buf + (b->bno - bno) * bc->buf_size,
+		       bc->buf_size);
+		if (b->dirty) {
+			b->dirty = FALSE;
+			bc->dirty_count--;
+		}
+	}
+
+	vmm_mutex_unlock(&bc->lock);
+
+	return rc;
+}
+
+/* Whole block device owning the buffer cache of given block device */
+static struct vmm_blockdev *blockcache_root(struct vmm_blockdev *bdev)
+{
+	while (bdev->parent) {
+		bdev = bdev->parent;
+	}
+
+	return bdev;
+}
+
+static struct vmm_blockcache *blockcache_get_ref(struct vmm_blockdev *bdev)
+{
+	struct vmm_blockcache *bc;
+
+	vmm_mutex_lock(&bcctrl.cache_list_lock);
+	bc = blockcache_root(bdev)->cache;
+	if (bc) {
+		bc->refs++;
+	}
+	vmm_mutex_unlock(&bcctrl.cache_list_lock);
+
+	return bc;
+}
+
+static void blockcache_put_ref(struct vmm_blockcache *bc)
+{
+	vmm_mutex_lock(&bcctrl.cache_list_lock);
+	bc->refs--;
+	vmm_mutex_unlock(&bcctrl.cache_list_lock);
+}
+
+int vmm_blockcache_rw(struct vmm_blockdev *bdev,
+		      enum vmm_request_type type,
+		      u8 *buf, u64 off, u64 len, u64 *done)
+{
+	u64 bno, boff, blen;
+	struct blockcache_buf *b;
+	struct vmm_blockcache *bc;
+
+	bc = blockcache_get_ref(bdev);
+	if (!bc) {
+		return VMM_ENOTAVAIL;
+	}
+
+	/* Partition offset relative to whole block device */
+	off += (bdev->start_lba - bc->bdev->start_lba) * bdev->block_size;
+
+	*done = 0;
+	while (len) {
+		bno = udiv64(off, bc->buf_size);
+		boff = off - bno * bc->buf_size;
+
+		if (!boff && (len >= BLOCKCACHE_BYPASS_BUFFERS * bc->buf_size)) {
+			blen = udiv64(len, bc->buf_size);
+			if (blockcache_bypass(bc, type, buf, bno, blen)) {
+				break;
+			}
+			blen = blen * bc->buf_size;
+		} else {
+			blen = bc->buf_size - boff;
+			blen = (blen < len) ? blen : len;
+
+			vmm_mutex_lock(&bc->lock);
+
+			/* Fully overwritten buffer need not be read */
+			b = blockcache_get(bc, bno,
+				(type == VMM_REQUEST_READ) ||
+				(blen < bc->buf_size));
+			if (!b) {
+				vmm_mutex_unlock(&bc->lock);
+				break;
+			}
+
+			if (type == VMM_REQUEST_WRITE) {
+				memcpy(&b->data[boff], buf, blen);
+				blockcache_mark_dirty(bc, b);
+			} else {
+				memcpy(buf, &b->data[boff], blen);
+			}
+
+			vmm_mutex_unlock(&bc->lock);
+		}
+
+		buf += blen;
+		off += blen;
+		len -= blen;
+		*done += blen;
+	}
+
+	blockcache_put_ref(bc);
+
+	return VMM_OK;
+}
+
+static struct vmm_blockcache *blockcache_alloc(struct vmm_blockdev *bdev)
+{
+	u32 i, hash_size;
+	struct vmm_blockcache *bc;
+
+	bc = vmm_zalloc(sizeof(*bc));
+	if (!bc) {
+		return NULL;
+	}
+
+	INIT_LIST_HEAD(&bc->head);
+	bc->bdev = bdev;
+	bc->users = 1;
+	bc->refs = 0;
+	INIT_MUTEX(&bc->lock);
+	INIT_LIST_HEAD(&bc->lru_list);
+
+	/* Cache one page worth of blocks per buffer whenever
+	 * block device size allows it.
+	 */
+	bc->buf_blocks = 1;
+	if ((bdev->block_size < VMM_PAGE_SIZE) &&
+	    !(VMM_PAGE_SIZE % bdev->block_size) &&
+	    !umod64(bdev->num_blocks, VMM_PAGE_SIZE / bdev->block_size)) {
+		bc->buf_blocks = VMM_PAGE_SIZE / bdev->block_size;
+	}
+	bc->buf_size = bc->buf_blocks * bdev->block_size;
+	bc->buf_count = (CONFIG_BLOCK_CACHE_SIZE_KB * 1024) / bc->buf_size;
+	if (bc->buf_count < BLOCKCACHE_MIN_BUFFERS) {
+		bc->buf_count = BLOCKCACHE_MIN_BUFFERS;
+	}
+
+	bc->buf_pages = VMM_SIZE_TO_PAGE((u64)bc->buf_count * bc->buf_size);
+	bc->buf_va = vmm_host_alloc_pages(bc->buf_pages,
+					  VMM_MEMORY_FLAGS_NORMAL);
+	if (!bc->buf_va) {
+		goto fail;
+	}
+
+	bc->bufs = vmm_zalloc(bc->buf_count * sizeof(*bc->bufs));
+	if (!bc->bufs) {
+		goto fail_free_pages;
+	}
+
+	hash_size = 1;
+	while (hash_size < bc->buf_count) {
+		hash_size <<= 1;
+	}
+	bc->hash_mask = hash_size - 1;
+	bc->hash = vmm_malloc(hash_size * sizeof(*bc->hash));
+	if (!bc->hash) {
+		goto fail_free_bufs;
+	}
+	for (i = 0; i < hash_size; i++) {
+		INIT_LIST_HEAD(&bc->hash[i]);
+	}
+
+	for (i = 0; i < bc->buf_count; i++) {
+		INIT_LIST_HEAD(&bc->bufs[i].hash_head);
+		INIT_LIST_HEAD(&bc->bufs[i].lru_head);
+		bc->bufs[i].data = (u8 *)bc->buf_va + i * bc->buf_size;
+		list_add_tail(&bc->bufs[i].lru_head, &bc->lru_list);
+	}
+
+	return bc;
+
+fail_free_bufs:
+	vmm_free(bc->bufs);
+fail_free_pages:
+	vmm_host_free_pages(bc->buf_va, bc->buf_pages);
+fail:
+	vmm_free(bc);
+	return NULL;
+}
+
+static void blockcache_free(struct vmm_blockcache *bc)
+{
+	vmm_free(bc->hash);
+	vmm_free(bc->bufs);
+	vmm_host_free_pages(bc->buf_va, bc->buf_pages);
+	vmm_free(bc);
+}
+
+/* Unlink buffer cache from block device with cache list lock held */
+static void blockcache_unlink(struct vmm_blockcache *bc)
+{
+	list_del(&bc->head);
+	bc->bdev->cache = NULL;
+}
+
+/* Wait for remaining users then write back and free unlinked cache */
+static int blockcache_destroy(struct vmm_blockcache *bc)
+{
+	int rc;
+	u32 refs;
+
+	while (1) {
+		vmm_mutex_lock(&bcctrl.cache_list_lock);
+		refs = bc->refs;
+		vmm_mutex_unlock(&bcctrl.cache_list_lock);
+		if (!refs) {
+			break;
+		}
+		vmm_msleep(1);
+	}
+
+	vmm_mutex_lock(&bc->lock);
+	rc = blockcache_sync(bc);
+	vmm_mutex_unlock(&bc->lock);
+
+	blockcache_free(bc);
+
+	return rc;
+}
+
+int vmm_blockcache_enable(struct vmm_blockdev *bdev)
+{
+	int rc = VMM_OK;
+	struct vmm_blockcache *bc;
+
+	if (!bdev || !bdev->block_size || !bdev->num_blocks) {
+		return VMM_EINVALID;
+	}
+	bdev = blockcache_root(bdev);
+
+	vmm_mutex_lock(&bcctrl.cache_list_lock);
+
+	if (bdev->cache) {
+		bdev->cache->users++;
+		goto done;
+	}
+
+	bc = blockcache_alloc(bdev);
+	if (!bc) {
+		rc = VMM_ENOMEM;
+		goto done;
+	}
+
+	list_add_tail(&bc->head, &bcctrl.cache_list);
+	bdev->cache = bc;
+
+done:
+	vmm_mutex_unlock(&bcctrl.cache_list_lock);
+
+	return rc;
+}
+VMM_EXPORT_SYMBOL(vmm_blockcache_enable);
+
+int vmm_blockcache_disable(struct vmm_blockdev *bdev)
+{
+	struct vmm_blockcache *bc = NULL;
+
+	if (!bdev) {
+		return VMM_EINVALID;
+	}
+	bdev = blockcache_root(bdev);
+
+	vmm_mutex_lock(&bcctrl.cache_list_lock);
+
+	/* Buffer cache might be already released by unregister */
+	if (bdev->cache) {
+		bdev->cache->users--;
+		if (!bdev->cache->users) {
+			bc = bdev->cache;
+			blockcache_unlink(bc);
+		}
+	}
+
+	vmm_mutex_unlock(&bcctrl.cache_list_lock);
+
+	return (bc) ? blockcache_destroy(bc) : VMM_OK;
+}
+VMM_EXPORT_SYMBOL(vmm_blockcache_disable);
+
+int vmm_blockcache_sync(struct vmm_blockdev *bdev)
+{
+	int rc;
+	struct vmm_blockcache *bc;
+
+	if (!bdev) {
+		return VMM_EINVALID;
+	}
+
+	bc = blockcache_get_ref(bdev);
+	if (!bc) {
+		return VMM_OK;
+	}
+
+	vmm_mutex_lock(&bc->lock);
+	rc = blockcache_sync(bc);
+	vmm_mutex_unlock(&bc->lock);
+
+	blockcache_put_ref(bc);
+
+	return rc;
+}
+VMM_EXPORT_SYMBOL(vmm_blockcache_sync);
+
+void vmm_blockcache_release(struct vmm_blockdev *bdev)
+{
+	struct vmm_blockcache *bc;
+
+	/* Only whole block device owns a buffer cache */
+	if (!bdev || bdev->parent) {
+		return;
+	}
+
+	vmm_mutex_lock(&bcctrl.cache_list_lock);
+	bc = bdev->cache;
+	if (bc) {
+		blockcache_unlink(bc);
+	}
+	vmm_mutex_unlock(&bcctrl.cache_list_lock);
+
+	if (bc) {
+		blockcache_destroy(bc);
+	}
+}
+
+int vmm_blockcache_get_stats(struct vmm_blockdev *bdev,
+			     struct vmm_blockcache_stats *stats)
+{
+	struct vmm_blockcache *bc;
+
+	if (!bdev || !stats) {
+		return VMM_EINVALID;
+	}
+
+	bc = blockcache_get_ref(bdev);
+	if (!bc) {
+		return VMM_ENOTAVAIL;
+	}
+
+	vmm_mutex_lock(&bc->lock);
+	memcpy(stats, &bc->stats, sizeof(*stats));
+	stats->buf_size = bc->buf_size;
+	stats->buf_count = bc->buf_count;
+	stats->dirty_count = bc->dirty_count;
+	stats->users = bc->users;
+	vmm_mutex_unlock(&bc->lock);
+
+	blockcache_put_ref(bc);
+
+	return VMM_OK;
+}
+VMM_EXPORT_SYMBOL(vmm_blockcache_get_stats);
+
+/* Get next buffer cache not yet written back in current flush round */
+static struct vmm_blockcache *blockcache_flush_next(void)
+{
+	struct vmm_blockcache *bc, *ret = NULL;
+
+	vmm_mutex_lock(&bcctrl.cache_list_lock);
+	list_for_each_entry(bc, &bcctrl.cache_list, head) {
+		if (bc->flush_gen != bcctrl.flush_gen) {
+			bc->flush_gen = bcctrl.flush_gen;
+			bc->refs++;
+			ret = bc;
+			break;
+		}
+	}
+	vmm_mutex_unlock(&bcctrl.cache_list_lock);
+
+	return ret;
+}
+
+static int blockcache_flush_main(void *data)
+{
+	u64 tstamp;
+	struct vmm_blockcache *bc;
+
+	while (1) {
+		tstamp = (u64)CONFIG_BLOCK_CACHE_FLUSH_MSECS * 1000000ULL;
+		vmm_completion_wait_timeout(&bcctrl.flush_cmpl, &tstamp);
+
+		vmm_mutex_lock(&bcctrl.cache_list_lock);
+		bcctrl.flush_gen++;
+		vmm_mutex_unlock(&bcctrl.cache_list_lock);
+
+		while ((bc = blockcache_flush_next())) {
+			vmm_mutex_lock(&bc->lock);
+			if (blockcache_sync(bc)) {
+				vmm_printf("%s: %s writeback failed\n",
+					   __func__, bc->bdev->name);
+			}
+			vmm_mutex_unlock(&bc->lock);
+			blockcache_put_ref(bc);
+		}
+	}
+
+	return VMM_OK;
+}
+
+int vmm_blockcache_init(void)
+{
+	int rc;
+
+	INIT_MUTEX(&bcctrl.cache_list_lock);
+	INIT_LIST_HEAD(&bcctrl.cache_list);
+	INIT_COMPLETION(&bcctrl.flush_cmpl);
+
+	bcctrl.flush_thread = vmm_threads_create("blkflush",
+						 blockcache_flush_main, NULL,
+						 BLOCKCACHE_PRIORITY,
+						 BLOCKCACHE_TIMESLICE);
+	if (!bcctrl.flush_thread) {
+		return VMM_EFAIL;
+	}
+
+	if ((rc = vmm_threads_start(bcctrl.flush_thread))) {
+		vmm_threads_destroy(bcctrl.flush_thread);
+		bcctrl.flush_thread = NULL;
+		return rc;
+	}
+
+	return VMM_OK;
+}
+
+void vmm_blockcache_exit(void)
+{
+	struct vmm_blockcache *bc;
+
+	if (bcctrl.flush_thread) {
+		vmm_threads_stop(bcctrl.flush_thread);
+		vmm_threads_destroy(bcctrl.flush_thread);
+		bcctrl.flush_thread = NULL;
+	}
+
+	while (1) {
+		vmm_mutex_lock(&bcctrl.cache_list_lock);
+		bc = NULL;
+		if (!list_empty(&bcctrl.cache_list)) {
+			bc = list_first_entry(&bcctrl.cache_list,
+					      struct vmm_blockcache, head);
+			blockcache_unlink(bc);
+		}
+		vmm_mutex_unlock(&bcctrl.cache_list_lock);
+		if (!bc) {
+			break;
+		}
+		blockcache_destroy(bc);
+	}
+}
@@ -25,12 +25,18 @@
 #include <vmm_heap.h>
 #include <vmm_stdio.h>
 #include <vmm_modules.h>
+#include <vmm_smp.h>
+#include <vmm_timer.h>
+#include <vmm_delay.h>
 #include <vmm_scheduler.h>
 #include <vmm_devdrv.h>
 #include <vmm_completion.h>
+#include <arch_cpu_irq.h>
 #include <block/vmm_blockdev.h>
+#include <block/vmm_blockcache.h>
 #include <libs/stringlib.h>
 #include <libs/mathlib.h>
+#include <libs/bitops.h>
 
 #define MODULE_DESC			"Block Device Framework"
 #define MODULE_AUTHOR			"Anup Patel"
@@ -39,8 +45,14 @@
 #define	MODULE_INIT			vmm_blockdev_init
 #define	MODULE_EXIT			vmm_blockdev_exit
 
+/* Max size of zero filled write used for emulating write zeroes */
+#define BLOCKDEV_ZEROES_CHUNK_SIZE	(64 * 1024)
+
 static BLOCKING_NOTIFIER_CHAIN(bdev_notifier_chain);
 
+/* Zero filled buffer which is only read by block devices */
+static u8 blockdev_zero_buf[BLOCKDEV_ZEROES_CHUNK_SIZE];
+
 int vmm_blockdev_register_client(struct vmm_notifier_block *nb)
 {
 	return vmm_blocking_notifier_register(&bdev_notifier_chain, nb);
@@ -53,6 +65,225 @@ int vmm_blockdev_unregister_client(struct vmm_notifier_block *nb)
 }
 VMM_EXPORT_SYMBOL(vmm_blockdev_unregister_client);
 
+struct vmm_blockdev_stats *vmm_blockdev_stats_alloc(void)
+{
+	void *ptr;
+	virtual_addr_t va;
+
+	/* Heap only guarantees u64 alignment so align per-CPU array
+	 * to cache line and save heap pointer just before it.
+	 */
+	ptr = vmm_zalloc(sizeof(struct vmm_blockdev_stats) *
+			 CONFIG_CPU_COUNT + VMM_CACHE_LINE_SIZE);
+	if (!ptr) {
+		return NULL;
+	}
+
+	va = VMM_CACHE_ALIGN((virtual_addr_t)ptr + sizeof(void *));
+	((void **)va)[-1] = ptr;
+
+	return (struct vmm_blockdev_stats *)va;
+}
+VMM_EXPORT_SYMBOL(vmm_blockdev_stats_alloc);
+
+void vmm_blockdev_stats_free(struct vmm_blockdev_stats *stats)
+{
+	if (stats) {
+		vmm_free(((void **)stats)[-1]);
+	}
+}
+VMM_EXPORT_SYMBOL(vmm_blockdev_stats_free);
+
+void vmm_blockdev_stats_start(struct vmm_blockdev_stats *stats)
+{
+	irq_flags_t flags;
+
+	if (!stats) {
+		return;
+	}
+
+	arch_cpu_irq_save(flags);
+	stats[vmm_smp_processor_id()].submitted++;
+	arch_cpu_irq_restore(flags);
+}
+VMM_EXPORT_SYMBOL(vmm_blockdev_stats_start);
+
+static inline u32 blockdev_stats_bucket(u64 nsecs)
+{
+	u32 b = fls64(udiv64(nsecs, 1000));
+
+	return (b < VMM_BLOCKDEV_STATS_HIST_BUCKETS) ?
+		b : (VMM_BLOCKDEV_STATS_HIST_BUCKETS - 1);
+}
+
+void vmm_blockdev_stats_done(struct vmm_blockdev_stats *stats,
+			     struct vmm_request *r, u64 bytes, bool failed)
+{
+	u32 dir;
+	irq_flags_t flags;
+	u64 now, issue, wait, service;
+	struct vmm_blockdev_stats *st;
+
+	if (!stats || !r) {
+		return;
+	}
+
+	/* Request never issued to request queue (for example emulated
+	 * write zeroes) is accounted as being serviced since submit.
+	 */
+	now = vmm_timer_timestamp();
+	issue = (r->issue_tstamp) ? r->issue_tstamp : r->submit_tstamp;
+	wait = (r->submit_tstamp < issue) ? (issue - r->submit_tstamp) : 0;
+	service = (issue < now) ? (now - issue) : 0;
+
+	dir = (r->type == VMM_REQUEST_READ) ?
+		VMM_BLOCKDEV_STATS_READ : VMM_BLOCKDEV_STATS_WRITE;
+	if ((r->type != VMM_REQUEST_READ) &&
+	    (r->type != VMM_REQUEST_WRITE)) {
+		bytes = 0;
+	}
+
+	arch_cpu_irq_save(flags);
+	st = &stats[vmm_smp_processor_id()];
+	st->completed++;
+	if (failed) {
+		st->errors[dir]++;
+	} else {
+		st->ops[dir]++;
+		st->bytes[dir] += bytes;
+		st->wait_nsecs[dir] += wait;
+		st->service_nsecs[dir] += service;
+		st->wait_hist[dir][blockdev_stats_bucket(wait)]++;
+		st->service_hist[dir][blockdev_stats_bucket(service)]++;
+	}
+	arch_cpu_irq_restore(flags);
+}
+VMM_EXPORT_SYMBOL(vmm_blockdev_stats_done);
+
+void vmm_blockdev_stats_sum(struct vmm_blockdev_stats *stats,
+			    struct vmm_blockdev_stats *out)
+{
+	u32 c, d, b;
+	struct vmm_blockdev_stats *st;
+
+	if (!out) {
+		return;
+	}
+
+	memset(out, 0, sizeof(*out));
+	if (!stats) {
+		return;
+	}
+
+	for (c = 0; c < CONFIG_CPU_COUNT; c++) {
+		st = &stats[c];
+		out->submitted += st->submitted;
+		out->completed += st->completed;
+		for (d = 0; d < VMM_BLOCKDEV_STATS_DIR_COUNT; d++) {
+			out->ops[d] += st->ops[d];
+			out->bytes[d] += st->bytes[d];
+			out->errors[d] += st->errors[d];
+			out->wait_nsecs[d] += st->wait_nsecs[d];
+			out->service_nsecs[d] += st->service_nsecs[d];
+			for (b = 0; b < VMM_BLOCKDEV_STATS_HIST_BUCKETS; b++) {
+				out->wait_hist[d][b] += st->wait_hist[d][b];
+				out->service_hist[d][b] +=
+						st->service_hist[d][b];
+			}
+		}
+	}
+}
+VMM_EXPORT_SYMBOL(vmm_blockdev_stats_sum);
+
+static u64 blockdev_stats_avg_usecs(u64 nsecs, u64 ops)
+{
+	return (ops) ? udiv64(udiv64(nsecs, ops), 1000) : 0;
+}
+
+int vmm_blockdev_stats_print(struct vmm_chardev *cdev,
+			     struct vmm_blockdev_stats *stats)
+{
+	u32 b;
+	char range[32];
+	const u32 r = VMM_BLOCKDEV_STATS_READ;
+	const u32 w = VMM_BLOCKDEV_STATS_WRITE;
+
+	if (!stats) {
+		return VMM_EINVALID;
+	}
+
+	vmm_cprintf(cdev, "In-flight   : %"PRIu64"\n",
+		    vmm_blockdev_stats_in_flight(stats));
+	vmm_cprintf(cdev, "%-12s %20s %20s\n", "", "Read", "Write");
+	vmm_cprintf(cdev, "%-12s %20"PRIu64" %20"PRIu64"\n",
+		    "Ops", stats->ops[r], stats->ops[w]);
+	vmm_cprintf(cdev, "%-12s %20"PRIu64" %20"PRIu64"\n",
+		    "Bytes", stats->bytes[r], stats->bytes[w]);
+	vmm_cprintf(cdev, "%-12s %20"PRIu64" %20"PRIu64"\n",
+		    "Errors", stats->errors[r], stats->errors[w]);
+	vmm_cprintf(cdev, "%-12s %20"PRIu64" %20"PRIu64"\n",
+		    "Avg Wait us",
+		    blockdev_stats_avg_usecs(stats->wait_nsecs[r],
+					     stats->ops[r]),
+		    blockdev_stats_avg_usecs(stats->wait_nsecs[w],
+					     stats->ops[w]));
+	vmm_cprintf(cdev, "%-12s %20"PRIu64" %20"PRIu64"\n",
+		    "Avg Svc us",
+		    blockdev_stats_avg_usecs(stats->service_nsecs[r],
+					     stats->ops[r]),
+		    blockdev_stats_avg_usecs(stats->service_nsecs[w],
+					     stats->ops[w]));
+
+	vmm_cprintf(cdev, "\n%-16s %14s %14s %14s %14s\n", "Latency (us)",
+		    "Read Wait", "Read Svc", "Write Wait", "Write Svc");
+	for (b = 0; b < VMM_BLOCKDEV_STATS_HIST_BUCKETS; b++) {
+		if (!stats->wait_hist[r][b] && !stats->service_hist[r][b] &&
+		    !stats->wait_hist[w][b] && !stats->service_hist[w][b]) {
+			continue;
+		}
+		if (!b) {
+			vmm_snprintf(range, sizeof(range), "< 1");
+		} else if (b == (VMM_BLOCKDEV_STATS_HIST_BUCKETS - 1)) {
+			vmm_snprintf(range, sizeof(range), ">= %u",
+				     1U << (b - 1));
+		} else {
+			vmm_snprintf(range, sizeof(range), "%u - %u",
+				     1U << (b - 1), (1U << b) - 1);
+		}
+		vmm_cprintf(cdev, "%-16s %14"PRIu64" %14"PRIu64" "
+			    "%14"PRIu64" %14"PRIu64"\n", range,
+			    stats->wait_hist[r][b], stats->service_hist[r][b],
+			    stats->wait_hist[w][b], stats->service_hist[w][b]);
+	}
+
+	return VMM_OK;
+}
+VMM_EXPORT_SYMBOL(vmm_blockdev_stats_print);
+
+int vmm_blockdev_get_stats(struct vmm_blockdev *bdev,
+			   struct vmm_blockdev_stats *out)
+{
+	if (!bdev || !out) {
+		return VMM_EINVALID;
+	}
+
+	vmm_blockdev_stats_sum(bdev->stats, out);
+
+	return VMM_OK;
+}
+VMM_EXPORT_SYMBOL(vmm_blockdev_get_stats);
+
+static void blockdev_stats_done(struct vmm_request *r, bool failed)
+{
+	if (!(r->flags & VMM_REQUEST_FLAG_STATS)) {
+		return;
+	}
+	r->flags &= ~VMM_REQUEST_FLAG_STATS;
+
+	vmm_blockdev_stats_done(r->bdev->stats, r,
+				(u64)r->bcnt * r->bdev->block_size, failed);
+}
+
 static int __blockdev_make_request(struct vmm_blockdev *bdev,
 				   struct vmm_request *r,
 				   bool append_backlog)
@@ -62,8 +293,10 @@ static int __blockdev_make_request(struct vmm_blockdev *bdev,
 
 	INIT_LIST_HEAD(&r->head);
 	r->bdev = bdev;
+	r->flags &= ~VMM_REQUEST_FLAG_BACKLOG;
 
 	if (rq->pending_count < rq->max_pending) {
+		r->issue_tstamp = vmm_timer_timestamp();
 		rc = rq->make_request(rq, r);
 		if (!rc) {
 			rq->pending_count++;
@@ -75,6 +308,7 @@ static int __blockdev_make_request(struct vmm_blockdev *bdev,
 			list_add(&r->head, &rq->backlog_list);
 		}
 		rq->backlog_count++;
+		r->flags |= VMM_REQUEST_FLAG_BACKLOG;
 	} else {
 		rc = VMM_ENOSPC;
 	}
@@ -86,28 +320,50 @@ static int __blockdev_make_request(struct vmm_blockdev *bdev,
 	return rc;
 }
 
-static void __blockdev_done_request(struct vmm_request_queue *rq)
+/* Backlog requests rejected by make_request() are moved to
+ * failed list which must be passed to blockdev_fail_list()
+ * after releasing request queue lock.
+ */
+static void __blockdev_done_request(struct vmm_request_queue *rq,
+				    struct dlist *failed)
 {
-	int rc = VMM_OK;
 	struct vmm_request *r;
+	struct vmm_blockdev *bdev;
 
 	if (rq->pending_count) {
 		rq->pending_count--;
 	}
 
-	if (list_empty(&rq->backlog_list)) {
-		return;
+	while (!list_empty(&rq->backlog_list) &&
+	       (rq->pending_count < rq->max_pending)) {
+		r = list_first_entry(&rq->backlog_list,
+				     struct vmm_request, head);
+		list_del(&r->head);
+		rq->backlog_count--;
+
+		bdev = r->bdev;
+		if (__blockdev_make_request(bdev, r, FALSE)) {
+			r->flags &= ~VMM_REQUEST_FLAG_BACKLOG;
+			r->bdev = bdev;
+			list_add_tail(&r->head, failed);
+		}
 	}
+}
 
-	r = list_first_entry(&rq->backlog_list, struct vmm_request, head);
-	list_del(&r->head);
-	rq->backlog_count--;
+/* Fail requests which were never issued to request queue */
+static void blockdev_fail_list(struct dlist *failed)
+{
+	struct vmm_request *r;
 
-	rc = __blockdev_make_request(r->bdev, r, FALSE);
-	if (rc) {
-		vmm_printf("%s: bdev=%p failed with error %d\n",
-			   __func__, r->bdev, rc);
-		WARN_ON(1);
+	while (!list_empty(failed)) {
+		r = list_first_entry(failed, struct vmm_request, head);
+		list_del(&r->head);
+
+		blockdev_stats_done(r, TRUE);
+		if (r->failed) {
+			r->failed(r);
+		}
+		r->bdev = NULL;
 	}
 }
 
@@ -115,19 +371,22 @@ int vmm_blockdev_complete_request(struct vmm_request *r)
 {
 	irq_flags_t flags;
 	struct vmm_request_queue *rq;
+	LIST_HEAD(failed);
 
 	if (!r || !r->bdev || !r->bdev->rq) {
 		return VMM_EINVALID;
 	}
 	rq = r->bdev->rq;
 
+	blockdev_stats_done(r, FALSE);
 	if (r->completed) {
 		r->completed(r);
 	}
 	vmm_spin_lock_irqsave(&rq->lock, flags);
-	__blockdev_done_request(rq);
+	__blockdev_done_request(rq, &failed);
 	vmm_spin_unlock_irqrestore(&rq->lock, flags);
 	r->bdev = NULL;
+	blockdev_fail_list(&failed);
 
 	return VMM_OK;
 }
@@ -137,24 +396,245 @@ int vmm_blockdev_fail_request(struct vmm_request *r)
 {
 	irq_flags_t flags;
 	struct vmm_request_queue *rq;
+	LIST_HEAD(failed);
 
 	if (!r || !r->bdev || !r->bdev->rq) {
 		return VMM_EINVALID;
 	}
 	rq = r->bdev->rq;
 
+	blockdev_stats_done(r, TRUE);
 	if (r->failed) {
 		r->failed(r);
 	}
 	vmm_spin_lock_irqsave(&rq->lock, flags);
-	__blockdev_done_request(rq);
+	__blockdev_done_request(rq, &failed);
 	vmm_spin_unlock_irqrestore(&rq->lock, flags);
 	r->bdev = NULL;
+	blockdev_fail_list(&failed);
 
 	return VMM_OK;
 }
 VMM_EXPORT_SYMBOL(vmm_blockdev_fail_request);
 
+/* Protects association of write zeroes state with request */
+static DEFINE_SPINLOCK(blockdev_zeroes_lock);
+
+struct blockdev_zeroes {
+	vmm_spinlock_t lock;
+	u32 ref_count;
+	struct vmm_completion done;
+	struct vmm_blockdev *bdev;
+	struct vmm_request *r;
+	struct vmm_request sub;
+	u64 lba;
+	u64 bcnt;
+	u32 chunk_bcnt;
+	bool submitting;
+	bool sub_done;
+	bool failed;
+	bool aborted;
+};
+
+static struct blockdev_zeroes *blockdev_zeroes_get(struct vmm_request *r)
+{
+	irq_flags_t flags;
+	struct blockdev_zeroes *z;
+
+	vmm_spin_lock_irqsave(&blockdev_zeroes_lock, flags);
+	z = r->fallback;
+	if (z) {
+		z->ref_count++;
+	}
+	vmm_spin_unlock_irqrestore(&blockdev_zeroes_lock, flags);
+
+	return z;
+}
+
+static void blockdev_zeroes_put(struct blockdev_zeroes *z)
+{
+	bool release;
+	irq_flags_t flags;
+
+	vmm_spin_lock_irqsave(&blockdev_zeroes_lock, flags);
+	release = (--z->ref_count) ? FALSE : TRUE;
+	vmm_spin_unlock_irqrestore(&blockdev_zeroes_lock, flags);
+
+	if (release) {
+		vmm_free(z);
+	}
+}
+
+static void blockdev_zeroes_finish(struct blockdev_zeroes *z)
+{
+	irq_flags_t flags;
+	bool failed = (z->failed || z->aborted) ? TRUE : FALSE;
+	struct vmm_request *r = z->r;
+
+	vmm_spin_lock_irqsave(&blockdev_zeroes_lock, flags);
+	r->fallback = NULL;
+	r->bdev = NULL;
+	vmm_spin_unlock_irqrestore(&blockdev_zeroes_lock, flags);
+
+	if (failed) {
+		if (r->failed) {
+			r->failed(r);
+		}
+	} else {
+		if (r->completed) {
+			r->completed(r);
+		}
+	}
+
+	/* Request is not touched after this point */
+	vmm_completion_complete(&z->done);
+	blockdev_zeroes_put(z);
+}
+
+static void blockdev_zeroes_run(struct blockdev_zeroes *z)
+{
+	int rc;
+	bool cont;
+	irq_flags_t flags;
+
+	while (1) {
+		vmm_spin_lock_irqsave(&z->lock, flags);
+
+		if (z->aborted || z->failed || !z->bcnt) {
+			vmm_spin_unlock_irqrestore(&z->lock, flags);
+			blockdev_zeroes_finish(z);
+			return;
+		}
+
+		z->sub.type = VMM_REQUEST_WRITE;
+		z->sub.flags = z->r->flags;
+		z->sub.lba = z->lba;
+		z->sub.bcnt = (z->bcnt < z->chunk_bcnt) ?
+						z->bcnt : z->chunk_bcnt;
+		z->sub.data = blockdev_zero_buf;
+		z->lba += z->sub.bcnt;
+		z->bcnt -= z->sub.bcnt;
+		z->sub_done = FALSE;
+		z->submitting = TRUE;
+
+		vmm_spin_unlock_irqrestore(&z->lock, flags);
+
+		rc = vmm_blockdev_submit_request(z->bdev, &z->sub);
+
+		vmm_spin_lock_irqsave(&z->lock, flags);
+		z->submitting = FALSE;
+		if (rc) {
+			z->failed = TRUE;
+		}
+		cont = (rc || z->sub_done) ? TRUE : FALSE;
+		vmm_spin_unlock_irqrestore(&z->lock, flags);
+
+		/* Chain continues from completion of sub-request */
+		if (!cont) {
+			return;
+		}
+	}
+}
+
+static void blockdev_zeroes_sub_done(struct vmm_request *sub, bool failed)
+{
+	bool cont;
+	irq_flags_t flags;
+	struct blockdev_zeroes *z = sub->priv;
+
+	vmm_spin_lock_irqsave(&z->lock, flags);
+	z->sub_done = TRUE;
+	if (failed) {
+		z->failed = TRUE;
+	}
+	cont = (z->submitting) ? FALSE : TRUE;
+	vmm_spin_unlock_irqrestore(&z->lock, flags);
+
+	if (cont) {
+		blockdev_zeroes_run(z);
+	}
+}
+
+static void blockdev_zeroes_sub_completed(struct vmm_request *sub)
+{
+	blockdev_zeroes_sub_done(sub, FALSE);
+}
+
+static void blockdev_zeroes_sub_failed(struct vmm_request *sub)
+{
+	blockdev_zeroes_sub_done(sub, TRUE);
+}
+
+static int blockdev_zeroes_start(struct vmm_blockdev *bdev,
+				 struct vmm_request *r)
+{
+	irq_flags_t flags;
+	struct blockdev_zeroes *z;
+
+	if (BLOCKDEV_ZEROES_CHUNK_SIZE < bdev->block_size) {
+		return VMM_EINVALID;
+	}
+
+	z = vmm_zalloc(sizeof(*z));
+	if (!z) {
+		return VMM_ENOMEM;
+	}
+
+	INIT_SPIN_LOCK(&z->lock);
+	z->ref_count = 1;
+	INIT_COMPLETION(&z->done);
+	z->bdev = bdev;
+	z->r = r;
+	z->lba = r->lba;
+	z->bcnt = r->bcnt;
+	z->chunk_bcnt = udiv32(BLOCKDEV_ZEROES_CHUNK_SIZE, bdev->block_size);
+	z->sub.completed = blockdev_zeroes_sub_completed;
+	z->sub.failed = blockdev_zeroes_sub_failed;
+	z->sub.priv = z;
+
+	vmm_spin_lock_irqsave(&blockdev_zeroes_lock, flags);
+	r->bdev = bdev;
+	r->fallback = z;
+	vmm_spin_unlock_irqrestore(&blockdev_zeroes_lock, flags);
+
+	blockdev_zeroes_run(z);
+
+	return VMM_OK;
+}
+
+/* Abort returns only after request is failed (or completed) because
+ * caller is free to release the request afterwards.
+ */
+static int blockdev_zeroes_abort(struct blockdev_zeroes *z)
+{
+	bool pending;
+	irq_flags_t flags;
+
+	vmm_spin_lock_irqsave(&z->lock, flags);
+	z->aborted = TRUE;
+	pending = (!z->sub_done && !z->submitting) ? TRUE : FALSE;
+	vmm_spin_unlock_irqrestore(&z->lock, flags);
+
+	/* Failure of aborted sub-request will fail the request otherwise
+	 * the chain notices abort after in-flight sub-request is done.
+	 */
+	if (pending) {
+		vmm_blockdev_abort_request(&z->sub);
+	}
+
+	if (vmm_scheduler_orphan_context()) {
+		vmm_completion_wait(&z->done);
+	} else {
+		while (!vmm_completion_done(&z->done)) {
+			vmm_udelay(1);
+		}
+	}
+
+	blockdev_zeroes_put(z);
+
+	return VMM_OK;
+}
+
 int vmm_blockdev_submit_request(struct vmm_blockdev *bdev,
 				struct vmm_request *r)
 {
@@ -168,7 +648,12 @@ int vmm_blockdev_submit_request(struct vmm_blockdev *bdev,
 	}
 	rq = bdev->rq;
 
-	if ((r->type == VMM_REQUEST_WRITE) &&
+	r->fallback = NULL;
+	r->flags &= ~(VMM_REQUEST_FLAG_STATS | VMM_REQUEST_FLAG_BACKLOG);
+	r->submit_tstamp = vmm_timer_timestamp();
+	r->issue_tstamp = 0;
+
+	if ((r->type != VMM_REQUEST_READ) &&
 	   !(bdev->flags & VMM_BLOCKDEV_RW)) {
 		rc = VMM_EINVALID;
 		goto failed;
@@ -188,11 +673,42 @@ int vmm_blockdev_submit_request(struct vmm_blockdev *bdev,
 		goto failed;
 	}
 
+	switch (r->type) {
+	case VMM_REQUEST_READ:
+	case VMM_REQUEST_WRITE:
+		break;
+	case VMM_REQUEST_DISCARD:
+		/* Discard is only a hint so nothing to do */
+		if (!(bdev->flags & VMM_BLOCKDEV_DISCARD)) {
+			if (r->completed) {
+				r->completed(r);
+			}
+			return VMM_OK;
+		}
+		break;
+	case VMM_REQUEST_WRITE_ZEROES:
+		if (!(bdev->flags & VMM_BLOCKDEV_WRITE_ZEROES)) {
+			rc = blockdev_zeroes_start(bdev, r);
+			if (rc) {
+				goto failed;
+			}
+			return VMM_OK;
+		}
+		break;
+	default:
+		rc = VMM_EINVALID;
+		goto failed;
+	};
+
 	if (rq->make_request) {
+		r->flags |= VMM_REQUEST_FLAG_STATS;
+		vmm_blockdev_stats_start(bdev->stats);
 		vmm_spin_lock_irqsave(&rq->lock, flags);
 		rc = __blockdev_make_request(bdev, r, TRUE);
 		vmm_spin_unlock_irqrestore(&rq->lock, flags);
 		if (rc) {
+			r->flags &= ~VMM_REQUEST_FLAG_STATS;
+			vmm_blockdev_stats_done(bdev->stats, r, 0, TRUE);
 			return rc;
 		}
 	} else {
@@ -211,18 +727,49 @@ VMM_EXPORT_SYMBOL(vmm_blockdev_submit_request);
 int vmm_blockdev_abort_request(struct vmm_request *r)
 {
 	int rc;
+	bool backlog;
 	irq_flags_t flags;
+	struct vmm_request_queue *rq;
 	struct vmm_blockdev *bdev;
+	struct blockdev_zeroes *z;
+	LIST_HEAD(failed);
 
 	if (!r || !r->bdev || !r->bdev->rq) {
 		return VMM_EFAIL;
 	}
 	bdev = r->bdev;
+	rq = bdev->rq;
 
-	if (bdev->rq->abort_request) {
-		vmm_spin_lock_irqsave(&bdev->rq->lock, flags);
-		rc = bdev->rq->abort_request(bdev->rq, r);
-		vmm_spin_unlock_irqrestore(&bdev->rq->lock, flags);
+	z = blockdev_zeroes_get(r);
+	if (z) {
+		return blockdev_zeroes_abort(z);
+	}
+	if ((r->type == VMM_REQUEST_WRITE_ZEROES) &&
+	    !(bdev->flags & VMM_BLOCKDEV_WRITE_ZEROES)) {
+		/* Emulated write zeroes already finished */
+		return VMM_EFAIL;
+	}
+
+	vmm_spin_lock_irqsave(&rq->lock, flags);
+	backlog = (r->flags & VMM_REQUEST_FLAG_BACKLOG) ? TRUE : FALSE;
+	if (backlog) {
+		/* Request queue has not seen backlog request so
+		 * it does not hold any pending slot.
+		 */
+		r->flags &= ~VMM_REQUEST_FLAG_BACKLOG;
+		list_del(&r->head);
+		rq->backlog_count--;
+		list_add_tail(&r->head, &failed);
+	}
+	vmm_spin_unlock_irqrestore(&rq->lock, flags);
+
+	if (backlog) {
+		blockdev_fail_list(&failed);
+		return VMM_OK;
+	}
+
+	if (rq->abort_request) {
+		rc = rq->abort_request(rq, r);
 		if (rc) {
 			return rc;
 		}
@@ -284,15 +831,16 @@ static void blockdev_rw_failed(struct vmm_request *req)
 	vmm_completion_complete(&rw->done);
 }
 
-static int blockdev_rw_blocks(struct vmm_blockdev *bdev,
-				enum vmm_request_type type,
-				u8 *buf, u64 lba, u64 bcnt)
+int vmm_blockdev_rw_blocks(struct vmm_blockdev *bdev,
+			   enum vmm_request_type type,
+			   u8 *buf, u64 lba, u64 bcnt)
 {
 	int rc;
 	struct blockdev_rw rw;
 
 	rw.failed = FALSE;
 	rw.req.type = type;
+	rw.req.flags = 0;
 	rw.req.lba = bdev->start_lba + lba;
 	rw.req.bcnt = bcnt;
 	rw.req.data = buf;
@@ -313,6 +861,7 @@ static int blockdev_rw_blocks(struct vmm_blockdev *bdev,
 
 	return VMM_OK;
 }
+VMM_EXPORT_SYMBOL(vmm_blockdev_rw_blocks);
 
 u64 vmm_blockdev_rw(struct vmm_blockdev *bdev,
 			enum vmm_request_type type,
@@ -344,6 +893,10 @@ u64 vmm_blockdev_rw(struct vmm_blockdev *bdev,
 		return 0;
 	}
 
+	if (!vmm_blockcache_rw(bdev, type, buf, off, len, &tmp)) {
+		return tmp;
+	}
+
 	first_lba = udiv64(off, bdev->block_size);
 	first_off = off - first_lba * bdev->block_size;
 	if (first_off) {
@@ -379,14 +932,14 @@ u64 vmm_blockdev_rw(struct vmm_blockdev *bdev,
 	tmp = 0;
 
 	if (first_len) {
-		if (blockdev_rw_blocks(bdev, VMM_REQUEST_READ,
+		if (vmm_blockdev_rw_blocks(bdev, VMM_REQUEST_READ,
 					tbuf, first_lba, 1)) {
 			goto done;
 		}
 
 		if (type == VMM_REQUEST_WRITE) {
 			memcpy(&tbuf[first_off], buf, first_len);
-			if (blockdev_rw_blocks(bdev, VMM_REQUEST_WRITE,
+			if (vmm_blockdev_rw_blocks(bdev, VMM_REQUEST_WRITE,
 					tbuf, first_lba, 1)) {
 				goto done;
 			}
@@ -399,7 +952,7 @@ u64 vmm_blockdev_rw(struct vmm_blockdev *bdev,
 	}
 
 	if (middle_len) {
-		if (blockdev_rw_blocks(bdev, type,
+		if (vmm_blockdev_rw_blocks(bdev, type,
 		buf, middle_lba, udiv64(middle_len, bdev->block_size))) {
 			goto done;
 		}
@@ -409,14 +962,14 @@ u64 vmm_blockdev_rw(struct vmm_blockdev *bdev,
 	}
 
 	if (last_len) {
-		if (blockdev_rw_blocks(bdev, VMM_REQUEST_READ,
+		if (vmm_blockdev_rw_blocks(bdev, VMM_REQUEST_READ,
 					tbuf, last_lba, 1)) {
 			goto done;
 		}
 
 		if (type == VMM_REQUEST_WRITE) {
 			memcpy(&tbuf[0], buf, last_len);
-			if (blockdev_rw_blocks(bdev, VMM_REQUEST_WRITE,
+			if (vmm_blockdev_rw_blocks(bdev, VMM_REQUEST_WRITE,
 					tbuf, last_lba, 1)) {
 				goto done;
 			}
@@ -450,6 +1003,13 @@ struct vmm_blockdev *vmm_blockdev_alloc(void)
 	bdev->child_count = 0;
 	INIT_LIST_HEAD(&bdev->child_list);
 	bdev->rq = NULL;
+	bdev->cache = NULL;
+
+	bdev->stats = vmm_blockdev_stats_alloc();
+	if (!bdev->stats) {
+		vmm_free(bdev);
+		return NULL;
+	}
 
 	return bdev;
 }
@@ -457,6 +1017,11 @@ VMM_EXPORT_SYMBOL(vmm_blockdev_alloc);
 
 void vmm_blockdev_free(struct vmm_blockdev *bdev)
 {
+	if (!bdev) {
+		return;
+	}
+
+	vmm_blockdev_stats_free(bdev->stats);
 	vmm_free(bdev);
 }
 VMM_EXPORT_SYMBOL(vmm_blockdev_free);
@@ -525,6 +1090,9 @@ int vmm_blockdev_add_child(struct vmm_blockdev *bdev,
 	}
 
 	child_bdev = vmm_blockdev_alloc();
+	if (!child_bdev) {
+		return VMM_ENOMEM;
+	}
 	child_bdev->parent = bdev;
 	child_bdev->dev.parent = &bdev->dev;
 	vmm_mutex_lock(&bdev->child_lock);
@@ -591,6 +1159,9 @@ int vmm_blockdev_unregister(struct vmm_blockdev *bdev)
 				   VMM_BLOCKDEV_EVENT_UNREGISTER,
 				   &event);
 
+	/* Write back and drop buffer cache */
+	vmm_blockcache_release(bdev);
+
 	return vmm_devdrv_unregister_device(&bdev->dev);
 }
 VMM_EXPORT_SYMBOL(vmm_blockdev_unregister);
@@ -647,13 +1218,27 @@ VMM_EXPORT_SYMBOL(vmm_blockdev_count);
 
 static int __init vmm_blockdev_init(void)
 {
+	int rc;
+
 	vmm_printf("init: block device framework\n");
 
-	return vmm_devdrv_register_class(&bdev_class);
+	rc = vmm_devdrv_register_class(&bdev_class);
+	if (rc) {
+		return rc;
+	}
+
+	rc = vmm_blockcache_init();
+	if (rc) {
+		vmm_devdrv_unregister_class(&bdev_class);
+		return rc;
+	}
+
+	return VMM_OK;
 }
 
 static void __exit vmm_blockdev_exit(void)
 {
+	vmm_blockcache_exit();
 	vmm_devdrv_unregister_class(&bdev_class);
 }
 
@@ -26,9 +26,19 @@
 #include <vmm_limits.h>
 #include <vmm_heap.h>
 #include <vmm_stdio.h>
+#include <vmm_timer.h>
+#include <vmm_delay.h>
+#include <vmm_threads.h>
 #include <vmm_modules.h>
+#include <vmm_scheduler.h>
+#include <vmm_completion.h>
 #include <vmm_host_aspace.h>
 #include <block/vmm_blockrq.h>
+#include <libs/stringlib.h>
+
+/* Deadline (in nanoseconds) of read/write requests */
+#define BLOCKRQ_READ_EXPIRE_NSECS	(500ULL * 1000000ULL)
+#define BLOCKRQ_WRITE_EXPIRE_NSECS	(5000ULL * 1000000ULL)
 
 struct blockrq_work {
 	struct vmm_blockrq *brq;
@@ -46,8 +56,160 @@ struct blockrq_work {
 		} w;
 	} d;
 	bool is_free;
+
+	/* Scheduler state of read/write work */
+	struct dlist sort_head;
+	struct dlist fifo_head;
+	u64 tstamp;
+	u64 deadline;
+	bool in_flight;
+	bool aborted;
+	bool fua_pending;
+	/* Completed when worker releases aborted in-flight work */
+	struct vmm_completion *released;
+};
+
+static const char *blockrq_sched_names[VMM_BLOCKRQ_SCHED_MAX] = {
+	[VMM_BLOCKRQ_SCHED_NOOP] = "noop",
+	[VMM_BLOCKRQ_SCHED_DEADLINE] = "deadline",
 };
 
+/* Note: Must be called with brq->wq_lock held */
+static void blockrq_sched_add(struct vmm_blockrq *brq,
+			      struct blockrq_work *bwork)
+{
+	struct blockrq_work *bw;
+	struct dlist *pos = &brq->sched_sort_list;
+	u64 lba = bwork->d.rw.r->lba;
+
+	/* Keep sort list in ascending LBA order. Scan from tail
+	 * because sequential requests mostly go at the tail.
+	 */
+	list_for_each_entry_reverse(bw, &brq->sched_sort_list, sort_head) {
+		if (bw->d.rw.r->lba <= lba) {
+			pos = &bw->sort_head;
+			break;
+		}
+	}
+	list_add(&bwork->sort_head, pos);
+	list_add_tail(&bwork->fifo_head, &brq->sched_fifo_list);
+	brq->sched_count++;
+}
+
+/* Note: Must be called with brq->wq_lock held */
+static bool blockrq_sched_can_merge(struct blockrq_work *prev,
+				    struct blockrq_work *next)
+{
+	struct vmm_request *pr = prev->d.rw.r;
+	struct vmm_request *nr = next->d.rw.r;
+
+	return ((pr->type == VMM_REQUEST_READ) ||
+		(pr->type == VMM_REQUEST_WRITE)) &&
+	       (pr->type == nr->type) &&
+	       (pr->flags == nr->flags) &&
+	       (pr->bdev == nr->bdev) &&
+	       ((pr->lba + pr->bcnt) == nr->lba);
+}
+
+/* Pick next batch of contiguous requests to be dispatched and
+ * move them to batch list in ascending LBA order. The merged
+ * request covering whole batch is described by mr.
+ *
+ * Note: Must be called with brq->wq_lock held
+ */
+static u32 blockrq_sched_next(struct vmm_blockrq *brq,
+			      struct dlist *batch,
+			      struct vmm_request *mr)
+{
+	u32 i, count, bsize;
+	u64 bytes, nbytes;
+	struct blockrq_work *first, *last, *bw, *bw_next;
+
+	if (!brq->sched_count) {
+		return 0;
+	}
+
+	first = list_first_entry(&brq->sched_fifo_list,
+				 struct blockrq_work, fifo_head);
+	if (brq->sched == VMM_BLOCKRQ_SCHED_DEADLINE) {
+		if (first->deadline <= vmm_timer_timestamp()) {
+			brq->stats.expired++;
+		} else {
+			/* One-way elevator with wrap around */
+			first = list_first_entry(&brq->sched_sort_list,
+						 struct blockrq_work, sort_head);
+			list_for_each_entry(bw, &brq->sched_sort_list,
+					    sort_head) {
+				if (brq->sched_next_lba <= bw->d.rw.r->lba) {
+					first = bw;
+					break;
+				}
+			}
+		}
+	}
+
+	count = 1;
+	last = first;
+	bsize = first->d.rw.r->bdev->block_size;
+	bytes = (u64)first->d.rw.r->bcnt * bsize;
+	if (!brq->async_rw && brq->max_merge_bytes) {
+		/* Back merge */
+		while (!list_is_last(&last->sort_head,
+				     &brq->sched_sort_list)) {
+			bw = list_next_entry(last, sort_head);
+			nbytes = (u64)bw->d.rw.r->bcnt * bsize;
+			if (!blockrq_sched_can_merge(last, bw) ||
+			    (brq->max_merge_bytes < (bytes + nbytes))) {
+				break;
+			}
+			bytes += nbytes;
+			last = bw;
+			count++;
+		}
+
+		/* Front merge */
+		while (!list_is_first(&first->sort_head,
+				      &brq->sched_sort_list)) {
+			bw = list_prev_entry(first, sort_head);
+			nbytes = (u64)bw->d.rw.r->bcnt * bsize;
+			if (!blockrq_sched_can_merge(bw, first) ||
+			    (brq->max_merge_bytes < (bytes + nbytes))) {
+				break;
+			}
+			bytes += nbytes;
+			first = bw;
+			count++;
+		}
+	}
+
+	memset(mr, 0, sizeof(*mr));
+	INIT_LIST_HEAD(&mr->head);
+	mr->bdev = first->d.rw.r->bdev;
+	mr->type = first->d.rw.r->type;
+	mr->flags = first->d.rw.r->flags;
+	mr->lba = first->d.rw.r->lba;
+	mr->bcnt = 0;
+	mr->data = (count == 1) ? first->d.rw.r->data : NULL;
+
+	brq->sched_next_lba = last->d.rw.r->lba + last->d.rw.r->bcnt;
+
+	bw = first;
+	for (i = 0; i < count; i++) {
+		bw_next = list_next_entry(bw, sort_head);
+		mr->bcnt += bw->d.rw.r->bcnt;
+		list_del(&bw->fifo_head);
+		list_move_tail(&bw->sort_head, batch);
+		bw->in_flight = TRUE;
+		bw = bw_next;
+	}
+	brq->sched_count -= count;
+
+	brq->stats.dispatches++;
+	brq->stats.merges += count - 1;
+
+	return count;
+}
+
 static int blockrq_queue_rw(struct vmm_blockrq *brq,
 			    struct vmm_request *r)
 {
@@ -55,6 +217,10 @@ static int blockrq_queue_rw(struct vmm_blockrq *brq,
 	irq_flags_t flags;
 	struct blockrq_work *bwork;
 
+	if (!r) {
+		return VMM_EINVALID;
+	}
+
 	vmm_spin_lock_irqsave(&brq->wq_lock, flags);
 
 	if (list_empty(&brq->wq_rw_free_list)) {
@@ -67,16 +233,23 @@ static int blockrq_queue_rw(struct vmm_blockrq *brq,
 	list_del(&bwork->head);
 	bwork->is_rw = TRUE;
 	bwork->d.rw.r = r;
-	if (r) {
-		bwork->d.rw.priv = r->priv;
-		r->priv = bwork;
-	} else {
-		bwork->d.rw.priv = NULL;
-	}
+	bwork->d.rw.priv = r->priv;
+	r->priv = bwork;
 	bwork->is_free = FALSE;
+	bwork->in_flight = FALSE;
+	bwork->aborted = FALSE;
+	bwork->fua_pending = FALSE;
+	bwork->released = NULL;
+	bwork->tstamp = vmm_timer_timestamp();
+	bwork->deadline = bwork->tstamp +
+			((r->type == VMM_REQUEST_READ) ?
+			 BLOCKRQ_READ_EXPIRE_NSECS : BLOCKRQ_WRITE_EXPIRE_NSECS);
 	list_add_tail(&bwork->head, &brq->wq_pending_list);
 
-	vmm_workqueue_schedule_work(brq->wq, &bwork->work);
+	blockrq_sched_add(brq, bwork);
+	brq->stats.requests++;
+
+	vmm_workqueue_schedule_work(brq->wq, &brq->rw_work);
 
 done:
 	vmm_spin_unlock_irqrestore(&brq->wq_lock, flags);
@@ -116,71 +289,148 @@ done:
 	return rc;
 }
 
-static void blockrq_dequeue_work(struct blockrq_work *bwork)
+/* Note: Must be called with brq->wq_lock held */
+static void __blockrq_dequeue_work(struct blockrq_work *bwork)
 {
-	irq_flags_t flags;
 	struct vmm_blockrq *brq = bwork->brq;
 
-	vmm_spin_lock_irqsave(&brq->wq_lock, flags);
-
 	list_del(&bwork->head);
 	bwork->is_free = TRUE;
 	if (bwork->is_rw) {
-		if (bwork->d.rw.r) {
+		if (bwork->d.rw.r && !bwork->aborted) {
 			bwork->d.rw.r->priv = bwork->d.rw.priv;
 		}
 		bwork->d.rw.r = NULL;
 		bwork->d.rw.priv = NULL;
+		bwork->in_flight = FALSE;
+		bwork->aborted = FALSE;
+		bwork->fua_pending = FALSE;
+		if (bwork->released) {
+			vmm_completion_complete(bwork->released);
+			bwork->released = NULL;
+		}
 		list_add_tail(&bwork->head, &brq->wq_rw_free_list);
 	} else {
 		bwork->d.w.func = NULL;
 		bwork->d.w.priv = NULL;
 		list_add_tail(&bwork->head, &brq->wq_w_free_list);
 	}
+}
+
+static void blockrq_dequeue_work(struct blockrq_work *bwork)
+{
+	irq_flags_t flags;
+	struct vmm_blockrq *brq = bwork->brq;
 
+	vmm_spin_lock_irqsave(&brq->wq_lock, flags);
+	__blockrq_dequeue_work(bwork);
 	vmm_spin_unlock_irqrestore(&brq->wq_lock, flags);
 }
 
+/* Note: Called without request queue lock held because worker
+ * needs it for completing other requests of a merged dispatch.
+ */
 static int blockrq_abort_rw(struct vmm_blockrq *brq,
 			    struct vmm_request *r)
 {
 	int rc = VMM_OK;
+	bool wait = FALSE;
+	irq_flags_t flags;
 	struct blockrq_work *bwork;
+	struct vmm_completion released;
 
 	if (!brq || !r || !r->priv) {
 		return VMM_EINVALID;
 	}
 	bwork = r->priv;
+	INIT_COMPLETION(&released);
 
-	rc = vmm_workqueue_stop_work(&bwork->work);
-	if (rc) {
-		return rc;
-	}
+	vmm_spin_lock_irqsave(&brq->wq_lock, flags);
 
-	if (!bwork->is_free) {
-		blockrq_dequeue_work(bwork);
+	if (!bwork->is_free && bwork->is_rw && (bwork->d.rw.r == r)) {
+		if (!bwork->in_flight) {
+			/* Not yet dispatched so drop it from scheduler */
+			list_del(&bwork->sort_head);
+			list_del(&bwork->fifo_head);
+			brq->sched_count--;
+			__blockrq_dequeue_work(bwork);
+		} else if (brq->async_rw) {
+			__blockrq_dequeue_work(bwork);
+		} else {
+			/* Dispatched (possibly merged) so detach it and
+			 * let the worker release it after the dispatch.
+			 */
+			r->priv = bwork->d.rw.priv;
+			bwork->aborted = TRUE;
+			bwork->released = &released;
+			wait = TRUE;
+		}
+		brq->stats.aborts++;
 	}
 
+	vmm_spin_unlock_irqrestore(&brq->wq_lock, flags);
+
+	/* Let driver cancel in-flight request before waiting for it */
 	if (brq->abort) {
 		rc = brq->abort(brq, r, brq->priv);
 	}
 
+	/* Worker might still be using request data so wait for it */
+	if (wait) {
+		if (vmm_scheduler_orphan_context()) {
+			vmm_completion_wait(&released);
+		} else {
+			while (!vmm_completion_done(&released)) {
+				vmm_udelay(VMM_THREAD_DEF_TIME_SLICE / 1000);
+			}
+		}
+
+		/* Worker completes it with wq_lock held so sync with
+		 * worker before the completion goes out of scope.
+		 */
+		vmm_spin_lock_irqsave(&brq->wq_lock, flags);
+		vmm_spin_unlock_irqrestore(&brq->wq_lock, flags);
+	}
+
 	return rc;
 }
 
-void blockrq_rw_done(struct blockrq_work *bwork, int error)
+static void blockrq_rw_done(struct blockrq_work *bwork, int error)
 {
+	u64 latency;
+	irq_flags_t flags;
 	struct vmm_request *r;
+	struct vmm_blockrq *brq;
 
 	if (!bwork || !bwork->is_rw) {
 		return;
 	}
-	if (!bwork->d.rw.r || !bwork->d.rw.r->priv) {
+	brq = bwork->brq;
+
+	vmm_spin_lock_irqsave(&brq->wq_lock, flags);
+
+	if (bwork->is_free || !bwork->d.rw.r) {
+		vmm_spin_unlock_irqrestore(&brq->wq_lock, flags);
+		return;
+	}
+
+	r = (bwork->aborted) ? NULL : bwork->d.rw.r;
+	if (r) {
+		latency = vmm_timer_timestamp() - bwork->tstamp;
+		brq->stats.completed++;
+		brq->stats.total_latency_ns += latency;
+		if (brq->stats.max_latency_ns < latency) {
+			brq->stats.max_latency_ns = latency;
+		}
+	}
+	__blockrq_dequeue_work(bwork);
+
+	vmm_spin_unlock_irqrestore(&brq->wq_lock, flags);
+
+	if (!r) {
 		return;
 	}
-	r = bwork->d.rw.r;
 
-	blockrq_dequeue_work(bwork);
 	if (error) {
 		vmm_blockdev_fail_request(r);
 	} else {
@@ -188,36 +438,44 @@ void blockrq_rw_done(struct blockrq_work *bwork, int error)
 	}
 }
 
-static void blockrq_work_func(struct vmm_work *work)
+static bool blockrq_need_fua_flush(struct vmm_blockrq *brq,
+				   struct vmm_request *r)
 {
-	int rc = VMM_OK;
-	void *w_priv;
-	void (*w_func)(struct vmm_blockrq *, void *);
-	struct blockrq_work *bwork =
-		container_of(work, struct blockrq_work, work);
-	struct vmm_blockrq *brq = bwork->brq;
+	return (brq->flush &&
+		(r->flags & VMM_REQUEST_FLAG_FUA) &&
+		(r->type != VMM_REQUEST_READ) &&
+		!(r->bdev->flags & VMM_BLOCKDEV_FUA)) ? TRUE : FALSE;
+}
 
-	if (!bwork->is_rw) {
-		w_func = bwork->d.w.func;
-		w_priv = bwork->d.w.priv;
-		blockrq_dequeue_work(bwork);
-		if (w_func) {
-			w_func(brq, w_priv);
-		}
-		return;
-	}
+static int blockrq_do_rw(struct vmm_blockrq *brq, struct vmm_request *r)
+{
+	int rc;
 
-	switch (bwork->d.rw.r->type) {
+	switch (r->type) {
 	case VMM_REQUEST_READ:
 		if (brq->read) {
-			rc = brq->read(brq, bwork->d.rw.r, brq->priv);
+			rc = brq->read(brq, r, brq->priv);
 		} else {
 			rc = VMM_EIO;
 		}
 		break;
 	case VMM_REQUEST_WRITE:
 		if (brq->write) {
-			rc = brq->write(brq, bwork->d.rw.r, brq->priv);
+			rc = brq->write(brq, r, brq->priv);
+		} else {
+			rc = VMM_EIO;
+		}
+		break;
+	case VMM_REQUEST_DISCARD:
+		if (brq->discard) {
+			rc = brq->discard(brq, r, brq->priv);
+		} else {
+			rc = VMM_EIO;
+		}
+		break;
+	case VMM_REQUEST_WRITE_ZEROES:
+		if (brq->write_zeroes) {
+			rc = brq->write_zeroes(brq, r, brq->priv);
 		} else {
 			rc = VMM_EIO;
 		}
@@ -226,8 +484,188 @@ static void blockrq_work_func(struct vmm_work *work)
 		rc = VMM_EINVALID;
 		break;
 	};
-	if (!brq->async_rw) {
-		blockrq_rw_done(bwork, rc);
+
+	/* Emulate FUA using flush for synchronous request queue */
+	if (!rc && !brq->async_rw && blockrq_need_fua_flush(brq, r)) {
+		brq->flush(brq, brq->priv);
+	}
+
+	return rc;
+}
+
+/* Note: Merge buffer is only touched by the worker */
+static u8 *blockrq_merge_buf(struct vmm_blockrq *brq, u64 bytes)
+{
+	u32 page_count = VMM_SIZE_TO_PAGE(bytes);
+
+	if (page_count <= brq->merge_page_count) {
+		return (u8 *)brq->merge_page_va;
+	}
+
+	if (brq->merge_page_va) {
+		vmm_host_free_pages(brq->merge_page_va,
+				    brq->merge_page_count);
+		brq->merge_page_va = 0;
+		brq->merge_page_count = 0;
+	}
+
+	brq->merge_page_va = vmm_host_alloc_pages(page_count,
+						  VMM_MEMORY_FLAGS_NORMAL);
+	if (!brq->merge_page_va) {
+		return NULL;
+	}
+	brq->merge_page_count = page_count;
+
+	return (u8 *)brq->merge_page_va;
+}
+
+static void blockrq_dispatch_merged(struct vmm_blockrq *brq,
+				    struct dlist *batch,
+				    struct vmm_request *mr)
+{
+	int rc;
+	bool direct;
+	u8 *buf, *data;
+	u64 off, len, bytes;
+	irq_flags_t flags;
+	struct vmm_request *r;
+	struct blockrq_work *bw, *bw_next;
+
+	bytes = (u64)mr->bcnt * mr->bdev->block_size;
+
+	/* Check whether data buffers are already contiguous */
+	vmm_spin_lock_irqsave(&brq->wq_lock, flags);
+	off = 0;
+	direct = TRUE;
+	data = NULL;
+	list_for_each_entry(bw, batch, sort_head) {
+		r = bw->d.rw.r;
+		if (!data) {
+			data = r->data;
+		} else if ((u8 *)r->data != (data + off)) {
+			direct = FALSE;
+		}
+		off += (u64)r->bcnt * mr->bdev->block_size;
+	}
+	vmm_spin_unlock_irqrestore(&brq->wq_lock, flags);
+
+	buf = (direct) ? data : blockrq_merge_buf(brq, bytes);
+	if (!buf) {
+		/* No merge buffer so dispatch requests one-by-one */
+		list_for_each_entry_safe(bw, bw_next, batch, sort_head) {
+			list_del_init(&bw->sort_head);
+			rc = (bw->aborted) ?
+				VMM_EIO : blockrq_do_rw(brq, bw->d.rw.r);
+			blockrq_rw_done(bw, rc);
+		}
+		return;
+	}
+
+	/* Aborter of a batch member waits until we release it so
+	 * data of aborted requests is still valid and copied as-is
+	 * hence merged write does not overwrite its blocks.
+	 */
+	if (!direct && (mr->type == VMM_REQUEST_WRITE)) {
+		off = 0;
+		list_for_each_entry(bw, batch, sort_head) {
+			r = bw->d.rw.r;
+			len = (u64)r->bcnt * mr->bdev->block_size;
+			memcpy(buf + off, r->data, len);
+			off += len;
+		}
+	}
+
+	mr->data = buf;
+	rc = blockrq_do_rw(brq, mr);
+
+	if (!rc && !direct && (mr->type == VMM_REQUEST_READ)) {
+		vmm_spin_lock_irqsave(&brq->wq_lock, flags);
+		off = 0;
+		list_for_each_entry(bw, batch, sort_head) {
+			r = bw->d.rw.r;
+			len = (u64)r->bcnt * mr->bdev->block_size;
+			if (!bw->aborted) {
+				memcpy(r->data, buf + off, len);
+			}
+			off += len;
+		}
+		vmm_spin_unlock_irqrestore(&brq->wq_lock, flags);
+	}
+
+	/* Release aborted requests first so that aborters waiting
+	 * for them don't also wait for completion of other requests.
+	 */
+	vmm_spin_lock_irqsave(&brq->wq_lock, flags);
+	list_for_each_entry_safe(bw, bw_next, batch, sort_head) {
+		if (bw->aborted) {
+			list_del_init(&bw->sort_head);
+			__blockrq_dequeue_work(bw);
+		}
+	}
+	vmm_spin_unlock_irqrestore(&brq->wq_lock, flags);
+
+	list_for_each_entry_safe(bw, bw_next, batch, sort_head) {
+		list_del_init(&bw->sort_head);
+		blockrq_rw_done(bw, rc);
+	}
+}
+
+static void blockrq_rw_work_func(struct vmm_work *work)
+{
+	int rc;
+	u32 count;
+	irq_flags_t flags;
+	struct dlist batch;
+	struct vmm_request mr, *r;
+	struct blockrq_work *bwork;
+	struct vmm_blockrq *brq =
+		container_of(work, struct vmm_blockrq, rw_work);
+
+	while (1) {
+		INIT_LIST_HEAD(&batch);
+
+		vmm_spin_lock_irqsave(&brq->wq_lock, flags);
+		count = blockrq_sched_next(brq, &batch, &mr);
+		if (count == 1) {
+			bwork = list_first_entry(&batch,
+						 struct blockrq_work, sort_head);
+			list_del_init(&bwork->sort_head);
+			r = bwork->d.rw.r;
+		} else {
+			bwork = NULL;
+			r = NULL;
+		}
+		vmm_spin_unlock_irqrestore(&brq->wq_lock, flags);
+
+		if (!count) {
+			break;
+		}
+
+		if (count > 1) {
+			blockrq_dispatch_merged(brq, &batch, &mr);
+			continue;
+		}
+
+		rc = blockrq_do_rw(brq, r);
+		if (!brq->async_rw) {
+			blockrq_rw_done(bwork, rc);
+		}
+	}
+}
+
+static void blockrq_work_func(struct vmm_work *work)
+{
+	void *w_priv;
+	void (*w_func)(struct vmm_blockrq *, void *);
+	struct blockrq_work *bwork =
+		container_of(work, struct blockrq_work, work);
+	struct vmm_blockrq *brq = bwork->brq;
+
+	w_func = bwork->d.w.func;
+	w_priv = bwork->d.w.priv;
+	blockrq_dequeue_work(bwork);
+	if (w_func) {
+		w_func(brq, w_priv);
 	}
 }
 
@@ -238,6 +676,27 @@ static void blockrq_flush_work(struct vmm_blockrq *brq, void *priv)
 	}
 }
 
+/* Emulate FUA using flush for asynchronous request queue */
+static void blockrq_fua_work(struct vmm_blockrq *brq, void *priv)
+{
+	bool pending;
+	irq_flags_t flags;
+	struct blockrq_work *bwork = priv;
+
+	vmm_spin_lock_irqsave(&brq->wq_lock, flags);
+	pending = bwork->fua_pending;
+	bwork->fua_pending = FALSE;
+	vmm_spin_unlock_irqrestore(&brq->wq_lock, flags);
+
+	/* Request was aborted meanwhile */
+	if (!pending) {
+		return;
+	}
+
+	brq->flush(brq, brq->priv);
+	blockrq_rw_done(bwork, VMM_OK);
+}
+
 static int blockrq_make_request(struct vmm_request_queue *rq, 
 				struct vmm_request *r)
 {
@@ -259,6 +718,7 @@ static int blockrq_flush_cache(struct vmm_request_queue *rq)
 void vmm_blockrq_async_done(struct vmm_blockrq *brq,
 			    struct vmm_request *r, int error)
 {
+	irq_flags_t flags;
 	struct blockrq_work *bwork;
 
 	if (!brq || !brq->async_rw || !r || !r->priv) {
@@ -266,10 +726,96 @@ void vmm_blockrq_async_done(struct vmm_blockrq *brq,
 	}
 	bwork = r->priv;
 
+	/* Completion has to wait for flush when FUA is emulated */
+	if (!error && blockrq_need_fua_flush(brq, r)) {
+		vmm_spin_lock_irqsave(&brq->wq_lock, flags);
+		bwork->fua_pending = TRUE;
+		vmm_spin_unlock_irqrestore(&brq->wq_lock, flags);
+		if (!blockrq_queue_work(brq, blockrq_fua_work, bwork)) {
+			return;
+		}
+		vmm_spin_lock_irqsave(&brq->wq_lock, flags);
+		bwork->fua_pending = FALSE;
+		vmm_spin_unlock_irqrestore(&brq->wq_lock, flags);
+		error = VMM_ENOMEM;
+	}
+
 	blockrq_rw_done(bwork, error);
 }
 VMM_EXPORT_SYMBOL(vmm_blockrq_async_done);
 
+bool vmm_blockrq_is_rq(struct vmm_request_queue *rq)
+{
+	return (rq && (rq->make_request == blockrq_make_request)) ?
+		TRUE : FALSE;
+}
+VMM_EXPORT_SYMBOL(vmm_blockrq_is_rq);
+
+const char *vmm_blockrq_sched_name(enum vmm_blockrq_sched sched)
+{
+	if (VMM_BLOCKRQ_SCHED_MAX <= sched) {
+		return "unknown";
+	}
+
+	return blockrq_sched_names[sched];
+}
+VMM_EXPORT_SYMBOL(vmm_blockrq_sched_name);
+
+int vmm_blockrq_set_sched(struct vmm_blockrq *brq,
+			  enum vmm_blockrq_sched sched, u32 max_merge_bytes)
+{
+	irq_flags_t flags;
+
+	if (!brq || (VMM_BLOCKRQ_SCHED_MAX <= sched) ||
+	    (VMM_BLOCKRQ_MAX_MERGE_BYTES < max_merge_bytes)) {
+		return VMM_EINVALID;
+	}
+
+	vmm_spin_lock_irqsave(&brq->wq_lock, flags);
+	brq->sched = sched;
+	brq->max_merge_bytes = (brq->async_rw) ? 0 : max_merge_bytes;
+	vmm_spin_unlock_irqrestore(&brq->wq_lock, flags);
+
+	return VMM_OK;
+}
+VMM_EXPORT_SYMBOL(vmm_blockrq_set_sched);
+
+int vmm_blockrq_get_stats(struct vmm_blockrq *brq,
+			  struct vmm_blockrq_stats *stats)
+{
+	irq_flags_t flags;
+
+	if (!brq || !stats) {
+		return VMM_EINVALID;
+	}
+
+	vmm_spin_lock_irqsave(&brq->wq_lock, flags);
+	memcpy(stats, &brq->stats, sizeof(*stats));
+	vmm_spin_unlock_irqrestore(&brq->wq_lock, flags);
+
+	return VMM_OK;
+}
+VMM_EXPORT_SYMBOL(vmm_blockrq_get_stats);
+
+int vmm_blockrq_set_discard_ops(struct vmm_blockrq *brq,
+	int (*discard)(struct vmm_blockrq *,struct vmm_request *, void *),
+	int (*write_zeroes)(struct vmm_blockrq *,struct vmm_request *, void *))
+{
+	irq_flags_t flags;
+
+	if (!brq) {
+		return VMM_EINVALID;
+	}
+
+	vmm_spin_lock_irqsave(&brq->wq_lock, flags);
+	brq->discard = discard;
+	brq->write_zeroes = write_zeroes;
+	vmm_spin_unlock_irqrestore(&brq->wq_lock, flags);
+
+	return VMM_OK;
+}
+VMM_EXPORT_SYMBOL(vmm_blockrq_set_discard_ops);
+
 int vmm_blockrq_queue_work(struct vmm_blockrq *brq,
 			void (*w_func)(struct vmm_blockrq *, void *),
 			void *w_priv)
@@ -295,6 +841,11 @@ int vmm_blockrq_destroy(struct vmm_blockrq *brq)
 		return rc;
 	}
 
+	if (brq->merge_page_va) {
+		vmm_host_free_pages(brq->merge_page_va,
+				    brq->merge_page_count);
+	}
+
 	vmm_host_free_pages(brq->wq_page_va, brq->wq_page_count);
 
 	vmm_free(brq);
@@ -345,6 +896,17 @@ struct vmm_blockrq *vmm_blockrq_create(
 	INIT_LIST_HEAD(&brq->wq_w_free_list);
 	INIT_LIST_HEAD(&brq->wq_pending_list);
 
+	brq->sched = VMM_BLOCKRQ_SCHED_DEADLINE;
+	brq->max_merge_bytes =
+		(async_rw) ? 0 : VMM_BLOCKRQ_DEFAULT_MAX_MERGE_BYTES;
+	brq->sched_count = 0;
+	brq->sched_next_lba = 0;
+	INIT_LIST_HEAD(&brq->sched_sort_list);
+	INIT_LIST_HEAD(&brq->sched_fifo_list);
+	brq->merge_page_count = 0;
+	brq->merge_page_va = 0;
+	INIT_WORK(&brq->rw_work, blockrq_rw_work_func);
+
 	for (i = 0; i < brq->max_pending; i++) {
 		bwork = (struct blockrq_work *)(brq->wq_page_va +
 						i * sizeof(*bwork));
@@ -355,6 +917,12 @@ struct vmm_blockrq *vmm_blockrq_create(
 		bwork->d.rw.priv = NULL;
 		bwork->is_rw = TRUE;
 		bwork->is_free = TRUE;
+		INIT_LIST_HEAD(&bwork->sort_head);
+		INIT_LIST_HEAD(&bwork->fifo_head);
+		bwork->in_flight = FALSE;
+		bwork->aborted = FALSE;
+		bwork->fua_pending = FALSE;
+		bwork->released = NULL;
 		list_add_tail(&bwork->head, &brq->wq_rw_free_list);
 	}
 
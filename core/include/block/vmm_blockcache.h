@@ -0,0 +1,131 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file vmm_blockcache.h
+ * @author agent (agent@local)
+ * @brief Block device buffer cache header
+ */
+
+#ifndef __VMM_BLOCKCACHE_H_
+#define __VMM_BLOCKCACHE_H_
+
+#include <vmm_error.h>
+#include <vmm_types.h>
+#include <block/vmm_blockdev.h>
+
+/** Buffer cache statistics of a block device */
+struct vmm_blockcache_stats {
+	u64 hits;
+	u64 misses;
+	u64 evictions;
+	u64 writebacks;
+	u64 bypass;
+	u32 buf_size;
+	u32 buf_count;
+	u32 dirty_count;
+	u32 users;
+};
+
+#ifdef CONFIG_BLOCK_CACHE
+
+/** Enable buffer cache for vmm_blockdev_rw() users of block device
+ *  Note: Buffer cache is reference counted so each successful
+ *  call must be paired with vmm_blockcache_disable().
+ *  Note: Buffer cache belongs to whole block device and is shared
+ *  by all of its partitions.
+ *  Note: Requests submitted using vmm_blockdev_submit_request()
+ *  are never cached.
+ */
+int vmm_blockcache_enable(struct vmm_blockdev *bdev);
+
+/** Disable buffer cache of block device
+ *  Note: Dirty buffers are written back when last user goes away.
+ */
+int vmm_blockcache_disable(struct vmm_blockdev *bdev);
+
+/** Write back dirty buffers of block device */
+int vmm_blockcache_sync(struct vmm_blockdev *bdev);
+
+/** Write back dirty buffers and free buffer cache of block device
+ *  irrespective of number of users
+ *  Note: This is called when block device is unregistered.
+ */
+void vmm_blockcache_release(struct vmm_blockdev *bdev);
+
+/** Retrive buffer cache statistics of block device */
+int vmm_blockcache_get_stats(struct vmm_blockdev *bdev,
+			     struct vmm_blockcache_stats *stats);
+
+/** Read/write block device through its buffer cache
+ *  Note: Returns VMM_ENOTAVAIL if buffer cache is not enabled
+ *  otherwise number of bytes transferred is returned via done.
+ *  Note: This is called by vmm_blockdev_rw() after validating
+ *  arguments so it should not be used directly.
+ */
+int vmm_blockcache_rw(struct vmm_blockdev *bdev,
+		      enum vmm_request_type type,
+		      u8 *buf, u64 off, u64 len, u64 *done);
+
+/** Initialize buffer cache */
+int vmm_blockcache_init(void);
+
+/** Cleanup buffer cache */
+void vmm_blockcache_exit(void);
+
+#else
+
+static inline int vmm_blockcache_enable(struct vmm_blockdev *bdev)
+{
+	return VMM_OK;
+}
+
+static inline int vmm_blockcache_disable(struct vmm_blockdev *bdev)
+{
+	return VMM_OK;
+}
+
+static inline int vmm_blockcache_sync(struct vmm_blockdev *bdev)
+{
+	return VMM_OK;
+}
+
+static inline void vmm_blockcache_release(struct vmm_blockdev *bdev) {}
+
+static inline int vmm_blockcache_get_stats(struct vmm_blockdev *bdev,
+					struct vmm_blockcache_stats *stats)
+{
+	return VMM_ENOTSUPP;
+}
+
+static inline int vmm_blockcache_rw(struct vmm_blockdev *bdev,
+				    enum vmm_request_type type,
+				    u8 *buf, u64 off, u64 len, u64 *done)
+{
+	return VMM_ENOTAVAIL;
+}
+
+static inline int vmm_blockcache_init(void)
+{
+	return VMM_OK;
+}
+
+static inline void vmm_blockcache_exit(void) {}
+
+#endif
+
+#endif /* __VMM_BLOCKCACHE_H_ */
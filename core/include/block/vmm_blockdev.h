@@ -26,6 +26,7 @@
 
 #include <vmm_limits.h>
 #include <vmm_types.h>
+#include <vmm_cache.h>
 #include <vmm_devdrv.h>
 #include <vmm_spinlocks.h>
 #include <vmm_mutex.h>
@@ -38,9 +39,28 @@
 enum vmm_request_type {
 	VMM_REQUEST_UNKNOWN=0,
 	VMM_REQUEST_READ=1,
-	VMM_REQUEST_WRITE=2
+	VMM_REQUEST_WRITE=2,
+	/* Drop contents of blocks (no data buffer) */
+	VMM_REQUEST_DISCARD=3,
+	/* Fill blocks with zeros (no data buffer) */
+	VMM_REQUEST_WRITE_ZEROES=4
 };
 
+/* Block IO request flags */
+/* Complete write only after data reaches stable storage */
+#define VMM_REQUEST_FLAG_FUA				0x00000001
+/* Request is accounted in block device statistics
+ * (Only for block layer internal use)
+ */
+#define VMM_REQUEST_FLAG_STATS				0x80000000
+/* Request is waiting in backlog of request queue
+ * (Only for block layer internal use)
+ */
+#define VMM_REQUEST_FLAG_BACKLOG			0x40000000
+
+struct vmm_chardev;
+struct vmm_blockcache;
+
 /** Representation of a block IO request */
 struct vmm_request {
 	struct dlist head;
@@ -50,6 +70,7 @@ struct vmm_request {
 				    */
 
 	enum vmm_request_type type;
+	u32 flags;
 	u64 lba;
 	u32 bcnt;
 	void *data;
@@ -57,8 +78,71 @@ struct vmm_request {
 	void (*completed)(struct vmm_request *);
 	void (*failed)(struct vmm_request *);
 	void *priv;
+
+	/* Used by block layer for emulating request types
+	 * not supported by block device.
+	 */
+	void *fallback;
+
+	/* Used by block layer for IO statistics. The submit_tstamp
+	 * is set by submit_request() and issue_tstamp is set when
+	 * request is passed to make_request() of request queue.
+	 */
+	u64 submit_tstamp;
+	u64 issue_tstamp;
 };
 
+/* Number of log2 buckets in IO latency histograms
+ * NOTE: Bucket 0 counts latencies below 1 usec, bucket N counts
+ * latencies from 2^(N-1) usecs upto 2^N usecs and the last bucket
+ * also counts all larger latencies.
+ */
+#define VMM_BLOCKDEV_STATS_HIST_BUCKETS			20
+
+/* Direction of IO in statistics
+ * NOTE: Discard and write zeroes requests are accounted as writes
+ */
+#define VMM_BLOCKDEV_STATS_READ				0
+#define VMM_BLOCKDEV_STATS_WRITE			1
+#define VMM_BLOCKDEV_STATS_DIR_COUNT			2
+
+/* IO statistics of block device (or virtual disk)
+ * NOTE: The counters are maintained per-CPU hence a consistent
+ * view is only available via vmm_blockdev_stats_sum().
+ * NOTE: Each per-CPU copy occupies its own cache lines so that
+ * CPUs updating their counters don't contend for cache lines.
+ */
+struct vmm_blockdev_stats {
+	/* Requests submitted */
+	u64 submitted;
+	/* Requests completed (or failed) */
+	u64 completed;
+	/* Requests completed successfully */
+	u64 ops[VMM_BLOCKDEV_STATS_DIR_COUNT];
+	/* Bytes read or written by successful requests */
+	u64 bytes[VMM_BLOCKDEV_STATS_DIR_COUNT];
+	/* Requests failed (or aborted) */
+	u64 errors[VMM_BLOCKDEV_STATS_DIR_COUNT];
+	/* Sum of submit to issue time of successful requests */
+	u64 wait_nsecs[VMM_BLOCKDEV_STATS_DIR_COUNT];
+	/* Sum of issue to completion time of successful requests */
+	u64 service_nsecs[VMM_BLOCKDEV_STATS_DIR_COUNT];
+	/* Histogram of submit to issue time */
+	u64 wait_hist[VMM_BLOCKDEV_STATS_DIR_COUNT]
+		     [VMM_BLOCKDEV_STATS_HIST_BUCKETS];
+	/* Histogram of issue to completion time */
+	u64 service_hist[VMM_BLOCKDEV_STATS_DIR_COUNT]
+			[VMM_BLOCKDEV_STATS_HIST_BUCKETS];
+} __cacheline_aligned;
+
+/** Retrive number of in-flight requests from IO statistics */
+static inline u64 vmm_blockdev_stats_in_flight(
+				const struct vmm_blockdev_stats *stats)
+{
+	return (stats->completed < stats->submitted) ?
+		(stats->submitted - stats->completed) : 0;
+}
+
 /** Representation of a block IO request queue */
 struct vmm_request_queue {
 	/* Lock to protect the request queue operations */
@@ -89,6 +173,9 @@ struct vmm_request_queue {
 
 	/* Note: abort_request will be called for successfully
 	 * submited request only
+	 * Note: abort_request is called without request queue lock
+	 * held and it may wait until request is no longer in use
+	 * because completing other requests needs the lock.
 	 */
 	int (*abort_request)(struct vmm_request_queue *rq, 
 			    struct vmm_request *r);
@@ -118,6 +205,12 @@ struct vmm_request_queue {
 /* Block device flags */
 #define VMM_BLOCKDEV_RDONLY				0x00000001
 #define VMM_BLOCKDEV_RW					0x00000002
+/* Request queue handles VMM_REQUEST_DISCARD */
+#define VMM_BLOCKDEV_DISCARD				0x00000004
+/* Request queue handles VMM_REQUEST_WRITE_ZEROES */
+#define VMM_BLOCKDEV_WRITE_ZEROES			0x00000008
+/* Request queue handles VMM_REQUEST_FLAG_FUA */
+#define VMM_BLOCKDEV_FUA				0x00000010
 
 /** Block device */
 struct vmm_blockdev {
@@ -139,6 +232,12 @@ struct vmm_blockdev {
 
 	struct vmm_request_queue *rq;
 
+	/* Buffer cache used by vmm_blockdev_rw() (if enabled) */
+	struct vmm_blockcache *cache;
+
+	/* Per-CPU IO statistics */
+	struct vmm_blockdev_stats *stats;
+
 	/* NOTE: partition managment uses part_manager_sign and
 	 * part_manager_priv for its own use.
 	 * NOTE: part_manager_sign will be unique to partition style
@@ -173,12 +272,45 @@ static inline u64 vmm_blockdev_total_size(struct vmm_blockdev *bdev)
 }
 
 /** Generic block IO complete request */
+/** Allocate per-CPU IO statistics */
+struct vmm_blockdev_stats *vmm_blockdev_stats_alloc(void);
+
+/** Free per-CPU IO statistics */
+void vmm_blockdev_stats_free(struct vmm_blockdev_stats *stats);
+
+/** Account submission of request in per-CPU IO statistics */
+void vmm_blockdev_stats_start(struct vmm_blockdev_stats *stats);
+
+/** Account completion (or failure) of request in per-CPU IO statistics
+ *  NOTE: Latencies are computed from timestamps set by block layer
+ *  in vmm_blockdev_submit_request()
+ */
+void vmm_blockdev_stats_done(struct vmm_blockdev_stats *stats,
+			     struct vmm_request *r, u64 bytes, bool failed);
+
+/** Sum per-CPU IO statistics into single IO statistics */
+void vmm_blockdev_stats_sum(struct vmm_blockdev_stats *stats,
+			    struct vmm_blockdev_stats *out);
+
+/** Print IO statistics with latency histograms */
+int vmm_blockdev_stats_print(struct vmm_chardev *cdev,
+			     struct vmm_blockdev_stats *stats);
+
+/** Retrive IO statistics of block device */
+int vmm_blockdev_get_stats(struct vmm_blockdev *bdev,
+			   struct vmm_blockdev_stats *out);
+
 int vmm_blockdev_complete_request(struct vmm_request *r);
 
 /** Generic block IO fail request */
 int vmm_blockdev_fail_request(struct vmm_request *r);
 
-/** Generic block IO submit request */
+/** Generic block IO submit request
+ *  Note: VMM_REQUEST_DISCARD is completed right away if block
+ *  device does not have VMM_BLOCKDEV_DISCARD flag.
+ *  Note: VMM_REQUEST_WRITE_ZEROES is emulated using zero filled
+ *  writes if block device does not have VMM_BLOCKDEV_WRITE_ZEROES.
+ */
 int vmm_blockdev_submit_request(struct vmm_blockdev *bdev,
 				struct vmm_request *r);
 
@@ -192,9 +324,20 @@ int vmm_blockdev_abort_request(struct vmm_request *r);
  */
 int vmm_blockdev_flush_cache(struct vmm_blockdev *bdev);
 
+/** Generic block IO read/write of whole blocks
+ *  Note: This is a blocking API hence must be
+ *  called from Orphan (or Thread) Context
+ *  Note: Block number is relative to start of block device
+ *  and buffer cache (if enabled) is bypassed.
+ */
+int vmm_blockdev_rw_blocks(struct vmm_blockdev *bdev,
+			   enum vmm_request_type type,
+			   u8 *buf, u64 lba, u64 bcnt);
+
 /** Generic block IO read/write
  *  Note: This is a blocking API hence must be 
  *  called from Orphan (or Thread) Context
+ *  Note: Goes through buffer cache if enabled for block device
  */
 u64 vmm_blockdev_rw(struct vmm_blockdev *bdev, 
 			enum vmm_request_type type,
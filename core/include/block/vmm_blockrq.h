@@ -31,6 +31,41 @@
 #include <block/vmm_blockdev.h>
 #include <libs/list.h>
 
+/** Default upper limit on size of merged request (in bytes) */
+#define VMM_BLOCKRQ_DEFAULT_MAX_MERGE_BYTES	(128 * 1024)
+
+/** Max allowed size of merged request (in bytes) */
+#define VMM_BLOCKRQ_MAX_MERGE_BYTES		(1024 * 1024)
+
+/** Types of I/O scheduler for generic request queue */
+enum vmm_blockrq_sched {
+	/* Dispatch in arrival order */
+	VMM_BLOCKRQ_SCHED_NOOP=0,
+	/* Dispatch in ascending LBA order with expiry deadlines */
+	VMM_BLOCKRQ_SCHED_DEADLINE=1,
+	VMM_BLOCKRQ_SCHED_MAX=2
+};
+
+/** Statistics of generic request queue */
+struct vmm_blockrq_stats {
+	/* Read/Write requests queued */
+	u64 requests;
+	/* Read/Write calls made to driver */
+	u64 dispatches;
+	/* Requests merged into another request */
+	u64 merges;
+	/* Requests dispatched due to expired deadline */
+	u64 expired;
+	/* Requests aborted */
+	u64 aborts;
+	/* Requests completed (or failed) */
+	u64 completed;
+	/* Sum of queue to completion latency of completed requests */
+	u64 total_latency_ns;
+	/* Max queue to completion latency of completed requests */
+	u64 max_latency_ns;
+};
+
 /** Representation of generic request queue */
 struct vmm_blockrq {
 	char name[VMM_FIELD_NAME_SIZE];
@@ -44,6 +79,10 @@ struct vmm_blockrq {
 	int (*abort)(struct vmm_blockrq *brq,
 		     struct vmm_request *r, void *priv);
 	void (*flush)(struct vmm_blockrq *brq, void *priv);
+	int (*discard)(struct vmm_blockrq *brq,
+		       struct vmm_request *r, void *priv);
+	int (*write_zeroes)(struct vmm_blockrq *brq,
+			    struct vmm_request *r, void *priv);
 	void *priv;
 
 	u32 wq_page_count;
@@ -53,6 +92,18 @@ struct vmm_blockrq {
 	struct dlist wq_w_free_list;
 	struct dlist wq_pending_list;
 
+	enum vmm_blockrq_sched sched;
+	u32 max_merge_bytes;
+	u32 sched_count;
+	u64 sched_next_lba;
+	struct dlist sched_sort_list;
+	struct dlist sched_fifo_list;
+	struct vmm_blockrq_stats stats;
+
+	u32 merge_page_count;
+	virtual_addr_t merge_page_va;
+
+	struct vmm_work rw_work;
 	struct vmm_workqueue *wq;
 
 	struct vmm_request_queue rq;
@@ -74,6 +125,33 @@ static inline struct vmm_request_queue *vmm_blockrq_to_rq(
 	return &brq->rq;
 }
 
+/** Check whether request queue pointer belongs to
+ *  generic blockdev request queue
+ */
+bool vmm_blockrq_is_rq(struct vmm_request_queue *rq);
+
+/** Retrive name of I/O scheduler */
+const char *vmm_blockrq_sched_name(enum vmm_blockrq_sched sched);
+
+/** Update I/O scheduler and max merged request size (in bytes)
+ *  Note: Zero max_merge_bytes disables merging of requests
+ *  Note: Requests are never merged for async_rw request queue
+ */
+int vmm_blockrq_set_sched(struct vmm_blockrq *brq,
+			  enum vmm_blockrq_sched sched, u32 max_merge_bytes);
+
+/** Retrive statistics of generic blockdev request queue */
+int vmm_blockrq_get_stats(struct vmm_blockrq *brq,
+			  struct vmm_blockrq_stats *stats);
+
+/** Set handlers of VMM_REQUEST_DISCARD and VMM_REQUEST_WRITE_ZEROES
+ *  Note: Block device flags VMM_BLOCKDEV_DISCARD and
+ *  VMM_BLOCKDEV_WRITE_ZEROES should be set only for available handlers
+ */
+int vmm_blockrq_set_discard_ops(struct vmm_blockrq *brq,
+	int (*discard)(struct vmm_blockrq *,struct vmm_request *, void *),
+	int (*write_zeroes)(struct vmm_blockrq *,struct vmm_request *, void *));
+
 /** Mark async request done */
 void vmm_blockrq_async_done(struct vmm_blockrq *brq,
 			    struct vmm_request *r, int error);
@@ -90,6 +168,14 @@ int vmm_blockrq_destroy(struct vmm_blockrq *brq);
 
 /** Create generic blockdev request queue
  *  Note: This function should be called from Orphan (or Thread) context.
+ *  Note: The request queue uses deadline I/O scheduler by default and
+ *  merges contiguous requests upto VMM_BLOCKRQ_DEFAULT_MAX_MERGE_BYTES
+ *  unless async_rw is set.
+ *  Note: Writes with VMM_REQUEST_FLAG_FUA are followed by flush
+ *  callback unless block device has VMM_BLOCKDEV_FUA flag set. With
+ *  async_rw, such writes complete only after the flush callback.
+ *  Note: The abort callback is called before waiting for the worker
+ *  to finish an in-flight request so that driver can cancel it.
  */
 struct vmm_blockrq *vmm_blockrq_create(
 	const char *name, u32 max_pending, bool async_rw,
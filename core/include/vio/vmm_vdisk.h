@@ -57,12 +57,15 @@ struct vmm_vdisk;
 enum vmm_vdisk_request_type {
 	VMM_VDISK_REQUEST_UNKNOWN=0,
 	VMM_VDISK_REQUEST_READ=1,
-	VMM_VDISK_REQUEST_WRITE=2
+	VMM_VDISK_REQUEST_WRITE=2,
+	VMM_VDISK_REQUEST_DISCARD=3,
+	VMM_VDISK_REQUEST_WRITE_ZEROES=4
 };
 
 /** Representation of a virtual disk request  */
 struct vmm_vdisk_request {
 	struct vmm_vdisk *vdisk;
+	u32 data_len;
 	struct vmm_request r;
 };
 
@@ -81,6 +84,9 @@ struct vmm_vdisk {
 	struct vmm_blockdev *blk;
 	u32 blk_factor;
 
+	/* Per-CPU IO statistics */
+	struct vmm_blockdev_stats *stats;
+
 	void *priv;
 };
 
@@ -125,6 +131,30 @@ void vmm_vdisk_set_request_type(struct vmm_vdisk_request *vreq,
 enum vmm_vdisk_request_type vmm_vdisk_get_request_type(
 					struct vmm_vdisk_request *vreq);
 
+/** Set force unit access (FUA) of given virtual disk request
+ *  NOTE: FUA write completes only after data reaches stable storage
+ */
+static inline void vmm_vdisk_set_request_fua(struct vmm_vdisk_request *vreq,
+					     bool fua)
+{
+	if (!vreq) {
+		return;
+	}
+
+	if (fua) {
+		vreq->r.flags |= VMM_REQUEST_FLAG_FUA;
+	} else {
+		vreq->r.flags &= ~VMM_REQUEST_FLAG_FUA;
+	}
+}
+
+/** Get force unit access (FUA) of given virtual disk request */
+static inline bool vmm_vdisk_get_request_fua(struct vmm_vdisk_request *vreq)
+{
+	return (vreq && (vreq->r.flags & VMM_REQUEST_FLAG_FUA)) ?
+		TRUE : FALSE;
+}
+
 /** Set lba of given virtual disk request */
 static inline void vmm_vdisk_set_request_lba(struct vmm_vdisk_request *vreq,
 					     u64 lba)
@@ -171,7 +201,10 @@ static inline void *vmm_vdisk_priv(struct vmm_vdisk *vdisk)
 	return (vdisk) ? vdisk->priv: NULL;
 }
 
-/** Submit IO request to virtual disk */
+/** Submit IO request to virtual disk
+ *  NOTE: The data is not required for discard and write zeroes
+ *  NOTE: The FUA setting of virtual disk request is retained
+ */
 int vmm_vdisk_submit_request(struct vmm_vdisk *vdisk,
 			     struct vmm_vdisk_request *vreq,
 			     enum vmm_vdisk_request_type type,
@@ -196,6 +229,13 @@ static inline u32 vmm_vdisk_block_size(struct vmm_vdisk *vdisk)
 	return (vdisk) ? vdisk->block_size : 0;
 }
 
+/** Retrive IO statistics of virtual disk
+ *  NOTE: Statistics are retained across detach and attach of
+ *  block devices
+ */
+int vmm_vdisk_get_stats(struct vmm_vdisk *vdisk,
+			struct vmm_blockdev_stats *out);
+
 /** Block count of virtual disk based on attached block device */
 u64 vmm_vdisk_capacity(struct vmm_vdisk *vdisk);
 
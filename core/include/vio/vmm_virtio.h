@@ -91,6 +91,7 @@ struct vmm_virtio_transport {
 	const char *name;
 
 	int  (*notify)(struct vmm_virtio_device *, u32 vq);
+	int  (*config_changed)(struct vmm_virtio_device *);
 };
 
 struct vmm_virtio_emulator {
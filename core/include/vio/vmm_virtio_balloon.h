@@ -0,0 +1,110 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file vmm_virtio_balloon.h
+ * @author agent (agent@local)
+ * @brief VirtIO Balloon Device Interface.
+ *
+ * This header has been derived from linux kernel source:
+ * <linux_source>/include/uapi/linux/virtio_balloon.h
+ *
+ * The original header is BSD licensed.
+ */
+
+/*
+ * This header is BSD licensed so anyone can use the definitions to implement
+ * compatible drivers/servers.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of IBM nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL IBM OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef __VMM_VIRTIO_BALLOON_H__
+#define __VMM_VIRTIO_BALLOON_H__
+
+#include <vmm_types.h>
+
+/* Feature bits */
+#define VMM_VIRTIO_BALLOON_F_MUST_TELL_HOST	0 /* Tell before reclaiming pages */
+#define VMM_VIRTIO_BALLOON_F_STATS_VQ		1 /* Memory Stats virtqueue */
+#define VMM_VIRTIO_BALLOON_F_DEFLATE_ON_OOM	2 /* Deflate balloon on OOM */
+#define VMM_VIRTIO_BALLOON_F_FREE_PAGE_HINT	3 /* VQ to report free pages */
+#define VMM_VIRTIO_BALLOON_F_PAGE_POISON	4 /* Guest is using page poisoning */
+#define VMM_VIRTIO_BALLOON_F_REPORTING		5 /* Page reporting virtqueue */
+
+/* Size of a PFN in the balloon interface. */
+#define VMM_VIRTIO_BALLOON_PFN_SHIFT		12
+
+struct vmm_virtio_balloon_config {
+	/* Number of pages host wants Guest to give up. */
+	u32 num_pages;
+	/* Number of pages we've actually got in balloon. */
+	u32 actual;
+	/* Free page hint command id, readonly by guest */
+	u32 free_page_hint_cmd_id;
+	/* Stores PAGE_POISON if page poisoning is in use */
+	u32 poison_val;
+} __attribute__((packed));
+
+#define VMM_VIRTIO_BALLOON_S_SWAP_IN	0   /* Amount of memory swapped in */
+#define VMM_VIRTIO_BALLOON_S_SWAP_OUT	1   /* Amount of memory swapped out */
+#define VMM_VIRTIO_BALLOON_S_MAJFLT	2   /* Number of major faults */
+#define VMM_VIRTIO_BALLOON_S_MINFLT	3   /* Number of minor faults */
+#define VMM_VIRTIO_BALLOON_S_MEMFREE	4   /* Total amount of free memory */
+#define VMM_VIRTIO_BALLOON_S_MEMTOT	5   /* Total amount of memory */
+#define VMM_VIRTIO_BALLOON_S_AVAIL	6   /* Available memory as in /proc */
+#define VMM_VIRTIO_BALLOON_S_CACHES	7   /* Disk caches */
+#define VMM_VIRTIO_BALLOON_S_HTLB_PGALLOC 8 /* Hugetlb page allocations */
+#define VMM_VIRTIO_BALLOON_S_HTLB_PGFAIL 9  /* Hugetlb page allocation failures */
+#define VMM_VIRTIO_BALLOON_S_NR		10
+
+/*
+ * Memory statistics structure.
+ * Driver fills an array of these structures and passes to device.
+ *
+ * NOTE: fields are laid out in a way that would make compiler add padding
+ * between and after fields, so we have to use compiler-specific attributes to
+ * pack it, to disable this padding. This also often causes compiler to
+ * generate suboptimal code.
+ */
+struct vmm_virtio_balloon_stat {
+	u16 tag;
+	u64 val;
+} __attribute__((packed));
+
+#endif /* __VMM_VIRTIO_BALLOON_H__ */
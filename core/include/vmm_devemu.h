@@ -51,6 +51,11 @@ struct vmm_emulator {
 	int (*reset) (struct vmm_emudev *edev);
 	int (*sync) (struct vmm_emudev *edev,
 		     unsigned long val, void *v);
+	u32 (*state_size) (struct vmm_emudev *edev);
+	int (*state_save) (struct vmm_emudev *edev,
+			   void *buf, u32 size);
+	int (*state_restore) (struct vmm_emudev *edev,
+			      const void *buf, u32 size);
 	int (*read8) (struct vmm_emudev *edev,
 		      physical_addr_t offset,
 		      u8 *dst);
@@ -275,6 +280,26 @@ int vmm_devemu_reset_context(struct vmm_guest *guest);
 int vmm_devemu_reset_region(struct vmm_guest *guest,
 			    struct vmm_region *reg);
 
+/** Retrive size of emulator state for given region
+ *  Note: returns zero if emulator cannot save its state
+ */
+u32 vmm_devemu_state_size(struct vmm_guest *guest,
+			  struct vmm_region *reg);
+
+/** Save emulator state for given region
+ *  Note: guest VCPUs should not be running
+ */
+int vmm_devemu_state_save(struct vmm_guest *guest,
+			  struct vmm_region *reg,
+			  void *buf, u32 size);
+
+/** Restore emulator state for given region
+ *  Note: guest VCPUs should not be running
+ */
+int vmm_devemu_state_restore(struct vmm_guest *guest,
+			     struct vmm_region *reg,
+			     const void *buf, u32 size);
+
 /** Remove emulator for given region */
 int vmm_devemu_remove_region(struct vmm_guest *guest,
 			     struct vmm_region *reg);
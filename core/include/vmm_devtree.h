@@ -44,6 +44,7 @@
 #define VMM_DEVTREE_DEVICE_TYPE_VAL_ALLOCED_RAM	"alloced_ram"
 #define VMM_DEVTREE_DEVICE_TYPE_VAL_COLORED_RAM	"colored_ram"
 #define VMM_DEVTREE_DEVICE_TYPE_VAL_SHARED_RAM	"shared_ram"
+#define VMM_DEVTREE_DEVICE_TYPE_VAL_ONDEMAND_RAM	"ondemand_ram"
 #define VMM_DEVTREE_DEVICE_TYPE_VAL_ROM		"rom"
 #define VMM_DEVTREE_DEVICE_TYPE_VAL_ALLOCED_ROM	"alloced_rom"
 #define VMM_DEVTREE_DEVICE_TYPE_VAL_COLORED_ROM	"colored_rom"
@@ -80,6 +81,7 @@
 #define VMM_DEVTREE_MEMORY_NODE_NAME		"memory"
 #define VMM_DEVTREE_MEMORY_PHYS_ADDR_ATTR_NAME	"physical_addr"
 #define VMM_DEVTREE_MEMORY_PHYS_SIZE_ATTR_NAME	"physical_size"
+#define VMM_DEVTREE_NUMA_NODE_ID_ATTR_NAME	"numa-node-id"
 
 #define VMM_DEVTREE_CPUS_NODE_NAME		"cpus"
 #define VMM_DEVTREE_INTERRUPTS_ATTR_NAME	"interrupts"
@@ -115,6 +117,13 @@
 #define VMM_DEVTREE_NUM_COLORS_ATTR_NAME	"num_colors"
 #define VMM_DEVTREE_SHARED_MEM_ATTR_NAME	"shared_mem"
 #define VMM_DEVTREE_MAP_ORDER_ATTR_NAME		"map_order"
+#define VMM_DEVTREE_ONDEMAND_LIMIT_ATTR_NAME	"ondemand_ram_limit"
+#define VMM_DEVTREE_NUMA_POLICY_ATTR_NAME	"numa_policy"
+#define VMM_DEVTREE_NUMA_POLICY_VAL_ANY		"any"
+#define VMM_DEVTREE_NUMA_POLICY_VAL_LOCAL	"local"
+#define VMM_DEVTREE_NUMA_POLICY_VAL_INTERLEAVE	"interleave"
+#define VMM_DEVTREE_NUMA_POLICY_VAL_NODE	"node"
+#define VMM_DEVTREE_NUMA_NODE_ATTR_NAME		"numa_node"
 #define VMM_DEVTREE_SWITCH_ATTR_NAME		"switch"
 #define VMM_DEVTREE_DOMAIN_ATTR_NAME		"domain"
 #define VMM_DEVTREE_NODE_ADDR_ATTR_NAME		"node_addr"
@@ -32,6 +32,8 @@
 #define VMM_GUEST_ASPACE_EVENT_DEINIT		0x02
 /* Notifier event when guest aspace is reset */
 #define VMM_GUEST_ASPACE_EVENT_RESET		0x03
+/* Notifier event when guest balloon target is changed */
+#define VMM_GUEST_ASPACE_EVENT_BALLOON		0x04
 
 /** Representation of block device notifier event */
 struct vmm_guest_aspace_event {
@@ -93,6 +95,15 @@ u32 vmm_guest_memory_write(struct vmm_guest *guest,
 			   physical_addr_t gphys_addr, 
 			   void *src, u32 len, bool cacheable);
 
+/** Mark start of a short lived host access to guest memory
+ *  Note: Host RAM given back by on-demand regions is freed only
+ *  after all accesses in-flight at the time of release have ended.
+ */
+void vmm_guest_memory_access_begin(struct vmm_guest *guest);
+
+/** Mark end of a short lived host access to guest memory */
+void vmm_guest_memory_access_end(struct vmm_guest *guest);
+
 /** Map guest physical address to some host physical address */
 int vmm_guest_physical_map(struct vmm_guest *guest,
 			   physical_addr_t gphys_addr,
@@ -106,6 +117,96 @@ int vmm_guest_physical_unmap(struct vmm_guest *guest,
 			     physical_addr_t gphys_addr,
 			     physical_size_t phys_size);
 
+/** Retrive host RAM currently allocated for on-demand RAM regions */
+physical_size_t vmm_guest_ondemand_resident(struct vmm_guest *guest);
+
+/** Retrive max host RAM allowed for on-demand RAM regions
+ *  Note: zero means no limit
+ */
+physical_size_t vmm_guest_ondemand_limit(struct vmm_guest *guest);
+
+/** Give back host RAM of on-demand RAM regions for given guest range
+ *  Note: only populated chunks fully covered by the range are released
+ *  and they will be populated again (zero filled) upon next access.
+ *  Note: returns amount of host RAM released
+ */
+physical_size_t vmm_guest_ondemand_release(struct vmm_guest *guest,
+					   physical_addr_t gphys_addr,
+					   physical_size_t phys_size);
+
+/** Update balloon target (i.e. amount of guest RAM which we want the
+ *  guest to give back) and notify balloon device emulators
+ *  Note: this function can sleep so don't call it from IRQ context
+ */
+int vmm_guest_balloon_set_target(struct vmm_guest *guest,
+				 physical_size_t target);
+
+/** Retrive current balloon target of guest */
+physical_size_t vmm_guest_balloon_target(struct vmm_guest *guest);
+
+/** Update amount of guest RAM given back by the guest
+ *  Note: this is called by balloon device emulators
+ */
+void vmm_guest_balloon_update_size(struct vmm_guest *guest,
+				   physical_size_t size);
+
+/** Retrive amount of guest RAM given back by the guest */
+physical_size_t vmm_guest_balloon_size(struct vmm_guest *guest);
+
+/** Update guest memory statistic reported by balloon device
+ *  Note: this is called by balloon device emulators
+ */
+void vmm_guest_balloon_update_stat(struct vmm_guest *guest,
+				   u32 stat, u64 val);
+
+/** Retrive guest memory statistic reported by balloon device */
+u64 vmm_guest_balloon_stat(struct vmm_guest *guest, u32 stat);
+
+/** Check whether guest writes to given region can be logged */
+bool vmm_guest_dirty_log_region(struct vmm_region *reg);
+
+/** Start logging guest writes to RAM regions
+ *  Note: RAM regions are write protected so that first write to
+ *  each page after start (or after a fetch) traps.
+ */
+int vmm_guest_dirty_log_start(struct vmm_guest *guest);
+
+/** Stop logging guest writes to RAM regions */
+int vmm_guest_dirty_log_stop(struct vmm_guest *guest);
+
+/** Check whether guest writes to RAM regions are being logged */
+bool vmm_guest_dirty_log_enabled(struct vmm_guest *guest);
+
+/** Mark guest RAM pages written by host as dirty */
+void vmm_guest_dirty_log_mark(struct vmm_guest *guest,
+			      physical_addr_t gphys_addr,
+			      physical_size_t phys_size);
+
+/** Mark guest RAM page as dirty upon guest write fault
+ *  Note: this is called by arch code after write permission is
+ *  given back so that time since fault_tstamp is accounted as
+ *  cost of the write fault
+ */
+void vmm_guest_dirty_log_fault(struct vmm_guest *guest,
+			       physical_addr_t gphys_addr,
+			       u64 fault_tstamp);
+
+/** Fetch and clear dirty page bitmap of given region
+ *  Note: bitmap should have one bit for each page of region
+ *  Note: dirty pages are write protected again before returning
+ *  so caller should read them only after this returns
+ */
+int vmm_guest_dirty_log_fetch(struct vmm_guest *guest,
+			      struct vmm_region *reg,
+			      unsigned long *bitmap, u32 *dirty_count);
+
+/** Retrive number of dirty pages not yet fetched */
+u32 vmm_guest_dirty_log_count(struct vmm_guest *guest);
+
+/** Retrive number of guest write faults and time spent on them */
+void vmm_guest_dirty_log_fault_stats(struct vmm_guest *guest,
+				     u64 *faults, u64 *nsecs);
+
 /** Add a new region from a given node in DTS */
 int vmm_guest_add_region_from_node(struct vmm_guest *guest,
 				   struct vmm_devtree_node *node,
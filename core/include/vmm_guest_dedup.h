@@ -0,0 +1,215 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file vmm_guest_dedup.h
+ * @author agent (agent@local)
+ * @brief header file for content based guest page deduplication
+ */
+#ifndef _VMM_GUEST_DEDUP_H__
+#define _VMM_GUEST_DEDUP_H__
+
+#include <vmm_error.h>
+#include <vmm_types.h>
+#include <vmm_host_ram.h>
+
+/** Guest attribute name to opt-in for page deduplication */
+#define VMM_GUEST_DEDUP_ATTR_NAME		"memory_dedup"
+
+struct vmm_guest;
+
+/** Page deduplication statistics of a guest */
+struct vmm_guest_dedup_stats {
+	u64 pages_scanned;
+	u64 pages_merged;
+	u64 cow_breaks;
+	u64 full_scans;
+	u32 pages_pending;
+	u32 pages_shared;
+	u32 pages_private;
+	u32 pages_pinned;
+};
+
+#ifdef CONFIG_GUEST_DEDUP
+
+/** Attach page deduplication context to guest address space
+ *  Note: Does nothing if guest has not opted-in using
+ *  VMM_GUEST_DEDUP_ATTR_NAME attribute.
+ *  Note: This is called before guest regions are created.
+ */
+int vmm_guest_dedup_attach(struct vmm_guest *guest);
+
+/** Stop scanning guest address space
+ *  Note: This is called before guest regions are removed.
+ */
+void vmm_guest_dedup_detach(struct vmm_guest *guest);
+
+/** Free page deduplication context of guest address space
+ *  Note: This is called after guest regions are removed.
+ */
+void vmm_guest_dedup_cleanup(struct vmm_guest *guest);
+
+/** Check whether page deduplication is enabled for guest */
+bool vmm_guest_dedup_enabled(struct vmm_guest *guest);
+
+/** Resolve stage2 fault of a guest page
+ *  Note: Returns VMM_ENOENT if guest page is not deduplicated
+ *  and caller should use regular region mapping.
+ *  Note: Writing to a shared page breaks the sharing so region
+ *  flags have VMM_REGION_READONLY set only for shared pages.
+ */
+int vmm_guest_dedup_fault(struct vmm_guest *guest,
+			  physical_addr_t gphys_addr, bool write,
+			  physical_addr_t *hphys_addr, u32 *reg_flags);
+
+/** Adjust host mapping of guest memory before host access
+ *  Note: Shared page is made private only for write access.
+ *  Note: Available size is truncated at next deduplicated page.
+ */
+void vmm_guest_dedup_access(struct vmm_guest *guest,
+			    physical_addr_t gphys_addr, bool write,
+			    physical_addr_t *hphys_addr,
+			    physical_size_t *avail_size);
+
+/** Mark start of a short lived host access to guest memory
+ *  Note: Pages are not merged while such accesses are in-flight.
+ */
+void vmm_guest_dedup_access_begin(struct vmm_guest *guest);
+
+/** Mark end of a short lived host access to guest memory */
+void vmm_guest_dedup_access_end(struct vmm_guest *guest);
+
+/** Exclude guest pages from deduplication forever
+ *  Note: Used for guest memory to which host keeps a
+ *  long lived mapping (e.g. VirtIO rings, framebuffers).
+ */
+void vmm_guest_dedup_pin(struct vmm_guest *guest,
+			 physical_addr_t gphys_addr,
+			 physical_size_t phys_size);
+
+/** Free host RAM backing a guest memory range
+ *  Note: Deduplicated pages of the range are dropped and their
+ *  original host pages (already freed) are skipped.
+ */
+int vmm_guest_dedup_free(struct vmm_guest *guest,
+			 physical_addr_t gphys_addr,
+			 physical_addr_t hphys_addr,
+			 physical_size_t phys_size);
+
+/** Retrive page deduplication statistics of guest */
+int vmm_guest_dedup_get_stats(struct vmm_guest *guest,
+			      struct vmm_guest_dedup_stats *stats);
+
+/** Retrive number of shared host frames */
+u32 vmm_guest_dedup_frame_count(void);
+
+/** Retrive number of full scans of all guests */
+u64 vmm_guest_dedup_full_scans(void);
+
+/** Retrive number of pages scanned in each scanning round */
+u32 vmm_guest_dedup_pages_to_scan(void);
+
+/** Retrive sleep time (in milliseconds) between scanning rounds */
+u32 vmm_guest_dedup_sleep_msecs(void);
+
+/** Update scanning rate limits */
+int vmm_guest_dedup_set_rate(u32 pages_to_scan, u32 sleep_msecs);
+
+/** Initialize page deduplication */
+int vmm_guest_dedup_init(void);
+
+#else
+
+static inline int vmm_guest_dedup_attach(struct vmm_guest *guest)
+{
+	return VMM_OK;
+}
+
+static inline void vmm_guest_dedup_detach(struct vmm_guest *guest) {}
+
+static inline void vmm_guest_dedup_cleanup(struct vmm_guest *guest) {}
+
+static inline bool vmm_guest_dedup_enabled(struct vmm_guest *guest)
+{
+	return FALSE;
+}
+
+static inline int vmm_guest_dedup_fault(struct vmm_guest *guest,
+					physical_addr_t gphys_addr, bool write,
+					physical_addr_t *hphys_addr,
+					u32 *reg_flags)
+{
+	return VMM_ENOENT;
+}
+
+static inline void vmm_guest_dedup_access(struct vmm_guest *guest,
+					  physical_addr_t gphys_addr,
+					  bool write,
+					  physical_addr_t *hphys_addr,
+					  physical_size_t *avail_size) {}
+
+static inline void vmm_guest_dedup_access_begin(struct vmm_guest *guest) {}
+
+static inline void vmm_guest_dedup_access_end(struct vmm_guest *guest) {}
+
+static inline void vmm_guest_dedup_pin(struct vmm_guest *guest,
+				       physical_addr_t gphys_addr,
+				       physical_size_t phys_size) {}
+
+static inline int vmm_guest_dedup_free(struct vmm_guest *guest,
+				       physical_addr_t gphys_addr,
+				       physical_addr_t hphys_addr,
+				       physical_size_t phys_size)
+{
+	return vmm_host_ram_free(hphys_addr, phys_size);
+}
+
+static inline int vmm_guest_dedup_get_stats(struct vmm_guest *guest,
+					struct vmm_guest_dedup_stats *stats)
+{
+	return VMM_ENOTSUPP;
+}
+
+static inline u32 vmm_guest_dedup_frame_count(void)
+{
+	return 0;
+}
+
+static inline u64 vmm_guest_dedup_full_scans(void)
+{
+	return 0;
+}
+
+static inline u32 vmm_guest_dedup_pages_to_scan(void)
+{
+	return 0;
+}
+
+static inline u32 vmm_guest_dedup_sleep_msecs(void)
+{
+	return 0;
+}
+
+static inline int vmm_guest_dedup_set_rate(u32 pages_to_scan,
+					   u32 sleep_msecs)
+{
+	return VMM_ENOTSUPP;
+}
+
+#endif
+
+#endif
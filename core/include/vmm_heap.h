@@ -63,6 +63,63 @@ virtual_size_t vmm_normal_heap_free_size(void);
 /** Print Normal heap state */
 int vmm_normal_heap_print_state(struct vmm_chardev *cdev);
 
+/** Kmem cache (slab pool of fixed size objects on Normal heap)
+ *  Note: vmm_malloc() of sizes upto VMM_PAGE_SIZE is served from
+ *  built-in kmem caches of power-of-two sizes.
+ *  Note: each host CPU has a magazine of free objects per cache so
+ *  most alloc/free operations do not take any lock.
+ */
+struct vmm_kmem_cache;
+
+/** Kmem cache statistics */
+struct vmm_kmem_cache_stats {
+	u32 obj_size;
+	u32 objs_per_slab;
+	u32 slab_count;
+	u32 obj_total;
+	u32 obj_free;
+	u32 obj_cached;
+	u64 alloc_hit;
+	u64 alloc_miss;
+	u64 free_hit;
+	u64 free_flush;
+};
+
+/** Create a named kmem cache for objects of given size
+ *  Note: object size must not be more than VMM_PAGE_SIZE
+ */
+struct vmm_kmem_cache *vmm_kmem_cache_create(const char *name,
+					     virtual_size_t size);
+
+/** Destroy a kmem cache
+ *  Note: all objects must be freed before destroying cache
+ */
+int vmm_kmem_cache_destroy(struct vmm_kmem_cache *cache);
+
+/** Allocate object from kmem cache */
+void *vmm_kmem_cache_alloc(struct vmm_kmem_cache *cache);
+
+/** Allocate object from kmem cache and zero set */
+void *vmm_kmem_cache_zalloc(struct vmm_kmem_cache *cache);
+
+/** Free object to kmem cache
+ *  Note: vmm_free() on kmem cache object is also allowed
+ */
+void vmm_kmem_cache_free(struct vmm_kmem_cache *cache, void *obj);
+
+/** Retrieve name of a kmem cache */
+const char *vmm_kmem_cache_name(struct vmm_kmem_cache *cache);
+
+/** Retrieve statistics of a kmem cache */
+int vmm_kmem_cache_stats(struct vmm_kmem_cache *cache,
+			 struct vmm_kmem_cache_stats *stats);
+
+/** Retrieve kmem cache instance from index */
+struct vmm_kmem_cache *vmm_kmem_cache_get(int index);
+
+/** Count number of kmem caches */
+u32 vmm_kmem_cache_count(void);
+
 /** Possible DMA directions */
 enum vmm_dma_direction {
 	DMA_BIDIRECTIONAL = 0,
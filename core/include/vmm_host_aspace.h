@@ -118,6 +118,15 @@ virtual_addr_t vmm_host_memmap(physical_addr_t pa,
 			       virtual_size_t sz, 
 			       u32 mem_flags);
 
+/** Map physical memory to a virtual memory without panicking
+ *  Note: Returns error if virtual address space is exhausted or
+ *  physical memory is already mapped with different attributes
+ */
+int vmm_host_memmap_try(physical_addr_t pa,
+			virtual_size_t sz,
+			u32 mem_flags,
+			virtual_addr_t *va);
+
 /** Unmap virtual memory */
 int vmm_host_memunmap(virtual_addr_t va);
 
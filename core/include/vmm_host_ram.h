@@ -27,6 +27,12 @@
 #include <vmm_types.h>
 #include <vmm_limits.h>
 
+/** Any NUMA node (i.e. no placement preference) */
+#define VMM_HOST_RAM_NODE_ANY		U32_MAX
+
+/** Maximum number of host NUMA nodes */
+#define VMM_HOST_RAM_MAX_NODES		CONFIG_MAX_RAM_BANK_COUNT
+
 /** Host RAM cache color operations */
 struct vmm_host_ram_color_ops {
 	char name[VMM_FIELD_NAME_SIZE];
@@ -57,6 +63,18 @@ physical_size_t vmm_host_ram_alloc(physical_addr_t *pa,
 				   physical_size_t sz,
 				   u32 align_order);
 
+/** Allocate physical space from RAM banks of given NUMA node
+ *  Note: other RAM banks are tried if given NUMA node is full
+ */
+physical_size_t vmm_host_ram_node_alloc(physical_addr_t *pa,
+					physical_size_t sz,
+					u32 align_order, u32 node);
+
+/** Allocate physical space only from RAM banks of given NUMA node */
+physical_size_t vmm_host_ram_node_alloc_strict(physical_addr_t *pa,
+					       physical_size_t sz,
+					       u32 align_order, u32 node);
+
 /** Reserve a portion of RAM forcefully */
 int vmm_host_ram_reserve(physical_addr_t pa, physical_size_t sz);
 
@@ -90,6 +108,30 @@ u32 vmm_host_ram_bank_frame_count(u32 bank);
 /** Free frames of RAM Bank */
 u32 vmm_host_ram_bank_free_frames(u32 bank);
 
+/** NUMA node of RAM Bank */
+u32 vmm_host_ram_bank_node(u32 bank);
+
+/** Number of NUMA nodes (i.e. largest NUMA node of RAM Banks + 1) */
+u32 vmm_host_ram_node_count(void);
+
+/** Set NUMA node of a host CPU */
+void vmm_host_ram_set_cpu_node(u32 cpu, u32 node);
+
+/** NUMA node of a host CPU */
+u32 vmm_host_ram_cpu_node(u32 cpu);
+
+/** Retrive allocation counts of a NUMA node
+ *  Note: local allocations were placed on requested NUMA node
+ *  whereas remote allocations had to fallback to other NUMA node.
+ */
+void vmm_host_ram_node_stats(u32 node, u64 *local_allocs,
+			     u64 *remote_allocs);
+
+/** Assign NUMA nodes to RAM Banks based on device tree
+ *  Note: This function will be called after populating device tree
+ */
+int vmm_host_ram_numa_init(void);
+
 /** Estimate House-keeping size of RAM */
 virtual_size_t vmm_host_ram_estimate_hksize(void);
 
@@ -52,16 +52,44 @@ enum vmm_region_flags {
 	VMM_REGION_ISCOLORED=0x00002000,
 	VMM_REGION_ISSHARED=0x00004000,
 	VMM_REGION_ISDYNAMIC=0x00008000,
+	VMM_REGION_ISONDEMAND=0x00010000,
 };
 
 #define VMM_REGION_MANIFEST_MASK	(VMM_REGION_REAL | \
 					 VMM_REGION_VIRTUAL | \
 					 VMM_REGION_ALIAS)
 
+/** NUMA placement policy of host RAM backing a guest region */
+enum vmm_region_numa_policy {
+	/* Lowest RAM bank first */
+	VMM_REGION_NUMA_ANY=0,
+	/* NUMA node where most guest VCPUs are placed */
+	VMM_REGION_NUMA_LOCAL=1,
+	/* Round-robin over NUMA nodes for each region mapping */
+	VMM_REGION_NUMA_INTERLEAVE=2,
+	/* Explicit NUMA node */
+	VMM_REGION_NUMA_NODE=3,
+};
+
 enum vmm_region_mapping_flags {
 	VMM_REGION_MAPPING_ISHOSTRAM=0x00000001,
 };
 
+/** Guest memory statistics reported by balloon device
+ *  Note: same as VirtIO balloon statistics tags
+ */
+enum vmm_guest_balloon_stats {
+	VMM_GUEST_BALLOON_STAT_SWAP_IN=0,
+	VMM_GUEST_BALLOON_STAT_SWAP_OUT=1,
+	VMM_GUEST_BALLOON_STAT_MAJFLT=2,
+	VMM_GUEST_BALLOON_STAT_MINFLT=3,
+	VMM_GUEST_BALLOON_STAT_MEMFREE=4,
+	VMM_GUEST_BALLOON_STAT_MEMTOT=5,
+	VMM_GUEST_BALLOON_STAT_AVAIL=6,
+	VMM_GUEST_BALLOON_STAT_CACHES=7,
+	VMM_GUEST_BALLOON_STAT_MAX=8,
+};
+
 struct vmm_region;
 struct vmm_region_mapping;
 struct vmm_guest_aspace;
@@ -87,9 +115,12 @@ struct vmm_region {
 	u32 num_colors;
 	struct vmm_shmem *shm;
 	u32 align_order;
+	u32 numa_policy;
+	u32 numa_node;
 	u32 map_order;
 	u32 maps_count;
 	struct vmm_region_mapping *maps;
+	unsigned long *dirty_bitmap;
 	void *devemu_priv;
 	void *priv;
 };
@@ -115,6 +146,19 @@ struct vmm_guest_aspace {
 	vmm_rwlock_t reg_memtree_lock;
 	struct rb_root reg_memtree;
 	struct dlist reg_memprobe_list;
+	vmm_spinlock_t ondemand_lock;
+	atomic_t ondemand_inflight;
+	struct dlist ondemand_pending;
+	physical_size_t ondemand_resident;
+	physical_size_t ondemand_limit;
+	physical_size_t balloon_target;
+	physical_size_t balloon_size;
+	u64 balloon_stats[VMM_GUEST_BALLOON_STAT_MAX];
+	vmm_spinlock_t dirty_lock;
+	bool dirty_log;
+	u64 dirty_faults;
+	u64 dirty_fault_nsecs;
+	void *dedup_priv;
 	void *devemu_priv;
 };
 
@@ -154,6 +198,10 @@ struct vmm_guest {
 	u32 reset_count;
 	u64 reset_tstamp;
 
+	/* Users which need guest to stay alive (manager lock held) */
+	u32 ref_count;
+	bool destroying;
+
 	/* Request queue */
 	vmm_spinlock_t req_lock;
 	struct dlist req_list;
@@ -450,9 +498,19 @@ int vmm_manager_guest_shutdown_request(struct vmm_guest *guest);
 /** Create a Guest based on device tree configuration */
 struct vmm_guest *vmm_manager_guest_create(struct vmm_devtree_node *gnode);
 
-/** Destroy a Guest */
+/** Destroy a Guest
+ *  NOTE: This waits for all references of the Guest to be dropped.
+ */
 int vmm_manager_guest_destroy(struct vmm_guest *guest);
 
+/** Take a reference so that Guest is not destroyed while in use
+ *  NOTE: Fails if Guest is being destroyed.
+ */
+int vmm_manager_guest_ref(struct vmm_guest *guest);
+
+/** Drop a reference taken by vmm_manager_guest_ref() */
+void vmm_manager_guest_dref(struct vmm_guest *guest);
+
 /** Initialize manager */
 int vmm_manager_init(void);
 
@@ -27,9 +27,17 @@
 #include <vmm_types.h>
 #include <vmm_waitqueue.h>
 
-/** Mutex lock structure */
+/** Maximum time spent spinning on a mutex owned by a running VCPU */
+#define VMM_MUTEX_SPIN_NSECS	20000
+
+/** Mutex lock structure
+ *  Note: a waiter that finds the lock free but loses it to an optimistic
+ *  spinner sets handoff so that next unlock passes ownership directly to
+ *  the first sleeping waiter.
+ */
 struct vmm_mutex {
 	u32 lock;
+	bool handoff;
 	struct vmm_vcpu_resource res;
 	struct vmm_vcpu *owner;
 	struct vmm_waitqueue wq;
@@ -45,6 +53,7 @@ void __vmm_mutex_cleanup(struct vmm_vcpu *vcpu,
 #define INIT_MUTEX(__mut)	\
 do { \
 	(__mut)->lock = 0; \
+	(__mut)->handoff = FALSE; \
 	(__mut)->res.name = "vmm_mutex"; \
 	(__mut)->res.cleanup = __vmm_mutex_cleanup; \
 	(__mut)->owner = NULL; \
@@ -54,6 +63,7 @@ do { \
 #define __MUTEX_INITIALIZER(__mut) \
 { \
 	.lock = 0, \
+	.handoff = FALSE, \
 	.res = { .name = "vmm_mutex", .cleanup = __vmm_mutex_cleanup }, \
 	.owner = NULL, \
 	.wq = __WAITQUEUE_INITIALIZER((__mut).wq, &(__mut)), \
@@ -76,7 +86,11 @@ int vmm_mutex_unlock(struct vmm_mutex *mut);
  */
 int vmm_mutex_trylock(struct vmm_mutex *mut);
 
-/** Lock mutex */
+/** Lock mutex
+ *  Note: if the mutex is owned by a VCPU running on other host CPU
+ *  then we spin for a while (at most VMM_MUTEX_SPIN_NSECS) before
+ *  going to sleep.
+ */
 int vmm_mutex_lock(struct vmm_mutex *mut);
 
 /** Lock mutex with timeout */
@@ -71,4 +71,73 @@ struct vmm_profiler_stat *vmm_profiler_get_stat_array(void);
  */
 int vmm_profiler_init(void);
 
+#if defined(CONFIG_PROFILE_SAMPLE)
+
+#define VMM_PROFILE_SAMPLE_COUNT	CONFIG_PROFILE_SAMPLE_COUNT
+#define VMM_PROFILE_SAMPLE_DEPTH	CONFIG_PROFILE_SAMPLE_DEPTH
+#define VMM_PROFILE_SAMPLE_MIN_PERIOD	10000ULL
+#define VMM_PROFILE_SAMPLE_DEF_PERIOD	1000000ULL
+
+/** Context in which a sample was taken */
+enum vmm_profiler_sample_context {
+	VMM_PROFILE_SAMPLE_HYP=0,
+	VMM_PROFILE_SAMPLE_GUEST_EXIT=1,
+	VMM_PROFILE_SAMPLE_GUEST=2,
+	VMM_PROFILE_SAMPLE_IDLE=3,
+	VMM_PROFILE_SAMPLE_MAX=4
+};
+
+struct vmm_profiler_sample {
+	unsigned long pc;
+	u32 context;
+	u32 nr_frames;
+	unsigned long frames[VMM_PROFILE_SAMPLE_DEPTH];
+};
+
+/**
+ * Check status of sampling profiler.
+ * Called from somewhere (usually cmd_profile).
+ */
+bool vmm_profiler_sample_isactive(void);
+
+/**
+ * Start sampling profiler on all online host CPUs.
+ * The period_nsecs is sampling period and depth is number of
+ * stack frames to record for each hypervisor sample.
+ * Called from some where (usually cmd_profile).
+ */
+int vmm_profiler_sample_start(u64 period_nsecs, u32 depth);
+
+/**
+ * Stop sampling profiler on all online host CPUs.
+ * Called from some where (usually cmd_profile).
+ */
+int vmm_profiler_sample_stop(void);
+
+/** Sampling period (in nanoseconds) of last/current run */
+u64 vmm_profiler_sample_period(void);
+
+/** Stack depth of last/current run */
+u32 vmm_profiler_sample_depth(void);
+
+/** Number of samples recorded on given host CPU */
+u32 vmm_profiler_sample_count(u32 hcpu);
+
+/** Number of samples dropped (buffer full) on given host CPU */
+u64 vmm_profiler_sample_dropped(u32 hcpu);
+
+/**
+ * Get a sample recorded on given host CPU.
+ * Note: Samples should only be read when sampling is stopped.
+ */
+struct vmm_profiler_sample *vmm_profiler_sample_get(u32 hcpu, u32 index);
+
+/**
+ * Initialize sampling profiler.
+ * Called from vmm_init()
+ */
+int vmm_profiler_sample_init(void);
+
+#endif
+
 #endif
@@ -0,0 +1,116 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file vmm_rwsem.h
+ * @author agent (agent@local)
+ * @brief Header file of reader-writer semaphores for Orphan VCPU (or Thread).
+ *
+ * A reader-writer semaphore is a sleeping lock which allows multiple
+ * readers or a single writer. Waiting writers block new readers so
+ * that writers are not starved by a continuous stream of readers.
+ * Unlike vmm_mutex, it cannot be acquired recursively.
+ */
+
+#ifndef __VMM_RWSEM_H__
+#define __VMM_RWSEM_H__
+
+#include <vmm_types.h>
+#include <vmm_waitqueue.h>
+
+/** Maximum time spent spinning on a rwsem owned by a running writer */
+#define VMM_RWSEM_SPIN_NSECS	20000
+
+/** Reader-writer semaphore structure
+ *  Note: count is number of readers, -1 when owned by a writer
+ *  and 0 when free.
+ */
+struct vmm_rwsem {
+	s32 count;
+	u32 wait_writers;
+	struct vmm_vcpu_resource res;
+	struct vmm_vcpu *owner;
+	struct vmm_waitqueue wq;
+};
+
+/** Cleanup callback for rwsem when writer VCPU is destroyed
+ *  Note: This function should not be directly called from anywhere.
+ *  Note: readers are not tracked so a VCPU must not be destroyed
+ *  while holding a rwsem for reading.
+ */
+void __vmm_rwsem_cleanup(struct vmm_vcpu *vcpu,
+			 struct vmm_vcpu_resource *vcpu_res);
+
+/** Initialize reader-writer semaphore */
+#define INIT_RWSEM(__sem)	\
+do { \
+	(__sem)->count = 0; \
+	(__sem)->wait_writers = 0; \
+	(__sem)->res.name = "vmm_rwsem"; \
+	(__sem)->res.cleanup = __vmm_rwsem_cleanup; \
+	(__sem)->owner = NULL; \
+	INIT_WAITQUEUE(&(__sem)->wq, (__sem)); \
+} while (0)
+
+#define __RWSEM_INITIALIZER(__sem) \
+{ \
+	.count = 0, \
+	.wait_writers = 0, \
+	.res = { .name = "vmm_rwsem", .cleanup = __vmm_rwsem_cleanup }, \
+	.owner = NULL, \
+	.wq = __WAITQUEUE_INITIALIZER((__sem).wq, &(__sem)), \
+}
+
+#define DEFINE_RWSEM(__sem) \
+struct vmm_rwsem __sem = __RWSEM_INITIALIZER(__sem)
+
+/** Check if rwsem is free (neither readers nor writer) */
+bool vmm_rwsem_avail(struct vmm_rwsem *sem);
+
+/** Try to acquire rwsem for reading without sleeping
+ *  NOTE: Returns 1 upon success and 0 on failure
+ */
+int vmm_rwsem_down_read_trylock(struct vmm_rwsem *sem);
+
+/** Acquire rwsem for reading */
+int vmm_rwsem_down_read(struct vmm_rwsem *sem);
+
+/** Acquire rwsem for reading with timeout */
+int vmm_rwsem_down_read_timeout(struct vmm_rwsem *sem, u64 *timeout);
+
+/** Release rwsem acquired for reading */
+int vmm_rwsem_up_read(struct vmm_rwsem *sem);
+
+/** Try to acquire rwsem for writing without sleeping
+ *  NOTE: Returns 1 upon success and 0 on failure
+ */
+int vmm_rwsem_down_write_trylock(struct vmm_rwsem *sem);
+
+/** Acquire rwsem for writing
+ *  Note: if rwsem is owned by a writer running on other host CPU
+ *  then we spin for a while (at most VMM_RWSEM_SPIN_NSECS) before
+ *  going to sleep.
+ */
+int vmm_rwsem_down_write(struct vmm_rwsem *sem);
+
+/** Acquire rwsem for writing with timeout */
+int vmm_rwsem_down_write_timeout(struct vmm_rwsem *sem, u64 *timeout);
+
+/** Release rwsem acquired for writing */
+int vmm_rwsem_up_write(struct vmm_rwsem *sem);
+
+#endif /* __VMM_RWSEM_H__ */
@@ -62,6 +62,11 @@ void vmm_scheduler_irq_exit(arch_regs_t *regs);
 /** Check whether we are in IRQ context */
 bool vmm_scheduler_irq_context(void);
 
+/** Retrive register state saved upon entering IRQ context
+ *  Note: This returns NULL outside IRQ context
+ */
+arch_regs_t *vmm_scheduler_irq_regs(void);
+
 /** Check whether we are in Orphan VCPU context */
 bool vmm_scheduler_orphan_context(void);
 
@@ -27,10 +27,19 @@
 #include <vmm_types.h>
 #include <vmm_waitqueue.h>
 
-/** Semaphore lock structure */
+/** Maximum time spent spinning on a semaphore held by a running VCPU */
+#define VMM_SEMAPHORE_SPIN_NSECS	20000
+
+/** Semaphore lock structure
+ *  Note: a waiter that was woken up but lost the semaphore to somebody
+ *  else sets starving so that next release reserves one count for the
+ *  first sleeping waiter (the handoff VCPU).
+ */
 struct vmm_semaphore {
 	u32 limit;
 	u32 value;
+	bool starving;
+	struct vmm_vcpu *handoff;
 	struct dlist res_list;
 	struct vmm_waitqueue wq;
 };
@@ -40,6 +49,8 @@ struct vmm_semaphore {
 do { \
 	(__sem)->limit = (__lim); \
 	(__sem)->value = (__val); \
+	(__sem)->starving = FALSE; \
+	(__sem)->handoff = NULL; \
 	INIT_LIST_HEAD(&((__sem)->res_list)); \
 	INIT_WAITQUEUE(&(__sem)->wq, (__sem)); \
 } while (0)
@@ -48,6 +59,8 @@ do { \
 { \
 	.limit = (__lim), \
 	.value = (__val), \
+	.starving = FALSE, \
+	.handoff = NULL, \
 	.res_list = { &(__sem).res_list, &(__sem).res_list }, \
 	.wq = __WAITQUEUE_INITIALIZER((__sem).wq, &(__sem)), \
 }
@@ -64,7 +77,11 @@ u32 vmm_semaphore_limit(struct vmm_semaphore *sem);
 /** Release (or increment) semaphore */
 int vmm_semaphore_up(struct vmm_semaphore *sem);
 
-/** Acquire (or decrement) semaphore */
+/** Acquire (or decrement) semaphore
+ *  Note: if semaphore is not available and some holder VCPU is running
+ *  on other host CPU then we spin for a while (at most
+ *  VMM_SEMAPHORE_SPIN_NSECS) before going to sleep.
+ */
 int vmm_semaphore_down(struct vmm_semaphore *sem);
 
 /** Acquire (or decrement) semaphore with timeout */
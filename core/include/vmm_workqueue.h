@@ -35,18 +35,43 @@ enum {
 	VMM_WORK_STATE_INPROGRESS=0x4,
 };
 
+enum {
+	VMM_WORKQUEUE_PERCPU=0x1,
+	VMM_WORKQUEUE_UNBOUND=0x2,
+};
+
 struct vmm_work;
 typedef void (*vmm_work_func_t)(struct vmm_work *work);
 struct vmm_workqueue;
+struct vmm_workqueue_pool;
 
 struct vmm_work {
 	vmm_spinlock_t lock;
 	struct dlist head;
 	u32 flags;
 	struct vmm_workqueue *wq;
+	struct vmm_workqueue_pool *pool;
+	u64 tstamp;
 	vmm_work_func_t func;
 };
 
+/** Workqueue statistics
+ *  Note: latency is the time between scheduling a work and the
+ *  start of its execution whereas exec is the time taken by work
+ *  function itself. All times are in nanoseconds.
+ */
+struct vmm_workqueue_stats {
+	u64 queued;
+	u64 executed;
+	u64 stolen;
+	u32 depth;
+	u32 max_depth;
+	u64 total_latency;
+	u64 max_latency;
+	u64 total_exec;
+	u64 max_exec;
+};
+
 struct vmm_delayed_work {
 	struct vmm_work work;
 	struct vmm_timer_event event;
@@ -57,6 +82,8 @@ struct vmm_delayed_work {
 				INIT_LIST_HEAD(&(w)->head); \
 				(w)->flags = VMM_WORK_STATE_CREATED; \
 				(w)->wq = NULL; \
+				(w)->pool = NULL; \
+				(w)->tstamp = 0; \
 				(w)->func = _f; \
 				} while (0)
 
@@ -70,6 +97,8 @@ struct vmm_delayed_work {
 	.flags = VMM_WORK_STATE_CREATED,				\
 	.head	= { &(n).head, &(n).head },				\
 	.wq = NULL,							\
+	.pool = NULL,							\
+	.tstamp = 0,							\
 	.func = (f),							\
 	}
 
@@ -126,9 +155,28 @@ int vmm_workqueue_stop_delayed_work(struct vmm_delayed_work *work);
 /** Forcefully flush all pending work in a workqueue */
 int vmm_workqueue_flush(struct vmm_workqueue *wq);
 
-/** Retrive workqueue instance from workqueue index */
+/** Retrive first worker thread of a workqueue */
 struct vmm_thread *vmm_workqueue_get_thread(struct vmm_workqueue *wq);
 
+/** Retrive name of a workqueue */
+const char *vmm_workqueue_get_name(struct vmm_workqueue *wq);
+
+/** Retrive creation flags of a workqueue */
+u32 vmm_workqueue_get_flags(struct vmm_workqueue *wq);
+
+/** Count number of worker threads serving a workqueue */
+u32 vmm_workqueue_worker_count(struct vmm_workqueue *wq);
+
+/** Retrive statistics of a workqueue (summed over all worker pools) */
+int vmm_workqueue_get_stats(struct vmm_workqueue *wq,
+			    struct vmm_workqueue_stats *stats);
+
+/** Retrive system-wide per-CPU workqueue
+ *  Note: work scheduled on this workqueue is queued on the local
+ *  CPU but can be stolen by idle workers of other CPUs.
+ */
+struct vmm_workqueue *vmm_workqueue_system_percpu(void);
+
 /** Retrive workqueue instance from workqueue index */
 struct vmm_workqueue *vmm_workqueue_index2workqueue(int index);
 
@@ -138,6 +186,20 @@ u32 vmm_workqueue_count(void);
 /** Destroy workqueue */
 int vmm_workqueue_destroy(struct vmm_workqueue *wq);
 
+/** Create workqueue with given name, thread priority and flags
+ *  Note: with flags zero the workqueue has a single worker thread
+ *  so work is executed in order of scheduling.
+ *  Note: VMM_WORKQUEUE_PERCPU creates one worker pool pinned to
+ *  each online CPU. Work is queued on the local CPU and idle workers
+ *  steal pending work from busy CPUs.
+ *  Note: VMM_WORKQUEUE_UNBOUND creates one shared queue served by
+ *  one unpinned worker thread per online CPU.
+ *  Note: a work is never executed concurrently with itself on the
+ *  same workqueue irrespective of flags.
+ */
+struct vmm_workqueue *vmm_workqueue_create_flags(const char *name,
+						 u8 priority, u32 flags);
+
 /** Create workqueue with given name and thread priority */
 struct vmm_workqueue *vmm_workqueue_create(const char *name, u8 priority);
 
@@ -58,6 +58,7 @@ core-objs-y+= vmm_waitqueue.o
 core-objs-y+= vmm_completion.o
 core-objs-y+= vmm_semaphore.o
 core-objs-y+= vmm_mutex.o
+core-objs-y+= vmm_rwsem.o
 core-objs-y+= vmm_notifier.o
 core-objs-y+= vmm_workqueue.o
 core-objs-y+= vmm_cmdmgr.o
@@ -67,5 +68,7 @@ core-objs-y+= vmm_chardev.o
 core-objs-y+= vmm_modules.o
 core-objs-y+= vmm_params.o
 core-objs-$(CONFIG_PROFILE)+= vmm_profiler.o
+core-objs-$(CONFIG_PROFILE_SAMPLE)+= vmm_profiler_sample.o
 core-objs-$(CONFIG_LOADBAL)+= vmm_loadbal.o
+core-objs-$(CONFIG_GUEST_DEDUP)+= vmm_guest_dedup.o
 core-objs-y+= vmm_extable.o
@@ -73,6 +73,7 @@ static void vdisk_req_completed(struct vmm_request *r)
 			container_of(r, struct vmm_vdisk_request, r);
 	struct vmm_vdisk *vdisk = vreq->vdisk;
 
+	vmm_blockdev_stats_done(vdisk->stats, r, vreq->data_len, FALSE);
 	if (vdisk->completed) {
 		vdisk->completed(vdisk, vreq);
 	}
@@ -87,6 +88,7 @@ static void vdisk_req_failed(struct vmm_request *r)
 			container_of(r, struct vmm_vdisk_request, r);
 	struct vmm_vdisk *vdisk = vreq->vdisk;
 
+	vmm_blockdev_stats_done(vdisk->stats, r, vreq->data_len, TRUE);
 	if (vdisk->failed) {
 		vdisk->failed(vdisk, vreq);
 	}
@@ -109,6 +111,12 @@ void vmm_vdisk_set_request_type(struct vmm_vdisk_request *vreq,
 	case VMM_VDISK_REQUEST_WRITE:
 		vreq->r.type = VMM_REQUEST_WRITE;
 		break;
+	case VMM_VDISK_REQUEST_DISCARD:
+		vreq->r.type = VMM_REQUEST_DISCARD;
+		break;
+	case VMM_VDISK_REQUEST_WRITE_ZEROES:
+		vreq->r.type = VMM_REQUEST_WRITE_ZEROES;
+		break;
 	default:
 		vreq->r.type = VMM_REQUEST_UNKNOWN;
 		break;
@@ -131,6 +139,12 @@ enum vmm_vdisk_request_type vmm_vdisk_get_request_type(
 	case VMM_REQUEST_WRITE:
 		type = VMM_VDISK_REQUEST_WRITE;
 		break;
+	case VMM_REQUEST_DISCARD:
+		type = VMM_VDISK_REQUEST_DISCARD;
+		break;
+	case VMM_REQUEST_WRITE_ZEROES:
+		type = VMM_VDISK_REQUEST_WRITE_ZEROES;
+		break;
 	default:
 		type = VMM_VDISK_REQUEST_UNKNOWN;
 		break;
@@ -184,14 +198,18 @@ int vmm_vdisk_submit_request(struct vmm_vdisk *vdisk,
 	int rc;
 	irq_flags_t flags;
 
-	if (!vdisk || !vreq || !data) {
+	if (!vdisk || !vreq) {
+		return VMM_EINVALID;
+	}
+	if (!data && ((type == VMM_VDISK_REQUEST_READ) ||
+		      (type == VMM_VDISK_REQUEST_WRITE))) {
 		return VMM_EINVALID;
 	}
 	if (data_len < vdisk->block_size) {
 		return VMM_EINVALID;
 	}
 	if ((type < VMM_VDISK_REQUEST_READ) ||
-	    (VMM_VDISK_REQUEST_WRITE < type)) {
+	    (VMM_VDISK_REQUEST_WRITE_ZEROES < type)) {
 		return VMM_EINVALID;
 	}
 
@@ -202,11 +220,19 @@ int vmm_vdisk_submit_request(struct vmm_vdisk *vdisk,
 		vreq->r.lba = (lba + vdisk->blk->start_lba) * vdisk->blk_factor;
 		vreq->r.bcnt =
 			udiv32(data_len, vdisk->block_size) * vdisk->blk_factor;
+		vreq->r.flags &= VMM_REQUEST_FLAG_FUA;
 		vreq->r.data = data;
 		vreq->r.completed = vdisk_req_completed;
 		vreq->r.failed = vdisk_req_failed;
 		vreq->r.priv = NULL;
+		vreq->data_len = data_len;
+		vmm_blockdev_stats_start(vdisk->stats);
 		rc = vmm_blockdev_submit_request(vdisk->blk, &vreq->r);
+		if (rc) {
+			/* Rejected request never reaches our callbacks */
+			vmm_blockdev_stats_done(vdisk->stats, &vreq->r,
+						0, TRUE);
+		}
 	} else {
 		vdisk->failed(vdisk, vreq);
 		rc = VMM_ENODEV;
@@ -234,12 +260,13 @@ int vmm_vdisk_abort_request(struct vmm_vdisk *vdisk,
 	}
 
 	vmm_spin_lock_irqsave_lite(&vdisk->blk_lock, flags);
-	if (vdisk->blk) {
+	rc = (vdisk->blk) ? VMM_OK : VMM_ENODEV;
+	vmm_spin_unlock_irqrestore_lite(&vdisk->blk_lock, flags);
+
+	/* Abort might wait for block device so don't hold blk_lock */
+	if (!rc) {
 		rc = vmm_blockdev_abort_request(&vreq->r);
-	} else {
-		rc = VMM_ENODEV;
 	}
-	vmm_spin_unlock_irqrestore_lite(&vdisk->blk_lock, flags);
 
 	DPRINTF("%s: vdisk=%s lba=0x%llx bcnt=%d rc=%d\n",
 		__func__, vdisk->name, (u64)vreq->r.lba, vreq->r.bcnt, rc);
@@ -272,6 +299,19 @@ int vmm_vdisk_flush_cache(struct vmm_vdisk *vdisk)
 }
 VMM_EXPORT_SYMBOL(vmm_vdisk_flush_cache);
 
+int vmm_vdisk_get_stats(struct vmm_vdisk *vdisk,
+			struct vmm_blockdev_stats *out)
+{
+	if (!vdisk || !out) {
+		return VMM_EINVALID;
+	}
+
+	vmm_blockdev_stats_sum(vdisk->stats, out);
+
+	return VMM_OK;
+}
+VMM_EXPORT_SYMBOL(vmm_vdisk_get_stats);
+
 u64 vmm_vdisk_capacity(struct vmm_vdisk *vdisk)
 {
 	u64 ret = 0;
@@ -435,6 +475,12 @@ struct vmm_vdisk *vmm_vdisk_create(const char *name, u32 block_size,
 		vmm_mutex_unlock(&vdctrl.vdisk_list_lock);
 		return NULL;
 	}
+	vdisk->stats = vmm_blockdev_stats_alloc();
+	if (!vdisk->stats) {
+		vmm_free(vdisk);
+		vmm_mutex_unlock(&vdctrl.vdisk_list_lock);
+		return NULL;
+	}
 	vdisk->block_size = block_size;
 	vdisk->attached = attached;
 	vdisk->detached = detached;
@@ -504,6 +550,7 @@ int vmm_vdisk_destroy(struct vmm_vdisk *vdisk)
 
 	list_del(&vd->head);
 
+	vmm_blockdev_stats_free(vd->stats);
 	vmm_free(vd);
 
 	vmm_mutex_unlock(&vdctrl.vdisk_list_lock);
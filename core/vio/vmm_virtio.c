@@ -28,6 +28,7 @@
 #include <vmm_stdio.h>
 #include <vmm_host_io.h>
 #include <vmm_guest_aspace.h>
+#include <vmm_guest_dedup.h>
 #include <vmm_modules.h>
 #include <vio/vmm_virtio.h>
 #include <libs/mathlib.h>
@@ -342,6 +343,9 @@ int vmm_virtio_queue_setup(struct vmm_virtio_queue *vq,
 	gphys_addr = guest_pfn * guest_page_size;
 	gphys_size = vmm_vring_size(desc_count, align);
 
+	/* Host address of vring is used till queue cleanup */
+	vmm_guest_dedup_pin(guest, gphys_addr, gphys_size);
+
 	if ((rc = vmm_guest_physical_map(guest, gphys_addr, gphys_size,
 					 &hphys_addr, &avail_size,
 					 &reg_flags))) {
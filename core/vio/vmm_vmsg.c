@@ -43,6 +43,8 @@ struct vmm_vmsg_control {
 	DECLARE_IDA(node_ida);
 	struct vmm_blocking_notifier_chain notifier_chain;
 	struct vmm_vmsg_domain *default_domain;
+	struct vmm_kmem_cache *msg_cache;
+	struct vmm_kmem_cache *work_cache;
 };
 
 static struct vmm_vmsg_control vmctrl;
@@ -86,7 +88,7 @@ VMM_EXPORT_SYMBOL(vmm_vmsg_dref);
 static void vmsg_release(struct vmm_vmsg *msg)
 {
 	vmm_free(msg->data);
-	vmm_free(msg);
+	vmm_kmem_cache_free(vmctrl.msg_cache, msg);
 }
 
 struct vmm_vmsg *vmm_vmsg_alloc(u32 dst, u32 src, size_t len)
@@ -103,7 +105,7 @@ struct vmm_vmsg *vmm_vmsg_alloc(u32 dst, u32 src, size_t len)
 		return NULL;
 	}
 
-	msg = vmm_zalloc(sizeof(*msg));
+	msg = vmm_kmem_cache_zalloc(vmctrl.msg_cache);
 	if (!msg) {
 		vmm_free(data);
 		return NULL;
@@ -139,7 +141,7 @@ static int vmsg_domain_enqueue_work(struct vmm_vmsg_domain *domain,
 		return VMM_EINVALID;
 	}
 
-	work = vmm_zalloc(sizeof(*work));
+	work = vmm_kmem_cache_zalloc(vmctrl.work_cache);
 	if (!work) {
 		return VMM_ENOMEM;
 	}
@@ -196,7 +198,7 @@ static int vmsg_domain_worker_main(void *data)
 			work->msg = NULL;
 		}
 
-		vmm_free(work);
+		vmm_kmem_cache_free(vmctrl.work_cache, work);
 	}
 
 	return VMM_OK;
@@ -370,7 +372,7 @@ static int vmsg_node_stop_work(struct vmm_vmsg_node *node,
 		    (work->data1 == fn) &&
 		    (work->msg == NULL)) {
 			list_del(&work->head);
-			vmm_free(work);
+			vmm_kmem_cache_free(vmctrl.work_cache, work);
 		}
 	}
 
@@ -920,8 +922,23 @@ static int __init vmm_vmsg_init(void)
 	INIT_IDA(&vmctrl.node_ida);
 	BLOCKING_INIT_NOTIFIER_CHAIN(&vmctrl.notifier_chain);
 
+	vmctrl.msg_cache = vmm_kmem_cache_create("vmsg",
+						 sizeof(struct vmm_vmsg));
+	if (!vmctrl.msg_cache) {
+		return VMM_ENOMEM;
+	}
+
+	vmctrl.work_cache = vmm_kmem_cache_create("vmsg_work",
+						  sizeof(struct vmsg_work));
+	if (!vmctrl.work_cache) {
+		vmm_kmem_cache_destroy(vmctrl.msg_cache);
+		return VMM_ENOMEM;
+	}
+
 	vmctrl.default_domain = vmm_vmsg_domain_create("vmsg_default", NULL);
 	if (!vmctrl.default_domain) {
+		vmm_kmem_cache_destroy(vmctrl.work_cache);
+		vmm_kmem_cache_destroy(vmctrl.msg_cache);
 		return VMM_ENOMEM;
 	}
 
@@ -1125,6 +1125,66 @@ int vmm_devemu_reset_region(struct vmm_guest *guest,
 	return devemu_reset_edev(guest, edev);
 }
 
+static struct vmm_emudev *devemu_state_edev(struct vmm_region *reg)
+{
+	struct vmm_emudev *edev;
+
+	if (!reg || !reg->devemu_priv ||
+	    !(reg->flags & VMM_REGION_ISDEVICE) ||
+	    (reg->flags & VMM_REGION_ALIAS)) {
+		return NULL;
+	}
+
+	edev = (struct vmm_emudev *)reg->devemu_priv;
+	if (!edev->emu->state_size ||
+	    !edev->emu->state_save ||
+	    !edev->emu->state_restore) {
+		return NULL;
+	}
+
+	return edev;
+}
+
+u32 vmm_devemu_state_size(struct vmm_guest *guest,
+			  struct vmm_region *reg)
+{
+	struct vmm_emudev *edev = devemu_state_edev(reg);
+
+	return (edev) ? edev->emu->state_size(edev) : 0;
+}
+
+int vmm_devemu_state_save(struct vmm_guest *guest,
+			  struct vmm_region *reg,
+			  void *buf, u32 size)
+{
+	struct vmm_emudev *edev = devemu_state_edev(reg);
+
+	if (!edev) {
+		return VMM_ENOTSUPP;
+	}
+	if (!buf || (size != edev->emu->state_size(edev))) {
+		return VMM_EINVALID;
+	}
+
+	return edev->emu->state_save(edev, buf, size);
+}
+
+int vmm_devemu_state_restore(struct vmm_guest *guest,
+			     struct vmm_region *reg,
+			     const void *buf, u32 size)
+{
+	struct vmm_emudev *edev = devemu_state_edev(reg);
+
+	if (!edev) {
+		return VMM_ENOTSUPP;
+	}
+	if (!buf || (size != edev->emu->state_size(edev))) {
+		return VMM_EINVALID;
+	}
+
+	return edev->emu->state_restore(edev, buf, size);
+}
+
 static int devemu_remove_edev(struct vmm_guest *guest,
 			      struct vmm_emudev *edev)
 {
@@ -32,11 +32,16 @@
 #include <vmm_host_ram.h>
 #include <vmm_host_aspace.h>
 #include <vmm_guest_aspace.h>
+#include <vmm_guest_dedup.h>
 #include <vmm_stdio.h>
 #include <vmm_notifier.h>
+#include <vmm_timer.h>
+#include <arch_atomic.h>
+#include <arch_barrier.h>
 #include <arch_guest.h>
 #include <libs/stringlib.h>
 #include <libs/mathlib.h>
+#include <libs/bitmap.h>
 
 static BLOCKING_NOTIFIER_CHAIN(guest_aspace_notifier_chain);
 
@@ -231,11 +236,282 @@ static struct vmm_region_mapping *mapping_find(struct vmm_guest *guest,
 	return &reg->maps[i];
 }
 
-void vmm_guest_find_mapping(struct vmm_guest *guest,
-			    struct vmm_region *reg,
-			    physical_addr_t gphys_addr,
-			    physical_addr_t *hphys_addr,
-			    physical_size_t *avail_size)
+/*
+ * Host RAM alignments tried for alloced RAM/ROM regions without explicit
+ * align_order so that stage2 can use huge blocks (i.e. 1GB and 2MB)
+ */
+static const u32 alloced_align_orders[] = { 30, 21 };
+
+static u32 mapping_numa_node(struct vmm_region *reg, u32 map_index)
+{
+	switch (reg->numa_policy) {
+	case VMM_REGION_NUMA_LOCAL:
+	case VMM_REGION_NUMA_NODE:
+		return reg->numa_node;
+	case VMM_REGION_NUMA_INTERLEAVE:
+		return umod32(reg->numa_node + map_index,
+			      vmm_host_ram_node_count());
+	default:
+		break;
+	};
+
+	return VMM_HOST_RAM_NODE_ANY;
+}
+
+static physical_size_t mapping_alloced_alloc(struct vmm_region *reg,
+					     u32 map_index)
+{
+	u32 i, pass, order, node = mapping_numa_node(reg, map_index);
+	physical_size_t size = mapping_phys_size(reg, map_index);
+	physical_addr_t gpa = reg->gphys_addr +
+			      mapping_gphys_offset(reg, map_index);
+	physical_addr_t *hpa = &reg->maps[map_index].hphys_addr;
+
+	if (reg->align_order) {
+		return vmm_host_ram_node_alloc(hpa, size,
+					       reg->align_order, node);
+	}
+
+	/*
+	 * Host and guest addresses have to be equally aligned for a
+	 * block to be usable so skip alignments which the guest address
+	 * or mapping size can't benefit from. If host RAM is too
+	 * fragmented then fallback to smaller alignment. All alignments
+	 * are tried on preferred NUMA node (first pass) before falling
+	 * back to other NUMA nodes (second pass).
+	 */
+	pass = (node == VMM_HOST_RAM_NODE_ANY) ? 1 : 0;
+	for (; pass < 2; pass++) {
+		for (i = 0; i <= array_size(alloced_align_orders); i++) {
+			order = (i < array_size(alloced_align_orders)) ?
+				alloced_align_orders[i] : VMM_PAGE_SHIFT;
+			if ((BITS_PER_LONG <= order) ||
+			    (size < order_size(order)) ||
+			    (gpa & order_mask(order))) {
+				continue;
+			}
+			if (!pass &&
+			    vmm_host_ram_node_alloc_strict(hpa, size,
+							   order, node)) {
+				return size;
+			}
+			if (pass &&
+			    vmm_host_ram_node_alloc(hpa, size, order, node)) {
+				return size;
+			}
+		}
+	}
+
+	return 0;
+}
+
+int __weak arch_guest_unmap_region(struct vmm_guest *guest,
+				   struct vmm_region *region,
+				   physical_addr_t gphys_addr,
+				   physical_size_t phys_size)
+{
+	return VMM_ENOTSUPP;
+}
+
+int __weak arch_guest_write_protect_region(struct vmm_guest *guest,
+					   struct vmm_region *region,
+					   physical_addr_t gphys_addr,
+					   physical_size_t phys_size)
+{
+	return VMM_ENOTSUPP;
+}
+
+/* Default mapping order of on-demand RAM regions (i.e. 2MB chunks) */
+#define ONDEMAND_MAP_ORDER		21
+
+/* Default mapping order of NUMA interleaved regions (i.e. 2MB chunks) */
+#define INTERLEAVE_MAP_ORDER		21
+
+static int mapping_ondemand_populate(struct vmm_guest *guest,
+				     struct vmm_region *reg, u32 map_index)
+{
+	irq_flags_t flags;
+	physical_addr_t hpa;
+	u32 align_order = reg->map_order;
+	physical_size_t size = mapping_phys_size(reg, map_index);
+	struct vmm_region_mapping *map = &reg->maps[map_index];
+	struct vmm_guest_aspace *aspace = &guest->aspace;
+
+	if (map->flags & VMM_REGION_MAPPING_ISHOSTRAM) {
+		arch_smp_rmb();
+		return VMM_OK;
+	}
+
+	/* Charge the chunk upfront so that resident limit is never crossed */
+	vmm_spin_lock_irqsave_lite(&aspace->ondemand_lock, flags);
+	if (aspace->ondemand_limit &&
+	    (aspace->ondemand_limit < (aspace->ondemand_resident + size))) {
+		vmm_spin_unlock_irqrestore_lite(&aspace->ondemand_lock, flags);
+		return VMM_ENOMEM;
+	}
+	aspace->ondemand_resident += size;
+	vmm_spin_unlock_irqrestore_lite(&aspace->ondemand_lock, flags);
+
+	/* Last chunk of region can be smaller than mapping size */
+	if (size & order_mask(align_order)) {
+		align_order = VMM_PAGE_SHIFT;
+	}
+
+	if (!vmm_host_ram_node_alloc(&hpa, size, align_order,
+				     mapping_numa_node(reg, map_index))) {
+		vmm_spin_lock_irqsave_lite(&aspace->ondemand_lock, flags);
+		aspace->ondemand_resident -= size;
+		vmm_spin_unlock_irqrestore_lite(&aspace->ondemand_lock, flags);
+		return VMM_ENOMEM;
+	}
+	vmm_host_memory_set(hpa, 0, size, FALSE);
+
+	/* Some other VCPU or emulator might have populated it meanwhile */
+	vmm_spin_lock_irqsave_lite(&aspace->ondemand_lock, flags);
+	if (map->flags & VMM_REGION_MAPPING_ISHOSTRAM) {
+		aspace->ondemand_resident -= size;
+		vmm_spin_unlock_irqrestore_lite(&aspace->ondemand_lock, flags);
+		vmm_host_ram_free(hpa, size);
+		return VMM_OK;
+	}
+	map->hphys_addr = hpa;
+	arch_smp_wmb();
+	map->flags |= VMM_REGION_MAPPING_ISHOSTRAM;
+	vmm_spin_unlock_irqrestore_lite(&aspace->ondemand_lock, flags);
+
+	return VMM_OK;
+}
+
+/* Host RAM of released on-demand chunk waiting for in-flight accesses */
+struct ondemand_pending {
+	struct dlist head;
+	struct vmm_region *reg;
+	physical_addr_t gphys_addr;
+	physical_addr_t hphys_addr;
+	physical_size_t size;
+};
+
+/*
+ * Free host RAM of released on-demand chunks. Without a region, only
+ * done when no host access is in-flight because accesses which started
+ * before a release might still use the old host address. With a region,
+ * chunks of that region are freed unconditionally (region is going away).
+ */
+static void mapping_ondemand_reap(struct vmm_guest *guest,
+				  struct vmm_region *reg)
+{
+	irq_flags_t flags;
+	struct ondemand_pending *p, *p_next;
+	struct vmm_guest_aspace *aspace = &guest->aspace;
+	LIST_HEAD(reap_list);
+
+	vmm_spin_lock_irqsave_lite(&aspace->ondemand_lock, flags);
+	arch_smp_mb();
+	if (!reg && arch_atomic_read(&aspace->ondemand_inflight)) {
+		vmm_spin_unlock_irqrestore_lite(&aspace->ondemand_lock, flags);
+		return;
+	}
+	list_for_each_entry_safe(p, p_next, &aspace->ondemand_pending, head) {
+		if (reg && (p->reg != reg)) {
+			continue;
+		}
+		list_del(&p->head);
+		list_add_tail(&p->head, &reap_list);
+	}
+	vmm_spin_unlock_irqrestore_lite(&aspace->ondemand_lock, flags);
+
+	while (!list_empty(&reap_list)) {
+		p = list_entry(list_pop(&reap_list),
+			       struct ondemand_pending, head);
+		/* Drop stage2 mapping created by a fault racing the release */
+		if (!reg) {
+			arch_guest_unmap_region(guest, p->reg,
+						p->gphys_addr, p->size);
+		}
+		vmm_guest_dedup_free(guest, p->gphys_addr,
+				     p->hphys_addr, p->size);
+		vmm_free(p);
+	}
+}
+
+static physical_size_t mapping_ondemand_release(struct vmm_guest *guest,
+						struct vmm_region *reg,
+						u32 map_index, bool unmap)
+{
+	irq_flags_t flags;
+	struct ondemand_pending *p;
+	physical_size_t size = mapping_phys_size(reg, map_index);
+	struct vmm_region_mapping *map = &reg->maps[map_index];
+	struct vmm_guest_aspace *aspace = &guest->aspace;
+
+	p = vmm_zalloc(sizeof(*p));
+	if (!p) {
+		return 0;
+	}
+	p->reg = reg;
+	p->gphys_addr = reg->gphys_addr + mapping_gphys_offset(reg, map_index);
+	p->size = size;
+
+	/*
+	 * Stage2 mappings are removed before clearing the chunk so that
+	 * guest does not keep using it. A host access or stage2 fault
+	 * which looked up the chunk before it was cleared can still be
+	 * using the old host address hence the host RAM is only freed
+	 * by mapping_ondemand_reap() after such accesses have ended.
+	 */
+	vmm_spin_lock_irqsave_lite(&aspace->ondemand_lock, flags);
+	if (!(map->flags & VMM_REGION_MAPPING_ISHOSTRAM) ||
+	    (unmap &&
+	     arch_guest_unmap_region(guest, reg, p->gphys_addr, size))) {
+		vmm_spin_unlock_irqrestore_lite(&aspace->ondemand_lock, flags);
+		vmm_free(p);
+		return 0;
+	}
+	p->hphys_addr = map->hphys_addr;
+	map->flags &= ~VMM_REGION_MAPPING_ISHOSTRAM;
+	map->hphys_addr = 0;
+	aspace->ondemand_resident -= size;
+	list_add_tail(&p->head, &aspace->ondemand_pending);
+	vmm_spin_unlock_irqrestore_lite(&aspace->ondemand_lock, flags);
+
+	mapping_ondemand_reap(guest, (unmap) ? NULL : reg);
+
+	return size;
+}
+
+void vmm_guest_memory_access_begin(struct vmm_guest *guest)
+{
+	if (!guest) {
+		return;
+	}
+
+	arch_atomic_add(&guest->aspace.ondemand_inflight, 1);
+	arch_smp_mb();
+
+	vmm_guest_dedup_access_begin(guest);
+}
+
+void vmm_guest_memory_access_end(struct vmm_guest *guest)
+{
+	if (!guest) {
+		return;
+	}
+
+	vmm_guest_dedup_access_end(guest);
+
+	arch_smp_mb();
+	arch_atomic_sub(&guest->aspace.ondemand_inflight, 1);
+
+	if (!list_empty(&guest->aspace.ondemand_pending)) {
+		mapping_ondemand_reap(guest, NULL);
+	}
+}
+
+static void mapping_find_hphys(struct vmm_guest *guest,
+			       struct vmm_region *reg,
+			       physical_addr_t gphys_addr, bool write,
+			       physical_addr_t *hphys_addr,
+			       physical_size_t *avail_size)
 {
 	u32 i;
 	physical_addr_t map_gphys_addr;
@@ -251,11 +527,18 @@ void vmm_guest_find_mapping(struct vmm_guest *guest,
 	if (!map) {
 		goto done;
 	}
+	if ((reg->flags & VMM_REGION_ISONDEMAND) &&
+	    mapping_ondemand_populate(guest, reg, i)) {
+		goto done;
+	}
 	map_gphys_addr = reg->gphys_addr + mapping_gphys_offset(reg, i);
 
 	hphys = map->hphys_addr + (gphys_addr - map_gphys_addr);
 	size = map->hphys_addr + mapping_phys_size(reg, i) - hphys;
 
+	/* Deduplicated pages are not backed by region mapping */
+	vmm_guest_dedup_access(guest, gphys_addr, write, &hphys, &size);
+
 done:
 	if (hphys_addr) {
 		*hphys_addr = hphys;
@@ -265,6 +548,17 @@ done:
 	}
 }
 
+void vmm_guest_find_mapping(struct vmm_guest *guest,
+			    struct vmm_region *reg,
+			    physical_addr_t gphys_addr,
+			    physical_addr_t *hphys_addr,
+			    physical_size_t *avail_size)
+{
+	/* Caller might write through the mapping */
+	mapping_find_hphys(guest, reg, gphys_addr, TRUE,
+			   hphys_addr, avail_size);
+}
+
 void vmm_guest_iterate_mapping(struct vmm_guest *guest,
 				struct vmm_region *reg,
 				void (*func)(struct vmm_guest *guest,
@@ -282,6 +576,11 @@ void vmm_guest_iterate_mapping(struct vmm_guest *guest,
 	}
 
 	for (i = 0; i < reg->maps_count; i++) {
+		/* Skip mappings of on-demand region not populated yet */
+		if ((reg->flags & VMM_REGION_ISONDEMAND) &&
+		    !(reg->maps[i].flags & VMM_REGION_MAPPING_ISHOSTRAM)) {
+			continue;
+		}
 		func(guest, reg,
 		     reg->gphys_addr + mapping_gphys_offset(reg, i),
 		     reg->maps[i].hphys_addr,
@@ -328,6 +627,8 @@ u32 vmm_guest_memory_read(struct vmm_guest *guest,
 		return 0;
 	}
 
+	vmm_guest_memory_access_begin(guest);
+
 	while (bytes_read < len) {
 		reg = vmm_guest_find_region(guest, gphys_addr,
 				VMM_REGION_REAL | VMM_REGION_MEMORY, TRUE);
@@ -335,8 +636,8 @@ u32 vmm_guest_memory_read(struct vmm_guest *guest,
 			break;
 		}
 
-		vmm_guest_find_mapping(guest, reg, gphys_addr,
-				       &hphys_addr, &avail_size);
+		mapping_find_hphys(guest, reg, gphys_addr, FALSE,
+				   &hphys_addr, &avail_size);
 		to_read = (avail_size < U32_MAX) ? avail_size : U32_MAX;
 		to_read = ((len - bytes_read) < to_read) ?
 			  (len - bytes_read) : to_read;
@@ -352,6 +653,8 @@ u32 vmm_guest_memory_read(struct vmm_guest *guest,
 		dst += to_read;
 	}
 
+	vmm_guest_memory_access_end(guest);
+
 	return bytes_read;
 }
 
@@ -368,6 +671,8 @@ u32 vmm_guest_memory_write(struct vmm_guest *guest,
 		return 0;
 	}
 
+	vmm_guest_memory_access_begin(guest);
+
 	while (bytes_written < len) {
 		reg = vmm_guest_find_region(guest, gphys_addr,
 				VMM_REGION_REAL | VMM_REGION_MEMORY, TRUE);
@@ -387,11 +692,17 @@ u32 vmm_guest_memory_write(struct vmm_guest *guest,
 			break;
 		}
 
+		if (guest->aspace.dirty_log) {
+			vmm_guest_dirty_log_mark(guest, gphys_addr, to_write);
+		}
+
 		gphys_addr += to_write;
 		bytes_written += to_write;
 		src += to_write;
 	}
 
+	vmm_guest_memory_access_end(guest);
+
 	return bytes_written;
 }
 
@@ -455,6 +766,87 @@ int vmm_guest_physical_unmap(struct vmm_guest *guest,
 	return VMM_OK;
 }
 
+static int region_numa_policy(const char *aval)
+{
+	if (!strcmp(aval, VMM_DEVTREE_NUMA_POLICY_VAL_ANY)) {
+		return VMM_REGION_NUMA_ANY;
+	} else if (!strcmp(aval, VMM_DEVTREE_NUMA_POLICY_VAL_LOCAL)) {
+		return VMM_REGION_NUMA_LOCAL;
+	} else if (!strcmp(aval, VMM_DEVTREE_NUMA_POLICY_VAL_INTERLEAVE)) {
+		return VMM_REGION_NUMA_INTERLEAVE;
+	} else if (!strcmp(aval, VMM_DEVTREE_NUMA_POLICY_VAL_NODE)) {
+		return VMM_REGION_NUMA_NODE;
+	}
+
+	return VMM_EINVALID;
+}
+
+static int region_numa_vcpu_iter(struct vmm_vcpu *vcpu, void *priv)
+{
+	u32 hcpu, node, *counts = priv;
+
+	if (!vmm_manager_vcpu_get_hcpu(vcpu, &hcpu)) {
+		node = vmm_host_ram_cpu_node(hcpu);
+		if (node < VMM_HOST_RAM_MAX_NODES) {
+			counts[node]++;
+		}
+	}
+
+	return VMM_OK;
+}
+
+/*
+ * Region (or else guest) numa_policy attribute selects the placement
+ * policy of host RAM and default is to place it near guest VCPUs.
+ */
+static int region_numa_setup(struct vmm_guest *guest, struct vmm_region *reg)
+{
+	int rc;
+	u32 n, counts[VMM_HOST_RAM_MAX_NODES];
+	const char *aval = VMM_DEVTREE_NUMA_POLICY_VAL_LOCAL;
+
+	if (vmm_devtree_read_string(reg->node,
+			VMM_DEVTREE_NUMA_POLICY_ATTR_NAME, &aval)) {
+		vmm_devtree_read_string(guest->node,
+			VMM_DEVTREE_NUMA_POLICY_ATTR_NAME, &aval);
+	}
+	rc = region_numa_policy(aval);
+	if (rc < 0) {
+		return rc;
+	}
+	reg->numa_policy = rc;
+	reg->numa_node = 0;
+
+	switch (reg->numa_policy) {
+	case VMM_REGION_NUMA_NODE:
+		if (vmm_devtree_read_u32(reg->node,
+				VMM_DEVTREE_NUMA_NODE_ATTR_NAME,
+				&reg->numa_node) &&
+		    vmm_devtree_read_u32(guest->node,
+				VMM_DEVTREE_NUMA_NODE_ATTR_NAME,
+				&reg->numa_node)) {
+			return VMM_EINVALID;
+		}
+		break;
+	case VMM_REGION_NUMA_LOCAL:
+	case VMM_REGION_NUMA_INTERLEAVE:
+		/* VCPUs are created before guest address space */
+		memset(counts, 0, sizeof(counts));
+		vmm_manager_guest_vcpu_iterate(guest,
+					       region_numa_vcpu_iter, counts);
+		for (n = 1; n < vmm_host_ram_node_count(); n++) {
+			if (counts[reg->numa_node] < counts[n]) {
+				reg->numa_node = n;
+			}
+		}
+		break;
+	default:
+		break;
+	};
+
+	return VMM_OK;
+}
+
 bool is_region_node_valid(struct vmm_devtree_node *rnode)
 {
 	const char *aval;
@@ -464,6 +856,7 @@ bool is_region_node_valid(struct vmm_devtree_node *rnode)
 	bool is_alloced = FALSE;
 	bool is_colored = FALSE;
 	bool is_shared = FALSE;
+	bool is_ondemand = FALSE;
 	physical_size_t size = 0;
 	bool shm_available = FALSE;
 	physical_size_t shm_size = 0;
@@ -512,13 +905,17 @@ bool is_region_node_valid(struct vmm_devtree_node *rnode)
 	    !strcmp(aval, VMM_DEVTREE_DEVICE_TYPE_VAL_SHARED_ROM)) {
 		is_shared = TRUE;
 	}
+	if (!strcmp(aval, VMM_DEVTREE_DEVICE_TYPE_VAL_ONDEMAND_RAM)) {
+		is_ondemand = TRUE;
+	}
 
 	if (vmm_devtree_read_physaddr(rnode,
 			VMM_DEVTREE_GUEST_PHYS_ATTR_NAME, &gphys_addr)) {
 		return FALSE;
 	}
 
-	if (is_real && !is_alloced && !is_colored && !is_shared) {
+	if (is_real && !is_alloced && !is_colored &&
+	    !is_shared && !is_ondemand) {
 		if (vmm_devtree_read_physaddr(rnode,
 			VMM_DEVTREE_HOST_PHYS_ATTR_NAME, &hphys_addr)) {
 			return FALSE;
@@ -537,6 +934,15 @@ bool is_region_node_valid(struct vmm_devtree_node *rnode)
 		return FALSE;
 	}
 
+	if (is_ondemand) {
+		if (!is_real) {
+			return FALSE;
+		}
+		if ((size & VMM_PAGE_MASK) || (gphys_addr & VMM_PAGE_MASK)) {
+			return FALSE;
+		}
+	}
+
 
 	if (vmm_devtree_read_u32(rnode,
 			VMM_DEVTREE_FIRST_COLOR_ATTR_NAME, &first_color)) {
@@ -595,6 +1001,12 @@ bool is_region_node_valid(struct vmm_devtree_node *rnode)
 		}
 	}
 
+	if (!vmm_devtree_read_string(rnode,
+			VMM_DEVTREE_NUMA_POLICY_ATTR_NAME, &aval) &&
+	    (region_numa_policy(aval) < 0)) {
+		return FALSE;
+	}
+
 	if (BITS_PER_LONG <= align_order) {
 		return FALSE;
 	}
@@ -755,7 +1167,8 @@ static int region_add(struct vmm_guest *guest,
 	if (!strcmp(aval, VMM_DEVTREE_DEVICE_TYPE_VAL_RAM) ||
 	    !strcmp(aval, VMM_DEVTREE_DEVICE_TYPE_VAL_ALLOCED_RAM) ||
 	    !strcmp(aval, VMM_DEVTREE_DEVICE_TYPE_VAL_COLORED_RAM) ||
-	    !strcmp(aval, VMM_DEVTREE_DEVICE_TYPE_VAL_SHARED_RAM)) {
+	    !strcmp(aval, VMM_DEVTREE_DEVICE_TYPE_VAL_SHARED_RAM) ||
+	    !strcmp(aval, VMM_DEVTREE_DEVICE_TYPE_VAL_ONDEMAND_RAM)) {
 		reg->flags |= VMM_REGION_ISRAM;
 	} else if (!strcmp(aval, VMM_DEVTREE_DEVICE_TYPE_VAL_ROM) ||
 		   !strcmp(aval, VMM_DEVTREE_DEVICE_TYPE_VAL_ALLOCED_ROM) ||
@@ -782,6 +1195,9 @@ static int region_add(struct vmm_guest *guest,
 	    !strcmp(aval, VMM_DEVTREE_DEVICE_TYPE_VAL_SHARED_ROM)) {
 		reg->flags |= VMM_REGION_ISSHARED;
 	}
+	if (!strcmp(aval, VMM_DEVTREE_DEVICE_TYPE_VAL_ONDEMAND_RAM)) {
+		reg->flags |= VMM_REGION_ISONDEMAND;
+	}
 	if ((reg->flags & VMM_REGION_REAL) &&
 	    (reg->flags & VMM_REGION_MEMORY) &&
 	    (reg->flags & VMM_REGION_ISRAM)) {
@@ -881,6 +1297,12 @@ static int region_add(struct vmm_guest *guest,
 		}
 	}
 
+	/* Determine region NUMA placement */
+	rc = region_numa_setup(guest, reg);
+	if (rc) {
+		goto region_dref_shm_fail;
+	}
+
 	/* Compute default mapping order for guest region */
 	reg->map_order = VMM_PAGE_SHIFT;
 	for (i = VMM_PAGE_SHIFT; i < 64; i++) {
@@ -906,6 +1328,13 @@ static int region_add(struct vmm_guest *guest,
 			reg->map_order = reg->align_order;
 		}
 
+		/* Interleaving needs more than one mapping */
+		if ((reg->numa_policy == VMM_REGION_NUMA_INTERLEAVE) &&
+		    (1 < vmm_host_ram_node_count()) &&
+		    (INTERLEAVE_MAP_ORDER < reg->map_order)) {
+			reg->map_order = INTERLEAVE_MAP_ORDER;
+		}
+
 		i = 0;
 		rc = vmm_devtree_read_u32(reg->node,
 				VMM_DEVTREE_MAP_ORDER_ATTR_NAME, &i);
@@ -914,6 +1343,24 @@ static int region_add(struct vmm_guest *guest,
 		}
 	}
 
+	/*
+	 * Overwrite mapping order for on-demand RAM regions so that
+	 * host RAM is allocated in chunks upon first access
+	 */
+	if ((reg->flags & VMM_REGION_REAL) &&
+	    (reg->flags & VMM_REGION_ISONDEMAND)) {
+		if (ONDEMAND_MAP_ORDER < reg->map_order) {
+			reg->map_order = ONDEMAND_MAP_ORDER;
+		}
+
+		i = 0;
+		rc = vmm_devtree_read_u32(reg->node,
+				VMM_DEVTREE_MAP_ORDER_ATTR_NAME, &i);
+		if (!rc && (VMM_PAGE_SHIFT <= i) && (i < reg->map_order)) {
+			reg->map_order = i;
+		}
+	}
+
 	/* Overwrite mapping order for colored RAM/ROM regions */
 	if (!(reg->flags & (VMM_REGION_ALIAS | VMM_REGION_VIRTUAL)) &&
 	    (reg->flags & (VMM_REGION_ISRAM | VMM_REGION_ISROM)) &&
@@ -960,7 +1407,8 @@ static int region_add(struct vmm_guest *guest,
 	if ((reg->flags & VMM_REGION_REAL) &&
 	    !(reg->flags & VMM_REGION_ISALLOCED) &&
 	    !(reg->flags & VMM_REGION_ISCOLORED) &&
-	    !(reg->flags & VMM_REGION_ISSHARED)) {
+	    !(reg->flags & VMM_REGION_ISSHARED) &&
+	    !(reg->flags & VMM_REGION_ISONDEMAND)) {
 		rc = vmm_devtree_read_physaddr(reg->node,
 					VMM_DEVTREE_HOST_PHYS_ATTR_NAME,
 					&reg->maps[0].hphys_addr);
@@ -1004,9 +1452,7 @@ static int region_add(struct vmm_guest *guest,
 	    (reg->flags & (VMM_REGION_ISRAM | VMM_REGION_ISROM)) &&
 	    (reg->flags & VMM_REGION_ISALLOCED)) {
 		for (i = 0; i < reg->maps_count; i++) {
-			if (!vmm_host_ram_alloc(&reg->maps[i].hphys_addr,
-						mapping_phys_size(reg, i),
-						reg->align_order)) {
+			if (!mapping_alloced_alloc(reg, i)) {
 				vmm_printf("%s: Failed to alloc "
 					   "host RAM for %s/%s\n",
 					   __func__, guest->name,
@@ -1200,8 +1646,14 @@ static int region_del(struct vmm_guest *guest,
 			if (!(reg->maps[i].flags &
 			      VMM_REGION_MAPPING_ISHOSTRAM))
 				continue;
-			rc = vmm_host_ram_free(reg->maps[i].hphys_addr,
-					       mapping_phys_size(reg, i));
+			if (reg->flags & VMM_REGION_ISONDEMAND) {
+				mapping_ondemand_release(guest, reg, i, FALSE);
+				continue;
+			}
+			rc = vmm_guest_dedup_free(guest,
+				reg->gphys_addr + mapping_gphys_offset(reg, i),
+				reg->maps[i].hphys_addr,
+				mapping_phys_size(reg, i));
 			if (rc) {
 				vmm_printf("%s: Failed to free host RAM "
 					   "for %s/%s (error %d)\n",
@@ -1210,6 +1662,17 @@ static int region_del(struct vmm_guest *guest,
 			}
 			reg->maps[i].flags &= ~VMM_REGION_MAPPING_ISHOSTRAM;
 		}
+		if (reg->flags & VMM_REGION_ISONDEMAND) {
+			mapping_ondemand_reap(guest, reg);
+		}
+	}
+
+	/* Free dirty page bitmap */
+	if (reg->dirty_bitmap) {
+		vmm_spin_lock_irqsave_lite(&aspace->dirty_lock, flags);
+		vmm_free(reg->dirty_bitmap);
+		reg->dirty_bitmap = NULL;
+		vmm_spin_unlock_irqrestore_lite(&aspace->dirty_lock, flags);
 	}
 
 	/* Free region mappings */
@@ -1287,6 +1750,448 @@ int vmm_guest_aspace_reset(struct vmm_guest *guest)
 	return vmm_devemu_reset_context(guest);
 }
 
+physical_size_t vmm_guest_ondemand_resident(struct vmm_guest *guest)
+{
+	irq_flags_t flags;
+	physical_size_t ret;
+
+	if (!guest) {
+		return 0;
+	}
+
+	vmm_spin_lock_irqsave_lite(&guest->aspace.ondemand_lock, flags);
+	ret = guest->aspace.ondemand_resident;
+	vmm_spin_unlock_irqrestore_lite(&guest->aspace.ondemand_lock, flags);
+
+	return ret;
+}
+
+physical_size_t vmm_guest_ondemand_limit(struct vmm_guest *guest)
+{
+	return (guest) ? guest->aspace.ondemand_limit : 0;
+}
+
+physical_size_t vmm_guest_ondemand_release(struct vmm_guest *guest,
+					   physical_addr_t gphys_addr,
+					   physical_size_t phys_size)
+{
+	u32 i;
+	struct vmm_region *reg;
+	physical_addr_t addr, end, map_start, map_end;
+	physical_size_t released = 0;
+
+	if (!guest || !phys_size) {
+		return 0;
+	}
+
+	addr = gphys_addr;
+	end = gphys_addr + phys_size;
+	while (addr < end) {
+		reg = vmm_guest_find_region(guest, addr,
+					    VMM_REGION_MEMORY, FALSE);
+		if (!reg) {
+			addr = (addr + VMM_PAGE_SIZE) & ~VMM_PAGE_MASK;
+			continue;
+		}
+
+		if ((reg->flags & VMM_REGION_REAL) &&
+		    (reg->flags & VMM_REGION_ISONDEMAND) &&
+		    mapping_find(guest, reg, &i, addr)) {
+			/* Only chunks fully covered by given range */
+			for (; i < reg->maps_count; i++) {
+				map_start = reg->gphys_addr +
+					    mapping_gphys_offset(reg, i);
+				map_end = map_start + mapping_phys_size(reg, i);
+				if (end < map_end) {
+					break;
+				}
+				if (addr <= map_start) {
+					released += mapping_ondemand_release(
+							guest, reg, i, TRUE);
+				}
+			}
+		}
+
+		addr = VMM_REGION_GPHYS_END(reg);
+	}
+
+	return released;
+}
+
+int vmm_guest_balloon_set_target(struct vmm_guest *guest,
+				 physical_size_t target)
+{
+	irq_flags_t flags;
+	struct vmm_guest_aspace_event evt;
+
+	if (!guest) {
+		return VMM_EINVALID;
+	}
+
+	target &= ~VMM_PAGE_MASK;
+
+	vmm_spin_lock_irqsave_lite(&guest->aspace.ondemand_lock, flags);
+	guest->aspace.balloon_target = target;
+	vmm_spin_unlock_irqrestore_lite(&guest->aspace.ondemand_lock, flags);
+
+	/* Notify the balloon device emulators */
+	evt.guest = guest;
+	evt.data = NULL;
+	vmm_blocking_notifier_call(&guest_aspace_notifier_chain,
+				   VMM_GUEST_ASPACE_EVENT_BALLOON,
+				   &evt);
+
+	return VMM_OK;
+}
+
+physical_size_t vmm_guest_balloon_target(struct vmm_guest *guest)
+{
+	return (guest) ? guest->aspace.balloon_target : 0;
+}
+
+void vmm_guest_balloon_update_size(struct vmm_guest *guest,
+				   physical_size_t size)
+{
+	if (guest) {
+		guest->aspace.balloon_size = size;
+	}
+}
+
+physical_size_t vmm_guest_balloon_size(struct vmm_guest *guest)
+{
+	return (guest) ? guest->aspace.balloon_size : 0;
+}
+
+void vmm_guest_balloon_update_stat(struct vmm_guest *guest,
+				   u32 stat, u64 val)
+{
+	if (guest && (stat < VMM_GUEST_BALLOON_STAT_MAX)) {
+		guest->aspace.balloon_stats[stat] = val;
+	}
+}
+
+u64 vmm_guest_balloon_stat(struct vmm_guest *guest, u32 stat)
+{
+	if (!guest || (VMM_GUEST_BALLOON_STAT_MAX <= stat)) {
+		return 0;
+	}
+
+	return guest->aspace.balloon_stats[stat];
+}
+
+static inline u32 dirty_log_region_pages(struct vmm_region *reg)
+{
+	return VMM_REGION_PHYS_SIZE(reg) >> VMM_PAGE_SHIFT;
+}
+
+bool vmm_guest_dirty_log_region(struct vmm_region *reg)
+{
+	u32 req = VMM_REGION_REAL | VMM_REGION_MEMORY | VMM_REGION_ISRAM;
+
+	if (!reg || ((reg->flags & req) != req)) {
+		return FALSE;
+	}
+
+	return (reg->flags & (VMM_REGION_READONLY | VMM_REGION_ALIAS |
+			      VMM_REGION_VIRTUAL | VMM_REGION_ISDEVICE)) ?
+		FALSE : TRUE;
+}
+
+static void dirty_log_start_region(struct vmm_guest *guest,
+				   struct vmm_region *reg, void *priv)
+{
+	int rc;
+	irq_flags_t flags;
+	unsigned long *bmap;
+	int *retp = priv;
+
+	if (*retp || !vmm_guest_dirty_log_region(reg)) {
+		return;
+	}
+
+	bmap = vmm_zalloc(bitmap_estimate_size(dirty_log_region_pages(reg)));
+	if (!bmap) {
+		*retp = VMM_ENOMEM;
+		return;
+	}
+
+	vmm_spin_lock_irqsave_lite(&guest->aspace.dirty_lock, flags);
+	if (reg->dirty_bitmap) {
+		vmm_free(reg->dirty_bitmap);
+	}
+	reg->dirty_bitmap = bmap;
+	vmm_spin_unlock_irqrestore_lite(&guest->aspace.dirty_lock, flags);
+
+	rc = arch_guest_write_protect_region(guest, reg,
+					     VMM_REGION_GPHYS_START(reg),
+					     VMM_REGION_PHYS_SIZE(reg));
+	if (rc) {
+		vmm_printf("%s: Failed to write protect %s/%s (error %d)\n",
+			   __func__, guest->name, reg->node->name, rc);
+		*retp = rc;
+	}
+}
+
+static void dirty_log_stop_region(struct vmm_guest *guest,
+				  struct vmm_region *reg, void *priv)
+{
+	irq_flags_t flags;
+	unsigned long *bmap;
+
+	vmm_spin_lock_irqsave_lite(&guest->aspace.dirty_lock, flags);
+	bmap = reg->dirty_bitmap;
+	reg->dirty_bitmap = NULL;
+	vmm_spin_unlock_irqrestore_lite(&guest->aspace.dirty_lock, flags);
+
+	if (bmap) {
+		vmm_free(bmap);
+	}
+}
+
+int vmm_guest_dirty_log_start(struct vmm_guest *guest)
+{
+	int rc = VMM_OK;
+	irq_flags_t flags;
+
+	if (!guest) {
+		return VMM_EINVALID;
+	}
+
+	/* Check and set under lock so that only one caller starts */
+	vmm_spin_lock_irqsave_lite(&guest->aspace.dirty_lock, flags);
+	if (guest->aspace.dirty_log) {
+		vmm_spin_unlock_irqrestore_lite(&guest->aspace.dirty_lock,
+						flags);
+		return VMM_EALREADY;
+	}
+	guest->aspace.dirty_faults = 0;
+	guest->aspace.dirty_fault_nsecs = 0;
+	guest->aspace.dirty_log = TRUE;
+	vmm_spin_unlock_irqrestore_lite(&guest->aspace.dirty_lock, flags);
+
+	vmm_guest_iterate_region(guest, VMM_REGION_MEMORY,
+				 dirty_log_start_region, &rc);
+	if (rc) {
+		vmm_guest_dirty_log_stop(guest);
+	}
+
+	return rc;
+}
+
+int vmm_guest_dirty_log_stop(struct vmm_guest *guest)
+{
+	irq_flags_t flags;
+
+	if (!guest) {
+		return VMM_EINVALID;
+	}
+
+	vmm_spin_lock_irqsave_lite(&guest->aspace.dirty_lock, flags);
+	guest->aspace.dirty_log = FALSE;
+	vmm_spin_unlock_irqrestore_lite(&guest->aspace.dirty_lock, flags);
+
+	/*
+	 * Stage2 mappings are left write protected. The arch code
+	 * gives back write permission upon next guest write.
+	 */
+	vmm_guest_iterate_region(guest, VMM_REGION_MEMORY,
+				 dirty_log_stop_region, NULL);
+
+	return VMM_OK;
+}
+
+bool vmm_guest_dirty_log_enabled(struct vmm_guest *guest)
+{
+	return (guest) ? guest->aspace.dirty_log : FALSE;
+}
+
+/* Note: Must be called with dirty_lock held */
+static void dirty_log_mark_region(struct vmm_region *reg,
+				  physical_addr_t gphys_addr,
+				  physical_size_t phys_size)
+{
+	physical_addr_t start, end;
+
+	if (!reg->dirty_bitmap) {
+		return;
+	}
+
+	start = gphys_addr;
+	end = gphys_addr + phys_size;
+	if (start < VMM_REGION_GPHYS_START(reg)) {
+		start = VMM_REGION_GPHYS_START(reg);
+	}
+	if (VMM_REGION_GPHYS_END(reg) < end) {
+		end = VMM_REGION_GPHYS_END(reg);
+	}
+	if (end <= start) {
+		return;
+	}
+
+	start = (start - VMM_REGION_GPHYS_START(reg)) >> VMM_PAGE_SHIFT;
+	end = (end - VMM_REGION_GPHYS_START(reg) +
+	       VMM_PAGE_SIZE - 1) >> VMM_PAGE_SHIFT;
+	bitmap_set(reg->dirty_bitmap, start, end - start);
+}
+
+void vmm_guest_dirty_log_mark(struct vmm_guest *guest,
+			      physical_addr_t gphys_addr,
+			      physical_size_t phys_size)
+{
+	irq_flags_t flags;
+	struct vmm_region *reg;
+	physical_addr_t addr, end;
+
+	if (!guest || !guest->aspace.dirty_log || !phys_size) {
+		return;
+	}
+
+	addr = gphys_addr;
+	end = gphys_addr + phys_size;
+	while (addr < end) {
+		reg = vmm_guest_find_region(guest, addr,
+				VMM_REGION_REAL | VMM_REGION_MEMORY, FALSE);
+		if (!reg) {
+			addr = (addr + VMM_PAGE_SIZE) & ~VMM_PAGE_MASK;
+			continue;
+		}
+
+		vmm_spin_lock_irqsave_lite(&guest->aspace.dirty_lock, flags);
+		dirty_log_mark_region(reg, addr, end - addr);
+		vmm_spin_unlock_irqrestore_lite(&guest->aspace.dirty_lock,
+						flags);
+
+		addr = VMM_REGION_GPHYS_END(reg);
+	}
+}
+
+void vmm_guest_dirty_log_fault(struct vmm_guest *guest,
+			       physical_addr_t gphys_addr,
+			       u64 fault_tstamp)
+{
+	irq_flags_t flags;
+	struct vmm_region *reg;
+	struct vmm_guest_aspace *aspace;
+
+	if (!guest) {
+		return;
+	}
+	aspace = &guest->aspace;
+
+	reg = vmm_guest_find_region(guest, gphys_addr,
+				    VMM_REGION_REAL | VMM_REGION_MEMORY, FALSE);
+
+	vmm_spin_lock_irqsave_lite(&aspace->dirty_lock, flags);
+	if (aspace->dirty_log) {
+		if (reg) {
+			dirty_log_mark_region(reg, gphys_addr, VMM_PAGE_SIZE);
+		}
+		aspace->dirty_faults++;
+		aspace->dirty_fault_nsecs +=
+				vmm_timer_timestamp() - fault_tstamp;
+	}
+	vmm_spin_unlock_irqrestore_lite(&aspace->dirty_lock, flags);
+}
+
+int vmm_guest_dirty_log_fetch(struct vmm_guest *guest,
+			      struct vmm_region *reg,
+			      unsigned long *bitmap, u32 *dirty_count)
+{
+	int rc = VMM_OK;
+	u32 pages, i, j, count;
+	irq_flags_t flags;
+
+	if (!guest || !reg || !bitmap) {
+		return VMM_EINVALID;
+	}
+	pages = dirty_log_region_pages(reg);
+
+	/* Copy and clear dirty bitmap */
+	vmm_spin_lock_irqsave_lite(&guest->aspace.dirty_lock, flags);
+	if (!reg->dirty_bitmap) {
+		vmm_spin_unlock_irqrestore_lite(&guest->aspace.dirty_lock,
+						flags);
+		return VMM_ENOENT;
+	}
+	bitmap_copy(bitmap, reg->dirty_bitmap, pages);
+	bitmap_zero(reg->dirty_bitmap, pages);
+	vmm_spin_unlock_irqrestore_lite(&guest->aspace.dirty_lock, flags);
+
+	/*
+	 * Write protect dirty pages again. Guest writes done between
+	 * clearing bitmap and write protection are seen by caller
+	 * because it reads dirty pages after we return.
+	 */
+	count = 0;
+	for (i = 0; i < pages; i = j) {
+		if (!bitmap_isset(bitmap, i)) {
+			j = i + 1;
+			continue;
+		}
+		j = i + 1;
+		while ((j < pages) && bitmap_isset(bitmap, j)) {
+			j++;
+		}
+		count += j - i;
+		rc = arch_guest_write_protect_region(guest, reg,
+				VMM_REGION_GPHYS_START(reg) +
+					((physical_addr_t)i << VMM_PAGE_SHIFT),
+				(physical_size_t)(j - i) << VMM_PAGE_SHIFT);
+		if (rc) {
+			break;
+		}
+	}
+
+	if (dirty_count) {
+		*dirty_count = count;
+	}
+
+	return rc;
+}
+
+static void dirty_log_count_region(struct vmm_guest *guest,
+				   struct vmm_region *reg, void *priv)
+{
+	irq_flags_t flags;
+	u32 *countp = priv;
+
+	vmm_spin_lock_irqsave_lite(&guest->aspace.dirty_lock, flags);
+	if (reg->dirty_bitmap) {
+		*countp += bitmap_weight(reg->dirty_bitmap,
+					 dirty_log_region_pages(reg));
+	}
+	vmm_spin_unlock_irqrestore_lite(&guest->aspace.dirty_lock, flags);
+}
+
+u32 vmm_guest_dirty_log_count(struct vmm_guest *guest)
+{
+	u32 count = 0;
+
+	vmm_guest_iterate_region(guest, VMM_REGION_MEMORY,
+				 dirty_log_count_region, &count);
+
+	return count;
+}
+
+void vmm_guest_dirty_log_fault_stats(struct vmm_guest *guest,
+				     u64 *faults, u64 *nsecs)
+{
+	irq_flags_t flags;
+
+	if (!guest) {
+		return;
+	}
+
+	vmm_spin_lock_irqsave_lite(&guest->aspace.dirty_lock, flags);
+	if (faults) {
+		*faults = guest->aspace.dirty_faults;
+	}
+	if (nsecs) {
+		*nsecs = guest->aspace.dirty_fault_nsecs;
+	}
+	vmm_spin_unlock_irqrestore_lite(&guest->aspace.dirty_lock, flags);
+}
+
 int vmm_guest_add_region_from_node(struct vmm_guest *guest,
 				   struct vmm_devtree_node *node,
 				   void *rpriv)
@@ -1530,8 +2435,29 @@ int vmm_guest_aspace_init(struct vmm_guest *guest)
 	INIT_RW_LOCK(&aspace->reg_memtree_lock);
 	aspace->reg_memtree = RB_ROOT;
 	INIT_LIST_HEAD(&aspace->reg_memprobe_list);
+	INIT_SPIN_LOCK(&aspace->ondemand_lock);
+	arch_atomic_write(&aspace->ondemand_inflight, 0);
+	INIT_LIST_HEAD(&aspace->ondemand_pending);
+	aspace->ondemand_resident = 0;
+	aspace->balloon_target = 0;
+	aspace->balloon_size = 0;
+	memset(aspace->balloon_stats, 0, sizeof(aspace->balloon_stats));
+	INIT_SPIN_LOCK(&aspace->dirty_lock);
+	aspace->dirty_log = FALSE;
+	aspace->dirty_faults = 0;
+	aspace->dirty_fault_nsecs = 0;
+	if (vmm_devtree_read_physsize(aspace->node,
+			VMM_DEVTREE_ONDEMAND_LIMIT_ATTR_NAME,
+			&aspace->ondemand_limit)) {
+		aspace->ondemand_limit = 0;
+	}
 	guest->aspace.devemu_priv = NULL;
 
+	/* Attach page deduplication before regions are created */
+	if ((rc = vmm_guest_dedup_attach(guest))) {
+		return rc;
+	}
+
 	/* Initialize device emulation context */
 	if ((rc = vmm_devemu_init_context(guest))) {
 		return rc;
@@ -1590,6 +2516,12 @@ int vmm_guest_aspace_deinit(struct vmm_guest *guest)
 				   VMM_GUEST_ASPACE_EVENT_DEINIT,
 				   &evt);
 
+	/* Stop page deduplication scanner from touching regions */
+	vmm_guest_dedup_detach(guest);
+
+	/* Stop dirty page logging */
+	vmm_guest_dirty_log_stop(guest);
+
 	/* Mark address space as uninitialized */
 	aspace->initialized = FALSE;
 
@@ -1641,6 +2573,9 @@ int vmm_guest_aspace_deinit(struct vmm_guest *guest)
 	}
 	guest->aspace.devemu_priv = NULL;
 
+	/* Free page deduplication context */
+	vmm_guest_dedup_cleanup(guest);
+
 	/* De-reference address space node */
 	if (guest->aspace.node) {
 		vmm_devtree_dref_node(guest->aspace.node);
@@ -0,0 +1,1188 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file vmm_guest_dedup.c
+ * @author agent (agent@local)
+ * @brief source file for content based guest page deduplication
+ *
+ * A background thread scans RAM regions of guests which have opted-in
+ * and merges guest pages having identical content into one read-only
+ * host frame shared by all of them.
+ *
+ * Merging a guest page happens in two scanning rounds. In first round,
+ * the page is hashed and if a stable (already shared) frame or another
+ * page with same hash (unstable) is found then guest page is marked as
+ * pending and unmapped from stage2. In next round, the page content is
+ * compared again and if it still matches then original host page is
+ * freed and guest page is backed by the shared frame. Any guest access
+ * to a pending page cancels the merge whereas write access to a shared
+ * page breaks the sharing by giving guest a private copy of the page.
+ *
+ * Host writes to guest memory see private copies of shared pages while
+ * host reads use the shared frame as-is. A shared frame given up by a
+ * guest page is released only after in-flight host accesses have ended.
+ * Guest memory to which host keeps long lived mappings (such as VirtIO
+ * rings) is pinned so that it is never merged.
+ */
+
+#include <vmm_error.h>
+#include <vmm_heap.h>
+#include <vmm_stdio.h>
+#include <vmm_mutex.h>
+#include <vmm_spinlocks.h>
+#include <vmm_threads.h>
+#include <vmm_completion.h>
+#include <vmm_devtree.h>
+#include <vmm_host_ram.h>
+#include <vmm_host_aspace.h>
+#include <vmm_manager.h>
+#include <vmm_guest_aspace.h>
+#include <vmm_guest_dedup.h>
+#include <arch_atomic.h>
+#include <arch_barrier.h>
+#include <arch_guest.h>
+#include <libs/list.h>
+#include <libs/rbtree.h>
+#include <libs/md5.h>
+#include <libs/stringlib.h>
+
+#define DEDUP_PRIORITY			VMM_THREAD_DEF_PRIORITY
+#define DEDUP_TIMESLICE			VMM_THREAD_DEF_TIME_SLICE
+#define DEDUP_UNSTABLE_SIZE		1024
+
+enum dedup_page_state {
+	DEDUP_PAGE_PENDING=0,
+	DEDUP_PAGE_SHARED,
+	DEDUP_PAGE_PRIVATE,
+	DEDUP_PAGE_PINNED,
+};
+
+/* Read-only host frame shared by guest pages */
+struct dedup_frame {
+	struct rb_node head;
+	u64 hash;
+	physical_addr_t hpa;
+	u32 ref_count;
+	u32 pending_count;
+};
+
+/* Guest page which is not backed by its region mapping as-is */
+struct dedup_page {
+	struct rb_node head;
+	physical_addr_t gpa;
+	u32 state;
+	struct vmm_region *reg;
+	physical_addr_t orig_hpa;
+	physical_addr_t hpa;
+	struct dedup_frame *frame;
+};
+
+struct dedup_guest {
+	struct dlist head;
+	struct vmm_guest *guest;
+	bool scanning;
+	bool disabled;
+	atomic_t inflight;
+	vmm_spinlock_t lock;
+	struct rb_root pages;
+	struct dlist stale_frames;
+	u8 *copy_buf;
+	physical_addr_t scan_gpa;
+	struct vmm_guest_dedup_stats stats;
+};
+
+/* Shared frame given up by a guest page while host might be reading it */
+struct dedup_stale {
+	struct dlist head;
+	struct dedup_frame *frame;
+};
+
+/* Last seen location of a page hash */
+struct dedup_unstable {
+	u64 hash;
+	struct dedup_guest *dg;
+	physical_addr_t gpa;
+};
+
+struct dedup_ctrl {
+	struct vmm_mutex guest_list_lock;
+	struct dlist guest_list;
+	struct dedup_guest *curr;
+	vmm_spinlock_t frame_lock;
+	struct rb_root frames;
+	u32 frame_count;
+	u64 full_scans;
+	struct dedup_unstable *unstable;
+	u8 *scan_buf;
+	u8 *cmp_buf;
+	u32 pages_to_scan;
+	u32 sleep_msecs;
+	struct vmm_completion dedup_cmpl;
+	struct vmm_thread *dedup_thread;
+};
+
+static struct dedup_ctrl dctrl;
+
+static u64 dedup_hash(u8 *buf)
+{
+	u64 hash;
+	u8 digest[16];
+	struct md5_context ctx;
+
+	md5_init(&ctx);
+	md5_update(&ctx, buf, VMM_PAGE_SIZE);
+	md5_final(digest, &ctx);
+	memcpy(&hash, digest, sizeof(hash));
+
+	return hash;
+}
+
+static bool dedup_region_eligible(struct vmm_region *reg)
+{
+	if ((reg->flags & (VMM_REGION_REAL | VMM_REGION_MEMORY |
+			   VMM_REGION_ISRAM)) !=
+	    (VMM_REGION_REAL | VMM_REGION_MEMORY | VMM_REGION_ISRAM)) {
+		return FALSE;
+	}
+
+	if (!(reg->flags & (VMM_REGION_ISALLOCED | VMM_REGION_ISONDEMAND))) {
+		return FALSE;
+	}
+
+	return (reg->flags & (VMM_REGION_ALIAS | VMM_REGION_VIRTUAL |
+			      VMM_REGION_READONLY | VMM_REGION_ISDEVICE |
+			      VMM_REGION_ISRESERVED | VMM_REGION_ISCOLORED |
+			      VMM_REGION_ISSHARED)) ? FALSE : TRUE;
+}
+
+static bool dedup_mapping_hpa(struct vmm_region *reg, physical_addr_t gpa,
+			      physical_addr_t *hpa)
+{
+	u32 i = (gpa - reg->gphys_addr) >> reg->map_order;
+	struct vmm_region_mapping *map = &reg->maps[i];
+
+	if (!(map->flags & VMM_REGION_MAPPING_ISHOSTRAM)) {
+		return FALSE;
+	}
+	arch_smp_rmb();
+
+	*hpa = map->hphys_addr +
+		(gpa - reg->gphys_addr - ((physical_addr_t)i << reg->map_order));
+
+	return TRUE;
+}
+
+static bool dedup_frame_same(struct dedup_frame *frame, u8 *buf)
+{
+	if (vmm_host_memory_read(frame->hpa, dctrl.cmp_buf,
+				 VMM_PAGE_SIZE, TRUE) != VMM_PAGE_SIZE) {
+		return FALSE;
+	}
+
+	return memcmp(dctrl.cmp_buf, buf, VMM_PAGE_SIZE) ? FALSE : TRUE;
+}
+
+/* Note: Must be called with frame_lock held */
+static struct dedup_frame *dedup_frame_find(u64 hash, u8 *buf)
+{
+	struct rb_node *n = dctrl.frames.rb_node;
+	struct dedup_frame *f, *found = NULL;
+
+	/* Find left-most frame with same hash */
+	while (n) {
+		f = rb_entry(n, struct dedup_frame, head);
+		if (hash < f->hash) {
+			n = n->rb_left;
+		} else if (f->hash < hash) {
+			n = n->rb_right;
+		} else {
+			found = f;
+			n = n->rb_left;
+		}
+	}
+
+	/* Hash collisions are possible so compare page content */
+	while (found && (found->hash == hash)) {
+		if (dedup_frame_same(found, buf)) {
+			return found;
+		}
+		n = rb_next(&found->head);
+		found = (n) ? rb_entry(n, struct dedup_frame, head) : NULL;
+	}
+
+	return NULL;
+}
+
+/* Note: Must be called with frame_lock held */
+static struct dedup_frame *dedup_frame_alloc(u64 hash, u8 *buf)
+{
+	struct dedup_frame *frame, *f;
+	struct rb_node **new = &dctrl.frames.rb_node, *parent = NULL;
+
+	frame = vmm_zalloc(sizeof(*frame));
+	if (!frame) {
+		return NULL;
+	}
+
+	if (!vmm_host_ram_alloc(&frame->hpa, VMM_PAGE_SIZE, VMM_PAGE_SHIFT)) {
+		vmm_free(frame);
+		return NULL;
+	}
+	vmm_host_memory_write(frame->hpa, buf, VMM_PAGE_SIZE, TRUE);
+	frame->hash = hash;
+
+	while (*new) {
+		parent = *new;
+		f = rb_entry(parent, struct dedup_frame, head);
+		if (hash < f->hash) {
+			new = &parent->rb_left;
+		} else {
+			new = &parent->rb_right;
+		}
+	}
+	rb_link_node(&frame->head, parent, new);
+	rb_insert_color(&frame->head, &dctrl.frames);
+	dctrl.frame_count++;
+
+	return frame;
+}
+
+/* Note: Must be called with interrupts disabled */
+static void dedup_frame_put(struct dedup_frame *frame, bool pending)
+{
+	bool release = FALSE;
+
+	vmm_spin_lock_lite(&dctrl.frame_lock);
+	if (pending) {
+		frame->pending_count--;
+	} else {
+		frame->ref_count--;
+	}
+	if (!frame->ref_count && !frame->pending_count) {
+		rb_erase(&frame->head, &dctrl.frames);
+		dctrl.frame_count--;
+		release = TRUE;
+	}
+	vmm_spin_unlock_lite(&dctrl.frame_lock);
+
+	if (release) {
+		vmm_host_ram_free(frame->hpa, VMM_PAGE_SIZE);
+		vmm_free(frame);
+	}
+}
+
+/* Note: Must be called with guest dedup lock held */
+static struct dedup_page *dedup_page_find(struct dedup_guest *dg,
+					  physical_addr_t gpa)
+{
+	struct dedup_page *pg;
+	struct rb_node *n = dg->pages.rb_node;
+
+	while (n) {
+		pg = rb_entry(n, struct dedup_page, head);
+		if (gpa < pg->gpa) {
+			n = n->rb_left;
+		} else if (pg->gpa < gpa) {
+			n = n->rb_right;
+		} else {
+			return pg;
+		}
+	}
+
+	return NULL;
+}
+
+/* Note: Must be called with guest dedup lock held */
+static struct dedup_page *dedup_page_find_next(struct dedup_guest *dg,
+					       physical_addr_t gpa)
+{
+	struct dedup_page *pg, *found = NULL;
+	struct rb_node *n = dg->pages.rb_node;
+
+	while (n) {
+		pg = rb_entry(n, struct dedup_page, head);
+		if (gpa < pg->gpa) {
+			found = pg;
+			n = n->rb_left;
+		} else {
+			n = n->rb_right;
+		}
+	}
+
+	return found;
+}
+
+/* Note: Must be called with guest dedup lock held */
+static struct dedup_page *dedup_page_add(struct dedup_guest *dg,
+					 struct vmm_region *reg,
+					 physical_addr_t gpa,
+					 physical_addr_t hpa,
+					 u32 state)
+{
+	struct dedup_page *pg, *p;
+	struct rb_node **new = &dg->pages.rb_node, *parent = NULL;
+
+	pg = vmm_zalloc(sizeof(*pg));
+	if (!pg) {
+		return NULL;
+	}
+	pg->gpa = gpa;
+	pg->state = state;
+	pg->reg = reg;
+	pg->orig_hpa = hpa;
+	pg->hpa = hpa;
+
+	while (*new) {
+		parent = *new;
+		p = rb_entry(parent, struct dedup_page, head);
+		if (gpa < p->gpa) {
+			new = &parent->rb_left;
+		} else {
+			new = &parent->rb_right;
+		}
+	}
+	rb_link_node(&pg->head, parent, new);
+	rb_insert_color(&pg->head, &dg->pages);
+
+	return pg;
+}
+
+/* Note: Must be called with guest dedup lock held */
+static void dedup_page_del(struct dedup_guest *dg, struct dedup_page *pg)
+{
+	rb_erase(&pg->head, &dg->pages);
+
+	switch (pg->state) {
+	case DEDUP_PAGE_PENDING:
+		dg->stats.pages_pending--;
+		dedup_frame_put(pg->frame, TRUE);
+		break;
+	case DEDUP_PAGE_SHARED:
+		dg->stats.pages_shared--;
+		dedup_frame_put(pg->frame, FALSE);
+		break;
+	case DEDUP_PAGE_PRIVATE:
+		dg->stats.pages_private--;
+		vmm_host_ram_free(pg->hpa, VMM_PAGE_SIZE);
+		break;
+	case DEDUP_PAGE_PINNED:
+		dg->stats.pages_pinned--;
+		break;
+	default:
+		break;
+	};
+
+	vmm_free(pg);
+}
+
+/* Note: Must be called with guest dedup lock held */
+static int dedup_page_unshare(struct dedup_guest *dg, struct dedup_page *pg)
+{
+	physical_addr_t hpa;
+	struct dedup_stale *st;
+
+	st = vmm_malloc(sizeof(*st));
+	if (!st) {
+		return VMM_ENOMEM;
+	}
+	if (!vmm_host_ram_alloc(&hpa, VMM_PAGE_SIZE, VMM_PAGE_SHIFT)) {
+		vmm_free(st);
+		return VMM_ENOMEM;
+	}
+	vmm_host_memory_read(pg->frame->hpa, dg->copy_buf,
+			     VMM_PAGE_SIZE, TRUE);
+	vmm_host_memory_write(hpa, dg->copy_buf, VMM_PAGE_SIZE, TRUE);
+
+	/* Remove read-only mapping of shared frame */
+	arch_guest_unmap_region(dg->guest, pg->reg, pg->gpa, VMM_PAGE_SIZE);
+
+	/* Host might be reading shared frame so drop it later */
+	st->frame = pg->frame;
+	list_add_tail(&st->head, &dg->stale_frames);
+
+	pg->frame = NULL;
+	pg->hpa = hpa;
+	pg->state = DEDUP_PAGE_PRIVATE;
+	dg->stats.pages_shared--;
+	dg->stats.pages_private++;
+	dg->stats.cow_breaks++;
+
+	return VMM_OK;
+}
+
+/* Drop shared frames given up while host accesses were in-flight */
+static void dedup_stale_reap(struct dedup_guest *dg, bool force)
+{
+	irq_flags_t flags;
+	struct dedup_stale *st;
+	LIST_HEAD(reap_list);
+
+	vmm_spin_lock_irqsave_lite(&dg->lock, flags);
+	arch_smp_mb();
+	if (force || !arch_atomic_read(&dg->inflight)) {
+		list_splice_init(&dg->stale_frames, &reap_list);
+	}
+	vmm_spin_unlock_irqrestore_lite(&dg->lock, flags);
+
+	while (!list_empty(&reap_list)) {
+		st = list_entry(list_pop(&reap_list), struct dedup_stale, head);
+		dedup_frame_put(st->frame, FALSE);
+		vmm_free(st);
+	}
+}
+
+/* Note: Must be called with guest dedup lock held */
+static void dedup_page_finalize(struct dedup_guest *dg, struct dedup_page *pg)
+{
+	/* Host might be accessing original page so retry later */
+	arch_smp_mb();
+	if (arch_atomic_read(&dg->inflight)) {
+		return;
+	}
+
+	/* Remove stage2 mapping created after the page became pending */
+	if (arch_guest_unmap_region(dg->guest, pg->reg,
+				    pg->gpa, VMM_PAGE_SIZE)) {
+		dedup_page_del(dg, pg);
+		return;
+	}
+
+	if ((vmm_host_memory_read(pg->orig_hpa, dctrl.scan_buf,
+				  VMM_PAGE_SIZE, TRUE) != VMM_PAGE_SIZE) ||
+	    !dedup_frame_same(pg->frame, dctrl.scan_buf)) {
+		dedup_page_del(dg, pg);
+		return;
+	}
+
+	vmm_spin_lock_lite(&dctrl.frame_lock);
+	pg->frame->pending_count--;
+	pg->frame->ref_count++;
+	vmm_spin_unlock_lite(&dctrl.frame_lock);
+
+	vmm_host_ram_free(pg->orig_hpa, VMM_PAGE_SIZE);
+
+	pg->hpa = pg->frame->hpa;
+	pg->state = DEDUP_PAGE_SHARED;
+	dg->stats.pages_pending--;
+	dg->stats.pages_shared++;
+	dg->stats.pages_merged++;
+}
+
+static void dedup_scan_page(struct dedup_guest *dg, struct vmm_region *reg,
+			    physical_addr_t gpa, physical_addr_t hpa)
+{
+	int rc;
+	u64 hash;
+	irq_flags_t flags;
+	physical_addr_t hpa1;
+	struct dedup_page *pg;
+	struct dedup_unstable *e;
+	struct dedup_frame *frame = NULL;
+
+	vmm_spin_lock_irqsave_lite(&dg->lock, flags);
+	dg->stats.pages_scanned++;
+	pg = dedup_page_find(dg, gpa);
+	if (pg) {
+		if (pg->state == DEDUP_PAGE_PENDING) {
+			dedup_page_finalize(dg, pg);
+		}
+		vmm_spin_unlock_irqrestore_lite(&dg->lock, flags);
+		return;
+	}
+	vmm_spin_unlock_irqrestore_lite(&dg->lock, flags);
+
+	if (vmm_host_memory_read(hpa, dctrl.scan_buf,
+				 VMM_PAGE_SIZE, TRUE) != VMM_PAGE_SIZE) {
+		return;
+	}
+	hash = dedup_hash(dctrl.scan_buf);
+
+	vmm_spin_lock_irqsave_lite(&dg->lock, flags);
+
+	/* Mapping might have changed while we were hashing */
+	if (!dedup_mapping_hpa(reg, gpa, &hpa1) || (hpa1 != hpa) ||
+	    dedup_page_find(dg, gpa)) {
+		goto done;
+	}
+
+	vmm_spin_lock_lite(&dctrl.frame_lock);
+	frame = dedup_frame_find(hash, dctrl.scan_buf);
+	if (!frame) {
+		e = &dctrl.unstable[(u32)hash & (DEDUP_UNSTABLE_SIZE - 1)];
+		if (e->dg && (e->hash == hash) &&
+		    ((e->dg != dg) || (e->gpa != gpa))) {
+			frame = dedup_frame_alloc(hash, dctrl.scan_buf);
+			e->dg = NULL;
+		} else {
+			e->hash = hash;
+			e->dg = dg;
+			e->gpa = gpa;
+		}
+	}
+	if (frame) {
+		frame->pending_count++;
+	}
+	vmm_spin_unlock_lite(&dctrl.frame_lock);
+	if (!frame) {
+		goto done;
+	}
+
+	pg = dedup_page_add(dg, reg, gpa, hpa, DEDUP_PAGE_PENDING);
+	if (!pg) {
+		dedup_frame_put(frame, TRUE);
+		goto done;
+	}
+	pg->frame = frame;
+	dg->stats.pages_pending++;
+
+	/* Guest access after this point will cancel the merge */
+	rc = arch_guest_unmap_region(dg->guest, reg, gpa, VMM_PAGE_SIZE);
+	if (rc) {
+		dedup_page_del(dg, pg);
+		if (rc == VMM_ENOTSUPP) {
+			vmm_printf("%s: stage2 unmap not supported for %s\n",
+				   __func__, dg->guest->name);
+			dg->disabled = TRUE;
+		}
+	}
+
+done:
+	vmm_spin_unlock_irqrestore_lite(&dg->lock, flags);
+}
+
+struct dedup_region_find {
+	physical_addr_t gpa;
+	struct vmm_region *reg;
+};
+
+static void dedup_region_find_iter(struct vmm_guest *guest,
+				   struct vmm_region *reg, void *priv)
+{
+	struct dedup_region_find *f = priv;
+
+	if (!dedup_region_eligible(reg) ||
+	    (VMM_REGION_GPHYS_END(reg) <= f->gpa)) {
+		return;
+	}
+
+	if (!f->reg ||
+	    (VMM_REGION_GPHYS_START(reg) < VMM_REGION_GPHYS_START(f->reg))) {
+		f->reg = reg;
+	}
+}
+
+/* Find eligible region containing or following given address */
+static struct vmm_region *dedup_region_find(struct vmm_guest *guest,
+					    physical_addr_t gpa)
+{
+	struct dedup_region_find f = { .gpa = gpa, .reg = NULL };
+
+	vmm_guest_iterate_region(guest, VMM_REGION_MEMORY,
+				 dedup_region_find_iter, &f);
+
+	return f.reg;
+}
+
+static u32 dedup_scan_guest(struct dedup_guest *dg, u32 budget, bool *done)
+{
+	u32 count = 0;
+	struct vmm_region *reg;
+	physical_addr_t gpa, hpa, cend;
+	physical_size_t csize;
+
+	*done = FALSE;
+	if (dg->disabled) {
+		*done = TRUE;
+		return 0;
+	}
+
+	gpa = dg->scan_gpa;
+	while (count < budget) {
+		reg = dedup_region_find(dg->guest, gpa);
+		if (!reg) {
+			*done = TRUE;
+			gpa = 0;
+			break;
+		}
+		if (gpa < VMM_REGION_GPHYS_START(reg)) {
+			gpa = VMM_REGION_GPHYS_START(reg);
+		}
+
+		/* End of current region mapping */
+		csize = ((physical_size_t)1) << reg->map_order;
+		cend = reg->gphys_addr +
+			((gpa - reg->gphys_addr) & ~(csize - 1)) + csize;
+		if (VMM_REGION_GPHYS_END(reg) < cend) {
+			cend = VMM_REGION_GPHYS_END(reg);
+		}
+
+		/* Skip on-demand mappings which are not populated */
+		if (!dedup_mapping_hpa(reg, gpa, &hpa)) {
+			gpa = cend;
+			count++;
+			continue;
+		}
+
+		while ((gpa < cend) && (count < budget)) {
+			dedup_scan_page(dg, reg, gpa, hpa);
+			gpa += VMM_PAGE_SIZE;
+			hpa += VMM_PAGE_SIZE;
+			count++;
+		}
+	}
+	dg->scan_gpa = gpa;
+
+	return count;
+}
+
+static void dedup_scan(void)
+{
+	bool done;
+	u32 count, budget = dctrl.pages_to_scan;
+	struct dedup_guest *dg;
+
+	vmm_mutex_lock(&dctrl.guest_list_lock);
+
+	while (budget && !list_empty(&dctrl.guest_list)) {
+		if (!dctrl.curr) {
+			dctrl.curr = list_first_entry(&dctrl.guest_list,
+						struct dedup_guest, head);
+		}
+		dg = dctrl.curr;
+
+		count = dedup_scan_guest(dg, budget, &done);
+		budget -= (count < budget) ? count : budget;
+		if (!done) {
+			continue;
+		}
+		dg->stats.full_scans++;
+
+		if (!list_is_last(&dg->head, &dctrl.guest_list)) {
+			dctrl.curr = list_entry(dg->head.next,
+						struct dedup_guest, head);
+			continue;
+		}
+
+		/* All guests scanned so start over with fresh hashes */
+		dctrl.curr = NULL;
+		dctrl.full_scans++;
+		memset(dctrl.unstable, 0,
+		       DEDUP_UNSTABLE_SIZE * sizeof(*dctrl.unstable));
+		break;
+	}
+
+	vmm_mutex_unlock(&dctrl.guest_list_lock);
+}
+
+static int dedup_main(void *data)
+{
+	u64 tstamp;
+
+	while (1) {
+		tstamp = (u64)dctrl.sleep_msecs * 1000000ULL;
+		vmm_completion_wait_timeout(&dctrl.dedup_cmpl, &tstamp);
+
+		dedup_scan();
+	}
+
+	return VMM_OK;
+}
+
+int vmm_guest_dedup_attach(struct vmm_guest *guest)
+{
+	struct dedup_guest *dg;
+
+	if (!guest) {
+		return VMM_EINVALID;
+	}
+
+	guest->aspace.dedup_priv = NULL;
+	if (!vmm_devtree_getattr(guest->node, VMM_GUEST_DEDUP_ATTR_NAME)) {
+		return VMM_OK;
+	}
+
+	dg = vmm_zalloc(sizeof(*dg));
+	if (!dg) {
+		return VMM_ENOMEM;
+	}
+	INIT_LIST_HEAD(&dg->head);
+	dg->guest = guest;
+	arch_atomic_write(&dg->inflight, 0);
+	INIT_SPIN_LOCK(&dg->lock);
+	dg->pages = RB_ROOT;
+	INIT_LIST_HEAD(&dg->stale_frames);
+	dg->copy_buf = vmm_malloc(VMM_PAGE_SIZE);
+	if (!dg->copy_buf) {
+		vmm_free(dg);
+		return VMM_ENOMEM;
+	}
+
+	vmm_mutex_lock(&dctrl.guest_list_lock);
+	list_add_tail(&dg->head, &dctrl.guest_list);
+	dg->scanning = TRUE;
+	vmm_mutex_unlock(&dctrl.guest_list_lock);
+
+	guest->aspace.dedup_priv = dg;
+
+	return VMM_OK;
+}
+
+void vmm_guest_dedup_detach(struct vmm_guest *guest)
+{
+	u32 i;
+	struct dedup_guest *dg;
+
+	if (!guest || !guest->aspace.dedup_priv) {
+		return;
+	}
+	dg = guest->aspace.dedup_priv;
+
+	vmm_mutex_lock(&dctrl.guest_list_lock);
+	if (dg->scanning) {
+		if (dctrl.curr == dg) {
+			dctrl.curr = NULL;
+		}
+		list_del(&dg->head);
+		dg->scanning = FALSE;
+		for (i = 0; i < DEDUP_UNSTABLE_SIZE; i++) {
+			if (dctrl.unstable[i].dg == dg) {
+				dctrl.unstable[i].dg = NULL;
+			}
+		}
+	}
+	vmm_mutex_unlock(&dctrl.guest_list_lock);
+}
+
+void vmm_guest_dedup_cleanup(struct vmm_guest *guest)
+{
+	irq_flags_t flags;
+	struct dedup_guest *dg;
+	struct dedup_page *pg, *n;
+
+	if (!guest || !guest->aspace.dedup_priv) {
+		return;
+	}
+	dg = guest->aspace.dedup_priv;
+
+	vmm_guest_dedup_detach(guest);
+
+	/* Regions are gone so whatever remains is only bookkeeping */
+	vmm_spin_lock_irqsave_lite(&dg->lock, flags);
+	rbtree_postorder_for_each_entry_safe(pg, n, &dg->pages, head) {
+		dedup_page_del(dg, pg);
+	}
+	dg->pages = RB_ROOT;
+	vmm_spin_unlock_irqrestore_lite(&dg->lock, flags);
+	dedup_stale_reap(dg, TRUE);
+
+	guest->aspace.dedup_priv = NULL;
+	vmm_free(dg->copy_buf);
+	vmm_free(dg);
+}
+
+bool vmm_guest_dedup_enabled(struct vmm_guest *guest)
+{
+	return (guest && guest->aspace.dedup_priv) ? TRUE : FALSE;
+}
+
+int vmm_guest_dedup_fault(struct vmm_guest *guest,
+			  physical_addr_t gphys_addr, bool write,
+			  physical_addr_t *hphys_addr, u32 *reg_flags)
+{
+	int rc = VMM_OK;
+	irq_flags_t flags;
+	struct dedup_page *pg;
+	struct dedup_guest *dg;
+
+	if (!guest || !guest->aspace.dedup_priv) {
+		return VMM_ENOENT;
+	}
+	dg = guest->aspace.dedup_priv;
+	gphys_addr &= ~VMM_PAGE_MASK;
+
+	vmm_spin_lock_irqsave_lite(&dg->lock, flags);
+
+	pg = dedup_page_find(dg, gphys_addr);
+	if (!pg) {
+		rc = VMM_ENOENT;
+		goto done;
+	}
+
+	switch (pg->state) {
+	case DEDUP_PAGE_PENDING:
+		/* Guest is using the page so don't merge it */
+		dedup_page_del(dg, pg);
+		rc = VMM_ENOENT;
+		break;
+	case DEDUP_PAGE_SHARED:
+		if (write) {
+			rc = dedup_page_unshare(dg, pg);
+			if (rc) {
+				break;
+			}
+		}
+		/* Fall-through */
+	case DEDUP_PAGE_PRIVATE:
+		if (hphys_addr) {
+			*hphys_addr = pg->hpa;
+		}
+		if (reg_flags) {
+			*reg_flags = pg->reg->flags;
+			if (pg->state == DEDUP_PAGE_SHARED) {
+				*reg_flags |= VMM_REGION_READONLY;
+			}
+		}
+		break;
+	default:
+		rc = VMM_ENOENT;
+		break;
+	};
+
+done:
+	vmm_spin_unlock_irqrestore_lite(&dg->lock, flags);
+
+	return rc;
+}
+
+void vmm_guest_dedup_access(struct vmm_guest *guest,
+			    physical_addr_t gphys_addr, bool write,
+			    physical_addr_t *hphys_addr,
+			    physical_size_t *avail_size)
+{
+	irq_flags_t flags;
+	physical_addr_t gpa;
+	struct dedup_page *pg;
+	struct dedup_guest *dg;
+
+	if (!guest || !guest->aspace.dedup_priv ||
+	    !hphys_addr || !avail_size || !(*avail_size)) {
+		return;
+	}
+	dg = guest->aspace.dedup_priv;
+	gpa = gphys_addr & ~VMM_PAGE_MASK;
+
+	vmm_spin_lock_irqsave_lite(&dg->lock, flags);
+
+	pg = dedup_page_find(dg, gpa);
+	if (write && pg && (pg->state == DEDUP_PAGE_PENDING)) {
+		/* Host is writing the page so don't merge it */
+		dedup_page_del(dg, pg);
+		pg = NULL;
+	}
+	if (write && pg && (pg->state == DEDUP_PAGE_SHARED) &&
+	    dedup_page_unshare(dg, pg)) {
+		*hphys_addr = 0;
+		*avail_size = 0;
+		goto done;
+	}
+	if (pg && ((pg->state == DEDUP_PAGE_SHARED) ||
+		   (pg->state == DEDUP_PAGE_PRIVATE))) {
+		*hphys_addr = pg->hpa + (gphys_addr - gpa);
+		*avail_size = VMM_PAGE_SIZE - (gphys_addr - gpa);
+		goto done;
+	}
+
+	/* Region mapping is valid only till next deduplicated page */
+	pg = dedup_page_find_next(dg, gpa);
+	while (pg && (pg->gpa < (gphys_addr + *avail_size))) {
+		if ((pg->state == DEDUP_PAGE_SHARED) ||
+		    (pg->state == DEDUP_PAGE_PRIVATE)) {
+			*avail_size = pg->gpa - gphys_addr;
+			break;
+		}
+		pg = dedup_page_find_next(dg, pg->gpa);
+	}
+
+done:
+	vmm_spin_unlock_irqrestore_lite(&dg->lock, flags);
+}
+
+void vmm_guest_dedup_access_begin(struct vmm_guest *guest)
+{
+	struct dedup_guest *dg;
+
+	if (!guest || !guest->aspace.dedup_priv) {
+		return;
+	}
+	dg = guest->aspace.dedup_priv;
+
+	arch_atomic_add(&dg->inflight, 1);
+	arch_smp_mb();
+}
+
+void vmm_guest_dedup_access_end(struct vmm_guest *guest)
+{
+	struct dedup_guest *dg;
+
+	if (!guest || !guest->aspace.dedup_priv) {
+		return;
+	}
+	dg = guest->aspace.dedup_priv;
+
+	arch_smp_mb();
+	arch_atomic_sub(&dg->inflight, 1);
+
+	if (!list_empty(&dg->stale_frames)) {
+		dedup_stale_reap(dg, FALSE);
+	}
+}
+
+/* Note: Must be called with guest dedup lock held */
+static void dedup_page_pin(struct dedup_guest *dg, struct vmm_region *reg,
+			   physical_addr_t gpa, physical_addr_t hpa)
+{
+	struct dedup_page *pg = dedup_page_find(dg, gpa);
+
+	if (!pg) {
+		pg = dedup_page_add(dg, reg, gpa, hpa, DEDUP_PAGE_PINNED);
+		if (pg) {
+			dg->stats.pages_pinned++;
+		}
+		return;
+	}
+
+	switch (pg->state) {
+	case DEDUP_PAGE_PENDING:
+		break;
+	case DEDUP_PAGE_SHARED:
+	case DEDUP_PAGE_PRIVATE:
+		/*
+		 * Host mappings usually span multiple pages so try
+		 * to take back the original host page. If somebody
+		 * else got it then guest page stays private.
+		 */
+		if (vmm_host_ram_reserve(pg->orig_hpa, VMM_PAGE_SIZE)) {
+			if (pg->state == DEDUP_PAGE_SHARED) {
+				dedup_page_unshare(dg, pg);
+			}
+			return;
+		}
+		vmm_host_memory_read(pg->hpa, dg->copy_buf,
+				     VMM_PAGE_SIZE, TRUE);
+		vmm_host_memory_write(pg->orig_hpa, dg->copy_buf,
+				      VMM_PAGE_SIZE, TRUE);
+		arch_guest_unmap_region(dg->guest, pg->reg,
+					pg->gpa, VMM_PAGE_SIZE);
+		break;
+	default:
+		return;
+	};
+
+	dedup_page_del(dg, pg);
+	pg = dedup_page_add(dg, reg, gpa, hpa, DEDUP_PAGE_PINNED);
+	if (pg) {
+		dg->stats.pages_pinned++;
+	}
+}
+
+void vmm_guest_dedup_pin(struct vmm_guest *guest,
+			 physical_addr_t gphys_addr,
+			 physical_size_t phys_size)
+{
+	irq_flags_t flags;
+	struct vmm_region *reg;
+	struct dedup_guest *dg;
+	physical_addr_t gpa, gend, hpa;
+
+	if (!guest || !guest->aspace.dedup_priv || !phys_size) {
+		return;
+	}
+	dg = guest->aspace.dedup_priv;
+
+	gpa = gphys_addr & ~VMM_PAGE_MASK;
+	gend = gphys_addr + phys_size;
+	while (gpa < gend) {
+		reg = vmm_guest_find_region(guest, gpa,
+				VMM_REGION_REAL | VMM_REGION_MEMORY, FALSE);
+		if (!reg) {
+			break;
+		}
+		if (!dedup_region_eligible(reg)) {
+			gpa = VMM_REGION_GPHYS_END(reg);
+			continue;
+		}
+
+		vmm_spin_lock_irqsave_lite(&dg->lock, flags);
+		if (dedup_mapping_hpa(reg, gpa, &hpa)) {
+			dedup_page_pin(dg, reg, gpa, hpa);
+		}
+		vmm_spin_unlock_irqrestore_lite(&dg->lock, flags);
+
+		gpa += VMM_PAGE_SIZE;
+	}
+}
+
+int vmm_guest_dedup_free(struct vmm_guest *guest,
+			 physical_addr_t gphys_addr,
+			 physical_addr_t hphys_addr,
+			 physical_size_t phys_size)
+{
+	int rc = VMM_OK;
+	irq_flags_t flags;
+	physical_addr_t gpa, gend, last;
+	struct dedup_page *pg;
+	struct dedup_guest *dg;
+
+	if (!guest || !guest->aspace.dedup_priv) {
+		return vmm_host_ram_free(hphys_addr, phys_size);
+	}
+	dg = guest->aspace.dedup_priv;
+
+	gpa = gphys_addr;
+	gend = gphys_addr + phys_size;
+
+	vmm_spin_lock_irqsave_lite(&dg->lock, flags);
+
+	pg = dedup_page_find(dg, gpa);
+	if (!pg) {
+		pg = dedup_page_find_next(dg, gpa);
+	}
+	while (pg && (pg->gpa < gend)) {
+		/* Original host page of merged guest page is already freed */
+		if ((pg->state == DEDUP_PAGE_SHARED) ||
+		    (pg->state == DEDUP_PAGE_PRIVATE)) {
+			if (gpa < pg->gpa) {
+				rc |= vmm_host_ram_free(hphys_addr +
+						(gpa - gphys_addr), pg->gpa - gpa);
+			}
+			gpa = pg->gpa + VMM_PAGE_SIZE;
+		}
+		last = pg->gpa;
+		dedup_page_del(dg, pg);
+		pg = dedup_page_find_next(dg, last);
+	}
+	if (gpa < gend) {
+		rc |= vmm_host_ram_free(hphys_addr + (gpa - gphys_addr),
+					gend - gpa);
+	}
+
+	vmm_spin_unlock_irqrestore_lite(&dg->lock, flags);
+
+	return (rc) ? VMM_EFAIL : VMM_OK;
+}
+
+int vmm_guest_dedup_get_stats(struct vmm_guest *guest,
+			      struct vmm_guest_dedup_stats *stats)
+{
+	irq_flags_t flags;
+	struct dedup_guest *dg;
+
+	if (!guest || !stats) {
+		return VMM_EINVALID;
+	}
+	if (!guest->aspace.dedup_priv) {
+		return VMM_ENOTAVAIL;
+	}
+	dg = guest->aspace.dedup_priv;
+
+	vmm_spin_lock_irqsave_lite(&dg->lock, flags);
+	memcpy(stats, &dg->stats, sizeof(*stats));
+	vmm_spin_unlock_irqrestore_lite(&dg->lock, flags);
+
+	return VMM_OK;
+}
+
+u32 vmm_guest_dedup_frame_count(void)
+{
+	return dctrl.frame_count;
+}
+
+u64 vmm_guest_dedup_full_scans(void)
+{
+	return dctrl.full_scans;
+}
+
+u32 vmm_guest_dedup_pages_to_scan(void)
+{
+	return dctrl.pages_to_scan;
+}
+
+u32 vmm_guest_dedup_sleep_msecs(void)
+{
+	return dctrl.sleep_msecs;
+}
+
+int vmm_guest_dedup_set_rate(u32 pages_to_scan, u32 sleep_msecs)
+{
+	if (!pages_to_scan || !sleep_msecs) {
+		return VMM_EINVALID;
+	}
+
+	dctrl.pages_to_scan = pages_to_scan;
+	dctrl.sleep_msecs = sleep_msecs;
+
+	/* Let the scanner pick new sleep time right away */
+	vmm_completion_complete(&dctrl.dedup_cmpl);
+
+	return VMM_OK;
+}
+
+int __init vmm_guest_dedup_init(void)
+{
+	int rc;
+
+	memset(&dctrl, 0, sizeof(dctrl));
+
+	INIT_MUTEX(&dctrl.guest_list_lock);
+	INIT_LIST_HEAD(&dctrl.guest_list);
+	dctrl.curr = NULL;
+	INIT_SPIN_LOCK(&dctrl.frame_lock);
+	dctrl.frames = RB_ROOT;
+	dctrl.pages_to_scan = CONFIG_GUEST_DEDUP_PAGES_TO_SCAN;
+	dctrl.sleep_msecs = CONFIG_GUEST_DEDUP_SLEEP_MSECS;
+	INIT_COMPLETION(&dctrl.dedup_cmpl);
+
+	dctrl.unstable = vmm_zalloc(DEDUP_UNSTABLE_SIZE *
+				    sizeof(*dctrl.unstable));
+	if (!dctrl.unstable) {
+		return VMM_ENOMEM;
+	}
+
+	dctrl.scan_buf = vmm_malloc(VMM_PAGE_SIZE);
+	dctrl.cmp_buf = vmm_malloc(VMM_PAGE_SIZE);
+	if (!dctrl.scan_buf || !dctrl.cmp_buf) {
+		rc = VMM_ENOMEM;
+		goto fail_free_buf;
+	}
+
+	dctrl.dedup_thread = vmm_threads_create("dedup", dedup_main, NULL,
+						DEDUP_PRIORITY,
+						DEDUP_TIMESLICE);
+	if (!dctrl.dedup_thread) {
+		rc = VMM_EFAIL;
+		goto fail_free_buf;
+	}
+
+	if ((rc = vmm_threads_start(dctrl.dedup_thread))) {
+		goto fail_destroy_thread;
+	}
+
+	return VMM_OK;
+
+fail_destroy_thread:
+	vmm_threads_destroy(dctrl.dedup_thread);
+fail_free_buf:
+	if (dctrl.cmp_buf) {
+		vmm_free(dctrl.cmp_buf);
+	}
+	if (dctrl.scan_buf) {
+		vmm_free(dctrl.scan_buf);
+	}
+	vmm_free(dctrl.unstable);
+	return rc;
+}
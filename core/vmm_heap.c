@@ -27,8 +27,13 @@
 #include <vmm_error.h>
 #include <vmm_cache.h>
 #include <vmm_heap.h>
+#include <vmm_limits.h>
+#include <vmm_smp.h>
 #include <vmm_stdio.h>
+#include <vmm_spinlocks.h>
 #include <vmm_host_aspace.h>
+#include <arch_cpu_irq.h>
+#include <libs/list.h>
 #include <libs/stringlib.h>
 #include <libs/buddy.h>
 
@@ -219,8 +224,597 @@ fail_free_pages:
 	return rc;
 }
 
+#ifdef CONFIG_HEAP_SLAB
+
+/*
+ * Slab layer for Normal heap
+ *
+ * Small objects are carved out of slabs of HEAP_SLAB_SIZE bytes which
+ * are allocated from the buddy allocator. Each kmem cache has per-CPU
+ * magazines of free objects so that common alloc/free operations only
+ * disable local interrupts. Slabs and magazines are exchanged in batches
+ * of half magazine under the cache lock. A page map translates object
+ * address to slab so that vmm_free() works for slab objects too.
+ */
+
+#define HEAP_SLAB_SHIFT		(VMM_PAGE_SHIFT + 2)
+#define HEAP_SLAB_SIZE		(1UL << HEAP_SLAB_SHIFT)
+#define HEAP_SLAB_PAGES		(HEAP_SLAB_SIZE >> VMM_PAGE_SHIFT)
+#define HEAP_MAG_SIZE		32
+#define HEAP_CLASS_COUNT	(HEAP_MAX_BIN - HEAP_MIN_BIN + 1)
+#define HEAP_OBJ_ALIGN		(sizeof(u64))
+
+struct heap_slab {
+	struct dlist head;
+	struct vmm_kmem_cache *cache;
+	void *base;
+	u32 inuse;
+	void *free_list;
+};
+
+struct heap_magazine {
+	u32 count;
+	void *objs[HEAP_MAG_SIZE];
+	u64 alloc_hit;
+	u64 alloc_miss;
+	u64 free_hit;
+	u64 free_flush;
+} __cacheline_aligned;
+
+struct vmm_kmem_cache {
+	struct dlist head;
+	char name[VMM_FIELD_NAME_SIZE];
+	u32 obj_size;
+	u32 objs_per_slab;
+	u32 mag_limit;
+	vmm_spinlock_t lock;
+	struct dlist partial_list;
+	struct dlist full_list;
+	struct dlist empty_list;
+	u32 slab_count;
+	u32 empty_count;
+	u32 obj_free;
+	struct heap_magazine mag[CONFIG_CPU_COUNT];
+};
+
+struct heap_slab_control {
+	bool ready;
+	struct heap_slab **map;
+	unsigned long map_count;
+	vmm_spinlock_t lock;
+	struct dlist cache_list;
+	u32 cache_count;
+	struct vmm_kmem_cache classes[HEAP_CLASS_COUNT];
+};
+
+static struct heap_slab_control slabctrl;
+
+static inline struct heap_slab *heap_slab_find(const void *ptr)
+{
+	unsigned long idx;
+
+	if ((ptr < normal_heap.mem_start) ||
+	    ((normal_heap.mem_start + normal_heap.mem_size) <= ptr)) {
+		return NULL;
+	}
+
+	idx = (unsigned long)(ptr - normal_heap.mem_start) >> VMM_PAGE_SHIFT;
+
+	return (idx < slabctrl.map_count) ? slabctrl.map[idx] : NULL;
+}
+
+static void heap_slab_map(struct heap_slab *slab, struct heap_slab *val)
+{
+	unsigned long i, idx;
+
+	idx = (unsigned long)(slab->base - normal_heap.mem_start) >>
+							VMM_PAGE_SHIFT;
+	for (i = 0; i < HEAP_SLAB_PAGES; i++) {
+		slabctrl.map[idx + i] = val;
+	}
+}
+
+/* Note: must be called with cache lock held */
+static struct heap_slab *heap_slab_create(struct vmm_kmem_cache *cache)
+{
+	u32 i;
+	void *obj;
+	struct heap_slab *slab;
+
+	slab = heap_malloc(&normal_heap, sizeof(*slab));
+	if (!slab) {
+		return NULL;
+	}
+
+	slab->base = heap_malloc(&normal_heap, HEAP_SLAB_SIZE);
+	if (!slab->base) {
+		heap_free(&normal_heap, slab);
+		return NULL;
+	}
+
+	INIT_LIST_HEAD(&slab->head);
+	slab->cache = cache;
+	slab->inuse = 0;
+	slab->free_list = NULL;
+	for (i = cache->objs_per_slab; i > 0; i--) {
+		obj = slab->base + (i - 1) * cache->obj_size;
+		*(void **)obj = slab->free_list;
+		slab->free_list = obj;
+	}
+
+	heap_slab_map(slab, slab);
+
+	cache->slab_count++;
+	cache->obj_free += cache->objs_per_slab;
+
+	return slab;
+}
+
+/* Note: must be called with cache lock held */
+static void heap_slab_destroy(struct heap_slab *slab)
+{
+	struct vmm_kmem_cache *cache = slab->cache;
+
+	list_del(&slab->head);
+	heap_slab_map(slab, NULL);
+
+	cache->slab_count--;
+	cache->obj_free -= cache->objs_per_slab;
+
+	heap_free(&normal_heap, slab->base);
+	heap_free(&normal_heap, slab);
+}
+
+/* Note: must be called with cache lock held */
+static void *heap_slab_get_obj(struct vmm_kmem_cache *cache)
+{
+	void *obj;
+	struct heap_slab *slab;
+
+	if (!list_empty(&cache->partial_list)) {
+		slab = list_first_entry(&cache->partial_list,
+					struct heap_slab, head);
+	} else if (!list_empty(&cache->empty_list)) {
+		slab = list_first_entry(&cache->empty_list,
+					struct heap_slab, head);
+		list_del(&slab->head);
+		list_add(&slab->head, &cache->partial_list);
+		cache->empty_count--;
+	} else {
+		slab = heap_slab_create(cache);
+		if (!slab) {
+			return NULL;
+		}
+		list_add(&slab->head, &cache->partial_list);
+	}
+
+	obj = slab->free_list;
+	slab->free_list = *(void **)obj;
+	slab->inuse++;
+	cache->obj_free--;
+
+	if (!slab->free_list) {
+		list_del(&slab->head);
+		list_add(&slab->head, &cache->full_list);
+	}
+
+	return obj;
+}
+
+/* Note: must be called with cache lock held */
+static void heap_slab_put_obj(struct vmm_kmem_cache *cache, void *obj)
+{
+	struct heap_slab *slab = heap_slab_find(obj);
+
+	BUG_ON(!slab || (slab->cache != cache));
+
+	if (!slab->free_list) {
+		list_del(&slab->head);
+		list_add(&slab->head, &cache->partial_list);
+	}
+
+	*(void **)obj = slab->free_list;
+	slab->free_list = obj;
+	slab->inuse--;
+	cache->obj_free++;
+
+	if (!slab->inuse) {
+		/* Keep one empty slab around to avoid thrashing buddy */
+		if (cache->empty_count) {
+			heap_slab_destroy(slab);
+		} else {
+			list_del(&slab->head);
+			list_add(&slab->head, &cache->empty_list);
+			cache->empty_count++;
+		}
+	}
+}
+
+static void heap_mag_refill(struct vmm_kmem_cache *cache,
+			    struct heap_magazine *mag)
+{
+	void *obj;
+	u32 batch = cache->mag_limit / 2;
+
+	vmm_spin_lock_lite(&cache->lock);
+	while (mag->count < batch) {
+		obj = heap_slab_get_obj(cache);
+		if (!obj) {
+			break;
+		}
+		mag->objs[mag->count++] = obj;
+	}
+	vmm_spin_unlock_lite(&cache->lock);
+}
+
+static void heap_mag_flush(struct vmm_kmem_cache *cache,
+			   struct heap_magazine *mag, u32 count)
+{
+	vmm_spin_lock_lite(&cache->lock);
+	while (count-- && mag->count) {
+		heap_slab_put_obj(cache, mag->objs[--mag->count]);
+	}
+	vmm_spin_unlock_lite(&cache->lock);
+}
+
+static void *heap_cache_alloc(struct vmm_kmem_cache *cache)
+{
+	void *obj = NULL;
+	irq_flags_t flags;
+	struct heap_magazine *mag;
+
+	arch_cpu_irq_save(flags);
+
+	mag = &cache->mag[vmm_smp_processor_id()];
+	if (mag->count) {
+		mag->alloc_hit++;
+	} else {
+		mag->alloc_miss++;
+		heap_mag_refill(cache, mag);
+	}
+	if (mag->count) {
+		obj = mag->objs[--mag->count];
+	}
+
+	arch_cpu_irq_restore(flags);
+
+	return obj;
+}
+
+static void heap_cache_free(struct vmm_kmem_cache *cache, void *obj)
+{
+	irq_flags_t flags;
+	struct heap_magazine *mag;
+
+	arch_cpu_irq_save(flags);
+
+	mag = &cache->mag[vmm_smp_processor_id()];
+	if (mag->count < cache->mag_limit) {
+		mag->free_hit++;
+	} else {
+		mag->free_flush++;
+		heap_mag_flush(cache, mag, cache->mag_limit / 2);
+	}
+	mag->objs[mag->count++] = obj;
+
+	arch_cpu_irq_restore(flags);
+}
+
+static void heap_cache_setup(struct vmm_kmem_cache *cache,
+			     const char *name, u32 obj_size)
+{
+	memset(cache, 0, sizeof(*cache));
+
+	INIT_LIST_HEAD(&cache->head);
+	strlcpy(cache->name, name, sizeof(cache->name));
+	cache->obj_size = obj_size;
+	cache->objs_per_slab = HEAP_SLAB_SIZE / obj_size;
+	cache->mag_limit = (cache->objs_per_slab < HEAP_MAG_SIZE) ?
+				cache->objs_per_slab : HEAP_MAG_SIZE;
+	INIT_SPIN_LOCK(&cache->lock);
+	INIT_LIST_HEAD(&cache->partial_list);
+	INIT_LIST_HEAD(&cache->full_list);
+	INIT_LIST_HEAD(&cache->empty_list);
+}
+
+static void heap_cache_add(struct vmm_kmem_cache *cache)
+{
+	irq_flags_t flags;
+
+	vmm_spin_lock_irqsave_lite(&slabctrl.lock, flags);
+	list_add_tail(&cache->head, &slabctrl.cache_list);
+	slabctrl.cache_count++;
+	vmm_spin_unlock_irqrestore_lite(&slabctrl.lock, flags);
+}
+
+static void *heap_slab_malloc(virtual_size_t size)
+{
+	unsigned long bin = HEAP_MIN_BIN;
+
+	while ((1UL << bin) < size) {
+		bin++;
+	}
+
+	return heap_cache_alloc(&slabctrl.classes[bin - HEAP_MIN_BIN]);
+}
+
+static int __init heap_slab_init(void)
+{
+	u32 i;
+	char name[VMM_FIELD_NAME_SIZE];
+
+	memset(&slabctrl, 0, sizeof(slabctrl));
+	INIT_SPIN_LOCK(&slabctrl.lock);
+	INIT_LIST_HEAD(&slabctrl.cache_list);
+
+	slabctrl.map_count = normal_heap.mem_size >> VMM_PAGE_SHIFT;
+	slabctrl.map = heap_malloc(&normal_heap,
+			slabctrl.map_count * sizeof(*slabctrl.map));
+	if (!slabctrl.map) {
+		return VMM_ENOMEM;
+	}
+	memset(slabctrl.map, 0, slabctrl.map_count * sizeof(*slabctrl.map));
+
+	for (i = 0; i < HEAP_CLASS_COUNT; i++) {
+		vmm_snprintf(name, sizeof(name), "heap-%lu",
+			     1UL << (HEAP_MIN_BIN + i));
+		heap_cache_setup(&slabctrl.classes[i], name,
+				 1UL << (HEAP_MIN_BIN + i));
+		heap_cache_add(&slabctrl.classes[i]);
+	}
+
+	slabctrl.ready = TRUE;
+
+	return VMM_OK;
+}
+
+struct vmm_kmem_cache *vmm_kmem_cache_create(const char *name,
+					     virtual_size_t size)
+{
+	struct vmm_kmem_cache *cache;
+
+	if (!name || !size || (VMM_PAGE_SIZE < size) || !slabctrl.ready) {
+		return NULL;
+	}
+
+	cache = heap_malloc(&normal_heap, sizeof(*cache));
+	if (!cache) {
+		return NULL;
+	}
+
+	size = (size + HEAP_OBJ_ALIGN - 1) & ~(HEAP_OBJ_ALIGN - 1);
+	heap_cache_setup(cache, name, size);
+	heap_cache_add(cache);
+
+	return cache;
+}
+
+int vmm_kmem_cache_destroy(struct vmm_kmem_cache *cache)
+{
+	u32 c;
+	irq_flags_t flags;
+	struct heap_slab *slab;
+
+	if (!cache) {
+		return VMM_EINVALID;
+	}
+	if ((&slabctrl.classes[0] <= cache) &&
+	    (cache < &slabctrl.classes[HEAP_CLASS_COUNT])) {
+		return VMM_EINVALID;
+	}
+
+	for (c = 0; c < CONFIG_CPU_COUNT; c++) {
+		heap_mag_flush(cache, &cache->mag[c], HEAP_MAG_SIZE);
+	}
+
+	vmm_spin_lock_irqsave_lite(&cache->lock, flags);
+	if (!list_empty(&cache->partial_list) ||
+	    !list_empty(&cache->full_list)) {
+		vmm_spin_unlock_irqrestore_lite(&cache->lock, flags);
+		return VMM_EBUSY;
+	}
+	while (!list_empty(&cache->empty_list)) {
+		slab = list_first_entry(&cache->empty_list,
+					struct heap_slab, head);
+		heap_slab_destroy(slab);
+	}
+	vmm_spin_unlock_irqrestore_lite(&cache->lock, flags);
+
+	vmm_spin_lock_irqsave_lite(&slabctrl.lock, flags);
+	list_del(&cache->head);
+	slabctrl.cache_count--;
+	vmm_spin_unlock_irqrestore_lite(&slabctrl.lock, flags);
+
+	heap_free(&normal_heap, cache);
+
+	return VMM_OK;
+}
+
+void *vmm_kmem_cache_alloc(struct vmm_kmem_cache *cache)
+{
+	if (!cache) {
+		return NULL;
+	}
+
+	return heap_cache_alloc(cache);
+}
+
+void *vmm_kmem_cache_zalloc(struct vmm_kmem_cache *cache)
+{
+	void *ret = vmm_kmem_cache_alloc(cache);
+
+	if (ret) {
+		memset(ret, 0, cache->obj_size);
+	}
+
+	return ret;
+}
+
+void vmm_kmem_cache_free(struct vmm_kmem_cache *cache, void *obj)
+{
+	if (!cache || !obj) {
+		return;
+	}
+
+	heap_cache_free(cache, obj);
+}
+
+const char *vmm_kmem_cache_name(struct vmm_kmem_cache *cache)
+{
+	return (cache) ? cache->name : NULL;
+}
+
+int vmm_kmem_cache_stats(struct vmm_kmem_cache *cache,
+			 struct vmm_kmem_cache_stats *stats)
+{
+	u32 c;
+	irq_flags_t flags;
+
+	if (!cache || !stats) {
+		return VMM_EINVALID;
+	}
+
+	memset(stats, 0, sizeof(*stats));
+
+	vmm_spin_lock_irqsave_lite(&cache->lock, flags);
+	stats->obj_size = cache->obj_size;
+	stats->objs_per_slab = cache->objs_per_slab;
+	stats->slab_count = cache->slab_count;
+	stats->obj_total = cache->slab_count * cache->objs_per_slab;
+	stats->obj_free = cache->obj_free;
+	vmm_spin_unlock_irqrestore_lite(&cache->lock, flags);
+
+	for (c = 0; c < CONFIG_CPU_COUNT; c++) {
+		stats->obj_cached += cache->mag[c].count;
+		stats->alloc_hit += cache->mag[c].alloc_hit;
+		stats->alloc_miss += cache->mag[c].alloc_miss;
+		stats->free_hit += cache->mag[c].free_hit;
+		stats->free_flush += cache->mag[c].free_flush;
+	}
+
+	return VMM_OK;
+}
+
+struct vmm_kmem_cache *vmm_kmem_cache_get(int index)
+{
+	irq_flags_t flags;
+	struct vmm_kmem_cache *c, *ret = NULL;
+
+	if (index < 0) {
+		return NULL;
+	}
+
+	vmm_spin_lock_irqsave_lite(&slabctrl.lock, flags);
+	list_for_each_entry(c, &slabctrl.cache_list, head) {
+		if (!index) {
+			ret = c;
+			break;
+		}
+		index--;
+	}
+	vmm_spin_unlock_irqrestore_lite(&slabctrl.lock, flags);
+
+	return ret;
+}
+
+u32 vmm_kmem_cache_count(void)
+{
+	return slabctrl.cache_count;
+}
+
+#else
+
+struct vmm_kmem_cache {
+	virtual_size_t obj_size;
+};
+
+struct vmm_kmem_cache *vmm_kmem_cache_create(const char *name,
+					     virtual_size_t size)
+{
+	struct vmm_kmem_cache *cache;
+
+	if (!name || !size || (VMM_PAGE_SIZE < size)) {
+		return NULL;
+	}
+
+	cache = heap_malloc(&normal_heap, sizeof(*cache));
+	if (cache) {
+		cache->obj_size = size;
+	}
+
+	return cache;
+}
+
+int vmm_kmem_cache_destroy(struct vmm_kmem_cache *cache)
+{
+	if (!cache) {
+		return VMM_EINVALID;
+	}
+
+	heap_free(&normal_heap, cache);
+
+	return VMM_OK;
+}
+
+void *vmm_kmem_cache_alloc(struct vmm_kmem_cache *cache)
+{
+	return (cache) ? heap_malloc(&normal_heap, cache->obj_size) : NULL;
+}
+
+void *vmm_kmem_cache_zalloc(struct vmm_kmem_cache *cache)
+{
+	void *ret = vmm_kmem_cache_alloc(cache);
+
+	if (ret) {
+		memset(ret, 0, cache->obj_size);
+	}
+
+	return ret;
+}
+
+void vmm_kmem_cache_free(struct vmm_kmem_cache *cache, void *obj)
+{
+	if (obj) {
+		heap_free(&normal_heap, obj);
+	}
+}
+
+const char *vmm_kmem_cache_name(struct vmm_kmem_cache *cache)
+{
+	return NULL;
+}
+
+int vmm_kmem_cache_stats(struct vmm_kmem_cache *cache,
+			 struct vmm_kmem_cache_stats *stats)
+{
+	return VMM_ENOTAVAIL;
+}
+
+struct vmm_kmem_cache *vmm_kmem_cache_get(int index)
+{
+	return NULL;
+}
+
+u32 vmm_kmem_cache_count(void)
+{
+	return 0;
+}
+
+#endif
+
 void *vmm_malloc(virtual_size_t size)
 {
+#ifdef CONFIG_HEAP_SLAB
+	void *ret;
+
+	if (slabctrl.ready && size && (size <= VMM_PAGE_SIZE)) {
+		ret = heap_slab_malloc(size);
+		if (ret) {
+			return ret;
+		}
+	}
+#endif
+
 	return heap_malloc(&normal_heap, size);
 }
 
@@ -237,11 +831,30 @@ void *vmm_zalloc(virtual_size_t size)
 
 virtual_size_t vmm_alloc_size(const void *ptr)
 {
+#ifdef CONFIG_HEAP_SLAB
+	struct heap_slab *slab = heap_slab_find(ptr);
+
+	if (slab) {
+		return slab->cache->obj_size -
+			(((unsigned long)(ptr - slab->base)) %
+						slab->cache->obj_size);
+	}
+#endif
+
 	return heap_alloc_size(&normal_heap, ptr);
 }
 
 void vmm_free(void *ptr)
 {
+#ifdef CONFIG_HEAP_SLAB
+	struct heap_slab *slab = heap_slab_find(ptr);
+
+	if (slab) {
+		heap_cache_free(slab->cache, ptr);
+		return;
+	}
+#endif
+
 	heap_free(&normal_heap, ptr);
 }
 
@@ -440,5 +1053,13 @@ int __init vmm_heap_init(void)
 		return rc;
 	}
 
+#ifdef CONFIG_HEAP_SLAB
+	/* Slab layer for small allocations from Normal heap */
+	rc = heap_slab_init();
+	if (rc) {
+		return rc;
+	}
+#endif
+
 	return VMM_OK;
 }
@@ -145,7 +145,10 @@ static int host_mhash_add(physical_addr_t pa,
 			} else if ((parent_e->pa + parent_e->sz) <= e->pa) {
 				new = &parent->rb_right;
 			} else {
-				vmm_panic("%s: can't add entry\n", __func__);
+				/* Overlaps partially with existing entry */
+				e->ref_count = 0;
+				rc = VMM_EEXIST;
+				goto done;
 			}
 		}
 
@@ -288,11 +291,13 @@ static int host_mhash_init(virtual_addr_t mhash_start,
 	return VMM_OK;
 }
 
-static virtual_addr_t host_memmap(physical_addr_t pa,
-				  virtual_size_t sz,
-				  u32 mem_flags)
+static int __host_memmap(physical_addr_t pa,
+			 virtual_size_t sz,
+			 u32 mem_flags,
+			 virtual_addr_t *out_va)
 {
 	int rc, ite;
+	bool alloced = FALSE;
 	virtual_addr_t va = 0;
 	virtual_addr_t tsz = 0;
 	physical_addr_t tpa = 0;
@@ -307,25 +312,25 @@ static virtual_addr_t host_memmap(physical_addr_t pa,
 			/* Trying to map same physical address with
 			 * different memory attributes.
 			 */
-			vmm_panic("%s: mem_flags mismatch\n", __func__);
+			return VMM_EINVALID;
 		}
 		if (tsz < sz) {
 			/* Trying to map same physical address with
 			 * greater size than already mapped.
 			 */
-			vmm_panic("%s: size mismatch\n", __func__);
+			return VMM_ERANGE;
 		}
 
 		va = va & ~VMM_PAGE_MASK;
 	} else if (rc != VMM_ENOTAVAIL) {
 		/* Something went wrong. */
-		vmm_panic("%s: unhandled error=%d\n", __func__, rc);
+		return rc;
 	} else {
 		if ((rc = vmm_host_vapool_alloc(&va, sz))) {
 			/* Don't have space */
-			vmm_panic("%s: vapool alloc failed error=%d\n",
-				  __func__, rc);
+			return rc;
 		}
+		alloced = TRUE;
 
 		for (ite = 0; ite < (sz >> VMM_PAGE_SHIFT); ite++) {
 			rc = arch_cpu_aspace_map(va + ite * VMM_PAGE_SIZE,
@@ -333,20 +338,45 @@ static virtual_addr_t host_memmap(physical_addr_t pa,
 						mem_flags);
 			if (rc) {
 				/* We were not able to map physical address */
-				vmm_panic("%s: failed to create VA->PA "
-					  "mapping error=%d\n",
-					  __func__, rc);
+				goto fail_unmap;
 			}
 		}
 	}
 
 	if ((rc = host_mhash_add(tpa, va, sz, mem_flags))) {
 		/* Failed to update MEMMAP HASH */
-		vmm_panic("%s: failed to add memmap hash entry error=%d\n",
-			  __func__, rc);
+		ite = sz >> VMM_PAGE_SHIFT;
+		goto fail_unmap;
+	}
+
+	*out_va = va + (pa & VMM_PAGE_MASK);
+
+	return VMM_OK;
+
+fail_unmap:
+	if (alloced) {
+		while (ite > 0) {
+			ite--;
+			arch_cpu_aspace_unmap(va + ite * VMM_PAGE_SIZE);
+		}
+		vmm_host_vapool_free(va, sz);
+	}
+	return rc;
+}
+
+static virtual_addr_t host_memmap(physical_addr_t pa,
+				  virtual_size_t sz,
+				  u32 mem_flags)
+{
+	int rc;
+	virtual_addr_t va = 0;
+
+	if ((rc = __host_memmap(pa, sz, mem_flags, &va))) {
+		vmm_panic("%s: failed to map pa=0x%"PRIPADDR" error=%d\n",
+			  __func__, pa, rc);
 	}
 
-	return va + (pa & VMM_PAGE_MASK);
+	return va;
 }
 
 static int host_memunmap(virtual_addr_t va, virtual_size_t sz)
@@ -390,6 +420,18 @@ virtual_addr_t vmm_host_memmap(physical_addr_t pa,
 	return host_memmap(pa, sz, mem_flags);
 }
 
+int vmm_host_memmap_try(physical_addr_t pa,
+			virtual_size_t sz,
+			u32 mem_flags,
+			virtual_addr_t *va)
+{
+	if (!va || !sz) {
+		return VMM_EINVALID;
+	}
+
+	return __host_memmap(pa, sz, mem_flags, va);
+}
+
 int vmm_host_memunmap(virtual_addr_t va)
 {
 	int rc;
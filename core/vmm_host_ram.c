@@ -23,24 +23,50 @@
 
 #include <vmm_error.h>
 #include <vmm_stdio.h>
+#include <vmm_heap.h>
 #include <vmm_spinlocks.h>
 #include <vmm_resource.h>
 #include <vmm_host_aspace.h>
 #include <vmm_host_ram.h>
+#include <vmm_devtree.h>
+#include <arch_atomic64.h>
 #include <arch_devtree.h>
 #include <libs/stringlib.h>
 #include <libs/mathlib.h>
 #include <libs/bitmap.h>
+#include <libs/bitops.h>
+#include <libs/log2.h>
+
+/*
+ * Each RAM bank has a bitmap of frames (bit set means frame in-use) and
+ * a free-extent tree on top of it. Leaves of the tree are bitmap words
+ * and every tree node holds (order + 1) of the largest naturally aligned
+ * free block of frames within its subtree (zero means no free frame).
+ * This allows finding an aligned free block in O(log n) without touching
+ * the bitmap. Requests which cannot be expressed as an aligned power-of-2
+ * block fall back to a word-at-a-time scan of the bitmap.
+ */
+
+#define HOST_RAM_WORD_ORDER		((BITS_PER_LONG == 64) ? 6 : 5)
+#define HOST_RAM_MAX_COLOR_HINTS	256
 
 struct vmm_host_ram_bank {
 	physical_addr_t start;
 	physical_size_t size;
 	u32 frame_count;
+	u32 start_order;
+	u32 node;
 
 	vmm_spinlock_t bmap_lock;
 	unsigned long *bmap;
 	u32 bmap_sz;
 	u32 bmap_free;
+	u32 bmap_words;
+
+	u8 *tree;
+	u32 tree_sz;
+	u32 tree_leaves;
+	u32 tree_full;
 
 	struct vmm_resource res;
 };
@@ -48,22 +74,298 @@ struct vmm_host_ram_bank {
 struct vmm_host_ram_ctrl {
 	struct vmm_host_ram_color_ops *ops;
 	void *ops_priv;
+	u32 *color_hint;
+	u32 color_hint_count;
 	u32 bank_count;
 	struct vmm_host_ram_bank banks[CONFIG_MAX_RAM_BANK_COUNT];
+	u32 node_count;
+	u32 cpu_node[CONFIG_CPU_COUNT];
+	atomic64_t node_local[VMM_HOST_RAM_MAX_NODES];
+	atomic64_t node_remote[VMM_HOST_RAM_MAX_NODES];
 };
 
 static struct vmm_host_ram_ctrl rctrl;
 
+/* Mask of bit positions which are multiple of 2^(index + 1) */
+static const unsigned long host_ram_chunk_mask[] = {
+	(unsigned long)0x5555555555555555ULL,
+	(unsigned long)0x1111111111111111ULL,
+	(unsigned long)0x0101010101010101ULL,
+	(unsigned long)0x0001000100010001ULL,
+	(unsigned long)0x0000000100000001ULL,
+	(unsigned long)0x0000000000000001ULL,
+};
+
+static inline unsigned long host_ram_word_used(struct vmm_host_ram_bank *bank,
+					       u32 w)
+{
+	unsigned long used = bank->bmap[w];
+
+	/* Frames beyond end of bank are never free */
+	if ((w == (bank->bmap_words - 1)) &&
+	    (bank->frame_count % BITS_PER_LONG)) {
+		used |= ~BITMAP_LAST_WORD_MASK(bank->frame_count);
+	}
+
+	return used;
+}
+
+/* Bit mask of free naturally aligned 2^order frame chunks in a word */
+static inline unsigned long host_ram_word_chunks(unsigned long used,
+						 u32 order)
+{
+	u32 k;
+	unsigned long f = ~used;
+
+	for (k = 0; f && (k < order); k++) {
+		f &= (f >> (1UL << k)) & host_ram_chunk_mask[k];
+	}
+
+	return f;
+}
+
+static u8 host_ram_leaf_value(struct vmm_host_ram_bank *bank, u32 w)
+{
+	u32 k;
+	unsigned long f, f1;
+
+	if (bank->bmap_words <= w) {
+		return 0;
+	}
+
+	f = ~host_ram_word_used(bank, w);
+	if (!f) {
+		return 0;
+	}
+
+	for (k = 0; k < HOST_RAM_WORD_ORDER; k++) {
+		f1 = f & (f >> (1UL << k)) & host_ram_chunk_mask[k];
+		if (!f1) {
+			break;
+		}
+		f = f1;
+	}
+
+	return k + 1;
+}
+
+/* Note: must be called with bmap_lock held */
+static void host_ram_tree_update(struct vmm_host_ram_bank *bank,
+				 u32 first_word, u32 last_word)
+{
+	u8 l, r, full = HOST_RAM_WORD_ORDER + 1;
+	u32 i, lo = bank->tree_leaves + first_word;
+	u32 hi = bank->tree_leaves + last_word;
+
+	for (i = lo; i <= hi; i++) {
+		bank->tree[i] = host_ram_leaf_value(bank,
+						    i - bank->tree_leaves);
+	}
+
+	while (lo > 1) {
+		lo >>= 1;
+		hi >>= 1;
+		for (i = lo; i <= hi; i++) {
+			l = bank->tree[2 * i];
+			r = bank->tree[2 * i + 1];
+			bank->tree[i] = ((l == full) && (r == full)) ?
+					(full + 1) : ((l < r) ? r : l);
+		}
+		full++;
+	}
+}
+
+/*
+ * Find first free naturally aligned block of 2^order frames at or
+ * after frame position "from" within subtree of node "i"
+ */
+static bool host_ram_tree_find(struct vmm_host_ram_bank *bank,
+			       u32 i, u32 full, u64 node_start,
+			       u32 order, u32 from, u32 *pos)
+{
+	u32 bit;
+	unsigned long f;
+	u64 node_frames = (u64)1 << (full - 1);
+
+	if ((bank->tree[i] < (order + 1)) ||
+	    ((node_start + node_frames) <= from)) {
+		return FALSE;
+	}
+
+	if ((full - 1) == order) {
+		/* Node itself is the free block */
+		if (node_start < from) {
+			return FALSE;
+		}
+		*pos = node_start;
+		return TRUE;
+	}
+
+	if ((full - 1) == HOST_RAM_WORD_ORDER) {
+		/* Leaf node so look inside bitmap word */
+		f = host_ram_word_chunks(host_ram_word_used(bank,
+					 i - bank->tree_leaves), order);
+		if (node_start < from) {
+			f &= BITMAP_FIRST_WORD_MASK(from - node_start);
+		}
+		if (!f) {
+			return FALSE;
+		}
+		bit = __ffs(f);
+		*pos = node_start + bit;
+		return TRUE;
+	}
+
+	node_frames >>= 1;
+	if (host_ram_tree_find(bank, 2 * i, full - 1,
+			       node_start, order, from, pos)) {
+		return TRUE;
+	}
+
+	return host_ram_tree_find(bank, 2 * i + 1, full - 1,
+				  node_start + node_frames, order, from, pos);
+}
+
+/* Find last in-use frame in given range using word-at-a-time scan */
+static bool host_ram_last_used(struct vmm_host_ram_bank *bank,
+			       u32 bpos, u32 bcnt, u32 *last)
+{
+	unsigned long m;
+	u32 w, first_w = bpos / BITS_PER_LONG;
+	u32 last_w = (bpos + bcnt - 1) / BITS_PER_LONG;
+
+	for (w = last_w + 1; w-- > first_w; ) {
+		m = bank->bmap[w];
+		if (w == last_w) {
+			m &= BITMAP_LAST_WORD_MASK(bpos + bcnt);
+		}
+		if (w == first_w) {
+			m &= BITMAP_FIRST_WORD_MASK(bpos);
+		}
+		if (m) {
+			*last = w * BITS_PER_LONG + __fls(m);
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+/* Note: must be called with bmap_lock held */
+static void host_ram_bmap_update(struct vmm_host_ram_bank *bank,
+				 u32 bpos, u32 bcnt, bool set)
+{
+	unsigned long m;
+	u32 w, first_w = bpos / BITS_PER_LONG;
+	u32 last_w = (bpos + bcnt - 1) / BITS_PER_LONG;
+
+	for (w = first_w; w <= last_w; w++) {
+		m = ~0UL;
+		if (w == first_w) {
+			m &= BITMAP_FIRST_WORD_MASK(bpos);
+		}
+		if (w == last_w) {
+			m &= BITMAP_LAST_WORD_MASK(bpos + bcnt);
+		}
+		if (set) {
+			bank->bmap[w] |= m;
+		} else {
+			bank->bmap[w] &= ~m;
+		}
+	}
+
+	host_ram_tree_update(bank, first_w, last_w);
+}
+
+/* Note: must be called with bmap_lock held */
+static bool host_ram_bank_find(struct vmm_host_ram_bank *bank,
+			       u32 bcnt, u32 align_order,
+			       u32 color, u32 *hint,
+			       struct vmm_host_ram_color_ops *ops,
+			       void *ops_priv, u32 *pos)
+{
+	physical_addr_t p;
+	u32 pass, from, last, order, bpos, binc;
+
+	binc = order_size(align_order) >> VMM_PAGE_SHIFT;
+	order = align_order - VMM_PAGE_SHIFT;
+	while (order_size(order) < bcnt) {
+		order++;
+	}
+
+	/* Fast path using free-extent tree */
+	if (((align_order - VMM_PAGE_SHIFT) <= bank->start_order) &&
+	    (order < bank->tree_full)) {
+		for (pass = 0; pass < 2; pass++) {
+			from = (pass || !hint) ? 0 : *hint;
+			while (host_ram_tree_find(bank, 1, bank->tree_full, 0,
+						  order, from, &bpos)) {
+				if (pass && hint && (*hint <= bpos)) {
+					break;
+				}
+				p = bank->start + ((physical_addr_t)bpos <<
+							VMM_PAGE_SHIFT);
+				if (!ops || ops->color_match(p,
+					(physical_size_t)bcnt << VMM_PAGE_SHIFT,
+					color, ops_priv)) {
+					*pos = bpos;
+					return TRUE;
+				}
+				from = bpos + order_size(order);
+			}
+			if (!hint) {
+				break;
+			}
+		}
+
+		/* Aligned power-of-2 requests are fully served by tree */
+		if (order_size(order) == bcnt) {
+			return FALSE;
+		}
+	}
+
+	/* Slow path using word-at-a-time bitmap scan */
+	bpos = bank->start & order_mask(align_order);
+	if (bpos) {
+		bpos = VMM_SIZE_TO_PAGE(order_size(align_order) - bpos);
+	}
+	from = bpos;
+	while ((bpos < bank->frame_count) &&
+	       (bcnt <= (bank->frame_count - bpos))) {
+		if (host_ram_last_used(bank, bpos, bcnt, &last)) {
+			/* Skip to first aligned position after in-use frame */
+			bpos = last + 1;
+			if ((bpos - from) & (binc - 1)) {
+				bpos += binc - ((bpos - from) & (binc - 1));
+			}
+			continue;
+		}
+
+		p = bank->start + ((physical_addr_t)bpos << VMM_PAGE_SHIFT);
+		if (ops && !ops->color_match(p,
+				(physical_size_t)bcnt << VMM_PAGE_SHIFT,
+				color, ops_priv)) {
+			bpos += binc;
+			continue;
+		}
+
+		*pos = bpos;
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
 static physical_size_t __host_ram_alloc(physical_addr_t *pa,
 					physical_size_t sz,
 					u32 align_order,
 					u32 color,
 					struct vmm_host_ram_color_ops *ops,
-					void *ops_priv)
+					void *ops_priv,
+					u32 node, bool strict)
 {
 	irq_flags_t f;
-	physical_addr_t p;
-	u32 i, bn, binc, bcnt, bpos, bfree;
+	u32 pass, bn, bcnt, bpos, *hint;
 	struct vmm_host_ram_bank *bank;
 
 	if ((sz == 0) ||
@@ -75,47 +377,56 @@ static physical_size_t __host_ram_alloc(physical_addr_t *pa,
 	sz = roundup2_order_size(sz, align_order);
 	bcnt = VMM_SIZE_TO_PAGE(sz);
 
-	for (bn = 0; bn < rctrl.bank_count; bn++) {
-		bank = &rctrl.banks[bn];
-
-		vmm_spin_lock_irqsave_lite(&bank->bmap_lock, f);
+	/* First pass over banks of given node and second pass over rest */
+	for (pass = 0; pass < 2; pass++) {
+		for (bn = 0; bn < rctrl.bank_count; bn++) {
+			bank = &rctrl.banks[bn];
 
-		if (bank->bmap_free < bcnt) {
-			vmm_spin_unlock_irqrestore_lite(&bank->bmap_lock, f);
-			continue;
-		}
+			if ((node != VMM_HOST_RAM_NODE_ANY) &&
+			    ((bank->node == node) ? pass : !pass)) {
+				continue;
+			}
 
-		binc = order_size(align_order) >> VMM_PAGE_SHIFT;
-		bpos = bank->start & order_mask(align_order);
-		if (bpos) {
-			bpos = VMM_SIZE_TO_PAGE(order_size(align_order) - bpos);
-		}
-		for (; bpos < (bank->size >> VMM_PAGE_SHIFT); bpos += binc) {
-			bfree = 0;
-			for (i = bpos; i < (bpos + bcnt); i++) {
-				if (bitmap_isset(bank->bmap, i)) {
-					break;
-				}
-				bfree++;
+			hint = NULL;
+			if (ops && rctrl.color_hint &&
+			    (color < rctrl.color_hint_count)) {
+				hint = &rctrl.color_hint[color *
+							rctrl.bank_count + bn];
 			}
-			if (bfree != bcnt)
-				continue;
 
-			p = bank->start + bpos * VMM_PAGE_SIZE;
+			vmm_spin_lock_irqsave_lite(&bank->bmap_lock, f);
 
-			if (ops && !ops->color_match(p, sz, color, ops_priv))
+			if ((bank->bmap_free < bcnt) ||
+			    !host_ram_bank_find(bank, bcnt, align_order,
+						color, hint, ops, ops_priv,
+						&bpos)) {
+				vmm_spin_unlock_irqrestore_lite(
+							&bank->bmap_lock, f);
 				continue;
+			}
 
-			*pa = p;
-			bitmap_set(bank->bmap, bpos, bcnt);
+			*pa = bank->start +
+				((physical_addr_t)bpos << VMM_PAGE_SHIFT);
+			host_ram_bmap_update(bank, bpos, bcnt, TRUE);
 			bank->bmap_free -= bcnt;
+			if (hint) {
+				*hint = bpos + bcnt;
+			}
 
 			vmm_spin_unlock_irqrestore_lite(&bank->bmap_lock, f);
 
+			if (node < VMM_HOST_RAM_MAX_NODES) {
+				arch_atomic64_inc((pass) ?
+						  &rctrl.node_remote[node] :
+						  &rctrl.node_local[node]);
+			}
+
 			return sz;
 		}
 
-		vmm_spin_unlock_irqrestore_lite(&bank->bmap_lock, f);
+		if ((node == VMM_HOST_RAM_NODE_ANY) || strict) {
+			break;
+		}
 	}
 
 	return 0;
@@ -144,6 +455,29 @@ static struct vmm_host_ram_color_ops default_ops = {
 	.color_match = default_color_match,
 };
 
+static void host_ram_color_hint_setup(void)
+{
+	u32 count = rctrl.ops->num_colors(rctrl.ops_priv);
+
+	if (rctrl.color_hint) {
+		vmm_free(rctrl.color_hint);
+		rctrl.color_hint = NULL;
+		rctrl.color_hint_count = 0;
+	}
+
+	/* Per-color search hints are only useful for real color ops */
+	if ((rctrl.ops == &default_ops) ||
+	    (HOST_RAM_MAX_COLOR_HINTS < count)) {
+		return;
+	}
+
+	rctrl.color_hint = vmm_zalloc(count * rctrl.bank_count *
+				      sizeof(*rctrl.color_hint));
+	if (rctrl.color_hint) {
+		rctrl.color_hint_count = count;
+	}
+}
+
 void vmm_host_ram_set_color_ops(struct vmm_host_ram_color_ops *ops,
 				void *priv)
 {
@@ -164,6 +498,8 @@ void vmm_host_ram_set_color_ops(struct vmm_host_ram_color_ops *ops,
 		rctrl.ops = &default_ops;
 		rctrl.ops_priv = NULL;
 	}
+
+	host_ram_color_hint_setup();
 }
 
 const char *vmm_host_ram_color_ops_name(void)
@@ -189,20 +525,46 @@ physical_size_t vmm_host_ram_color_alloc(physical_addr_t *pa, u32 color)
 		return 0;
 
 	return __host_ram_alloc(pa, (physical_size_t)1 << order, order,
-				color, rctrl.ops, rctrl.ops_priv);
+				color, rctrl.ops, rctrl.ops_priv,
+				VMM_HOST_RAM_NODE_ANY, FALSE);
 }
 
 physical_size_t vmm_host_ram_alloc(physical_addr_t *pa,
 				   physical_size_t sz,
 				   u32 align_order)
 {
-	return __host_ram_alloc(pa, sz, align_order, 0, NULL, NULL);
+	return __host_ram_alloc(pa, sz, align_order, 0, NULL, NULL,
+				VMM_HOST_RAM_NODE_ANY, FALSE);
+}
+
+physical_size_t vmm_host_ram_node_alloc(physical_addr_t *pa,
+					physical_size_t sz,
+					u32 align_order, u32 node)
+{
+	if ((node != VMM_HOST_RAM_NODE_ANY) && (rctrl.node_count <= node)) {
+		node = VMM_HOST_RAM_NODE_ANY;
+	}
+
+	return __host_ram_alloc(pa, sz, align_order, 0, NULL, NULL,
+				node, FALSE);
+}
+
+physical_size_t vmm_host_ram_node_alloc_strict(physical_addr_t *pa,
+					       physical_size_t sz,
+					       u32 align_order, u32 node)
+{
+	if ((node == VMM_HOST_RAM_NODE_ANY) || (rctrl.node_count <= node)) {
+		return 0;
+	}
+
+	return __host_ram_alloc(pa, sz, align_order, 0, NULL, NULL,
+				node, TRUE);
 }
 
 int vmm_host_ram_reserve(physical_addr_t pa, physical_size_t sz)
 {
 	int rc = VMM_EINVALID;
-	u32 i, bn, bcnt, bpos, bfree;
+	u32 bn, bcnt, bpos, last;
 	irq_flags_t flags;
 	struct vmm_host_ram_bank *bank;
 
@@ -225,21 +587,13 @@ int vmm_host_ram_reserve(physical_addr_t pa, physical_size_t sz)
 			break;
 		}
 
-		bfree = 0;
-		for (i = bpos; i < (bpos + bcnt); i++) {
-			if (bitmap_isset(bank->bmap, i)) {
-				break;
-			}
-			bfree++;
-		}
-
-		if (bfree != bcnt) {
+		if (host_ram_last_used(bank, bpos, bcnt, &last)) {
 			vmm_spin_unlock_irqrestore_lite(&bank->bmap_lock, flags);
 			rc = VMM_ENOSPC;
 			break;
 		}
 
-		bitmap_set(bank->bmap, bpos, bcnt);
+		host_ram_bmap_update(bank, bpos, bcnt, TRUE);
 		bank->bmap_free -= bcnt;
 
 		vmm_spin_unlock_irqrestore_lite(&bank->bmap_lock, flags);
@@ -271,7 +625,7 @@ int vmm_host_ram_free(physical_addr_t pa, physical_size_t sz)
 
 		vmm_spin_lock_irqsave_lite(&bank->bmap_lock, flags);
 
-		bitmap_clear(bank->bmap, bpos, bcnt);
+		host_ram_bmap_update(bank, bpos, bcnt, FALSE);
 		bank->bmap_free += bcnt;
 
 		vmm_spin_unlock_irqrestore_lite(&bank->bmap_lock, flags);
@@ -393,6 +747,119 @@ u32 vmm_host_ram_bank_free_frames(u32 bank)
 	return ret;
 }
 
+u32 vmm_host_ram_bank_node(u32 bank)
+{
+	return (bank < rctrl.bank_count) ? rctrl.banks[bank].node : 0;
+}
+
+u32 vmm_host_ram_node_count(void)
+{
+	return rctrl.node_count;
+}
+
+void vmm_host_ram_set_cpu_node(u32 cpu, u32 node)
+{
+	if ((cpu < CONFIG_CPU_COUNT) && (node < VMM_HOST_RAM_MAX_NODES)) {
+		rctrl.cpu_node[cpu] = node;
+	}
+}
+
+u32 vmm_host_ram_cpu_node(u32 cpu)
+{
+	return (cpu < CONFIG_CPU_COUNT) ? rctrl.cpu_node[cpu] : 0;
+}
+
+void vmm_host_ram_node_stats(u32 node, u64 *local_allocs,
+			     u64 *remote_allocs)
+{
+	if (node >= VMM_HOST_RAM_MAX_NODES) {
+		node = 0;
+	}
+
+	if (local_allocs) {
+		*local_allocs = arch_atomic64_read(&rctrl.node_local[node]);
+	}
+	if (remote_allocs) {
+		*remote_allocs = arch_atomic64_read(&rctrl.node_remote[node]);
+	}
+}
+
+static void host_ram_numa_node_setup(struct vmm_devtree_node *node)
+{
+	int i;
+	u32 bn, nid;
+	physical_addr_t addr;
+	physical_size_t size;
+	struct vmm_host_ram_bank *bank;
+
+	if (vmm_devtree_read_u32(node,
+			VMM_DEVTREE_NUMA_NODE_ID_ATTR_NAME, &nid)) {
+		return;
+	}
+	if (nid >= VMM_HOST_RAM_MAX_NODES) {
+		vmm_printf("%s: %s: numa node %d not supported\n",
+			   __func__, node->name, nid);
+		return;
+	}
+
+	/* Banks starting within any reg range belong to the node */
+	for (i = 0; !vmm_devtree_regaddr(node, &addr, i); i++) {
+		if (vmm_devtree_regsize(node, &size, i)) {
+			break;
+		}
+		for (bn = 0; bn < rctrl.bank_count; bn++) {
+			bank = &rctrl.banks[bn];
+			if ((addr <= bank->start) &&
+			    (bank->start < (addr + size))) {
+				bank->node = nid;
+				if (rctrl.node_count <= nid) {
+					rctrl.node_count = nid + 1;
+				}
+			}
+		}
+	}
+}
+
+int __init vmm_host_ram_numa_init(void)
+{
+	struct vmm_devtree_node *root, *child;
+
+	root = vmm_devtree_getnode(VMM_DEVTREE_PATH_SEPARATOR_STRING);
+	if (!root) {
+		return VMM_ENODEV;
+	}
+
+	vmm_devtree_for_each_child(child, root) {
+		if (strncmp(child->name, VMM_DEVTREE_MEMORY_NODE_NAME,
+			    strlen(VMM_DEVTREE_MEMORY_NODE_NAME))) {
+			continue;
+		}
+		host_ram_numa_node_setup(child);
+	}
+
+	vmm_devtree_dref_node(root);
+
+	return VMM_OK;
+}
+
+static u32 host_ram_tree_leaves(u32 frame_count)
+{
+	u32 leaves = 1;
+
+	while ((leaves * BITS_PER_LONG) < frame_count) {
+		leaves <<= 1;
+	}
+
+	return leaves;
+}
+
+static u32 host_ram_tree_estimate_size(u32 frame_count)
+{
+	u32 sz = 2 * host_ram_tree_leaves(frame_count);
+
+	return roundup2_order_size(sz, ilog2(sizeof(unsigned long)));
+}
+
 virtual_size_t vmm_host_ram_estimate_hksize(void)
 {
 	int rc;
@@ -414,6 +881,7 @@ virtual_size_t vmm_host_ram_estimate_hksize(void)
 		}
 
 		ret += bitmap_estimate_size(size >> VMM_PAGE_SHIFT);
+		ret += host_ram_tree_estimate_size(size >> VMM_PAGE_SHIFT);
 	}
 
 	return ret;
@@ -429,6 +897,7 @@ int __init vmm_host_ram_init(virtual_addr_t hkbase)
 
 	rctrl.ops = &default_ops;
 	rctrl.ops_priv = NULL;
+	rctrl.node_count = 1;
 
 	if ((rc = arch_devtree_ram_bank_count(&rctrl.bank_count))) {
 		return rc;
@@ -460,12 +929,25 @@ int __init vmm_host_ram_init(virtual_addr_t hkbase)
 
 		INIT_SPIN_LOCK(&bank->bmap_lock);
 
+		bank->start_order = (bank->start >> VMM_PAGE_SHIFT) ?
+				__ffs(bank->start >> VMM_PAGE_SHIFT) :
+				(BITS_PER_LONG - 1);
+
 		bank->bmap = (unsigned long *)hkbase;
 		bank->bmap_sz = bitmap_estimate_size(bank->frame_count);
 		bank->bmap_free = bank->frame_count;
+		bank->bmap_words = BITS_TO_LONGS(bank->frame_count);
 
 		bitmap_zero(bank->bmap, bank->frame_count);
 
+		bank->tree = (u8 *)(hkbase + bank->bmap_sz);
+		bank->tree_sz = host_ram_tree_estimate_size(bank->frame_count);
+		bank->tree_leaves = host_ram_tree_leaves(bank->frame_count);
+		bank->tree_full = HOST_RAM_WORD_ORDER + 1 +
+				  ilog2(bank->tree_leaves);
+
+		host_ram_tree_update(bank, 0, bank->tree_leaves - 1);
+
 		bank->res.start = bank->start;
 		bank->res.end = bank->start + bank->size - 1;
 		bank->res.name = "System RAM";
@@ -475,7 +957,7 @@ int __init vmm_host_ram_init(virtual_addr_t hkbase)
 			return rc;
 		}
 
-		hkbase += bank->bmap_sz;
+		hkbase += bank->bmap_sz + bank->tree_sz;
 	}
 
 	return VMM_OK;
@@ -28,6 +28,7 @@
 #include <vmm_version.h>
 #include <vmm_initfn.h>
 #include <vmm_host_aspace.h>
+#include <vmm_host_ram.h>
 #include <vmm_host_irq.h>
 #include <vmm_smp.h>
 #include <vmm_percpu.h>
@@ -39,6 +40,7 @@
 #include <vmm_manager.h>
 #include <vmm_scheduler.h>
 #include <vmm_loadbal.h>
+#include <vmm_guest_dedup.h>
 #include <vmm_threads.h>
 #include <vmm_profiler.h>
 #include <vmm_devdrv.h>
@@ -206,6 +208,15 @@ static void system_init_work(struct vmm_work *work)
 #endif
 #endif
 
+#ifdef CONFIG_GUEST_DEDUP
+	/* Initialize guest page deduplication */
+	vmm_printf("init: guest page deduplication\n");
+	ret = vmm_guest_dedup_init();
+	if (ret) {
+		goto fail;
+	}
+#endif
+
 	/* Initialize command manager */
 	vmm_printf("init: command manager\n");
 	ret = vmm_cmdmgr_init();
@@ -353,6 +364,13 @@ static void __init init_bootcpu(void)
 		goto init_bootcpu_fail;
 	}
 
+	/* Initialize host RAM NUMA nodes */
+	vmm_printf("init: host RAM NUMA nodes\n");
+	ret = vmm_host_ram_numa_init();
+	if (ret) {
+		goto init_bootcpu_fail;
+	}
+
 #if defined(CONFIG_SMP)
 	/* Initialize secondary CPUs */
 	vmm_printf("init: discover secondary CPUs\n");
@@ -491,6 +509,15 @@ static void __init init_bootcpu(void)
 	}
 #endif
 
+#ifdef CONFIG_PROFILE_SAMPLE
+	/* Initialize hypervisor sampling profiler */
+	vmm_printf("init: hypervisor sampling profiler\n");
+	ret = vmm_profiler_sample_init();
+	if (ret) {
+		goto init_bootcpu_fail;
+	}
+#endif
+
 #if defined(CONFIG_SMP)
 	/* Initialize inter-processor interrupts */
 	vmm_printf("init: inter-processor interrupts\n");
@@ -27,6 +27,7 @@
 #include <vmm_stdio.h>
 #include <vmm_heap.h>
 #include <vmm_timer.h>
+#include <vmm_delay.h>
 #include <vmm_guest_aspace.h>
 #include <vmm_vcpu_irq.h>
 #include <vmm_scheduler.h>
@@ -74,6 +75,34 @@ void vmm_manager_unlock(void)
 	vmm_mutex_unlock(&mngr.lock);
 }
 
+u32 __weak arch_vcpu_state_size(struct vmm_vcpu *vcpu)
+{
+	return sizeof(arch_regs_t);
+}
+
+int __weak arch_vcpu_state_save(struct vmm_vcpu *vcpu, void *buf, u32 size)
+{
+	if (size != sizeof(arch_regs_t)) {
+		return VMM_EINVALID;
+	}
+
+	memcpy(buf, &vcpu->regs, sizeof(arch_regs_t));
+
+	return VMM_OK;
+}
+
+int __weak arch_vcpu_state_restore(struct vmm_vcpu *vcpu,
+				   const void *buf, u32 size)
+{
+	if (size != sizeof(arch_regs_t)) {
+		return VMM_EINVALID;
+	}
+
+	memcpy(&vcpu->regs, buf, sizeof(arch_regs_t));
+
+	return VMM_OK;
+}
+
 u32 vmm_manager_max_vcpu_count(void)
 {
 	return CONFIG_MAX_VCPU_COUNT;
@@ -1042,7 +1071,8 @@ static void manager_enqueue_req(struct vmm_guest *guest,
 	list_add_tail(&req->head, &guest->req_list);
 	vmm_spin_unlock_irqrestore_lite(&guest->req_lock, flags);
 
-	vmm_workqueue_schedule_work(NULL, &mngr.guest_work_array[guest->id]);
+	vmm_workqueue_schedule_work(vmm_workqueue_system_percpu(),
+				    &mngr.guest_work_array[guest->id]);
 }
 
 static struct vmm_guest_request *manager_dequeue_req(struct vmm_guest *guest)
@@ -1102,7 +1132,8 @@ static void manager_req_work(struct vmm_work *work)
 
 		/* Reschedule work if we more request */
 		if (manager_have_req(guest)) {
-			vmm_workqueue_schedule_work(NULL,
+			vmm_workqueue_schedule_work(
+					vmm_workqueue_system_percpu(),
 					&mngr.guest_work_array[guest->id]);
 		}
 	}
@@ -1257,6 +1288,8 @@ struct vmm_guest *vmm_manager_guest_create(struct vmm_devtree_node *gnode)
 #endif
 	guest->reset_count = 0;
 	guest->reset_tstamp = vmm_timer_timestamp();
+	guest->ref_count = 0;
+	guest->destroying = FALSE;
 	INIT_SPIN_LOCK(&guest->req_lock);
 	INIT_LIST_HEAD(&guest->req_list);
 	INIT_RW_LOCK(&guest->vcpu_lock);
@@ -1605,6 +1638,16 @@ int vmm_manager_guest_destroy(struct vmm_guest *guest)
 		return VMM_EFAIL;
 	}
 
+	/* Refuse new references and wait for existing ones */
+	vmm_manager_lock();
+	guest->destroying = TRUE;
+	while (guest->ref_count) {
+		vmm_manager_unlock();
+		vmm_msleep(1);
+		vmm_manager_lock();
+	}
+	vmm_manager_unlock();
+
 	/* For sanity reset guest (ignore reture value) */
 	vmm_manager_guest_reset(guest);
 
@@ -1711,6 +1754,37 @@ int vmm_manager_guest_destroy(struct vmm_guest *guest)
 	return VMM_OK;
 }
 
+int vmm_manager_guest_ref(struct vmm_guest *guest)
+{
+	int rc = VMM_OK;
+
+	if (!guest) {
+		return VMM_EFAIL;
+	}
+
+	vmm_manager_lock();
+	if (guest->destroying) {
+		rc = VMM_ENOTAVAIL;
+	} else {
+		guest->ref_count++;
+	}
+	vmm_manager_unlock();
+
+	return rc;
+}
+
+void vmm_manager_guest_dref(struct vmm_guest *guest)
+{
+	if (!guest) {
+		return;
+	}
+
+	vmm_manager_lock();
+	BUG_ON(!guest->ref_count);
+	guest->ref_count--;
+	vmm_manager_unlock();
+}
+
 int __init vmm_manager_init(void)
 {
 	u32 vnum, gnum;
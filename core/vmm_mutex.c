@@ -23,9 +23,11 @@
 
 #include <vmm_error.h>
 #include <vmm_stdio.h>
+#include <vmm_timer.h>
 #include <vmm_scheduler.h>
 #include <vmm_mutex.h>
 #include <arch_cpu_irq.h>
+#include <arch_barrier.h>
 
 void __vmm_mutex_cleanup(struct vmm_vcpu *vcpu,
 			 struct vmm_vcpu_resource *vcpu_res)
@@ -80,6 +82,7 @@ int vmm_mutex_unlock(struct vmm_mutex *mut)
 {
 	int rc = VMM_EINVALID;
 	irq_flags_t flags;
+	struct vmm_vcpu *next;
 	struct vmm_vcpu *current_vcpu = vmm_scheduler_current_vcpu();
 
 	BUG_ON(!mut);
@@ -93,10 +96,24 @@ int vmm_mutex_unlock(struct vmm_mutex *mut)
 			mut->owner = NULL;
 			vmm_manager_vcpu_resource_remove(current_vcpu,
 							 &mut->res);
-			rc = __vmm_waitqueue_wakeall(&mut->wq);
-			if (rc == VMM_ENOENT) {
+			if (mut->handoff && mut->wq.vcpu_count) {
+				/* Pass ownership to first waiter so that
+				 * spinners cannot starve it any further.
+				 */
+				next = list_first_entry(&mut->wq.vcpu_list,
+						struct vmm_vcpu, wq_head);
+				mut->lock = 1;
+				mut->owner = next;
+				vmm_manager_vcpu_resource_add(next, &mut->res);
+				__vmm_waitqueue_wakefirst(&mut->wq);
 				rc = VMM_OK;
+			} else {
+				rc = __vmm_waitqueue_wakeall(&mut->wq);
+				if (rc == VMM_ENOENT) {
+					rc = VMM_OK;
+				}
 			}
+			mut->handoff = FALSE;
 		} else {
 			rc = VMM_OK;
 		}
@@ -136,9 +153,41 @@ int vmm_mutex_trylock(struct vmm_mutex *mut)
 	return ret;
 }
 
+/* Spin while mutex owner is running on other host CPU
+ * Note: This function must be called with mutex waitqueue lock held
+ * which is released while spinning.
+ * Note: Returns TRUE if owner changed so caller should retry.
+ */
+static bool mutex_optimistic_spin(struct vmm_mutex *mut,
+				  irq_flags_t *flags)
+{
+	u64 tstamp;
+	struct vmm_vcpu *owner = mut->owner;
+
+	/* Don't spin if a waiter is already starving */
+	if (!owner || mut->handoff ||
+	    (vmm_manager_vcpu_get_state(owner) != VMM_VCPU_STATE_RUNNING)) {
+		return FALSE;
+	}
+
+	vmm_spin_unlock_irqrestore(&mut->wq.lock, *flags);
+
+	tstamp = vmm_timer_timestamp();
+	while ((mut->owner == owner) &&
+	       (vmm_manager_vcpu_get_state(owner) == VMM_VCPU_STATE_RUNNING) &&
+	       ((vmm_timer_timestamp() - tstamp) < VMM_MUTEX_SPIN_NSECS)) {
+		arch_smp_rmb();
+	}
+
+	vmm_spin_lock_irqsave(&mut->wq.lock, *flags);
+
+	return (mut->owner != owner) ? TRUE : FALSE;
+}
+
 static int mutex_lock_common(struct vmm_mutex *mut, u64 *timeout)
 {
 	int rc = VMM_OK;
+	bool woken = FALSE;
 	irq_flags_t flags;
 	struct vmm_vcpu *current_vcpu = vmm_scheduler_current_vcpu();
 
@@ -147,31 +196,45 @@ static int mutex_lock_common(struct vmm_mutex *mut, u64 *timeout)
 
 	vmm_spin_lock_irqsave(&mut->wq.lock, flags);
 
+	/*
+	 * If VCPU owning the lock try to acquire it again then let
+	 * it acquire lock multiple times (as-per POSIX standard).
+	 */
+	if (mut->lock && (mut->owner == current_vcpu)) {
+		mut->lock++;
+		goto done;
+	}
+
 	while (mut->lock) {
-		/*
-		 * If VCPU owning the lock try to acquire it again then let
-		 * it acquire lock multiple times (as-per POSIX standard).
-		 */
+		/* Ownership handed over by previous owner */
 		if (mut->owner == current_vcpu) {
-			break;
+			goto done;
+		}
+		/* Woken up but somebody else got the lock */
+		if (woken) {
+			mut->handoff = TRUE;
+		}
+		if (mutex_optimistic_spin(mut, &flags)) {
+			continue;
 		}
 		rc = __vmm_waitqueue_sleep(&mut->wq, timeout);
 		if (rc) {
-			/* Timeout or some other failure */
-			break;
-		}
-	}
-	if (rc == VMM_OK) {
-		if (!mut->lock) {
-			mut->lock = 1;
-			vmm_manager_vcpu_resource_add(current_vcpu,
-						      &mut->res);
-			mut->owner = current_vcpu;
-		} else {
-			mut->lock++;
+			/* Timeout or some other failure but we might
+			 * have been handed ownership in the meantime.
+			 */
+			if (mut->owner == current_vcpu) {
+				rc = VMM_OK;
+			}
+			goto done;
 		}
+		woken = TRUE;
 	}
 
+	mut->lock = 1;
+	vmm_manager_vcpu_resource_add(current_vcpu, &mut->res);
+	mut->owner = current_vcpu;
+
+done:
 	vmm_spin_unlock_irqrestore(&mut->wq.lock, flags);
 
 	return rc;
@@ -0,0 +1,252 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file vmm_profiler_sample.c
+ * @author agent (agent@local)
+ * @brief source file of hypervisor sampling profiler.
+ *
+ * Each host CPU runs a periodic timer event which records the program
+ * counter (and optionally a short stack trace) of the context it has
+ * interrupted into a per-CPU sample buffer. Nothing is symbolized or
+ * aggregated here, that is left to the consumer (usually cmd_profile)
+ * after sampling is stopped.
+ */
+
+#include <vmm_error.h>
+#include <vmm_heap.h>
+#include <vmm_smp.h>
+#include <vmm_percpu.h>
+#include <vmm_cpumask.h>
+#include <vmm_timer.h>
+#include <vmm_scheduler.h>
+#include <vmm_profiler.h>
+#include <arch_profiler.h>
+#include <libs/stacktrace.h>
+
+struct vmm_profiler_sample_cpu {
+	struct vmm_timer_event ev;
+	struct vmm_profiler_sample *samples;
+	u32 count;
+	u64 dropped;
+};
+
+struct vmm_profiler_sample_ctrl {
+	bool is_active;
+	u64 period_ns;
+	u32 depth;
+};
+
+static struct vmm_profiler_sample_ctrl sctrl;
+static DEFINE_PER_CPU(struct vmm_profiler_sample_cpu, sprof);
+
+unsigned long __weak arch_profiler_regs_pc(arch_regs_t *regs,
+					   bool *guest_mode)
+{
+	if (guest_mode) {
+		*guest_mode = FALSE;
+	}
+
+	return 0;
+}
+
+static void profiler_sample_event(struct vmm_timer_event *ev)
+{
+	bool guest_mode = FALSE;
+	struct stack_trace trace;
+	struct vmm_vcpu *vcpu;
+	struct vmm_profiler_sample *s;
+	struct vmm_profiler_sample_cpu *scp = ev->priv;
+	arch_regs_t *regs = vmm_scheduler_irq_regs();
+
+	if (!sctrl.is_active) {
+		return;
+	}
+
+	if (!regs) {
+		goto done;
+	}
+
+	if (scp->count >= VMM_PROFILE_SAMPLE_COUNT) {
+		scp->dropped++;
+		goto done;
+	}
+
+	s = &scp->samples[scp->count];
+	s->pc = arch_profiler_regs_pc(regs, &guest_mode);
+	s->nr_frames = 0;
+
+	vcpu = vmm_scheduler_current_vcpu();
+	if (guest_mode) {
+		s->context = VMM_PROFILE_SAMPLE_GUEST;
+	} else if (vcpu == vmm_scheduler_idle_vcpu(vmm_smp_processor_id())) {
+		s->context = VMM_PROFILE_SAMPLE_IDLE;
+	} else if (vcpu && vcpu->is_normal) {
+		/* Hypervisor code running on behalf of a Normal VCPU */
+		s->context = VMM_PROFILE_SAMPLE_GUEST_EXIT;
+	} else {
+		s->context = VMM_PROFILE_SAMPLE_HYP;
+	}
+
+	if (!guest_mode && sctrl.depth) {
+		/* First entry of trace is the interrupted PC itself */
+		trace.nr_entries = 0;
+		trace.max_entries = sctrl.depth;
+		trace.entries = s->frames;
+		trace.skip = 1;
+		arch_save_stacktrace_regs(regs, &trace);
+		s->nr_frames = trace.nr_entries;
+	}
+
+	scp->count++;
+
+done:
+	vmm_timer_event_start(ev, sctrl.period_ns);
+}
+
+static void profiler_sample_start_ipi(void *a0, void *a1, void *a2)
+{
+	struct vmm_profiler_sample_cpu *scp = &this_cpu(sprof);
+
+	vmm_timer_event_start(&scp->ev, sctrl.period_ns);
+}
+
+static void profiler_sample_stop_ipi(void *a0, void *a1, void *a2)
+{
+	struct vmm_profiler_sample_cpu *scp = &this_cpu(sprof);
+
+	vmm_timer_event_stop(&scp->ev);
+}
+
+bool vmm_profiler_sample_isactive(void)
+{
+	return sctrl.is_active;
+}
+
+int vmm_profiler_sample_start(u64 period_nsecs, u32 depth)
+{
+	u32 c;
+	struct vmm_profiler_sample_cpu *scp;
+
+	if (sctrl.is_active) {
+		return VMM_EBUSY;
+	}
+
+	if (period_nsecs < VMM_PROFILE_SAMPLE_MIN_PERIOD) {
+		return VMM_EINVALID;
+	}
+
+	for_each_cpu(c, cpu_online_mask) {
+		scp = &per_cpu(sprof, c);
+		if (!scp->samples) {
+			scp->samples = vmm_malloc(VMM_PROFILE_SAMPLE_COUNT *
+					sizeof(struct vmm_profiler_sample));
+			if (!scp->samples) {
+				return VMM_ENOMEM;
+			}
+		}
+		scp->count = 0;
+		scp->dropped = 0;
+	}
+
+	sctrl.period_ns = period_nsecs;
+	sctrl.depth = (depth < VMM_PROFILE_SAMPLE_DEPTH) ?
+					depth : VMM_PROFILE_SAMPLE_DEPTH;
+	sctrl.is_active = TRUE;
+
+	vmm_smp_ipi_async_call(cpu_online_mask,
+			       profiler_sample_start_ipi, NULL, NULL, NULL);
+
+	return VMM_OK;
+}
+
+int vmm_profiler_sample_stop(void)
+{
+	if (!sctrl.is_active) {
+		return VMM_EFAIL;
+	}
+
+	sctrl.is_active = FALSE;
+
+	return vmm_smp_ipi_sync_call(cpu_online_mask, 1000,
+				     profiler_sample_stop_ipi,
+				     NULL, NULL, NULL);
+}
+
+u64 vmm_profiler_sample_period(void)
+{
+	return sctrl.period_ns;
+}
+
+u32 vmm_profiler_sample_depth(void)
+{
+	return sctrl.depth;
+}
+
+u32 vmm_profiler_sample_count(u32 hcpu)
+{
+	if (CONFIG_CPU_COUNT <= hcpu) {
+		return 0;
+	}
+
+	return per_cpu(sprof, hcpu).count;
+}
+
+u64 vmm_profiler_sample_dropped(u32 hcpu)
+{
+	if (CONFIG_CPU_COUNT <= hcpu) {
+		return 0;
+	}
+
+	return per_cpu(sprof, hcpu).dropped;
+}
+
+struct vmm_profiler_sample *vmm_profiler_sample_get(u32 hcpu, u32 index)
+{
+	struct vmm_profiler_sample_cpu *scp;
+
+	if (CONFIG_CPU_COUNT <= hcpu) {
+		return NULL;
+	}
+
+	scp = &per_cpu(sprof, hcpu);
+	if (!scp->samples || (scp->count <= index)) {
+		return NULL;
+	}
+
+	return &scp->samples[index];
+}
+
+int __init vmm_profiler_sample_init(void)
+{
+	u32 c;
+	struct vmm_profiler_sample_cpu *scp;
+
+	sctrl.is_active = FALSE;
+	sctrl.period_ns = VMM_PROFILE_SAMPLE_DEF_PERIOD;
+	sctrl.depth = VMM_PROFILE_SAMPLE_DEPTH;
+
+	for_each_cpu(c, cpu_possible_mask) {
+		scp = &per_cpu(sprof, c);
+		INIT_TIMER_EVENT(&scp->ev, profiler_sample_event, scp);
+		scp->samples = NULL;
+		scp->count = 0;
+		scp->dropped = 0;
+	}
+
+	return VMM_OK;
+}
@@ -0,0 +1,276 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file vmm_rwsem.c
+ * @author agent (agent@local)
+ * @brief Implementation of reader-writer semaphores for Orphan VCPU (or Thread).
+ */
+
+#include <vmm_error.h>
+#include <vmm_stdio.h>
+#include <vmm_timer.h>
+#include <vmm_scheduler.h>
+#include <vmm_rwsem.h>
+#include <arch_cpu_irq.h>
+#include <arch_barrier.h>
+
+void __vmm_rwsem_cleanup(struct vmm_vcpu *vcpu,
+			 struct vmm_vcpu_resource *vcpu_res)
+{
+	irq_flags_t flags;
+	struct vmm_rwsem *sem = container_of(vcpu_res, struct vmm_rwsem, res);
+
+	if (!vcpu || !vcpu_res) {
+		return;
+	}
+
+	vmm_spin_lock_irqsave(&sem->wq.lock, flags);
+
+	if ((sem->count < 0) && (sem->owner == vcpu)) {
+		sem->count = 0;
+		sem->owner = NULL;
+		__vmm_waitqueue_wakeall(&sem->wq);
+	}
+
+	vmm_spin_unlock_irqrestore(&sem->wq.lock, flags);
+}
+
+bool vmm_rwsem_avail(struct vmm_rwsem *sem)
+{
+	bool ret;
+	irq_flags_t flags;
+
+	BUG_ON(!sem);
+
+	vmm_spin_lock_irqsave(&sem->wq.lock, flags);
+	ret = (sem->count) ? FALSE : TRUE;
+	vmm_spin_unlock_irqrestore(&sem->wq.lock, flags);
+
+	return ret;
+}
+
+/* Spin while rwsem is owned by a writer running on other host CPU
+ * Note: This function must be called with rwsem waitqueue lock held
+ * which is released while spinning.
+ * Note: Returns TRUE if writer released rwsem so caller should retry.
+ */
+static bool rwsem_optimistic_spin(struct vmm_rwsem *sem,
+				  irq_flags_t *flags)
+{
+	u64 tstamp;
+	struct vmm_vcpu *owner = sem->owner;
+
+	if (!owner ||
+	    (vmm_manager_vcpu_get_state(owner) != VMM_VCPU_STATE_RUNNING)) {
+		return FALSE;
+	}
+
+	vmm_spin_unlock_irqrestore(&sem->wq.lock, *flags);
+
+	tstamp = vmm_timer_timestamp();
+	while ((sem->owner == owner) &&
+	       (vmm_manager_vcpu_get_state(owner) == VMM_VCPU_STATE_RUNNING) &&
+	       ((vmm_timer_timestamp() - tstamp) < VMM_RWSEM_SPIN_NSECS)) {
+		arch_smp_rmb();
+	}
+
+	vmm_spin_lock_irqsave(&sem->wq.lock, *flags);
+
+	return (sem->owner != owner) ? TRUE : FALSE;
+}
+
+int vmm_rwsem_down_read_trylock(struct vmm_rwsem *sem)
+{
+	int ret = 0;
+	irq_flags_t flags;
+
+	BUG_ON(!sem);
+	BUG_ON(!vmm_scheduler_orphan_context());
+
+	vmm_spin_lock_irqsave(&sem->wq.lock, flags);
+
+	if ((sem->count >= 0) && !sem->wait_writers) {
+		sem->count++;
+		ret = 1;
+	}
+
+	vmm_spin_unlock_irqrestore(&sem->wq.lock, flags);
+
+	return ret;
+}
+
+static int rwsem_down_read_common(struct vmm_rwsem *sem, u64 *timeout)
+{
+	int rc = VMM_OK;
+	irq_flags_t flags;
+
+	BUG_ON(!sem);
+	BUG_ON(!vmm_scheduler_orphan_context());
+
+	vmm_spin_lock_irqsave(&sem->wq.lock, flags);
+
+	/* Waiting writers get preference over new readers */
+	while ((sem->count < 0) || sem->wait_writers) {
+		if (rwsem_optimistic_spin(sem, &flags)) {
+			continue;
+		}
+		rc = __vmm_waitqueue_sleep(&sem->wq, timeout);
+		if (rc) {
+			/* Timeout or some other failure */
+			break;
+		}
+	}
+	if (rc == VMM_OK) {
+		sem->count++;
+	}
+
+	vmm_spin_unlock_irqrestore(&sem->wq.lock, flags);
+
+	return rc;
+}
+
+int vmm_rwsem_down_read(struct vmm_rwsem *sem)
+{
+	return rwsem_down_read_common(sem, NULL);
+}
+
+int vmm_rwsem_down_read_timeout(struct vmm_rwsem *sem, u64 *timeout)
+{
+	return rwsem_down_read_common(sem, timeout);
+}
+
+int vmm_rwsem_up_read(struct vmm_rwsem *sem)
+{
+	int rc = VMM_EINVALID;
+	irq_flags_t flags;
+
+	BUG_ON(!sem);
+
+	vmm_spin_lock_irqsave(&sem->wq.lock, flags);
+
+	if (sem->count > 0) {
+		sem->count--;
+		rc = VMM_OK;
+		if (!sem->count) {
+			rc = __vmm_waitqueue_wakeall(&sem->wq);
+			if (rc == VMM_ENOENT) {
+				rc = VMM_OK;
+			}
+		}
+	}
+
+	vmm_spin_unlock_irqrestore(&sem->wq.lock, flags);
+
+	return rc;
+}
+
+int vmm_rwsem_down_write_trylock(struct vmm_rwsem *sem)
+{
+	int ret = 0;
+	irq_flags_t flags;
+	struct vmm_vcpu *current_vcpu = vmm_scheduler_current_vcpu();
+
+	BUG_ON(!sem);
+	BUG_ON(!vmm_scheduler_orphan_context());
+
+	vmm_spin_lock_irqsave(&sem->wq.lock, flags);
+
+	if (!sem->count) {
+		sem->count = -1;
+		sem->owner = current_vcpu;
+		vmm_manager_vcpu_resource_add(current_vcpu, &sem->res);
+		ret = 1;
+	}
+
+	vmm_spin_unlock_irqrestore(&sem->wq.lock, flags);
+
+	return ret;
+}
+
+static int rwsem_down_write_common(struct vmm_rwsem *sem, u64 *timeout)
+{
+	int rc = VMM_OK;
+	irq_flags_t flags;
+	struct vmm_vcpu *current_vcpu = vmm_scheduler_current_vcpu();
+
+	BUG_ON(!sem);
+	BUG_ON(!vmm_scheduler_orphan_context());
+
+	vmm_spin_lock_irqsave(&sem->wq.lock, flags);
+
+	sem->wait_writers++;
+	while (sem->count) {
+		if (rwsem_optimistic_spin(sem, &flags)) {
+			continue;
+		}
+		rc = __vmm_waitqueue_sleep(&sem->wq, timeout);
+		if (rc) {
+			/* Timeout or some other failure */
+			break;
+		}
+	}
+	sem->wait_writers--;
+	if (rc == VMM_OK) {
+		sem->count = -1;
+		sem->owner = current_vcpu;
+		vmm_manager_vcpu_resource_add(current_vcpu, &sem->res);
+	} else if (!sem->wait_writers && (sem->count >= 0)) {
+		/* Readers might be waiting only because of us */
+		__vmm_waitqueue_wakeall(&sem->wq);
+	}
+
+	vmm_spin_unlock_irqrestore(&sem->wq.lock, flags);
+
+	return rc;
+}
+
+int vmm_rwsem_down_write(struct vmm_rwsem *sem)
+{
+	return rwsem_down_write_common(sem, NULL);
+}
+
+int vmm_rwsem_down_write_timeout(struct vmm_rwsem *sem, u64 *timeout)
+{
+	return rwsem_down_write_common(sem, timeout);
+}
+
+int vmm_rwsem_up_write(struct vmm_rwsem *sem)
+{
+	int rc = VMM_EINVALID;
+	irq_flags_t flags;
+	struct vmm_vcpu *current_vcpu = vmm_scheduler_current_vcpu();
+
+	BUG_ON(!sem);
+	BUG_ON(!vmm_scheduler_orphan_context());
+
+	vmm_spin_lock_irqsave(&sem->wq.lock, flags);
+
+	if ((sem->count < 0) && (sem->owner == current_vcpu)) {
+		sem->count = 0;
+		sem->owner = NULL;
+		vmm_manager_vcpu_resource_remove(current_vcpu, &sem->res);
+		rc = __vmm_waitqueue_wakeall(&sem->wq);
+		if (rc == VMM_ENOENT) {
+			rc = VMM_OK;
+		}
+	}
+
+	vmm_spin_unlock_irqrestore(&sem->wq.lock, flags);
+
+	return rc;
+}
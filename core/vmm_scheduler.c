@@ -712,6 +712,11 @@ bool vmm_scheduler_irq_context(void)
 	return this_cpu(sched).irq_context;
 }
 
+arch_regs_t *vmm_scheduler_irq_regs(void)
+{
+	return this_cpu(sched).irq_regs;
+}
+
 bool vmm_scheduler_orphan_context(void)
 {
 	bool ret = FALSE;
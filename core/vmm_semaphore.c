@@ -24,8 +24,10 @@
 #include <vmm_error.h>
 #include <vmm_heap.h>
 #include <vmm_stdio.h>
+#include <vmm_timer.h>
 #include <vmm_semaphore.h>
 #include <arch_cpu_irq.h>
+#include <arch_barrier.h>
 
 struct vmm_semaphore_resource {
 	struct dlist head;
@@ -62,6 +64,23 @@ static struct vmm_semaphore_resource *__semaphore_first_resource(
 				struct vmm_semaphore_resource, head);
 }
 
+/* Note: This function must be called with semaphore waitqueue lock held */
+static u32 __semaphore_reserved(struct vmm_semaphore *sem,
+				struct vmm_vcpu *vcpu)
+{
+	if (!sem->handoff || (sem->handoff == vcpu)) {
+		return 0;
+	}
+
+	/* Reservation is only valid while handoff VCPU is waiting */
+	if (sem->handoff->wq_lock != &sem->wq.lock) {
+		sem->handoff = NULL;
+		return 0;
+	}
+
+	return 1;
+}
+
 static void __vmm_semaphore_cleanup(struct vmm_vcpu *vcpu,
 				    struct vmm_vcpu_resource *vcpu_res)
 {
@@ -142,6 +161,13 @@ int vmm_semaphore_up(struct vmm_semaphore *sem)
 	if (sem->value < sem->limit) {
 		sem->value++;
 
+		/* Reserve this count for first waiter if it is starving */
+		if (sem->starving && sem->wq.vcpu_count && !sem->handoff) {
+			sem->handoff = list_first_entry(&sem->wq.vcpu_list,
+						struct vmm_vcpu, wq_head);
+			sem->starving = FALSE;
+		}
+
 		sres = __semaphore_find_resource(sem, current_vcpu);
 		if (!sres) {
 			sres = __semaphore_first_resource(sem);
@@ -171,9 +197,53 @@ int vmm_semaphore_up(struct vmm_semaphore *sem)
 	return rc;
 }
 
+/* Spin while semaphore is held by some VCPU running on other host CPU
+ * Note: This function must be called with semaphore waitqueue lock held
+ * which is released while spinning.
+ * Note: Returns TRUE if semaphore became available so caller should retry.
+ */
+static bool semaphore_optimistic_spin(struct vmm_semaphore *sem,
+				      struct vmm_vcpu *current_vcpu,
+				      irq_flags_t *flags)
+{
+	u64 tstamp;
+	bool running = FALSE;
+	struct vmm_semaphore_resource *sres;
+
+	/* Don't spin if a waiter is already starving */
+	if (sem->starving || sem->handoff) {
+		return FALSE;
+	}
+
+	list_for_each_entry(sres, &sem->res_list, head) {
+		if ((sres->vcpu != current_vcpu) &&
+		    (vmm_manager_vcpu_get_state(sres->vcpu) ==
+						VMM_VCPU_STATE_RUNNING)) {
+			running = TRUE;
+			break;
+		}
+	}
+	if (!running) {
+		return FALSE;
+	}
+
+	vmm_spin_unlock_irqrestore(&sem->wq.lock, *flags);
+
+	tstamp = vmm_timer_timestamp();
+	while (!sem->value &&
+	       ((vmm_timer_timestamp() - tstamp) < VMM_SEMAPHORE_SPIN_NSECS)) {
+		arch_smp_rmb();
+	}
+
+	vmm_spin_lock_irqsave(&sem->wq.lock, *flags);
+
+	return (sem->value) ? TRUE : FALSE;
+}
+
 static int semaphore_down_common(struct vmm_semaphore *sem, u64 *timeout)
 {
 	int rc = VMM_OK;
+	bool woken = FALSE;
 	irq_flags_t flags;
 	struct vmm_vcpu *current_vcpu = vmm_scheduler_current_vcpu();
 	struct vmm_semaphore_resource *sres;
@@ -184,14 +254,33 @@ static int semaphore_down_common(struct vmm_semaphore *sem, u64 *timeout)
 
 	vmm_spin_lock_irqsave(&sem->wq.lock, flags);
 
-	while (!sem->value) {
+	while (sem->value <= __semaphore_reserved(sem, current_vcpu)) {
+		/* Woken up but somebody else got the semaphore */
+		if (woken) {
+			sem->starving = TRUE;
+		}
+		if (semaphore_optimistic_spin(sem, current_vcpu, &flags)) {
+			continue;
+		}
 		rc = __vmm_waitqueue_sleep(&sem->wq, timeout);
 		if (rc) {
-			/* Timeout or some other failure */
+			/* Timeout or some other failure so give up
+			 * reservation (if any) to other waiters.
+			 */
+			if (sem->handoff == current_vcpu) {
+				sem->handoff = NULL;
+				if (sem->value) {
+					__vmm_waitqueue_wakeall(&sem->wq);
+				}
+			}
 			break;
 		}
+		woken = TRUE;
 	}
 	if (rc == VMM_OK) {
+		if (sem->handoff == current_vcpu) {
+			sem->handoff = NULL;
+		}
 		sres = __semaphore_find_resource(sem, current_vcpu);
 		if (!sres) {
 			sres = vmm_zalloc(sizeof(*sres));
@@ -30,7 +30,12 @@
 #include <vmm_timer.h>
 #include <vmm_completion.h>
 #include <vmm_manager.h>
-#include <libs/fifo.h>
+#include <vmm_scheduler.h>
+#include <vmm_heap.h>
+#include <arch_atomic.h>
+#include <arch_barrier.h>
+#include <arch_cpu_irq.h>
+#include <libs/log2.h>
 
 /* SMP processor ID for Boot CPU */
 static u32 smp_bootcpu_id = UINT_MAX;
@@ -63,6 +68,7 @@ bool vmm_smp_is_bootcpu(void)
  * simultaneously to a host CPU should not be more than 
  * maximum possible hardware CPUs but, we keep minimum
  * Sync IPIs per host CPU to max possible VCPUs.
+ * Note: IPI queue size is rounded up to power of two.
  */
 #define SMP_IPI_MAX_SYNC_PER_CPU	(CONFIG_MAX_VCPU_COUNT)
 
@@ -72,8 +78,7 @@ bool vmm_smp_is_bootcpu(void)
  */
 #define SMP_IPI_MAX_ASYNC_PER_CPU	(64)
 
-#define SMP_IPI_WAIT_TRY_COUNT		100
-#define SMP_IPI_WAIT_UDELAY		1000
+#define SMP_IPI_WAIT_UDELAY		10
 
 #define IPI_VCPU_STACK_SZ 		CONFIG_THREAD_STACK_SIZE
 #define IPI_VCPU_PRIORITY 		VMM_VCPU_MAX_PRIORITY
@@ -90,59 +95,256 @@ struct smp_ipi_call {
 	void *arg2;
 };
 
+struct smp_ipi_slot {
+	atomic_t seq;
+	struct smp_ipi_call call;
+};
+
+/* Bounded lock-free multi-producer single-consumer queue
+ *
+ * Each slot has a sequence number which tells whether the slot
+ * is free for producer claiming position "pos" (seq == pos) or
+ * holds a call ready for consumer at position "pos" (seq == pos + 1).
+ * Producers claim positions using cmpxchg on tail whereas the only
+ * consumer (destination host CPU) simply advances head.
+ */
+struct smp_ipi_queue {
+	atomic_t tail;
+	atomic_t head;
+	u32 size;
+	struct smp_ipi_slot *slots;
+};
+
 struct smp_ipi_ctrl {
-	struct fifo *sync_fifo;
-	struct fifo *async_fifo;
+	struct smp_ipi_queue sync_q;
+	struct smp_ipi_queue async_q;
+	atomic_t ipi_pending;
 	struct vmm_completion ipi_avail;
 	struct vmm_vcpu *ipi_vcpu;
 };
 
 static DEFINE_PER_CPU(struct smp_ipi_ctrl, ictl);
 
-static void smp_ipi_sync_submit(struct smp_ipi_ctrl *ictlp, 
-				struct smp_ipi_call *ipic)
+static int smp_ipi_queue_init(struct smp_ipi_queue *q, u32 size)
 {
-	int try;
+	u32 i;
 
-	if (!ipic || !ipic->func) {
-		return;
+	q->size = roundup_pow_of_two(size);
+	q->slots = vmm_zalloc(q->size * sizeof(*q->slots));
+	if (!q->slots) {
+		return VMM_ENOMEM;
 	}
 
-	try = SMP_IPI_WAIT_TRY_COUNT;
-	while (!fifo_enqueue(ictlp->sync_fifo, ipic, FALSE) && try) {
-		arch_smp_ipi_trigger(vmm_cpumask_of(ipic->dst_cpu));
-		vmm_udelay(SMP_IPI_WAIT_UDELAY);
-		try--;
+	for (i = 0; i < q->size; i++) {
+		ARCH_ATOMIC_INIT(&q->slots[i].seq, i);
+	}
+	ARCH_ATOMIC_INIT(&q->tail, 0);
+	ARCH_ATOMIC_INIT(&q->head, 0);
+
+	return VMM_OK;
+}
+
+static void smp_ipi_queue_free(struct smp_ipi_queue *q)
+{
+	if (q->slots) {
+		vmm_free(q->slots);
+		q->slots = NULL;
+	}
+}
+
+static bool smp_ipi_queue_enqueue(struct smp_ipi_queue *q,
+				  struct smp_ipi_call *ipic, long *ticket)
+{
+	long pos, diff;
+	struct smp_ipi_slot *slot;
+
+	pos = arch_atomic_read(&q->tail);
+	while (1) {
+		slot = &q->slots[pos & (q->size - 1)];
+		diff = arch_atomic_read(&slot->seq) - pos;
+		if (diff == 0) {
+			if (arch_atomic_cmpxchg(&q->tail, pos, pos + 1) == pos) {
+				break;
+			}
+		} else if (diff < 0) {
+			/* Queue is full */
+			return FALSE;
+		}
+		pos = arch_atomic_read(&q->tail);
+	}
+
+	slot->call = *ipic;
+	arch_smp_wmb();
+	arch_atomic_write(&slot->seq, pos + 1);
+
+	if (ticket) {
+		*ticket = pos;
 	}
 
-	if (!try) {
-		vmm_panic("CPU%d: IPI sync fifo full\n", ipic->dst_cpu);
+	return TRUE;
+}
+
+/* Note: Must only be called by the owner (i.e. consumer) of queue.
+ * Note: If release is FALSE then slot of dequeued call is reused only
+ * after smp_ipi_queue_release() is called for returned ticket.
+ */
+static bool smp_ipi_queue_dequeue(struct smp_ipi_queue *q,
+				  struct smp_ipi_call *ipic, long *ticket,
+				  bool release)
+{
+	long pos = arch_atomic_read(&q->head);
+	struct smp_ipi_slot *slot = &q->slots[pos & (q->size - 1)];
+
+	if (arch_atomic_read(&slot->seq) != (pos + 1)) {
+		return FALSE;
 	}
+	arch_smp_rmb();
+
+	*ipic = slot->call;
+	if (release) {
+		arch_smp_mb();
+		arch_atomic_write(&slot->seq, pos + q->size);
+	}
+	arch_atomic_write(&q->head, pos + 1);
+
+	if (ticket) {
+		*ticket = pos;
+	}
+
+	return TRUE;
+}
 
-	arch_smp_ipi_trigger(vmm_cpumask_of(ipic->dst_cpu));
+/* Mark call of given ticket as done and allow reuse of its slot */
+static void smp_ipi_queue_release(struct smp_ipi_queue *q, long ticket)
+{
+	struct smp_ipi_slot *slot = &q->slots[ticket & (q->size - 1)];
+
+	arch_smp_mb();
+	arch_atomic_write(&slot->seq, ticket + q->size);
+}
+
+/* Check whether call of given ticket is done. The sequence number
+ * of a slot only moves forward so this remains TRUE even after the
+ * slot is reused by later tickets.
+ */
+static bool smp_ipi_queue_released(struct smp_ipi_queue *q, long ticket)
+{
+	struct smp_ipi_slot *slot = &q->slots[ticket & (q->size - 1)];
+
+	return ((arch_atomic_read(&slot->seq) - (ticket + (long)q->size)) >= 0) ?
+								TRUE : FALSE;
 }
 
-static void smp_ipi_async_submit(struct smp_ipi_ctrl *ictlp, 
-				 struct smp_ipi_call *ipic)
+static bool smp_ipi_queue_isempty(struct smp_ipi_queue *q)
 {
-	int try;
+	long pos = arch_atomic_read(&q->head);
+	struct smp_ipi_slot *slot = &q->slots[pos & (q->size - 1)];
+
+	return (arch_atomic_read(&slot->seq) != (pos + 1)) ? TRUE : FALSE;
+}
+
+/* Note: Must be called on owner host CPU with interrupts disabled.
+ * Note: Sync IPI handlers can wait for other host CPUs and process
+ * later Sync IPIs in nested manner so each call is marked done using
+ * its own ticket instead of a shared in-order counter.
+ */
+static void smp_ipi_sync_process(struct smp_ipi_ctrl *ictlp)
+{
+	long ticket;
+	struct smp_ipi_call ipic;
 
-	if (!ipic || !ipic->func) {
+	while (smp_ipi_queue_dequeue(&ictlp->sync_q, &ipic, &ticket, FALSE)) {
+		if (ipic.func) {
+			ipic.func(ipic.arg0, ipic.arg1, ipic.arg2);
+		}
+		smp_ipi_queue_release(&ictlp->sync_q, ticket);
+	}
+}
+
+/* Process Sync IPIs pending for current host CPU while we are busy
+ * waiting for other host CPUs. This avoids deadlock when two host
+ * CPUs wait on each other from IRQ context.
+ *
+ * Sync IPI handlers expect IRQ context so in thread context nothing
+ * is done here and pending Sync IPIs are left to the hardware IPI
+ * already triggered for current host CPU.
+ */
+static void smp_ipi_sync_process_local(void)
+{
+	irq_flags_t flags;
+
+	if (!vmm_scheduler_irq_context()) {
 		return;
 	}
 
-	try = SMP_IPI_WAIT_TRY_COUNT;
-	while (!fifo_enqueue(ictlp->async_fifo, ipic, FALSE) && try) {
+	arch_cpu_irq_save(flags);
+	smp_ipi_sync_process(&this_cpu(ictl));
+	arch_cpu_irq_restore(flags);
+}
+
+/* Enqueue an IPI call to destination host CPU and return TRUE if
+ * destination needs a hardware IPI. If destination already has an
+ * IPI pending then the hardware IPI is suppressed because the
+ * destination will drain the queue anyway.
+ */
+static bool smp_ipi_submit(struct smp_ipi_ctrl *ictlp,
+			   struct smp_ipi_queue *q,
+			   struct smp_ipi_call *ipic, long *ticket)
+{
+	/* Apply backpressure when destination queue is full */
+	while (!smp_ipi_queue_enqueue(q, ipic, ticket)) {
+		arch_atomic_write(&ictlp->ipi_pending, 1);
 		arch_smp_ipi_trigger(vmm_cpumask_of(ipic->dst_cpu));
+		smp_ipi_sync_process_local();
 		vmm_udelay(SMP_IPI_WAIT_UDELAY);
-		try--;
 	}
 
-	if (!try) {
-		vmm_panic("CPU%d: IPI async fifo full\n", ipic->dst_cpu);
+	arch_smp_mb();
+
+	return (arch_atomic_cmpxchg(&ictlp->ipi_pending, 0, 1) == 0) ?
+								TRUE : FALSE;
+}
+
+/* Enqueue an IPI call once for each online destination host CPU
+ * (other than current host CPU) and trigger hardware IPI only
+ * once for all destinations which do not have IPI pending.
+ */
+static void smp_ipi_multicast(const struct vmm_cpumask *dest, bool sync,
+			      void (*func)(void *, void *, void *),
+			      void *arg0, void *arg1, void *arg2,
+			      struct vmm_cpumask *submit_mask, long *tickets)
+{
+	u32 c, cpu = vmm_smp_processor_id();
+	struct vmm_cpumask trig_mask = VMM_CPU_MASK_NONE;
+	struct smp_ipi_call ipic;
+	struct smp_ipi_ctrl *ictlp;
+
+	ipic.src_cpu = cpu;
+	ipic.func = func;
+	ipic.arg0 = arg0;
+	ipic.arg1 = arg1;
+	ipic.arg2 = arg2;
+
+	for_each_cpu(c, dest) {
+		if ((c == cpu) || !vmm_cpu_online(c)) {
+			continue;
+		}
+
+		ipic.dst_cpu = c;
+		ictlp = &per_cpu(ictl, c);
+		if (smp_ipi_submit(ictlp,
+				   (sync) ? &ictlp->sync_q : &ictlp->async_q,
+				   &ipic, (tickets) ? &tickets[c] : NULL)) {
+			vmm_cpumask_set_cpu(c, &trig_mask);
+		}
+		if (submit_mask) {
+			vmm_cpumask_set_cpu(c, submit_mask);
+		}
 	}
 
-	arch_smp_ipi_trigger(vmm_cpumask_of(ipic->dst_cpu));
+	if (!vmm_cpumask_empty(&trig_mask)) {
+		arch_smp_ipi_trigger(&trig_mask);
+	}
 }
 
 static void smp_ipi_main(void)
@@ -155,7 +357,8 @@ static void smp_ipi_main(void)
 		vmm_completion_wait(&ictlp->ipi_avail);
 
 		/* Process async IPIs */
-		while (fifo_dequeue(ictlp->async_fifo, &ipic)) {
+		while (smp_ipi_queue_dequeue(&ictlp->async_q, &ipic,
+					     NULL, TRUE)) {
 			if (ipic.func) {
 				ipic.func(ipic.arg0, ipic.arg1, ipic.arg2);
 			}
@@ -165,18 +368,19 @@ static void smp_ipi_main(void)
 
 void vmm_smp_ipi_exec(void)
 {
-	struct smp_ipi_call ipic;
 	struct smp_ipi_ctrl *ictlp = &this_cpu(ictl);
 
+	/* Allow new hardware IPIs before draining queues so that
+	 * calls submitted after this point are never missed.
+	 */
+	arch_atomic_write(&ictlp->ipi_pending, 0);
+	arch_smp_mb();
+
 	/* Process Sync IPIs */
-	while (fifo_dequeue(ictlp->sync_fifo, &ipic)) {
-		if (ipic.func) {
-			ipic.func(ipic.arg0, ipic.arg1, ipic.arg2);
-		}
-	}
+	smp_ipi_sync_process(ictlp);
 
 	/* Signal IPI available event */
-	if (!fifo_isempty(ictlp->async_fifo)) {
+	if (!smp_ipi_queue_isempty(&ictlp->async_q)) {
 		vmm_completion_complete(&ictlp->ipi_avail);
 	}
 }
@@ -185,29 +389,14 @@ void vmm_smp_ipi_async_call(const struct vmm_cpumask *dest,
 			     void (*func)(void *, void *, void *),
 			     void *arg0, void *arg1, void *arg2)
 {
-	u32 c, cpu = vmm_smp_processor_id();
-	struct smp_ipi_call ipic;
-
 	if (!dest || !func) {
 		return;
 	}
 
-	for_each_cpu(c, dest) {
-		if (c == cpu) {
-			func(arg0, arg1, arg2);
-		} else {
-			if (!vmm_cpu_online(c)) {
-				continue;
-			}
+	smp_ipi_multicast(dest, FALSE, func, arg0, arg1, arg2, NULL, NULL);
 
-			ipic.src_cpu = cpu;
-			ipic.dst_cpu = c;
-			ipic.func = func;
-			ipic.arg0 = arg0;
-			ipic.arg1 = arg1;
-			ipic.arg2 = arg2;
-			smp_ipi_async_submit(&per_cpu(ictl, c), &ipic);
-		}
+	if (vmm_cpumask_test_cpu(vmm_smp_processor_id(), dest)) {
+		func(arg0, arg1, arg2);
 	}
 }
 
@@ -218,44 +407,31 @@ int vmm_smp_ipi_sync_call(const struct vmm_cpumask *dest,
 {
 	int rc = VMM_OK;
 	u64 timeout_tstamp;
-	u32 c, trig_count, cpu = vmm_smp_processor_id();
+	u32 c, trig_count;
+	long tickets[CONFIG_CPU_COUNT];
 	struct vmm_cpumask trig_mask = VMM_CPU_MASK_NONE;
-	struct smp_ipi_call ipic;
-	struct smp_ipi_ctrl *ictlp;
 
 	if (!dest || !func) {
 		return VMM_EFAIL;
 	}
 
-	trig_count = 0;
-	for_each_cpu(c, dest) {
-		if (c == cpu) {
-			func(arg0, arg1, arg2);
-		} else {
-			if (!vmm_cpu_online(c)) {
-				continue;
-			}
+	smp_ipi_multicast(dest, TRUE, func, arg0, arg1, arg2,
+			  &trig_mask, tickets);
 
-			ipic.src_cpu = cpu;
-			ipic.dst_cpu = c;
-			ipic.func = func;
-			ipic.arg0 = arg0;
-			ipic.arg1 = arg1;
-			ipic.arg2 = arg2;
-			smp_ipi_sync_submit(&per_cpu(ictl, c), &ipic);
-			vmm_cpumask_set_cpu(c, &trig_mask);
-			trig_count++;
-		}
+	if (vmm_cpumask_test_cpu(vmm_smp_processor_id(), dest)) {
+		func(arg0, arg1, arg2);
 	}
 
+	trig_count = vmm_cpumask_weight(&trig_mask);
 	if (trig_count) {
 		rc = VMM_ETIMEDOUT;
 		timeout_tstamp = vmm_timer_timestamp();
 		timeout_tstamp += (u64)timeout_msecs * 1000000ULL;
 		while (vmm_timer_timestamp() < timeout_tstamp) {
 			for_each_cpu(c, &trig_mask) {
-				ictlp = &per_cpu(ictl, c);
-				if (!fifo_avail(ictlp->sync_fifo)) {
+				if (smp_ipi_queue_released(
+						&per_cpu(ictl, c).sync_q,
+						tickets[c])) {
 					vmm_cpumask_clear_cpu(c, &trig_mask);
 					trig_count--;
 				}
@@ -266,6 +442,7 @@ int vmm_smp_ipi_sync_call(const struct vmm_cpumask *dest,
 				break;
 			}
 
+			smp_ipi_sync_process_local();
 			vmm_udelay(SMP_IPI_WAIT_UDELAY);
 		}
 	}
@@ -280,22 +457,21 @@ int __cpuinit vmm_smp_ipi_init(void)
 	u32 cpu = vmm_smp_processor_id();
 	struct smp_ipi_ctrl *ictlp = &this_cpu(ictl);
 
-	/* Initialize Sync IPI FIFO */
-	ictlp->sync_fifo = fifo_alloc(sizeof(struct smp_ipi_call), 
-					   SMP_IPI_MAX_SYNC_PER_CPU);
-	if (!ictlp->sync_fifo) {
-		rc = VMM_ENOMEM;
+	/* Initialize Sync IPI queue */
+	rc = smp_ipi_queue_init(&ictlp->sync_q, SMP_IPI_MAX_SYNC_PER_CPU);
+	if (rc) {
 		goto fail;
 	}
 
-	/* Initialize Async IPI FIFO */
-	ictlp->async_fifo = fifo_alloc(sizeof(struct smp_ipi_call), 
-					   SMP_IPI_MAX_ASYNC_PER_CPU);
-	if (!ictlp->async_fifo) {
-		rc = VMM_ENOMEM;
+	/* Initialize Async IPI queue */
+	rc = smp_ipi_queue_init(&ictlp->async_q, SMP_IPI_MAX_ASYNC_PER_CPU);
+	if (rc) {
 		goto fail_free_sync;
 	}
 
+	/* Initialize IPI pending state */
+	ARCH_ATOMIC_INIT(&ictlp->ipi_pending, 0);
+
 	/* Initialize IPI available completion event */
 	INIT_COMPLETION(&ictlp->ipi_avail);
 
@@ -331,9 +507,9 @@ fail_stop_vcpu:
 fail_free_vcpu:
 	vmm_manager_vcpu_orphan_destroy(ictlp->ipi_vcpu);
 fail_free_async:
-	fifo_free(ictlp->async_fifo);
+	smp_ipi_queue_free(&ictlp->async_q);
 fail_free_sync:
-	fifo_free(ictlp->sync_fifo);
+	smp_ipi_queue_free(&ictlp->sync_q);
 fail:
 	return rc;
 }
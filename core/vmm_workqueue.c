@@ -30,21 +30,44 @@
 #include <vmm_scheduler.h>
 #include <vmm_completion.h>
 #include <vmm_workqueue.h>
+#include <arch_barrier.h>
 #include <libs/stringlib.h>
 
-struct vmm_workqueue {
+struct vmm_workqueue_pool {
 	vmm_spinlock_t lock;
-	struct dlist head;
 	struct dlist work_list;
 	struct vmm_completion work_avail;
+	struct vmm_workqueue *wq;
+	bool online;
+	u32 nr_busy;
+	struct vmm_workqueue_stats stats;
+};
+
+struct vmm_workqueue_worker {
+	struct vmm_workqueue_pool *pool;
 	struct vmm_thread *thread;
 };
 
+struct vmm_workqueue {
+	struct dlist head;
+	char name[VMM_FIELD_NAME_SIZE];
+	u32 flags;
+	u8 priority;
+	u32 def_pool;
+	u32 nr_pools;
+	struct vmm_workqueue_pool *pools;
+	vmm_spinlock_t workers_lock;
+	u32 nr_workers;
+	u32 max_workers;
+	struct vmm_workqueue_worker *workers;
+};
+
 struct vmm_workqueue_ctrl {
 	vmm_spinlock_t lock;
 	struct dlist wq_list;
 	u32 wq_count;
 	struct vmm_workqueue *syswq[CONFIG_CPU_COUNT];
+	struct vmm_workqueue *syspwq;
 };
 
 static struct vmm_workqueue_ctrl wqctrl;
@@ -115,6 +138,7 @@ bool vmm_workqueue_work_completed(struct vmm_work *work)
 int vmm_workqueue_stop_work(struct vmm_work *work)
 {
 	irq_flags_t flags, flags1;
+	struct vmm_workqueue_pool *pool;
 
 	if (!work) {
 		return VMM_EFAIL;
@@ -129,16 +153,22 @@ stop_retry:
 		goto stop_retry;
 	}
 
-	if (work->wq && (work->flags & VMM_WORK_STATE_SCHEDULED)) {
-		vmm_spin_lock_irqsave(&(work->wq)->lock, flags1);
-		list_del(&work->head);
-		vmm_spin_unlock_irqrestore(&(work->wq)->lock, flags1);
+	pool = work->pool;
+	if (pool && (work->flags & VMM_WORK_STATE_SCHEDULED)) {
+		vmm_spin_lock_irqsave(&pool->lock, flags1);
+		/* Worker might have already dequeued it */
+		if (!list_empty(&work->head)) {
+			list_del_init(&work->head);
+			pool->stats.depth--;
+		}
+		vmm_spin_unlock_irqrestore(&pool->lock, flags1);
 	}
 
 	work->flags &= ~VMM_WORK_STATE_CREATED;
 	work->flags &= ~VMM_WORK_STATE_INPROGRESS;
 	work->flags &= ~VMM_WORK_STATE_SCHEDULED;
 	work->wq = NULL;
+	work->pool = NULL;
 
 	vmm_spin_unlock_irqrestore(&work->lock, flags);
 
@@ -163,7 +193,79 @@ int vmm_workqueue_stop_delayed_work(struct vmm_delayed_work *work)
 
 struct vmm_thread *vmm_workqueue_get_thread(struct vmm_workqueue *wq)
 {
-	return (wq) ? wq->thread : NULL;
+	u32 i;
+
+	if (!wq) {
+		return NULL;
+	}
+
+	for (i = 0; i < wq->max_workers; i++) {
+		if (wq->workers[i].thread) {
+			return wq->workers[i].thread;
+		}
+	}
+
+	return NULL;
+}
+
+const char *vmm_workqueue_get_name(struct vmm_workqueue *wq)
+{
+	return (wq) ? wq->name : NULL;
+}
+
+u32 vmm_workqueue_get_flags(struct vmm_workqueue *wq)
+{
+	return (wq) ? wq->flags : 0;
+}
+
+u32 vmm_workqueue_worker_count(struct vmm_workqueue *wq)
+{
+	return (wq) ? wq->nr_workers : 0;
+}
+
+int vmm_workqueue_get_stats(struct vmm_workqueue *wq,
+			    struct vmm_workqueue_stats *stats)
+{
+	u32 i;
+	irq_flags_t flags;
+	struct vmm_workqueue_pool *pool;
+
+	if (!wq || !stats) {
+		return VMM_EINVALID;
+	}
+
+	memset(stats, 0, sizeof(*stats));
+
+	for (i = 0; i < wq->nr_pools; i++) {
+		pool = &wq->pools[i];
+
+		vmm_spin_lock_irqsave(&pool->lock, flags);
+
+		stats->queued += pool->stats.queued;
+		stats->executed += pool->stats.executed;
+		stats->stolen += pool->stats.stolen;
+		stats->depth += pool->stats.depth;
+		if (stats->max_depth < pool->stats.max_depth) {
+			stats->max_depth = pool->stats.max_depth;
+		}
+		stats->total_latency += pool->stats.total_latency;
+		if (stats->max_latency < pool->stats.max_latency) {
+			stats->max_latency = pool->stats.max_latency;
+		}
+		stats->total_exec += pool->stats.total_exec;
+		if (stats->max_exec < pool->stats.max_exec) {
+			stats->max_exec = pool->stats.max_exec;
+		}
+
+		vmm_spin_unlock_irqrestore(&pool->lock, flags);
+	}
+
+	return VMM_OK;
+}
+
+struct vmm_workqueue *vmm_workqueue_system_percpu(void)
+{
+	return wqctrl.syspwq;
 }
 
 struct vmm_workqueue *vmm_workqueue_index2workqueue(int index)
@@ -203,37 +305,92 @@ u32 vmm_workqueue_count(void)
 	return wqctrl.wq_count;
 }
 
+static void workqueue_wakeup_workers(struct vmm_workqueue_pool *pool)
+{
+	u32 i;
+	struct vmm_workqueue *wq = pool->wq;
+
+	for (i = 0; i < wq->max_workers; i++) {
+		if (wq->workers[i].thread && (wq->workers[i].pool == pool)) {
+			vmm_threads_wakeup(wq->workers[i].thread);
+		}
+	}
+}
+
 int vmm_workqueue_flush(struct vmm_workqueue *wq)
 {
+	u32 i;
 	irq_flags_t flags;
+	struct vmm_workqueue_pool *pool;
 
 	if (!wq) {
 		return VMM_EFAIL;
 	}
 
-	vmm_spin_lock_irqsave(&wq->lock, flags);
+	for (i = 0; i < wq->nr_pools; i++) {
+		pool = &wq->pools[i];
 
-	while (!list_empty(&wq->work_list)) {
-		vmm_spin_unlock_irqrestore(&wq->lock, flags);
+		vmm_spin_lock_irqsave(&pool->lock, flags);
 
-		/* Make sure thread is running */
-		vmm_threads_wakeup(wq->thread);
+		while (!list_empty(&pool->work_list)) {
+			vmm_spin_unlock_irqrestore(&pool->lock, flags);
 
-		/* We release the processor to let the wq thread do its job */
-		vmm_scheduler_yield();
+			/* Make sure worker threads are running */
+			workqueue_wakeup_workers(pool);
 
-		vmm_spin_lock_irqsave(&wq->lock, flags);
-	}
+			/* We release the processor to let the workers
+			 * do their job
+			 */
+			vmm_scheduler_yield();
 
-	vmm_spin_unlock_irqrestore(&wq->lock, flags);
+			vmm_spin_lock_irqsave(&pool->lock, flags);
+		}
+
+		vmm_spin_unlock_irqrestore(&pool->lock, flags);
+	}
 
 	return VMM_OK;
 }
 
+static struct vmm_workqueue_pool *workqueue_local_pool(
+						struct vmm_workqueue *wq)
+{
+	u32 cpu;
+
+	if (wq->flags & VMM_WORKQUEUE_PERCPU) {
+		cpu = vmm_smp_processor_id();
+		if ((cpu < wq->nr_pools) && wq->pools[cpu].online) {
+			return &wq->pools[cpu];
+		}
+	}
+
+	return &wq->pools[wq->def_pool];
+}
+
+/* Wakeup one idle worker so that it can steal from a busy pool */
+static void workqueue_kick_idle(struct vmm_workqueue *wq,
+				struct vmm_workqueue_pool *busy)
+{
+	u32 i;
+	struct vmm_workqueue_pool *pool;
+
+	for (i = 0; i < wq->nr_pools; i++) {
+		pool = &wq->pools[i];
+		if ((pool == busy) || !pool->online ||
+		    pool->nr_busy || pool->stats.depth) {
+			continue;
+		}
+		vmm_completion_complete_once(&pool->work_avail);
+		break;
+	}
+}
+
 int vmm_workqueue_schedule_work(struct vmm_workqueue *wq, 
 				struct vmm_work *work)
 {
+	bool kick;
 	irq_flags_t flags, flags1;
+	struct vmm_workqueue_pool *pool;
 
 	if (!work) {
 		return VMM_EFAIL;
@@ -250,17 +407,39 @@ int vmm_workqueue_schedule_work(struct vmm_workqueue *wq,
 		wq = wqctrl.syswq[vmm_smp_processor_id()];
 	}
 
+	/* Work still in-progress goes to the pool executing it so
+	 * that it is not executed concurrently with itself.
+	 */
+	if ((work->flags & VMM_WORK_STATE_INPROGRESS) &&
+	    work->pool && (work->pool->wq == wq)) {
+		pool = work->pool;
+	} else {
+		pool = workqueue_local_pool(wq);
+	}
+
 	work->flags &= ~VMM_WORK_STATE_CREATED;
 	work->flags |= VMM_WORK_STATE_SCHEDULED;
 	work->wq = wq;
-
-	vmm_spin_lock_irqsave(&wq->lock, flags1);
-	list_add_tail(&work->head, &wq->work_list);
-	vmm_spin_unlock_irqrestore(&wq->lock, flags1);
+	work->pool = pool;
+	work->tstamp = vmm_timer_timestamp();
+
+	vmm_spin_lock_irqsave(&pool->lock, flags1);
+	list_add_tail(&work->head, &pool->work_list);
+	pool->stats.queued++;
+	pool->stats.depth++;
+	if (pool->stats.max_depth < pool->stats.depth) {
+		pool->stats.max_depth = pool->stats.depth;
+	}
+	kick = (pool->nr_busy) ? TRUE : FALSE;
+	vmm_spin_unlock_irqrestore(&pool->lock, flags1);
 
 	vmm_spin_unlock_irqrestore(&work->lock, flags);
 
-	vmm_completion_complete(&wq->work_avail);
+	vmm_completion_complete(&pool->work_avail);
+
+	if (kick && (wq->flags & VMM_WORKQUEUE_PERCPU)) {
+		workqueue_kick_idle(wq, pool);
+	}
 
 	return VMM_OK;
 }
@@ -294,98 +473,340 @@ int vmm_workqueue_schedule_delayed_work(struct vmm_workqueue *wq,
 	return vmm_timer_event_start(&work->event, nsecs);
 }
 
-static int workqueue_main(void *data)
+static struct vmm_work *workqueue_dequeue(struct vmm_workqueue_pool *pool,
+					  struct vmm_workqueue_pool *from)
 {
-	bool do_work;
 	irq_flags_t flags;
-	struct vmm_workqueue *wq = data;
 	struct vmm_work *work = NULL;
 
-	if (!wq) {
+	vmm_spin_lock_irqsave(&from->lock, flags);
+	if (!list_empty(&from->work_list)) {
+		work = list_first_entry(&from->work_list,
+					struct vmm_work, head);
+		list_del_init(&work->head);
+		from->stats.depth--;
+	}
+	vmm_spin_unlock_irqrestore(&from->lock, flags);
+
+	if (work) {
+		vmm_spin_lock_irqsave(&pool->lock, flags);
+		pool->nr_busy++;
+		vmm_spin_unlock_irqrestore(&pool->lock, flags);
+	}
+
+	return work;
+}
+
+/* Steal oldest work from the deepest pool having a busy worker */
+static struct vmm_work *workqueue_steal(struct vmm_workqueue_pool *pool)
+{
+	u32 i, depth = 0;
+	struct vmm_workqueue *wq = pool->wq;
+	struct vmm_workqueue_pool *victim = NULL;
+
+	if (!(wq->flags & VMM_WORKQUEUE_PERCPU)) {
+		return NULL;
+	}
+
+	/* Lockless scan, the dequeue will recheck under lock */
+	for (i = 0; i < wq->nr_pools; i++) {
+		if ((&wq->pools[i] == pool) || !wq->pools[i].online ||
+		    !wq->pools[i].nr_busy) {
+			continue;
+		}
+		if (depth < wq->pools[i].stats.depth) {
+			depth = wq->pools[i].stats.depth;
+			victim = &wq->pools[i];
+		}
+	}
+
+	return (victim) ? workqueue_dequeue(pool, victim) : NULL;
+}
+
+/* Returns FALSE if work was handed back to the pool executing it */
+static bool workqueue_process(struct vmm_workqueue_pool *pool,
+			      struct vmm_work *work, bool stolen)
+{
+	bool do_work = FALSE, requeued = FALSE;
+	u64 latency = 0, exec = 0;
+	irq_flags_t flags, flags1;
+	struct vmm_workqueue_pool *wpool = NULL;
+
+	vmm_spin_lock_irqsave(&work->lock, flags);
+	if (work->flags & VMM_WORK_STATE_SCHEDULED) {
+		if (work->flags & VMM_WORK_STATE_INPROGRESS) {
+			/* Executing on some other worker so give it back
+			 * to pool of that worker.
+			 */
+			wpool = work->pool;
+			vmm_spin_lock_irqsave(&wpool->lock, flags1);
+			list_add_tail(&work->head, &wpool->work_list);
+			wpool->stats.depth++;
+			vmm_spin_unlock_irqrestore(&wpool->lock, flags1);
+			requeued = TRUE;
+		} else {
+			work->flags &= ~VMM_WORK_STATE_SCHEDULED;
+			work->flags |= VMM_WORK_STATE_INPROGRESS;
+			work->pool = pool;
+			exec = vmm_timer_timestamp();
+			latency = exec - work->tstamp;
+			do_work = TRUE;
+		}
+	}
+	vmm_spin_unlock_irqrestore(&work->lock, flags);
+
+	if (do_work) {
+		work->func(work);
+		exec = vmm_timer_timestamp() - exec;
+
+		wpool = NULL;
+		vmm_spin_lock_irqsave(&work->lock, flags);
+		work->flags &= ~VMM_WORK_STATE_INPROGRESS;
+		if (work->flags & VMM_WORK_STATE_SCHEDULED) {
+			/* Rescheduled while executing so make sure
+			 * worker of its pool does not miss it.
+			 */
+			wpool = work->pool;
+		}
+		vmm_spin_unlock_irqrestore(&work->lock, flags);
+
+		if (wpool && (wpool != pool)) {
+			vmm_completion_complete(&wpool->work_avail);
+		}
+	}
+
+	vmm_spin_lock_irqsave(&pool->lock, flags);
+	pool->nr_busy--;
+	if (do_work) {
+		pool->stats.executed++;
+		if (stolen) {
+			pool->stats.stolen++;
+		}
+		pool->stats.total_latency += latency;
+		if (pool->stats.max_latency < latency) {
+			pool->stats.max_latency = latency;
+		}
+		pool->stats.total_exec += exec;
+		if (pool->stats.max_exec < exec) {
+			pool->stats.max_exec = exec;
+		}
+	}
+	vmm_spin_unlock_irqrestore(&pool->lock, flags);
+
+	return !requeued;
+}
+
+static int workqueue_main(void *data)
+{
+	bool stolen;
+	struct vmm_work *work;
+	struct vmm_workqueue_worker *wkr = data;
+	struct vmm_workqueue_pool *pool;
+
+	if (!wkr || !wkr->pool) {
 		return VMM_EFAIL;
 	}
+	pool = wkr->pool;
 
 	while (1) {
-		vmm_completion_wait(&wq->work_avail);
-
-		vmm_spin_lock_irqsave(&wq->lock, flags);
-		
-		while (!list_empty(&wq->work_list)) {
-			work = list_first_entry(&wq->work_list,
-						struct vmm_work, head);
-			list_del(&work->head);
-			vmm_spin_unlock_irqrestore(&wq->lock, flags);
-
-			do_work = FALSE;
-			vmm_spin_lock_irqsave(&work->lock, flags);
-			if (work->flags & VMM_WORK_STATE_SCHEDULED) {
-				work->flags &= ~VMM_WORK_STATE_SCHEDULED;
-				work->flags |= VMM_WORK_STATE_INPROGRESS;
-				do_work = TRUE;
+		vmm_completion_wait(&pool->work_avail);
+
+		while (1) {
+			/* Local work first then try stealing */
+			stolen = FALSE;
+			work = workqueue_dequeue(pool, pool);
+			if (!work) {
+				work = workqueue_steal(pool);
+				if (!work) {
+					break;
+				}
+				stolen = TRUE;
 			}
-			vmm_spin_unlock_irqrestore(&work->lock, flags);
 
-			if (do_work) {
-				work->func(work);
-				vmm_spin_lock_irqsave(&work->lock, flags);
-				work->flags &= ~VMM_WORK_STATE_INPROGRESS;
-				vmm_spin_unlock_irqrestore(&work->lock, flags);
+			if (!workqueue_process(pool, work, stolen)) {
+				break;
 			}
-
-			vmm_spin_lock_irqsave(&wq->lock, flags);
 		}
+	}
+
+	return VMM_OK;
+}
+
+static int workqueue_start_worker(struct vmm_workqueue *wq, u32 index,
+				  struct vmm_workqueue_pool *pool,
+				  const struct vmm_cpumask *affinity)
+{
+	int rc;
+	irq_flags_t flags;
+	char name[VMM_FIELD_NAME_SIZE];
+	struct vmm_workqueue_worker *wkr = &wq->workers[index];
+
+	/* Claim worker slot because secondary CPUs coming online
+	 * add their worker concurrently.
+	 */
+	vmm_spin_lock_irqsave(&wq->workers_lock, flags);
+	if (wkr->pool) {
+		vmm_spin_unlock_irqrestore(&wq->workers_lock, flags);
+		return VMM_EALREADY;
+	}
+	wkr->pool = pool;
+	vmm_spin_unlock_irqrestore(&wq->workers_lock, flags);
+
+	if (wq->flags & VMM_WORKQUEUE_PERCPU) {
+		vmm_snprintf(name, sizeof(name), "%s/%d", wq->name, index);
+	} else if (wq->flags & VMM_WORKQUEUE_UNBOUND) {
+		vmm_snprintf(name, sizeof(name), "%s/u%d", wq->name, index);
+	} else {
+		strlcpy(name, wq->name, sizeof(name));
+	}
 
-		vmm_spin_unlock_irqrestore(&wq->lock, flags);
+	wkr->thread = vmm_threads_create(name, workqueue_main, wkr,
+					 wq->priority,
+					 VMM_THREAD_DEF_TIME_SLICE);
+	if (!wkr->thread) {
+		rc = VMM_ENOMEM;
+		goto fail_release;
 	}
 
+	if ((rc = vmm_threads_start(wkr->thread))) {
+		goto fail;
+	}
+
+	if (affinity &&
+	    (rc = vmm_threads_set_affinity(wkr->thread, affinity))) {
+		vmm_threads_stop(wkr->thread);
+		goto fail;
+	}
+
+	/* Pool must be fully setup before others see it online */
+	arch_smp_wmb();
+	pool->online = TRUE;
+
+	vmm_spin_lock_irqsave(&wq->workers_lock, flags);
+	wq->nr_workers++;
+	vmm_spin_unlock_irqrestore(&wq->workers_lock, flags);
+
 	return VMM_OK;
+
+fail:
+	vmm_threads_destroy(wkr->thread);
+	wkr->thread = NULL;
+fail_release:
+	vmm_spin_lock_irqsave(&wq->workers_lock, flags);
+	wkr->pool = NULL;
+	vmm_spin_unlock_irqrestore(&wq->workers_lock, flags);
+	return rc;
 }
 
-struct vmm_workqueue *vmm_workqueue_create(const char *name, u8 priority)
+struct vmm_workqueue *vmm_workqueue_create_flags(const char *name,
+						 u8 priority, u32 flags)
 {
+	u32 c, i;
 	struct vmm_workqueue *wq;
-	irq_flags_t flags;
+	irq_flags_t f;
 
 	if (!name) {
 		return NULL;
 	}
+	if ((flags & VMM_WORKQUEUE_PERCPU) &&
+	    (flags & VMM_WORKQUEUE_UNBOUND)) {
+		return NULL;
+	}
 
 	wq = vmm_zalloc(sizeof(struct vmm_workqueue));
 	if (!wq) {
 		return NULL;
 	}
 
-	INIT_SPIN_LOCK(&wq->lock);
 	INIT_LIST_HEAD(&wq->head);
-	INIT_LIST_HEAD(&wq->work_list);
-	INIT_COMPLETION(&wq->work_avail);
+	strlcpy(wq->name, name, sizeof(wq->name));
+	wq->flags = flags;
+	wq->priority = priority;
+	INIT_SPIN_LOCK(&wq->workers_lock);
 
-	wq->thread = vmm_threads_create(name, workqueue_main, wq, 
-					priority, VMM_THREAD_DEF_TIME_SLICE);
-	if (!wq->thread) {
-		vmm_free(wq);
-		return NULL;
+	/* Per-CPU workqueues have one pool and worker per host CPU
+	 * whereas others have one shared pool.
+	 */
+	if (flags & VMM_WORKQUEUE_PERCPU) {
+		wq->nr_pools = CONFIG_CPU_COUNT;
+		wq->def_pool = vmm_smp_processor_id();
+	} else {
+		wq->nr_pools = 1;
+		wq->def_pool = 0;
+	}
+	wq->pools = vmm_zalloc(wq->nr_pools * sizeof(*wq->pools));
+	if (!wq->pools) {
+		goto fail_free_wq;
+	}
+	for (i = 0; i < wq->nr_pools; i++) {
+		INIT_SPIN_LOCK(&wq->pools[i].lock);
+		INIT_LIST_HEAD(&wq->pools[i].work_list);
+		INIT_COMPLETION(&wq->pools[i].work_avail);
+		wq->pools[i].wq = wq;
 	}
 
-	if (vmm_threads_start(wq->thread)) {
-		vmm_threads_destroy(wq->thread);
-		vmm_free(wq);
-		return NULL;
+	wq->max_workers =
+		(flags & (VMM_WORKQUEUE_PERCPU|VMM_WORKQUEUE_UNBOUND)) ?
+		CONFIG_CPU_COUNT : 1;
+	wq->workers = vmm_zalloc(wq->max_workers * sizeof(*wq->workers));
+	if (!wq->workers) {
+		goto fail_free_pools;
 	}
 
-	vmm_spin_lock_irqsave(&wqctrl.lock, flags);
+	if (flags & VMM_WORKQUEUE_PERCPU) {
+		for_each_cpu(c, cpu_online_mask) {
+			if (workqueue_start_worker(wq, c, &wq->pools[c],
+						   vmm_cpumask_of(c))) {
+				goto fail_stop_workers;
+			}
+		}
+	} else if (flags & VMM_WORKQUEUE_UNBOUND) {
+		for_each_cpu(c, cpu_online_mask) {
+			if (workqueue_start_worker(wq, c,
+						   &wq->pools[0], NULL)) {
+				goto fail_stop_workers;
+			}
+		}
+	} else {
+		if (workqueue_start_worker(wq, 0, &wq->pools[0], NULL)) {
+			goto fail_free_workers;
+		}
+	}
+
+	vmm_spin_lock_irqsave(&wqctrl.lock, f);
 
 	list_add_tail(&wq->head, &wqctrl.wq_list);
 	wqctrl.wq_count++;
 
-	vmm_spin_unlock_irqrestore(&wqctrl.lock, flags);
+	vmm_spin_unlock_irqrestore(&wqctrl.lock, f);
 
 	return wq;
+
+fail_stop_workers:
+	for (i = 0; i < wq->max_workers; i++) {
+		if (wq->workers[i].thread) {
+			vmm_threads_stop(wq->workers[i].thread);
+			vmm_threads_destroy(wq->workers[i].thread);
+		}
+	}
+fail_free_workers:
+	vmm_free(wq->workers);
+fail_free_pools:
+	vmm_free(wq->pools);
+fail_free_wq:
+	vmm_free(wq);
+	return NULL;
+}
+
+struct vmm_workqueue *vmm_workqueue_create(const char *name, u8 priority)
+{
+	return vmm_workqueue_create_flags(name, priority, 0);
 }
 
 int vmm_workqueue_destroy(struct vmm_workqueue *wq)
 {
 	int rc;
+	u32 i;
 	irq_flags_t flags;
 
 	if (!wq) {
@@ -396,8 +817,13 @@ int vmm_workqueue_destroy(struct vmm_workqueue *wq)
 		return rc;
 	}
 
-	if ((rc = vmm_threads_stop(wq->thread))) {
-		return rc;
+	for (i = 0; i < wq->max_workers; i++) {
+		if (!wq->workers[i].thread) {
+			continue;
+		}
+		if ((rc = vmm_threads_stop(wq->workers[i].thread))) {
+			return rc;
+		}
 	}
 
 	vmm_spin_lock_irqsave(&wqctrl.lock, flags);
@@ -407,6 +833,8 @@ int vmm_workqueue_destroy(struct vmm_workqueue *wq)
 
 	vmm_spin_unlock_irqrestore(&wqctrl.lock, flags);
 
+	vmm_free(wq->workers);
+	vmm_free(wq->pools);
 	vmm_free(wq);
 
 	return VMM_OK;
@@ -414,6 +842,8 @@ int vmm_workqueue_destroy(struct vmm_workqueue *wq)
 
 int __cpuinit vmm_workqueue_init(void)
 {
+	int rc, i, count;
+	struct vmm_workqueue *wq;
 	char syswq_name[VMM_FIELD_NAME_SIZE];
 	u32 cpu = vmm_smp_processor_id();
 
@@ -429,6 +859,30 @@ int __cpuinit vmm_workqueue_init(void)
 
 		/* Initialize workqueue count */
 		wqctrl.wq_count = 0;
+	} else {
+		/* Add worker for current CPU to per-CPU and unbound
+		 * workqueues created before this CPU came online.
+		 */
+		count = vmm_workqueue_count();
+		for (i = 0; i < count; i++) {
+			wq = vmm_workqueue_index2workqueue(i);
+			if (!wq) {
+				continue;
+			}
+			if (wq->flags & VMM_WORKQUEUE_PERCPU) {
+				rc = workqueue_start_worker(wq, cpu,
+						&wq->pools[cpu],
+						vmm_cpumask_of(cpu));
+			} else if (wq->flags & VMM_WORKQUEUE_UNBOUND) {
+				rc = workqueue_start_worker(wq, cpu,
+						&wq->pools[0], NULL);
+			} else {
+				continue;
+			}
+			if (rc && (rc != VMM_EALREADY)) {
+				return rc;
+			}
+		}
 	}
 
 	/* Create one system workqueue with thread priority
@@ -437,10 +891,27 @@ int __cpuinit vmm_workqueue_init(void)
 	vmm_snprintf(syswq_name, sizeof(syswq_name), "syswq/%d", cpu);
 	wqctrl.syswq[cpu] = vmm_workqueue_create(syswq_name,
 						 VMM_THREAD_DEF_PRIORITY);
-	if (!wqctrl.syswq) {
+	if (!wqctrl.syswq[cpu]) {
 		return VMM_EFAIL;
 	}
 
-	return vmm_threads_set_affinity(wqctrl.syswq[cpu]->thread,
-					vmm_cpumask_of(cpu));
+	rc = vmm_threads_set_affinity(wqctrl.syswq[cpu]->workers[0].thread,
+				      vmm_cpumask_of(cpu));
+	if (rc) {
+		return rc;
+	}
+
+	/* Create system-wide per-CPU workqueue on boot CPU, the
+	 * secondary CPUs add their worker above.
+	 */
+	if (vmm_smp_is_bootcpu()) {
+		wqctrl.syspwq = vmm_workqueue_create_flags("syspwq",
+						VMM_THREAD_DEF_PRIORITY,
+						VMM_WORKQUEUE_PERCPU);
+		if (!wqctrl.syspwq) {
+			return VMM_EFAIL;
+		}
+	}
+
+	return VMM_OK;
 }
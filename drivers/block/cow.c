@@ -0,0 +1,750 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file cow.c
+ * @author agent (agent@local)
+ * @brief Copy-on-write layered block device driver.
+ *
+ * A COW block device reads unmodified clusters from a read-only base
+ * block device and keeps modified clusters in an overlay block device
+ * (e.g. a loop device) using two level cluster tables similar to
+ * qcow2. First write to a cluster copies it up from base to a newly
+ * allocated overlay cluster. This allows many guests to share one
+ * golden image while storing only their deltas.
+ *
+ * All requests are served by the request queue thread so metadata
+ * updates are serialized. Each request holds the instance lock so
+ * that unregistering base or overlay block device detaches the COW
+ * instance and later requests fail instead of using stale devices.
+ *
+ * Overlay cache is flushed after writing a new cluster and before
+ * writing the table entry which maps it, so a crash can only leak
+ * clusters and never exposes unwritten clusters.
+ */
+
+#include <vmm_error.h>
+#include <vmm_heap.h>
+#include <vmm_mutex.h>
+#include <vmm_host_io.h>
+#include <vmm_modules.h>
+#include <block/vmm_blockrq.h>
+#include <libs/mathlib.h>
+#include <libs/stringlib.h>
+#include <drv/cow.h>
+
+#define MODULE_DESC			"Copy-on-write Block Driver"
+#define MODULE_AUTHOR			"agent"
+#define MODULE_LICENSE			"GPL"
+#define MODULE_IPRIORITY		(COW_IPRIORITY)
+#define	MODULE_INIT			cow_driver_init
+#define	MODULE_EXIT			cow_driver_exit
+
+#define COW_MAX_PENDING			32
+
+static LIST_HEAD(cow_list);
+static DEFINE_MUTEX(cow_list_lock);
+static struct vmm_notifier_block cow_blk_client;
+
+static int cow_dev_rw(struct vmm_blockdev *bdev, bool write,
+		      u64 off, void *buf, u64 len)
+{
+	u64 ret;
+
+	if (write) {
+		ret = vmm_blockdev_write(bdev, buf, off, len);
+	} else {
+		ret = vmm_blockdev_read(bdev, buf, off, len);
+	}
+
+	return (ret == len) ? VMM_OK : VMM_EIO;
+}
+
+static int cow_write_header(struct vmm_blockdev *overlay,
+			    struct cow_header *hdr)
+{
+	struct cow_header h;
+
+	memcpy(&h, hdr, sizeof(h));
+	h.magic = vmm_cpu_to_le32(hdr->magic);
+	h.version = vmm_cpu_to_le32(hdr->version);
+	h.cluster_bits = vmm_cpu_to_le32(hdr->cluster_bits);
+	h.l1_size = vmm_cpu_to_le32(hdr->l1_size);
+	h.size = vmm_cpu_to_le64(hdr->size);
+	h.l1_offset = vmm_cpu_to_le64(hdr->l1_offset);
+	h.next_free = vmm_cpu_to_le64(hdr->next_free);
+
+	return cow_dev_rw(overlay, TRUE, 0, &h, sizeof(h));
+}
+
+static int cow_read_header(struct vmm_blockdev *overlay,
+			   struct cow_header *hdr)
+{
+	int rc;
+
+	rc = cow_dev_rw(overlay, FALSE, 0, hdr, sizeof(*hdr));
+	if (rc) {
+		return rc;
+	}
+
+	hdr->magic = vmm_le32_to_cpu(hdr->magic);
+	hdr->version = vmm_le32_to_cpu(hdr->version);
+	hdr->cluster_bits = vmm_le32_to_cpu(hdr->cluster_bits);
+	hdr->l1_size = vmm_le32_to_cpu(hdr->l1_size);
+	hdr->size = vmm_le64_to_cpu(hdr->size);
+	hdr->l1_offset = vmm_le64_to_cpu(hdr->l1_offset);
+	hdr->next_free = vmm_le64_to_cpu(hdr->next_free);
+	hdr->base_name[sizeof(hdr->base_name) - 1] = '\0';
+
+	return VMM_OK;
+}
+
+/* Allocate new cluster at end of overlay
+ * Note: Header is updated before cluster is used and callers
+ * flush overlay before mapping the cluster so a crash can only
+ * leak the cluster.
+ */
+static int cow_alloc_cluster(struct cow *c, u64 *off)
+{
+	int rc;
+
+	if (c->overlay_size < (c->hdr.next_free + c->cluster_size)) {
+		return VMM_ENOSPC;
+	}
+
+	*off = c->hdr.next_free;
+	c->hdr.next_free += c->cluster_size;
+	rc = cow_write_header(c->overlay, &c->hdr);
+	if (rc) {
+		c->hdr.next_free -= c->cluster_size;
+		return rc;
+	}
+	c->allocated++;
+
+	return VMM_OK;
+}
+
+/* Check table entry for zero or allocated overlay cluster */
+static bool cow_valid_cluster(struct cow *c, u64 off)
+{
+	if (!off) {
+		return TRUE;
+	}
+
+	return (c->hdr.l1_offset < off) && (off < c->hdr.next_free) &&
+		!(off & (c->cluster_size - 1));
+}
+
+/* Get cached L2 table for given L1 index
+ * Note: L2 table is allocated only if alloc is TRUE
+ */
+static int cow_l2_table(struct cow *c, u32 l1_idx, bool alloc, u64 **table)
+{
+	int rc;
+	u32 i, victim = 0;
+	u64 e, l2_off = c->l1[l1_idx];
+	struct cow_l2 *l2;
+
+	*table = NULL;
+
+	if (l2_off) {
+		for (i = 0; i < COW_L2_CACHE_SIZE; i++) {
+			l2 = &c->l2_cache[i];
+			if (l2->offset == l2_off) {
+				l2->last_used = ++c->l2_tick;
+				*table = l2->table;
+				return VMM_OK;
+			}
+		}
+	} else if (!alloc) {
+		return VMM_OK;
+	}
+
+	/* Recycle least recently used L2 table */
+	for (i = 1; i < COW_L2_CACHE_SIZE; i++) {
+		if (c->l2_cache[i].last_used <
+		    c->l2_cache[victim].last_used) {
+			victim = i;
+		}
+	}
+	l2 = &c->l2_cache[victim];
+	l2->offset = 0;
+	l2->last_used = 0;
+
+	if (l2_off) {
+		rc = cow_dev_rw(c->overlay, FALSE, l2_off,
+				l2->table, c->cluster_size);
+		if (rc) {
+			return rc;
+		}
+		for (i = 0; i < (c->cluster_size >> 3); i++) {
+			l2->table[i] = vmm_le64_to_cpu(l2->table[i]);
+			if (!cow_valid_cluster(c, l2->table[i])) {
+				return VMM_EINVALID;
+			}
+		}
+	} else {
+		rc = cow_alloc_cluster(c, &l2_off);
+		if (rc) {
+			return rc;
+		}
+		memset(l2->table, 0, c->cluster_size);
+		rc = cow_dev_rw(c->overlay, TRUE, l2_off,
+				l2->table, c->cluster_size);
+		if (rc) {
+			return rc;
+		}
+		rc = vmm_blockdev_flush_cache(c->overlay);
+		if (rc) {
+			return rc;
+		}
+		e = vmm_cpu_to_le64(l2_off);
+		rc = cow_dev_rw(c->overlay, TRUE,
+				c->hdr.l1_offset + (u64)l1_idx * sizeof(u64),
+				&e, sizeof(e));
+		if (rc) {
+			return rc;
+		}
+		c->l1[l1_idx] = l2_off;
+	}
+
+	l2->offset = l2_off;
+	l2->last_used = ++c->l2_tick;
+	*table = l2->table;
+
+	return VMM_OK;
+}
+
+/* Copy-up given virtual cluster with new data and map it */
+static int cow_copyup(struct cow *c, u64 vcl, u64 *l2_table, u32 l2_idx,
+		      u32 coff, u32 clen, const u8 *buf)
+{
+	int rc;
+	u64 e, cstart, cvalid, hoff;
+
+	cstart = vcl << c->hdr.cluster_bits;
+	cvalid = c->hdr.size - cstart;
+	if (c->cluster_size < cvalid) {
+		cvalid = c->cluster_size;
+	}
+
+	/* Fully overwritten cluster need not be read from base */
+	if (coff || (clen < cvalid)) {
+		rc = cow_dev_rw(c->base, FALSE, cstart,
+				c->cluster_buf, cvalid);
+		if (rc) {
+			return rc;
+		}
+		c->copyups++;
+	}
+	if (cvalid < c->cluster_size) {
+		memset(c->cluster_buf + cvalid, 0, c->cluster_size - cvalid);
+	}
+	memcpy(c->cluster_buf + coff, buf, clen);
+
+	rc = cow_alloc_cluster(c, &hoff);
+	if (rc) {
+		return rc;
+	}
+	rc = cow_dev_rw(c->overlay, TRUE, hoff,
+			c->cluster_buf, c->cluster_size);
+	if (rc) {
+		return rc;
+	}
+	rc = vmm_blockdev_flush_cache(c->overlay);
+	if (rc) {
+		return rc;
+	}
+
+	/* Map cluster only after its contents are in overlay */
+	e = vmm_cpu_to_le64(hoff);
+	rc = cow_dev_rw(c->overlay, TRUE,
+			c->l1[vcl >> c->l2_bits] + (u64)l2_idx * sizeof(u64),
+			&e, sizeof(e));
+	if (rc) {
+		return rc;
+	}
+	l2_table[l2_idx] = hoff;
+
+	return VMM_OK;
+}
+
+static int cow_rw_request(struct cow *c, struct vmm_request *r, bool write)
+{
+	int rc;
+	u8 *buf = r->data;
+	u32 l1_idx, l2_idx, coff, clen;
+	u64 vcl, hoff, *l2_table;
+	u64 off = r->lba * c->bdev->block_size;
+	u64 len = (u64)r->bcnt * c->bdev->block_size;
+
+	while (len) {
+		vcl = off >> c->hdr.cluster_bits;
+		coff = off - (vcl << c->hdr.cluster_bits);
+		clen = c->cluster_size - coff;
+		if (len < clen) {
+			clen = len;
+		}
+		l1_idx = vcl >> c->l2_bits;
+		l2_idx = vcl & ((1ULL << c->l2_bits) - 1);
+
+		rc = cow_l2_table(c, l1_idx, write, &l2_table);
+		if (rc) {
+			return rc;
+		}
+		hoff = (l2_table) ? l2_table[l2_idx] : 0;
+
+		if (hoff) {
+			rc = cow_dev_rw(c->overlay, write,
+					hoff + coff, buf, clen);
+		} else if (write) {
+			rc = cow_copyup(c, vcl, l2_table, l2_idx,
+					coff, clen, buf);
+		} else {
+			rc = cow_dev_rw(c->base, FALSE, off, buf, clen);
+		}
+		if (rc) {
+			return rc;
+		}
+
+		buf += clen;
+		off += clen;
+		len -= clen;
+	}
+
+	return VMM_OK;
+}
+
+static int cow_read_request(struct vmm_blockrq *brq,
+			    struct vmm_request *r, void *priv)
+{
+	int rc = VMM_EIO;
+	struct cow *c = priv;
+
+	vmm_mutex_lock(&c->lock);
+	if (!c->detached) {
+		rc = cow_rw_request(c, r, FALSE);
+	}
+	vmm_mutex_unlock(&c->lock);
+
+	return rc;
+}
+
+static int cow_write_request(struct vmm_blockrq *brq,
+			     struct vmm_request *r, void *priv)
+{
+	int rc = VMM_EIO;
+	struct cow *c = priv;
+
+	vmm_mutex_lock(&c->lock);
+	if (!c->detached) {
+		rc = cow_rw_request(c, r, TRUE);
+	}
+	vmm_mutex_unlock(&c->lock);
+
+	return rc;
+}
+
+static void cow_flush(struct vmm_blockrq *brq, void *priv)
+{
+	struct cow *c = priv;
+
+	vmm_mutex_lock(&c->lock);
+	if (!c->detached) {
+		vmm_blockdev_flush_cache(c->overlay);
+	}
+	vmm_mutex_unlock(&c->lock);
+}
+
+int cow_format(struct vmm_blockdev *overlay,
+	       struct vmm_blockdev *base,
+	       u32 cluster_bits)
+{
+	int rc;
+	u8 *l1;
+	u64 l1_bytes, clusters, l2_entries;
+	struct cow_header hdr;
+
+	if (!overlay || !base || (overlay == base) ||
+	    !(overlay->flags & VMM_BLOCKDEV_RW) ||
+	    (cluster_bits < COW_MIN_CLUSTER_BITS) ||
+	    (COW_MAX_CLUSTER_BITS < cluster_bits)) {
+		return VMM_EINVALID;
+	}
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.magic = COW_MAGIC;
+	hdr.version = COW_VERSION;
+	hdr.cluster_bits = cluster_bits;
+	hdr.size = base->num_blocks * base->block_size;
+	strncpy(hdr.base_name, base->name, sizeof(hdr.base_name) - 1);
+
+	clusters = (hdr.size + (1ULL << cluster_bits) - 1) >> cluster_bits;
+	l2_entries = (1ULL << cluster_bits) / sizeof(u64);
+	hdr.l1_size = udiv64(clusters + l2_entries - 1, l2_entries);
+	l1_bytes = (u64)hdr.l1_size * sizeof(u64);
+
+	/* Header in cluster 0 followed by L1 table */
+	hdr.l1_offset = 1ULL << cluster_bits;
+	hdr.next_free = hdr.l1_offset +
+		(((l1_bytes + (1ULL << cluster_bits) - 1) >> cluster_bits)
+							<< cluster_bits);
+	if ((overlay->num_blocks * overlay->block_size) < hdr.next_free) {
+		return VMM_ENOSPC;
+	}
+
+	l1 = vmm_zalloc(l1_bytes);
+	if (!l1) {
+		return VMM_ENOMEM;
+	}
+	rc = cow_dev_rw(overlay, TRUE, hdr.l1_offset, l1, l1_bytes);
+	vmm_free(l1);
+	if (rc) {
+		return rc;
+	}
+
+	rc = cow_write_header(overlay, &hdr);
+	if (rc) {
+		return rc;
+	}
+
+	return vmm_blockdev_flush_cache(overlay);
+}
+VMM_EXPORT_SYMBOL(cow_format);
+
+int cow_check_header(const struct cow_header *hdr,
+		     u64 base_size, u64 overlay_size)
+{
+	u64 csize, clusters, l2_entries, l1_bytes;
+
+	if (!hdr ||
+	    (hdr->magic != COW_MAGIC) ||
+	    (hdr->version != COW_VERSION) ||
+	    (hdr->cluster_bits < COW_MIN_CLUSTER_BITS) ||
+	    (COW_MAX_CLUSTER_BITS < hdr->cluster_bits) ||
+	    (hdr->size != base_size) || !hdr->l1_size) {
+		return VMM_EINVALID;
+	}
+
+	csize = 1ULL << hdr->cluster_bits;
+	clusters = (hdr->size + csize - 1) >> hdr->cluster_bits;
+	l2_entries = csize / sizeof(u64);
+	if (hdr->l1_size != udiv64(clusters + l2_entries - 1, l2_entries)) {
+		return VMM_EINVALID;
+	}
+
+	/* L1 table must be between header and first free cluster */
+	l1_bytes = (u64)hdr->l1_size * sizeof(u64);
+	if ((hdr->l1_offset < csize) || (hdr->l1_offset & (csize - 1)) ||
+	    (hdr->next_free & (csize - 1)) ||
+	    (overlay_size < hdr->next_free) ||
+	    (hdr->next_free < hdr->l1_offset) ||
+	    ((hdr->next_free - hdr->l1_offset) < l1_bytes)) {
+		return VMM_EINVALID;
+	}
+
+	return VMM_OK;
+}
+VMM_EXPORT_SYMBOL(cow_check_header);
+
+static void cow_free(struct cow *c)
+{
+	u32 i;
+
+	for (i = 0; i < COW_L2_CACHE_SIZE; i++) {
+		if (c->l2_cache[i].table) {
+			vmm_free(c->l2_cache[i].table);
+		}
+	}
+	if (c->cluster_buf) {
+		vmm_free(c->cluster_buf);
+	}
+	if (c->l1) {
+		vmm_free(c->l1);
+	}
+	vmm_free(c);
+}
+
+struct cow *cow_create(const char *name,
+		       struct vmm_blockdev *base,
+		       struct vmm_blockdev *overlay)
+{
+	u32 i;
+	struct cow *c;
+	struct vmm_blockrq *brq;
+
+	if (!name || !base || !overlay || (base == overlay)) {
+		return NULL;
+	}
+
+	c = vmm_zalloc(sizeof(struct cow));
+	if (!c) {
+		goto free_nothing;
+	}
+	INIT_LIST_HEAD(&c->head);
+	INIT_MUTEX(&c->lock);
+	c->detached = FALSE;
+	c->base = base;
+	c->overlay = overlay;
+	c->overlay_size = overlay->num_blocks * overlay->block_size;
+
+	/* Validate overlay header against base */
+	if (cow_read_header(overlay, &c->hdr) ||
+	    cow_check_header(&c->hdr, base->num_blocks * base->block_size,
+			     c->overlay_size)) {
+		goto free_cow;
+	}
+	c->cluster_size = 1U << c->hdr.cluster_bits;
+	c->l2_bits = c->hdr.cluster_bits - 3;
+
+	/* Load L1 table */
+	c->l1 = vmm_malloc((u64)c->hdr.l1_size * sizeof(u64));
+	if (!c->l1) {
+		goto free_cow;
+	}
+	if (cow_dev_rw(overlay, FALSE, c->hdr.l1_offset, c->l1,
+		       (u64)c->hdr.l1_size * sizeof(u64))) {
+		goto free_cow;
+	}
+	for (i = 0; i < c->hdr.l1_size; i++) {
+		c->l1[i] = vmm_le64_to_cpu(c->l1[i]);
+		if (!cow_valid_cluster(c, c->l1[i])) {
+			goto free_cow;
+		}
+	}
+
+	/* Allocate L2 table cache and copy-up buffer */
+	for (i = 0; i < COW_L2_CACHE_SIZE; i++) {
+		c->l2_cache[i].table = vmm_malloc(c->cluster_size);
+		if (!c->l2_cache[i].table) {
+			goto free_cow;
+		}
+	}
+	c->cluster_buf = vmm_malloc(c->cluster_size);
+	if (!c->cluster_buf) {
+		goto free_cow;
+	}
+
+	c->bdev = vmm_blockdev_alloc();
+	if (!c->bdev) {
+		goto free_cow;
+	}
+
+	/* Setup block device instance */
+	strncpy(c->bdev->name, name, VMM_FIELD_NAME_SIZE);
+	strncpy(c->bdev->desc, "Copy-on-write block device",
+		VMM_FIELD_DESC_SIZE);
+	c->bdev->dev.parent = NULL;
+	c->bdev->flags = (overlay->flags & VMM_BLOCKDEV_RW) ?
+			 VMM_BLOCKDEV_RW : VMM_BLOCKDEV_RDONLY;
+	c->bdev->start_lba = 0;
+	c->bdev->num_blocks = base->num_blocks;
+	c->bdev->block_size = base->block_size;
+
+	/* Setup request queue for block device instance */
+	brq = vmm_blockrq_create(name, COW_MAX_PENDING, FALSE,
+				 cow_read_request,
+				 cow_write_request,
+				 NULL, cow_flush, c);
+	if (!brq) {
+		goto free_bdev;
+	}
+	c->bdev->rq = vmm_blockrq_to_rq(brq);
+
+	/* Merge sequential requests to reduce table lookups */
+	vmm_blockrq_set_sched(brq, VMM_BLOCKRQ_SCHED_DEADLINE,
+			      VMM_BLOCKRQ_DEFAULT_MAX_MERGE_BYTES);
+
+	/* Register block device instance */
+	if (vmm_blockdev_register(c->bdev)) {
+		goto free_bdev_rq;
+	}
+
+	/* Add to list of COW instances */
+	vmm_mutex_lock(&cow_list_lock);
+	list_add_tail(&c->head, &cow_list);
+	vmm_mutex_unlock(&cow_list_lock);
+
+	return c;
+
+free_bdev_rq:
+	vmm_blockrq_destroy(vmm_rq_to_blockrq(c->bdev->rq));
+free_bdev:
+	vmm_blockdev_free(c->bdev);
+free_cow:
+	cow_free(c);
+free_nothing:
+	return NULL;
+}
+VMM_EXPORT_SYMBOL(cow_create);
+
+void cow_destroy(struct cow *c)
+{
+	/* Sanity check */
+	if (!c) {
+		return;
+	}
+
+	/* Remove from list of COW instances */
+	vmm_mutex_lock(&cow_list_lock);
+	list_del(&c->head);
+	vmm_mutex_unlock(&cow_list_lock);
+
+	/* Unregister block device */
+	vmm_blockdev_unregister(c->bdev);
+
+	/* Free block device request queue */
+	vmm_blockrq_destroy(vmm_rq_to_blockrq(c->bdev->rq));
+
+	/* Free block device */
+	vmm_blockdev_free(c->bdev);
+
+	/* Write back overlay contents */
+	if (!c->detached) {
+		vmm_blockdev_flush_cache(c->overlay);
+	}
+
+	/* Free COW instance */
+	cow_free(c);
+}
+VMM_EXPORT_SYMBOL(cow_destroy);
+
+struct cow *cow_find(const char *name)
+{
+	struct cow *c, *ret = NULL;
+
+	if (!name) {
+		return NULL;
+	}
+
+	vmm_mutex_lock(&cow_list_lock);
+
+	list_for_each_entry(c, &cow_list, head) {
+		if (strcmp(c->bdev->name, name) == 0) {
+			ret = c;
+			break;
+		}
+	}
+
+	vmm_mutex_unlock(&cow_list_lock);
+
+	return ret;
+}
+VMM_EXPORT_SYMBOL(cow_find);
+
+struct cow *cow_get(int index)
+{
+	struct cow *c, *ret = NULL;
+
+	if (index < 0) {
+		return NULL;
+	}
+
+	vmm_mutex_lock(&cow_list_lock);
+
+	list_for_each_entry(c, &cow_list, head) {
+		if (!index) {
+			ret = c;
+			break;
+		}
+		index--;
+	}
+
+	vmm_mutex_unlock(&cow_list_lock);
+
+	return ret;
+}
+VMM_EXPORT_SYMBOL(cow_get);
+
+u32 cow_count(void)
+{
+	u32 ret = 0;
+	struct cow *c;
+
+	vmm_mutex_lock(&cow_list_lock);
+
+	list_for_each_entry(c, &cow_list, head) {
+		ret++;
+	}
+
+	vmm_mutex_unlock(&cow_list_lock);
+
+	return ret;
+}
+VMM_EXPORT_SYMBOL(cow_count);
+
+static int cow_blk_notification(struct vmm_notifier_block *nb,
+				unsigned long evt, void *data)
+{
+	struct cow *c;
+	struct vmm_blockdev_event *e = data;
+
+	if (evt != VMM_BLOCKDEV_EVENT_UNREGISTER) {
+		/* We are only interested in unregister events so,
+		 * don't care about this event.
+		 */
+		return NOTIFY_DONE;
+	}
+
+	vmm_mutex_lock(&cow_list_lock);
+
+	/* Detach COW instances using block device */
+	list_for_each_entry(c, &cow_list, head) {
+		vmm_mutex_lock(&c->lock);
+		if ((c->base == e->bdev) || (c->overlay == e->bdev)) {
+			c->detached = TRUE;
+		}
+		vmm_mutex_unlock(&c->lock);
+	}
+
+	vmm_mutex_unlock(&cow_list_lock);
+
+	return NOTIFY_OK;
+}
+
+static int __init cow_driver_init(void)
+{
+	cow_blk_client.notifier_call = &cow_blk_notification;
+	cow_blk_client.priority = 0;
+
+	return vmm_blockdev_register_client(&cow_blk_client);
+}
+
+static void __exit cow_driver_exit(void)
+{
+	struct cow *c;
+
+	vmm_blockdev_unregister_client(&cow_blk_client);
+
+	while (1) {
+		vmm_mutex_lock(&cow_list_lock);
+		c = list_empty(&cow_list) ? NULL :
+		    list_first_entry(&cow_list, struct cow, head);
+		vmm_mutex_unlock(&cow_list_lock);
+		if (!c) {
+			break;
+		}
+		cow_destroy(c);
+	}
+}
+
+VMM_DECLARE_MODULE(MODULE_DESC,
+			MODULE_AUTHOR,
+			MODULE_LICENSE,
+			MODULE_IPRIORITY,
+			MODULE_INIT,
+			MODULE_EXIT);
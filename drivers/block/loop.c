@@ -0,0 +1,325 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file loop.c
+ * @author agent (agent@local)
+ * @brief File backed (loop) block device driver.
+ *
+ * A loop block device exposes a regular file of any mounted VFS
+ * filesystem as block device. Block requests are served by the
+ * request queue thread using VFS file operations so submitters never
+ * block. Adjacent requests are merged by the request queue so that
+ * sequential guest IO becomes large file reads/writes.
+ */
+
+#include <vmm_error.h>
+#include <vmm_heap.h>
+#include <vmm_mutex.h>
+#include <vmm_modules.h>
+#include <block/vmm_blockrq.h>
+#include <libs/mathlib.h>
+#include <libs/stringlib.h>
+#include <drv/loop.h>
+
+#define MODULE_DESC			"File Backed Block Driver"
+#define MODULE_AUTHOR			"agent"
+#define MODULE_LICENSE			"GPL"
+#define MODULE_IPRIORITY		(LOOP_IPRIORITY)
+#define	MODULE_INIT			loop_driver_init
+#define	MODULE_EXIT			loop_driver_exit
+
+#define LOOP_MAX_PENDING		32
+
+static LIST_HEAD(loop_list);
+static DEFINE_MUTEX(loop_list_lock);
+
+static int loop_file_rw(struct loop *l, bool write,
+			u64 off, u8 *buf, u64 len)
+{
+	int rc = VMM_OK;
+	size_t cnt;
+
+	vmm_mutex_lock(&l->fd_lock);
+
+	if (vfs_lseek(l->fd, off, SEEK_SET) != (loff_t)off) {
+		rc = VMM_EIO;
+		goto done;
+	}
+
+	while (len) {
+		if (write) {
+			cnt = vfs_write(l->fd, buf, len);
+		} else {
+			cnt = vfs_read(l->fd, buf, len);
+		}
+		if (!cnt) {
+			rc = VMM_EIO;
+			break;
+		}
+		buf += cnt;
+		len -= cnt;
+	}
+
+done:
+	vmm_mutex_unlock(&l->fd_lock);
+
+	return rc;
+}
+
+static int loop_read_request(struct vmm_blockrq *brq,
+			     struct vmm_request *r, void *priv)
+{
+	struct loop *l = priv;
+
+	return loop_file_rw(l, FALSE, r->lba * LOOP_BLOCK_SIZE,
+			    r->data, (u64)r->bcnt * LOOP_BLOCK_SIZE);
+}
+
+static int loop_write_request(struct vmm_blockrq *brq,
+			      struct vmm_request *r, void *priv)
+{
+	struct loop *l = priv;
+
+	return loop_file_rw(l, TRUE, r->lba * LOOP_BLOCK_SIZE,
+			    r->data, (u64)r->bcnt * LOOP_BLOCK_SIZE);
+}
+
+static void loop_flush(struct vmm_blockrq *brq, void *priv)
+{
+	struct loop *l = priv;
+
+	vmm_mutex_lock(&l->fd_lock);
+	vfs_fsync(l->fd);
+	vmm_mutex_unlock(&l->fd_lock);
+}
+
+struct loop *loop_create(const char *name,
+			 const char *path,
+			 bool read_only)
+{
+	int rc;
+	struct loop *l;
+	struct stat st;
+	struct vmm_blockrq *brq;
+
+	if (!name || !path) {
+		return NULL;
+	}
+
+	l = vmm_zalloc(sizeof(struct loop));
+	if (!l) {
+		goto free_nothing;
+	}
+	INIT_LIST_HEAD(&l->head);
+	strncpy(l->path, path, sizeof(l->path));
+	l->path[sizeof(l->path) - 1] = '\0';
+	l->read_only = read_only;
+	INIT_MUTEX(&l->fd_lock);
+
+	/* Open backing file */
+	l->fd = vfs_open(path, (read_only) ? O_RDONLY : O_RDWR, 0);
+	if (l->fd < 0) {
+		goto free_loop;
+	}
+	rc = vfs_fstat(l->fd, &st);
+	if (rc || !(st.st_mode & S_IFREG)) {
+		goto close_file;
+	}
+	l->size = udiv64(st.st_size, LOOP_BLOCK_SIZE) * LOOP_BLOCK_SIZE;
+	if (!l->size) {
+		goto close_file;
+	}
+
+	l->bdev = vmm_blockdev_alloc();
+	if (!l->bdev) {
+		goto close_file;
+	}
+
+	/* Setup block device instance */
+	strncpy(l->bdev->name, name, VMM_FIELD_NAME_SIZE);
+	strncpy(l->bdev->desc, "File backed block device",
+		VMM_FIELD_DESC_SIZE);
+	l->bdev->dev.parent = NULL;
+	l->bdev->flags = (read_only) ? VMM_BLOCKDEV_RDONLY : VMM_BLOCKDEV_RW;
+	l->bdev->start_lba = 0;
+	l->bdev->num_blocks = udiv64(l->size, LOOP_BLOCK_SIZE);
+	l->bdev->block_size = LOOP_BLOCK_SIZE;
+
+	/* Setup request queue for block device instance */
+	brq = vmm_blockrq_create(name, LOOP_MAX_PENDING, FALSE,
+				 loop_read_request,
+				 loop_write_request,
+				 NULL, loop_flush, l);
+	if (!brq) {
+		goto free_bdev;
+	}
+	l->bdev->rq = vmm_blockrq_to_rq(brq);
+
+	/* Merge sequential requests into large file operations */
+	vmm_blockrq_set_sched(brq, VMM_BLOCKRQ_SCHED_DEADLINE,
+			      VMM_BLOCKRQ_MAX_MERGE_BYTES);
+
+	/* Register block device instance */
+	if (vmm_blockdev_register(l->bdev)) {
+		goto free_bdev_rq;
+	}
+
+	/* Add to list of loop instances */
+	vmm_mutex_lock(&loop_list_lock);
+	list_add_tail(&l->head, &loop_list);
+	vmm_mutex_unlock(&loop_list_lock);
+
+	return l;
+
+free_bdev_rq:
+	vmm_blockrq_destroy(vmm_rq_to_blockrq(l->bdev->rq));
+free_bdev:
+	vmm_blockdev_free(l->bdev);
+close_file:
+	vfs_close(l->fd);
+free_loop:
+	vmm_free(l);
+free_nothing:
+	return NULL;
+}
+VMM_EXPORT_SYMBOL(loop_create);
+
+void loop_destroy(struct loop *l)
+{
+	/* Sanity check */
+	if (!l) {
+		return;
+	}
+
+	/* Remove from list of loop instances */
+	vmm_mutex_lock(&loop_list_lock);
+	list_del(&l->head);
+	vmm_mutex_unlock(&loop_list_lock);
+
+	/* Unregister block device */
+	vmm_blockdev_unregister(l->bdev);
+
+	/* Free block device request queue */
+	vmm_blockrq_destroy(vmm_rq_to_blockrq(l->bdev->rq));
+
+	/* Free block device */
+	vmm_blockdev_free(l->bdev);
+
+	/* Sync and close backing file */
+	if (!l->read_only) {
+		vfs_fsync(l->fd);
+	}
+	vfs_close(l->fd);
+
+	/* Free loop instance */
+	vmm_free(l);
+}
+VMM_EXPORT_SYMBOL(loop_destroy);
+
+struct loop *loop_find(const char *name)
+{
+	struct loop *l, *ret = NULL;
+
+	if (!name) {
+		return NULL;
+	}
+
+	vmm_mutex_lock(&loop_list_lock);
+
+	list_for_each_entry(l, &loop_list, head) {
+		if (strcmp(l->bdev->name, name) == 0) {
+			ret = l;
+			break;
+		}
+	}
+
+	vmm_mutex_unlock(&loop_list_lock);
+
+	return ret;
+}
+VMM_EXPORT_SYMBOL(loop_find);
+
+struct loop *loop_get(int index)
+{
+	struct loop *l, *ret = NULL;
+
+	if (index < 0) {
+		return NULL;
+	}
+
+	vmm_mutex_lock(&loop_list_lock);
+
+	list_for_each_entry(l, &loop_list, head) {
+		if (!index) {
+			ret = l;
+			break;
+		}
+		index--;
+	}
+
+	vmm_mutex_unlock(&loop_list_lock);
+
+	return ret;
+}
+VMM_EXPORT_SYMBOL(loop_get);
+
+u32 loop_count(void)
+{
+	u32 ret = 0;
+	struct loop *l;
+
+	vmm_mutex_lock(&loop_list_lock);
+
+	list_for_each_entry(l, &loop_list, head) {
+		ret++;
+	}
+
+	vmm_mutex_unlock(&loop_list_lock);
+
+	return ret;
+}
+VMM_EXPORT_SYMBOL(loop_count);
+
+static int __init loop_driver_init(void)
+{
+	/* Nothing to do here. */
+	return VMM_OK;
+}
+
+static void __exit loop_driver_exit(void)
+{
+	struct loop *l;
+
+	while (1) {
+		vmm_mutex_lock(&loop_list_lock);
+		l = list_empty(&loop_list) ? NULL :
+		    list_first_entry(&loop_list, struct loop, head);
+		vmm_mutex_unlock(&loop_list_lock);
+		if (!l) {
+			break;
+		}
+		loop_destroy(l);
+	}
+}
+
+VMM_DECLARE_MODULE(MODULE_DESC,
+			MODULE_AUTHOR,
+			MODULE_LICENSE,
+			MODULE_IPRIORITY,
+			MODULE_INIT,
+			MODULE_EXIT);
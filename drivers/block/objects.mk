@@ -23,5 +23,7 @@
 
 drivers-objs-$(CONFIG_BLOCK_RBD)+= block/rbd.o
 drivers-objs-$(CONFIG_BLOCK_INITRD)+= block/initrd.o
+drivers-objs-$(CONFIG_BLOCK_LOOP)+= block/loop.o
+drivers-objs-$(CONFIG_BLOCK_COW)+= block/cow.o
 drivers-objs-$(CONFIG_BLOCK_VIRTIO_HOST)+= block/virtio_host_blk.o
 
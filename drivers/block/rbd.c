@@ -73,6 +73,22 @@ static int rbd_write_request(struct vmm_blockrq *brq,
 	return VMM_OK;
 }
 
+static int rbd_zero_request(struct vmm_blockrq *brq,
+			    struct vmm_request *r, void *priv)
+{
+	struct rbd *d = priv;
+	physical_addr_t pa;
+	physical_size_t sz;
+
+	pa = d->addr + r->lba * RBD_BLOCK_SIZE;
+	sz = r->bcnt * RBD_BLOCK_SIZE;
+
+	/* Discarded blocks also read back as zeros */
+	vmm_host_memory_set(pa, 0, sz, TRUE);
+
+	return VMM_OK;
+}
+
 static struct rbd *__rbd_create(struct vmm_device *dev,
 				const char *name,
 				physical_addr_t pa,
@@ -105,7 +121,8 @@ static struct rbd *__rbd_create(struct vmm_device *dev,
 	strncpy(d->bdev->desc, "RAM backed block device",
 		VMM_FIELD_DESC_SIZE);
 	d->bdev->dev.parent = dev;
-	d->bdev->flags = VMM_BLOCKDEV_RW;
+	d->bdev->flags = VMM_BLOCKDEV_RW | VMM_BLOCKDEV_DISCARD |
+			 VMM_BLOCKDEV_WRITE_ZEROES | VMM_BLOCKDEV_FUA;
 	d->bdev->start_lba = 0;
 	d->bdev->num_blocks = udiv64(d->size, RBD_BLOCK_SIZE);
 	d->bdev->block_size = RBD_BLOCK_SIZE;
@@ -120,6 +137,10 @@ static struct rbd *__rbd_create(struct vmm_device *dev,
 	}
 	d->bdev->rq = vmm_blockrq_to_rq(brq);
 
+	/* RAM access has no seek cost so neither reorder nor merge */
+	vmm_blockrq_set_sched(brq, VMM_BLOCKRQ_SCHED_NOOP, 0);
+	vmm_blockrq_set_discard_ops(brq, rbd_zero_request, rbd_zero_request);
+
 	/* Register block device instance */
 	if (vmm_blockdev_register(d->bdev)) {
 		goto free_bdev_rq;
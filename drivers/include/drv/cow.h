@@ -0,0 +1,133 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file cow.h
+ * @author agent (agent@local)
+ * @brief Interface for copy-on-write layered block device driver.
+ */
+
+#ifndef __COW_H_
+#define __COW_H_
+
+#include <vmm_limits.h>
+#include <vmm_types.h>
+#include <vmm_mutex.h>
+#include <libs/list.h>
+#include <block/vmm_blockdev.h>
+
+#define COW_IPRIORITY			(VMM_BLOCKDEV_CLASS_IPRIORITY+1)
+
+/* Overlay layout:
+ * Cluster 0 has struct cow_header (little-endian) followed by
+ * L1 table starting at l1_offset. Each L1 entry (le64) is overlay
+ * offset of a L2 table (or zero) and each L2 table is one cluster
+ * of le64 entries having overlay offset of a data cluster (or zero).
+ * Unallocated data clusters are read from base block device and
+ * new clusters are always allocated at next_free offset.
+ */
+#define COW_MAGIC			0x574f4358 /* "XCOW" */
+#define COW_VERSION			1
+#define COW_MIN_CLUSTER_BITS		12
+#define COW_MAX_CLUSTER_BITS		20
+#define COW_DEFAULT_CLUSTER_BITS	16
+#define COW_L2_CACHE_SIZE		8
+
+struct cow_header {
+	u32 magic;
+	u32 version;
+	u32 cluster_bits;
+	u32 l1_size;
+	u64 size;
+	u64 l1_offset;
+	u64 next_free;
+	char base_name[VMM_FIELD_NAME_SIZE];
+} __attribute__((packed));
+
+/* Cached L2 table */
+struct cow_l2 {
+	u64 offset;
+	u64 *table;
+	u64 last_used;
+};
+
+/* Copy-on-write block device context */
+struct cow {
+	struct dlist head;
+	struct vmm_blockdev *bdev;
+	struct vmm_blockdev *base;
+	struct vmm_blockdev *overlay;
+
+	/* Held while serving a request and while detaching */
+	struct vmm_mutex lock;
+	bool detached;
+
+	struct cow_header hdr;
+	u32 cluster_size;
+	u32 l2_bits;
+	u64 overlay_size;
+	u64 *l1;
+
+	u64 l2_tick;
+	struct cow_l2 l2_cache[COW_L2_CACHE_SIZE];
+
+	/* Bounce buffer used for copy-up of a cluster */
+	u8 *cluster_buf;
+
+	u64 copyups;
+	u64 allocated;
+};
+
+/** Format overlay block device for given base block device
+ *  Note: Existing overlay contents are lost
+ *  Note: This is a blocking API hence must be
+ *  called from Orphan (or Thread) Context
+ */
+int cow_format(struct vmm_blockdev *overlay,
+	       struct vmm_blockdev *base,
+	       u32 cluster_bits);
+
+/** Check overlay header against base and overlay sizes
+ *  Note: Header fields must be in host byte order
+ */
+int cow_check_header(const struct cow_header *hdr,
+		     u64 base_size, u64 overlay_size);
+
+/** Create COW instance using formatted overlay block device
+ *  Note: COW instance fails all requests once its base or
+ *  overlay block device is unregistered
+ *  Note: Base block device must not be written while in use
+ *  Note: This is a blocking API hence must be
+ *  called from Orphan (or Thread) Context
+ */
+struct cow *cow_create(const char *name,
+		       struct vmm_blockdev *base,
+		       struct vmm_blockdev *overlay);
+
+/** Destroy COW instance */
+void cow_destroy(struct cow *c);
+
+/** Find a COW instance with given name */
+struct cow *cow_find(const char *name);
+
+/** Get COW instance with given index */
+struct cow *cow_get(int index);
+
+/** Count number of COW instances */
+u32 cow_count(void);
+
+#endif /* __COW_H_ */
@@ -0,0 +1,69 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file loop.h
+ * @author agent (agent@local)
+ * @brief Interface for file backed (loop) block device driver.
+ */
+
+#ifndef __LOOP_H_
+#define __LOOP_H_
+
+#include <vmm_types.h>
+#include <vmm_mutex.h>
+#include <libs/list.h>
+#include <libs/vfs.h>
+#include <block/vmm_blockdev.h>
+
+#define LOOP_IPRIORITY			(VFS_IPRIORITY+1)
+#define LOOP_BLOCK_SIZE			512
+
+/* File backed (loop) block device context */
+struct loop {
+	struct dlist head;
+	struct vmm_blockdev *bdev;
+	char path[VFS_MAX_PATH];
+	bool read_only;
+	u64 size;
+	/* Lock to protect file offset of backing file */
+	struct vmm_mutex fd_lock;
+	int fd;
+};
+
+/** Create loop instance backed by given file
+ *  Note: File size is rounded down to LOOP_BLOCK_SIZE
+ *  Note: This is a blocking API hence must be
+ *  called from Orphan (or Thread) Context
+ */
+struct loop *loop_create(const char *name,
+			 const char *path,
+			 bool read_only);
+
+/** Destroy loop instance and close backing file */
+void loop_destroy(struct loop *l);
+
+/** Find a loop instance with given name */
+struct loop *loop_find(const char *name);
+
+/** Get loop instance with given index */
+struct loop *loop_get(int index);
+
+/** Count number of loop instances */
+u32 loop_count(void);
+
+#endif /* __LOOP_H_ */
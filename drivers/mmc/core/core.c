@@ -407,6 +407,25 @@ static int mmc_blockrq_write(struct vmm_blockrq *brq,
 	return rc;
 }
 
+static int mmc_blockrq_discard(struct vmm_blockrq *brq,
+			       struct vmm_request *r, void *priv)
+{
+	u32 cnt;
+	int rc = VMM_OK;
+	struct mmc_host *host = priv;
+
+	vmm_mutex_lock(&host->lock);
+	cnt = __mmc_sd_berase(host, host->card, r->lba, r->bcnt);
+	if (cnt == r->bcnt) {
+		rc = VMM_OK;
+	} else {
+		rc = VMM_EIO;
+	}
+	vmm_mutex_unlock(&host->lock);
+
+	return rc;
+}
+
 static int mmc_blockrq_abort(struct vmm_blockrq *brq,
 			     struct vmm_request *r, void *priv)
 {
@@ -479,6 +498,7 @@ int mmc_add_host(struct mmc_host *host)
 		vmm_mutex_unlock(&mmc_host_list_mutex);
 		return VMM_EFAIL;
 	}
+	vmm_blockrq_set_discard_ops(host->brq, mmc_blockrq_discard, NULL);
 
 	host->host_num = mmc_host_count;
 	mmc_host_count++;
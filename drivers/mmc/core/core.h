@@ -72,6 +72,8 @@ u32 __mmc_sd_bwrite(struct mmc_host *host, struct mmc_card *card,
 		    u64 start, u32 blkcnt, const void *src);
 u32 __mmc_sd_bread(struct mmc_host *host, struct mmc_card *card,
 		   u64 start, u32 blkcnt, void *dst);
+u32 __mmc_sd_berase(struct mmc_host *host, struct mmc_card *card,
+		    u64 start, u32 blkcnt);
 int __mmc_sd_attach(struct mmc_host *host);
 
 #endif
@@ -52,6 +52,11 @@
 #define DPRINTF(msg...)
 #endif
 
+/* Card busy polling count (in milliseconds) after erase command */
+#define MMC_ERASE_TIMEOUT		10000
+/* Max erase groups erased using one erase command */
+#define MMC_ERASE_MAX_GROUPS		1024
+
 /* frequency bases */
 /* divided by 10 to be nice to platforms without floating point */
 static const int fbase[] = {
@@ -169,6 +174,69 @@ u32 __mmc_sd_bwrite(struct mmc_host *host, struct mmc_card *card,
 	return blkcnt;
 }
 
+static int __mmc_erase_blocks(struct mmc_host *host, struct mmc_card *card,
+			      u64 start, u32 blkcnt)
+{
+	struct mmc_cmd cmd;
+	u64 end = start + blkcnt - 1;
+	int timeout = MMC_ERASE_TIMEOUT;
+
+	DPRINTF("%s: start=0x%llx blkcnt=%d\n", __func__, start, blkcnt);
+
+	if (!card->high_capacity) {
+		start *= card->write_bl_len;
+		end *= card->write_bl_len;
+	}
+
+	cmd.cmdidx = (IS_SD(card)) ?
+		SD_CMD_ERASE_WR_BLK_START : MMC_CMD_ERASE_GROUP_START;
+	cmd.cmdarg = start;
+	cmd.resp_type = MMC_RSP_R1;
+	if (mmc_send_cmd(host, &cmd, NULL)) {
+		return VMM_EIO;
+	}
+
+	cmd.cmdidx = (IS_SD(card)) ?
+		SD_CMD_ERASE_WR_BLK_END : MMC_CMD_ERASE_GROUP_END;
+	cmd.cmdarg = end;
+	cmd.resp_type = MMC_RSP_R1;
+	if (mmc_send_cmd(host, &cmd, NULL)) {
+		return VMM_EIO;
+	}
+
+	cmd.cmdidx = MMC_CMD_ERASE;
+	cmd.cmdarg = 0;
+	cmd.resp_type = MMC_RSP_R1b;
+	if (mmc_send_cmd(host, &cmd, NULL)) {
+		return VMM_EIO;
+	}
+
+	/* Waiting for the ready status */
+	return mmc_send_status(host, card, timeout);
+}
+
+u32 __mmc_sd_berase(struct mmc_host *host, struct mmc_card *card,
+		    u64 start, u32 blkcnt)
+{
+	u32 cur, grp = (card->erase_grp_size) ? card->erase_grp_size : 1;
+	u64 end = start + blkcnt;
+
+	/* Only erase groups fully inside the range are erased */
+	start = udiv64(start + grp - 1, grp) * grp;
+	end = udiv64(end, grp) * grp;
+
+	while (start < end) {
+		cur = ((end - start) > (MMC_ERASE_MAX_GROUPS * grp)) ?
+				(MMC_ERASE_MAX_GROUPS * grp) : (end - start);
+		if (__mmc_erase_blocks(host, card, start, cur)) {
+			return 0;
+		}
+		start += cur;
+	}
+
+	return blkcnt;
+}
+
 static u32 __mmc_read_blocks(struct mmc_host *host, struct mmc_card *card,
 			     void *dst, u64 start, u32 blkcnt)
 {
@@ -643,6 +711,7 @@ static int __mmc_startup(struct mmc_host *host, struct mmc_card *card)
 
 	/*
 	 * For SD, its erase group is always one sector
+	 * Note: erase group size is in units of write blocks
 	 */
 	card->erase_grp_size = 1;
 	card->part_config = MMCPART_NOAVAILABLE;
@@ -689,8 +758,10 @@ static int __mmc_startup(struct mmc_host *host, struct mmc_card *card)
 		 * the group size from the csd value.
 		 */
 		if (ext_csd[EXT_CSD_ERASE_GROUP_DEF]) {
+			/* HC_ERASE_GRP_SIZE is in units of 512KiB */
 			card->erase_grp_size =
-			      ext_csd[EXT_CSD_HC_ERASE_GRP_SIZE] * 512 * 1024;
+			      udiv32(ext_csd[EXT_CSD_HC_ERASE_GRP_SIZE] *
+				     512 * 1024, card->write_bl_len);
 		} else {
 			int erase_gsz, erase_gmul;
 			erase_gsz = (card->csd[2] & 0x00007c00) >> 10;
@@ -1095,7 +1166,7 @@ int __mmc_sd_attach(struct mmc_host *host)
 		     ((card->cid[2] >> 24) & 0xff), ((card->cid[2] >> 20) & 0xf),
 		     ((card->cid[2] >> 16) & 0xf));
 	bdev->dev.parent = host->dev;
-	bdev->flags = VMM_BLOCKDEV_RW;
+	bdev->flags = VMM_BLOCKDEV_RW | VMM_BLOCKDEV_DISCARD;
 	if (card->read_bl_len < card->write_bl_len) {
 		bdev->block_size = card->write_bl_len;
 	} else {
@@ -49,13 +49,16 @@
 #define MODULE_EXIT			virtio_blk_exit
 
 #define VIRTIO_BLK_QUEUE_SIZE		128
-#define VIRTIO_BLK_IO_QUEUE		0
-#define VIRTIO_BLK_NUM_QUEUES		1
+#define VIRTIO_BLK_MAX_QUEUES		8
 #define VIRTIO_BLK_SECTOR_SIZE		512
 #define VIRTIO_BLK_DISK_SEG_MAX		(VIRTIO_BLK_QUEUE_SIZE - 2)
+/* Keep discard/write zeroes length (in bytes) within u32 */
+#define VIRTIO_BLK_MAX_DISCARD_SECTORS	(1U << 22)
+
+struct virtio_blk_queue;
 
 struct virtio_blk_dev_req {
-	struct vmm_virtio_queue		*vq;
+	struct virtio_blk_queue		*q;
 	u16				head;
 	struct vmm_virtio_iovec		*read_iov;
 	u32				read_iov_cnt;
@@ -65,12 +68,27 @@ struct virtio_blk_dev_req {
 	struct vmm_vdisk_request	r;
 };
 
+/* Each request queue is processed on the VCPU which kicked it so
+ * all state touched while processing a queue is kept per-queue.
+ * The avail_lock serializes popping requests from avail ring and use
+ * of the iovec scratch array. It is dropped while a request is being
+ * submitted to block layer. The used_lock serializes completions which
+ * can arrive from block layer context at any time.
+ */
+struct virtio_blk_queue {
+	u32				num;
+	struct vmm_virtio_queue		vq;
+	vmm_spinlock_t			avail_lock;
+	vmm_spinlock_t			used_lock;
+	struct vmm_virtio_iovec		iov[VIRTIO_BLK_QUEUE_SIZE];
+	struct virtio_blk_dev_req	reqs[VIRTIO_BLK_QUEUE_SIZE];
+};
+
 struct virtio_blk_dev {
 	struct vmm_virtio_device 	*vdev;
 
-	struct vmm_virtio_queue 	vqs[VIRTIO_BLK_NUM_QUEUES];
-	struct vmm_virtio_iovec		iov[VIRTIO_BLK_QUEUE_SIZE];
-	struct virtio_blk_dev_req	reqs[VIRTIO_BLK_QUEUE_SIZE];
+	u32				num_queues;
+	struct virtio_blk_queue		*queues;
 	u32 				features;
 
 	struct vmm_virtio_blk_config 	config;
@@ -79,13 +97,23 @@ struct virtio_blk_dev {
 
 static u32 virtio_blk_get_host_features(struct vmm_virtio_device *dev)
 {
-	return	1UL << VMM_VIRTIO_BLK_F_SEG_MAX
+	struct virtio_blk_dev *vbdev = dev->emu_data;
+	u32 features;
+
+	features = 1UL << VMM_VIRTIO_BLK_F_SEG_MAX
 		| 1UL << VMM_VIRTIO_BLK_F_BLK_SIZE
 		| 1UL << VMM_VIRTIO_BLK_F_FLUSH
+		| 1UL << VMM_VIRTIO_BLK_F_DISCARD
+		| 1UL << VMM_VIRTIO_BLK_F_WRITE_ZEROES
 		| 1UL << VMM_VIRTIO_RING_F_EVENT_IDX;
 #if 0
-		| 1UL << VMM_VIRTIO_RING_F_INDIRECT_DESC;
+	features |= 1UL << VMM_VIRTIO_RING_F_INDIRECT_DESC;
 #endif
+	if (vbdev->num_queues > 1) {
+		features |= 1UL << VMM_VIRTIO_BLK_F_MQ;
+	}
+
+	return features;
 }
 
 static void virtio_blk_set_guest_features(struct vmm_virtio_device *dev,
@@ -100,53 +128,32 @@ static int virtio_blk_init_vq(struct vmm_virtio_device *dev,
 			      u32 vq, u32 page_size, u32 align,
 			      u32 pfn)
 {
-	int rc;
 	struct virtio_blk_dev *vbdev = dev->emu_data;
 
-	switch (vq) {
-	case VIRTIO_BLK_IO_QUEUE:
-		rc = vmm_virtio_queue_setup(&vbdev->vqs[vq], dev->guest,
-				pfn, page_size, VIRTIO_BLK_QUEUE_SIZE, align);
-		break;
-	default:
-		rc = VMM_EINVALID;
-		break;
-	};
+	if (vbdev->num_queues <= vq) {
+		return VMM_EINVALID;
+	}
 
-	return rc;
+	return vmm_virtio_queue_setup(&vbdev->queues[vq].vq, dev->guest,
+			pfn, page_size, VIRTIO_BLK_QUEUE_SIZE, align);
 }
 
 static int virtio_blk_get_pfn_vq(struct vmm_virtio_device *dev, u32 vq)
 {
-	int rc;
 	struct virtio_blk_dev *vbdev = dev->emu_data;
 
-	switch (vq) {
-	case VIRTIO_BLK_IO_QUEUE:
-		rc = vmm_virtio_queue_guest_pfn(&vbdev->vqs[vq]);
-		break;
-	default:
-		rc = VMM_EINVALID;
-		break;
-	};
+	if (vbdev->num_queues <= vq) {
+		return VMM_EINVALID;
+	}
 
-	return rc;
+	return vmm_virtio_queue_guest_pfn(&vbdev->queues[vq].vq);
 }
 
 static int virtio_blk_get_size_vq(struct vmm_virtio_device *dev, u32 vq)
 {
-	int rc;
-
-	switch (vq) {
-	case VIRTIO_BLK_IO_QUEUE:
-		rc = VIRTIO_BLK_QUEUE_SIZE;
-		break;
-	default:
-		rc = 0;
-		break;
-	};
+	struct virtio_blk_dev *vbdev = dev->emu_data;
 
-	return rc;
+	return (vq < vbdev->num_queues) ? VIRTIO_BLK_QUEUE_SIZE : 0;
 }
 
 static int virtio_blk_set_size_vq(struct vmm_virtio_device *dev,
@@ -159,8 +166,9 @@ static int virtio_blk_set_size_vq(struct vmm_virtio_device *dev,
 static void virtio_blk_req_done(struct virtio_blk_dev *vbdev,
 				struct virtio_blk_dev_req *req, u8 status)
 {
+	irq_flags_t flags;
+	struct virtio_blk_queue *q = req->q;
 	struct vmm_virtio_device *dev = vbdev->vdev;
-	int queueid = req->vq - vbdev->vqs;
 
 	if (req->read_iov && req->len && req->data &&
 	    (status == VMM_VIRTIO_BLK_S_OK) &&
@@ -186,11 +194,12 @@ static void virtio_blk_req_done(struct virtio_blk_dev *vbdev,
 
 	vmm_virtio_buf_to_iovec_write(dev, &req->status_iov, 1, &status, 1);
 
-	vmm_virtio_queue_set_used_elem(req->vq, req->head, req->len);
-
-	if (vmm_virtio_queue_should_signal(req->vq)) {
-		dev->tra->notify(dev, queueid);
+	vmm_spin_lock_irqsave_lite(&q->used_lock, flags);
+	vmm_virtio_queue_set_used_elem(&q->vq, req->head, req->len);
+	if (vmm_virtio_queue_should_signal(&q->vq)) {
+		dev->tra->notify(dev, q->num);
 	}
+	vmm_spin_unlock_irqrestore_lite(&q->used_lock, flags);
 }
 
 static void virtio_blk_attached(struct vmm_vdisk *vdisk)
@@ -239,166 +248,249 @@ static void virtio_blk_req_failed(struct vmm_vdisk *vdisk,
 			    VMM_VIRTIO_BLK_S_IOERR);
 }
 
+/* Copy all request state out of shared queue iovec array
+ * Note: Must be called with avail_lock held
+ */
+static u8 virtio_blk_prep_req(struct vmm_virtio_device *dev,
+			      struct virtio_blk_queue *q,
+			      struct virtio_blk_dev_req *req, u32 iov_cnt,
+			      struct vmm_virtio_blk_outhdr *hdr,
+			      struct vmm_virtio_blk_discard_write_zeroes *seg)
+{
+	u32 i, len, valid_flags;
+
+	switch (hdr->type) {
+	case VMM_VIRTIO_BLK_T_IN:
+		vmm_vdisk_set_request_type(&req->r, VMM_VDISK_REQUEST_READ);
+		req->data = vmm_malloc(req->len);
+		if (!req->data) {
+			return VMM_VIRTIO_BLK_S_IOERR;
+		}
+		len = sizeof(struct vmm_virtio_iovec) * (iov_cnt - 2);
+		req->read_iov = vmm_malloc(len);
+		if (!req->read_iov) {
+			return VMM_VIRTIO_BLK_S_IOERR;
+		}
+		req->read_iov_cnt = iov_cnt - 2;
+		for (i = 0; i < req->read_iov_cnt; i++) {
+			req->read_iov[i].addr = q->iov[i + 1].addr;
+			req->read_iov[i].len = q->iov[i + 1].len;
+		}
+		break;
+	case VMM_VIRTIO_BLK_T_OUT:
+		vmm_vdisk_set_request_type(&req->r, VMM_VDISK_REQUEST_WRITE);
+		req->data = vmm_malloc(req->len);
+		if (!req->data) {
+			return VMM_VIRTIO_BLK_S_IOERR;
+		}
+		vmm_virtio_iovec_to_buf_read(dev, &q->iov[1], iov_cnt - 2,
+					     req->data, req->len);
+		break;
+	case VMM_VIRTIO_BLK_T_FLUSH:
+		vmm_vdisk_set_request_type(&req->r, VMM_VDISK_REQUEST_WRITE);
+		break;
+	case VMM_VIRTIO_BLK_T_DISCARD:
+	case VMM_VIRTIO_BLK_T_WRITE_ZEROES:
+		if (hdr->type == VMM_VIRTIO_BLK_T_DISCARD) {
+			vmm_vdisk_set_request_type(&req->r,
+						VMM_VDISK_REQUEST_DISCARD);
+			valid_flags = 0;
+		} else {
+			vmm_vdisk_set_request_type(&req->r,
+					VMM_VDISK_REQUEST_WRITE_ZEROES);
+			valid_flags = VMM_VIRTIO_BLK_WRITE_ZEROES_FLAG_UNMAP;
+		}
+		/* We only support one segment per request */
+		len = 0;
+		if (iov_cnt == 3) {
+			len = vmm_virtio_iovec_to_buf_read(dev, &q->iov[1], 1,
+							   seg, sizeof(*seg));
+		}
+		if ((len < sizeof(*seg)) || !seg->num_sectors ||
+		    (VIRTIO_BLK_MAX_DISCARD_SECTORS < seg->num_sectors)) {
+			return VMM_VIRTIO_BLK_S_IOERR;
+		}
+		if (seg->flags & ~valid_flags) {
+			return VMM_VIRTIO_BLK_S_UNSUPP;
+		}
+		break;
+	case VMM_VIRTIO_BLK_T_GET_ID:
+		vmm_vdisk_set_request_type(&req->r, VMM_VDISK_REQUEST_READ);
+		req->len = VMM_VIRTIO_BLK_ID_BYTES;
+		req->data = vmm_zalloc(req->len);
+		if (!req->data) {
+			return VMM_VIRTIO_BLK_S_IOERR;
+		}
+		req->read_iov = vmm_malloc(sizeof(struct vmm_virtio_iovec));
+		if (!req->read_iov) {
+			return VMM_VIRTIO_BLK_S_IOERR;
+		}
+		req->read_iov_cnt = 1;
+		req->read_iov[0].addr = q->iov[1].addr;
+		req->read_iov[0].len = q->iov[1].len;
+		break;
+	default:
+		break;
+	};
+
+	return VMM_VIRTIO_BLK_S_OK;
+}
+
+/* Submit prepared request without holding avail_lock */
+static void virtio_blk_submit_req(struct vmm_virtio_device *dev,
+			struct virtio_blk_dev *vbdev,
+			struct virtio_blk_dev_req *req,
+			struct vmm_virtio_blk_outhdr *hdr,
+			struct vmm_virtio_blk_discard_write_zeroes *seg)
+{
+	switch (hdr->type) {
+	case VMM_VIRTIO_BLK_T_IN:
+		DPRINTF("%s: VIRTIO_BLK_T_IN dev=%s "
+			"hdr.sector=%"PRIu64" req->len=%d\n",
+			__func__, dev->name, (u64)hdr->sector, req->len);
+		/* Note: We will get failed() or complete() callback
+		 * even when no block device attached to virtual disk
+		 */
+		vmm_vdisk_submit_request(vbdev->vdisk, &req->r,
+					 VMM_VDISK_REQUEST_READ,
+					 hdr->sector, req->data, req->len);
+		break;
+	case VMM_VIRTIO_BLK_T_OUT:
+		DPRINTF("%s: VIRTIO_BLK_T_OUT dev=%s "
+			"hdr.sector=%"PRIu64" req->len=%d\n",
+			__func__, dev->name, (u64)hdr->sector, req->len);
+		/* Note: We will get failed() or complete() callback
+		 * even when no block device attached to virtual disk
+		 */
+		vmm_vdisk_submit_request(vbdev->vdisk, &req->r,
+					 VMM_VDISK_REQUEST_WRITE,
+					 hdr->sector, req->data, req->len);
+		break;
+	case VMM_VIRTIO_BLK_T_FLUSH:
+		DPRINTF("%s: VIRTIO_BLK_T_FLUSH dev=%s\n",
+			__func__, dev->name);
+		if (vmm_vdisk_flush_cache(vbdev->vdisk)) {
+			virtio_blk_req_done(vbdev, req,
+					    VMM_VIRTIO_BLK_S_IOERR);
+		} else {
+			virtio_blk_req_done(vbdev, req, VMM_VIRTIO_BLK_S_OK);
+		}
+		break;
+	case VMM_VIRTIO_BLK_T_DISCARD:
+	case VMM_VIRTIO_BLK_T_WRITE_ZEROES:
+		DPRINTF("%s: type=%d dev=%s seg.sector=%"PRIu64" "
+			"seg.num_sectors=%d\n", __func__, hdr->type,
+			dev->name, (u64)seg->sector, seg->num_sectors);
+		/* Note: We will get failed() or complete() callback
+		 * even when no block device attached to virtual disk
+		 */
+		vmm_vdisk_submit_request(vbdev->vdisk, &req->r,
+				vmm_vdisk_get_request_type(&req->r),
+				seg->sector, NULL,
+				seg->num_sectors * VIRTIO_BLK_SECTOR_SIZE);
+		break;
+	case VMM_VIRTIO_BLK_T_GET_ID:
+		DPRINTF("%s: VIRTIO_BLK_T_GET_ID dev=%s req->len=%d\n",
+			__func__, dev->name, req->len);
+		if (vmm_vdisk_current_block_device(vbdev->vdisk,
+						   req->data, req->len)) {
+			virtio_blk_req_done(vbdev, req,
+					    VMM_VIRTIO_BLK_S_IOERR);
+		} else {
+			virtio_blk_req_done(vbdev, req, VMM_VIRTIO_BLK_S_OK);
+		}
+		break;
+	default:
+		break;
+	};
+}
+
 static void virtio_blk_do_io(struct vmm_virtio_device *dev,
-			     struct virtio_blk_dev *vbdev)
+			     struct virtio_blk_dev *vbdev,
+			     struct virtio_blk_queue *q)
 {
+	u8 status;
 	u16 head;
 	u32 i, iov_cnt, len;
+	irq_flags_t flags, used_flags;
 	struct virtio_blk_dev_req *req;
-	struct vmm_virtio_queue *vq = &vbdev->vqs[VIRTIO_BLK_IO_QUEUE];
+	struct vmm_virtio_queue *vq = &q->vq;
 	struct vmm_virtio_blk_outhdr hdr;
+	struct vmm_virtio_blk_discard_write_zeroes seg;
+	bool fua;
+
+	/* Without flush command guest expects write-through disk */
+	fua = (vbdev->features & (1UL << VMM_VIRTIO_BLK_F_FLUSH)) ?
+							FALSE : TRUE;
+
+	vmm_spin_lock_irqsave_lite(&q->avail_lock, flags);
 
 	while (vmm_virtio_queue_available(vq)) {
 		head = vmm_virtio_queue_pop(vq);
-		req = &vbdev->reqs[head];
-		head = vmm_virtio_queue_get_head_iovec(vq, head, vbdev->iov,
+		req = &q->reqs[head];
+		head = vmm_virtio_queue_get_head_iovec(vq, head, q->iov,
 						       &iov_cnt, &len);
 
-		req->vq = vq;
+		req->q = q;
 		req->head = head;
 		req->read_iov = NULL;
 		req->read_iov_cnt = 0;
 		req->len = 0;
 		for (i = 1; i < (iov_cnt - 1); i++) {
-			req->len += vbdev->iov[i].len;
+			req->len += q->iov[i].len;
 		}
-		req->status_iov.addr = vbdev->iov[iov_cnt - 1].addr;
-		req->status_iov.len = vbdev->iov[iov_cnt - 1].len;
+		req->status_iov.addr = q->iov[iov_cnt - 1].addr;
+		req->status_iov.len = q->iov[iov_cnt - 1].len;
 		vmm_vdisk_set_request_type(&req->r, VMM_VDISK_REQUEST_UNKNOWN);
+		vmm_vdisk_set_request_fua(&req->r, fua);
 
-		len = vmm_virtio_iovec_to_buf_read(dev, &vbdev->iov[0], 1,
+		len = vmm_virtio_iovec_to_buf_read(dev, &q->iov[0], 1,
 						   &hdr, sizeof(hdr));
 		if (len < sizeof(hdr)) {
-			vmm_virtio_queue_set_used_elem(req->vq, req->head, 0);
+			vmm_spin_lock_irqsave_lite(&q->used_lock, used_flags);
+			vmm_virtio_queue_set_used_elem(vq, req->head, 0);
+			vmm_spin_unlock_irqrestore_lite(&q->used_lock,
+							used_flags);
 			continue;
 		}
 
-		switch (hdr.type) {
-		case VMM_VIRTIO_BLK_T_IN:
-			vmm_vdisk_set_request_type(&req->r,
-						   VMM_VDISK_REQUEST_READ);
-			req->data = vmm_malloc(req->len);
-			if (!req->data) {
-				virtio_blk_req_done(vbdev, req,
-						    VMM_VIRTIO_BLK_S_IOERR);
-				continue;
-			}
-			len = sizeof(struct vmm_virtio_iovec) * (iov_cnt - 2);
-			req->read_iov = vmm_malloc(len);
-			if (!req->read_iov) {
-				virtio_blk_req_done(vbdev, req,
-						    VMM_VIRTIO_BLK_S_IOERR);
-				continue;
-			}
-			req->read_iov_cnt = iov_cnt - 2;
-			for (i = 0; i < req->read_iov_cnt; i++) {
-				req->read_iov[i].addr = vbdev->iov[i + 1].addr;
-				req->read_iov[i].len = vbdev->iov[i + 1].len;
-			}
-			DPRINTF("%s: VIRTIO_BLK_T_IN dev=%s "
-				"hdr.sector=%"PRIu64" req->len=%d\n",
-				__func__, dev->name,
-				(u64)hdr.sector, req->len);
-			/* Note: We will get failed() or complete() callback
-			 * even when no block device attached to virtual disk
-			 */
-			vmm_vdisk_submit_request(vbdev->vdisk, &req->r,
-						 VMM_VDISK_REQUEST_READ,
-						 hdr.sector, req->data, req->len);
-			break;
-		case VMM_VIRTIO_BLK_T_OUT:
-			vmm_vdisk_set_request_type(&req->r,
-						   VMM_VDISK_REQUEST_WRITE);
-			req->data = vmm_malloc(req->len);
-			if (!req->data) {
-				virtio_blk_req_done(vbdev, req,
-						    VMM_VIRTIO_BLK_S_IOERR);
-				continue;
-			} else {
-				vmm_virtio_iovec_to_buf_read(dev,
-							 &vbdev->iov[1],
-							 iov_cnt - 2,
-							 req->data,
-							 req->len);
-			}
-			DPRINTF("%s: VIRTIO_BLK_T_OUT dev=%s "
-				"hdr.sector=%"PRIu64" req->len=%d\n",
-				__func__, dev->name,
-				(u64)hdr.sector, req->len);
-			/* Note: We will get failed() or complete() callback
-			 * even when no block device attached to virtual disk
-			 */
-			vmm_vdisk_submit_request(vbdev->vdisk, &req->r,
-						 VMM_VDISK_REQUEST_WRITE,
-						 hdr.sector, req->data, req->len);
-			break;
-		case VMM_VIRTIO_BLK_T_FLUSH:
-			vmm_vdisk_set_request_type(&req->r,
-						   VMM_VDISK_REQUEST_WRITE);
-			DPRINTF("%s: VIRTIO_BLK_T_FLUSH dev=%s\n",
-				__func__, dev->name);
-			if (vmm_vdisk_flush_cache(vbdev->vdisk)) {
-				virtio_blk_req_done(vbdev, req,
-						    VMM_VIRTIO_BLK_S_IOERR);
-			} else {
-				virtio_blk_req_done(vbdev, req,
-						    VMM_VIRTIO_BLK_S_OK);
-			}
-			break;
-		case VMM_VIRTIO_BLK_T_GET_ID:
-			vmm_vdisk_set_request_type(&req->r,
-						   VMM_VDISK_REQUEST_READ);
-			req->len = VMM_VIRTIO_BLK_ID_BYTES;
-			req->data = vmm_zalloc(req->len);
-			if (!req->data) {
-				virtio_blk_req_done(vbdev, req,
-						    VMM_VIRTIO_BLK_S_IOERR);
-				continue;
-			}
-			req->read_iov =
-				vmm_malloc(sizeof(struct vmm_virtio_iovec));
-			if (!req->read_iov) {
-				virtio_blk_req_done(vbdev, req,
-						    VMM_VIRTIO_BLK_S_IOERR);
-				continue;
-			}
-			req->read_iov_cnt = 1;
-			req->read_iov[0].addr = vbdev->iov[1].addr;
-			req->read_iov[0].len = vbdev->iov[1].len;
-			DPRINTF("%s: VIRTIO_BLK_T_GET_ID dev=%s req->len=%d\n",
-				__func__, dev->name, req->len);
-			if (vmm_vdisk_current_block_device(vbdev->vdisk,
-							req->data, req->len)) {
-				virtio_blk_req_done(vbdev, req,
-						    VMM_VIRTIO_BLK_S_IOERR);
-			} else {
-				virtio_blk_req_done(vbdev, req,
-						    VMM_VIRTIO_BLK_S_OK);
-			}
-			break;
-		default:
-			break;
-		};
+		status = virtio_blk_prep_req(dev, q, req, iov_cnt,
+					     &hdr, &seg);
+
+		/* Don't hold avail_lock while block layer processes
+		 * the request so that other kicks of this queue and
+		 * completions are not stalled behind submission.
+		 */
+		vmm_spin_unlock_irqrestore_lite(&q->avail_lock, flags);
+
+		if (status != VMM_VIRTIO_BLK_S_OK) {
+			virtio_blk_req_done(vbdev, req, status);
+		} else {
+			virtio_blk_submit_req(dev, vbdev, req, &hdr, &seg);
+		}
+
+		vmm_spin_lock_irqsave_lite(&q->avail_lock, flags);
 	}
+
+	vmm_spin_unlock_irqrestore_lite(&q->avail_lock, flags);
 }
 
 static int virtio_blk_notify_vq(struct vmm_virtio_device *dev, u32 vq)
 {
-	int rc = VMM_OK;
 	struct virtio_blk_dev *vbdev = dev->emu_data;
 
 	DPRINTF("%s: dev=%s vq=%d\n", __func__, dev->name, vq);
 
-	switch (vq) {
-	case VIRTIO_BLK_IO_QUEUE:
-		virtio_blk_do_io(dev, vbdev);
-		break;
-	default:
-		rc = VMM_EINVALID;
-		break;
-	};
+	if (vbdev->num_queues <= vq) {
+		return VMM_EINVALID;
+	}
+
+	/* Process the kicked queue right here on the notifying VCPU
+	 * so that kicks of different queues proceed in parallel.
+	 */
+	virtio_blk_do_io(dev, vbdev, &vbdev->queues[vq]);
 
-	return rc;
+	return VMM_OK;
 }
 
 static void virtio_blk_status_changed(struct vmm_virtio_device *dev,
@@ -444,25 +536,31 @@ static int virtio_blk_write_config(struct vmm_virtio_device *dev,
 static int virtio_blk_reset(struct vmm_virtio_device *dev)
 {
 	int i, rc;
+	u32 qnum;
+	struct virtio_blk_queue *q;
 	struct virtio_blk_dev_req *req;
 	struct virtio_blk_dev *vbdev = dev->emu_data;
 
 	DPRINTF("%s: dev=%s\n", __func__, dev->name);
 
-	for (i = 0; i < VIRTIO_BLK_QUEUE_SIZE; i++) {
-		req = &vbdev->reqs[i];
-		if (vmm_vdisk_get_request_type(&req->r) !=
-					VMM_VDISK_REQUEST_UNKNOWN) {
-			vmm_vdisk_abort_request(vbdev->vdisk, &req->r);
+	for (qnum = 0; qnum < vbdev->num_queues; qnum++) {
+		q = &vbdev->queues[qnum];
+
+		for (i = 0; i < VIRTIO_BLK_QUEUE_SIZE; i++) {
+			req = &q->reqs[i];
+			if (vmm_vdisk_get_request_type(&req->r) !=
+						VMM_VDISK_REQUEST_UNKNOWN) {
+				vmm_vdisk_abort_request(vbdev->vdisk, &req->r);
+			}
+			memset(req, 0, sizeof(*req));
+			vmm_vdisk_set_request_type(&req->r,
+						   VMM_VDISK_REQUEST_UNKNOWN);
 		}
-		memset(req, 0, sizeof(*req));
-		vmm_vdisk_set_request_type(&req->r,
-					   VMM_VDISK_REQUEST_UNKNOWN);
-	}
 
-	rc = vmm_virtio_queue_cleanup(&vbdev->vqs[VIRTIO_BLK_IO_QUEUE]);
-	if (rc) {
-		return rc;
+		rc = vmm_virtio_queue_cleanup(&q->vq);
+		if (rc) {
+			return rc;
+		}
 	}
 
 	return VMM_OK;
@@ -471,6 +569,7 @@ static int virtio_blk_reset(struct vmm_virtio_device *dev)
 static int virtio_blk_connect(struct vmm_virtio_device *dev,
 			      struct vmm_virtio_emulator *emu)
 {
+	u32 i, num_queues;
 	const char *attr;
 	struct virtio_blk_dev *vbdev;
 
@@ -483,9 +582,39 @@ static int virtio_blk_connect(struct vmm_virtio_device *dev,
 	}
 	vbdev->vdev = dev;
 
+	/* One request queue per VCPU unless specified otherwise */
+	if (vmm_devtree_read_u32(dev->edev->node,
+				 "num_queues", &num_queues) != VMM_OK) {
+		num_queues = dev->guest->vcpu_count;
+	}
+	if (num_queues < 1) {
+		num_queues = 1;
+	} else if (VIRTIO_BLK_MAX_QUEUES < num_queues) {
+		num_queues = VIRTIO_BLK_MAX_QUEUES;
+	}
+	vbdev->queues = vmm_zalloc(sizeof(struct virtio_blk_queue) *
+				   num_queues);
+	if (!vbdev->queues) {
+		vmm_free(vbdev);
+		return VMM_ENOMEM;
+	}
+	vbdev->num_queues = num_queues;
+	for (i = 0; i < num_queues; i++) {
+		vbdev->queues[i].num = i;
+		INIT_SPIN_LOCK(&vbdev->queues[i].avail_lock);
+		INIT_SPIN_LOCK(&vbdev->queues[i].used_lock);
+	}
+
 	vbdev->config.capacity = 0;
 	vbdev->config.seg_max = VIRTIO_BLK_DISK_SEG_MAX,
 	vbdev->config.blk_size = VIRTIO_BLK_SECTOR_SIZE;
+	vbdev->config.max_discard_sectors = VIRTIO_BLK_MAX_DISCARD_SECTORS;
+	vbdev->config.max_discard_seg = 1;
+	vbdev->config.discard_sector_alignment = 1;
+	vbdev->config.max_write_zeroes_sectors = VIRTIO_BLK_MAX_DISCARD_SECTORS;
+	vbdev->config.max_write_zeroes_seg = 1;
+	vbdev->config.write_zeroes_may_unmap = 0;
+	vbdev->config.num_queues = num_queues;
 
 	vbdev->vdisk = vmm_vdisk_create(dev->name, VIRTIO_BLK_SECTOR_SIZE,
 					virtio_blk_attached,
@@ -494,6 +623,7 @@ static int virtio_blk_connect(struct vmm_virtio_device *dev,
 					virtio_blk_req_failed,
 					vbdev);
 	if (!vbdev->vdisk) {
+		vmm_free(vbdev->queues);
 		vmm_free(vbdev);
 		return VMM_EFAIL;
 	}
@@ -516,6 +646,7 @@ static void virtio_blk_disconnect(struct vmm_virtio_device *dev)
 	DPRINTF("%s: dev=%s\n", __func__, dev->name);
 
 	vmm_vdisk_destroy(vbdev->vdisk);
+	vmm_free(vbdev->queues);
 	vmm_free(vbdev);
 }
 
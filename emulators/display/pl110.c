@@ -37,6 +37,7 @@
 #include <vmm_devemu.h>
 #include <vmm_host_io.h>
 #include <vmm_guest_aspace.h>
+#include <vmm_guest_dedup.h>
 #include <vio/vmm_pixel_ops.h>
 #include <vio/vmm_vdisplay.h>
 
@@ -145,6 +146,7 @@ static int pl110_display_pixeldata(struct vmm_vdisplay *vdis,
 
 	gpa = s->upbase;
 	gsz = (s->cols * s->rows) * bytes_per_pixel;
+	vmm_guest_dedup_pin(s->guest, gpa, gsz);
 	rc = vmm_guest_physical_map(s->guest, gpa, gsz, &hpa, &hsz, &flags);
 	if (rc) {
 		return rc;
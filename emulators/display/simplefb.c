@@ -27,6 +27,7 @@
 #include <vmm_devemu.h>
 #include <vmm_host_io.h>
 #include <vmm_guest_aspace.h>
+#include <vmm_guest_dedup.h>
 #include <vio/vmm_pixel_ops.h>
 #include <vio/vmm_vdisplay.h>
 #include <libs/stringlib.h>
@@ -91,6 +92,7 @@ static int simplefb_display_pixeldata(struct vmm_vdisplay *vdis,
 
 	gpa = s->fb_base;
 	gsz = s->height * s->stride;
+	vmm_guest_dedup_pin(s->guest, gpa, gsz);
 	rc = vmm_guest_physical_map(s->guest, gpa, gsz, &hpa, &hsz, &flags);
 	if (rc) {
 		return rc;
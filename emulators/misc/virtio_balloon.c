@@ -0,0 +1,671 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file virtio_balloon.c
+ * @author agent (agent@local)
+ * @brief VirtIO based memory balloon Emulator.
+ *
+ * The balloon target is set using vmm_guest_balloon_set_target() and
+ * pages given back by the guest (inflated or reported as free) are
+ * released to host only when they belong to on-demand RAM regions.
+ * A chunk of on-demand RAM region is released only after all pages
+ * of the chunk are inside the balloon and it is populated again (zero
+ * filled) when the guest touches it after deflating the balloon.
+ */
+
+#include <vmm_error.h>
+#include <vmm_macros.h>
+#include <vmm_heap.h>
+#include <vmm_timer.h>
+#include <vmm_modules.h>
+#include <vmm_devtree.h>
+#include <vmm_devemu.h>
+#include <vmm_spinlocks.h>
+#include <vmm_host_aspace.h>
+#include <vmm_guest_aspace.h>
+#include <vio/vmm_virtio.h>
+#include <vio/vmm_virtio_balloon.h>
+#include <libs/bitmap.h>
+#include <libs/stringlib.h>
+
+#define MODULE_DESC			"VirtIO Balloon Emulator"
+#define MODULE_AUTHOR			"agent"
+#define MODULE_LICENSE			"GPL"
+#define MODULE_IPRIORITY		(VMM_VIRTIO_IPRIORITY + 1)
+#define MODULE_INIT			virtio_balloon_init
+#define MODULE_EXIT			virtio_balloon_exit
+
+#define VIRTIO_BALLOON_QUEUE_SIZE	128
+#define VIRTIO_BALLOON_NUM_QUEUES	4
+#define VIRTIO_BALLOON_INFLATE_QUEUE	0
+#define VIRTIO_BALLOON_DEFLATE_QUEUE	1
+#define VIRTIO_BALLOON_STATS_QUEUE	2
+#define VIRTIO_BALLOON_REPORTING_QUEUE	3
+
+#define VIRTIO_BALLOON_PFN_BATCH	64
+
+#define VIRTIO_BALLOON_STATS_PERIOD_ATTR_NAME	"stats_period_msecs"
+
+/* Ballooned pages of an on-demand RAM region */
+struct virtio_balloon_area {
+	struct dlist head;
+	struct vmm_region *reg;
+	unsigned long *pages;
+	u32 *chunk_pages;
+};
+
+struct virtio_balloon_dev {
+	struct vmm_virtio_device *vdev;
+	struct vmm_guest *guest;
+
+	struct vmm_virtio_queue vqs[VIRTIO_BALLOON_NUM_QUEUES];
+	struct vmm_virtio_iovec iov[VIRTIO_BALLOON_QUEUE_SIZE];
+	struct vmm_virtio_balloon_config config;
+	u32 features;
+
+	vmm_spinlock_t lock;
+	struct dlist area_list;
+	bool stats_pending;
+	u16 stats_head;
+	u64 stats_period;
+	struct vmm_timer_event stats_ev;
+	struct vmm_notifier_block nb;
+};
+
+static u32 virtio_balloon_get_host_features(struct vmm_virtio_device *dev)
+{
+	return (1UL << VMM_VIRTIO_BALLOON_F_STATS_VQ) |
+	       (1UL << VMM_VIRTIO_BALLOON_F_DEFLATE_ON_OOM) |
+	       (1UL << VMM_VIRTIO_BALLOON_F_REPORTING);
+}
+
+static void virtio_balloon_set_guest_features(struct vmm_virtio_device *dev,
+					      u32 features)
+{
+	struct virtio_balloon_dev *bdev = dev->emu_data;
+
+	bdev->features = features & virtio_balloon_get_host_features(dev);
+}
+
+/*
+ * Guest only creates queues for negotiated features so, the queue
+ * number seen by guest has to be mapped to our queue number.
+ */
+static int virtio_balloon_queue(struct virtio_balloon_dev *bdev, u32 vq)
+{
+	u32 q;
+
+	for (q = 0; q < VIRTIO_BALLOON_NUM_QUEUES; q++) {
+		if ((q == VIRTIO_BALLOON_STATS_QUEUE) &&
+		    !(bdev->features & (1UL << VMM_VIRTIO_BALLOON_F_STATS_VQ))) {
+			continue;
+		}
+		if ((q == VIRTIO_BALLOON_REPORTING_QUEUE) &&
+		    !(bdev->features & (1UL << VMM_VIRTIO_BALLOON_F_REPORTING))) {
+			continue;
+		}
+		if (!vq) {
+			return q;
+		}
+		vq--;
+	}
+
+	return VMM_EINVALID;
+}
+
+static int virtio_balloon_init_vq(struct vmm_virtio_device *dev,
+				  u32 vq, u32 page_size, u32 align, u32 pfn)
+{
+	struct virtio_balloon_dev *bdev = dev->emu_data;
+	int q = virtio_balloon_queue(bdev, vq);
+
+	if (q < 0) {
+		return q;
+	}
+
+	return vmm_virtio_queue_setup(&bdev->vqs[q], dev->guest,
+			pfn, page_size, VIRTIO_BALLOON_QUEUE_SIZE, align);
+}
+
+static int virtio_balloon_get_pfn_vq(struct vmm_virtio_device *dev, u32 vq)
+{
+	struct virtio_balloon_dev *bdev = dev->emu_data;
+	int q = virtio_balloon_queue(bdev, vq);
+
+	if (q < 0) {
+		return q;
+	}
+
+	return vmm_virtio_queue_guest_pfn(&bdev->vqs[q]);
+}
+
+static int virtio_balloon_get_size_vq(struct vmm_virtio_device *dev, u32 vq)
+{
+	struct virtio_balloon_dev *bdev = dev->emu_data;
+
+	return (virtio_balloon_queue(bdev, vq) < 0) ?
+				0 : VIRTIO_BALLOON_QUEUE_SIZE;
+}
+
+static int virtio_balloon_set_size_vq(struct vmm_virtio_device *dev,
+				      u32 vq, int size)
+{
+	/* FIXME: dynamic */
+	return size;
+}
+
+static struct virtio_balloon_area *virtio_balloon_area_get(
+					struct virtio_balloon_dev *bdev,
+					physical_addr_t gpa)
+{
+	u32 npages;
+	struct vmm_region *reg;
+	struct virtio_balloon_area *area;
+
+	reg = vmm_guest_find_region(bdev->guest, gpa,
+				    VMM_REGION_MEMORY, FALSE);
+	if (!reg ||
+	    !(reg->flags & VMM_REGION_REAL) ||
+	    !(reg->flags & VMM_REGION_ISONDEMAND)) {
+		return NULL;
+	}
+
+	list_for_each_entry(area, &bdev->area_list, head) {
+		if (area->reg == reg) {
+			return area;
+		}
+	}
+
+	/* First page ballooned from this region */
+	area = vmm_zalloc(sizeof(*area));
+	if (!area) {
+		return NULL;
+	}
+	npages = VMM_REGION_PHYS_SIZE(reg) >> VMM_VIRTIO_BALLOON_PFN_SHIFT;
+	area->pages = vmm_zalloc(bitmap_estimate_size(npages));
+	area->chunk_pages = vmm_zalloc(sizeof(u32) *
+					VMM_REGION_MAPS_COUNT(reg));
+	if (!area->pages || !area->chunk_pages) {
+		if (area->pages) {
+			vmm_free(area->pages);
+		}
+		if (area->chunk_pages) {
+			vmm_free(area->chunk_pages);
+		}
+		vmm_free(area);
+		return NULL;
+	}
+	INIT_LIST_HEAD(&area->head);
+	area->reg = reg;
+	list_add_tail(&area->head, &bdev->area_list);
+
+	return area;
+}
+
+static void virtio_balloon_area_clear(struct virtio_balloon_dev *bdev,
+				      bool free)
+{
+	u32 npages;
+	struct virtio_balloon_area *area;
+
+	if (free) {
+		while (!list_empty(&bdev->area_list)) {
+			area = list_first_entry(&bdev->area_list,
+					struct virtio_balloon_area, head);
+			list_del(&area->head);
+			vmm_free(area->chunk_pages);
+			vmm_free(area->pages);
+			vmm_free(area);
+		}
+		return;
+	}
+
+	list_for_each_entry(area, &bdev->area_list, head) {
+		npages = VMM_REGION_PHYS_SIZE(area->reg) >>
+					VMM_VIRTIO_BALLOON_PFN_SHIFT;
+		bitmap_zero(area->pages, npages);
+		memset(area->chunk_pages, 0,
+		       sizeof(u32) * VMM_REGION_MAPS_COUNT(area->reg));
+	}
+}
+
+static void virtio_balloon_page(struct virtio_balloon_dev *bdev,
+				u32 pfn, bool inflate)
+{
+	u32 page, chunk, chunk_npages;
+	physical_addr_t gpa, cstart;
+	physical_size_t csize;
+	struct vmm_region *reg;
+	struct virtio_balloon_area *area;
+
+	gpa = (physical_addr_t)pfn << VMM_VIRTIO_BALLOON_PFN_SHIFT;
+	area = virtio_balloon_area_get(bdev, gpa);
+	if (!area) {
+		return;
+	}
+	reg = area->reg;
+
+	page = (gpa - VMM_REGION_GPHYS_START(reg)) >>
+					VMM_VIRTIO_BALLOON_PFN_SHIFT;
+	chunk = (gpa - VMM_REGION_GPHYS_START(reg)) >> reg->map_order;
+	cstart = VMM_REGION_GPHYS_START(reg) +
+			((physical_addr_t)chunk << reg->map_order);
+	csize = min((physical_size_t)1 << reg->map_order,
+		    (physical_size_t)(VMM_REGION_GPHYS_END(reg) - cstart));
+	chunk_npages = csize >> VMM_VIRTIO_BALLOON_PFN_SHIFT;
+
+	if (!inflate) {
+		if (__test_and_clear_bit(page, area->pages)) {
+			area->chunk_pages[chunk]--;
+		}
+		return;
+	}
+
+	if (__test_and_set_bit(page, area->pages)) {
+		return;
+	}
+	area->chunk_pages[chunk]++;
+
+	/* Give back host RAM when whole chunk is inside balloon */
+	if (area->chunk_pages[chunk] == chunk_npages) {
+		vmm_guest_ondemand_release(bdev->guest, cstart, csize);
+	}
+}
+
+static void virtio_balloon_do_pfns(struct vmm_virtio_device *dev,
+				   struct virtio_balloon_dev *bdev,
+				   u32 q, bool inflate)
+{
+	u16 head = 0;
+	u32 pfns[VIRTIO_BALLOON_PFN_BATCH];
+	u32 i, j, len, iov_cnt = 0, total_len = 0;
+	struct vmm_virtio_queue *vq = &bdev->vqs[q];
+	struct vmm_virtio_iovec *iov = bdev->iov;
+	struct vmm_virtio_iovec tiov;
+
+	while (vmm_virtio_queue_available(vq)) {
+		head = vmm_virtio_queue_get_iovec(vq, iov,
+						  &iov_cnt, &total_len);
+
+		for (i = 0; i < iov_cnt; i++) {
+			memcpy(&tiov, &iov[i], sizeof(tiov));
+			while (tiov.len >= sizeof(u32)) {
+				len = min(tiov.len, (u32)sizeof(pfns));
+				len &= ~(sizeof(u32) - 1);
+				len = vmm_virtio_iovec_to_buf_read(dev, &tiov,
+							1, pfns, len);
+				if (!len) {
+					break;
+				}
+				for (j = 0; j < (len / sizeof(u32)); j++) {
+					virtio_balloon_page(bdev, pfns[j],
+							    inflate);
+				}
+				tiov.addr += len;
+				tiov.len -= len;
+			}
+		}
+
+		vmm_virtio_queue_set_used_elem(vq, head, 0);
+	}
+
+	if (vmm_virtio_queue_should_signal(vq)) {
+		dev->tra->notify(dev, q);
+	}
+}
+
+static void virtio_balloon_do_reporting(struct vmm_virtio_device *dev,
+					struct virtio_balloon_dev *bdev)
+{
+	u16 head = 0;
+	u32 i, iov_cnt = 0, total_len = 0;
+	struct vmm_virtio_queue *vq =
+			&bdev->vqs[VIRTIO_BALLOON_REPORTING_QUEUE];
+	struct vmm_virtio_iovec *iov = bdev->iov;
+
+	while (vmm_virtio_queue_available(vq)) {
+		head = vmm_virtio_queue_get_iovec(vq, iov,
+						  &iov_cnt, &total_len);
+
+		/* Each IO vector is a free page range of guest */
+		for (i = 0; i < iov_cnt; i++) {
+			vmm_guest_ondemand_release(bdev->guest,
+						   iov[i].addr, iov[i].len);
+		}
+
+		vmm_virtio_queue_set_used_elem(vq, head, 0);
+	}
+
+	if (vmm_virtio_queue_should_signal(vq)) {
+		dev->tra->notify(dev, VIRTIO_BALLOON_REPORTING_QUEUE);
+	}
+}
+
+static void virtio_balloon_do_stats(struct vmm_virtio_device *dev,
+				    struct virtio_balloon_dev *bdev)
+{
+	u32 i, len, iov_cnt = 0, total_len = 0;
+	struct vmm_virtio_queue *vq = &bdev->vqs[VIRTIO_BALLOON_STATS_QUEUE];
+	struct vmm_virtio_iovec *iov = bdev->iov;
+	struct vmm_virtio_iovec tiov;
+	struct vmm_virtio_balloon_stat stat;
+
+	if (!vmm_virtio_queue_available(vq)) {
+		return;
+	}
+
+	bdev->stats_head = vmm_virtio_queue_get_iovec(vq, iov,
+						      &iov_cnt, &total_len);
+	bdev->stats_pending = TRUE;
+
+	for (i = 0; i < iov_cnt; i++) {
+		memcpy(&tiov, &iov[i], sizeof(tiov));
+		while (tiov.len >= sizeof(stat)) {
+			len = vmm_virtio_iovec_to_buf_read(dev, &tiov, 1,
+							&stat, sizeof(stat));
+			if (len != sizeof(stat)) {
+				break;
+			}
+			vmm_guest_balloon_update_stat(bdev->guest,
+						      stat.tag, stat.val);
+			tiov.addr += len;
+			tiov.len -= len;
+		}
+	}
+}
+
+/* Give back the stats buffer so that guest refreshes statistics */
+static void virtio_balloon_request_stats(struct virtio_balloon_dev *bdev)
+{
+	struct vmm_virtio_device *dev = bdev->vdev;
+	struct vmm_virtio_queue *vq = &bdev->vqs[VIRTIO_BALLOON_STATS_QUEUE];
+
+	if (!bdev->stats_pending) {
+		return;
+	}
+	bdev->stats_pending = FALSE;
+
+	vmm_virtio_queue_set_used_elem(vq, bdev->stats_head, 0);
+	dev->tra->notify(dev, VIRTIO_BALLOON_STATS_QUEUE);
+}
+
+static void virtio_balloon_stats_event(struct vmm_timer_event *ev)
+{
+	irq_flags_t flags;
+	struct virtio_balloon_dev *bdev = ev->priv;
+
+	vmm_spin_lock_irqsave(&bdev->lock, flags);
+	virtio_balloon_request_stats(bdev);
+	vmm_spin_unlock_irqrestore(&bdev->lock, flags);
+
+	vmm_timer_event_start(ev, bdev->stats_period);
+}
+
+static int virtio_balloon_notify_vq(struct vmm_virtio_device *dev, u32 vq)
+{
+	int q, rc = VMM_OK;
+	irq_flags_t flags;
+	struct virtio_balloon_dev *bdev = dev->emu_data;
+
+	q = virtio_balloon_queue(bdev, vq);
+
+	vmm_spin_lock_irqsave(&bdev->lock, flags);
+
+	switch (q) {
+	case VIRTIO_BALLOON_INFLATE_QUEUE:
+		virtio_balloon_do_pfns(dev, bdev, q, TRUE);
+		break;
+	case VIRTIO_BALLOON_DEFLATE_QUEUE:
+		virtio_balloon_do_pfns(dev, bdev, q, FALSE);
+		break;
+	case VIRTIO_BALLOON_STATS_QUEUE:
+		virtio_balloon_do_stats(dev, bdev);
+		break;
+	case VIRTIO_BALLOON_REPORTING_QUEUE:
+		virtio_balloon_do_reporting(dev, bdev);
+		break;
+	default:
+		rc = VMM_EINVALID;
+		break;
+	}
+
+	vmm_spin_unlock_irqrestore(&bdev->lock, flags);
+
+	return rc;
+}
+
+static void virtio_balloon_status_changed(struct vmm_virtio_device *dev,
+					  u32 new_status)
+{
+	/* Nothing to do here. */
+}
+
+static int virtio_balloon_read_config(struct vmm_virtio_device *dev,
+				      u32 offset, void *dst, u32 dst_len)
+{
+	struct virtio_balloon_dev *bdev = dev->emu_data;
+	u8 *src = (u8 *)&bdev->config;
+	u32 i, src_len = sizeof(bdev->config);
+
+	for (i = 0; (i < dst_len) && ((offset + i) < src_len); i++) {
+		*((u8 *)dst + i) = src[offset + i];
+	}
+
+	return VMM_OK;
+}
+
+static int virtio_balloon_write_config(struct vmm_virtio_device *dev,
+				       u32 offset, void *src, u32 src_len)
+{
+	struct virtio_balloon_dev *bdev = dev->emu_data;
+	u8 *dst = (u8 *)&bdev->config;
+	u32 i, start = offsetof(struct vmm_virtio_balloon_config, actual);
+
+	/* Only actual number of pages is writeable by guest */
+	for (i = 0; i < src_len; i++) {
+		if (((offset + i) < start) ||
+		    ((start + sizeof(u32)) <= (offset + i))) {
+			continue;
+		}
+		dst[offset + i] = *((u8 *)src + i);
+	}
+
+	vmm_guest_balloon_update_size(bdev->guest,
+		(physical_size_t)bdev->config.actual <<
+					VMM_VIRTIO_BALLOON_PFN_SHIFT);
+
+	return VMM_OK;
+}
+
+static int virtio_balloon_reset(struct vmm_virtio_device *dev)
+{
+	int rc;
+	u32 q;
+	irq_flags_t flags;
+	struct virtio_balloon_dev *bdev = dev->emu_data;
+
+	vmm_spin_lock_irqsave(&bdev->lock, flags);
+
+	/* Guest forgets about the balloon upon reset */
+	virtio_balloon_area_clear(bdev, FALSE);
+	bdev->config.actual = 0;
+	bdev->stats_pending = FALSE;
+
+	for (q = 0; q < VIRTIO_BALLOON_NUM_QUEUES; q++) {
+		rc = vmm_virtio_queue_cleanup(&bdev->vqs[q]);
+		if (rc) {
+			vmm_spin_unlock_irqrestore(&bdev->lock, flags);
+			return rc;
+		}
+	}
+
+	vmm_spin_unlock_irqrestore(&bdev->lock, flags);
+
+	vmm_guest_balloon_update_size(bdev->guest, 0);
+
+	return VMM_OK;
+}
+
+static u32 virtio_balloon_target_pages(struct vmm_guest *guest)
+{
+	physical_size_t target = vmm_guest_balloon_target(guest);
+
+	target >>= VMM_VIRTIO_BALLOON_PFN_SHIFT;
+
+	return (target > 0xFFFFFFFFULL) ? 0xFFFFFFFF : (u32)target;
+}
+
+static int virtio_balloon_guest_aspace_notification(
+					struct vmm_notifier_block *nb,
+					unsigned long evt, void *data)
+{
+	irq_flags_t flags;
+	struct vmm_guest_aspace_event *edata = data;
+	struct virtio_balloon_dev *bdev =
+			container_of(nb, struct virtio_balloon_dev, nb);
+	struct vmm_virtio_device *dev = bdev->vdev;
+
+	/* We are only interested in events for our guest */
+	if (bdev->guest != edata->guest) {
+		return NOTIFY_DONE;
+	}
+
+	switch (evt) {
+	case VMM_GUEST_ASPACE_EVENT_BALLOON:
+		vmm_spin_lock_irqsave(&bdev->lock, flags);
+		bdev->config.num_pages =
+				virtio_balloon_target_pages(bdev->guest);
+		virtio_balloon_request_stats(bdev);
+		vmm_spin_unlock_irqrestore(&bdev->lock, flags);
+		if (dev->tra && dev->tra->config_changed) {
+			dev->tra->config_changed(dev);
+		}
+		break;
+	case VMM_GUEST_ASPACE_EVENT_DEINIT:
+		/* Regions are about to go away */
+		vmm_spin_lock_irqsave(&bdev->lock, flags);
+		virtio_balloon_area_clear(bdev, TRUE);
+		vmm_spin_unlock_irqrestore(&bdev->lock, flags);
+		break;
+	default:
+		return NOTIFY_DONE;
+	};
+
+	return NOTIFY_OK;
+}
+
+static int virtio_balloon_connect(struct vmm_virtio_device *dev,
+				  struct vmm_virtio_emulator *emu)
+{
+	int rc;
+	u32 period = 0;
+	struct virtio_balloon_dev *bdev;
+
+	bdev = vmm_zalloc(sizeof(struct virtio_balloon_dev));
+	if (!bdev) {
+		vmm_printf("Failed to allocate virtio balloon device....\n");
+		return VMM_ENOMEM;
+	}
+	bdev->vdev = dev;
+	bdev->guest = dev->guest;
+
+	INIT_SPIN_LOCK(&bdev->lock);
+	INIT_LIST_HEAD(&bdev->area_list);
+	bdev->config.num_pages = virtio_balloon_target_pages(bdev->guest);
+
+	/* Optional periodic refresh of guest memory statistics */
+	vmm_devtree_read_u32(dev->edev->node,
+			     VIRTIO_BALLOON_STATS_PERIOD_ATTR_NAME, &period);
+	bdev->stats_period = (u64)period * 1000000ULL;
+	INIT_TIMER_EVENT(&bdev->stats_ev, virtio_balloon_stats_event, bdev);
+
+	bdev->nb.notifier_call = &virtio_balloon_guest_aspace_notification;
+	bdev->nb.priority = 0;
+	rc = vmm_guest_aspace_register_client(&bdev->nb);
+	if (rc) {
+		vmm_free(bdev);
+		return rc;
+	}
+
+	dev->emu_data = bdev;
+
+	if (bdev->stats_period) {
+		vmm_timer_event_start(&bdev->stats_ev, bdev->stats_period);
+	}
+
+	return VMM_OK;
+}
+
+static void virtio_balloon_disconnect(struct vmm_virtio_device *dev)
+{
+	irq_flags_t flags;
+	struct virtio_balloon_dev *bdev = dev->emu_data;
+
+	vmm_timer_event_stop(&bdev->stats_ev);
+	vmm_guest_aspace_unregister_client(&bdev->nb);
+
+	vmm_spin_lock_irqsave(&bdev->lock, flags);
+	virtio_balloon_area_clear(bdev, TRUE);
+	vmm_spin_unlock_irqrestore(&bdev->lock, flags);
+
+	vmm_free(bdev);
+}
+
+struct vmm_virtio_device_id virtio_balloon_emu_id[] = {
+	{ .type = VMM_VIRTIO_ID_BALLOON },
+	{ },
+};
+
+struct vmm_virtio_emulator virtio_balloon = {
+	.name = "virtio_balloon",
+	.id_table = virtio_balloon_emu_id,
+
+	/* VirtIO operations */
+	.get_host_features      = virtio_balloon_get_host_features,
+	.set_guest_features     = virtio_balloon_set_guest_features,
+	.init_vq                = virtio_balloon_init_vq,
+	.get_pfn_vq             = virtio_balloon_get_pfn_vq,
+	.get_size_vq            = virtio_balloon_get_size_vq,
+	.set_size_vq            = virtio_balloon_set_size_vq,
+	.notify_vq              = virtio_balloon_notify_vq,
+	.status_changed         = virtio_balloon_status_changed,
+
+	/* Emulator operations */
+	.read_config = virtio_balloon_read_config,
+	.write_config = virtio_balloon_write_config,
+	.reset = virtio_balloon_reset,
+	.connect = virtio_balloon_connect,
+	.disconnect = virtio_balloon_disconnect,
+};
+
+static int __init virtio_balloon_init(void)
+{
+	return vmm_virtio_register_emulator(&virtio_balloon);
+}
+
+static void __exit virtio_balloon_exit(void)
+{
+	vmm_virtio_unregister_emulator(&virtio_balloon);
+}
+
+VMM_DECLARE_MODULE(MODULE_DESC,
+			MODULE_AUTHOR,
+			MODULE_LICENSE,
+			MODULE_IPRIORITY,
+			MODULE_INIT,
+			MODULE_EXIT);
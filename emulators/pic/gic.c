@@ -944,6 +944,104 @@ static int gic_emulator_reset(struct vmm_emudev *edev)
 	return gic_state_reset(s);
 }
 
+/* GIC state saved in guest snapshots */
+struct gic_saved_cpu_state {
+	u32 enabled;
+	u16 priority_mask;
+	u16 running_irq;
+	u16 running_priority;
+	u16 last_active[GIC_MAX_NIRQ];
+	u8 priority[32];
+};
+
+struct gic_saved_state {
+	u32 enabled;
+	u32 num_cpu;
+	u32 num_irq;
+	struct gic_irq_state irq_state[GIC_MAX_NIRQ];
+	struct gic_saved_cpu_state cpu_state[GIC_MAX_NCPU];
+};
+
+static u32 gic_emulator_state_size(struct vmm_emudev *edev)
+{
+	return sizeof(struct gic_saved_state);
+}
+
+static int gic_emulator_state_save(struct vmm_emudev *edev,
+				   void *buf, u32 size)
+{
+	u32 i;
+	irq_flags_t flags;
+	struct gic_state *s = edev->priv;
+	struct gic_saved_state *st = buf;
+	struct gic_cpu_state *cpu_state;
+
+	memset(st, 0, sizeof(*st));
+	st->num_cpu = GIC_NUM_CPU(s);
+	st->num_irq = GIC_NUM_IRQ(s);
+
+	vmm_read_lock_irqsave(&s->dist_lock, flags);
+	st->enabled = s->enabled;
+	memcpy(st->irq_state, s->irq_state, sizeof(st->irq_state));
+	vmm_read_unlock_irqrestore(&s->dist_lock, flags);
+
+	for (i = 0; i < GIC_NUM_CPU(s); i++) {
+		cpu_state = &s->cpu_state[i];
+		vmm_read_lock_irqsave(&cpu_state->cpu_lock, flags);
+		st->cpu_state[i].enabled = cpu_state->enabled;
+		st->cpu_state[i].priority_mask = cpu_state->priority_mask;
+		st->cpu_state[i].running_irq = cpu_state->running_irq;
+		st->cpu_state[i].running_priority =
+					cpu_state->running_priority;
+		memcpy(st->cpu_state[i].last_active, cpu_state->last_active,
+		       sizeof(st->cpu_state[i].last_active));
+		memcpy(st->cpu_state[i].priority, cpu_state->priority,
+		       sizeof(st->cpu_state[i].priority));
+		vmm_read_unlock_irqrestore(&cpu_state->cpu_lock, flags);
+	}
+
+	return VMM_OK;
+}
+
+static int gic_emulator_state_restore(struct vmm_emudev *edev,
+				      const void *buf, u32 size)
+{
+	u32 i;
+	irq_flags_t flags;
+	struct gic_state *s = edev->priv;
+	const struct gic_saved_state *st = buf;
+	struct gic_cpu_state *cpu_state;
+
+	if ((st->num_cpu != GIC_NUM_CPU(s)) ||
+	    (st->num_irq != GIC_NUM_IRQ(s))) {
+		return VMM_EINVALID;
+	}
+
+	vmm_write_lock_irqsave(&s->dist_lock, flags);
+	s->enabled = (st->enabled) ? TRUE : FALSE;
+	memcpy(s->irq_state, st->irq_state, sizeof(s->irq_state));
+	vmm_write_unlock_irqrestore(&s->dist_lock, flags);
+
+	for (i = 0; i < GIC_NUM_CPU(s); i++) {
+		cpu_state = &s->cpu_state[i];
+		vmm_write_lock_irqsave(&cpu_state->cpu_lock, flags);
+		cpu_state->enabled = (st->cpu_state[i].enabled) ? TRUE : FALSE;
+		cpu_state->priority_mask = st->cpu_state[i].priority_mask;
+		cpu_state->running_irq = st->cpu_state[i].running_irq;
+		cpu_state->running_priority =
+					st->cpu_state[i].running_priority;
+		memcpy(cpu_state->last_active, st->cpu_state[i].last_active,
+		       sizeof(cpu_state->last_active));
+		memcpy(cpu_state->priority, st->cpu_state[i].priority,
+		       sizeof(cpu_state->priority));
+		vmm_write_unlock_irqrestore(&cpu_state->cpu_lock, flags);
+	}
+
+	gic_update(s);
+
+	return VMM_OK;
+}
+
 static u32 gic_configs[][14] = {
 	{
 		/* num_irq */ 96,
@@ -1205,6 +1303,9 @@ static struct vmm_emulator gic_emulator = {
 	.write32 = gic_emulator_write32,
 	.reset = gic_emulator_reset,
 	.remove = gic_emulator_remove,
+	.state_size = gic_emulator_state_size,
+	.state_save = gic_emulator_state_save,
+	.state_restore = gic_emulator_state_restore,
 };
 
 static int __init gic_emulator_init(void)
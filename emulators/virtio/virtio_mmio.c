@@ -54,6 +54,17 @@ static int virtio_mmio_notify(struct vmm_virtio_device *dev, u32 vq)
 	return VMM_OK;
 }
 
+static int virtio_mmio_config_changed(struct vmm_virtio_device *dev)
+{
+	struct virtio_mmio_dev *m = dev->tra_data;
+
+	m->config.interrupt_state |= VMM_VIRTIO_MMIO_INT_CONFIG;
+
+	vmm_devemu_emulate_irq(m->guest, m->irq, 1);
+
+	return VMM_OK;
+}
+
 int virtio_mmio_config_read(struct virtio_mmio_dev *m,
 			    u32 offset, void *dst, u32 dst_len)
 {
@@ -263,6 +274,7 @@ static int virtio_mmio_reset(struct vmm_emudev *edev)
 static struct vmm_virtio_transport mmio_tra = {
 	.name = "virtio_mmio",
 	.notify = virtio_mmio_notify,
+	.config_changed = virtio_mmio_config_changed,
 };
 
 static int virtio_mmio_probe(struct vmm_guest *guest,
@@ -59,6 +59,17 @@ static int virtio_pci_notify(struct vmm_virtio_device *dev, u32 vq)
 	return VMM_OK;
 }
 
+static int virtio_pci_config_changed(struct vmm_virtio_device *dev)
+{
+	struct virtio_pci_dev *m = dev->tra_data;
+
+	m->config.interrupt_state |= VMM_VIRTIO_PCI_INT_CONFIG;
+
+	vmm_devemu_emulate_irq(m->guest, m->irq, 1);
+
+	return VMM_OK;
+}
+
 int virtio_pci_config_read(struct virtio_pci_dev *m,
 			   u32 offset, void *dst, u32 dst_len)
 {
@@ -168,6 +179,7 @@ static int virtio_pci_write(struct virtio_pci_dev *m,
 static struct vmm_virtio_transport pci_tra = {
 	.name = "virtio_pci",
 	.notify = virtio_pci_notify,
+	.config_changed = virtio_pci_config_changed,
 };
 
 static int virtio_pci_emulator_reset(struct pci_device *pdev)
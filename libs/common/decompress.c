@@ -0,0 +1,1012 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file decompress.c
+ * @author agent (agent@local)
+ * @brief Streaming decompression library
+ *
+ * Decompressed bytes are produced into a ring buffer which always
+ * holds the last 64KB of output as history for back references of
+ * deflate and LZ4. Whenever 64KB of output is pending it is passed
+ * to the write callback so the whole stream is decompressed using
+ * a fixed amount of scratch memory.
+ *
+ * Deflate decoding follows the canonical Huffman decoding of RFC1951
+ * with a lookup table for short codes. LZ4 block checksums and content
+ * checksums are skipped whereas gzip CRC32 and size are verified.
+ */
+
+#include <vmm_error.h>
+#include <vmm_heap.h>
+#include <vmm_modules.h>
+#include <libs/stringlib.h>
+#include <libs/decompress.h>
+
+#define DC_IN_SIZE			(16 * 1024)
+#define DC_WIN_SIZE			(128 * 1024)
+#define DC_WIN_MASK			(DC_WIN_SIZE - 1)
+#define DC_FLUSH_SIZE			(DC_WIN_SIZE / 2)
+
+#define DC_MAXBITS			15
+#define DC_FAST_BITS			9
+#define DC_FAST_MASK			((1U << DC_FAST_BITS) - 1)
+#define DC_MAXLCODES			286
+#define DC_MAXDCODES			30
+#define DC_FIXLCODES			288
+
+#define GZIP_FHCRC			0x02
+#define GZIP_FEXTRA			0x04
+#define GZIP_FNAME			0x08
+#define GZIP_FCOMMENT			0x10
+
+#define LZ4_FRAME_MAGIC			0x184D2204
+#define LZ4_LEGACY_MAGIC		0x184C2102
+#define LZ4_SKIP_MAGIC			0x184D2A50
+#define LZ4_SKIP_MAGIC_MASK		0xFFFFFFF0
+#define LZ4_LEGACY_BLOCK_MAX		(8 * 1024 * 1024)
+#define LZ4_FLG_VERSION(flg)		(((flg) >> 6) & 0x3)
+#define LZ4_FLG_BCHECKSUM		0x10
+#define LZ4_FLG_CSIZE			0x08
+#define LZ4_FLG_CCHECKSUM		0x04
+#define LZ4_FLG_DICTID			0x01
+#define LZ4_BD_BMAX(bd)			(((bd) >> 4) & 0x7)
+#define LZ4_BLOCK_UNCOMPRESSED		0x80000000
+
+/* Canonical Huffman code with lookup table for short codes.
+ * Each fast[] entry is (code length << DC_FAST_BITS) | symbol
+ * or zero when code is longer than DC_FAST_BITS.
+ */
+struct dc_huff {
+	u16 count[DC_MAXBITS + 1];
+	u16 symbol[DC_FIXLCODES];
+	u16 fast[1 << DC_FAST_BITS];
+};
+
+struct dc_ctx {
+	decompress_read_t read;
+	decompress_write_t write;
+	void *priv;
+	int rc;
+
+	u8 *in;
+	u32 in_pos;
+	u32 in_len;
+	bool in_eof;
+	u64 in_bytes;
+
+	u32 bitbuf;
+	u32 bitcnt;
+
+	u8 *win;
+	u64 pos;
+	u64 flushed;
+
+	bool crc_on;
+	u32 crc;
+	u32 crc_table[256];
+
+	struct dc_huff lencode;
+	struct dc_huff distcode;
+};
+
+static inline void dc_fail(struct dc_ctx *c, int err)
+{
+	if (!c->rc) {
+		c->rc = err;
+	}
+}
+
+static u32 dc_refill(struct dc_ctx *c)
+{
+	int rc;
+
+	if (c->in_eof) {
+		return 0;
+	}
+
+	rc = c->read(c->priv, c->in, DC_IN_SIZE);
+	if (rc <= 0) {
+		if (rc < 0) {
+			dc_fail(c, rc);
+		}
+		c->in_eof = TRUE;
+		return 0;
+	}
+
+	c->in_pos = 0;
+	c->in_len = rc;
+	c->in_bytes += rc;
+
+	return rc;
+}
+
+/* Retrive next input byte or -1 at end of input */
+static inline int dc_byte(struct dc_ctx *c)
+{
+	if ((c->in_pos == c->in_len) && !dc_refill(c)) {
+		return -1;
+	}
+
+	return c->in[c->in_pos++];
+}
+
+/* Check for end of input without consuming input byte */
+static inline bool dc_eof(struct dc_ctx *c)
+{
+	return ((c->in_pos == c->in_len) && !dc_refill(c)) ? TRUE : FALSE;
+}
+
+static void dc_skip(struct dc_ctx *c, u32 count)
+{
+	while (count--) {
+		if (dc_byte(c) < 0) {
+			dc_fail(c, VMM_EIO);
+			return;
+		}
+	}
+}
+
+/* Read little-endian u32 from input
+ * Note: returns VMM_ENOENT when input ends before first byte
+ */
+static int dc_le32(struct dc_ctx *c, u32 *val)
+{
+	int i, b;
+
+	*val = 0;
+	for (i = 0; i < 4; i++) {
+		b = dc_byte(c);
+		if (b < 0) {
+			return (i) ? VMM_EIO : VMM_ENOENT;
+		}
+		*val |= (u32)b << (8 * i);
+	}
+
+	return VMM_OK;
+}
+
+static void dc_crc_init(struct dc_ctx *c)
+{
+	u32 i, j, crc;
+
+	for (i = 0; i < 256; i++) {
+		crc = i;
+		for (j = 0; j < 8; j++) {
+			crc = (crc & 1) ? ((crc >> 1) ^ 0xEDB88320) : (crc >> 1);
+		}
+		c->crc_table[i] = crc;
+	}
+}
+
+static void dc_flush(struct dc_ctx *c)
+{
+	u32 i, start, len;
+
+	while (!c->rc && (c->flushed < c->pos)) {
+		start = c->flushed & DC_WIN_MASK;
+		len = c->pos - c->flushed;
+		if ((DC_WIN_SIZE - start) < len) {
+			len = DC_WIN_SIZE - start;
+		}
+
+		if (c->crc_on) {
+			for (i = start; i < (start + len); i++) {
+				c->crc = c->crc_table[(c->crc ^ c->win[i]) & 0xff] ^
+					 (c->crc >> 8);
+			}
+		}
+
+		c->rc = c->write(c->priv, &c->win[start], len);
+		c->flushed += len;
+	}
+}
+
+static inline void dc_out(struct dc_ctx *c, u8 val)
+{
+	c->win[c->pos & DC_WIN_MASK] = val;
+	c->pos++;
+	if ((c->pos - c->flushed) >= DC_FLUSH_SIZE) {
+		dc_flush(c);
+	}
+}
+
+static void dc_copy(struct dc_ctx *c, u32 dist, u32 len)
+{
+	u64 src;
+
+	if (!dist || (c->pos < dist) || (DC_FLUSH_SIZE < dist)) {
+		dc_fail(c, VMM_EINVALID);
+		return;
+	}
+
+	src = c->pos - dist;
+	while (len--) {
+		dc_out(c, c->win[src++ & DC_WIN_MASK]);
+	}
+}
+
+/* ========== Deflate (RFC1951) ========== */
+
+static u32 dc_bits(struct dc_ctx *c, u32 need)
+{
+	int b;
+	u32 val;
+
+	while (c->bitcnt < need) {
+		b = dc_byte(c);
+		if (b < 0) {
+			dc_fail(c, VMM_EIO);
+			return 0;
+		}
+		c->bitbuf |= (u32)b << c->bitcnt;
+		c->bitcnt += 8;
+	}
+
+	val = c->bitbuf & ((1U << need) - 1);
+	c->bitbuf >>= need;
+	c->bitcnt -= need;
+
+	return val;
+}
+
+/* Retrive next byte after discarding bits of partially used byte */
+static int dc_aligned_byte(struct dc_ctx *c)
+{
+	c->bitbuf >>= (c->bitcnt & 7);
+	c->bitcnt &= ~7U;
+
+	if (c->bitcnt) {
+		return dc_bits(c, 8);
+	}
+
+	return dc_byte(c);
+}
+
+static int dc_decode(struct dc_ctx *c, struct dc_huff *h)
+{
+	int b, code, first, count, index;
+	u32 len, e;
+
+	/* Peek as many bits as possible without failing at end of input */
+	while (c->bitcnt < DC_MAXBITS) {
+		b = dc_byte(c);
+		if (b < 0) {
+			break;
+		}
+		c->bitbuf |= (u32)b << c->bitcnt;
+		c->bitcnt += 8;
+	}
+
+	e = h->fast[c->bitbuf & DC_FAST_MASK];
+	if (e) {
+		len = e >> DC_FAST_BITS;
+		if (c->bitcnt < len) {
+			goto fail;
+		}
+		c->bitbuf >>= len;
+		c->bitcnt -= len;
+		return e & DC_FAST_MASK;
+	}
+
+	code = first = index = 0;
+	for (len = 1; len <= DC_MAXBITS; len++) {
+		if (c->bitcnt < len) {
+			break;
+		}
+		code |= (c->bitbuf >> (len - 1)) & 1;
+		count = h->count[len];
+		if (code < (first + count)) {
+			c->bitbuf >>= len;
+			c->bitcnt -= len;
+			return h->symbol[index + (code - first)];
+		}
+		index += count;
+		first += count;
+		first <<= 1;
+		code <<= 1;
+	}
+
+fail:
+	dc_fail(c, VMM_EINVALID);
+	return -1;
+}
+
+static u32 dc_reverse(u32 code, u32 len)
+{
+	u32 ret = 0;
+
+	while (len--) {
+		ret = (ret << 1) | (code & 1);
+		code >>= 1;
+	}
+
+	return ret;
+}
+
+/* Build canonical Huffman code from code lengths
+ * Note: returns zero for complete code, positive value for
+ * incomplete code and negative value for over-subscribed code
+ */
+static int dc_build(struct dc_huff *h, const u16 *length, u32 n)
+{
+	int left;
+	u32 sym, len, i, idx, code, r;
+	u16 offs[DC_MAXBITS + 1];
+
+	memset(h->count, 0, sizeof(h->count));
+	for (sym = 0; sym < n; sym++) {
+		h->count[length[sym]]++;
+	}
+
+	left = 1;
+	for (len = 1; len <= DC_MAXBITS; len++) {
+		left <<= 1;
+		left -= h->count[len];
+		if (left < 0) {
+			return left;
+		}
+	}
+
+	offs[1] = 0;
+	for (len = 1; len < DC_MAXBITS; len++) {
+		offs[len + 1] = offs[len] + h->count[len];
+	}
+	for (sym = 0; sym < n; sym++) {
+		if (length[sym]) {
+			h->symbol[offs[length[sym]]++] = sym;
+		}
+	}
+
+	memset(h->fast, 0, sizeof(h->fast));
+	code = idx = 0;
+	for (len = 1; len <= DC_FAST_BITS; len++) {
+		for (i = 0; i < h->count[len]; i++) {
+			sym = h->symbol[idx++];
+			for (r = dc_reverse(code, len); r <= DC_FAST_MASK;
+			     r += (1U << len)) {
+				h->fast[r] = (len << DC_FAST_BITS) | sym;
+			}
+			code++;
+		}
+		code <<= 1;
+	}
+
+	return left;
+}
+
+static const u16 dc_lbase[29] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const u8 dc_lext[29] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const u16 dc_dbase[30] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+	8193, 12289, 16385, 24577 };
+static const u8 dc_dext[30] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+static void dc_codes(struct dc_ctx *c)
+{
+	int sym;
+	u32 len, dist;
+
+	while (!c->rc) {
+		sym = dc_decode(c, &c->lencode);
+		if (sym < 0) {
+			return;
+		} else if (sym < 256) {
+			dc_out(c, sym);
+			continue;
+		} else if (sym == 256) {
+			return;
+		}
+
+		sym -= 257;
+		if (29 <= sym) {
+			dc_fail(c, VMM_EINVALID);
+			return;
+		}
+		len = dc_lbase[sym] + dc_bits(c, dc_lext[sym]);
+
+		sym = dc_decode(c, &c->distcode);
+		if (sym < 0) {
+			return;
+		} else if (30 <= sym) {
+			dc_fail(c, VMM_EINVALID);
+			return;
+		}
+		dist = dc_dbase[sym] + dc_bits(c, dc_dext[sym]);
+		if (c->rc) {
+			return;
+		}
+
+		dc_copy(c, dist, len);
+	}
+}
+
+static void dc_stored(struct dc_ctx *c)
+{
+	int b;
+	u32 len, nlen;
+
+	/* Length fields start at next byte boundary */
+	b = dc_aligned_byte(c);
+	len = (b < 0) ? 0 : b;
+	len |= dc_bits(c, 8) << 8;
+	nlen = dc_bits(c, 16);
+	if (c->rc || (b < 0) || (len != (~nlen & 0xffff))) {
+		dc_fail(c, VMM_EINVALID);
+		return;
+	}
+
+	while (len--) {
+		b = dc_aligned_byte(c);
+		if (b < 0) {
+			dc_fail(c, VMM_EIO);
+			return;
+		}
+		dc_out(c, b);
+	}
+}
+
+static void dc_fixed(struct dc_ctx *c)
+{
+	u32 sym;
+	u16 lengths[DC_FIXLCODES];
+
+	for (sym = 0; sym < 144; sym++) {
+		lengths[sym] = 8;
+	}
+	for (; sym < 256; sym++) {
+		lengths[sym] = 9;
+	}
+	for (; sym < 280; sym++) {
+		lengths[sym] = 7;
+	}
+	for (; sym < DC_FIXLCODES; sym++) {
+		lengths[sym] = 8;
+	}
+	dc_build(&c->lencode, lengths, DC_FIXLCODES);
+
+	for (sym = 0; sym < DC_MAXDCODES; sym++) {
+		lengths[sym] = 5;
+	}
+	dc_build(&c->distcode, lengths, DC_MAXDCODES);
+
+	dc_codes(c);
+}
+
+static void dc_dynamic(struct dc_ctx *c)
+{
+	static const u8 order[19] = {
+		16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+	int sym, err;
+	u32 nlen, ndist, ncode, index, len, rep;
+	u16 lengths[DC_MAXLCODES + DC_MAXDCODES];
+
+	nlen = dc_bits(c, 5) + 257;
+	ndist = dc_bits(c, 5) + 1;
+	ncode = dc_bits(c, 4) + 4;
+	if (c->rc) {
+		return;
+	}
+	if ((DC_MAXLCODES < nlen) || (DC_MAXDCODES < ndist)) {
+		goto fail;
+	}
+	memset(lengths, 0, sizeof(lengths));
+
+	/* Code length code */
+	for (index = 0; index < ncode; index++) {
+		lengths[order[index]] = dc_bits(c, 3);
+	}
+	for (; index < 19; index++) {
+		lengths[order[index]] = 0;
+	}
+	if (c->rc) {
+		return;
+	}
+	if (dc_build(&c->lencode, lengths, 19)) {
+		goto fail;
+	}
+
+	/* Literal/length and distance code lengths */
+	index = 0;
+	while (index < (nlen + ndist)) {
+		sym = dc_decode(c, &c->lencode);
+		if (sym < 0) {
+			return;
+		}
+		if (sym < 16) {
+			lengths[index++] = sym;
+			continue;
+		}
+
+		len = 0;
+		if (sym == 16) {
+			if (!index) {
+				goto fail;
+			}
+			len = lengths[index - 1];
+			rep = 3 + dc_bits(c, 2);
+		} else if (sym == 17) {
+			rep = 3 + dc_bits(c, 3);
+		} else {
+			rep = 11 + dc_bits(c, 7);
+		}
+		if (c->rc) {
+			return;
+		}
+		if ((nlen + ndist) < (index + rep)) {
+			goto fail;
+		}
+		while (rep--) {
+			lengths[index++] = len;
+		}
+	}
+
+	/* End-of-block code must be present */
+	if (!lengths[256]) {
+		goto fail;
+	}
+
+	/* Incomplete codes are allowed only for single code */
+	err = dc_build(&c->lencode, lengths, nlen);
+	if (err && ((err < 0) ||
+	    (nlen != (c->lencode.count[0] + c->lencode.count[1])))) {
+		goto fail;
+	}
+	err = dc_build(&c->distcode, lengths + nlen, ndist);
+	if (err && ((err < 0) ||
+	    (ndist != (c->distcode.count[0] + c->distcode.count[1])))) {
+		goto fail;
+	}
+
+	dc_codes(c);
+	return;
+
+fail:
+	dc_fail(c, VMM_EINVALID);
+}
+
+static void dc_inflate(struct dc_ctx *c)
+{
+	u32 last, type;
+
+	do {
+		last = dc_bits(c, 1);
+		type = dc_bits(c, 2);
+		if (c->rc) {
+			return;
+		}
+
+		switch (type) {
+		case 0:
+			dc_stored(c);
+			break;
+		case 1:
+			dc_fixed(c);
+			break;
+		case 2:
+			dc_dynamic(c);
+			break;
+		default:
+			dc_fail(c, VMM_EINVALID);
+			break;
+		};
+	} while (!c->rc && !last);
+}
+
+static void dc_gunzip(struct dc_ctx *c)
+{
+	int b, i;
+	u64 start;
+	u32 flags, len, crc, isize;
+	bool first = TRUE;
+
+	dc_crc_init(c);
+
+	while (!c->rc) {
+		/* Trailing data after a gzip member is ignored */
+		b = dc_aligned_byte(c);
+		if (!first && (b != 0x1f)) {
+			break;
+		}
+		if ((b != 0x1f) ||
+		    (dc_aligned_byte(c) != 0x8b) ||
+		    (dc_aligned_byte(c) != 0x08)) {
+			dc_fail(c, VMM_EINVALID);
+			break;
+		}
+
+		/* Skip flags, mtime, extra flags and OS */
+		b = dc_aligned_byte(c);
+		flags = b;
+		for (i = 0; (i < 6) && (0 <= b); i++) {
+			b = dc_aligned_byte(c);
+		}
+		if ((0 <= b) && (flags & GZIP_FEXTRA)) {
+			len = b = dc_aligned_byte(c);
+			if (0 <= b) {
+				b = dc_aligned_byte(c);
+				len |= (u32)b << 8;
+			}
+			while ((0 <= b) && len--) {
+				b = dc_aligned_byte(c);
+			}
+		}
+		if ((0 <= b) && (flags & GZIP_FNAME)) {
+			while ((b = dc_aligned_byte(c)) > 0) ;
+		}
+		if ((0 <= b) && (flags & GZIP_FCOMMENT)) {
+			while ((b = dc_aligned_byte(c)) > 0) ;
+		}
+		if ((0 <= b) && (flags & GZIP_FHCRC)) {
+			dc_aligned_byte(c);
+			b = dc_aligned_byte(c);
+		}
+		if (b < 0) {
+			dc_fail(c, VMM_EIO);
+			break;
+		}
+
+		start = c->pos;
+		c->crc = 0xffffffff;
+		c->crc_on = TRUE;
+
+		dc_inflate(c);
+		dc_flush(c);
+		if (c->rc) {
+			break;
+		}
+
+		crc = isize = 0;
+		for (i = 0; i < 4; i++) {
+			b = dc_aligned_byte(c);
+			crc |= (u32)(b & 0xff) << (8 * i);
+		}
+		for (i = 0; i < 4; i++) {
+			b = dc_aligned_byte(c);
+			isize |= (u32)(b & 0xff) << (8 * i);
+		}
+		if (b < 0) {
+			dc_fail(c, VMM_EIO);
+			break;
+		}
+		if ((crc != (c->crc ^ 0xffffffff)) ||
+		    (isize != (u32)(c->pos - start))) {
+			dc_fail(c, VMM_EINVALID);
+			break;
+		}
+
+		first = FALSE;
+	}
+}
+
+/* ========== LZ4 ========== */
+
+/* Retrive next byte of a compressed block or -1 when block ends */
+static inline int dc_lz4_byte(struct dc_ctx *c, u32 *remain)
+{
+	int b;
+
+	if (!*remain) {
+		return -1;
+	}
+	b = dc_byte(c);
+	if (b < 0) {
+		dc_fail(c, VMM_EIO);
+		return -1;
+	}
+	(*remain)--;
+
+	return b;
+}
+
+static void dc_lz4_block(struct dc_ctx *c, u32 remain)
+{
+	int b, token;
+	u32 lit, mlen, off;
+
+	while (!c->rc && remain) {
+		token = dc_lz4_byte(c, &remain);
+		if (token < 0) {
+			goto fail;
+		}
+
+		lit = token >> 4;
+		if (lit == 15) {
+			do {
+				b = dc_lz4_byte(c, &remain);
+				lit += (b < 0) ? 0 : b;
+			} while (b == 255);
+			if (b < 0) {
+				goto fail;
+			}
+		}
+		if (remain < lit) {
+			goto fail;
+		}
+		while (lit--) {
+			dc_out(c, dc_lz4_byte(c, &remain));
+		}
+
+		/* Last sequence of a block has only literals */
+		if (!remain) {
+			break;
+		}
+
+		b = dc_lz4_byte(c, &remain);
+		off = dc_lz4_byte(c, &remain);
+		if ((b < 0) || ((int)off < 0)) {
+			goto fail;
+		}
+		off = (off << 8) | b;
+
+		mlen = (token & 0xf) + 4;
+		if ((token & 0xf) == 15) {
+			do {
+				b = dc_lz4_byte(c, &remain);
+				mlen += (b < 0) ? 0 : b;
+			} while (b == 255);
+			if (b < 0) {
+				goto fail;
+			}
+		}
+
+		dc_copy(c, off, mlen);
+	}
+
+	return;
+
+fail:
+	dc_fail(c, VMM_EINVALID);
+}
+
+static void dc_lz4_frame(struct dc_ctx *c)
+{
+	int flg, bd;
+	u32 bsize, bmax;
+
+	flg = dc_byte(c);
+	bd = dc_byte(c);
+	if ((flg < 0) || (bd < 0)) {
+		dc_fail(c, VMM_EIO);
+		return;
+	}
+	if ((LZ4_FLG_VERSION(flg) != 1) || (LZ4_BD_BMAX(bd) < 4)) {
+		dc_fail(c, VMM_EINVALID);
+		return;
+	}
+	if (flg & LZ4_FLG_DICTID) {
+		dc_fail(c, VMM_ENOTSUPP);
+		return;
+	}
+	bmax = 1U << (8 + 2 * LZ4_BD_BMAX(bd));
+
+	/* Skip content size and header checksum */
+	dc_skip(c, (flg & LZ4_FLG_CSIZE) ? 9 : 1);
+
+	while (!c->rc) {
+		if (dc_le32(c, &bsize)) {
+			dc_fail(c, VMM_EIO);
+			return;
+		}
+		if (!bsize) {
+			break;
+		}
+
+		if (bsize & LZ4_BLOCK_UNCOMPRESSED) {
+			bsize &= ~LZ4_BLOCK_UNCOMPRESSED;
+			if (bmax < bsize) {
+				dc_fail(c, VMM_EINVALID);
+				return;
+			}
+			while (!c->rc && bsize) {
+				dc_out(c, dc_lz4_byte(c, &bsize));
+			}
+		} else {
+			if (bmax < bsize) {
+				dc_fail(c, VMM_EINVALID);
+				return;
+			}
+			dc_lz4_block(c, bsize);
+		}
+
+		if (flg & LZ4_FLG_BCHECKSUM) {
+			dc_skip(c, 4);
+		}
+	}
+
+	if (flg & LZ4_FLG_CCHECKSUM) {
+		dc_skip(c, 4);
+	}
+}
+
+static void dc_lz4_legacy(struct dc_ctx *c)
+{
+	int rc;
+	u32 bsize;
+
+	while (!c->rc) {
+		rc = dc_le32(c, &bsize);
+		if (rc == VMM_ENOENT) {
+			break;
+		} else if (rc) {
+			dc_fail(c, rc);
+			break;
+		}
+
+		/* Concatenated legacy frames */
+		if (bsize == LZ4_LEGACY_MAGIC) {
+			continue;
+		}
+		/* Last word is uncompressed size appended by kbuild */
+		if (dc_eof(c)) {
+			break;
+		}
+		if (LZ4_LEGACY_BLOCK_MAX < bsize) {
+			dc_fail(c, VMM_EINVALID);
+			break;
+		}
+
+		dc_lz4_block(c, bsize);
+	}
+}
+
+static void dc_unlz4(struct dc_ctx *c)
+{
+	int rc;
+	u32 magic, size;
+	bool first = TRUE;
+
+	while (!c->rc) {
+		rc = dc_le32(c, &magic);
+		if (rc == VMM_ENOENT && !first) {
+			break;
+		} else if (rc) {
+			dc_fail(c, VMM_EIO);
+			break;
+		}
+
+		if (magic == LZ4_FRAME_MAGIC) {
+			dc_lz4_frame(c);
+		} else if (magic == LZ4_LEGACY_MAGIC) {
+			dc_lz4_legacy(c);
+		} else if ((magic & LZ4_SKIP_MAGIC_MASK) == LZ4_SKIP_MAGIC) {
+			if (dc_le32(c, &size)) {
+				dc_fail(c, VMM_EIO);
+				break;
+			}
+			dc_skip(c, size);
+		} else if (first) {
+			dc_fail(c, VMM_EINVALID);
+		} else {
+			/* Trailing data after last frame is ignored */
+			break;
+		}
+
+		first = FALSE;
+	}
+
+	dc_flush(c);
+}
+
+enum decompress_format decompress_detect(const void *buf, u32 len)
+{
+	u32 magic;
+	const u8 *b = buf;
+
+	if (!b) {
+		return DECOMPRESS_NONE;
+	}
+
+	if ((3 <= len) && (b[0] == 0x1f) && (b[1] == 0x8b) && (b[2] == 0x08)) {
+		return DECOMPRESS_GZIP;
+	}
+
+	if (4 <= len) {
+		magic = (u32)b[0] | ((u32)b[1] << 8) |
+			((u32)b[2] << 16) | ((u32)b[3] << 24);
+		if ((magic == LZ4_FRAME_MAGIC) ||
+		    (magic == LZ4_LEGACY_MAGIC) ||
+		    ((magic & LZ4_SKIP_MAGIC_MASK) == LZ4_SKIP_MAGIC)) {
+			return DECOMPRESS_LZ4;
+		}
+	}
+
+	return DECOMPRESS_NONE;
+}
+VMM_EXPORT_SYMBOL(decompress_detect);
+
+const char *decompress_format_name(enum decompress_format fmt)
+{
+	switch (fmt) {
+	case DECOMPRESS_GZIP:
+		return "gzip";
+	case DECOMPRESS_LZ4:
+		return "lz4";
+	default:
+		break;
+	};
+
+	return "none";
+}
+VMM_EXPORT_SYMBOL(decompress_format_name);
+
+int decompress_stream(enum decompress_format fmt,
+		      decompress_read_t read,
+		      decompress_write_t write,
+		      void *priv, u64 *in_bytes, u64 *out_bytes)
+{
+	int rc;
+	struct dc_ctx *c;
+
+	if (!read || !write) {
+		return VMM_EINVALID;
+	}
+
+	c = vmm_zalloc(sizeof(*c));
+	if (!c) {
+		return VMM_ENOMEM;
+	}
+	c->read = read;
+	c->write = write;
+	c->priv = priv;
+
+	c->in = vmm_malloc(DC_IN_SIZE);
+	c->win = vmm_malloc(DC_WIN_SIZE);
+	if (!c->in || !c->win) {
+		rc = VMM_ENOMEM;
+		goto done;
+	}
+
+	switch (fmt) {
+	case DECOMPRESS_GZIP:
+		dc_gunzip(c);
+		break;
+	case DECOMPRESS_LZ4:
+		dc_unlz4(c);
+		break;
+	default:
+		dc_fail(c, VMM_ENOTSUPP);
+		break;
+	};
+	rc = c->rc;
+
+	if (in_bytes) {
+		*in_bytes = c->in_bytes;
+	}
+	if (out_bytes) {
+		*out_bytes = c->flushed;
+	}
+
+done:
+	if (c->win) {
+		vmm_free(c->win);
+	}
+	if (c->in) {
+		vmm_free(c->in);
+	}
+	vmm_free(c);
+
+	return rc;
+}
+VMM_EXPORT_SYMBOL(decompress_stream);
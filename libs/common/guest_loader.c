@@ -0,0 +1,454 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file guest_loader.c
+ * @author agent (agent@local)
+ * @brief Guest image loader library
+ *
+ * Destination guest region is resolved once for each contiguous host
+ * physical span and file data is read straight into a temporary host
+ * mapping of the span using large VFS requests. Pages which already
+ * have a host mapping, or which can't be mapped because virtual address
+ * space is short, are loaded through a bounce buffer instead so that
+ * existing memory attributes are never changed.
+ *
+ * Compressed images (gzip or LZ4) are detected from their leading
+ * bytes and decompressed on the fly so each chunk of decompressed
+ * output is written to destination memory as soon as it is ready.
+ * Detection is skipped for GUEST_LOADER_RAW loads so that images
+ * which merely start with a compression magic are loaded as-is.
+ */
+
+#include <vmm_error.h>
+#include <vmm_heap.h>
+#include <vmm_mutex.h>
+#include <vmm_stdio.h>
+#include <vmm_timer.h>
+#include <vmm_threads.h>
+#include <vmm_workqueue.h>
+#include <vmm_completion.h>
+#include <vmm_host_aspace.h>
+#include <vmm_host_vapool.h>
+#include <vmm_guest_aspace.h>
+#include <vmm_guest_dedup.h>
+#include <vmm_manager.h>
+#include <libs/stringlib.h>
+#include <libs/vfs.h>
+#include <libs/decompress.h>
+#include <libs/guest_loader.h>
+
+/* Keep some virtual address space free for rest of the system */
+#define LOADER_VAPOOL_RESERVE_PAGES	256
+
+struct guest_loader_job {
+	struct vmm_work work;
+	struct vmm_completion done;
+	struct vmm_guest *guest;
+	physical_addr_t pa;
+	char path[VFS_MAX_PATH];
+	u32 off;
+	u32 len;
+	u32 flags;
+	int rc;
+	struct guest_loader_stats stats;
+};
+
+struct loader_ctx {
+	struct vmm_guest *guest;
+	physical_addr_t pa;
+	u32 len;
+	int fd;
+	void *bounce;
+	struct guest_loader_stats *stats;
+};
+
+static DEFINE_MUTEX(loader_wq_lock);
+static struct vmm_workqueue *loader_wq;
+
+static int loader_read(int fd, void *buf, u32 len)
+{
+	size_t cnt;
+
+	while (len) {
+		cnt = vfs_read(fd, buf, len);
+		if (cnt < 1) {
+			return VMM_EIO;
+		}
+		buf += cnt;
+		len -= cnt;
+	}
+
+	return VMM_OK;
+}
+
+/* Cheap check to skip mapping attempts which are known to fail
+ * Note: vmm_host_memmap_try() still decides whether mapping is possible
+ */
+static bool loader_can_map(physical_addr_t hpa, u32 len)
+{
+	virtual_addr_t va;
+	physical_addr_t end = hpa + len;
+
+	if (vmm_host_vapool_free_page_count() <
+	    (LOADER_VAPOOL_RESERVE_PAGES + VMM_SIZE_TO_PAGE(len) + 1)) {
+		return FALSE;
+	}
+
+	for (hpa &= ~VMM_PAGE_MASK; hpa < end; hpa += VMM_PAGE_SIZE) {
+		if (vmm_host_pa2va(hpa, &va) == VMM_OK) {
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+static int loader_copy_chunk(struct loader_ctx *ctx,
+			     physical_addr_t hpa, u32 len)
+{
+	int rc;
+	virtual_addr_t va;
+	physical_addr_t page_pa = hpa & ~VMM_PAGE_MASK;
+	virtual_size_t map_sz = VMM_ROUNDUP2_PAGE_SIZE(hpa - page_pa + len);
+
+	if (loader_can_map(hpa, len) &&
+	    !vmm_host_memmap_try(page_pa, map_sz,
+				 VMM_MEMORY_FLAGS_NORMAL_NOCACHE, &va)) {
+		rc = loader_read(ctx->fd, (void *)(va + (hpa - page_pa)), len);
+		vmm_host_memunmap(va);
+		ctx->stats->direct_chunks++;
+		return rc;
+	}
+
+	if (!ctx->bounce) {
+		ctx->bounce = vmm_malloc(GUEST_LOADER_CHUNK_SIZE);
+		if (!ctx->bounce) {
+			return VMM_ENOMEM;
+		}
+	}
+
+	rc = loader_read(ctx->fd, ctx->bounce, len);
+	if (rc) {
+		return rc;
+	}
+	if (vmm_host_memory_write(hpa, ctx->bounce, len, FALSE) != len) {
+		return VMM_EIO;
+	}
+	ctx->stats->bounce_chunks++;
+
+	return VMM_OK;
+}
+
+static int loader_copy_span(struct loader_ctx *ctx,
+			    physical_addr_t hpa, u32 len)
+{
+	int rc;
+	u32 chunk;
+
+	while (len) {
+		chunk = (len < GUEST_LOADER_CHUNK_SIZE) ?
+			len : GUEST_LOADER_CHUNK_SIZE;
+		rc = loader_copy_chunk(ctx, hpa, chunk);
+		if (rc) {
+			return rc;
+		}
+		hpa += chunk;
+		len -= chunk;
+	}
+
+	return VMM_OK;
+}
+
+/* Resolve host physical span backing next destination bytes
+ * Note: every successful call must be followed by loader_span_put()
+ */
+static int loader_span_get(struct loader_ctx *ctx,
+			   physical_addr_t *hpa, u32 *span)
+{
+	struct vmm_region *reg;
+	physical_size_t avail = 0;
+
+	if (!ctx->guest) {
+		*hpa = ctx->pa;
+		*span = ctx->len;
+		return VMM_OK;
+	}
+
+	vmm_guest_memory_access_begin(ctx->guest);
+
+	reg = vmm_guest_find_region(ctx->guest, ctx->pa,
+				VMM_REGION_REAL | VMM_REGION_MEMORY, TRUE);
+	if (reg) {
+		vmm_guest_find_mapping(ctx->guest, reg, ctx->pa, hpa, &avail);
+	}
+	if (!avail) {
+		vmm_guest_memory_access_end(ctx->guest);
+		return (reg) ? VMM_EFAIL : VMM_ENOTAVAIL;
+	}
+	*span = (avail < ctx->len) ? avail : ctx->len;
+
+	return VMM_OK;
+}
+
+static void loader_span_put(struct loader_ctx *ctx, u32 done)
+{
+	if (ctx->guest) {
+		if (done && ctx->guest->aspace.dirty_log) {
+			vmm_guest_dirty_log_mark(ctx->guest, ctx->pa, done);
+		}
+		vmm_guest_memory_access_end(ctx->guest);
+	}
+
+	ctx->pa += done;
+	ctx->len -= done;
+	ctx->stats->bytes += done;
+}
+
+static int loader_load_raw(struct loader_ctx *ctx)
+{
+	int rc;
+	u32 span;
+	physical_addr_t hpa;
+
+	while (ctx->len) {
+		rc = loader_span_get(ctx, &hpa, &span);
+		if (rc) {
+			return rc;
+		}
+		rc = loader_copy_span(ctx, hpa, span);
+		loader_span_put(ctx, (rc) ? 0 : span);
+		if (rc) {
+			return rc;
+		}
+	}
+
+	return VMM_OK;
+}
+
+static int loader_decompress_read(void *priv, void *buf, u32 len)
+{
+	struct loader_ctx *ctx = priv;
+
+	return vfs_read(ctx->fd, buf, len);
+}
+
+static int loader_decompress_write(void *priv, const void *buf, u32 len)
+{
+	int rc;
+	u32 span, done;
+	physical_addr_t hpa;
+	struct loader_ctx *ctx = priv;
+
+	while (len) {
+		if (!ctx->len) {
+			return VMM_ENOSPC;
+		}
+		rc = loader_span_get(ctx, &hpa, &span);
+		if (rc) {
+			return rc;
+		}
+		span = (len < span) ? len : span;
+		done = vmm_host_memory_write(hpa, (void *)buf, span, FALSE);
+		loader_span_put(ctx, done);
+		if (done != span) {
+			return VMM_EIO;
+		}
+		buf += span;
+		len -= span;
+	}
+
+	return VMM_OK;
+}
+
+int guest_loader_load(struct vmm_guest *guest, physical_addr_t pa,
+		      const char *path, u32 off, u32 len, u32 flags,
+		      struct guest_loader_stats *stats)
+{
+	int rc;
+	u64 tstamp;
+	size_t cnt;
+	struct stat st;
+	struct loader_ctx ctx;
+	struct guest_loader_stats tmp;
+	u8 magic[DECOMPRESS_MAGIC_SIZE];
+
+	if (!path) {
+		return VMM_EINVALID;
+	}
+
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.guest = guest;
+	ctx.pa = pa;
+	ctx.stats = (stats) ? stats : &tmp;
+	memset(ctx.stats, 0, sizeof(*ctx.stats));
+	tstamp = vmm_timer_timestamp();
+
+	ctx.fd = vfs_open(path, O_RDONLY, 0);
+	if (ctx.fd < 0) {
+		return ctx.fd;
+	}
+
+	rc = vfs_fstat(ctx.fd, &st);
+	if (rc) {
+		goto done;
+	}
+	if (!(st.st_mode & S_IFREG) || (st.st_size <= off)) {
+		rc = VMM_EINVALID;
+		goto done;
+	}
+
+	/* Detect compressed image from leading bytes */
+	if (vfs_lseek(ctx.fd, off, SEEK_SET) != off) {
+		rc = VMM_EIO;
+		goto done;
+	}
+	if (flags & GUEST_LOADER_RAW) {
+		ctx.stats->format = DECOMPRESS_NONE;
+	} else {
+		cnt = vfs_read(ctx.fd, magic, sizeof(magic));
+		ctx.stats->format = decompress_detect(magic, cnt);
+	}
+	if (vfs_lseek(ctx.fd, off, SEEK_SET) != off) {
+		rc = VMM_EIO;
+		goto done;
+	}
+
+	if (ctx.stats->format != DECOMPRESS_NONE) {
+		/* Destination byte count limits decompressed output */
+		ctx.len = len;
+		rc = decompress_stream(ctx.stats->format,
+					loader_decompress_read,
+					loader_decompress_write,
+					&ctx, &ctx.stats->file_bytes, NULL);
+	} else {
+		ctx.len = ((st.st_size - off) < len) ? (st.st_size - off) : len;
+		rc = loader_load_raw(&ctx);
+		ctx.stats->file_bytes = ctx.stats->bytes;
+	}
+
+done:
+	if (ctx.bounce) {
+		vmm_free(ctx.bounce);
+	}
+	vfs_close(ctx.fd);
+	ctx.stats->nsecs = vmm_timer_timestamp() - tstamp;
+
+	return rc;
+}
+
+static void loader_work_func(struct vmm_work *work)
+{
+	struct guest_loader_job *job =
+			container_of(work, struct guest_loader_job, work);
+
+	job->rc = guest_loader_load(job->guest, job->pa, job->path,
+				    job->off, job->len, job->flags,
+				    &job->stats);
+	if (job->guest) {
+		vmm_manager_guest_dref(job->guest);
+	}
+
+	vmm_completion_complete(&job->done);
+}
+
+static struct vmm_workqueue *loader_get_wq(void)
+{
+	struct vmm_workqueue *wq;
+
+	vmm_mutex_lock(&loader_wq_lock);
+	if (!loader_wq) {
+		/* One unpinned worker per host CPU */
+		loader_wq = vmm_workqueue_create_flags("guest_loader",
+						VMM_THREAD_DEF_PRIORITY,
+						VMM_WORKQUEUE_UNBOUND);
+	}
+	wq = loader_wq;
+	vmm_mutex_unlock(&loader_wq_lock);
+
+	return wq;
+}
+
+struct guest_loader_job *guest_loader_submit(struct vmm_guest *guest,
+					     physical_addr_t pa,
+					     const char *path,
+					     u32 off, u32 len, u32 flags)
+{
+	struct vmm_workqueue *wq;
+	struct guest_loader_job *job;
+
+	if (!path || (VFS_MAX_PATH <= strlen(path))) {
+		return NULL;
+	}
+
+	wq = loader_get_wq();
+	if (!wq) {
+		return NULL;
+	}
+
+	/* Keep guest alive until job is done */
+	if (guest && vmm_manager_guest_ref(guest)) {
+		return NULL;
+	}
+
+	job = vmm_zalloc(sizeof(*job));
+	if (!job) {
+		goto fail;
+	}
+	INIT_WORK(&job->work, loader_work_func);
+	INIT_COMPLETION(&job->done);
+	job->guest = guest;
+	job->pa = pa;
+	strcpy(job->path, path);
+	job->off = off;
+	job->len = len;
+	job->flags = flags;
+	job->rc = VMM_OK;
+
+	if (vmm_workqueue_schedule_work(wq, &job->work)) {
+		vmm_free(job);
+		goto fail;
+	}
+
+	return job;
+
+fail:
+	if (guest) {
+		vmm_manager_guest_dref(guest);
+	}
+	return NULL;
+}
+
+int guest_loader_wait(struct guest_loader_job *job,
+		      struct guest_loader_stats *stats)
+{
+	int rc;
+
+	if (!job) {
+		return VMM_EINVALID;
+	}
+
+	vmm_completion_wait(&job->done);
+
+	rc = job->rc;
+	if (stats) {
+		memcpy(stats, &job->stats, sizeof(*stats));
+	}
+	vmm_free(job);
+
+	return rc;
+}
@@ -0,0 +1,784 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file guest_snapshot.c
+ * @author agent (agent@local)
+ * @brief Guest snapshot and restore library
+ *
+ * Guest RAM is streamed through a large bounce buffer so that the
+ * snapshot file is written (and read back) using few large VFS
+ * requests. Runs of zero pages are recorded without any payload.
+ */
+
+#include <vmm_error.h>
+#include <vmm_heap.h>
+#include <vmm_delay.h>
+#include <vmm_smp.h>
+#include <vmm_stdio.h>
+#include <vmm_timer.h>
+#include <vmm_manager.h>
+#include <vmm_devemu.h>
+#include <vmm_host_aspace.h>
+#include <vmm_guest_aspace.h>
+#include <arch_vcpu.h>
+#include <libs/stringlib.h>
+#include <libs/vfs.h>
+#include <libs/guest_snapshot.h>
+
+#define SNAPSHOT_BUF_SIZE		(1024 * 1024)
+#define SNAPSHOT_SYNC_TIMEOUT_MSECS	1000
+
+#define SNAPSHOT_VCPU_ACTIVE_STATES	(VMM_VCPU_STATE_READY | \
+					 VMM_VCPU_STATE_RUNNING | \
+					 VMM_VCPU_STATE_PAUSED)
+
+struct snapshot_ctx {
+	struct vmm_guest *guest;
+	struct guest_snapshot_stats *stats;
+	int fd;
+	int rc;
+	void *buf;
+	physical_addr_t zero_addr;
+	physical_size_t zero_size;
+	u32 devemu_expected;
+};
+
+static bool snapshot_ram_region(struct vmm_region *reg)
+{
+	u32 req = VMM_REGION_REAL | VMM_REGION_MEMORY | VMM_REGION_ISRAM;
+
+	if ((reg->flags & req) != req) {
+		return FALSE;
+	}
+
+	return (reg->flags & (VMM_REGION_ALIAS | VMM_REGION_VIRTUAL |
+			      VMM_REGION_ISDEVICE | VMM_REGION_ISSHARED)) ?
+		FALSE : TRUE;
+}
+
+static bool snapshot_is_zero(const void *data, u32 len)
+{
+	u32 i;
+	const unsigned long *p = data;
+	const u8 *b;
+
+	for (i = 0; i < (len / sizeof(unsigned long)); i++) {
+		if (p[i]) {
+			return FALSE;
+		}
+	}
+
+	b = data;
+	for (i = i * sizeof(unsigned long); i < len; i++) {
+		if (b[i]) {
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+static void snapshot_sync_func(void *arg0, void *arg1, void *arg2)
+{
+	/* Nothing to do. */
+}
+
+static int snapshot_quiesce_iter(struct vmm_vcpu *vcpu, void *priv)
+{
+	u32 hcpu, retry = SNAPSHOT_SYNC_TIMEOUT_MSECS;
+	int rc;
+
+	/* Guest pause is asynchronous so wait for VCPU state change */
+	while (!(vmm_manager_vcpu_get_state(vcpu) &
+		 (VMM_VCPU_STATE_RESET | VMM_VCPU_STATE_PAUSED |
+		  VMM_VCPU_STATE_HALTED))) {
+		if (!retry--) {
+			return VMM_ETIMEDOUT;
+		}
+		vmm_msleep(1);
+	}
+
+	/*
+	 * Paused VCPU might still be on its host CPU until the host
+	 * CPU reschedules so wait for a function call on that host CPU.
+	 */
+	if ((rc = vmm_manager_vcpu_get_hcpu(vcpu, &hcpu))) {
+		return rc;
+	}
+
+	return vmm_smp_ipi_sync_call(vmm_cpumask_of(hcpu),
+				     SNAPSHOT_SYNC_TIMEOUT_MSECS,
+				     snapshot_sync_func, NULL, NULL, NULL);
+}
+
+static int snapshot_active_iter(struct vmm_vcpu *vcpu, void *priv)
+{
+	bool *activep = priv;
+
+	if (vmm_manager_vcpu_get_state(vcpu) &
+	    (VMM_VCPU_STATE_READY | VMM_VCPU_STATE_RUNNING)) {
+		*activep = TRUE;
+	}
+
+	return VMM_OK;
+}
+
+static int snapshot_pause(struct vmm_guest *guest, bool *was_running)
+{
+	int rc;
+
+	*was_running = FALSE;
+	vmm_manager_guest_vcpu_iterate(guest, snapshot_active_iter,
+				       was_running);
+	if (*was_running) {
+		if ((rc = vmm_manager_guest_pause(guest))) {
+			return rc;
+		}
+	}
+
+	return vmm_manager_guest_vcpu_iterate(guest,
+					      snapshot_quiesce_iter, NULL);
+}
+
+static int snapshot_write(struct snapshot_ctx *ctx,
+			  void *data, size_t len)
+{
+	if (ctx->rc) {
+		return ctx->rc;
+	}
+
+	if (vfs_write(ctx->fd, data, len) != len) {
+		ctx->rc = VMM_EIO;
+		return ctx->rc;
+	}
+	ctx->stats->file_bytes += len;
+
+	return VMM_OK;
+}
+
+static int snapshot_write_record(struct snapshot_ctx *ctx, u32 type, u32 id,
+				 u64 addr, u64 size, void *payload)
+{
+	struct guest_snapshot_record rec;
+
+	rec.type = type;
+	rec.id = id;
+	rec.addr = addr;
+	rec.size = size;
+	snapshot_write(ctx, &rec, sizeof(rec));
+	if (payload && size) {
+		snapshot_write(ctx, payload, size);
+	}
+
+	return ctx->rc;
+}
+
+static void snapshot_flush_zero(struct snapshot_ctx *ctx)
+{
+	if (!ctx->zero_size) {
+		return;
+	}
+
+	snapshot_write_record(ctx, GUEST_SNAPSHOT_REC_RAM_ZERO, 0,
+			      ctx->zero_addr, ctx->zero_size, NULL);
+	ctx->stats->zero_bytes += ctx->zero_size;
+	ctx->zero_size = 0;
+}
+
+static void snapshot_add_zero(struct snapshot_ctx *ctx,
+			      physical_addr_t gpa, physical_size_t size)
+{
+	if (ctx->zero_size && ((ctx->zero_addr + ctx->zero_size) != gpa)) {
+		snapshot_flush_zero(ctx);
+	}
+	if (!ctx->zero_size) {
+		ctx->zero_addr = gpa;
+	}
+	ctx->zero_size += size;
+}
+
+static void snapshot_save_range(struct snapshot_ctx *ctx,
+				physical_addr_t gpa, physical_addr_t end)
+{
+	u32 len, pos, run, plen;
+	u8 *buf = ctx->buf;
+
+	while (!ctx->rc && (gpa < end)) {
+		len = ((end - gpa) < SNAPSHOT_BUF_SIZE) ?
+				(end - gpa) : SNAPSHOT_BUF_SIZE;
+		if (vmm_guest_memory_read(ctx->guest, gpa,
+					  buf, len, TRUE) != len) {
+			ctx->rc = VMM_EIO;
+			break;
+		}
+
+		pos = 0;
+		while (!ctx->rc && (pos < len)) {
+			plen = ((len - pos) < VMM_PAGE_SIZE) ?
+					(len - pos) : VMM_PAGE_SIZE;
+			if (snapshot_is_zero(&buf[pos], plen)) {
+				snapshot_add_zero(ctx, gpa + pos, plen);
+				pos += plen;
+				continue;
+			}
+
+			/* Write consecutive non-zero pages at once */
+			run = plen;
+			while ((pos + run) < len) {
+				plen = ((len - pos - run) < VMM_PAGE_SIZE) ?
+						(len - pos - run) : VMM_PAGE_SIZE;
+				if (snapshot_is_zero(&buf[pos + run], plen)) {
+					break;
+				}
+				run += plen;
+			}
+
+			snapshot_flush_zero(ctx);
+			snapshot_write_record(ctx, GUEST_SNAPSHOT_REC_RAM, 0,
+					      gpa + pos, run, &buf[pos]);
+			ctx->stats->ram_bytes += run;
+			pos += run;
+		}
+
+		gpa += len;
+	}
+}
+
+static void snapshot_save_region(struct vmm_guest *guest,
+				 struct vmm_region *reg, void *priv)
+{
+	u32 i;
+	struct snapshot_ctx *ctx = priv;
+	physical_addr_t start, end;
+	physical_size_t chunk;
+
+	if (ctx->rc || !snapshot_ram_region(reg)) {
+		return;
+	}
+
+	if (!(reg->flags & VMM_REGION_ISONDEMAND)) {
+		snapshot_save_range(ctx, VMM_REGION_GPHYS_START(reg),
+				    VMM_REGION_GPHYS_END(reg));
+		snapshot_flush_zero(ctx);
+		return;
+	}
+
+	/* Chunks not populated yet are zero so don't populate them */
+	chunk = (physical_size_t)1 << reg->map_order;
+	for (i = 0; !ctx->rc && (i < reg->maps_count); i++) {
+		start = VMM_REGION_GPHYS_START(reg) + i * chunk;
+		end = start + chunk;
+		if (VMM_REGION_GPHYS_END(reg) < end) {
+			end = VMM_REGION_GPHYS_END(reg);
+		}
+		if (reg->maps[i].flags & VMM_REGION_MAPPING_ISHOSTRAM) {
+			snapshot_save_range(ctx, start, end);
+		} else {
+			snapshot_add_zero(ctx, start, end - start);
+		}
+	}
+	snapshot_flush_zero(ctx);
+}
+
+static int snapshot_save_vcpu(struct vmm_vcpu *vcpu, void *priv)
+{
+	u32 size;
+	struct snapshot_ctx *ctx = priv;
+
+	size = arch_vcpu_state_size(vcpu);
+	if (SNAPSHOT_BUF_SIZE < size) {
+		return VMM_ENOMEM;
+	}
+
+	if ((ctx->rc = arch_vcpu_state_save(vcpu, ctx->buf, size))) {
+		return ctx->rc;
+	}
+
+	snapshot_write_record(ctx, GUEST_SNAPSHOT_REC_VCPU, vcpu->subid,
+			      vmm_manager_vcpu_get_state(vcpu),
+			      size, ctx->buf);
+	if (!ctx->rc) {
+		ctx->stats->vcpu_count++;
+	}
+
+	return ctx->rc;
+}
+
+static void snapshot_save_devemu(struct vmm_guest *guest,
+				 struct vmm_region *reg, void *priv)
+{
+	u32 size;
+	struct snapshot_ctx *ctx = priv;
+
+	if (ctx->rc || !(reg->flags & VMM_REGION_VIRTUAL)) {
+		return;
+	}
+
+	size = vmm_devemu_state_size(guest, reg);
+	if (!size) {
+		ctx->stats->devemu_skipped++;
+		return;
+	}
+	if (SNAPSHOT_BUF_SIZE < size) {
+		ctx->rc = VMM_ENOMEM;
+		return;
+	}
+
+	if ((ctx->rc = vmm_devemu_state_save(guest, reg, ctx->buf, size))) {
+		return;
+	}
+
+	snapshot_write_record(ctx, GUEST_SNAPSHOT_REC_DEVEMU,
+			      (reg->flags & VMM_REGION_IO) ? 1 : 0,
+			      VMM_REGION_GPHYS_START(reg), size, ctx->buf);
+	if (!ctx->rc) {
+		ctx->stats->devemu_count++;
+	}
+}
+
+int guest_snapshot_save(struct vmm_guest *guest, const char *path,
+			struct guest_snapshot_stats *stats)
+{
+	int rc;
+	bool was_running;
+	u64 tstamp = vmm_timer_timestamp();
+	struct snapshot_ctx ctx;
+	struct guest_snapshot_header hdr;
+	struct guest_snapshot_stats tmp;
+
+	if (!guest || !path) {
+		return VMM_EINVALID;
+	}
+
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.guest = guest;
+	ctx.stats = (stats) ? stats : &tmp;
+	memset(ctx.stats, 0, sizeof(*ctx.stats));
+
+	ctx.buf = vmm_malloc(SNAPSHOT_BUF_SIZE);
+	if (!ctx.buf) {
+		return VMM_ENOMEM;
+	}
+
+	ctx.fd = vfs_open(path, O_WRONLY | O_CREAT | O_TRUNC,
+			  S_IRUSR | S_IWUSR);
+	if (ctx.fd < 0) {
+		vmm_free(ctx.buf);
+		return ctx.fd;
+	}
+
+	if ((rc = snapshot_pause(guest, &was_running))) {
+		goto done;
+	}
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.magic = GUEST_SNAPSHOT_MAGIC;
+	hdr.version = GUEST_SNAPSHOT_VERSION;
+	strncpy(hdr.guest_name, guest->name, sizeof(hdr.guest_name) - 1);
+	hdr.vcpu_count = guest->vcpu_count;
+	hdr.page_size = VMM_PAGE_SIZE;
+	snapshot_write(&ctx, &hdr, sizeof(hdr));
+
+	/* Small state first so that restore can validate it early */
+	if (!ctx.rc) {
+		vmm_manager_guest_vcpu_iterate(guest,
+					       snapshot_save_vcpu, &ctx);
+	}
+	vmm_guest_iterate_region(guest, VMM_REGION_VIRTUAL,
+				 snapshot_save_devemu, &ctx);
+	vmm_guest_iterate_region(guest, VMM_REGION_VIRTUAL | VMM_REGION_IO,
+				 snapshot_save_devemu, &ctx);
+	vmm_guest_iterate_region(guest, VMM_REGION_MEMORY,
+				 snapshot_save_region, &ctx);
+	snapshot_write_record(&ctx, GUEST_SNAPSHOT_REC_END, 0, 0, 0, NULL);
+
+	rc = ctx.rc;
+
+	if (was_running) {
+		vmm_manager_guest_resume(guest);
+	}
+
+done:
+	if (!rc) {
+		rc = vfs_fsync(ctx.fd);
+	}
+	vfs_close(ctx.fd);
+	vmm_free(ctx.buf);
+
+	ctx.stats->nsecs = vmm_timer_timestamp() - tstamp;
+
+	return rc;
+}
+
+static int snapshot_read(struct snapshot_ctx *ctx, void *data, size_t len)
+{
+	if (vfs_read(ctx->fd, data, len) != len) {
+		return VMM_EIO;
+	}
+	ctx->stats->file_bytes += len;
+
+	return VMM_OK;
+}
+
+static int snapshot_check_ram(struct snapshot_ctx *ctx,
+			      const struct guest_snapshot_record *rec,
+			      struct vmm_region **regp)
+{
+	struct vmm_region *reg;
+
+	reg = vmm_guest_find_region(ctx->guest, rec->addr,
+				    VMM_REGION_REAL | VMM_REGION_MEMORY,
+				    FALSE);
+	if (!reg || !snapshot_ram_region(reg) ||
+	    ((rec->addr + rec->size) < rec->addr) ||
+	    (VMM_REGION_GPHYS_END(reg) < (rec->addr + rec->size))) {
+		vmm_printf("%s: %s: no RAM region for 0x%"PRIPADDR
+			   " size 0x%"PRIx64"\n", __func__, ctx->guest->name,
+			   (physical_addr_t)rec->addr, rec->size);
+		return VMM_ENOENT;
+	}
+
+	*regp = reg;
+
+	return VMM_OK;
+}
+
+static int snapshot_restore_ram(struct snapshot_ctx *ctx,
+				const struct guest_snapshot_record *rec)
+{
+	int rc;
+	u32 len;
+	physical_addr_t gpa = rec->addr;
+	physical_size_t left = rec->size;
+	struct vmm_region *reg;
+
+	if ((rc = snapshot_check_ram(ctx, rec, &reg))) {
+		return rc;
+	}
+
+	while (left) {
+		len = (left < SNAPSHOT_BUF_SIZE) ? left : SNAPSHOT_BUF_SIZE;
+		if ((rc = snapshot_read(ctx, ctx->buf, len))) {
+			return rc;
+		}
+		if (vmm_guest_memory_write(ctx->guest, gpa,
+					   ctx->buf, len, TRUE) != len) {
+			return VMM_EIO;
+		}
+		gpa += len;
+		left -= len;
+	}
+	ctx->stats->ram_bytes += rec->size;
+
+	return VMM_OK;
+}
+
+static int snapshot_zero_range(struct snapshot_ctx *ctx,
+			       physical_addr_t gpa, physical_addr_t end)
+{
+	u32 len;
+
+	while (gpa < end) {
+		len = ((end - gpa) < SNAPSHOT_BUF_SIZE) ?
+				(end - gpa) : SNAPSHOT_BUF_SIZE;
+		if (vmm_guest_memory_write(ctx->guest, gpa,
+					   ctx->buf, len, TRUE) != len) {
+			return VMM_EIO;
+		}
+		gpa += len;
+	}
+
+	return VMM_OK;
+}
+
+static int snapshot_restore_zero(struct snapshot_ctx *ctx,
+				 const struct guest_snapshot_record *rec)
+{
+	int rc;
+	u32 i;
+	physical_addr_t start, end, cstart, cend;
+	physical_size_t chunk;
+	struct vmm_region *reg;
+
+	if ((rc = snapshot_check_ram(ctx, rec, &reg))) {
+		return rc;
+	}
+
+	memset(ctx->buf, 0, SNAPSHOT_BUF_SIZE);
+	start = rec->addr;
+	end = rec->addr + rec->size;
+
+	if (!(reg->flags & VMM_REGION_ISONDEMAND)) {
+		rc = snapshot_zero_range(ctx, start, end);
+		goto done;
+	}
+
+	/*
+	 * Fully covered chunks of on-demand region are given back so
+	 * that they are populated (zero filled) only upon next access.
+	 */
+	chunk = (physical_size_t)1 << reg->map_order;
+	i = (start - VMM_REGION_GPHYS_START(reg)) >> reg->map_order;
+	for (; !rc && (i < reg->maps_count); i++) {
+		cstart = VMM_REGION_GPHYS_START(reg) + i * chunk;
+		cend = cstart + chunk;
+		if (VMM_REGION_GPHYS_END(reg) < cend) {
+			cend = VMM_REGION_GPHYS_END(reg);
+		}
+		if (end <= cstart) {
+			break;
+		}
+		if (!(reg->maps[i].flags & VMM_REGION_MAPPING_ISHOSTRAM)) {
+			continue;
+		}
+		if ((start <= cstart) && (cend <= end)) {
+			vmm_guest_ondemand_release(ctx->guest, cstart,
+						   cend - cstart);
+			continue;
+		}
+		rc = snapshot_zero_range(ctx,
+				(start < cstart) ? cstart : start,
+				(cend < end) ? cend : end);
+	}
+
+done:
+	if (!rc) {
+		ctx->stats->zero_bytes += rec->size;
+	}
+
+	return rc;
+}
+
+static int snapshot_restore_vcpu(struct snapshot_ctx *ctx,
+				 const struct guest_snapshot_record *rec,
+				 u32 *active_mask)
+{
+	int rc;
+	struct vmm_vcpu *vcpu;
+
+	vcpu = vmm_manager_guest_vcpu(ctx->guest, rec->id);
+	if (!vcpu || (rec->size != arch_vcpu_state_size(vcpu))) {
+		vmm_printf("%s: %s: VCPU%d state mismatch\n",
+			   __func__, ctx->guest->name, rec->id);
+		return VMM_EINVALID;
+	}
+
+	if ((rc = snapshot_read(ctx, ctx->buf, rec->size))) {
+		return rc;
+	}
+	if ((rc = arch_vcpu_state_restore(vcpu, ctx->buf, rec->size))) {
+		return rc;
+	}
+
+	if ((rec->addr & SNAPSHOT_VCPU_ACTIVE_STATES) && (rec->id < 32)) {
+		*active_mask |= (1U << rec->id);
+	}
+	ctx->stats->vcpu_count++;
+
+	return VMM_OK;
+}
+
+static int snapshot_restore_devemu(struct snapshot_ctx *ctx,
+				   const struct guest_snapshot_record *rec)
+{
+	int rc;
+	struct vmm_region *reg;
+
+	if (SNAPSHOT_BUF_SIZE < rec->size) {
+		return VMM_EINVALID;
+	}
+	if ((rc = snapshot_read(ctx, ctx->buf, rec->size))) {
+		return rc;
+	}
+
+	reg = vmm_guest_find_region(ctx->guest, rec->addr,
+			VMM_REGION_VIRTUAL |
+			((rec->id) ? VMM_REGION_IO : VMM_REGION_MEMORY),
+			FALSE);
+	if (!reg || (VMM_REGION_GPHYS_START(reg) != rec->addr)) {
+		vmm_printf("%s: %s: no emulated region at 0x%"PRIPADDR"\n",
+			   __func__, ctx->guest->name,
+			   (physical_addr_t)rec->addr);
+		return VMM_ENOENT;
+	}
+
+	rc = vmm_devemu_state_restore(ctx->guest, reg, ctx->buf, rec->size);
+	if (rc) {
+		vmm_printf("%s: %s/%s: state restore failed (error %d)\n",
+			   __func__, ctx->guest->name, reg->node->name, rc);
+		return rc;
+	}
+	ctx->stats->devemu_count++;
+
+	return VMM_OK;
+}
+
+static void snapshot_count_devemu(struct vmm_guest *guest,
+				  struct vmm_region *reg, void *priv)
+{
+	struct snapshot_ctx *ctx = priv;
+
+	if (!(reg->flags & VMM_REGION_VIRTUAL)) {
+		return;
+	}
+
+	if (vmm_devemu_state_size(guest, reg)) {
+		ctx->devemu_expected++;
+	} else {
+		vmm_printf("%s: %s/%s: emulator state cannot be restored\n",
+			   __func__, guest->name, reg->node->name);
+		ctx->stats->devemu_skipped++;
+	}
+}
+
+static int snapshot_start_iter(struct vmm_vcpu *vcpu, void *priv)
+{
+	u32 *active_mask = priv;
+
+	if ((vcpu->subid >= 32) || !(*active_mask & (1U << vcpu->subid))) {
+		return VMM_OK;
+	}
+
+	return vmm_manager_vcpu_kick(vcpu);
+}
+
+int guest_snapshot_restore(struct vmm_guest *guest, const char *path,
+			   struct guest_snapshot_stats *stats)
+{
+	int rc;
+	bool was_running, done = FALSE, modified = FALSE;
+	u32 active_mask = 0;
+	u64 tstamp = vmm_timer_timestamp();
+	struct snapshot_ctx ctx;
+	struct guest_snapshot_header hdr;
+	struct guest_snapshot_record rec;
+	struct guest_snapshot_stats tmp;
+
+	if (!guest || !path) {
+		return VMM_EINVALID;
+	}
+
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.guest = guest;
+	ctx.stats = (stats) ? stats : &tmp;
+	memset(ctx.stats, 0, sizeof(*ctx.stats));
+
+	ctx.buf = vmm_malloc(SNAPSHOT_BUF_SIZE);
+	if (!ctx.buf) {
+		return VMM_ENOMEM;
+	}
+
+	ctx.fd = vfs_open(path, O_RDONLY, 0);
+	if (ctx.fd < 0) {
+		vmm_free(ctx.buf);
+		return ctx.fd;
+	}
+
+	if ((rc = snapshot_read(&ctx, &hdr, sizeof(hdr)))) {
+		goto fail;
+	}
+	if ((hdr.magic != GUEST_SNAPSHOT_MAGIC) ||
+	    (hdr.version != GUEST_SNAPSHOT_VERSION) ||
+	    (hdr.page_size != VMM_PAGE_SIZE)) {
+		vmm_printf("%s: %s is not a valid snapshot\n",
+			   __func__, path);
+		rc = VMM_EINVALID;
+		goto fail;
+	}
+	if (hdr.vcpu_count != guest->vcpu_count) {
+		vmm_printf("%s: %s: snapshot has %d VCPUs instead of %d\n",
+			   __func__, guest->name, hdr.vcpu_count,
+			   guest->vcpu_count);
+		rc = VMM_EINVALID;
+		goto fail;
+	}
+
+	/* Emulators without saved state would not match rest of guest */
+	vmm_guest_iterate_region(guest, VMM_REGION_VIRTUAL,
+				 snapshot_count_devemu, &ctx);
+	vmm_guest_iterate_region(guest, VMM_REGION_VIRTUAL | VMM_REGION_IO,
+				 snapshot_count_devemu, &ctx);
+	if (ctx.stats->devemu_skipped) {
+		rc = VMM_ENOTSUPP;
+		goto fail;
+	}
+
+	if ((rc = snapshot_pause(guest, &was_running))) {
+		goto fail;
+	}
+
+	while (!rc && !done) {
+		if ((rc = snapshot_read(&ctx, &rec, sizeof(rec)))) {
+			break;
+		}
+		if (rec.type != GUEST_SNAPSHOT_REC_END) {
+			modified = TRUE;
+		}
+
+		switch (rec.type) {
+		case GUEST_SNAPSHOT_REC_END:
+			done = TRUE;
+			break;
+		case GUEST_SNAPSHOT_REC_RAM:
+			rc = snapshot_restore_ram(&ctx, &rec);
+			break;
+		case GUEST_SNAPSHOT_REC_RAM_ZERO:
+			rc = snapshot_restore_zero(&ctx, &rec);
+			break;
+		case GUEST_SNAPSHOT_REC_VCPU:
+			rc = snapshot_restore_vcpu(&ctx, &rec, &active_mask);
+			break;
+		case GUEST_SNAPSHOT_REC_DEVEMU:
+			rc = snapshot_restore_devemu(&ctx, &rec);
+			break;
+		default:
+			rc = VMM_EINVALID;
+			break;
+		}
+	}
+
+	if (!rc && (ctx.stats->devemu_count != ctx.devemu_expected)) {
+		vmm_printf("%s: %s: snapshot has state of %d emulators "
+			   "instead of %d\n", __func__, guest->name,
+			   ctx.stats->devemu_count, ctx.devemu_expected);
+		rc = VMM_EINVALID;
+	}
+
+	/* Start VCPUs only if whole snapshot was restored */
+	if (!rc) {
+		rc = vmm_manager_guest_vcpu_iterate(guest,
+					snapshot_start_iter, &active_mask);
+	} else if (modified) {
+		/* Half restored guest is not usable so reboot it */
+		vmm_printf("%s: %s: restore failed (error %d) so guest "
+			   "is reset\n", __func__, guest->name, rc);
+		if (!vmm_manager_guest_reset(guest) && was_running) {
+			vmm_manager_guest_kick(guest);
+		}
+	} else if (was_running) {
+		vmm_manager_guest_resume(guest);
+	}
+
+fail:
+	vfs_close(ctx.fd);
+	vmm_free(ctx.buf);
+
+	ctx.stats->nsecs = vmm_timer_timestamp() - tstamp;
+
+	return rc;
+}
@@ -67,4 +67,7 @@ endif
 
 libs-objs-$(CONFIG_GENALLOC)+= common/genalloc.o
 libs-objs-$(CONFIG_IMAGE_LOADER)+= common/image_loader.o
+libs-objs-$(CONFIG_GUEST_SNAPSHOT)+= common/guest_snapshot.o
+libs-objs-$(CONFIG_DECOMPRESS)+= common/decompress.o
+libs-objs-$(CONFIG_GUEST_LOADER)+= common/guest_loader.o
 
@@ -0,0 +1,95 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file decompress.h
+ * @author agent (agent@local)
+ * @brief Streaming decompression library
+ */
+
+#ifndef __DECOMPRESS_H__
+#define __DECOMPRESS_H__
+
+#include <vmm_error.h>
+#include <vmm_types.h>
+
+/* Number of leading bytes required by decompress_detect() */
+#define DECOMPRESS_MAGIC_SIZE		4
+
+enum decompress_format {
+	/* Not compressed (or unknown format) */
+	DECOMPRESS_NONE=0,
+	/* gzip (deflate) stream (RFC1952) */
+	DECOMPRESS_GZIP=1,
+	/* LZ4 frame or LZ4 legacy frame */
+	DECOMPRESS_LZ4=2,
+};
+
+/** Read callback of compressed input
+ *  Note: returns number of bytes read, zero at end of input
+ *  or negative error code
+ */
+typedef int (*decompress_read_t)(void *priv, void *buf, u32 len);
+
+/** Write callback of decompressed output
+ *  Note: returns VMM_OK or negative error code
+ */
+typedef int (*decompress_write_t)(void *priv, const void *buf, u32 len);
+
+#if IS_ENABLED(CONFIG_DECOMPRESS)
+
+/** Detect compression format from leading bytes of input */
+enum decompress_format decompress_detect(const void *buf, u32 len);
+
+/** Retrive name of compression format */
+const char *decompress_format_name(enum decompress_format fmt);
+
+/** Decompress input stream of given format to output stream
+ *  Note: output is written in chunks of at most 64KB
+ *  Note: scratch memory used is bounded irrespective of input size
+ *  Note: in_bytes (optional) is number of input bytes read
+ *  Note: out_bytes (optional) is number of output bytes written
+ */
+int decompress_stream(enum decompress_format fmt,
+		      decompress_read_t read,
+		      decompress_write_t write,
+		      void *priv, u64 *in_bytes, u64 *out_bytes);
+
+#else
+
+static inline enum decompress_format decompress_detect(const void *buf,
+							 u32 len)
+{
+	return DECOMPRESS_NONE;
+}
+
+static inline const char *decompress_format_name(enum decompress_format fmt)
+{
+	return "none";
+}
+
+static inline int decompress_stream(enum decompress_format fmt,
+				    decompress_read_t read,
+				    decompress_write_t write,
+				    void *priv, u64 *in_bytes, u64 *out_bytes)
+{
+	return VMM_ENOTSUPP;
+}
+
+#endif
+
+#endif /* __DECOMPRESS_H__ */
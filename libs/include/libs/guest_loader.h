@@ -0,0 +1,115 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file guest_loader.h
+ * @author agent (agent@local)
+ * @brief Guest image loader library
+ */
+
+#ifndef __GUEST_LOADER_H__
+#define __GUEST_LOADER_H__
+
+#include <vmm_error.h>
+#include <vmm_types.h>
+#include <libs/decompress.h>
+
+/* Maximum bytes read from file by one VFS request */
+#define GUEST_LOADER_CHUNK_SIZE		(512 * 1024)
+
+/* Load file as-is without detecting compressed images */
+#define GUEST_LOADER_RAW		0x1
+
+struct guest_loader_stats {
+	/* Bytes written to destination memory */
+	u64 bytes;
+	/* Bytes read from file */
+	u64 file_bytes;
+	/* Compression format of file */
+	enum decompress_format format;
+	/* Time taken by the load */
+	u64 nsecs;
+	/* Chunks read directly into destination memory */
+	u32 direct_chunks;
+	/* Chunks read through a bounce buffer */
+	u32 bounce_chunks;
+};
+
+struct vmm_guest;
+struct guest_loader_job;
+
+#if IS_ENABLED(CONFIG_GUEST_LOADER)
+
+/** Load file contents to guest physical memory (or host physical
+ *  memory when guest is NULL) in calling context
+ *  Note: at most len bytes starting at file offset off are loaded
+ *  Note: gzip and LZ4 compressed files are decompressed while loading
+ *  and len limits the decompressed size unless GUEST_LOADER_RAW
+ *  is set in flags
+ *  Note: This is a blocking API hence must be
+ *  called from Orphan (or Thread) Context
+ */
+int guest_loader_load(struct vmm_guest *guest, physical_addr_t pa,
+		      const char *path, u32 off, u32 len, u32 flags,
+		      struct guest_loader_stats *stats);
+
+/** Submit asynchronous load of file contents to guest physical memory
+ *  (or host physical memory when guest is NULL)
+ *  Note: loads are processed in parallel by loader worker threads
+ *  Note: every submitted job must be passed to guest_loader_wait()
+ *  Note: guest can't be destroyed until the job is done
+ */
+struct guest_loader_job *guest_loader_submit(struct vmm_guest *guest,
+					     physical_addr_t pa,
+					     const char *path,
+					     u32 off, u32 len, u32 flags);
+
+/** Wait for asynchronous load to finish and free the job
+ *  Note: returns error code of the load
+ */
+int guest_loader_wait(struct guest_loader_job *job,
+		      struct guest_loader_stats *stats);
+
+#else
+
+static inline int guest_loader_load(struct vmm_guest *guest,
+				    physical_addr_t pa,
+				    const char *path, u32 off, u32 len,
+				    u32 flags,
+				    struct guest_loader_stats *stats)
+{
+	return VMM_ENOTSUPP;
+}
+
+static inline struct guest_loader_job *guest_loader_submit(
+					struct vmm_guest *guest,
+					physical_addr_t pa,
+					const char *path,
+					u32 off, u32 len, u32 flags)
+{
+	return NULL;
+}
+
+static inline int guest_loader_wait(struct guest_loader_job *job,
+				    struct guest_loader_stats *stats)
+{
+	return VMM_ENOTSUPP;
+}
+
+#endif
+
+#endif /* __GUEST_LOADER_H__ */
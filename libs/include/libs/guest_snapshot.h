@@ -0,0 +1,122 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file guest_snapshot.h
+ * @author agent (agent@local)
+ * @brief Guest snapshot and restore library
+ */
+
+#ifndef __GUEST_SNAPSHOT_H__
+#define __GUEST_SNAPSHOT_H__
+
+#include <vmm_error.h>
+#include <vmm_limits.h>
+#include <vmm_types.h>
+
+/* Snapshot file layout:
+ * struct guest_snapshot_header followed by a sequence of
+ * struct guest_snapshot_record each followed by record payload
+ * (if any) and terminated by GUEST_SNAPSHOT_REC_END record.
+ */
+#define GUEST_SNAPSHOT_MAGIC		0x50534758 /* "XGSP" */
+#define GUEST_SNAPSHOT_VERSION		1
+
+enum guest_snapshot_rec_type {
+	/* End of snapshot */
+	GUEST_SNAPSHOT_REC_END=0,
+	/* Guest RAM contents (payload size bytes) */
+	GUEST_SNAPSHOT_REC_RAM=1,
+	/* Zero filled guest RAM (no payload) */
+	GUEST_SNAPSHOT_REC_RAM_ZERO=2,
+	/* Architecture specific VCPU state (payload size bytes) */
+	GUEST_SNAPSHOT_REC_VCPU=3,
+	/* Emulator state of a region (payload size bytes) */
+	GUEST_SNAPSHOT_REC_DEVEMU=4,
+};
+
+struct guest_snapshot_header {
+	u32 magic;
+	u32 version;
+	char guest_name[VMM_FIELD_NAME_SIZE];
+	u32 vcpu_count;
+	u32 page_size;
+} __attribute__((packed));
+
+struct guest_snapshot_record {
+	/* One of enum guest_snapshot_rec_type */
+	u32 type;
+	/* VCPU sub-id or non-zero for IO region of emulator */
+	u32 id;
+	/* Guest physical address or VCPU state */
+	u64 addr;
+	/* Size of guest RAM or payload */
+	u64 size;
+} __attribute__((packed));
+
+struct guest_snapshot_stats {
+	u64 ram_bytes;
+	u64 zero_bytes;
+	u64 file_bytes;
+	u32 vcpu_count;
+	u32 devemu_count;
+	u32 devemu_skipped;
+	u64 nsecs;
+};
+
+struct vmm_guest;
+
+#if IS_ENABLED(CONFIG_GUEST_SNAPSHOT)
+
+/** Save guest RAM, VCPU state and emulator state to given file
+ *  Note: running guest is paused while saving and resumed afterwards
+ *  Note: zero pages are not written to the file
+ */
+int guest_snapshot_save(struct vmm_guest *guest, const char *path,
+			struct guest_snapshot_stats *stats);
+
+/** Restore guest from given snapshot file and start VCPUs which
+ *  were active when snapshot was taken
+ *  Note: guest VCPUs should be in reset or paused state
+ *  Note: guest address space should be same as snapshot time
+ *  Note: fails without touching guest if some emulator of guest
+ *  cannot restore its state (counted in devemu_skipped)
+ *  Note: on failure after guest state was partly overwritten, the
+ *  guest is reset and kicked again only if it was running before
+ */
+int guest_snapshot_restore(struct vmm_guest *guest, const char *path,
+			   struct guest_snapshot_stats *stats);
+
+#else
+
+static inline int guest_snapshot_save(struct vmm_guest *guest,
+				      const char *path,
+				      struct guest_snapshot_stats *stats)
+{
+	return VMM_ENOTSUPP;
+}
+
+static inline int guest_snapshot_restore(struct vmm_guest *guest,
+					 const char *path,
+					 struct guest_snapshot_stats *stats)
+{
+	return VMM_ENOTSUPP;
+}
+
+#endif
+
+#endif /* __GUEST_SNAPSHOT_H__ */
@@ -30,6 +30,18 @@ struct stack_trace {
 	int skip;	/* input argument: how many entries to skip */
 };
 
+struct arch_regs;
+
+void arch_save_stacktrace(struct stack_trace *trace);
+
+/* Save stack trace of interrupted context described by given registers.
+ * Note: This is optional for architecture and default does nothing.
+ */
+void arch_save_stacktrace_regs(struct arch_regs *regs,
+			       struct stack_trace *trace);
+
+void print_stacktrace(struct stack_trace *trace);
+
 void dump_stacktrace(void);
 
 #endif /* __STACKTRACE__ */
@@ -28,11 +28,16 @@
  *	Adapted the file to xvisor
  */
 
+#include <vmm_error.h>
 #include <vmm_stdio.h>
+#include <vmm_heap.h>
+#include <vmm_percpu.h>
+#include <vmm_modules.h>
+#include <arch_barrier.h>
 #include <libs/stringlib.h>
 #include <libs/kallsyms.h>
 
-extern unsigned char _code_end;
+extern u8 _code_end;
 
 /*
  * Expand a compressed symbol data into the resulting uncompressed string,
@@ -80,6 +85,80 @@ __notrace unsigned int kallsyms_expand_symbol(unsigned int off,
 	return off;
 }
 
+/*
+ * Address-sorted index of unique (i.e. non-aliased) symbol addresses
+ * built once at boot time. Each entry also remembers the position of
+ * first aliased symbol so that lookups never have to scan aliases or
+ * search for the next symbol. A small markers table (one address for
+ * every KSYM_INDEX_MARKER_SIZE entries) is searched first so that the
+ * hot part of binary search stays within few cache lines.
+ */
+#define KSYM_INDEX_MARKER_SHIFT	6
+#define KSYM_INDEX_MARKER_SIZE	(1UL << KSYM_INDEX_MARKER_SHIFT)
+
+struct kallsyms_index {
+	unsigned long count;
+	unsigned long *addr;
+	u32 *pos;
+	unsigned long marker_count;
+	unsigned long *markers;
+	u32 *name_off;
+};
+
+static struct kallsyms_index kidx;
+
+/* Per-CPU index of last hit to speed-up repeated lookups */
+static DEFINE_PER_CPU(unsigned long, kallsyms_last_hit);
+
+static __notrace bool kallsyms_index_lookup(unsigned long addr,
+					    unsigned long *idx)
+{
+	unsigned long i, low, high, mid;
+	unsigned long *last_hit;
+
+	if (!kidx.count ||
+	    (addr < kidx.addr[0]) || (kidx.addr[kidx.count] <= addr)) {
+		return FALSE;
+	}
+
+	/* Fast path: same symbol as previous lookup on this CPU */
+	last_hit = &this_cpu(kallsyms_last_hit);
+	i = *last_hit;
+	if ((kidx.addr[i] <= addr) && (addr < kidx.addr[i + 1])) {
+		*idx = i;
+		return TRUE;
+	}
+
+	/* Binary search on markers table */
+	low = 0;
+	high = kidx.marker_count;
+	while (high - low > 1) {
+		mid = low + (high - low) / 2;
+		if (kidx.markers[mid] <= addr)
+			low = mid;
+		else
+			high = mid;
+	}
+
+	/* Binary search within the selected block */
+	low = low << KSYM_INDEX_MARKER_SHIFT;
+	high = low + KSYM_INDEX_MARKER_SIZE;
+	if (kidx.count < high)
+		high = kidx.count;
+	while (high - low > 1) {
+		mid = low + (high - low) / 2;
+		if (kidx.addr[mid] <= addr)
+			low = mid;
+		else
+			high = mid;
+	}
+
+	*last_hit = low;
+	*idx = low;
+
+	return TRUE;
+}
+
 __notrace unsigned long kallsyms_get_symbol_pos(unsigned long addr, unsigned long *symbolsize, unsigned long *offset)
 {
 	unsigned long symbol_start = 0, symbol_end = 0;
@@ -88,6 +167,15 @@ __notrace unsigned long kallsyms_get_symbol_pos(unsigned long addr, unsigned lon
 	/* This kernel should never had been booted. */
 	BUG_ON(!kallsyms_addresses);
 
+	/* Use the index whenever available */
+	if (kallsyms_index_lookup(addr, &i)) {
+		if (symbolsize)
+			*symbolsize = kidx.addr[i + 1] - kidx.addr[i];
+		if (offset)
+			*offset = addr - kidx.addr[i];
+		return kidx.pos[i];
+	}
+
 	/* Do a binary search on the sorted kallsyms_addresses array. */
 	low = 0;
 	high = kallsyms_num_syms;
@@ -119,7 +207,7 @@ __notrace unsigned long kallsyms_get_symbol_pos(unsigned long addr, unsigned lon
 
 	/* If we found no next symbol, we use the end of the section. */
 	if (!symbol_end) {
-		symbol_end = (unsigned long)_code_end;
+		symbol_end = (unsigned long)&_code_end;
 	}
 
 	if (symbolsize)
@@ -139,6 +227,10 @@ __notrace unsigned int kallsyms_get_symbol_offset(unsigned long pos)
 	const unsigned char *name;
 	int i;
 
+	/* Direct lookup when per-symbol offsets are available */
+	if (kidx.name_off && (pos < kallsyms_num_syms))
+		return kidx.name_off[pos];
+
 	/*
 	 * Use the closest marker we have. We have markers every 256 positions,
 	 * so that should be close enough.
@@ -302,3 +394,75 @@ __notrace int kallsyms_lookup_symbol_attrs(unsigned long addr, unsigned long *si
 	kallsyms_expand_symbol(kallsyms_get_symbol_offset(pos), name);
 	return 0;
 }
+
+static int __init kallsyms_index_init(void)
+{
+	unsigned long i, j, count, off, end;
+
+	if (!kallsyms_addresses || !kallsyms_num_syms) {
+		return VMM_OK;
+	}
+
+	/* Count unique symbol addresses */
+	count = 1;
+	for (i = 1; i < kallsyms_num_syms; i++) {
+		if (kallsyms_addresses[i] != kallsyms_addresses[i - 1])
+			count++;
+	}
+
+	kidx.addr = vmm_malloc((count + 1) * sizeof(*kidx.addr));
+	kidx.pos = vmm_malloc(count * sizeof(*kidx.pos));
+	kidx.marker_count =
+		(count + KSYM_INDEX_MARKER_SIZE - 1) >> KSYM_INDEX_MARKER_SHIFT;
+	kidx.markers = vmm_malloc(kidx.marker_count * sizeof(*kidx.markers));
+	kidx.name_off = vmm_malloc(kallsyms_num_syms * sizeof(*kidx.name_off));
+	if (!kidx.addr || !kidx.pos || !kidx.markers || !kidx.name_off) {
+		/* Not fatal, we just fallback to slow lookups */
+		if (kidx.addr)
+			vmm_free(kidx.addr);
+		if (kidx.pos)
+			vmm_free(kidx.pos);
+		if (kidx.markers)
+			vmm_free(kidx.markers);
+		if (kidx.name_off)
+			vmm_free(kidx.name_off);
+		memset(&kidx, 0, sizeof(kidx));
+		return VMM_OK;
+	}
+
+	/* Fill unique addresses and position of first alias */
+	for (i = 0, j = 0; i < kallsyms_num_syms; i++) {
+		if (i && (kallsyms_addresses[i] == kallsyms_addresses[i - 1]))
+			continue;
+		kidx.addr[j] = kallsyms_addresses[i];
+		kidx.pos[j] = i;
+		j++;
+	}
+
+	/* Sentinel marks end of last symbol */
+	end = (unsigned long)&_code_end;
+	kidx.addr[count] = (kidx.addr[count - 1] < end) ?
+					end : (kidx.addr[count - 1] + 1);
+
+	for (i = 0; i < kidx.marker_count; i++)
+		kidx.markers[i] = kidx.addr[i << KSYM_INDEX_MARKER_SHIFT];
+
+	/* Offset of each symbol name in compressed stream */
+	for (i = 0, off = 0; i < kallsyms_num_syms; i++) {
+		kidx.name_off[i] = off;
+		off += kallsyms_names[off] + 1;
+	}
+
+	/* Publish the index only after it is complete */
+	arch_smp_mb();
+	kidx.count = count;
+
+	return VMM_OK;
+}
+
+VMM_DECLARE_MODULE("Kallsyms index",
+		   "Anup Patel",
+		   "GPL",
+		   0,
+		   kallsyms_index_init,
+		   NULL);
@@ -27,6 +27,7 @@
 #include <vmm_wallclock.h>
 #include <libs/stringlib.h>
 #include <libs/mathlib.h>
+#include <block/vmm_blockcache.h>
 
 #include "ext4_control.h"
 
@@ -411,6 +412,12 @@ int ext4fs_control_sync(struct ext4fs_control *ctrl)
 		vmm_mutex_unlock(&ctrl->groups[g].grp_lock);
 	}
 
+	/* Write back dirty buffers of block device */
+	rc = vmm_blockcache_sync(ctrl->bdev);
+	if (rc) {
+		return rc;
+	}
+
 	/* Flush cached data in device request queue */
 	rc = vmm_blockdev_flush_cache(ctrl->bdev);
 	if (rc) {
@@ -33,6 +33,7 @@
 #include <vmm_modules.h>
 #include <libs/stringlib.h>
 #include <libs/vfs.h>
+#include <block/vmm_blockcache.h>
 
 #include "ext4_control.h"
 #include "ext4_node.h"
@@ -60,6 +61,12 @@ int ext4fs_mount(struct mount *m, const char *dev, u32 flags)
 		return VMM_ENOMEM;
 	}
 
+	/* Cache blocks of underlying block device */
+	rc = vmm_blockcache_enable(m->m_dev);
+	if (rc) {
+		goto fail_free;
+	}
+
 	/* Setup control info */
 	rc = ext4fs_control_init(ctrl, m->m_dev);
 	if (rc) {
@@ -137,13 +144,15 @@ int ext4fs_mount(struct mount *m, const char *dev, u32 flags)
 	return VMM_OK;
 
 fail:
+	vmm_blockcache_disable(m->m_dev);
+fail_free:
 	vmm_free(ctrl);
 	return rc;
 }
 
 static int ext4fs_unmount(struct mount *m)
 {
-	int rc;
+	int rc, rc1;
 	struct ext4fs_control *ctrl = m->m_data;
 
 	if (!ctrl) {
@@ -152,9 +161,12 @@ static int ext4fs_unmount(struct mount *m)
 
 	rc = ext4fs_control_exit(ctrl);
 
+	/* Write back and drop cached blocks */
+	rc1 = vmm_blockcache_disable(m->m_dev);
+
 	vmm_free(ctrl);
 
-	return rc;
+	return (rc) ? rc : rc1;
 }
 
 static int ext4fs_msync(struct mount *m)
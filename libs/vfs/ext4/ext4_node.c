@@ -382,14 +382,99 @@ int ext4fs_node_write_blkno(struct ext4fs_node *node, u32 blkpos, u32 blkno)
 	return VMM_OK;
 }
 
+/* Read whole blocks of a node directly into given buffer.
+ * Physically contiguous blocks are read using one device read.
+ */
+static int ext4fs_node_read_blks(struct ext4fs_node *node,
+				 u32 blkpos, u32 blkcnt, char *buf)
+{
+	int rc;
+	u32 i, run, blkno, next_blkno;
+	struct ext4fs_control *ctrl = node->ctrl;
+
+	i = 0;
+	while (i < blkcnt) {
+		rc = ext4fs_node_read_blkno(node, blkpos + i, &blkno);
+		if (rc) {
+			return rc;
+		}
+
+		/* Find run of contiguous blocks (or holes) */
+		run = 1;
+		while ((i + run) < blkcnt) {
+			rc = ext4fs_node_read_blkno(node, blkpos + i + run,
+						    &next_blkno);
+			if (rc) {
+				return rc;
+			}
+			if (blkno) {
+				if (next_blkno != (blkno + run)) {
+					break;
+				}
+			} else if (next_blkno) {
+				break;
+			}
+			run++;
+		}
+
+		if (!blkno) {
+			memset(buf, 0, run * ctrl->block_size);
+		} else {
+			rc = ext4fs_devread(ctrl, blkno, 0,
+					    run * ctrl->block_size, buf);
+			if (rc) {
+				return rc;
+			}
+
+			/* Dirty cached block is newer than on-disk block */
+			if (node->cached_block && node->cached_dirty &&
+			    (blkno <= node->cached_blkno) &&
+			    (node->cached_blkno < (blkno + run))) {
+				memcpy(buf + (node->cached_blkno - blkno) *
+							ctrl->block_size,
+				       node->cached_block, ctrl->block_size);
+			}
+		}
+
+		buf += run * ctrl->block_size;
+		i += run;
+	}
+
+	return VMM_OK;
+}
+
+/* Fill readahead window starting from given block */
+static int ext4fs_node_readahead(struct ext4fs_node *node,
+				 u32 blkpos, u32 blkcnt)
+{
+	int rc;
+
+	if (!node->ra_buf) {
+		node->ra_buf = vmm_malloc(EXT4_NODE_RA_MAX_SIZE);
+		if (!node->ra_buf) {
+			return VMM_ENOMEM;
+		}
+	}
+
+	node->ra_count = 0;
+	rc = ext4fs_node_read_blks(node, blkpos, blkcnt,
+				   (char *)node->ra_buf);
+	if (rc) {
+		return rc;
+	}
+	node->ra_blkpos = blkpos;
+	node->ra_count = blkcnt;
+
+	return VMM_OK;
+}
+
 /* Note: Node position has to be 64-bit */
 u32 ext4fs_node_read(struct ext4fs_node *node, u64 pos, u32 len, char *buf)
 {
 	int rc;
 	u64 filesize = ext4fs_node_get_size(node);
-	u32 i, rlen, blkno, blkoff, blklen;
-	u32 last_blkpos, last_blklen;
-	u32 first_blkpos, first_blkoff, first_blklen;
+	u32 rlen, blkpos, blkno, blkoff, blklen, blkcnt, filecnt;
+	u32 ra_min, ra_max;
 	struct ext4fs_control *ctrl = node->ctrl;
 
 	if (filesize <= pos) {
@@ -400,51 +485,84 @@ u32 ext4fs_node_read(struct ext4fs_node *node, u64 pos, u32 len, char *buf)
 	}
 
 	/* Note: div result < 32-bit */
-	first_blkpos = udiv64(pos, ctrl->block_size); 
-	first_blkoff = pos - (first_blkpos * ctrl->block_size);
-	first_blklen = ctrl->block_size - first_blkoff;
-	if (len < first_blklen) {
-		first_blklen = len;
-	}
+	filecnt = udiv64(filesize + ctrl->block_size - 1, ctrl->block_size);
 
-	/* Note: div result < 32-bit */
-	last_blkpos = udiv64((len + pos), ctrl->block_size); 
-	last_blklen = (len + pos) - (last_blkpos * ctrl->block_size);
+	/* Grow readahead window for sequential reads and
+	 * drop it for random reads.
+	 */
+	ra_min = udiv32(EXT4_NODE_RA_MIN_SIZE, ctrl->block_size);
+	ra_max = udiv32(EXT4_NODE_RA_MAX_SIZE, ctrl->block_size);
+	if ((pos == node->ra_next_pos) && (1 < ra_max)) {
+		if (!node->ra_size) {
+			node->ra_size = (ra_min) ? ra_min : 1;
+		} else if (node->ra_size < ra_max) {
+			node->ra_size = node->ra_size * 2;
+		}
+		if (ra_max < node->ra_size) {
+			node->ra_size = ra_max;
+		}
+	} else {
+		node->ra_size = 0;
+	}
 
 	rlen = len;
-	i = first_blkpos;
 	while (rlen) {
-		rc = ext4fs_node_read_blkno(node, i, &blkno);
-		if (rc) {
-			goto done;
+		/* Note: div result < 32-bit */
+		blkpos = udiv64(pos, ctrl->block_size);
+		blkoff = pos - ((u64)blkpos * ctrl->block_size);
+		blklen = ctrl->block_size - blkoff;
+		if (rlen < blklen) {
+			blklen = rlen;
 		}
 
-		if (i == first_blkpos) {
-			/* First block.  */
-			blkoff = first_blkoff;
-			blklen = first_blklen;
-		} else if (i == last_blkpos) {
-			/* Last block.  */
-			blkoff = 0;
-			blklen = last_blklen;
+		blkcnt = (blkoff) ? 0 : udiv32(rlen, ctrl->block_size);
+
+		if (node->ra_count &&
+		    (node->ra_blkpos <= blkpos) &&
+		    (blkpos < (node->ra_blkpos + node->ra_count))) {
+			/* Copy from readahead window */
+			memcpy(buf, &node->ra_buf[
+				(blkpos - node->ra_blkpos) * ctrl->block_size +
+				blkoff], blklen);
+		} else if (blkcnt && (node->ra_size <= blkcnt)) {
+			/* Read whole blocks directly into caller buffer */
+			rc = ext4fs_node_read_blks(node, blkpos, blkcnt, buf);
+			if (rc) {
+				goto done;
+			}
+			blklen = blkcnt * ctrl->block_size;
+		} else if (node->ra_size) {
+			/* Read ahead and copy in next iteration */
+			blkcnt = filecnt - blkpos;
+			if (node->ra_size < blkcnt) {
+				blkcnt = node->ra_size;
+			}
+			rc = ext4fs_node_readahead(node, blkpos, blkcnt);
+			if (rc) {
+				node->ra_size = 0;
+			}
+			continue;
 		} else {
-			/* Middle block. */
-			blkoff = 0;
-			blklen = ctrl->block_size;
-		}
-
-		/* Read cached block */
-		rc = ext4fs_node_read_blk(node, blkno, blkoff, blklen, buf);
-		if (rc) {
-			goto done;
+			/* Read cached block */
+			rc = ext4fs_node_read_blkno(node, blkpos, &blkno);
+			if (rc) {
+				goto done;
+			}
+			rc = ext4fs_node_read_blk(node, blkno,
+						  blkoff, blklen, buf);
+			if (rc) {
+				goto done;
+			}
 		}
 
 		buf += blklen;
+		pos += blklen;
 		rlen -= blklen;
-		i++;
 	}
 
 done:
+	node->ra_next_pos = pos;
+
 	return len - rlen;
 }
 
@@ -489,6 +607,9 @@ u32 ext4fs_node_write(struct ext4fs_node *node, u64 pos, u32 len, char *buf)
 	u64 wpos, filesize = ext4fs_node_get_size(node);
 	struct ext4fs_control *ctrl = node->ctrl;
 
+	/* Drop readahead window since it might become stale */
+	node->ra_count = 0;
+
 	wlen = len;
 	wpos = pos;
 	update_nodesize = FALSE;
@@ -569,6 +690,9 @@ int ext4fs_node_truncate(struct ext4fs_node *node, u64 pos)
 		return VMM_OK;
 	}
 
+	/* Drop readahead window since it might become stale */
+	node->ra_count = 0;
+
 	/* Note: div result < 32-bit */
 	first_blkpos = udiv64(pos, ctrl->block_size); 
 	first_blkoff = pos - (first_blkpos * ctrl->block_size);
@@ -651,6 +775,12 @@ int ext4fs_node_load(struct ext4fs_control *ctrl,
 	node->dindir2_blkno = 0;
 	node->dindir2_dirty = FALSE;
 
+	node->ra_buf = NULL;
+	node->ra_blkpos = 0;
+	node->ra_count = 0;
+	node->ra_size = 0;
+	node->ra_next_pos = 0;
+
 	return VMM_OK;
 }
 
@@ -677,6 +807,12 @@ int ext4fs_node_init(struct ext4fs_node *node)
 	node->dindir2_blkno = 0;
 	node->dindir2_dirty = FALSE;
 
+	node->ra_buf = NULL;
+	node->ra_blkpos = 0;
+	node->ra_count = 0;
+	node->ra_size = 0;
+	node->ra_next_pos = 0;
+
 	node->lookup_victim = 0;
 	for (idx = 0; idx < EXT4_NODE_LOOKUP_SIZE; idx++) {
 		node->lookup_name[idx][0] = '\0';
@@ -703,6 +839,10 @@ int ext4fs_node_exit(struct ext4fs_node *node)
 		vmm_free(node->dindir2_block);
 	}
 
+	if (node->ra_buf) {
+		vmm_free(node->ra_buf);
+	}
+
 	return VMM_OK;
 }
 
@@ -28,6 +28,8 @@
 #include "ext4_common.h"
 
 #define EXT4_NODE_LOOKUP_SIZE		4
+#define EXT4_NODE_RA_MIN_SIZE		(16 * 1024)
+#define EXT4_NODE_RA_MAX_SIZE		(128 * 1024)
 
 /* Information for accessing a ext4fs file/directory. */
 struct ext4fs_node {
@@ -67,6 +69,15 @@ struct ext4fs_node {
 	u32 dindir2_blkno;
 	bool dindir2_dirty;
 
+	/* Readahead window of sequentially read blocks
+	 * Allocated on demand. Must be freed in vput()
+	 */
+	u8 *ra_buf;
+	u32 ra_blkpos;
+	u32 ra_count;
+	u32 ra_size;
+	u64 ra_next_pos;
+
 	/* Child directory entry lookup table */
 	u32 lookup_victim;
 	char lookup_name[EXT4_NODE_LOOKUP_SIZE][VFS_MAX_NAME];
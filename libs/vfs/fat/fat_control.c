@@ -27,6 +27,7 @@
 #include <vmm_modules.h>
 #include <libs/stringlib.h>
 #include <libs/mathlib.h>
+#include <block/vmm_blockcache.h>
 
 #include "fat_control.h"
 
@@ -697,6 +698,12 @@ int fatfs_control_sync(struct fatfs_control *ctrl)
 	}
 	vmm_mutex_unlock(&ctrl->fat_cache_lock);
 
+	/* Write back dirty buffers of block device */
+	rc = vmm_blockcache_sync(ctrl->bdev);
+	if (rc) {
+		return rc;
+	}
+
 	/* Flush cached data in device request queue */
 	rc = vmm_blockdev_flush_cache(ctrl->bdev);
 	if (rc) {
@@ -32,6 +32,7 @@
 #include <libs/stringlib.h>
 #include <libs/mathlib.h>
 #include <libs/vfs.h>
+#include <block/vmm_blockcache.h>
 
 #include "fat_control.h"
 #include "fat_node.h"
@@ -58,6 +59,12 @@ static int fatfs_mount(struct mount *m, const char *dev, u32 flags)
 		return VMM_ENOMEM;
 	}
 
+	/* Cache blocks of underlying block device */
+	rc = vmm_blockcache_enable(m->m_dev);
+	if (rc) {
+		goto fail_free;
+	}
+
 	/* Setup control info */
 	rc = fatfs_control_init(ctrl, m->m_dev);
 	if (rc) {
@@ -105,13 +112,15 @@ static int fatfs_mount(struct mount *m, const char *dev, u32 flags)
 	return VMM_OK;
 
 fail:
+	vmm_blockcache_disable(m->m_dev);
+fail_free:
 	vmm_free(ctrl);
 	return rc;
 }
 
 static int fatfs_unmount(struct mount *m)
 {
-	int rc;
+	int rc, rc1;
 	struct fatfs_control *ctrl = m->m_data;
 
 	if (!ctrl) {
@@ -120,9 +129,12 @@ static int fatfs_unmount(struct mount *m)
 
 	rc = fatfs_control_exit(ctrl);
 
+	/* Write back and drop cached blocks */
+	rc1 = vmm_blockcache_disable(m->m_dev);
+
 	vmm_free(ctrl);
 
-	return rc;
+	return (rc) ? rc : rc1;
 }
 
 static int fatfs_msync(struct mount *m)
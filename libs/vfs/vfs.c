@@ -24,6 +24,7 @@
 #include <vmm_error.h>
 #include <vmm_heap.h>
 #include <vmm_stdio.h>
+#include <vmm_rwsem.h>
 #include <vmm_scheduler.h>
 #include <vmm_modules.h>
 #include <arch_atomic.h>
@@ -52,7 +53,7 @@ struct file {
 struct vfs_ctrl {
 	struct vmm_mutex fs_list_lock;
 	struct dlist fs_list;
-	struct vmm_mutex mnt_list_lock;
+	struct vmm_rwsem mnt_list_lock;
 	struct dlist mnt_list;
 	struct vmm_mutex vnode_list_lock[VFS_VNODE_HASH_SIZE];
 	struct list_head vnode_list[VFS_VNODE_HASH_SIZE];
@@ -102,7 +103,7 @@ static int vfs_findroot(const char *path, struct mount **mp, char **root)
 	/* find mount point from nearest path */
 	m = NULL;
 
-	vmm_mutex_lock(&vfsc.mnt_list_lock);
+	vmm_rwsem_down_read(&vfsc.mnt_list_lock);
 
 	list_for_each_entry(tmp, &vfsc.mnt_list, m_link) {
 		len = count_match(path, tmp->m_path);
@@ -112,7 +113,7 @@ static int vfs_findroot(const char *path, struct mount **mp, char **root)
 		}
 	}
 
-	vmm_mutex_unlock(&vfsc.mnt_list_lock);
+	vmm_rwsem_up_read(&vfsc.mnt_list_lock);
 
 	if (m == NULL) {
 		return VMM_EFAIL;
@@ -602,7 +603,7 @@ static int vfs_blockdev_notification(struct vmm_notifier_block *nb,
 	}
 
 	/* Lock mount point list */
-	vmm_mutex_lock(&vfsc.mnt_list_lock);
+	vmm_rwsem_down_write(&vfsc.mnt_list_lock);
 
 	/* Find mount point using block device */
 	found = FALSE;
@@ -616,7 +617,7 @@ static int vfs_blockdev_notification(struct vmm_notifier_block *nb,
 		/* Did not find suitable mount point so,
 		 * don't care about this event.
 		 */
-		vmm_mutex_unlock(&vfsc.mnt_list_lock);
+		vmm_rwsem_up_write(&vfsc.mnt_list_lock);
 		return NOTIFY_DONE;
 	}
 
@@ -624,7 +625,7 @@ static int vfs_blockdev_notification(struct vmm_notifier_block *nb,
 	vfs_force_unmount(m);
 
 	/* Unlock mount point list */
-	vmm_mutex_unlock(&vfsc.mnt_list_lock);
+	vmm_rwsem_up_write(&vfsc.mnt_list_lock);
 
 	return NOTIFY_OK;
 }
@@ -728,12 +729,12 @@ int vfs_mount(const char *dir, const char *fsname, const char *dev, u32 flags)
 	}
 
 	/* add to mount list */
-	vmm_mutex_lock(&vfsc.mnt_list_lock);
+	vmm_rwsem_down_write(&vfsc.mnt_list_lock);
 
 	list_for_each_entry(tm, &vfsc.mnt_list, m_link) {
 		if (!strcmp(tm->m_path, dir) ||
 		    ((dev != NULL) && (tm->m_dev == bdev))) {
-			vmm_mutex_unlock(&vfsc.mnt_list_lock);
+			vmm_rwsem_up_write(&vfsc.mnt_list_lock);
 			vmm_mutex_lock(&m->m_lock);
 			m->m_fs->unmount(m);
 			vmm_mutex_unlock(&m->m_lock);
@@ -748,7 +749,7 @@ int vfs_mount(const char *dir, const char *fsname, const char *dev, u32 flags)
 
 	list_add(&m->m_link, &vfsc.mnt_list);
 
-	vmm_mutex_unlock(&vfsc.mnt_list_lock);
+	vmm_rwsem_up_write(&vfsc.mnt_list_lock);
 
 	return VMM_OK;
 }
@@ -762,7 +763,7 @@ int vfs_unmount(const char *path)
 
 	BUG_ON(!vmm_scheduler_orphan_context());
 
-	vmm_mutex_lock(&vfsc.mnt_list_lock);
+	vmm_rwsem_down_write(&vfsc.mnt_list_lock);
 
 	found = FALSE;
 	list_for_each_entry(m, &vfsc.mnt_list, m_link) {
@@ -774,7 +775,7 @@ int vfs_unmount(const char *path)
 
 	/* root fs can not be unmounted. */
 	if (!found) {
-		vmm_mutex_unlock(&vfsc.mnt_list_lock);
+		vmm_rwsem_up_write(&vfsc.mnt_list_lock);
 		return VMM_EINVALID;
 	}
 
@@ -782,14 +783,14 @@ int vfs_unmount(const char *path)
 	 * otherwise it is busy.
 	 */
 	if (arch_atomic_read(&m->m_refcnt) > 1) {
-		vmm_mutex_unlock(&vfsc.mnt_list_lock);
+		vmm_rwsem_up_write(&vfsc.mnt_list_lock);
 		return VMM_EBUSY;
 	}
 
 	/* remove mount point and break */
 	list_del(&m->m_link);
 
-	vmm_mutex_unlock(&vfsc.mnt_list_lock);
+	vmm_rwsem_up_write(&vfsc.mnt_list_lock);
 
 	/* call filesytem msync & filesystem unmount */
 	vmm_mutex_lock(&m->m_lock);
@@ -822,7 +823,7 @@ struct mount *vfs_mount_get(int index)
 		return NULL;
 	}
 
-	vmm_mutex_lock(&vfsc.mnt_list_lock);
+	vmm_rwsem_down_read(&vfsc.mnt_list_lock);
 
 	m = NULL;
 	found = FALSE;
@@ -835,7 +836,7 @@ struct mount *vfs_mount_get(int index)
 		index--;
 	}
 
-	vmm_mutex_unlock(&vfsc.mnt_list_lock);
+	vmm_rwsem_up_read(&vfsc.mnt_list_lock);
 
 	if (!found) {
 		return NULL;
@@ -852,13 +853,13 @@ u32 vfs_mount_count(void)
 
 	BUG_ON(!vmm_scheduler_orphan_context());
 
-	vmm_mutex_lock(&vfsc.mnt_list_lock);
+	vmm_rwsem_down_read(&vfsc.mnt_list_lock);
 
 	list_for_each_entry(m, &vfsc.mnt_list, m_link) {
 		retval++;
 	}
 
-	vmm_mutex_unlock(&vfsc.mnt_list_lock);
+	vmm_rwsem_up_read(&vfsc.mnt_list_lock);
 
 	return retval;
 }
@@ -2040,7 +2041,7 @@ static int __init vfs_init(void)
 	INIT_MUTEX(&vfsc.fs_list_lock);
 	INIT_LIST_HEAD(&vfsc.fs_list);
 
-	INIT_MUTEX(&vfsc.mnt_list_lock);
+	INIT_RWSEM(&vfsc.mnt_list_lock);
 	INIT_LIST_HEAD(&vfsc.mnt_list);
 
 	for (i = 0; i < VFS_VNODE_HASH_SIZE; i++) {
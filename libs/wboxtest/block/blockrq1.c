@@ -0,0 +1,609 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file blockrq1.c
+ * @author agent (agent@local)
+ * @brief blockrq1 test implementation
+ *
+ * This test creates a RAM backed generic request queue and keeps its
+ * worker busy with a plug request so that further requests queue up.
+ * It then checks that contiguous reads and writes are merged into one
+ * dispatch with correct data, that aborting a queued request fails it
+ * exactly once without touching its buffer and that aborting one
+ * member of a merged dispatch blocked in the driver neither deadlocks
+ * nor corrupts data of other members or the disk.
+ */
+
+#include <vmm_error.h>
+#include <vmm_heap.h>
+#include <vmm_stdio.h>
+#include <vmm_spinlocks.h>
+#include <vmm_modules.h>
+#include <vmm_completion.h>
+#include <block/vmm_blockrq.h>
+#include <libs/stringlib.h>
+#include <libs/wboxtest.h>
+
+#define MODULE_DESC			"blockrq1 test"
+#define MODULE_AUTHOR			"agent"
+#define MODULE_LICENSE			"GPL"
+#define MODULE_IPRIORITY		(WBOXTEST_IPRIORITY+1)
+#define	MODULE_INIT			blockrq1_init
+#define	MODULE_EXIT			blockrq1_exit
+
+#define BLOCKRQ1_BLOCK_SIZE		512
+#define BLOCKRQ1_NUM_BLOCKS		64
+#define BLOCKRQ1_PLUG_LBA		(BLOCKRQ1_NUM_BLOCKS - 1)
+#define BLOCKRQ1_REQ_COUNT		4
+#define BLOCKRQ1_TIMEOUT_NSECS		(1000ULL * 1000000ULL)
+
+struct blockrq1_req {
+	struct vmm_request r;
+	struct vmm_completion done;
+	u32 completed;
+	u32 failed;
+	u8 buf[BLOCKRQ1_BLOCK_SIZE];
+};
+
+struct blockrq1_ctx {
+	vmm_spinlock_t lock;
+	/* Completed by worker when it blocks on gate */
+	struct vmm_completion entered;
+	/* Completed by test to unblock worker */
+	struct vmm_completion gate;
+	bool plugged;
+	bool release_on_abort;
+	u32 dispatches;
+	u32 max_bcnt;
+	u8 disk[BLOCKRQ1_NUM_BLOCKS * BLOCKRQ1_BLOCK_SIZE];
+	struct blockrq1_req plug;
+	struct blockrq1_req reqs[BLOCKRQ1_REQ_COUNT];
+};
+
+static struct blockrq1_ctx *blockrq1_ctx;
+
+static int blockrq1_rw(struct vmm_request *r, void *priv, bool write)
+{
+	bool plugged;
+	irq_flags_t flags;
+	struct blockrq1_ctx *ctx = priv;
+	u8 *ptr = &ctx->disk[r->lba * BLOCKRQ1_BLOCK_SIZE];
+
+	vmm_spin_lock_irqsave(&ctx->lock, flags);
+	plugged = ctx->plugged;
+	ctx->plugged = FALSE;
+	ctx->dispatches++;
+	if (ctx->max_bcnt < r->bcnt) {
+		ctx->max_bcnt = r->bcnt;
+	}
+	vmm_spin_unlock_irqrestore(&ctx->lock, flags);
+
+	/* Hold worker until test lets it go */
+	if (plugged) {
+		vmm_completion_complete(&ctx->entered);
+		vmm_completion_wait(&ctx->gate);
+	}
+
+	if (write) {
+		memcpy(ptr, r->data, r->bcnt * BLOCKRQ1_BLOCK_SIZE);
+	} else {
+		memcpy(r->data, ptr, r->bcnt * BLOCKRQ1_BLOCK_SIZE);
+	}
+
+	return VMM_OK;
+}
+
+static int blockrq1_read(struct vmm_blockrq *brq,
+			 struct vmm_request *r, void *priv)
+{
+	return blockrq1_rw(r, priv, FALSE);
+}
+
+static int blockrq1_write(struct vmm_blockrq *brq,
+			  struct vmm_request *r, void *priv)
+{
+	return blockrq1_rw(r, priv, TRUE);
+}
+
+/* Driver cancels in-flight request by unblocking worker */
+static int blockrq1_abort_cb(struct vmm_blockrq *brq,
+			     struct vmm_request *r, void *priv)
+{
+	bool release;
+	irq_flags_t flags;
+	struct blockrq1_ctx *ctx = priv;
+
+	vmm_spin_lock_irqsave(&ctx->lock, flags);
+	release = ctx->release_on_abort;
+	ctx->release_on_abort = FALSE;
+	vmm_spin_unlock_irqrestore(&ctx->lock, flags);
+
+	if (release) {
+		vmm_completion_complete(&ctx->gate);
+	}
+
+	return VMM_OK;
+}
+
+static void blockrq1_completed(struct vmm_request *r)
+{
+	struct blockrq1_req *req = r->priv;
+
+	req->completed++;
+	vmm_completion_complete(&req->done);
+}
+
+static void blockrq1_failed(struct vmm_request *r)
+{
+	struct blockrq1_req *req = r->priv;
+
+	req->failed++;
+	vmm_completion_complete(&req->done);
+}
+
+static int blockrq1_submit(struct vmm_blockdev *bdev,
+			   struct blockrq1_req *req,
+			   enum vmm_request_type type, u64 lba)
+{
+	memset(&req->r, 0, sizeof(req->r));
+	INIT_LIST_HEAD(&req->r.head);
+	req->r.type = type;
+	req->r.lba = lba;
+	req->r.bcnt = 1;
+	req->r.data = req->buf;
+	req->r.completed = blockrq1_completed;
+	req->r.failed = blockrq1_failed;
+	req->r.priv = req;
+	req->completed = 0;
+	req->failed = 0;
+	INIT_COMPLETION(&req->done);
+
+	return vmm_blockdev_submit_request(bdev, &req->r);
+}
+
+/* Block worker in next dispatch */
+static void blockrq1_arm(void)
+{
+	irq_flags_t flags;
+	struct blockrq1_ctx *ctx = blockrq1_ctx;
+
+	REINIT_COMPLETION(&ctx->entered);
+	REINIT_COMPLETION(&ctx->gate);
+	vmm_spin_lock_irqsave(&ctx->lock, flags);
+	ctx->plugged = TRUE;
+	vmm_spin_unlock_irqrestore(&ctx->lock, flags);
+}
+
+/* Wait until worker is blocked on gate */
+static int blockrq1_entered(void)
+{
+	u64 timeout = BLOCKRQ1_TIMEOUT_NSECS;
+
+	return vmm_completion_wait_timeout(&blockrq1_ctx->entered, &timeout);
+}
+
+/* Submit plug request and wait until worker is blocked on it */
+static int blockrq1_plug(struct vmm_blockdev *bdev)
+{
+	int rc;
+	struct blockrq1_ctx *ctx = blockrq1_ctx;
+
+	blockrq1_arm();
+	rc = blockrq1_submit(bdev, &ctx->plug, VMM_REQUEST_READ,
+			     BLOCKRQ1_PLUG_LBA);
+	if (rc) {
+		return rc;
+	}
+
+	return blockrq1_entered();
+}
+
+/* Wait until every given request is completed or failed */
+static int blockrq1_wait(struct blockrq1_req *reqs, u32 count)
+{
+	int rc;
+	u32 i;
+	u64 timeout;
+
+	for (i = 0; i < count; i++) {
+		timeout = BLOCKRQ1_TIMEOUT_NSECS;
+		rc = vmm_completion_wait_timeout(&reqs[i].done, &timeout);
+		if (rc) {
+			return rc;
+		}
+	}
+
+	return VMM_OK;
+}
+
+static int blockrq1_merge(struct vmm_chardev *cdev,
+			  struct vmm_blockdev *bdev,
+			  struct vmm_blockrq *brq,
+			  enum vmm_request_type type)
+{
+	int rc;
+	u32 i, j;
+	u8 *ptr;
+	struct vmm_blockrq_stats st0, st1;
+	struct blockrq1_ctx *ctx = blockrq1_ctx;
+
+	for (i = 0; i < sizeof(ctx->disk); i++) {
+		ctx->disk[i] = (u8)(i * 7 + type);
+	}
+	ctx->dispatches = 0;
+	ctx->max_bcnt = 0;
+	vmm_blockrq_get_stats(brq, &st0);
+
+	rc = blockrq1_plug(bdev);
+	if (rc) {
+		vmm_cprintf(cdev, "error: plug request not dispatched\n");
+		return rc;
+	}
+
+	/* Contiguous requests with separate buffers */
+	for (i = 0; i < BLOCKRQ1_REQ_COUNT; i++) {
+		memset(ctx->reqs[i].buf, 0xA0 + i, BLOCKRQ1_BLOCK_SIZE);
+		rc = blockrq1_submit(bdev, &ctx->reqs[i], type, i);
+		if (rc) {
+			vmm_cprintf(cdev, "error: submit %d failed\n", i);
+			vmm_completion_complete(&ctx->gate);
+			return rc;
+		}
+	}
+
+	vmm_completion_complete(&ctx->gate);
+	rc = blockrq1_wait(&ctx->plug, 1);
+	if (!rc) {
+		rc = blockrq1_wait(ctx->reqs, BLOCKRQ1_REQ_COUNT);
+	}
+	if (rc) {
+		vmm_cprintf(cdev, "error: requests timed out\n");
+		return rc;
+	}
+	vmm_blockrq_get_stats(brq, &st1);
+
+	for (i = 0; i < BLOCKRQ1_REQ_COUNT; i++) {
+		if ((ctx->reqs[i].completed != 1) || ctx->reqs[i].failed) {
+			vmm_cprintf(cdev, "error: request %d completed %d "
+				    "failed %d\n", i, ctx->reqs[i].completed,
+				    ctx->reqs[i].failed);
+			return VMM_EFAIL;
+		}
+		ptr = &ctx->disk[i * BLOCKRQ1_BLOCK_SIZE];
+		for (j = 0; j < BLOCKRQ1_BLOCK_SIZE; j++) {
+			if (ptr[j] != ctx->reqs[i].buf[j]) {
+				vmm_cprintf(cdev, "error: request %d data "
+					    "mismatch at %d\n", i, j);
+				return VMM_EFAIL;
+			}
+		}
+	}
+
+	/* Plug and one merged dispatch */
+	if ((ctx->dispatches != 2) ||
+	    (ctx->max_bcnt != BLOCKRQ1_REQ_COUNT) ||
+	    ((st1.merges - st0.merges) != (BLOCKRQ1_REQ_COUNT - 1))) {
+		vmm_cprintf(cdev, "error: %s dispatches %d max_bcnt %d "
+			    "merges %"PRIu64"\n",
+			    (type == VMM_REQUEST_READ) ? "read" : "write",
+			    ctx->dispatches, ctx->max_bcnt,
+			    st1.merges - st0.merges);
+		return VMM_EFAIL;
+	}
+
+	return VMM_OK;
+}
+
+static int blockrq1_abort(struct vmm_chardev *cdev,
+			  struct vmm_blockdev *bdev,
+			  struct vmm_blockrq *brq)
+{
+	int rc;
+	u32 i, j;
+	struct blockrq1_req *req;
+	struct vmm_blockrq_stats st0, st1;
+	struct blockrq1_ctx *ctx = blockrq1_ctx;
+
+	vmm_blockrq_get_stats(brq, &st0);
+
+	rc = blockrq1_plug(bdev);
+	if (rc) {
+		vmm_cprintf(cdev, "error: plug request not dispatched\n");
+		return rc;
+	}
+
+	for (i = 0; i < BLOCKRQ1_REQ_COUNT; i++) {
+		memset(ctx->reqs[i].buf, 0x55, BLOCKRQ1_BLOCK_SIZE);
+		rc = blockrq1_submit(bdev, &ctx->reqs[i],
+				     VMM_REQUEST_READ, 8 + i);
+		if (rc) {
+			vmm_cprintf(cdev, "error: submit %d failed\n", i);
+			vmm_completion_complete(&ctx->gate);
+			return rc;
+		}
+	}
+
+	/* Abort second request while it is still queued */
+	req = &ctx->reqs[1];
+	rc = vmm_blockdev_abort_request(&req->r);
+	if (rc || (req->failed != 1) || req->completed) {
+		vmm_cprintf(cdev, "error: abort rc %d failed %d "
+			    "completed %d\n", rc, req->failed,
+			    req->completed);
+		vmm_completion_complete(&ctx->gate);
+		return VMM_EFAIL;
+	}
+
+	vmm_completion_complete(&ctx->gate);
+	rc = blockrq1_wait(&ctx->plug, 1);
+	if (!rc) {
+		rc = blockrq1_wait(ctx->reqs, BLOCKRQ1_REQ_COUNT);
+	}
+	if (rc) {
+		vmm_cprintf(cdev, "error: requests timed out\n");
+		return rc;
+	}
+	vmm_blockrq_get_stats(brq, &st1);
+
+	for (i = 0; i < BLOCKRQ1_REQ_COUNT; i++) {
+		req = &ctx->reqs[i];
+		if (i == 1) {
+			if ((req->failed != 1) || req->completed) {
+				vmm_cprintf(cdev, "error: aborted request "
+					    "called back again\n");
+				return VMM_EFAIL;
+			}
+			for (j = 0; j < BLOCKRQ1_BLOCK_SIZE; j++) {
+				if (req->buf[j] != 0x55) {
+					vmm_cprintf(cdev, "error: aborted "
+						    "request buffer written\n");
+					return VMM_EFAIL;
+				}
+			}
+			continue;
+		}
+		if ((req->completed != 1) || req->failed ||
+		    memcmp(req->buf, &ctx->disk[(8 + i) * BLOCKRQ1_BLOCK_SIZE],
+			   BLOCKRQ1_BLOCK_SIZE)) {
+			vmm_cprintf(cdev, "error: request %d not completed "
+				    "correctly\n", i);
+			return VMM_EFAIL;
+		}
+	}
+
+	if ((st1.aborts - st0.aborts) != 1) {
+		vmm_cprintf(cdev, "error: aborts %"PRIu64"\n",
+			    st1.aborts - st0.aborts);
+		return VMM_EFAIL;
+	}
+
+	return VMM_OK;
+}
+
+static int blockrq1_abort_merged(struct vmm_chardev *cdev,
+				 struct vmm_blockdev *bdev,
+				 struct vmm_blockrq *brq,
+				 enum vmm_request_type type)
+{
+	int rc;
+	u32 i, j;
+	u8 *ptr;
+	irq_flags_t flags;
+	struct blockrq1_req *req;
+	struct vmm_blockrq_stats st0, st1;
+	struct blockrq1_ctx *ctx = blockrq1_ctx;
+	const char *name = (type == VMM_REQUEST_READ) ? "read" : "write";
+
+	for (i = 0; i < sizeof(ctx->disk); i++) {
+		ctx->disk[i] = (u8)(i * 5 + type);
+	}
+	ctx->dispatches = 0;
+	ctx->max_bcnt = 0;
+	vmm_blockrq_get_stats(brq, &st0);
+
+	rc = blockrq1_plug(bdev);
+	if (rc) {
+		vmm_cprintf(cdev, "error: plug request not dispatched\n");
+		return rc;
+	}
+
+	for (i = 0; i < BLOCKRQ1_REQ_COUNT; i++) {
+		memset(ctx->reqs[i].buf, 0xC0 + i, BLOCKRQ1_BLOCK_SIZE);
+		rc = blockrq1_submit(bdev, &ctx->reqs[i], type, 16 + i);
+		if (rc) {
+			vmm_cprintf(cdev, "error: submit %d failed\n", i);
+			vmm_completion_complete(&ctx->gate);
+			return rc;
+		}
+	}
+
+	/* Release plug and block worker again in merged dispatch */
+	REINIT_COMPLETION(&ctx->entered);
+	vmm_spin_lock_irqsave(&ctx->lock, flags);
+	ctx->plugged = TRUE;
+	vmm_spin_unlock_irqrestore(&ctx->lock, flags);
+	vmm_completion_complete(&ctx->gate);
+	rc = blockrq1_wait(&ctx->plug, 1);
+	if (!rc) {
+		rc = blockrq1_entered();
+	}
+	if (rc || (ctx->max_bcnt != BLOCKRQ1_REQ_COUNT)) {
+		vmm_cprintf(cdev, "error: %s merged dispatch not blocked "
+			    "(max_bcnt %d)\n", name, ctx->max_bcnt);
+		vmm_completion_complete(&ctx->gate);
+		return VMM_EFAIL;
+	}
+
+	/* Abort second member while worker is blocked in driver. The
+	 * abort callback unblocks worker so abort returns once worker
+	 * has released the request.
+	 */
+	vmm_spin_lock_irqsave(&ctx->lock, flags);
+	ctx->release_on_abort = TRUE;
+	vmm_spin_unlock_irqrestore(&ctx->lock, flags);
+	req = &ctx->reqs[1];
+	rc = vmm_blockdev_abort_request(&req->r);
+	if (rc || (req->failed != 1) || req->completed) {
+		vmm_cprintf(cdev, "error: %s abort rc %d failed %d "
+			    "completed %d\n", name, rc, req->failed,
+			    req->completed);
+		return VMM_EFAIL;
+	}
+
+	rc = blockrq1_wait(ctx->reqs, BLOCKRQ1_REQ_COUNT);
+	if (rc) {
+		vmm_cprintf(cdev, "error: requests timed out\n");
+		return rc;
+	}
+	vmm_blockrq_get_stats(brq, &st1);
+
+	for (i = 0; i < BLOCKRQ1_REQ_COUNT; i++) {
+		req = &ctx->reqs[i];
+		ptr = &ctx->disk[(16 + i) * BLOCKRQ1_BLOCK_SIZE];
+		if (i == 1) {
+			if ((req->failed != 1) || req->completed) {
+				vmm_cprintf(cdev, "error: %s aborted request "
+					    "called back again\n", name);
+				return VMM_EFAIL;
+			}
+			for (j = 0; j < BLOCKRQ1_BLOCK_SIZE; j++) {
+				/* Read must not fill aborted buffer */
+				if ((type == VMM_REQUEST_READ) &&
+				    (req->buf[j] != 0xC1)) {
+					vmm_cprintf(cdev, "error: aborted "
+						    "read buffer written\n");
+					return VMM_EFAIL;
+				}
+				/* Write keeps old or aborted data */
+				if ((type == VMM_REQUEST_WRITE) &&
+				    (ptr[j] != req->buf[j]) &&
+				    (ptr[j] != (u8)(((16 + i) *
+					BLOCKRQ1_BLOCK_SIZE + j) * 5 + type))) {
+					vmm_cprintf(cdev, "error: aborted "
+						    "write corrupted disk at "
+						    "%d\n", j);
+					return VMM_EFAIL;
+				}
+			}
+			continue;
+		}
+		if ((req->completed != 1) || req->failed ||
+		    memcmp(req->buf, ptr, BLOCKRQ1_BLOCK_SIZE)) {
+			vmm_cprintf(cdev, "error: %s request %d not "
+				    "completed correctly\n", name, i);
+			return VMM_EFAIL;
+		}
+	}
+
+	if ((ctx->dispatches != 2) || ((st1.aborts - st0.aborts) != 1)) {
+		vmm_cprintf(cdev, "error: %s dispatches %d aborts %"PRIu64"\n",
+			    name, ctx->dispatches, st1.aborts - st0.aborts);
+		return VMM_EFAIL;
+	}
+
+	return VMM_OK;
+}
+
+static int blockrq1_run(struct wboxtest *test, struct vmm_chardev *cdev,
+			u32 test_hcpu)
+{
+	int rc = VMM_ENOMEM;
+	struct vmm_blockrq *brq;
+	struct vmm_blockdev *bdev;
+	struct blockrq1_ctx *ctx;
+
+	ctx = vmm_zalloc(sizeof(*ctx));
+	if (!ctx) {
+		return VMM_ENOMEM;
+	}
+	INIT_SPIN_LOCK(&ctx->lock);
+	INIT_COMPLETION(&ctx->entered);
+	INIT_COMPLETION(&ctx->gate);
+	blockrq1_ctx = ctx;
+
+	bdev = vmm_blockdev_alloc();
+	if (!bdev) {
+		goto free_ctx;
+	}
+	strncpy(bdev->name, "blockrq1", sizeof(bdev->name));
+	bdev->flags = VMM_BLOCKDEV_RW;
+	bdev->start_lba = 0;
+	bdev->num_blocks = BLOCKRQ1_NUM_BLOCKS;
+	bdev->block_size = BLOCKRQ1_BLOCK_SIZE;
+
+	brq = vmm_blockrq_create("blockrq1", 2 * BLOCKRQ1_REQ_COUNT, FALSE,
+				 blockrq1_read, blockrq1_write,
+				 blockrq1_abort_cb, NULL, ctx);
+	if (!brq) {
+		goto free_bdev;
+	}
+	bdev->rq = vmm_blockrq_to_rq(brq);
+	vmm_blockrq_set_sched(brq, VMM_BLOCKRQ_SCHED_DEADLINE,
+			      VMM_BLOCKRQ_DEFAULT_MAX_MERGE_BYTES);
+
+	rc = blockrq1_merge(cdev, bdev, brq, VMM_REQUEST_READ);
+	if (!rc) {
+		rc = blockrq1_merge(cdev, bdev, brq, VMM_REQUEST_WRITE);
+	}
+	if (!rc) {
+		rc = blockrq1_abort(cdev, bdev, brq);
+	}
+	if (!rc) {
+		rc = blockrq1_abort_merged(cdev, bdev, brq, VMM_REQUEST_READ);
+	}
+	if (!rc) {
+		rc = blockrq1_abort_merged(cdev, bdev, brq, VMM_REQUEST_WRITE);
+	}
+
+	/* Let any remaining request drain before destroying queue */
+	if (rc) {
+		vmm_completion_complete_all(&ctx->gate);
+		blockrq1_wait(&ctx->plug, 1);
+		blockrq1_wait(ctx->reqs, BLOCKRQ1_REQ_COUNT);
+	}
+	vmm_blockrq_destroy(brq);
+free_bdev:
+	vmm_blockdev_free(bdev);
+free_ctx:
+	blockrq1_ctx = NULL;
+	vmm_free(ctx);
+
+	return rc;
+}
+
+static struct wboxtest blockrq1 = {
+	.name = "blockrq1",
+	.run = blockrq1_run,
+};
+
+static int __init blockrq1_init(void)
+{
+	return wboxtest_register("block", &blockrq1);
+}
+
+static void __exit blockrq1_exit(void)
+{
+	wboxtest_unregister(&blockrq1);
+}
+
+VMM_DECLARE_MODULE(MODULE_DESC,
+			MODULE_AUTHOR,
+			MODULE_LICENSE,
+			MODULE_IPRIORITY,
+			MODULE_INIT,
+			MODULE_EXIT);
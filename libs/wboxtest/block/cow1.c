@@ -0,0 +1,182 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file cow1.c
+ * @author agent (agent@local)
+ * @brief cow1 test implementation
+ *
+ * This test feeds valid and corrupted copy-on-write overlay headers
+ * to cow_check_header() and checks that only consistent headers are
+ * accepted.
+ */
+
+#include <vmm_error.h>
+#include <vmm_stdio.h>
+#include <vmm_modules.h>
+#include <libs/mathlib.h>
+#include <libs/stringlib.h>
+#include <libs/wboxtest.h>
+#include <drv/cow.h>
+
+#define MODULE_DESC			"cow1 test"
+#define MODULE_AUTHOR			"agent"
+#define MODULE_LICENSE			"GPL"
+#define MODULE_IPRIORITY		(WBOXTEST_IPRIORITY+1)
+#define	MODULE_INIT			cow1_init
+#define	MODULE_EXIT			cow1_exit
+
+/* Base size which is not a multiple of cluster size */
+#define COW1_BASE_SIZE			(64ULL * 1024 * 1024 + 512)
+#define COW1_OVERLAY_SIZE		(16ULL * 1024 * 1024)
+
+/* Build header in same way as cow_format() */
+static u64 cow1_header(struct cow_header *hdr, u64 base_size,
+		       u32 cluster_bits)
+{
+	u64 csize = 1ULL << cluster_bits;
+	u64 clusters, l2_entries, l1_bytes;
+
+	memset(hdr, 0, sizeof(*hdr));
+	hdr->magic = COW_MAGIC;
+	hdr->version = COW_VERSION;
+	hdr->cluster_bits = cluster_bits;
+	hdr->size = base_size;
+
+	clusters = (base_size + csize - 1) >> cluster_bits;
+	l2_entries = csize / sizeof(u64);
+	hdr->l1_size = udiv64(clusters + l2_entries - 1, l2_entries);
+	l1_bytes = (u64)hdr->l1_size * sizeof(u64);
+
+	hdr->l1_offset = csize;
+	hdr->next_free = hdr->l1_offset +
+			 (((l1_bytes + csize - 1) >> cluster_bits) << cluster_bits);
+
+	return csize;
+}
+
+static int cow1_expect(struct vmm_chardev *cdev, const char *name,
+		       struct cow_header *hdr, u64 overlay_size, int exp)
+{
+	int rc = cow_check_header(hdr, COW1_BASE_SIZE, overlay_size);
+
+	if ((exp && !rc) || (!exp && rc)) {
+		vmm_cprintf(cdev, "error: %s gives %d\n", name, rc);
+		return VMM_EFAIL;
+	}
+
+	return VMM_OK;
+}
+
+static int cow1_run(struct wboxtest *test, struct vmm_chardev *cdev,
+		    u32 test_hcpu)
+{
+	int rc = VMM_OK;
+	u32 bits;
+	u64 csize;
+	struct cow_header hdr;
+
+#define COW1_CHECK(name, expr, overlay_size, exp)			\
+	do {								\
+		csize = cow1_header(&hdr, COW1_BASE_SIZE, bits);	\
+		expr;							\
+		rc |= cow1_expect(cdev, name, &hdr, overlay_size, exp);	\
+	} while (0)
+
+	for (bits = COW_MIN_CLUSTER_BITS; bits <= COW_MAX_CLUSTER_BITS;
+	     bits++) {
+		/* Headers written by cow_format() are accepted */
+		COW1_CHECK("valid", , COW1_OVERLAY_SIZE, VMM_OK);
+		COW1_CHECK("exact overlay", , hdr.next_free, VMM_OK);
+
+		/* Identity and geometry */
+		COW1_CHECK("magic", hdr.magic++,
+			   COW1_OVERLAY_SIZE, VMM_EINVALID);
+		COW1_CHECK("version", hdr.version++,
+			   COW1_OVERLAY_SIZE, VMM_EINVALID);
+		COW1_CHECK("size", hdr.size += 512,
+			   COW1_OVERLAY_SIZE, VMM_EINVALID);
+
+		/* L1 size must match base size */
+		COW1_CHECK("zero l1_size", hdr.l1_size = 0,
+			   COW1_OVERLAY_SIZE, VMM_EINVALID);
+		COW1_CHECK("small l1_size", hdr.l1_size--,
+			   COW1_OVERLAY_SIZE, VMM_EINVALID);
+		COW1_CHECK("large l1_size", hdr.l1_size++,
+			   COW1_OVERLAY_SIZE, VMM_EINVALID);
+		COW1_CHECK("huge l1_size", hdr.l1_size = 0xFFFFFFFF,
+			   COW1_OVERLAY_SIZE, VMM_EINVALID);
+
+		/* L1 table placement */
+		COW1_CHECK("zero l1_offset", hdr.l1_offset = 0,
+			   COW1_OVERLAY_SIZE, VMM_EINVALID);
+		COW1_CHECK("unaligned l1_offset", hdr.l1_offset += 8,
+			   COW1_OVERLAY_SIZE, VMM_EINVALID);
+		COW1_CHECK("l1_offset past next_free",
+			   hdr.l1_offset = hdr.next_free + csize,
+			   COW1_OVERLAY_SIZE, VMM_EINVALID);
+		COW1_CHECK("l1_offset overflow",
+			   hdr.l1_offset = ~(csize - 1),
+			   COW1_OVERLAY_SIZE, VMM_EINVALID);
+
+		/* First free cluster */
+		COW1_CHECK("unaligned next_free", hdr.next_free += 8,
+			   COW1_OVERLAY_SIZE, VMM_EINVALID);
+		COW1_CHECK("next_free overlaps l1",
+			   hdr.next_free = hdr.l1_offset,
+			   COW1_OVERLAY_SIZE, VMM_EINVALID);
+		COW1_CHECK("next_free past overlay", ,
+			   hdr.next_free - 512, VMM_EINVALID);
+		COW1_CHECK("next_free overflow",
+			   hdr.next_free = ~(csize - 1),
+			   COW1_OVERLAY_SIZE, VMM_EINVALID);
+	}
+
+	/* Cluster size limits */
+	bits = COW_MIN_CLUSTER_BITS;
+	COW1_CHECK("small cluster_bits", hdr.cluster_bits--,
+		   COW1_OVERLAY_SIZE, VMM_EINVALID);
+	bits = COW_MAX_CLUSTER_BITS;
+	COW1_CHECK("large cluster_bits", hdr.cluster_bits++,
+		   COW1_OVERLAY_SIZE, VMM_EINVALID);
+
+#undef COW1_CHECK
+
+	return (rc) ? VMM_EFAIL : VMM_OK;
+}
+
+static struct wboxtest cow1 = {
+	.name = "cow1",
+	.run = cow1_run,
+};
+
+static int __init cow1_init(void)
+{
+	return wboxtest_register("block", &cow1);
+}
+
+static void __exit cow1_exit(void)
+{
+	wboxtest_unregister(&cow1);
+}
+
+VMM_DECLARE_MODULE(MODULE_DESC,
+			MODULE_AUTHOR,
+			MODULE_LICENSE,
+			MODULE_IPRIORITY,
+			MODULE_INIT,
+			MODULE_EXIT);
@@ -0,0 +1,26 @@
+#/**
+# Copyright (c) 2026 agent.
+# All rights reserved.
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2, or (at your option)
+# any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+#
+# @file objects.mk
+# @author agent (agent@local)
+# @brief list of block test objects to be built
+# */
+
+libs-objs-$(CONFIG_WBOXTEST_BLOCK) += wboxtest/block/blockrq1.o
+libs-objs-$(CONFIG_WBOXTEST_BLOCK) += wboxtest/block/stats1.o
+libs-objs-$(CONFIG_WBOXTEST_BLOCK_COW) += wboxtest/block/cow1.o
@@ -0,0 +1,326 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file stats1.c
+ * @author agent (agent@local)
+ * @brief stats1 test implementation
+ *
+ * This test drives a synchronous request queue through rejected
+ * submits, backlog, aborts and backlog issue failures. It checks that
+ * every request is called back exactly once and that block device
+ * statistics account it exactly once.
+ */
+
+#include <vmm_error.h>
+#include <vmm_heap.h>
+#include <vmm_stdio.h>
+#include <vmm_modules.h>
+#include <block/vmm_blockdev.h>
+#include <libs/stringlib.h>
+#include <libs/wboxtest.h>
+
+#define MODULE_DESC			"stats1 test"
+#define MODULE_AUTHOR			"agent"
+#define MODULE_LICENSE			"GPL"
+#define MODULE_IPRIORITY		(WBOXTEST_IPRIORITY+1)
+#define	MODULE_INIT			stats1_init
+#define	MODULE_EXIT			stats1_exit
+
+#define STATS1_BLOCK_SIZE		512
+#define STATS1_NUM_BLOCKS		64
+#define STATS1_MAX_PENDING		2
+#define STATS1_REQ_COUNT		6
+
+struct stats1_req {
+	struct vmm_request r;
+	u32 completed;
+	u32 failed;
+	u8 buf[STATS1_BLOCK_SIZE];
+};
+
+struct stats1_ctx {
+	struct vmm_request_queue rq;
+	int reject;
+	u32 issued;
+	u32 aborted;
+	struct stats1_req reqs[STATS1_REQ_COUNT];
+};
+
+/* Requests are only recorded and later completed by test itself */
+static int stats1_make_request(struct vmm_request_queue *rq,
+			       struct vmm_request *r)
+{
+	struct stats1_ctx *ctx = rq->priv;
+
+	if (ctx->reject) {
+		return ctx->reject;
+	}
+	ctx->issued++;
+
+	return VMM_OK;
+}
+
+static int stats1_abort_request(struct vmm_request_queue *rq,
+				struct vmm_request *r)
+{
+	struct stats1_ctx *ctx = rq->priv;
+
+	ctx->aborted++;
+
+	return VMM_OK;
+}
+
+static void stats1_completed(struct vmm_request *r)
+{
+	struct stats1_req *req = r->priv;
+
+	req->completed++;
+}
+
+static void stats1_failed(struct vmm_request *r)
+{
+	struct stats1_req *req = r->priv;
+
+	req->failed++;
+}
+
+static int stats1_submit(struct vmm_blockdev *bdev,
+			 struct stats1_req *req,
+			 enum vmm_request_type type, u64 lba)
+{
+	memset(&req->r, 0, sizeof(req->r));
+	INIT_LIST_HEAD(&req->r.head);
+	req->r.type = type;
+	req->r.lba = lba;
+	req->r.bcnt = 1;
+	req->r.data = req->buf;
+	req->r.completed = stats1_completed;
+	req->r.failed = stats1_failed;
+	req->r.priv = req;
+	req->completed = 0;
+	req->failed = 0;
+
+	return vmm_blockdev_submit_request(bdev, &req->r);
+}
+
+/* Check request queue counters and in-flight requests */
+static int stats1_check(struct vmm_chardev *cdev,
+			struct vmm_blockdev *bdev, const char *step,
+			u32 pending, u32 backlog, u64 in_flight)
+{
+	struct vmm_blockdev_stats st;
+
+	vmm_blockdev_get_stats(bdev, &st);
+	if ((bdev->rq->pending_count != pending) ||
+	    (bdev->rq->backlog_count != backlog) ||
+	    (vmm_blockdev_stats_in_flight(&st) != in_flight) ||
+	    ((st.submitted - st.completed) != in_flight)) {
+		vmm_cprintf(cdev, "error: %s pending %d backlog %d "
+			    "in-flight %"PRIu64" (expected %d %d %"PRIu64")\n",
+			    step, bdev->rq->pending_count,
+			    bdev->rq->backlog_count,
+			    vmm_blockdev_stats_in_flight(&st),
+			    pending, backlog, in_flight);
+		return VMM_EFAIL;
+	}
+
+	return VMM_OK;
+}
+
+/* Check callbacks of request */
+static int stats1_check_req(struct vmm_chardev *cdev,
+			    struct stats1_req *req, u32 index,
+			    u32 completed, u32 failed)
+{
+	if ((req->completed != completed) || (req->failed != failed)) {
+		vmm_cprintf(cdev, "error: request %d completed %d failed %d "
+			    "(expected %d %d)\n", index, req->completed,
+			    req->failed, completed, failed);
+		return VMM_EFAIL;
+	}
+
+	return VMM_OK;
+}
+
+static int stats1_test(struct vmm_chardev *cdev,
+		       struct vmm_blockdev *bdev,
+		       struct stats1_ctx *ctx)
+{
+	int rc;
+	u32 i;
+	struct stats1_req *reqs = ctx->reqs;
+	struct vmm_blockdev_stats st;
+
+	/* Rejected submit is reported only by return value */
+	ctx->reject = VMM_EIO;
+	rc = stats1_submit(bdev, &reqs[5], VMM_REQUEST_READ, 5);
+	ctx->reject = VMM_OK;
+	if (rc != VMM_EIO) {
+		vmm_cprintf(cdev, "error: rejected submit gives %d\n", rc);
+		return VMM_EFAIL;
+	}
+	if (stats1_check_req(cdev, &reqs[5], 5, 0, 0) ||
+	    stats1_check(cdev, bdev, "reject", 0, 0, 0)) {
+		return VMM_EFAIL;
+	}
+
+	/* Two requests issued and three waiting in backlog */
+	for (i = 0; i < 5; i++) {
+		rc = stats1_submit(bdev, &reqs[i], (i == 4) ?
+				   VMM_REQUEST_WRITE : VMM_REQUEST_READ, i);
+		if (rc) {
+			vmm_cprintf(cdev, "error: submit %d gives %d\n",
+				    i, rc);
+			return VMM_EFAIL;
+		}
+	}
+	if ((ctx->issued != STATS1_MAX_PENDING) ||
+	    stats1_check(cdev, bdev, "backlog", STATS1_MAX_PENDING, 3, 5)) {
+		return VMM_EFAIL;
+	}
+
+	/* Abort of backlog request must not release a pending slot */
+	rc = vmm_blockdev_abort_request(&reqs[3].r);
+	if (rc || ctx->aborted || (ctx->issued != STATS1_MAX_PENDING) ||
+	    stats1_check_req(cdev, &reqs[3], 3, 0, 1) ||
+	    stats1_check(cdev, bdev, "abort backlog",
+			 STATS1_MAX_PENDING, 2, 4)) {
+		vmm_cprintf(cdev, "error: abort backlog rc %d aborted %d "
+			    "issued %d\n", rc, ctx->aborted, ctx->issued);
+		return VMM_EFAIL;
+	}
+
+	/* Abort of issued request issues next backlog request */
+	rc = vmm_blockdev_abort_request(&reqs[1].r);
+	if (rc || (ctx->aborted != 1) || (ctx->issued != 3) ||
+	    stats1_check_req(cdev, &reqs[1], 1, 0, 1) ||
+	    stats1_check(cdev, bdev, "abort issued",
+			 STATS1_MAX_PENDING, 1, 3)) {
+		vmm_cprintf(cdev, "error: abort issued rc %d aborted %d "
+			    "issued %d\n", rc, ctx->aborted, ctx->issued);
+		return VMM_EFAIL;
+	}
+
+	/* Backlog request rejected on issue is failed once */
+	ctx->reject = VMM_EIO;
+	rc = vmm_blockdev_complete_request(&reqs[0].r);
+	ctx->reject = VMM_OK;
+	if (rc || stats1_check_req(cdev, &reqs[0], 0, 1, 0) ||
+	    stats1_check_req(cdev, &reqs[4], 4, 0, 1) ||
+	    stats1_check(cdev, bdev, "backlog reject", 1, 0, 1)) {
+		return VMM_EFAIL;
+	}
+
+	rc = vmm_blockdev_complete_request(&reqs[2].r);
+	if (rc || stats1_check_req(cdev, &reqs[2], 2, 1, 0) ||
+	    stats1_check(cdev, bdev, "drain", 0, 0, 0)) {
+		return VMM_EFAIL;
+	}
+
+	/* Finished requests can't be aborted or called back again */
+	if (!vmm_blockdev_abort_request(&reqs[3].r) ||
+	    !vmm_blockdev_abort_request(&reqs[4].r)) {
+		vmm_cprintf(cdev, "error: finished request aborted\n");
+		return VMM_EFAIL;
+	}
+	for (i = 0; i < STATS1_REQ_COUNT; i++) {
+		rc = stats1_check_req(cdev, &reqs[i], i,
+				      (i == 0 || i == 2) ? 1 : 0,
+				      (i == 0 || i == 2 || i == 5) ? 0 : 1);
+		if (rc) {
+			return rc;
+		}
+	}
+
+	/* Every submitted request accounted exactly once */
+	vmm_blockdev_get_stats(bdev, &st);
+	if ((st.submitted != 6) || (st.completed != 6) ||
+	    (st.ops[VMM_BLOCKDEV_STATS_READ] != 2) ||
+	    (st.ops[VMM_BLOCKDEV_STATS_WRITE] != 0) ||
+	    (st.errors[VMM_BLOCKDEV_STATS_READ] != 3) ||
+	    (st.errors[VMM_BLOCKDEV_STATS_WRITE] != 1) ||
+	    (st.bytes[VMM_BLOCKDEV_STATS_READ] != 2 * STATS1_BLOCK_SIZE)) {
+		vmm_cprintf(cdev, "error: submitted %"PRIu64" completed "
+			    "%"PRIu64" ops %"PRIu64"/%"PRIu64" errors "
+			    "%"PRIu64"/%"PRIu64"\n", st.submitted,
+			    st.completed, st.ops[VMM_BLOCKDEV_STATS_READ],
+			    st.ops[VMM_BLOCKDEV_STATS_WRITE],
+			    st.errors[VMM_BLOCKDEV_STATS_READ],
+			    st.errors[VMM_BLOCKDEV_STATS_WRITE]);
+		return VMM_EFAIL;
+	}
+
+	return VMM_OK;
+}
+
+static int stats1_run(struct wboxtest *test, struct vmm_chardev *cdev,
+		      u32 test_hcpu)
+{
+	int rc;
+	struct vmm_blockdev *bdev;
+	struct stats1_ctx *ctx;
+
+	ctx = vmm_zalloc(sizeof(*ctx));
+	if (!ctx) {
+		return VMM_ENOMEM;
+	}
+	INIT_REQUEST_QUEUE(&ctx->rq, STATS1_MAX_PENDING,
+			   stats1_make_request, stats1_abort_request,
+			   NULL, ctx);
+
+	bdev = vmm_blockdev_alloc();
+	if (!bdev) {
+		vmm_free(ctx);
+		return VMM_ENOMEM;
+	}
+	strncpy(bdev->name, "stats1", sizeof(bdev->name));
+	bdev->flags = VMM_BLOCKDEV_RW;
+	bdev->start_lba = 0;
+	bdev->num_blocks = STATS1_NUM_BLOCKS;
+	bdev->block_size = STATS1_BLOCK_SIZE;
+	bdev->rq = &ctx->rq;
+
+	rc = stats1_test(cdev, bdev, ctx);
+
+	vmm_blockdev_free(bdev);
+	vmm_free(ctx);
+
+	return rc;
+}
+
+static struct wboxtest stats1 = {
+	.name = "stats1",
+	.run = stats1_run,
+};
+
+static int __init stats1_init(void)
+{
+	return wboxtest_register("block", &stats1);
+}
+
+static void __exit stats1_exit(void)
+{
+	wboxtest_unregister(&stats1);
+}
+
+VMM_DECLARE_MODULE(MODULE_DESC,
+			MODULE_AUTHOR,
+			MODULE_LICENSE,
+			MODULE_IPRIORITY,
+			MODULE_INIT,
+			MODULE_EXIT);
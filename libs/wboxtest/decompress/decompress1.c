@@ -0,0 +1,576 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file decompress1.c
+ * @author agent (agent@local)
+ * @brief decompress1 test implementation
+ *
+ * This test decompresses small gzip and LZ4 streams of known content
+ * with different read sizes and checks the output byte-by-byte. It
+ * also checks that truncated and corrupted streams are rejected.
+ */
+
+#include <vmm_error.h>
+#include <vmm_heap.h>
+#include <vmm_stdio.h>
+#include <vmm_modules.h>
+#include <libs/stringlib.h>
+#include <libs/decompress.h>
+#include <libs/wboxtest.h>
+
+#define MODULE_DESC			"decompress1 test"
+#define MODULE_AUTHOR			"agent"
+#define MODULE_LICENSE			"GPL"
+#define MODULE_IPRIORITY		(WBOXTEST_IPRIORITY+1)
+#define	MODULE_INIT			decompress1_init
+#define	MODULE_EXIT			decompress1_exit
+
+/*
+ * Uncompressed content is 64 copies of DECOMPRESS1_LINE followed by
+ * DECOMPRESS1_RAND_COUNT letters of "ACGT" picked by an LCG.
+ */
+#define DECOMPRESS1_LINE		"The quick brown fox jumps over the lazy dog.\n"
+#define DECOMPRESS1_LINE_COUNT		64
+#define DECOMPRESS1_RAND_COUNT		1024
+#define DECOMPRESS1_SIZE		((sizeof(DECOMPRESS1_LINE) - 1) * \
+					 DECOMPRESS1_LINE_COUNT + \
+					 DECOMPRESS1_RAND_COUNT)
+#define DECOMPRESS1_STORED_SIZE		90
+
+/* gzip with dynamic Huffman block (zlib level 9) */
+static const u8 decompress1_gzip[] = {
+	0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xed, 0x93,
+	0xdb, 0x59, 0xdc, 0x50, 0x0c, 0x84, 0xdf, 0xa9, 0xc2, 0x15, 0xd0, 0xc3,
+	0x7c, 0x7a, 0x50, 0x03, 0x6a, 0x80, 0x84, 0xcd, 0x85, 0x5c, 0x0c, 0x4b,
+	0x36, 0x09, 0x54, 0x1f, 0xcd, 0x2f, 0xef, 0x36, 0x91, 0xf3, 0x19, 0xb0,
+	0x39, 0x1e, 0x8d, 0x46, 0x33, 0x72, 0x7d, 0x39, 0x6d, 0x2f, 0x97, 0xaf,
+	0x1f, 0xbf, 0x6d, 0x1f, 0xce, 0xfb, 0x9f, 0x9f, 0xdb, 0xa7, 0xfd, 0xef,
+	0xf6, 0x74, 0xf9, 0xf1, 0xfc, 0xba, 0xed, 0xbf, 0x4f, 0xe7, 0xed, 0x57,
+	0xbf, 0xfe, 0xfe, 0xf0, 0xfe, 0xb6, 0x3d, 0xee, 0x9f, 0xef, 0xef, 0x6a,
+	0x81, 0x17, 0x78, 0x81, 0x17, 0x78, 0x81, 0x17, 0x78, 0x81, 0x17, 0x78,
+	0x81, 0x17, 0xf8, 0xff, 0x06, 0x67, 0x46, 0x55, 0x65, 0xa9, 0xef, 0x52,
+	0x54, 0x5f, 0x99, 0xc9, 0x51, 0x64, 0x1f, 0xf8, 0x39, 0x23, 0xe4, 0x77,
+	0xfd, 0x50, 0x8d, 0x97, 0xca, 0x90, 0xa0, 0xb0, 0x2b, 0xc3, 0x15, 0xa9,
+	0xfe, 0xe9, 0xa7, 0xe2, 0x7d, 0x85, 0xfa, 0x0a, 0x35, 0x47, 0xbf, 0xf7,
+	0x21, 0xbf, 0xfc, 0xd3, 0xb4, 0x8d, 0x6c, 0xb8, 0xd1, 0xe6, 0x4e, 0xf7,
+	0xe9, 0x22, 0x77, 0x07, 0x5f, 0x66, 0x0e, 0x13, 0xb8, 0x87, 0xcb, 0x0c,
+	0x41, 0x29, 0xe4, 0x89, 0x98, 0x66, 0x4f, 0xf7, 0xb1, 0x62, 0x3f, 0x7b,
+	0x80, 0x11, 0x63, 0x40, 0x53, 0xcb, 0xad, 0xfa, 0xc8, 0x50, 0xce, 0x9a,
+	0xbc, 0xeb, 0x64, 0x0a, 0x59, 0x4b, 0xa1, 0x9c, 0x86, 0x1e, 0xcb, 0x13,
+	0xa5, 0x95, 0x1a, 0x69, 0x11, 0xf6, 0xa4, 0x18, 0x6b, 0x94, 0x8e, 0x25,
+	0x0d, 0x6f, 0xb9, 0x05, 0x2f, 0xbe, 0x45, 0x5c, 0x47, 0x8e, 0x3a, 0x46,
+	0x17, 0xe8, 0x0a, 0x8c, 0x12, 0x42, 0x3c, 0x66, 0xd3, 0x46, 0x5d, 0x49,
+	0xdb, 0x05, 0xc6, 0xc1, 0xbd, 0xc4, 0x2f, 0xe3, 0x4c, 0xec, 0xf9, 0x99,
+	0x44, 0x3e, 0x08, 0xeb, 0x0f, 0x2a, 0xf1, 0x9c, 0x20, 0x3c, 0x36, 0x42,
+	0xda, 0xcd, 0x16, 0xc1, 0x04, 0x84, 0xa5, 0x89, 0x32, 0x90, 0x2f, 0x5b,
+	0x3d, 0xa1, 0x99, 0x0c, 0x29, 0x65, 0xbd, 0xc5, 0x25, 0x68, 0xc8, 0xd2,
+	0x92, 0x67, 0xfa, 0xf1, 0x86, 0x90, 0x83, 0x58, 0x63, 0xaa, 0x5c, 0x6f,
+	0x21, 0x39, 0x31, 0x15, 0x19, 0x60, 0x3e, 0x8d, 0x91, 0xa7, 0x19, 0xcc,
+	0x74, 0x6e, 0x76, 0x64, 0x10, 0xc4, 0x9d, 0x62, 0xfa, 0x29, 0x9a, 0x29,
+	0x6c, 0x39, 0xf6, 0x55, 0x02, 0x98, 0xa8, 0x0b, 0x9b, 0xd1, 0xe5, 0x4e,
+	0x1e, 0xc8, 0x49, 0x23, 0xd9, 0x04, 0x34, 0x66, 0x59, 0x19, 0x93, 0x1e,
+	0xa5, 0x23, 0xf5, 0xc3, 0x2e, 0x03, 0xc5, 0x9d, 0x9d, 0x1c, 0xb7, 0xad,
+	0x8b, 0x33, 0x8d, 0x9f, 0xf6, 0xdf, 0x86, 0xda, 0x34, 0xc2, 0xf0, 0xdd,
+	0xe5, 0x6c, 0x4a, 0xcc, 0xd6, 0x0f, 0xb0, 0x08, 0x46, 0xa3, 0x26, 0x67,
+	0x34, 0x21, 0x50, 0xb3, 0xf1, 0x8c, 0x10, 0x87, 0x93, 0x81, 0x03, 0xb4,
+	0x4b, 0xd6, 0x2d, 0xae, 0x8f, 0xec, 0x87, 0xe1, 0xb8, 0x31, 0x4b, 0xe2,
+	0x90, 0x58, 0x27, 0x91, 0xe3, 0xfc, 0xb1, 0xcd, 0x90, 0x6a, 0x76, 0x5f,
+	0xb7, 0xf5, 0xb1, 0x53, 0xf3, 0xc9, 0x4d, 0x94, 0xbc, 0xf3, 0xf7, 0x9a,
+	0x88, 0x4f, 0x42, 0xaa, 0x51, 0x7f, 0x23, 0x9c, 0x4f, 0xd3, 0xca, 0x29,
+	0x76, 0x7d, 0xf0, 0xc1, 0xfc, 0x03, 0xf7, 0x0c, 0x09, 0x90, 0x40, 0x0f,
+	0x00, 0x00,
+};
+
+/* gzip with fixed Huffman block (zlib Z_FIXED) */
+static const u8 decompress1_gzip_fixed[] = {
+	0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x0b, 0xc9,
+	0x48, 0x55, 0x28, 0x2c, 0xcd, 0x4c, 0xce, 0x56, 0x48, 0x2a, 0xca, 0x2f,
+	0xcf, 0x53, 0x48, 0xcb, 0xaf, 0x50, 0xc8, 0x2a, 0xcd, 0x2d, 0x28, 0x56,
+	0xc8, 0x2f, 0x4b, 0x2d, 0x52, 0x28, 0x01, 0x4a, 0xe7, 0x24, 0x56, 0x55,
+	0x2a, 0xa4, 0xe4, 0xa7, 0xeb, 0x71, 0x85, 0x8c, 0x2a, 0x1e, 0x55, 0x3c,
+	0xaa, 0x78, 0x54, 0xf1, 0xa8, 0xe2, 0x51, 0xc5, 0xa3, 0x8a, 0x47, 0x15,
+	0x8f, 0x2a, 0x1e, 0x55, 0x3c, 0xb2, 0x15, 0xbb, 0xbb, 0x3b, 0x87, 0x84,
+	0x84, 0xb8, 0x87, 0x38, 0x02, 0x69, 0x47, 0x47, 0xe7, 0x10, 0x20, 0x74,
+	0x77, 0x77, 0x07, 0x0b, 0x39, 0xbb, 0x03, 0x05, 0x40, 0x6c, 0x77, 0x67,
+	0x67, 0x47, 0x90, 0x1c, 0x90, 0x11, 0x02, 0x54, 0xef, 0xe8, 0x18, 0x02,
+	0x52, 0xe2, 0x0c, 0xd6, 0x08, 0xd4, 0xe9, 0x0c, 0xd2, 0xe1, 0xee, 0x08,
+	0x44, 0x40, 0x56, 0x08, 0x58, 0x3e, 0xc4, 0xd9, 0x11, 0x08, 0x9d, 0x1d,
+	0x81, 0x66, 0x00, 0xe5, 0x41, 0x82, 0x60, 0x0c, 0xe6, 0x00, 0x8d, 0x05,
+	0xaa, 0x04, 0x2a, 0x07, 0xa9, 0x06, 0x99, 0xed, 0x0e, 0xb2, 0x07, 0xa8,
+	0x09, 0x64, 0x3b, 0x58, 0x7d, 0x08, 0xc8, 0x64, 0x67, 0x90, 0x01, 0x20,
+	0x3b, 0x40, 0xda, 0x40, 0x4a, 0xc0, 0x2e, 0x05, 0x1b, 0xee, 0x0e, 0x76,
+	0x0c, 0xd0, 0x74, 0x77, 0x90, 0x3d, 0x20, 0x17, 0x83, 0xd8, 0x20, 0x0f,
+	0x40, 0x1c, 0x03, 0x52, 0x00, 0x34, 0xda, 0x11, 0x64, 0x15, 0x50, 0x08,
+	0xa4, 0x14, 0x2c, 0x06, 0x34, 0x1c, 0xa8, 0xcf, 0x11, 0x64, 0x84, 0x23,
+	0xc8, 0x2d, 0x21, 0x60, 0x97, 0x83, 0x2d, 0x04, 0x79, 0x0b, 0xe4, 0x23,
+	0x77, 0x90, 0x4b, 0x41, 0x2a, 0x41, 0x8e, 0x00, 0x85, 0x49, 0x08, 0xd8,
+	0x5b, 0x10, 0x97, 0x42, 0x82, 0x04, 0xa8, 0x1c, 0xe8, 0xdc, 0x10, 0xb0,
+	0xb9, 0xe0, 0x70, 0x73, 0x76, 0x86, 0x79, 0xd9, 0x39, 0x04, 0xea, 0x75,
+	0x47, 0xb0, 0xea, 0x10, 0x67, 0x70, 0x40, 0x39, 0x82, 0x1d, 0x02, 0xf2,
+	0x26, 0xd0, 0x58, 0xe7, 0x10, 0x98, 0xa1, 0xc0, 0x50, 0x00, 0x7b, 0x07,
+	0x1c, 0x7a, 0xee, 0xe0, 0xf0, 0x02, 0xa9, 0x03, 0x19, 0x0c, 0xf2, 0x3f,
+	0xd8, 0x27, 0x8e, 0x20, 0x01, 0x67, 0x90, 0xfb, 0x9d, 0xc1, 0x3a, 0xc1,
+	0x61, 0x0e, 0x8e, 0x08, 0x90, 0xb7, 0xc1, 0x0e, 0x01, 0x86, 0x26, 0xd0,
+	0x11, 0x60, 0x1f, 0x80, 0x23, 0xcb, 0x11, 0x12, 0x95, 0xce, 0x60, 0xe7,
+	0x3b, 0x82, 0x82, 0x1a, 0x12, 0x69, 0x20, 0xc3, 0xc0, 0x4e, 0x09, 0x01,
+	0xb9, 0x37, 0x04, 0x0c, 0x1d, 0xc1, 0xc6, 0x80, 0xe3, 0x12, 0xe4, 0x64,
+	0x88, 0xef, 0x21, 0x61, 0x03, 0x8e, 0x64, 0x67, 0x70, 0xb4, 0x3a, 0x43,
+	0x74, 0x81, 0xf4, 0x83, 0x1c, 0xe2, 0x0e, 0x89, 0xa6, 0x10, 0x70, 0x1c,
+	0x80, 0x03, 0x1f, 0x6c, 0x31, 0xd8, 0x79, 0x8e, 0x10, 0x8f, 0x81, 0x8c,
+	0x03, 0x59, 0x06, 0x8d, 0x03, 0x67, 0x70, 0x74, 0xbb, 0x3b, 0x82, 0x7d,
+	0x0f, 0xd1, 0x04, 0xf1, 0x05, 0x28, 0xc8, 0xc1, 0xc1, 0x17, 0xe2, 0x0e,
+	0x56, 0x00, 0x89, 0xea, 0x10, 0x70, 0x30, 0x83, 0xdd, 0x05, 0xb2, 0x09,
+	0xe4, 0x21, 0x50, 0x4c, 0x83, 0x9d, 0x0c, 0x32, 0x00, 0x6c, 0x31, 0x38,
+	0xb1, 0x82, 0xbd, 0x09, 0xb6, 0x23, 0xc4, 0x11, 0x1a, 0xeb, 0xd0, 0xe0,
+	0x02, 0x29, 0x74, 0x04, 0xd3, 0xe0, 0x34, 0x09, 0x09, 0x6d, 0x90, 0xbb,
+	0xc0, 0x62, 0x8e, 0x90, 0xf0, 0x04, 0x85, 0x3f, 0x28, 0x40, 0x41, 0x81,
+	0x06, 0x8e, 0x0c, 0x10, 0x0d, 0xd2, 0x0e, 0x4e, 0x29, 0xce, 0x90, 0x54,
+	0x0f, 0x51, 0x18, 0x02, 0x8e, 0x18, 0x47, 0x88, 0x6b, 0xdc, 0x21, 0x5e,
+	0x73, 0x04, 0x3b, 0xd0, 0x11, 0x92, 0xe2, 0xc1, 0x5e, 0x70, 0x86, 0x86,
+	0xa4, 0x33, 0x38, 0x04, 0xc0, 0xd6, 0xb9, 0x83, 0x93, 0x9b, 0x33, 0x8c,
+	0x09, 0x4e, 0x1f, 0x20, 0xe5, 0xe0, 0xd0, 0x80, 0x24, 0x12, 0x50, 0x24,
+	0x81, 0x93, 0x93, 0x23, 0x38, 0x1e, 0x21, 0x04, 0x28, 0x98, 0xc1, 0x86,
+	0x3a, 0x42, 0xd2, 0xbe, 0x23, 0x3c, 0xf9, 0x80, 0x42, 0x0a, 0x92, 0xe5,
+	0x20, 0x51, 0x09, 0x96, 0x03, 0xe5, 0x57, 0x77, 0xb0, 0xe3, 0xdd, 0xc1,
+	0x91, 0x14, 0x02, 0x71, 0x3d, 0xdc, 0x40, 0x48, 0xd6, 0x04, 0xb9, 0x1c,
+	0xac, 0x19, 0xa4, 0xdf, 0x19, 0x9c, 0x61, 0x00, 0xf7, 0x0c, 0x09, 0x90,
+	0x40, 0x0f, 0x00, 0x00,
+};
+
+/* gzip with stored block of first 90 bytes (zlib level 0) */
+static const u8 decompress1_gzip_stored[] = {
+	0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x03, 0x01, 0x5a,
+	0x00, 0xa5, 0xff, 0x54, 0x68, 0x65, 0x20, 0x71, 0x75, 0x69, 0x63, 0x6b,
+	0x20, 0x62, 0x72, 0x6f, 0x77, 0x6e, 0x20, 0x66, 0x6f, 0x78, 0x20, 0x6a,
+	0x75, 0x6d, 0x70, 0x73, 0x20, 0x6f, 0x76, 0x65, 0x72, 0x20, 0x74, 0x68,
+	0x65, 0x20, 0x6c, 0x61, 0x7a, 0x79, 0x20, 0x64, 0x6f, 0x67, 0x2e, 0x0a,
+	0x54, 0x68, 0x65, 0x20, 0x71, 0x75, 0x69, 0x63, 0x6b, 0x20, 0x62, 0x72,
+	0x6f, 0x77, 0x6e, 0x20, 0x66, 0x6f, 0x78, 0x20, 0x6a, 0x75, 0x6d, 0x70,
+	0x73, 0x20, 0x6f, 0x76, 0x65, 0x72, 0x20, 0x74, 0x68, 0x65, 0x20, 0x6c,
+	0x61, 0x7a, 0x79, 0x20, 0x64, 0x6f, 0x67, 0x2e, 0x0a, 0xc7, 0x78, 0x08,
+	0x34, 0x5a, 0x00, 0x00, 0x00,
+};
+
+/* LZ4 frame with content checksum (lz4 -9) */
+static const u8 decompress1_lz4[] = {
+	0x04, 0x22, 0x4d, 0x18, 0x64, 0x40, 0xa7, 0xf0, 0x02, 0x00, 0x00, 0xff,
+	0x1e, 0x54, 0x68, 0x65, 0x20, 0x71, 0x75, 0x69, 0x63, 0x6b, 0x20, 0x62,
+	0x72, 0x6f, 0x77, 0x6e, 0x20, 0x66, 0x6f, 0x78, 0x20, 0x6a, 0x75, 0x6d,
+	0x70, 0x73, 0x20, 0x6f, 0x76, 0x65, 0x72, 0x20, 0x74, 0x68, 0x65, 0x20,
+	0x6c, 0x61, 0x7a, 0x79, 0x20, 0x64, 0x6f, 0x67, 0x2e, 0x0a, 0x2d, 0x00,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x0b,
+	0xf1, 0x07, 0x47, 0x47, 0x43, 0x54, 0x54, 0x54, 0x47, 0x54, 0x41, 0x47,
+	0x43, 0x54, 0x41, 0x41, 0x43, 0x54, 0x43, 0x54, 0x43, 0x47, 0x47, 0x47,
+	0x13, 0x00, 0x50, 0x43, 0x47, 0x41, 0x41, 0x43, 0x0c, 0x00, 0x40, 0x47,
+	0x43, 0x43, 0x41, 0x1c, 0x00, 0xa0, 0x54, 0x47, 0x43, 0x54, 0x47, 0x47,
+	0x43, 0x41, 0x41, 0x54, 0x23, 0x00, 0x11, 0x43, 0x39, 0x00, 0x40, 0x47,
+	0x54, 0x41, 0x43, 0x32, 0x00, 0x40, 0x47, 0x41, 0x47, 0x47, 0x0a, 0x00,
+	0x11, 0x54, 0x20, 0x00, 0xa0, 0x54, 0x43, 0x41, 0x43, 0x41, 0x43, 0x43,
+	0x41, 0x54, 0x43, 0x20, 0x00, 0x00, 0x15, 0x00, 0x01, 0x04, 0x00, 0x01,
+	0x0d, 0x00, 0xb2, 0x43, 0x47, 0x41, 0x47, 0x41, 0x43, 0x41, 0x47, 0x47,
+	0x43, 0x43, 0x5c, 0x00, 0x10, 0x47, 0x68, 0x00, 0x30, 0x41, 0x41, 0x54,
+	0x7e, 0x00, 0x01, 0x30, 0x00, 0x10, 0x54, 0x5a, 0x00, 0x10, 0x43, 0x41,
+	0x00, 0x00, 0x64, 0x00, 0x00, 0x37, 0x00, 0x00, 0x23, 0x00, 0x01, 0xaa,
+	0x00, 0x01, 0x5d, 0x00, 0x11, 0x47, 0x8d, 0x00, 0x20, 0x43, 0x41, 0xa4,
+	0x00, 0x20, 0x41, 0x43, 0xb2, 0x00, 0x00, 0x0c, 0x00, 0x00, 0xc1, 0x00,
+	0x02, 0x8d, 0x00, 0x00, 0x21, 0x00, 0x20, 0x47, 0x54, 0xd3, 0x00, 0x10,
+	0x47, 0x57, 0x00, 0x00, 0x2b, 0x00, 0x01, 0x14, 0x00, 0x20, 0x43, 0x47,
+	0x5a, 0x00, 0x10, 0x41, 0x43, 0x00, 0x10, 0x41, 0x8c, 0x00, 0x11, 0x54,
+	0xba, 0x00, 0x01, 0x71, 0x00, 0x00, 0xd7, 0x00, 0x21, 0x54, 0x43, 0xdf,
+	0x00, 0x10, 0x47, 0x08, 0x01, 0x10, 0x47, 0x85, 0x00, 0x00, 0x14, 0x01,
+	0x11, 0x54, 0xd7, 0x00, 0x02, 0xaa, 0x00, 0x02, 0x13, 0x01, 0x71, 0x41,
+	0x43, 0x54, 0x41, 0x43, 0x41, 0x54, 0x58, 0x00, 0x01, 0x38, 0x01, 0x24,
+	0x43, 0x43, 0xf3, 0x00, 0x23, 0x43, 0x54, 0xfb, 0x00, 0x11, 0x41, 0x2e,
+	0x00, 0x31, 0x54, 0x43, 0x54, 0x60, 0x00, 0x01, 0x89, 0x00, 0x00, 0xe7,
+	0x00, 0x20, 0x43, 0x47, 0x63, 0x00, 0x03, 0x55, 0x00, 0x31, 0x41, 0x47,
+	0x41, 0xcf, 0x00, 0x01, 0x3e, 0x01, 0x11, 0x47, 0x30, 0x01, 0x00, 0x28,
+	0x00, 0x00, 0x59, 0x00, 0x00, 0x00, 0x01, 0x22, 0x41, 0x43, 0x32, 0x00,
+	0x00, 0x0e, 0x00, 0x11, 0x43, 0x66, 0x00, 0x11, 0x54, 0x05, 0x00, 0x00,
+	0x56, 0x00, 0x02, 0x0a, 0x00, 0x11, 0x43, 0x89, 0x00, 0x20, 0x47, 0x41,
+	0x85, 0x00, 0x01, 0xc2, 0x00, 0x01, 0xad, 0x01, 0x12, 0x41, 0xcb, 0x01,
+	0x11, 0x43, 0xbf, 0x00, 0x10, 0x41, 0x6b, 0x01, 0x02, 0xb5, 0x01, 0x00,
+	0x4d, 0x00, 0x01, 0x8b, 0x00, 0x10, 0x54, 0xb0, 0x00, 0x11, 0x54, 0x02,
+	0x00, 0x11, 0x41, 0x47, 0x00, 0x01, 0xcc, 0x01, 0x00, 0xb3, 0x00, 0x02,
+	0xfe, 0x00, 0x02, 0x1c, 0x01, 0x01, 0xe5, 0x01, 0x11, 0x43, 0xd7, 0x01,
+	0x12, 0x43, 0x36, 0x00, 0x22, 0x47, 0x41, 0x89, 0x00, 0x12, 0x47, 0xa7,
+	0x01, 0x11, 0x54, 0x84, 0x01, 0x01, 0x7d, 0x01, 0x01, 0x79, 0x00, 0x01,
+	0x9f, 0x00, 0x12, 0x41, 0xd9, 0x00, 0x21, 0x43, 0x43, 0x26, 0x01, 0x13,
+	0x41, 0x84, 0x01, 0x11, 0x43, 0xef, 0x01, 0x21, 0x47, 0x41, 0xfe, 0x00,
+	0x02, 0x35, 0x00, 0x02, 0xc6, 0x00, 0x00, 0x73, 0x01, 0x01, 0x3f, 0x01,
+	0x21, 0x54, 0x47, 0x21, 0x00, 0x02, 0xeb, 0x01, 0x00, 0x58, 0x01, 0x02,
+	0x18, 0x01, 0x00, 0x2c, 0x00, 0x10, 0x47, 0xd1, 0x00, 0x00, 0xea, 0x01,
+	0x01, 0xb3, 0x00, 0x00, 0x41, 0x00, 0x01, 0x79, 0x00, 0x01, 0xad, 0x02,
+	0x01, 0xe7, 0x00, 0x01, 0x64, 0x00, 0x23, 0x54, 0x41, 0xf6, 0x01, 0x03,
+	0x2f, 0x01, 0x00, 0x29, 0x00, 0x11, 0x41, 0x08, 0x00, 0x01, 0x94, 0x02,
+	0x02, 0x6e, 0x01, 0x00, 0x98, 0x00, 0x01, 0x14, 0x00, 0x12, 0x41, 0x50,
+	0x01, 0x00, 0x80, 0x01, 0x00, 0x51, 0x01, 0x00, 0x35, 0x01, 0x01, 0x8d,
+	0x01, 0x00, 0x08, 0x00, 0x00, 0x3f, 0x00, 0x01, 0x2a, 0x02, 0x12, 0x43,
+	0xf6, 0x02, 0x02, 0x29, 0x00, 0x11, 0x54, 0x99, 0x01, 0x01, 0x8f, 0x01,
+	0x02, 0x1f, 0x01, 0x00, 0x0e, 0x00, 0x22, 0x47, 0x47, 0x86, 0x02, 0x01,
+	0xbd, 0x02, 0x00, 0xc3, 0x00, 0x13, 0x43, 0x4a, 0x01, 0x00, 0x14, 0x01,
+	0x01, 0x64, 0x00, 0x11, 0x41, 0x31, 0x02, 0x00, 0xc7, 0x00, 0x03, 0x0b,
+	0x00, 0x01, 0x20, 0x02, 0x00, 0x2f, 0x00, 0x01, 0x0e, 0x01, 0x02, 0x25,
+	0x02, 0x22, 0x41, 0x41, 0xf6, 0x01, 0x21, 0x54, 0x41, 0xc8, 0x01, 0x02,
+	0x05, 0x00, 0x00, 0x67, 0x01, 0x01, 0x55, 0x00, 0x00, 0x53, 0x01, 0x13,
+	0x41, 0x5f, 0x03, 0x01, 0x3f, 0x02, 0x22, 0x41, 0x47, 0xeb, 0x01, 0x13,
+	0x47, 0xcb, 0x01, 0x01, 0x1c, 0x00, 0x00, 0xb0, 0x03, 0x11, 0x47, 0xbd,
+	0x00, 0x00, 0xdf, 0x00, 0x03, 0xe5, 0x01, 0x16, 0x41, 0x51, 0x00, 0x02,
+	0x9b, 0x03, 0x00, 0xba, 0x00, 0x01, 0x3d, 0x00, 0xa0, 0x43, 0x43, 0x47,
+	0x47, 0x43, 0x47, 0x43, 0x54, 0x41, 0x54, 0x00, 0x00, 0x00, 0x00, 0xcb,
+	0xdb, 0x9a, 0x28,
+};
+
+/* LZ4 legacy frame (lz4 -l -9) */
+static const u8 decompress1_lz4_legacy[] = {
+	0x02, 0x21, 0x4c, 0x18, 0xf0, 0x02, 0x00, 0x00, 0xff, 0x1e, 0x54, 0x68,
+	0x65, 0x20, 0x71, 0x75, 0x69, 0x63, 0x6b, 0x20, 0x62, 0x72, 0x6f, 0x77,
+	0x6e, 0x20, 0x66, 0x6f, 0x78, 0x20, 0x6a, 0x75, 0x6d, 0x70, 0x73, 0x20,
+	0x6f, 0x76, 0x65, 0x72, 0x20, 0x74, 0x68, 0x65, 0x20, 0x6c, 0x61, 0x7a,
+	0x79, 0x20, 0x64, 0x6f, 0x67, 0x2e, 0x0a, 0x2d, 0x00, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x0b, 0xf1, 0x07, 0x47,
+	0x47, 0x43, 0x54, 0x54, 0x54, 0x47, 0x54, 0x41, 0x47, 0x43, 0x54, 0x41,
+	0x41, 0x43, 0x54, 0x43, 0x54, 0x43, 0x47, 0x47, 0x47, 0x13, 0x00, 0x50,
+	0x43, 0x47, 0x41, 0x41, 0x43, 0x0c, 0x00, 0x40, 0x47, 0x43, 0x43, 0x41,
+	0x1c, 0x00, 0xa0, 0x54, 0x47, 0x43, 0x54, 0x47, 0x47, 0x43, 0x41, 0x41,
+	0x54, 0x23, 0x00, 0x11, 0x43, 0x39, 0x00, 0x40, 0x47, 0x54, 0x41, 0x43,
+	0x32, 0x00, 0x40, 0x47, 0x41, 0x47, 0x47, 0x0a, 0x00, 0x11, 0x54, 0x20,
+	0x00, 0xa0, 0x54, 0x43, 0x41, 0x43, 0x41, 0x43, 0x43, 0x41, 0x54, 0x43,
+	0x20, 0x00, 0x00, 0x15, 0x00, 0x01, 0x04, 0x00, 0x01, 0x0d, 0x00, 0xb2,
+	0x43, 0x47, 0x41, 0x47, 0x41, 0x43, 0x41, 0x47, 0x47, 0x43, 0x43, 0x5c,
+	0x00, 0x10, 0x47, 0x68, 0x00, 0x30, 0x41, 0x41, 0x54, 0x7e, 0x00, 0x01,
+	0x30, 0x00, 0x10, 0x54, 0x5a, 0x00, 0x10, 0x43, 0x41, 0x00, 0x00, 0x64,
+	0x00, 0x00, 0x37, 0x00, 0x00, 0x23, 0x00, 0x01, 0xaa, 0x00, 0x01, 0x5d,
+	0x00, 0x11, 0x47, 0x8d, 0x00, 0x20, 0x43, 0x41, 0xa4, 0x00, 0x20, 0x41,
+	0x43, 0xb2, 0x00, 0x00, 0x0c, 0x00, 0x00, 0xc1, 0x00, 0x02, 0x8d, 0x00,
+	0x00, 0x21, 0x00, 0x20, 0x47, 0x54, 0xd3, 0x00, 0x10, 0x47, 0x57, 0x00,
+	0x00, 0x2b, 0x00, 0x01, 0x14, 0x00, 0x20, 0x43, 0x47, 0x5a, 0x00, 0x10,
+	0x41, 0x43, 0x00, 0x10, 0x41, 0x8c, 0x00, 0x11, 0x54, 0xba, 0x00, 0x01,
+	0x71, 0x00, 0x00, 0xd7, 0x00, 0x21, 0x54, 0x43, 0xdf, 0x00, 0x10, 0x47,
+	0x08, 0x01, 0x10, 0x47, 0x85, 0x00, 0x00, 0x14, 0x01, 0x11, 0x54, 0xd7,
+	0x00, 0x02, 0xaa, 0x00, 0x02, 0x13, 0x01, 0x71, 0x41, 0x43, 0x54, 0x41,
+	0x43, 0x41, 0x54, 0x58, 0x00, 0x01, 0x38, 0x01, 0x24, 0x43, 0x43, 0xf3,
+	0x00, 0x23, 0x43, 0x54, 0xfb, 0x00, 0x11, 0x41, 0x2e, 0x00, 0x31, 0x54,
+	0x43, 0x54, 0x60, 0x00, 0x01, 0x89, 0x00, 0x00, 0xe7, 0x00, 0x20, 0x43,
+	0x47, 0x63, 0x00, 0x03, 0x55, 0x00, 0x31, 0x41, 0x47, 0x41, 0xcf, 0x00,
+	0x01, 0x3e, 0x01, 0x11, 0x47, 0x30, 0x01, 0x00, 0x28, 0x00, 0x00, 0x59,
+	0x00, 0x00, 0x00, 0x01, 0x22, 0x41, 0x43, 0x32, 0x00, 0x00, 0x0e, 0x00,
+	0x11, 0x43, 0x66, 0x00, 0x11, 0x54, 0x05, 0x00, 0x00, 0x56, 0x00, 0x02,
+	0x0a, 0x00, 0x11, 0x43, 0x89, 0x00, 0x20, 0x47, 0x41, 0x85, 0x00, 0x01,
+	0xc2, 0x00, 0x01, 0xad, 0x01, 0x12, 0x41, 0xcb, 0x01, 0x11, 0x43, 0xbf,
+	0x00, 0x10, 0x41, 0x6b, 0x01, 0x02, 0xb5, 0x01, 0x00, 0x4d, 0x00, 0x01,
+	0x8b, 0x00, 0x10, 0x54, 0xb0, 0x00, 0x11, 0x54, 0x02, 0x00, 0x11, 0x41,
+	0x47, 0x00, 0x01, 0xcc, 0x01, 0x00, 0xb3, 0x00, 0x02, 0xfe, 0x00, 0x02,
+	0x1c, 0x01, 0x01, 0xe5, 0x01, 0x11, 0x43, 0xd7, 0x01, 0x12, 0x43, 0x36,
+	0x00, 0x22, 0x47, 0x41, 0x89, 0x00, 0x12, 0x47, 0xa7, 0x01, 0x11, 0x54,
+	0x84, 0x01, 0x01, 0x7d, 0x01, 0x01, 0x79, 0x00, 0x01, 0x9f, 0x00, 0x12,
+	0x41, 0xd9, 0x00, 0x21, 0x43, 0x43, 0x26, 0x01, 0x13, 0x41, 0x84, 0x01,
+	0x11, 0x43, 0xef, 0x01, 0x21, 0x47, 0x41, 0xfe, 0x00, 0x02, 0x35, 0x00,
+	0x02, 0xc6, 0x00, 0x00, 0x73, 0x01, 0x01, 0x3f, 0x01, 0x21, 0x54, 0x47,
+	0x21, 0x00, 0x02, 0xeb, 0x01, 0x00, 0x58, 0x01, 0x02, 0x18, 0x01, 0x00,
+	0x2c, 0x00, 0x10, 0x47, 0xd1, 0x00, 0x00, 0xea, 0x01, 0x01, 0xb3, 0x00,
+	0x00, 0x41, 0x00, 0x01, 0x79, 0x00, 0x01, 0xad, 0x02, 0x01, 0xe7, 0x00,
+	0x01, 0x64, 0x00, 0x23, 0x54, 0x41, 0xf6, 0x01, 0x03, 0x2f, 0x01, 0x00,
+	0x29, 0x00, 0x11, 0x41, 0x08, 0x00, 0x01, 0x94, 0x02, 0x02, 0x6e, 0x01,
+	0x00, 0x98, 0x00, 0x01, 0x14, 0x00, 0x12, 0x41, 0x50, 0x01, 0x00, 0x80,
+	0x01, 0x00, 0x51, 0x01, 0x00, 0x35, 0x01, 0x01, 0x8d, 0x01, 0x00, 0x08,
+	0x00, 0x00, 0x3f, 0x00, 0x01, 0x2a, 0x02, 0x12, 0x43, 0xf6, 0x02, 0x02,
+	0x29, 0x00, 0x11, 0x54, 0x99, 0x01, 0x01, 0x8f, 0x01, 0x02, 0x1f, 0x01,
+	0x00, 0x0e, 0x00, 0x22, 0x47, 0x47, 0x86, 0x02, 0x01, 0xbd, 0x02, 0x00,
+	0xc3, 0x00, 0x13, 0x43, 0x4a, 0x01, 0x00, 0x14, 0x01, 0x01, 0x64, 0x00,
+	0x11, 0x41, 0x31, 0x02, 0x00, 0xc7, 0x00, 0x03, 0x0b, 0x00, 0x01, 0x20,
+	0x02, 0x00, 0x2f, 0x00, 0x01, 0x0e, 0x01, 0x02, 0x25, 0x02, 0x22, 0x41,
+	0x41, 0xf6, 0x01, 0x21, 0x54, 0x41, 0xc8, 0x01, 0x02, 0x05, 0x00, 0x00,
+	0x67, 0x01, 0x01, 0x55, 0x00, 0x00, 0x53, 0x01, 0x13, 0x41, 0x5f, 0x03,
+	0x01, 0x3f, 0x02, 0x22, 0x41, 0x47, 0xeb, 0x01, 0x13, 0x47, 0xcb, 0x01,
+	0x01, 0x1c, 0x00, 0x00, 0xb0, 0x03, 0x11, 0x47, 0xbd, 0x00, 0x00, 0xdf,
+	0x00, 0x03, 0xe5, 0x01, 0x16, 0x41, 0x51, 0x00, 0x02, 0x9b, 0x03, 0x00,
+	0xba, 0x00, 0x01, 0x3d, 0x00, 0xa0, 0x43, 0x43, 0x47, 0x47, 0x43, 0x47,
+	0x43, 0x54, 0x41, 0x54,
+};
+
+/* LZ4 legacy frame with match offset beyond decompressed data */
+static const u8 decompress1_lz4_bad_offset[] = {
+	0x02, 0x21, 0x4c, 0x18, 0x07, 0x00, 0x00, 0x00, 0x40, 'a',  'b',  'c',
+	'd',  0x10, 0x00,
+};
+
+struct decompress1_ctx {
+	const u8 *in;
+	u32 in_len;
+	u32 in_pos;
+	u32 chunk;
+	const u8 *exp;
+	u32 exp_len;
+	u32 out_pos;
+};
+
+static int decompress1_read(void *priv, void *buf, u32 len)
+{
+	struct decompress1_ctx *ctx = priv;
+
+	if (ctx->chunk < len) {
+		len = ctx->chunk;
+	}
+	if ((ctx->in_len - ctx->in_pos) < len) {
+		len = ctx->in_len - ctx->in_pos;
+	}
+	memcpy(buf, ctx->in + ctx->in_pos, len);
+	ctx->in_pos += len;
+
+	return len;
+}
+
+static int decompress1_write(void *priv, const void *buf, u32 len)
+{
+	struct decompress1_ctx *ctx = priv;
+
+	if (((ctx->exp_len - ctx->out_pos) < len) ||
+	    memcmp(ctx->exp + ctx->out_pos, buf, len)) {
+		return VMM_EFAIL;
+	}
+	ctx->out_pos += len;
+
+	return VMM_OK;
+}
+
+static int decompress1_stream(enum decompress_format fmt,
+			      const u8 *in, u32 in_len, u32 chunk,
+			      const u8 *exp, u32 exp_len,
+			      struct decompress1_ctx *ctx, u64 *in_bytes)
+{
+	memset(ctx, 0, sizeof(*ctx));
+	ctx->in = in;
+	ctx->in_len = in_len;
+	ctx->chunk = chunk;
+	ctx->exp = exp;
+	ctx->exp_len = exp_len;
+
+	return decompress_stream(fmt, decompress1_read, decompress1_write,
+				 ctx, in_bytes, NULL);
+}
+
+static int decompress1_good(struct vmm_chardev *cdev, const char *name,
+			    enum decompress_format fmt,
+			    const u8 *in, u32 in_len,
+			    const u8 *exp, u32 exp_len)
+{
+	int rc;
+	u32 i;
+	u64 in_bytes;
+	struct decompress1_ctx ctx;
+	static const u32 chunks[] = { 1, 13, 4096 };
+
+	if (decompress_detect(in, in_len) != fmt) {
+		vmm_cprintf(cdev, "error: %s detected as %s\n", name,
+			    decompress_format_name(decompress_detect(in,
+								     in_len)));
+		return VMM_EFAIL;
+	}
+
+	for (i = 0; i < array_size(chunks); i++) {
+		rc = decompress1_stream(fmt, in, in_len, chunks[i],
+					exp, exp_len, &ctx, &in_bytes);
+		if (rc) {
+			vmm_cprintf(cdev, "error: %s chunk %d gives %d\n",
+				    name, chunks[i], rc);
+			return VMM_EFAIL;
+		}
+		if (ctx.out_pos != exp_len) {
+			vmm_cprintf(cdev, "error: %s chunk %d output %d "
+				    "bytes instead of %d\n",
+				    name, chunks[i], ctx.out_pos, exp_len);
+			return VMM_EFAIL;
+		}
+		if (in_bytes != in_len) {
+			vmm_cprintf(cdev, "error: %s chunk %d consumed %d "
+				    "bytes instead of %d\n",
+				    name, chunks[i], (u32)in_bytes, in_len);
+			return VMM_EFAIL;
+		}
+	}
+
+	return VMM_OK;
+}
+
+static int decompress1_bad(struct vmm_chardev *cdev, const char *name,
+			   enum decompress_format fmt,
+			   const u8 *in, u32 in_len,
+			   const u8 *exp, u32 exp_len)
+{
+	int rc;
+	struct decompress1_ctx ctx;
+
+	rc = decompress1_stream(fmt, in, in_len, 4096,
+				exp, exp_len, &ctx, NULL);
+	if (!rc) {
+		vmm_cprintf(cdev, "error: %s accepted\n", name);
+		return VMM_EFAIL;
+	}
+
+	return VMM_OK;
+}
+
+static int decompress1_run(struct wboxtest *test, struct vmm_chardev *cdev,
+			   u32 test_hcpu)
+{
+	int rc = VMM_OK;
+	u32 i, pos, len, seed;
+	u8 *exp, *buf;
+
+	exp = vmm_malloc(DECOMPRESS1_SIZE);
+	/* Scratch copy of largest stream for corruption */
+	buf = vmm_malloc(sizeof(decompress1_lz4));
+	if (!exp || !buf) {
+		vmm_cprintf(cdev, "error: failed to alloc buffers\n");
+		rc = VMM_ENOMEM;
+		goto done;
+	}
+
+	/* Build expected content */
+	pos = 0;
+	len = sizeof(DECOMPRESS1_LINE) - 1;
+	for (i = 0; i < DECOMPRESS1_LINE_COUNT; i++) {
+		memcpy(&exp[pos], DECOMPRESS1_LINE, len);
+		pos += len;
+	}
+	seed = 1;
+	for (i = 0; i < DECOMPRESS1_RAND_COUNT; i++) {
+		seed = (seed * 1103515245 + 12345) & 0x7fffffff;
+		exp[pos++] = "ACGT"[(seed >> 16) & 0x3];
+	}
+
+	/* Plain data and too short magic are not detected */
+	if ((decompress_detect(exp, DECOMPRESS1_SIZE) != DECOMPRESS_NONE) ||
+	    (decompress_detect(decompress1_gzip, 2) != DECOMPRESS_NONE) ||
+	    (decompress_detect(decompress1_lz4,
+			       DECOMPRESS_MAGIC_SIZE - 1) != DECOMPRESS_NONE)) {
+		vmm_cprintf(cdev, "error: detected format of plain data\n");
+		rc = VMM_EFAIL;
+	}
+
+	/* Round-trip of well-formed streams */
+	rc |= decompress1_good(cdev, "gzip", DECOMPRESS_GZIP,
+			decompress1_gzip, sizeof(decompress1_gzip),
+			exp, DECOMPRESS1_SIZE);
+	rc |= decompress1_good(cdev, "gzip fixed", DECOMPRESS_GZIP,
+			decompress1_gzip_fixed, sizeof(decompress1_gzip_fixed),
+			exp, DECOMPRESS1_SIZE);
+	rc |= decompress1_good(cdev, "gzip stored", DECOMPRESS_GZIP,
+			decompress1_gzip_stored,
+			sizeof(decompress1_gzip_stored),
+			exp, DECOMPRESS1_STORED_SIZE);
+	rc |= decompress1_good(cdev, "lz4", DECOMPRESS_LZ4,
+			decompress1_lz4, sizeof(decompress1_lz4),
+			exp, DECOMPRESS1_SIZE);
+	rc |= decompress1_good(cdev, "lz4 legacy", DECOMPRESS_LZ4,
+			decompress1_lz4_legacy, sizeof(decompress1_lz4_legacy),
+			exp, DECOMPRESS1_SIZE);
+
+	/* Uncompressed size appended by kbuild after LZ4 legacy frame */
+	len = sizeof(decompress1_lz4_legacy);
+	memcpy(buf, decompress1_lz4_legacy, len);
+	for (i = 0; i < 4; i++) {
+		buf[len++] = (DECOMPRESS1_SIZE >> (8 * i)) & 0xff;
+	}
+	rc |= decompress1_good(cdev, "lz4 legacy with size", DECOMPRESS_LZ4,
+			buf, len, exp, DECOMPRESS1_SIZE);
+
+	/* Truncated streams */
+	rc |= decompress1_bad(cdev, "gzip truncated", DECOMPRESS_GZIP,
+			decompress1_gzip, sizeof(decompress1_gzip) / 2,
+			exp, DECOMPRESS1_SIZE);
+	rc |= decompress1_bad(cdev, "gzip without size", DECOMPRESS_GZIP,
+			decompress1_gzip, sizeof(decompress1_gzip) - 4,
+			exp, DECOMPRESS1_SIZE);
+	rc |= decompress1_bad(cdev, "lz4 truncated", DECOMPRESS_LZ4,
+			decompress1_lz4, sizeof(decompress1_lz4) / 2,
+			exp, DECOMPRESS1_SIZE);
+	rc |= decompress1_bad(cdev, "lz4 legacy truncated", DECOMPRESS_LZ4,
+			decompress1_lz4_legacy,
+			sizeof(decompress1_lz4_legacy) / 2,
+			exp, DECOMPRESS1_SIZE);
+
+	/* Corrupted gzip trailer and block type */
+	len = sizeof(decompress1_gzip);
+	memcpy(buf, decompress1_gzip, len);
+	buf[len - 8] ^= 0x1;
+	rc |= decompress1_bad(cdev, "gzip bad crc", DECOMPRESS_GZIP,
+			buf, len, exp, DECOMPRESS1_SIZE);
+	memcpy(buf, decompress1_gzip, len);
+	buf[len - 4] ^= 0x1;
+	rc |= decompress1_bad(cdev, "gzip bad size", DECOMPRESS_GZIP,
+			buf, len, exp, DECOMPRESS1_SIZE);
+	len = sizeof(decompress1_gzip_fixed);
+	memcpy(buf, decompress1_gzip_fixed, len);
+	buf[10] |= 0x6;
+	rc |= decompress1_bad(cdev, "gzip reserved block", DECOMPRESS_GZIP,
+			buf, len, exp, DECOMPRESS1_SIZE);
+
+	/* Corrupted LZ4 block size and match offset */
+	len = sizeof(decompress1_lz4);
+	memcpy(buf, decompress1_lz4, len);
+	buf[10] = 0x7f;
+	rc |= decompress1_bad(cdev, "lz4 bad block size", DECOMPRESS_LZ4,
+			buf, len, exp, DECOMPRESS1_SIZE);
+	rc |= decompress1_bad(cdev, "lz4 bad offset", DECOMPRESS_LZ4,
+			decompress1_lz4_bad_offset,
+			sizeof(decompress1_lz4_bad_offset),
+			exp, DECOMPRESS1_SIZE);
+
+	/* Mismatched and unknown formats */
+	rc |= decompress1_bad(cdev, "lz4 as gzip", DECOMPRESS_GZIP,
+			decompress1_lz4, sizeof(decompress1_lz4),
+			exp, DECOMPRESS1_SIZE);
+	rc |= decompress1_bad(cdev, "gzip as lz4", DECOMPRESS_LZ4,
+			decompress1_gzip, sizeof(decompress1_gzip),
+			exp, DECOMPRESS1_SIZE);
+	rc |= decompress1_bad(cdev, "plain data", DECOMPRESS_NONE,
+			exp, DECOMPRESS1_SIZE, exp, DECOMPRESS1_SIZE);
+
+done:
+	if (buf) {
+		vmm_free(buf);
+	}
+	if (exp) {
+		vmm_free(exp);
+	}
+
+	return (rc) ? VMM_EFAIL : VMM_OK;
+}
+
+static struct wboxtest decompress1 = {
+	.name = "decompress1",
+	.run = decompress1_run,
+};
+
+static int __init decompress1_init(void)
+{
+	return wboxtest_register("decompress", &decompress1);
+}
+
+static void __exit decompress1_exit(void)
+{
+	wboxtest_unregister(&decompress1);
+}
+
+VMM_DECLARE_MODULE(MODULE_DESC,
+			MODULE_AUTHOR,
+			MODULE_LICENSE,
+			MODULE_IPRIORITY,
+			MODULE_INIT,
+			MODULE_EXIT);
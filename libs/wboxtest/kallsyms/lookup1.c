@@ -0,0 +1,173 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file lookup1.c
+ * @author agent (agent@local)
+ * @brief lookup1 test implementation
+ *
+ * This test verifies kallsyms_get_symbol_pos() against a plain
+ * binary search over kallsyms_addresses[] and then measures number
+ * of lookups per second for repeated and scattered addresses.
+ */
+
+#include <vmm_error.h>
+#include <vmm_stdio.h>
+#include <vmm_timer.h>
+#include <vmm_modules.h>
+#include <libs/mathlib.h>
+#include <libs/kallsyms.h>
+#include <libs/wboxtest.h>
+
+#define MODULE_DESC			"lookup1 test"
+#define MODULE_AUTHOR			"agent"
+#define MODULE_LICENSE			"GPL"
+#define MODULE_IPRIORITY		(WBOXTEST_IPRIORITY+1)
+#define	MODULE_INIT			lookup1_init
+#define	MODULE_EXIT			lookup1_exit
+
+#define LOOKUP_ITERATIONS		100000
+#define LOOKUP_STRIDE			7919
+
+/* Reference lookup without any index or cache */
+static unsigned long lookup1_reference(unsigned long addr)
+{
+	unsigned long low = 0, high = kallsyms_num_syms, mid;
+
+	while (high - low > 1) {
+		mid = low + (high - low) / 2;
+		if (kallsyms_addresses[mid] <= addr)
+			low = mid;
+		else
+			high = mid;
+	}
+
+	while (low && kallsyms_addresses[low - 1] == kallsyms_addresses[low])
+		--low;
+
+	return low;
+}
+
+static u64 lookup1_rate(u64 count, u64 tstamp)
+{
+	return (tstamp) ? udiv64(count * 1000000000ULL, tstamp) : 0;
+}
+
+static int lookup1_run(struct wboxtest *test, struct vmm_chardev *cdev,
+		       u32 test_hcpu)
+{
+	u64 tstamp, sum = 0;
+	unsigned long i, j, addr, pos, size, off;
+
+	if (!kallsyms_addresses || (kallsyms_num_syms < 2)) {
+		vmm_cprintf(cdev, "kallsyms not available\n");
+		return VMM_ENODEV;
+	}
+
+	/* Verify start and middle address of every symbol */
+	for (i = 0; i < kallsyms_num_syms; i++) {
+		addr = kallsyms_addresses[i];
+		pos = kallsyms_get_symbol_pos(addr, &size, &off);
+		if ((pos != lookup1_reference(addr)) || off) {
+			vmm_cprintf(cdev, "error: start of symbol %lu "
+				    "(0x%lx) gives pos %lu offset 0x%lx\n",
+				    i, addr, pos, off);
+			return VMM_EFAIL;
+		}
+		if (size > 1) {
+			addr += size / 2;
+			pos = kallsyms_get_symbol_pos(addr, NULL, &off);
+			if ((pos != lookup1_reference(addr)) ||
+			    (off != size / 2)) {
+				vmm_cprintf(cdev, "error: middle of symbol "
+					    "%lu (0x%lx) gives pos %lu\n",
+					    i, addr, pos);
+				return VMM_EFAIL;
+			}
+		}
+	}
+
+	/* Repeated lookups of same address */
+	addr = (unsigned long)lookup1_run;
+	tstamp = vmm_timer_timestamp();
+	for (i = 0; i < LOOKUP_ITERATIONS; i++) {
+		sum += kallsyms_get_symbol_pos(addr, NULL, NULL);
+	}
+	tstamp = vmm_timer_timestamp() - tstamp;
+	vmm_cprintf(cdev, "repeated  : %"PRIu64" lookups/sec\n",
+		    lookup1_rate(LOOKUP_ITERATIONS, tstamp));
+
+	/* Scattered lookups over whole symbol table */
+	tstamp = vmm_timer_timestamp();
+	for (i = 0, j = 0; i < LOOKUP_ITERATIONS; i++) {
+		j = (j + LOOKUP_STRIDE) % kallsyms_num_syms;
+		sum += kallsyms_get_symbol_pos(kallsyms_addresses[j],
+						NULL, NULL);
+	}
+	tstamp = vmm_timer_timestamp() - tstamp;
+	vmm_cprintf(cdev, "scattered : %"PRIu64" lookups/sec\n",
+		    lookup1_rate(LOOKUP_ITERATIONS, tstamp));
+
+	/* Scattered lookups using reference lookup for comparison */
+	tstamp = vmm_timer_timestamp();
+	for (i = 0, j = 0; i < LOOKUP_ITERATIONS; i++) {
+		j = (j + LOOKUP_STRIDE) % kallsyms_num_syms;
+		sum += lookup1_reference(kallsyms_addresses[j]);
+	}
+	tstamp = vmm_timer_timestamp() - tstamp;
+	vmm_cprintf(cdev, "reference : %"PRIu64" lookups/sec\n",
+		    lookup1_rate(LOOKUP_ITERATIONS, tstamp));
+
+	/* Symbol name expansion */
+	tstamp = vmm_timer_timestamp();
+	for (i = 0, j = 0; i < LOOKUP_ITERATIONS; i++) {
+		j = (j + LOOKUP_STRIDE) % kallsyms_num_syms;
+		sum += kallsyms_get_symbol_offset(j);
+	}
+	tstamp = vmm_timer_timestamp() - tstamp;
+	vmm_cprintf(cdev, "name      : %"PRIu64" lookups/sec\n",
+		    lookup1_rate(LOOKUP_ITERATIONS, tstamp));
+
+	/* Keep compiler from optimizing away the loops */
+	if (!sum) {
+		vmm_cprintf(cdev, "checksum is zero\n");
+	}
+
+	return VMM_OK;
+}
+
+static struct wboxtest lookup1 = {
+	.name = "lookup1",
+	.run = lookup1_run,
+};
+
+static int __init lookup1_init(void)
+{
+	return wboxtest_register("kallsyms", &lookup1);
+}
+
+static void __exit lookup1_exit(void)
+{
+	wboxtest_unregister(&lookup1);
+}
+
+VMM_DECLARE_MODULE(MODULE_DESC,
+			MODULE_AUTHOR,
+			MODULE_LICENSE,
+			MODULE_IPRIORITY,
+			MODULE_INIT,
+			MODULE_EXIT);
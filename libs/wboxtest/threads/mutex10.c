@@ -0,0 +1,175 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file mutex10.c
+ * @author agent (agent@local)
+ * @brief mutex10 test implementation
+ *
+ * This test creates worker threads spread over all online host CPUs
+ * which repeatedly lock the same mutex around a short critical section.
+ * It checks that no update of the shared counter is lost and reports
+ * lock/unlock pairs per second under contention.
+ */
+
+#include <vmm_error.h>
+#include <vmm_delay.h>
+#include <vmm_mutex.h>
+#include <vmm_smp.h>
+#include <vmm_stdio.h>
+#include <vmm_timer.h>
+#include <vmm_scheduler.h>
+#include <vmm_threads.h>
+#include <vmm_modules.h>
+#include <arch_atomic.h>
+#include <libs/mathlib.h>
+#include <libs/stringlib.h>
+#include <libs/wboxtest.h>
+
+#define MODULE_DESC			"mutex10 test"
+#define MODULE_AUTHOR			"agent"
+#define MODULE_LICENSE			"GPL"
+#define MODULE_IPRIORITY		(WBOXTEST_IPRIORITY+1)
+#define MODULE_INIT			mutex10_init
+#define MODULE_EXIT			mutex10_exit
+
+/* Number of threads */
+#define NUM_THREADS			4
+
+/* Number of lock/unlock pairs per thread */
+#define NUM_ITERATIONS			20000
+
+/* Length of critical section in loop iterations */
+#define CRITICAL_LOOPS			64
+
+/* Sleep delay in milliseconds */
+#define SLEEP_MSECS			(VMM_THREAD_DEF_TIME_SLICE/1000000ULL)
+
+/* Global data */
+static struct vmm_thread *workers[NUM_THREADS];
+static DEFINE_MUTEX(m1);
+static volatile u32 shared_count;
+static volatile u32 critical_work;
+static atomic_t done_count;
+
+static int mutex10_worker_thread_main(void *data)
+{
+	u32 i, j, val;
+
+	for (i = 0; i < NUM_ITERATIONS; i++) {
+		vmm_mutex_lock(&m1);
+		val = shared_count;
+		for (j = 0; j < CRITICAL_LOOPS; j++) {
+			critical_work++;
+		}
+		shared_count = val + 1;
+		vmm_mutex_unlock(&m1);
+	}
+
+	arch_atomic_add(&done_count, 1);
+
+	return 0;
+}
+
+static int mutex10_run(struct wboxtest *test, struct vmm_chardev *cdev,
+		       u32 test_hcpu)
+{
+	int i, ret = VMM_OK;
+	u32 c, cpus[CONFIG_CPU_COUNT], cpu_count = 0;
+	u64 tstamp;
+	char wname[VMM_FIELD_NAME_SIZE];
+	u8 current_priority = vmm_scheduler_current_priority();
+
+	/* Initialise global data */
+	memset(workers, 0, sizeof(workers));
+	shared_count = 0;
+	ARCH_ATOMIC_INIT(&done_count, 0);
+	for_each_cpu(c, cpu_online_mask) {
+		cpus[cpu_count++] = c;
+	}
+
+	/* Create worker threads spread over online host CPUs */
+	for (i = 0; i < NUM_THREADS; i++) {
+		vmm_snprintf(wname, VMM_FIELD_NAME_SIZE,
+			     "mutex10_worker%d", i);
+		workers[i] = vmm_threads_create(wname,
+						mutex10_worker_thread_main,
+						(void *)(unsigned long)i,
+						current_priority,
+						VMM_THREAD_DEF_TIME_SLICE);
+		if (workers[i] == NULL) {
+			ret = VMM_EFAIL;
+			goto destroy_workers;
+		}
+		vmm_threads_set_affinity(workers[i],
+				vmm_cpumask_of(cpus[i % cpu_count]));
+	}
+
+	/* Start workers and wait for all of them to finish */
+	tstamp = vmm_timer_timestamp();
+	for (i = 0; i < NUM_THREADS; i++) {
+		vmm_threads_start(workers[i]);
+	}
+	while (arch_atomic_read(&done_count) < NUM_THREADS) {
+		vmm_msleep(SLEEP_MSECS);
+	}
+	tstamp = vmm_timer_timestamp() - tstamp;
+
+	if (shared_count != (NUM_THREADS * NUM_ITERATIONS)) {
+		vmm_cprintf(cdev, "error: shared count %d expected %d\n",
+			    shared_count, NUM_THREADS * NUM_ITERATIONS);
+		ret = VMM_EFAIL;
+	}
+
+	vmm_cprintf(cdev, "%d threads on %d CPUs: %"PRIu64" locks/sec\n",
+		    NUM_THREADS, cpu_count,
+		    (tstamp) ? udiv64((u64)NUM_THREADS * NUM_ITERATIONS *
+				      1000000000ULL, tstamp) : 0);
+
+	/* Destroy worker threads */
+destroy_workers:
+	for (i = 0; i < NUM_THREADS; i++) {
+		if (workers[i]) {
+			vmm_threads_destroy(workers[i]);
+			workers[i] = NULL;
+		}
+	}
+
+	return ret;
+}
+
+static struct wboxtest mutex10 = {
+	.name = "mutex10",
+	.run = mutex10_run,
+};
+
+static int __init mutex10_init(void)
+{
+	return wboxtest_register("threads", &mutex10);
+}
+
+static void __exit mutex10_exit(void)
+{
+	wboxtest_unregister(&mutex10);
+}
+
+VMM_DECLARE_MODULE(MODULE_DESC,
+			MODULE_AUTHOR,
+			MODULE_LICENSE,
+			MODULE_IPRIORITY,
+			MODULE_INIT,
+			MODULE_EXIT);
@@ -0,0 +1,289 @@
+/**
+ * Copyright (c) 2026 agent.
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file rwsem1.c
+ * @author agent (agent@local)
+ * @brief rwsem1 test implementation
+ *
+ * This test first exercises reader-writer semaphore APIs including
+ * the trylock and timeout failure cases. After that it creates worker
+ * threads spread over all online host CPUs doing mostly reads and
+ * occasional writes on the same rwsem. Readers check that they never
+ * observe a half-done write and we report operations per second.
+ */
+
+#include <vmm_error.h>
+#include <vmm_delay.h>
+#include <vmm_rwsem.h>
+#include <vmm_smp.h>
+#include <vmm_stdio.h>
+#include <vmm_timer.h>
+#include <vmm_scheduler.h>
+#include <vmm_threads.h>
+#include <vmm_modules.h>
+#include <arch_atomic.h>
+#include <libs/mathlib.h>
+#include <libs/stringlib.h>
+#include <libs/wboxtest.h>
+
+#define MODULE_DESC			"rwsem1 test"
+#define MODULE_AUTHOR			"agent"
+#define MODULE_LICENSE			"GPL"
+#define MODULE_IPRIORITY		(WBOXTEST_IPRIORITY+1)
+#define MODULE_INIT			rwsem1_init
+#define MODULE_EXIT			rwsem1_exit
+
+/* Number of threads */
+#define NUM_THREADS			4
+
+/* Number of operations per thread */
+#define NUM_ITERATIONS			20000
+
+/* One out of these many operations is a write */
+#define WRITE_RATIO			16
+
+/* Sleep delay in milliseconds */
+#define SLEEP_MSECS			(VMM_THREAD_DEF_TIME_SLICE/1000000ULL)
+
+/* Global data */
+static struct vmm_thread *workers[NUM_THREADS];
+static DEFINE_RWSEM(s1);
+static volatile u32 shared_a;
+static volatile u32 shared_b;
+static atomic_t done_count;
+static atomic_t bad_reads;
+
+static int rwsem1_holder_thread_main(void *data)
+{
+	int rc;
+
+	rc = vmm_rwsem_down_write(&s1);
+	if (rc) {
+		return rc;
+	}
+
+	while (1) {
+		vmm_msleep(SLEEP_MSECS);
+	}
+
+	return 0;
+}
+
+static int rwsem1_worker_thread_main(void *data)
+{
+	u32 i, a, b;
+
+	for (i = 0; i < NUM_ITERATIONS; i++) {
+		if (!(i % WRITE_RATIO)) {
+			vmm_rwsem_down_write(&s1);
+			shared_a = shared_a + 1;
+			shared_b = shared_b + 1;
+			vmm_rwsem_up_write(&s1);
+		} else {
+			vmm_rwsem_down_read(&s1);
+			a = shared_a;
+			b = shared_b;
+			vmm_rwsem_up_read(&s1);
+			if (a != b) {
+				arch_atomic_add(&bad_reads, 1);
+			}
+		}
+	}
+
+	arch_atomic_add(&done_count, 1);
+
+	return 0;
+}
+
+static int rwsem1_api_test(struct vmm_chardev *cdev, u32 test_hcpu)
+{
+	int rc, failures = 0;
+	u64 timeout;
+	struct vmm_thread *holder;
+
+	/* Multiple readers are allowed */
+	if ((vmm_rwsem_down_read(&s1) != VMM_OK) ||
+	    !vmm_rwsem_down_read_trylock(&s1)) {
+		vmm_cprintf(cdev, "error: second reader failed\n");
+		return VMM_EFAIL;
+	}
+
+	/* Writer must fail while readers hold it */
+	if (vmm_rwsem_down_write_trylock(&s1)) {
+		vmm_cprintf(cdev, "error: writer trylock passed with readers\n");
+		vmm_rwsem_up_write(&s1);
+		failures++;
+	}
+
+	vmm_rwsem_up_read(&s1);
+	vmm_rwsem_up_read(&s1);
+
+	/* Extra reader unlock should fail */
+	if (vmm_rwsem_up_read(&s1) == VMM_OK) {
+		vmm_cprintf(cdev, "error: additional reader unlock passed\n");
+		failures++;
+	}
+
+	/* Writer should get it now and exclude readers */
+	if (!vmm_rwsem_down_write_trylock(&s1)) {
+		vmm_cprintf(cdev, "error: writer trylock failed on free rwsem\n");
+		return VMM_EFAIL;
+	}
+	if (vmm_rwsem_down_read_trylock(&s1)) {
+		vmm_cprintf(cdev, "error: reader trylock passed with writer\n");
+		vmm_rwsem_up_read(&s1);
+		failures++;
+	}
+	vmm_rwsem_up_write(&s1);
+	if (!vmm_rwsem_avail(&s1)) {
+		vmm_cprintf(cdev, "error: rwsem not free after writer\n");
+		failures++;
+	}
+
+	/* Reader should timeout while other thread holds writer lock */
+	holder = vmm_threads_create("rwsem1_holder",
+				    rwsem1_holder_thread_main, NULL,
+				    vmm_scheduler_current_priority(),
+				    VMM_THREAD_DEF_TIME_SLICE);
+	if (!holder) {
+		return VMM_EFAIL;
+	}
+	vmm_threads_set_affinity(holder, vmm_cpumask_of(test_hcpu));
+	vmm_threads_start(holder);
+	while (vmm_rwsem_avail(&s1)) {
+		vmm_msleep(SLEEP_MSECS);
+	}
+
+	timeout = SLEEP_MSECS * 1000000LL;
+	rc = vmm_rwsem_down_read_timeout(&s1, &timeout);
+	if (rc != VMM_ETIMEDOUT) {
+		vmm_cprintf(cdev, "error: did not get reader timeout\n");
+		failures++;
+	}
+
+	/* Stopping holder releases its writer lock */
+	vmm_threads_stop(holder);
+	vmm_threads_destroy(holder);
+	if (!vmm_rwsem_avail(&s1)) {
+		vmm_cprintf(cdev, "error: rwsem not released by cleanup\n");
+		failures++;
+	}
+
+	return (failures) ? VMM_EFAIL : VMM_OK;
+}
+
+static int rwsem1_run(struct wboxtest *test, struct vmm_chardev *cdev,
+		      u32 test_hcpu)
+{
+	int i, ret = VMM_OK;
+	u32 c, cpus[CONFIG_CPU_COUNT], cpu_count = 0;
+	u64 tstamp;
+	char wname[VMM_FIELD_NAME_SIZE];
+	u8 current_priority = vmm_scheduler_current_priority();
+
+	/* Initialise global data */
+	memset(workers, 0, sizeof(workers));
+	shared_a = shared_b = 0;
+	ARCH_ATOMIC_INIT(&done_count, 0);
+	ARCH_ATOMIC_INIT(&bad_reads, 0);
+	for_each_cpu(c, cpu_online_mask) {
+		cpus[cpu_count++] = c;
+	}
+
+	/* Check APIs first */
+	ret = rwsem1_api_test(cdev, test_hcpu);
+	if (ret) {
+		return ret;
+	}
+
+	/* Create worker threads spread over online host CPUs */
+	for (i = 0; i < NUM_THREADS; i++) {
+		vmm_snprintf(wname, VMM_FIELD_NAME_SIZE,
+			     "rwsem1_worker%d", i);
+		workers[i] = vmm_threads_create(wname,
+						rwsem1_worker_thread_main,
+						(void *)(unsigned long)i,
+						current_priority,
+						VMM_THREAD_DEF_TIME_SLICE);
+		if (workers[i] == NULL) {
+			ret = VMM_EFAIL;
+			goto destroy_workers;
+		}
+		vmm_threads_set_affinity(workers[i],
+				vmm_cpumask_of(cpus[i % cpu_count]));
+	}
+
+	/* Start workers and wait for all of them to finish */
+	tstamp = vmm_timer_timestamp();
+	for (i = 0; i < NUM_THREADS; i++) {
+		vmm_threads_start(workers[i]);
+	}
+	while (arch_atomic_read(&done_count) < NUM_THREADS) {
+		vmm_msleep(SLEEP_MSECS);
+	}
+	tstamp = vmm_timer_timestamp() - tstamp;
+
+	if (arch_atomic_read(&bad_reads)) {
+		vmm_cprintf(cdev, "error: %d readers saw partial write\n",
+			    (int)arch_atomic_read(&bad_reads));
+		ret = VMM_EFAIL;
+	}
+	if (shared_a != (NUM_THREADS * (NUM_ITERATIONS / WRITE_RATIO))) {
+		vmm_cprintf(cdev, "error: write count %d expected %d\n",
+			    shared_a, NUM_THREADS * (NUM_ITERATIONS / WRITE_RATIO));
+		ret = VMM_EFAIL;
+	}
+
+	vmm_cprintf(cdev, "%d threads on %d CPUs: %"PRIu64" ops/sec\n",
+		    NUM_THREADS, cpu_count,
+		    (tstamp) ? udiv64((u64)NUM_THREADS * NUM_ITERATIONS *
+				      1000000000ULL, tstamp) : 0);
+
+	/* Destroy worker threads */
+destroy_workers:
+	for (i = 0; i < NUM_THREADS; i++) {
+		if (workers[i]) {
+			vmm_threads_destroy(workers[i]);
+			workers[i] = NULL;
+		}
+	}
+
+	return ret;
+}
+
+static struct wboxtest rwsem1 = {
+	.name = "rwsem1",
+	.run = rwsem1_run,
+};
+
+static int __init rwsem1_init(void)
+{
+	return wboxtest_register("threads", &rwsem1);
+}
+
+static void __exit rwsem1_exit(void)
+{
+	wboxtest_unregister(&rwsem1);
+}
+
+VMM_DECLARE_MODULE(MODULE_DESC,
+			MODULE_AUTHOR,
+			MODULE_LICENSE,
+			MODULE_IPRIORITY,
+			MODULE_INIT,
+			MODULE_EXIT);